@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Camera position and look-at point at the given time of a benchmark run
+struct BenchmarkCameraKey
+{
+    float  Time = 0;
+    float3 Pos;
+    float3 LookAt;
+};
+
+/// Scripted camera path of a benchmark run, keys are interpolated with Catmull-Rom splines
+class BenchmarkCameraPath
+{
+public:
+    /// Reads a text file with one key per line: time, position xyz and look-at xyz,
+    /// separated by white space. Empty lines and lines starting with # are skipped.
+    bool Load(const char* FilePath);
+
+    void AddKey(const BenchmarkCameraKey& Key);
+    bool IsEmpty() const { return m_Keys.empty(); }
+
+    /// Time is clamped to the first and the last key
+    void Evaluate(float Time, float3& Pos, float3& LookAt) const;
+
+private:
+    std::vector<BenchmarkCameraKey> m_Keys;
+};
+
+/// Percentile summary of one metric
+struct BenchmarkMetric
+{
+    std::string Name;
+    std::string Unit;
+
+    Uint32 NumSamples = 0;
+
+    double Mean = 0;
+    double Min  = 0;
+    double P50  = 0;
+    double P95  = 0;
+    double P99  = 0;
+    double Max  = 0;
+};
+
+/// Per-frame samples of a benchmark run
+class BenchmarkRecorder
+{
+public:
+    void AddSample(const std::string& Name, const char* Unit, double Value);
+
+    /// Sorted by name
+    std::vector<BenchmarkMetric> Summarize() const;
+
+private:
+    struct Samples
+    {
+        std::string         Unit;
+        std::vector<double> Values;
+    };
+    std::map<std::string, Samples> m_Samples;
+};
+
+/// Run description written to the report next to the metrics
+struct BenchmarkRunInfo
+{
+    std::string SampleName;
+    std::string DeviceType;
+    std::string Adapter;
+    Uint32      Width  = 0;
+    Uint32      Height = 0;
+    Uint32      Frames = 0;
+    Uint32      Warmup = 0;
+};
+
+struct BenchmarkRegression
+{
+    std::string Name;
+    std::string Unit;
+
+    double BaselineP50 = 0;
+    double CurrentP50  = 0;
+    double BaselineP95 = 0;
+    double CurrentP95  = 0;
+};
+
+/// Writes the run info and the metrics as JSON. Regressions, when not null, are
+/// listed in the report too.
+bool WriteBenchmarkReport(const char*                             FilePath,
+                          const BenchmarkRunInfo&                 Info,
+                          const std::vector<BenchmarkMetric>&     Metrics,
+                          const std::vector<BenchmarkRegression>* pRegressions = nullptr);
+
+/// Reads the metrics of a report written by WriteBenchmarkReport
+bool ReadBenchmarkReport(const char* FilePath, std::vector<BenchmarkMetric>& Metrics);
+
+/// A metric regresses when its median or its 95th percentile grows by more than
+/// TolerancePercent. Time metrics must also grow by more than MinTimeDeltaMs, which
+/// keeps scopes that take a few microseconds from flagging noise. Metrics missing
+/// from either side are skipped.
+std::vector<BenchmarkRegression> CompareBenchmarkMetrics(const std::vector<BenchmarkMetric>& Baseline,
+                                                         const std::vector<BenchmarkMetric>& Current,
+                                                         double                              TolerancePercent,
+                                                         double                              MinTimeDeltaMs);
+
+} // namespace Diligent
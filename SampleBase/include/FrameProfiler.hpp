@@ -0,0 +1,301 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+
+namespace Diligent
+{
+
+/// Process-wide identifier of a profiled scope, see FrameProfiler::RegisterScope
+using ProfileScopeId = Uint32;
+
+static constexpr ProfileScopeId InvalidProfileScopeId = ~Uint32{0};
+
+/// One closed CPU or GPU scope
+struct ProfileEvent
+{
+    ProfileScopeId ScopeId = InvalidProfileScopeId;
+
+    /// Nesting level, 0 for scopes opened outside of any other scope
+    Uint32 Depth = 0;
+
+    /// Index of the thread in FrameProfiler::GetThreadName, 0 for GPU events
+    Uint32 ThreadIndex = 0;
+
+    Uint32 Padding = 0;
+
+    /// Seconds since the profiler was created. GPU events are placed on the same
+    /// time line by aligning the first timestamp of a frame with its CPU begin time.
+    double Begin = 0;
+    double End   = 0;
+};
+
+/// Events of one frame, ordered by thread and begin time
+struct ProfileFrame
+{
+    Uint64 FrameNumber = 0;
+    double Begin       = 0;
+    double End         = 0;
+
+    std::vector<ProfileEvent> Events;
+};
+
+struct FrameProfilerStats
+{
+    /// CPU events lost because the ring buffer of their thread was full
+    Uint32 DroppedCPUEvents = 0;
+
+    /// GPU frames whose timestamps were not available when their slot was reused
+    Uint32 DroppedGPUFrames = 0;
+
+    /// GPU scopes opened after the per-frame query pool was exhausted
+    Uint32 DroppedGPUScopes = 0;
+
+    /// Frames between the CPU end of a frame and the resolution of its timestamps
+    Uint32 GPULatency = 0;
+};
+
+/// Hierarchical CPU and GPU frame profiler.
+///
+/// CPU scopes are recorded per thread into single-producer ring buffers that are
+/// drained by EndFrame, so opening and closing a scope never takes a lock. GPU scopes
+/// write timestamp queries taken from a pool owned by a ring of frame slots; the
+/// results are polled without waiting and a slot that is still not ready when it is
+/// reused is dropped rather than stalling the CPU.
+///
+/// Scopes are identified by ids registered once, typically in a function-local static
+/// through the PROFILE_CPU_SCOPE / PROFILE_GPU_SCOPE macros.
+class FrameProfiler
+{
+public:
+    FrameProfiler();
+    ~FrameProfiler();
+
+    // clang-format off
+    FrameProfiler           (const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+    // clang-format on
+
+    /// Creates the GPU query pools. GPU scopes are ignored when the device does not
+    /// support timestamp queries or the profiler was not initialized.
+    /// NumFrameSlots is the number of frames in flight plus one.
+    void Initialize(IRenderDevice* pDevice, Uint32 NumFrameSlots = 4, Uint32 MaxGPUScopesPerFrame = 32);
+
+    /// Returns the id of the scope Name, registering it on the first call. Names are
+    /// compared by value, the same name always yields the same id.
+    static ProfileScopeId RegisterScope(const char* Name, Uint32 Color = 0xFFFFFFFFu);
+
+    static const char* GetScopeName(ProfileScopeId Id);
+    static Uint32      GetScopeColor(ProfileScopeId Id);
+    static Uint32      GetNumScopes();
+
+    /// Names the calling thread in the exported traces
+    void        SetThreadName(const char* Name);
+    const char* GetThreadName(Uint32 ThreadIndex) const;
+    Uint32      GetNumThreads() const;
+
+    void BeginFrame(IDeviceContext* pContext);
+    void EndFrame(IDeviceContext* pContext);
+
+    void BeginCPUScope(ProfileScopeId Id);
+    void EndCPUScope();
+
+    /// Returns the handle to pass to EndGPUScope
+    Uint32 BeginGPUScope(IDeviceContext* pContext, ProfileScopeId Id);
+    void   EndGPUScope(IDeviceContext* pContext, Uint32 Handle);
+
+    bool IsInFrame() const { return m_bInFrame; }
+    bool IsGPUProfilingSupported() const;
+
+    /// The last frame drained by EndFrame
+    const ProfileFrame& GetLastCPUFrame() const { return m_LastCPUFrame; }
+
+    /// The last frame whose timestamps were resolved, it lags GetLastCPUFrame
+    /// by FrameProfilerStats::GPULatency frames
+    const ProfileFrame& GetLastGPUFrame() const { return m_LastGPUFrame; }
+
+    const FrameProfilerStats& GetStats() const { return m_Stats; }
+
+    /// Seconds since the profiler was created
+    double GetTime() const;
+
+    /// Keeps the frames ended from now on, at most MaxFrames of them
+    void StartCapture(Uint32 MaxFrames = ~Uint32{0});
+    void StopCapture();
+    void ClearCapture();
+
+    bool   IsCapturing() const { return m_bCapturing; }
+    Uint32 GetNumCapturedFrames() const;
+
+    /// True once the capture is stopped and every captured frame has its GPU events
+    /// resolved or dropped
+    bool IsCaptureResolved() const;
+
+    /// Writes the capture in the Chrome trace event format (chrome://tracing, Perfetto).
+    /// CPU threads are listed under process 0, the GPU under process 1.
+    bool ExportChromeTrace(const char* FilePath) const;
+
+    /// Writes the capture in the binary format described in FrameProfiler.cpp
+    bool ExportBinary(const char* FilePath) const;
+
+private:
+    struct ThreadData;
+    struct GPUFrameSlot;
+    struct CapturedFrame;
+
+    ThreadData& GetThreadData();
+    void        DrainThreads(ProfileFrame& Frame);
+    Uint32      AcquireQuery(GPUFrameSlot& Slot);
+    void        ResolveGPUFrames();
+    void        DropGPUFrame(GPUFrameSlot& Slot);
+
+    const std::chrono::steady_clock::time_point m_StartTime;
+    const Uint64                                m_InstanceId;
+
+    mutable std::mutex                       m_ThreadsMtx;
+    std::vector<std::unique_ptr<ThreadData>> m_Threads;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    std::vector<GPUFrameSlot>    m_GPUFrames;
+    std::vector<Uint64>          m_Timestamps;
+    Uint32                       m_MaxGPUScopesPerFrame = 0;
+    Uint32                       m_CurrGPUFrame         = 0;
+    Uint32                       m_GPUFrameScopeHandle  = ~Uint32{0};
+
+    Uint64 m_FrameNumber    = 0;
+    double m_FrameBeginTime = 0;
+    bool   m_bInFrame       = false;
+
+    ProfileFrame       m_LastCPUFrame;
+    ProfileFrame       m_LastGPUFrame;
+    FrameProfilerStats m_Stats;
+
+    bool                       m_bCapturing       = false;
+    Uint32                     m_MaxCaptureFrames = 0;
+    std::vector<CapturedFrame> m_Capture;
+};
+
+/// Closes the CPU scope on destruction
+class CPUProfileScope
+{
+public:
+    CPUProfileScope(FrameProfiler* pProfiler, ProfileScopeId Id) :
+        m_pProfiler{pProfiler}
+    {
+        if (m_pProfiler != nullptr)
+            m_pProfiler->BeginCPUScope(Id);
+    }
+
+    ~CPUProfileScope()
+    {
+        if (m_pProfiler != nullptr)
+            m_pProfiler->EndCPUScope();
+    }
+
+    // clang-format off
+    CPUProfileScope           (const CPUProfileScope&) = delete;
+    CPUProfileScope& operator=(const CPUProfileScope&) = delete;
+    // clang-format on
+
+private:
+    FrameProfiler* const m_pProfiler;
+};
+
+/// Closes the GPU scope on destruction
+class GPUProfileScope
+{
+public:
+    GPUProfileScope(FrameProfiler* pProfiler, IDeviceContext* pContext, ProfileScopeId Id) :
+        m_pProfiler{pProfiler},
+        m_pContext{pContext}
+    {
+        if (m_pProfiler != nullptr)
+            m_Handle = m_pProfiler->BeginGPUScope(m_pContext, Id);
+    }
+
+    ~GPUProfileScope()
+    {
+        if (m_pProfiler != nullptr)
+            m_pProfiler->EndGPUScope(m_pContext, m_Handle);
+    }
+
+    // clang-format off
+    GPUProfileScope           (const GPUProfileScope&) = delete;
+    GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+    // clang-format on
+
+private:
+    FrameProfiler* const  m_pProfiler;
+    IDeviceContext* const m_pContext;
+    Uint32                m_Handle = ~Uint32{0};
+};
+
+/// Times the same code on the CPU and on the GPU
+class CPUAndGPUProfileScope
+{
+public:
+    CPUAndGPUProfileScope(FrameProfiler* pProfiler, IDeviceContext* pContext, ProfileScopeId Id) :
+        m_CPU{pProfiler, Id},
+        m_GPU{pProfiler, pContext, Id}
+    {}
+
+private:
+    CPUProfileScope m_CPU;
+    GPUProfileScope m_GPU;
+};
+
+} // namespace Diligent
+
+#define PROFILE_SCOPE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b)      PROFILE_SCOPE_CONCAT_IMPL(a, b)
+
+/// Registers Name once and opens a CPU scope until the end of the enclosing block
+#define PROFILE_CPU_SCOPE(pProfiler, Name, Color)                                                                                                        \
+    static const ::Diligent::ProfileScopeId PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__) = ::Diligent::FrameProfiler::RegisterScope(Name, Color); \
+    ::Diligent::CPUProfileScope PROFILE_SCOPE_CONCAT(_CPUProfileScope, __LINE__){pProfiler, PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__)}
+
+/// Registers Name once and opens a GPU scope on pContext until the end of the enclosing block
+#define PROFILE_GPU_SCOPE(pProfiler, pContext, Name, Color)                                                                                              \
+    static const ::Diligent::ProfileScopeId PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__) = ::Diligent::FrameProfiler::RegisterScope(Name, Color); \
+    ::Diligent::GPUProfileScope PROFILE_SCOPE_CONCAT(_GPUProfileScope, __LINE__){pProfiler, pContext, PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__)}
+
+/// Registers Name once and opens a CPU and a GPU scope until the end of the enclosing block
+#define PROFILE_CPU_AND_GPU_SCOPE(pProfiler, pContext, Name, Color)                                                                                      \
+    static const ::Diligent::ProfileScopeId PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__) = ::Diligent::FrameProfiler::RegisterScope(Name, Color); \
+    ::Diligent::CPUAndGPUProfileScope PROFILE_SCOPE_CONCAT(_ProfileScope, __LINE__){pProfiler, pContext, PROFILE_SCOPE_CONCAT(_ProfileScopeId, __LINE__)}
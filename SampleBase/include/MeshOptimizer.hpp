@@ -0,0 +1,110 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Post-transform vertex cache model used by SimulateVertexCache
+enum VERTEX_CACHE_TYPE
+{
+    /// Vertices are evicted in the order they were loaded, hits do not refresh them
+    VERTEX_CACHE_TYPE_FIFO = 0,
+
+    /// Every hit moves the vertex to the front of the cache
+    VERTEX_CACHE_TYPE_LRU
+};
+
+struct VertexCacheStats
+{
+    Uint32 NumTriangles   = 0;
+    Uint32 NumVertices    = 0; // Distinct vertices referenced by the index list
+    Uint32 NumCacheMisses = 0;
+
+    /// Average cache miss ratio - transformed vertices per triangle, 0.5 is the limit for a regular grid
+    float ACMR = 0;
+
+    /// Average transform to vertex ratio - transformed vertices per referenced vertex, 1.0 is optimal
+    float ATVR = 0;
+};
+
+/// Runs a triangle list through a simulated post-transform cache of CacheSize entries
+VertexCacheStats SimulateVertexCache(const Uint32*     pIndices,
+                                     Uint32            NumIndices,
+                                     Uint32            NumVertices,
+                                     Uint32            CacheSize,
+                                     VERTEX_CACHE_TYPE CacheType);
+
+/// Reorders the triangles of a list for vertex cache reuse with Tom Forsyth's
+/// "Linear-Speed Vertex Cache Optimisation". The algorithm scores vertices against a
+/// simulated LRU cache and does not depend on the exact cache size of the hardware.
+/// pDstIndices may not alias pIndices. Winding order of every triangle is preserved.
+void OptimizeVertexCacheForsyth(const Uint32* pIndices,
+                                Uint32        NumIndices,
+                                Uint32        NumVertices,
+                                Uint32*       pDstIndices);
+
+/// Reorders the triangles of a list with Tipsify (Sander, Nehab, Barczak, "Fast Triangle
+/// Reordering for Vertex Locality and Reduced Overdraw"). Runs in linear time and targets
+/// a FIFO cache of CacheSize entries. pDstIndices may not alias pIndices.
+void OptimizeVertexCacheTipsify(const Uint32* pIndices,
+                                Uint32        NumIndices,
+                                Uint32        NumVertices,
+                                Uint32        CacheSize,
+                                Uint32*       pDstIndices);
+
+/// Renumbers vertices in the order they are first referenced by the index list so that
+/// vertex fetches walk the vertex buffer linearly. Indices are rewritten in place,
+/// Remap receives the new location of every old vertex (~0u for unreferenced vertices).
+/// Returns the number of referenced vertices.
+Uint32 OptimizeVertexFetch(Uint32*              pIndices,
+                           Uint32               NumIndices,
+                           Uint32               NumVertices,
+                           std::vector<Uint32>& Remap);
+
+/// Moves vertices to the locations computed by OptimizeVertexFetch, unreferenced vertices are dropped
+template <typename VertexType>
+void RemapVertices(std::vector<VertexType>& Vertices, const std::vector<Uint32>& Remap, Uint32 NumRemappedVertices)
+{
+    std::vector<VertexType> Remapped(NumRemappedVertices);
+    for (size_t v = 0; v < Remap.size(); ++v)
+    {
+        if (Remap[v] != ~0u)
+            Remapped[Remap[v]] = Vertices[v];
+    }
+    Vertices.swap(Remapped);
+}
+
+/// Expands a triangle strip into a list with the same winding, degenerate triangles are skipped
+void ConvertTriangleStripToList(const Uint32* pStripIndices, Uint32 NumStripIndices, std::vector<Uint32>& ListIndices);
+
+} // namespace Diligent
@@ -39,7 +39,9 @@
 #include "SwapChain.h"
 #include "SampleBase.hpp"
 #include "ScreenCapture.hpp"
+#include "ScopedQueryHelper.hpp"
 #include "Image.h"
+#include "Benchmark.hpp"
 
 namespace Diligent
 {
@@ -99,6 +101,10 @@ protected:
     void CompareGoldenImage(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
     void SaveScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
 
+    void InitializeBenchmark();
+    void UpdateBenchmark();
+    void FinishBenchmark();
+
     RENDER_DEVICE_TYPE                         m_DeviceType = RENDER_DEVICE_TYPE_UNDEFINED;
     RefCntAutoPtr<IEngineFactory>              m_pEngineFactory;
     RefCntAutoPtr<IRenderDevice>               m_pDevice;
@@ -145,6 +151,33 @@ protected:
     } m_ScreenCaptureInfo;
     std::unique_ptr<ScreenCapture> m_pScreenCapture;
 
+    struct ProfileCaptureInfo
+    {
+        Uint32      FramesToCapture = 0;
+        std::string FilePath        = "profile";
+    } m_ProfileCaptureInfo;
+
+    struct BenchmarkInfo
+    {
+        Uint32      MeasuredFrames = 0; // 0 - benchmark mode is off
+        Uint32      WarmupFrames   = 30;
+        double      TimeStep       = 1.0 / 60.0; // Simulated time between frames
+        std::string OutputPath     = "benchmark.json";
+        std::string CameraPathFile;
+        std::string BaselinePath;
+        double      TolerancePercent = 10;
+        double      MinTimeDeltaMs   = 0.05;
+
+        BenchmarkCameraPath CameraPath;
+        BenchmarkRecorder   Recorder;
+
+        Uint32 CurrentFrame       = 0; // Frames run, warm-up included
+        Uint64 FirstMeasuredFrame = 0; // Profiler frame number
+        Uint64 LastGPUFrame       = ~Uint64{0};
+        double LastFrameBegin     = -1;
+    } m_BenchmarkInfo;
+    std::unique_ptr<ScopedQueryHelper> m_pPipelineStatsQuery;
+
     std::unique_ptr<ImGuiImplDiligent> m_pImGui;
 
     GoldenImageMode m_GoldenImgMode           = GoldenImageMode::None;
@@ -36,11 +36,13 @@
 #include "SwapChain.h"
 #include "InputController.hpp"
 #include "BasicMath.hpp"
+#include "FrameProfiler.hpp"
 
 namespace Diligent
 {
 
 class ImGuiImplDiligent;
+class BenchmarkCameraPath;
 
 struct SampleInitInfo
 {
@@ -70,11 +72,22 @@ public:
     virtual const Char* GetSampleName() const { return "Diligent Engine Sample"; }
     virtual void        ProcessCommandLine(const char* CmdLine) {}
 
+    // Benchmark mode: the camera path to follow when none is given on the command line
+    virtual void GetBenchmarkCameraPath(BenchmarkCameraPath& Path) const {}
+
+    // Benchmark mode: places the camera on the path, called before every Update
+    virtual void SetBenchmarkCamera(const float3& Pos, const float3& LookAt) {}
+
     InputController& GetInputController()
     {
         return m_InputController;
     }
 
+    FrameProfiler& GetProfiler()
+    {
+        return m_Profiler;
+    }
+
     void ResetSwapChain(ISwapChain* pNewSwapChain)
     {
         m_pSwapChain = pNewSwapChain;
@@ -100,6 +113,9 @@ protected:
     Uint32 m_CurrentFrameNumber = 0;
 
     InputController m_InputController;
+
+    // Frames are begun and ended by the sample app, samples only open their scopes
+    FrameProfiler m_Profiler;
 };
 
 inline void SampleBase::Update(double CurrTime, double ElapsedTime)
@@ -125,6 +141,9 @@ inline void SampleBase::Initialize(const SampleInitInfo& InitInfo)
     for (Uint32 ctx = 0; ctx < InitInfo.NumDeferredCtx; ++ctx)
         m_pDeferredContexts[ctx] = InitInfo.ppContexts[1 + ctx];
     m_pImGui = InitInfo.pImGui;
+
+    // One slot per back buffer plus the frame being recorded
+    m_Profiler.Initialize(m_pDevice, m_pSwapChain ? m_pSwapChain->GetDesc().BufferCount + 1 : 4);
 }
 
 extern SampleBase* CreateSample();
@@ -0,0 +1,440 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "DebugUtilities.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Nearest-rank percentile of sorted values
+double GetPercentile(const std::vector<double>& Sorted, double Percentile)
+{
+    const auto Rank = static_cast<size_t>(std::ceil(Percentile / 100.0 * static_cast<double>(Sorted.size())));
+    return Sorted[std::min(std::max(Rank, size_t{1}), Sorted.size()) - 1];
+}
+
+float3 CatmullRom(const float3& P0, const float3& P1, const float3& P2, const float3& P3, float t)
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return 0.5f * ((2.f * P1) +
+                   (P2 - P0) * t +
+                   (2.f * P0 - 5.f * P1 + 4.f * P2 - P3) * t2 +
+                   (3.f * P1 - P0 - 3.f * P2 + P3) * t3);
+}
+
+void WriteJsonString(std::ostream& Stream, const std::string& Str)
+{
+    Stream << '"';
+    for (char c : Str)
+    {
+        if (c == '"' || c == '\\')
+            Stream << '\\' << c;
+        else if (static_cast<unsigned char>(c) >= 0x20)
+            Stream << c;
+    }
+    Stream << '"';
+}
+
+// Reader of the flat objects of the "metrics" array, the only part of the report
+// the comparison needs
+class MetricsReader
+{
+public:
+    explicit MetricsReader(const std::string& Text) :
+        m_Text{Text}
+    {}
+
+    bool Read(std::vector<BenchmarkMetric>& Metrics)
+    {
+        m_Pos = m_Text.find("\"metrics\"");
+        if (m_Pos == std::string::npos)
+            return false;
+        m_Pos = m_Text.find('[', m_Pos);
+        if (m_Pos == std::string::npos)
+            return false;
+        ++m_Pos;
+
+        while (true)
+        {
+            SkipSpace();
+            if (Peek() == ']')
+                return true;
+            if (Peek() == ',')
+            {
+                ++m_Pos;
+                continue;
+            }
+            BenchmarkMetric Metric;
+            if (!ReadMetric(Metric))
+                return false;
+            Metrics.push_back(std::move(Metric));
+        }
+    }
+
+private:
+    char Peek() const { return m_Pos < m_Text.size() ? m_Text[m_Pos] : '\0'; }
+
+    void SkipSpace()
+    {
+        while (m_Pos < m_Text.size() && std::isspace(static_cast<unsigned char>(m_Text[m_Pos])))
+            ++m_Pos;
+    }
+
+    bool ReadString(std::string& Str)
+    {
+        SkipSpace();
+        if (Peek() != '"')
+            return false;
+        ++m_Pos;
+        Str.clear();
+        while (m_Pos < m_Text.size() && m_Text[m_Pos] != '"')
+        {
+            if (m_Text[m_Pos] == '\\' && m_Pos + 1 < m_Text.size())
+                ++m_Pos;
+            Str.push_back(m_Text[m_Pos++]);
+        }
+        if (Peek() != '"')
+            return false;
+        ++m_Pos;
+        return true;
+    }
+
+    bool ReadNumber(double& Value)
+    {
+        SkipSpace();
+        const char* pStart = m_Text.c_str() + m_Pos;
+        char*       pEnd   = nullptr;
+        Value              = std::strtod(pStart, &pEnd);
+        if (pEnd == pStart)
+            return false;
+        m_Pos += static_cast<size_t>(pEnd - pStart);
+        return true;
+    }
+
+    bool ReadMetric(BenchmarkMetric& Metric)
+    {
+        SkipSpace();
+        if (Peek() != '{')
+            return false;
+        ++m_Pos;
+        while (true)
+        {
+            SkipSpace();
+            if (Peek() == '}')
+            {
+                ++m_Pos;
+                return !Metric.Name.empty();
+            }
+            if (Peek() == ',')
+            {
+                ++m_Pos;
+                continue;
+            }
+
+            std::string Key;
+            if (!ReadString(Key))
+                return false;
+            SkipSpace();
+            if (Peek() != ':')
+                return false;
+            ++m_Pos;
+
+            if (Key == "name" || Key == "unit")
+            {
+                if (!ReadString(Key == "name" ? Metric.Name : Metric.Unit))
+                    return false;
+                continue;
+            }
+
+            double Value = 0;
+            if (!ReadNumber(Value))
+                return false;
+            // clang-format off
+            if      (Key == "samples") Metric.NumSamples = static_cast<Uint32>(Value);
+            else if (Key == "mean")    Metric.Mean = Value;
+            else if (Key == "min")     Metric.Min  = Value;
+            else if (Key == "p50")     Metric.P50  = Value;
+            else if (Key == "p95")     Metric.P95  = Value;
+            else if (Key == "p99")     Metric.P99  = Value;
+            else if (Key == "max")     Metric.Max  = Value;
+            // clang-format on
+        }
+    }
+
+    const std::string& m_Text;
+    size_t             m_Pos = 0;
+};
+
+} // namespace
+
+bool BenchmarkCameraPath::Load(const char* FilePath)
+{
+    std::ifstream File{FilePath};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open benchmark camera path '", FilePath, "'");
+        return false;
+    }
+
+    m_Keys.clear();
+    std::string Line;
+    for (int LineNum = 1; std::getline(File, Line); ++LineNum)
+    {
+        const auto First = Line.find_first_not_of(" \t\r");
+        if (First == std::string::npos || Line[First] == '#')
+            continue;
+
+        std::istringstream Stream{Line};
+        BenchmarkCameraKey Key;
+        if (!(Stream >> Key.Time >> Key.Pos.x >> Key.Pos.y >> Key.Pos.z >> Key.LookAt.x >> Key.LookAt.y >> Key.LookAt.z))
+        {
+            LOG_ERROR_MESSAGE("Invalid camera key at line ", LineNum, " of '", FilePath, "'. Expected: time pos.x pos.y pos.z lookat.x lookat.y lookat.z");
+            m_Keys.clear();
+            return false;
+        }
+        AddKey(Key);
+    }
+    return !m_Keys.empty();
+}
+
+void BenchmarkCameraPath::AddKey(const BenchmarkCameraKey& Key)
+{
+    auto it = std::upper_bound(m_Keys.begin(), m_Keys.end(), Key.Time,
+                               [](float Time, const BenchmarkCameraKey& Other) { return Time < Other.Time; });
+    m_Keys.insert(it, Key);
+}
+
+void BenchmarkCameraPath::Evaluate(float Time, float3& Pos, float3& LookAt) const
+{
+    VERIFY(!m_Keys.empty(), "The path has no keys");
+    if (Time <= m_Keys.front().Time || m_Keys.size() == 1)
+    {
+        Pos    = m_Keys.front().Pos;
+        LookAt = m_Keys.front().LookAt;
+        return;
+    }
+    if (Time >= m_Keys.back().Time)
+    {
+        Pos    = m_Keys.back().Pos;
+        LookAt = m_Keys.back().LookAt;
+        return;
+    }
+
+    size_t i = 0;
+    while (m_Keys[i + 1].Time <= Time)
+        ++i;
+
+    const auto& K0 = m_Keys[i > 0 ? i - 1 : 0];
+    const auto& K1 = m_Keys[i];
+    const auto& K2 = m_Keys[i + 1];
+    const auto& K3 = m_Keys[std::min(i + 2, m_Keys.size() - 1)];
+
+    const float t = (Time - K1.Time) / std::max(K2.Time - K1.Time, 1e-6f);
+    Pos           = CatmullRom(K0.Pos, K1.Pos, K2.Pos, K3.Pos, t);
+    LookAt        = CatmullRom(K0.LookAt, K1.LookAt, K2.LookAt, K3.LookAt, t);
+}
+
+void BenchmarkRecorder::AddSample(const std::string& Name, const char* Unit, double Value)
+{
+    auto& Samples = m_Samples[Name];
+    if (Samples.Values.empty())
+        Samples.Unit = Unit;
+    Samples.Values.push_back(Value);
+}
+
+std::vector<BenchmarkMetric> BenchmarkRecorder::Summarize() const
+{
+    std::vector<BenchmarkMetric> Metrics;
+    Metrics.reserve(m_Samples.size());
+
+    std::vector<double> Sorted;
+    for (const auto& it : m_Samples)
+    {
+        Sorted = it.second.Values;
+        if (Sorted.empty())
+            continue;
+        std::sort(Sorted.begin(), Sorted.end());
+
+        BenchmarkMetric Metric;
+        Metric.Name       = it.first;
+        Metric.Unit       = it.second.Unit;
+        Metric.NumSamples = static_cast<Uint32>(Sorted.size());
+        for (double Value : Sorted)
+            Metric.Mean += Value;
+        Metric.Mean /= static_cast<double>(Sorted.size());
+        Metric.Min = Sorted.front();
+        Metric.P50 = GetPercentile(Sorted, 50);
+        Metric.P95 = GetPercentile(Sorted, 95);
+        Metric.P99 = GetPercentile(Sorted, 99);
+        Metric.Max = Sorted.back();
+        Metrics.push_back(std::move(Metric));
+    }
+    return Metrics;
+}
+
+bool WriteBenchmarkReport(const char*                             FilePath,
+                          const BenchmarkRunInfo&                 Info,
+                          const std::vector<BenchmarkMetric>&     Metrics,
+                          const std::vector<BenchmarkRegression>* pRegressions)
+{
+    std::ofstream File{FilePath, std::ios::out | std::ios::trunc};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to create benchmark report '", FilePath, "'");
+        return false;
+    }
+
+    File.setf(std::ios::fixed);
+    File.precision(4);
+
+    File << "{\n  \"sample\": ";
+    WriteJsonString(File, Info.SampleName);
+    File << ",\n  \"device\": ";
+    WriteJsonString(File, Info.DeviceType);
+    File << ",\n  \"adapter\": ";
+    WriteJsonString(File, Info.Adapter);
+    File << ",\n  \"width\": " << Info.Width
+         << ",\n  \"height\": " << Info.Height
+         << ",\n  \"frames\": " << Info.Frames
+         << ",\n  \"warmup\": " << Info.Warmup
+         << ",\n  \"metrics\": [";
+
+    for (size_t i = 0; i < Metrics.size(); ++i)
+    {
+        const auto& Metric = Metrics[i];
+        File << (i > 0 ? ",\n" : "\n") << "    {\"name\": ";
+        WriteJsonString(File, Metric.Name);
+        File << ", \"unit\": ";
+        WriteJsonString(File, Metric.Unit);
+        File << ", \"samples\": " << Metric.NumSamples
+             << ", \"mean\": " << Metric.Mean
+             << ", \"min\": " << Metric.Min
+             << ", \"p50\": " << Metric.P50
+             << ", \"p95\": " << Metric.P95
+             << ", \"p99\": " << Metric.P99
+             << ", \"max\": " << Metric.Max << "}";
+    }
+    File << "\n  ]";
+
+    if (pRegressions != nullptr)
+    {
+        File << ",\n  \"regressions\": [";
+        for (size_t i = 0; i < pRegressions->size(); ++i)
+        {
+            const auto& Regression = (*pRegressions)[i];
+            File << (i > 0 ? ",\n" : "\n") << "    {\"name\": ";
+            WriteJsonString(File, Regression.Name);
+            File << ", \"unit\": ";
+            WriteJsonString(File, Regression.Unit);
+            File << ", \"baseline_p50\": " << Regression.BaselineP50
+                 << ", \"p50\": " << Regression.CurrentP50
+                 << ", \"baseline_p95\": " << Regression.BaselineP95
+                 << ", \"p95\": " << Regression.CurrentP95 << "}";
+        }
+        File << "\n  ]";
+    }
+    File << "\n}\n";
+
+    File.close();
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to write benchmark report '", FilePath, "'");
+        return false;
+    }
+    return true;
+}
+
+bool ReadBenchmarkReport(const char* FilePath, std::vector<BenchmarkMetric>& Metrics)
+{
+    std::ifstream File{FilePath};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open benchmark report '", FilePath, "'");
+        return false;
+    }
+
+    std::stringstream Text;
+    Text << File.rdbuf();
+
+    Metrics.clear();
+    if (!MetricsReader{Text.str()}.Read(Metrics))
+    {
+        LOG_ERROR_MESSAGE("'", FilePath, "' is not a valid benchmark report");
+        return false;
+    }
+    return true;
+}
+
+std::vector<BenchmarkRegression> CompareBenchmarkMetrics(const std::vector<BenchmarkMetric>& Baseline,
+                                                         const std::vector<BenchmarkMetric>& Current,
+                                                         double                              TolerancePercent,
+                                                         double                              MinTimeDeltaMs)
+{
+    std::vector<BenchmarkRegression> Regressions;
+
+    const double Scale = 1.0 + TolerancePercent / 100.0;
+    for (const auto& Base : Baseline)
+    {
+        auto it = std::find_if(Current.begin(), Current.end(), [&](const BenchmarkMetric& Metric) { return Metric.Name == Base.Name; });
+        if (it == Current.end() || it->Unit != Base.Unit)
+            continue;
+
+        const double MinDelta = Base.Unit == "ms" ? MinTimeDeltaMs : 0.0;
+
+        auto IsWorse = [&](double BaseValue, double CurrValue) {
+            return CurrValue > BaseValue * Scale && CurrValue - BaseValue > MinDelta;
+        };
+        if (IsWorse(Base.P50, it->P50) || IsWorse(Base.P95, it->P95))
+        {
+            BenchmarkRegression Regression;
+            Regression.Name        = Base.Name;
+            Regression.Unit        = Base.Unit;
+            Regression.BaselineP50 = Base.P50;
+            Regression.CurrentP50  = it->P50;
+            Regression.BaselineP95 = Base.P95;
+            Regression.CurrentP95  = it->P95;
+            Regressions.push_back(std::move(Regression));
+        }
+    }
+    return Regressions;
+}
+
+} // namespace Diligent
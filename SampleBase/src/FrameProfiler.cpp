@@ -0,0 +1,739 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+#include "DebugUtilities.hpp"
+#include "Errors.hpp"
+
+// Binary capture layout, all values little-endian:
+//
+//     Uint32 Magic ("DFP1"), Uint32 Version, Uint32 NumScopes, Uint32 NumThreads, Uint32 NumFrames, Uint32 Reserved
+//     NumScopes  x { Uint32 Color, Uint32 NameLength, char Name[NameLength] }
+//     NumThreads x { Uint32 NameLength, char Name[NameLength] }
+//     NumFrames  x { Uint64 FrameNumber, double Begin, double End, Uint32 NumCPUEvents, Uint32 NumGPUEvents,
+//                    ProfileEvent CPUEvents[NumCPUEvents], ProfileEvent GPUEvents[NumGPUEvents] }
+//
+// ProfileEvent is written as is: Uint32 ScopeId, Depth, ThreadIndex, Padding, double Begin, End.
+#define FRAME_PROFILER_CAPTURE_MAGIC   0x31504644u
+#define FRAME_PROFILER_CAPTURE_VERSION 1
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct ScopeRegistry
+{
+    std::mutex Mtx;
+
+    // Deque keeps the names in place so that GetScopeName can hand out pointers
+    std::deque<std::string>                         Names;
+    std::vector<Uint32>                             Colors;
+    std::unordered_map<std::string, ProfileScopeId> Ids;
+};
+
+ScopeRegistry& GetScopeRegistry()
+{
+    static ScopeRegistry Registry;
+    return Registry;
+}
+
+std::atomic<Uint64> g_NextProfilerInstanceId{1};
+
+void WriteJsonString(std::ostream& Stream, const char* Str)
+{
+    Stream << '"';
+    for (const char* c = Str; *c != '\0'; ++c)
+    {
+        switch (*c)
+        {
+            case '"': Stream << "\\\""; break;
+            case '\\': Stream << "\\\\"; break;
+            case '\n': Stream << "\\n"; break;
+            case '\t': Stream << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20)
+                    Stream << *c;
+        }
+    }
+    Stream << '"';
+}
+
+template <typename T>
+void WriteBinary(std::ostream& Stream, const T& Value)
+{
+    Stream.write(reinterpret_cast<const char*>(&Value), sizeof(Value));
+}
+
+void WriteBinaryString(std::ostream& Stream, const char* Str)
+{
+    const auto Length = static_cast<Uint32>(strlen(Str));
+    WriteBinary(Stream, Length);
+    Stream.write(Str, Length);
+}
+
+} // namespace
+
+struct FrameProfiler::ThreadData
+{
+    static constexpr Uint32 RingSize = 1u << 14;
+
+    struct OpenScope
+    {
+        ProfileScopeId Id;
+        double         Begin;
+    };
+
+    ThreadData(std::thread::id _ThreadId, Uint32 _Index) :
+        ThreadId{_ThreadId},
+        Index{_Index},
+        Name{"Thread " + std::to_string(_Index)},
+        Ring{new ProfileEvent[RingSize]}
+    {
+        Stack.reserve(64);
+    }
+
+    const std::thread::id ThreadId;
+    const Uint32          Index;
+
+    // Guarded by FrameProfiler::m_ThreadsMtx
+    std::string Name;
+
+    // Only touched by the owning thread
+    std::vector<OpenScope> Stack;
+
+    // Single producer (the owning thread), single consumer (FrameProfiler::EndFrame)
+    std::unique_ptr<ProfileEvent[]> Ring;
+    std::atomic<Uint32>             WritePos{0};
+    std::atomic<Uint32>             ReadPos{0};
+    std::atomic<Uint32>             Dropped{0};
+};
+
+struct FrameProfiler::GPUFrameSlot
+{
+    struct Scope
+    {
+        ProfileScopeId Id;
+        Uint32         Depth;
+        Uint32         BeginQuery;
+        Uint32         EndQuery;
+    };
+
+    // Grows up to 2 x MaxGPUScopesPerFrame queries and is reused from then on
+    std::vector<RefCntAutoPtr<IQuery>> Queries;
+    std::vector<Scope>                 Scopes;
+
+    Uint32 NumQueries   = 0;
+    Uint32 Depth        = 0;
+    Uint64 FrameNumber  = 0;
+    double CPUBeginTime = 0;
+    bool   bPending     = false;
+};
+
+struct FrameProfiler::CapturedFrame
+{
+    ProfileFrame CPU;
+    ProfileFrame GPU;
+    bool         bGPUPending = false;
+};
+
+FrameProfiler::FrameProfiler() :
+    m_StartTime{std::chrono::steady_clock::now()},
+    m_InstanceId{g_NextProfilerInstanceId.fetch_add(1)}
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+}
+
+void FrameProfiler::Initialize(IRenderDevice* pDevice, Uint32 NumFrameSlots, Uint32 MaxGPUScopesPerFrame)
+{
+    m_GPUFrames.clear();
+    m_CurrGPUFrame = 0;
+
+    if (pDevice == nullptr || !pDevice->GetDeviceCaps().Features.TimestampQueries)
+    {
+        LOG_INFO_MESSAGE("Timestamp queries are not supported by this device: GPU scopes will not be profiled");
+        return;
+    }
+
+    m_MaxGPUScopesPerFrame = std::max(MaxGPUScopesPerFrame, 1u);
+    m_GPUFrames.resize(std::max(NumFrameSlots, 2u));
+    for (size_t i = 0; i < m_GPUFrames.size(); ++i)
+    {
+        auto& Slot = m_GPUFrames[i];
+        Slot.Queries.resize(m_MaxGPUScopesPerFrame * 2);
+        Slot.Scopes.reserve(m_MaxGPUScopesPerFrame);
+    }
+
+    // Queries are created lazily: the device query heaps are not sized for the worst case
+    m_pDevice = pDevice;
+}
+
+bool FrameProfiler::IsGPUProfilingSupported() const
+{
+    return !m_GPUFrames.empty();
+}
+
+ProfileScopeId FrameProfiler::RegisterScope(const char* Name, Uint32 Color)
+{
+    auto& Registry = GetScopeRegistry();
+
+    std::lock_guard<std::mutex> Lock{Registry.Mtx};
+
+    auto it = Registry.Ids.find(Name);
+    if (it != Registry.Ids.end())
+        return it->second;
+
+    const auto Id = static_cast<ProfileScopeId>(Registry.Names.size());
+    Registry.Names.emplace_back(Name);
+    Registry.Colors.push_back(Color);
+    Registry.Ids.emplace(Registry.Names.back(), Id);
+    return Id;
+}
+
+const char* FrameProfiler::GetScopeName(ProfileScopeId Id)
+{
+    auto& Registry = GetScopeRegistry();
+
+    std::lock_guard<std::mutex> Lock{Registry.Mtx};
+    return Id < Registry.Names.size() ? Registry.Names[Id].c_str() : "<unknown>";
+}
+
+Uint32 FrameProfiler::GetScopeColor(ProfileScopeId Id)
+{
+    auto& Registry = GetScopeRegistry();
+
+    std::lock_guard<std::mutex> Lock{Registry.Mtx};
+    return Id < Registry.Colors.size() ? Registry.Colors[Id] : 0xFFFFFFFFu;
+}
+
+Uint32 FrameProfiler::GetNumScopes()
+{
+    auto& Registry = GetScopeRegistry();
+
+    std::lock_guard<std::mutex> Lock{Registry.Mtx};
+    return static_cast<Uint32>(Registry.Names.size());
+}
+
+FrameProfiler::ThreadData& FrameProfiler::GetThreadData()
+{
+    // The cache is keyed by the instance id rather than the address, a new profiler
+    // may be created where a destroyed one used to live
+    static thread_local Uint64      CachedInstanceId = 0;
+    static thread_local ThreadData* pCachedData      = nullptr;
+    if (CachedInstanceId == m_InstanceId)
+        return *pCachedData;
+
+    const auto ThreadId = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+
+    ThreadData* pData = nullptr;
+    for (auto& pThread : m_Threads)
+    {
+        if (pThread->ThreadId == ThreadId)
+        {
+            pData = pThread.get();
+            break;
+        }
+    }
+    if (pData == nullptr)
+    {
+        m_Threads.emplace_back(new ThreadData{ThreadId, static_cast<Uint32>(m_Threads.size())});
+        pData = m_Threads.back().get();
+    }
+
+    CachedInstanceId = m_InstanceId;
+    pCachedData      = pData;
+    return *pData;
+}
+
+void FrameProfiler::SetThreadName(const char* Name)
+{
+    auto& Data = GetThreadData();
+
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+    Data.Name = Name;
+}
+
+const char* FrameProfiler::GetThreadName(Uint32 ThreadIndex) const
+{
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+    return ThreadIndex < m_Threads.size() ? m_Threads[ThreadIndex]->Name.c_str() : "<unknown>";
+}
+
+Uint32 FrameProfiler::GetNumThreads() const
+{
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+    return static_cast<Uint32>(m_Threads.size());
+}
+
+double FrameProfiler::GetTime() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+}
+
+void FrameProfiler::BeginCPUScope(ProfileScopeId Id)
+{
+    auto& Data = GetThreadData();
+    Data.Stack.push_back({Id, GetTime()});
+}
+
+void FrameProfiler::EndCPUScope()
+{
+    const double EndTime = GetTime();
+
+    auto& Data = GetThreadData();
+    VERIFY(!Data.Stack.empty(), "EndCPUScope() is called without a matching BeginCPUScope()");
+    if (Data.Stack.empty())
+        return;
+
+    ProfileEvent Event;
+    Event.ScopeId     = Data.Stack.back().Id;
+    Event.Begin       = Data.Stack.back().Begin;
+    Event.End         = EndTime;
+    Event.ThreadIndex = Data.Index;
+    Data.Stack.pop_back();
+    Event.Depth = static_cast<Uint32>(Data.Stack.size());
+
+    const Uint32 WritePos = Data.WritePos.load(std::memory_order_relaxed);
+    if (WritePos - Data.ReadPos.load(std::memory_order_acquire) >= ThreadData::RingSize)
+    {
+        // The ring is only full when EndFrame is not called, never block the thread
+        Data.Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Data.Ring[WritePos & (ThreadData::RingSize - 1)] = Event;
+    Data.WritePos.store(WritePos + 1, std::memory_order_release);
+}
+
+void FrameProfiler::DrainThreads(ProfileFrame& Frame)
+{
+    Frame.Events.clear();
+    {
+        std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+        for (auto& pThread : m_Threads)
+        {
+            auto&        Data     = *pThread;
+            Uint32       ReadPos  = Data.ReadPos.load(std::memory_order_relaxed);
+            const Uint32 WritePos = Data.WritePos.load(std::memory_order_acquire);
+            for (; ReadPos != WritePos; ++ReadPos)
+                Frame.Events.push_back(Data.Ring[ReadPos & (ThreadData::RingSize - 1)]);
+            Data.ReadPos.store(WritePos, std::memory_order_release);
+
+            m_Stats.DroppedCPUEvents += Data.Dropped.exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Scopes are pushed when they close, children before their parents
+    std::sort(Frame.Events.begin(), Frame.Events.end(), [](const ProfileEvent& lhs, const ProfileEvent& rhs) {
+        if (lhs.ThreadIndex != rhs.ThreadIndex)
+            return lhs.ThreadIndex < rhs.ThreadIndex;
+        if (lhs.Begin != rhs.Begin)
+            return lhs.Begin < rhs.Begin;
+        return lhs.Depth < rhs.Depth;
+    });
+}
+
+Uint32 FrameProfiler::BeginGPUScope(IDeviceContext* pContext, ProfileScopeId Id)
+{
+    if (m_GPUFrames.empty() || !m_bInFrame || pContext == nullptr)
+        return ~Uint32{0};
+
+    auto& Slot = m_GPUFrames[m_CurrGPUFrame];
+    if (Slot.Scopes.size() >= m_MaxGPUScopesPerFrame)
+    {
+        ++m_Stats.DroppedGPUScopes;
+        return ~Uint32{0};
+    }
+
+    const Uint32 BeginQuery = AcquireQuery(Slot);
+    if (BeginQuery == ~Uint32{0})
+    {
+        ++m_Stats.DroppedGPUScopes;
+        return ~Uint32{0};
+    }
+    pContext->EndQuery(Slot.Queries[BeginQuery]);
+
+    Slot.Scopes.push_back({Id, Slot.Depth++, BeginQuery, ~Uint32{0}});
+    return static_cast<Uint32>(Slot.Scopes.size() - 1);
+}
+
+void FrameProfiler::EndGPUScope(IDeviceContext* pContext, Uint32 Handle)
+{
+    if (Handle == ~Uint32{0} || m_GPUFrames.empty() || !m_bInFrame || pContext == nullptr)
+        return;
+
+    auto& Slot = m_GPUFrames[m_CurrGPUFrame];
+    VERIFY_EXPR(Handle < Slot.Scopes.size() && Slot.Depth > 0);
+    --Slot.Depth;
+
+    // A scope without the end timestamp is skipped when the frame is resolved
+    const Uint32 EndQuery = AcquireQuery(Slot);
+    if (EndQuery == ~Uint32{0})
+        return;
+    pContext->EndQuery(Slot.Queries[EndQuery]);
+    Slot.Scopes[Handle].EndQuery = EndQuery;
+}
+
+Uint32 FrameProfiler::AcquireQuery(GPUFrameSlot& Slot)
+{
+    if (Slot.NumQueries >= Slot.Queries.size())
+        return ~Uint32{0};
+
+    auto& pQuery = Slot.Queries[Slot.NumQueries];
+    if (!pQuery)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Frame profiler timestamp";
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        m_pDevice->CreateQuery(Desc, &pQuery);
+        if (!pQuery)
+        {
+            // The query heap is exhausted, stop growing the pool of this slot
+            Slot.Queries.resize(Slot.NumQueries);
+            return ~Uint32{0};
+        }
+    }
+    return Slot.NumQueries++;
+}
+
+void FrameProfiler::ResolveGPUFrames()
+{
+    const auto NumSlots = static_cast<Uint32>(m_GPUFrames.size());
+
+    // Slots are filled in order, the current one is reused next and holds the oldest frame
+    for (Uint32 i = 0; i < NumSlots; ++i)
+    {
+        auto& Slot = m_GPUFrames[(m_CurrGPUFrame + i) % NumSlots];
+        if (!Slot.bPending)
+            continue;
+
+        m_Timestamps.resize(Slot.NumQueries);
+
+        // Poll without invalidating first: the frame is either resolved as a whole or kept
+        bool   bReady    = true;
+        Uint64 Frequency = 0;
+        for (Uint32 q = 0; q < Slot.NumQueries && bReady; ++q)
+        {
+            QueryDataTimestamp Data;
+            bReady          = Slot.Queries[q]->GetData(&Data, sizeof(Data), false);
+            m_Timestamps[q] = Data.Counter;
+            Frequency       = Data.Frequency;
+        }
+        if (!bReady)
+        {
+            // Later frames cannot have finished before this one
+            break;
+        }
+        for (Uint32 q = 0; q < Slot.NumQueries; ++q)
+        {
+            QueryDataTimestamp Data;
+            Slot.Queries[q]->GetData(&Data, sizeof(Data), true);
+        }
+        Slot.bPending = false;
+
+        auto& Frame = m_LastGPUFrame;
+        Frame.FrameNumber = Slot.FrameNumber;
+        Frame.Events.clear();
+
+        // The first timestamp of the frame is aligned with its CPU begin time
+        const Uint64 BaseCounter = Slot.NumQueries > 0 ? *std::min_element(m_Timestamps.begin(), m_Timestamps.end()) : 0;
+        const double TickPeriod  = Frequency > 0 ? 1.0 / static_cast<double>(Frequency) : 0.0;
+
+        Frame.Begin = Slot.CPUBeginTime;
+        Frame.End   = Slot.CPUBeginTime;
+        for (const auto& Scope : Slot.Scopes)
+        {
+            if (Scope.EndQuery == ~Uint32{0})
+                continue;
+
+            ProfileEvent Event;
+            Event.ScopeId = Scope.Id;
+            Event.Depth   = Scope.Depth;
+            Event.Begin   = Slot.CPUBeginTime + static_cast<double>(m_Timestamps[Scope.BeginQuery] - BaseCounter) * TickPeriod;
+            Event.End     = Slot.CPUBeginTime + static_cast<double>(m_Timestamps[Scope.EndQuery] - BaseCounter) * TickPeriod;
+            Frame.End     = std::max(Frame.End, Event.End);
+            Frame.Events.push_back(Event);
+        }
+
+        m_Stats.GPULatency = static_cast<Uint32>(m_FrameNumber - Slot.FrameNumber);
+
+        for (auto it = m_Capture.rbegin(); it != m_Capture.rend(); ++it)
+        {
+            if (it->CPU.FrameNumber == Slot.FrameNumber)
+            {
+                it->GPU         = Frame;
+                it->bGPUPending = false;
+                break;
+            }
+        }
+    }
+}
+
+void FrameProfiler::DropGPUFrame(GPUFrameSlot& Slot)
+{
+    // Timestamp queries need no Begin, the pending results are simply overwritten
+    Slot.bPending = false;
+    ++m_Stats.DroppedGPUFrames;
+
+    for (auto it = m_Capture.rbegin(); it != m_Capture.rend(); ++it)
+    {
+        if (it->CPU.FrameNumber == Slot.FrameNumber)
+        {
+            it->bGPUPending = false;
+            break;
+        }
+    }
+}
+
+void FrameProfiler::BeginFrame(IDeviceContext* pContext)
+{
+    VERIFY(!m_bInFrame, "BeginFrame() is called twice without EndFrame()");
+
+    static const ProfileScopeId FrameScopeId    = RegisterScope("Frame", 0xFF808080u);
+    static const ProfileScopeId GPUFrameScopeId = RegisterScope("GPU Frame", 0xFF808080u);
+
+    m_FrameBeginTime = GetTime();
+    m_bInFrame       = true;
+
+    if (!m_GPUFrames.empty())
+    {
+        ResolveGPUFrames();
+
+        auto& Slot = m_GPUFrames[m_CurrGPUFrame];
+        if (Slot.bPending)
+        {
+            // Never wait for the GPU, the frame is lost instead
+            DropGPUFrame(Slot);
+        }
+        Slot.Scopes.clear();
+        Slot.NumQueries   = 0;
+        Slot.Depth        = 0;
+        Slot.FrameNumber  = m_FrameNumber;
+        Slot.CPUBeginTime = m_FrameBeginTime;
+
+        m_GPUFrameScopeHandle = BeginGPUScope(pContext, GPUFrameScopeId);
+    }
+
+    BeginCPUScope(FrameScopeId);
+}
+
+void FrameProfiler::EndFrame(IDeviceContext* pContext)
+{
+    VERIFY(m_bInFrame, "EndFrame() is called without BeginFrame()");
+
+    EndCPUScope();
+
+    bool bGPUPending = false;
+    if (!m_GPUFrames.empty())
+    {
+        EndGPUScope(pContext, m_GPUFrameScopeHandle);
+        m_GPUFrameScopeHandle = ~Uint32{0};
+
+        auto& Slot    = m_GPUFrames[m_CurrGPUFrame];
+        Slot.bPending = Slot.NumQueries > 0;
+        bGPUPending   = Slot.bPending;
+    }
+    m_bInFrame = false;
+
+    m_LastCPUFrame.FrameNumber = m_FrameNumber;
+    m_LastCPUFrame.Begin       = m_FrameBeginTime;
+    m_LastCPUFrame.End         = GetTime();
+    DrainThreads(m_LastCPUFrame);
+
+    if (m_bCapturing)
+    {
+        m_Capture.emplace_back();
+        m_Capture.back().CPU         = m_LastCPUFrame;
+        m_Capture.back().bGPUPending = bGPUPending;
+        if (m_Capture.size() >= m_MaxCaptureFrames)
+            StopCapture();
+    }
+
+    if (!m_GPUFrames.empty())
+    {
+        // Move to the next slot first so that the frame just ended is not the oldest one
+        m_CurrGPUFrame = (m_CurrGPUFrame + 1) % static_cast<Uint32>(m_GPUFrames.size());
+        ResolveGPUFrames();
+    }
+
+    ++m_FrameNumber;
+}
+
+void FrameProfiler::StartCapture(Uint32 MaxFrames)
+{
+    m_bCapturing       = MaxFrames > 0;
+    m_MaxCaptureFrames = static_cast<Uint32>(m_Capture.size()) + MaxFrames;
+    if (m_MaxCaptureFrames < MaxFrames)
+        m_MaxCaptureFrames = ~Uint32{0};
+}
+
+void FrameProfiler::StopCapture()
+{
+    m_bCapturing = false;
+}
+
+void FrameProfiler::ClearCapture()
+{
+    m_Capture.clear();
+}
+
+Uint32 FrameProfiler::GetNumCapturedFrames() const
+{
+    return static_cast<Uint32>(m_Capture.size());
+}
+
+bool FrameProfiler::IsCaptureResolved() const
+{
+    if (m_bCapturing)
+        return false;
+
+    for (const auto& Frame : m_Capture)
+    {
+        if (Frame.bGPUPending)
+            return false;
+    }
+    return true;
+}
+
+bool FrameProfiler::ExportChromeTrace(const char* FilePath) const
+{
+    std::ofstream File{FilePath, std::ios::out | std::ios::trunc};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to create profiler trace file '", FilePath, "'");
+        return false;
+    }
+
+    // Trace event timestamps are in microseconds
+    File.setf(std::ios::fixed);
+    File.precision(3);
+
+    File << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    File << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    File << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}},\n";
+    File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Immediate context\"}}";
+
+    const Uint32 NumThreads = GetNumThreads();
+    for (Uint32 t = 0; t < NumThreads; ++t)
+    {
+        File << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":";
+        WriteJsonString(File, GetThreadName(t));
+        File << "}}";
+    }
+
+    auto WriteEvents = [&](const ProfileFrame& Frame, int Pid) {
+        for (const auto& Event : Frame.Events)
+        {
+            File << ",\n{\"name\":";
+            WriteJsonString(File, GetScopeName(Event.ScopeId));
+            File << ",\"cat\":\"" << (Pid == 0 ? "cpu" : "gpu") << "\",\"ph\":\"X\",\"pid\":" << Pid
+                 << ",\"tid\":" << Event.ThreadIndex
+                 << ",\"ts\":" << Event.Begin * 1e+6
+                 << ",\"dur\":" << (Event.End - Event.Begin) * 1e+6
+                 << ",\"args\":{\"frame\":" << Frame.FrameNumber << ",\"depth\":" << Event.Depth << "}}";
+        }
+    };
+    for (const auto& Frame : m_Capture)
+    {
+        WriteEvents(Frame.CPU, 0);
+        WriteEvents(Frame.GPU, 1);
+    }
+
+    File << "\n]}\n";
+    File.close();
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to write profiler trace file '", FilePath, "'");
+        return false;
+    }
+    return true;
+}
+
+bool FrameProfiler::ExportBinary(const char* FilePath) const
+{
+    std::ofstream File{FilePath, std::ios::out | std::ios::binary | std::ios::trunc};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to create profiler capture file '", FilePath, "'");
+        return false;
+    }
+
+    const Uint32 NumScopes  = GetNumScopes();
+    const Uint32 NumThreads = GetNumThreads();
+
+    WriteBinary(File, Uint32{FRAME_PROFILER_CAPTURE_MAGIC});
+    WriteBinary(File, Uint32{FRAME_PROFILER_CAPTURE_VERSION});
+    WriteBinary(File, NumScopes);
+    WriteBinary(File, NumThreads);
+    WriteBinary(File, static_cast<Uint32>(m_Capture.size()));
+    WriteBinary(File, Uint32{0});
+
+    for (Uint32 s = 0; s < NumScopes; ++s)
+    {
+        WriteBinary(File, GetScopeColor(s));
+        WriteBinaryString(File, GetScopeName(s));
+    }
+    for (Uint32 t = 0; t < NumThreads; ++t)
+        WriteBinaryString(File, GetThreadName(t));
+
+    static_assert(sizeof(ProfileEvent) == 32, "ProfileEvent is written as is, update the capture version when it changes");
+    for (const auto& Frame : m_Capture)
+    {
+        WriteBinary(File, Frame.CPU.FrameNumber);
+        WriteBinary(File, Frame.CPU.Begin);
+        WriteBinary(File, Frame.CPU.End);
+        WriteBinary(File, static_cast<Uint32>(Frame.CPU.Events.size()));
+        WriteBinary(File, static_cast<Uint32>(Frame.GPU.Events.size()));
+        if (!Frame.CPU.Events.empty())
+            File.write(reinterpret_cast<const char*>(Frame.CPU.Events.data()), Frame.CPU.Events.size() * sizeof(ProfileEvent));
+        if (!Frame.GPU.Events.empty())
+            File.write(reinterpret_cast<const char*>(Frame.GPU.Events.data()), Frame.GPU.Events.size() * sizeof(ProfileEvent));
+    }
+
+    File.close();
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to write profiler capture file '", FilePath, "'");
+        return false;
+    }
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,417 @@
+/*
+ *  Copyright 2019-2021 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Triangles referencing every vertex, built per triangle corner so that
+// degenerate triangles keep consistent counts
+struct VertexAdjacency
+{
+    std::vector<Uint32> Offsets;
+    std::vector<Uint32> Counts;
+    std::vector<Uint32> Triangles;
+
+    VertexAdjacency(const Uint32* pIndices, Uint32 NumIndices, Uint32 NumVertices) :
+        Offsets(NumVertices + 1, 0),
+        Counts(NumVertices, 0),
+        Triangles(NumIndices)
+    {
+        for (Uint32 i = 0; i < NumIndices; ++i)
+        {
+            VERIFY(pIndices[i] < NumVertices, "Index ", pIndices[i], " is out of range");
+            ++Counts[pIndices[i]];
+        }
+
+        for (Uint32 v = 0; v < NumVertices; ++v)
+            Offsets[v + 1] = Offsets[v] + Counts[v];
+
+        std::vector<Uint32> Cursor(Offsets.begin(), Offsets.end() - 1);
+        for (Uint32 i = 0; i < NumIndices; ++i)
+            Triangles[Cursor[pIndices[i]]++] = i / 3;
+    }
+};
+
+// Values from the original paper
+constexpr Uint32 ForsythCacheSize         = 32;
+constexpr float  ForsythCacheDecayPower   = 1.5f;
+constexpr float  ForsythLastTriScore      = 0.75f;
+constexpr float  ForsythValenceBoostScale = 2.0f;
+constexpr float  ForsythValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(int CachePos, Uint32 NumActiveTris)
+{
+    if (NumActiveTris == 0)
+    {
+        // No triangles left, the vertex never contributes again
+        return -1.f;
+    }
+
+    float Score = 0.f;
+    if (CachePos >= 0)
+    {
+        if (CachePos < 3)
+        {
+            // The vertices of the last triangle get a fixed score so that the next
+            // triangle does not just reuse the same edge and produce long thin strips
+            Score = ForsythLastTriScore;
+        }
+        else
+        {
+            const float Scaler = 1.f / static_cast<float>(ForsythCacheSize - 3);
+            Score              = std::pow(1.f - static_cast<float>(CachePos - 3) * Scaler, ForsythCacheDecayPower);
+        }
+    }
+
+    // Boost vertices with few triangles left so that lone triangles get cleaned up early
+    Score += ForsythValenceBoostScale * std::pow(static_cast<float>(NumActiveTris), -ForsythValenceBoostPower);
+    return Score;
+}
+
+} // namespace
+
+VertexCacheStats SimulateVertexCache(const Uint32*     pIndices,
+                                     Uint32            NumIndices,
+                                     Uint32            NumVertices,
+                                     Uint32            CacheSize,
+                                     VERTEX_CACHE_TYPE CacheType)
+{
+    VERIFY_EXPR(NumIndices % 3 == 0 && CacheSize > 0);
+
+    VertexCacheStats Stats;
+    Stats.NumTriangles = NumIndices / 3;
+
+    std::vector<bool> Referenced(NumVertices, false);
+
+    // Front of the cache is the most recent entry
+    std::vector<Uint32> Cache;
+    Cache.reserve(CacheSize + 1);
+    for (Uint32 i = 0; i < NumIndices; ++i)
+    {
+        const Uint32 Index = pIndices[i];
+        if (!Referenced[Index])
+        {
+            Referenced[Index] = true;
+            ++Stats.NumVertices;
+        }
+
+        auto It = std::find(Cache.begin(), Cache.end(), Index);
+        if (It != Cache.end())
+        {
+            if (CacheType == VERTEX_CACHE_TYPE_LRU)
+            {
+                Cache.erase(It);
+                Cache.insert(Cache.begin(), Index);
+            }
+            continue;
+        }
+
+        ++Stats.NumCacheMisses;
+        Cache.insert(Cache.begin(), Index);
+        if (Cache.size() > CacheSize)
+            Cache.pop_back();
+    }
+
+    if (Stats.NumTriangles > 0)
+        Stats.ACMR = static_cast<float>(Stats.NumCacheMisses) / static_cast<float>(Stats.NumTriangles);
+    if (Stats.NumVertices > 0)
+        Stats.ATVR = static_cast<float>(Stats.NumCacheMisses) / static_cast<float>(Stats.NumVertices);
+
+    return Stats;
+}
+
+void OptimizeVertexCacheForsyth(const Uint32* pIndices,
+                                Uint32        NumIndices,
+                                Uint32        NumVertices,
+                                Uint32*       pDstIndices)
+{
+    VERIFY_EXPR(NumIndices % 3 == 0 && pIndices != pDstIndices);
+
+    const Uint32 NumTriangles = NumIndices / 3;
+    if (NumTriangles == 0)
+        return;
+
+    VertexAdjacency Adjacency(pIndices, NumIndices, NumVertices);
+
+    // Active triangles of every vertex are kept at the front of its adjacency range
+    std::vector<Uint32>& NumActiveTris = Adjacency.Counts;
+    std::vector<int>     CachePos(NumVertices, -1);
+    std::vector<float>   VertexScore(NumVertices);
+    for (Uint32 v = 0; v < NumVertices; ++v)
+        VertexScore[v] = ForsythVertexScore(-1, NumActiveTris[v]);
+
+    std::vector<float> TriangleScore(NumTriangles);
+    std::vector<bool>  Emitted(NumTriangles, false);
+    for (Uint32 t = 0; t < NumTriangles; ++t)
+    {
+        const Uint32* Tri = pIndices + t * 3;
+        TriangleScore[t]  = VertexScore[Tri[0]] + VertexScore[Tri[1]] + VertexScore[Tri[2]];
+    }
+
+    // Three extra slots hold the vertices pushed out by the last triangle
+    std::vector<Uint32> Cache, NewCache;
+    Cache.reserve(ForsythCacheSize + 3);
+    NewCache.reserve(ForsythCacheSize + 3);
+
+    Uint32 BestTriangle = ~0u;
+    Uint32 ScanCursor   = 0;
+    for (Uint32 NumOutTris = 0; NumOutTris < NumTriangles; ++NumOutTris)
+    {
+        if (BestTriangle == ~0u)
+        {
+            // Nothing in the cache has triangles left, take the best remaining one.
+            // Triangles before the cursor are all emitted.
+            while (Emitted[ScanCursor])
+                ++ScanCursor;
+
+            float BestScore = -1.f;
+            for (Uint32 t = ScanCursor; t < NumTriangles; ++t)
+            {
+                if (!Emitted[t] && TriangleScore[t] > BestScore)
+                {
+                    BestScore    = TriangleScore[t];
+                    BestTriangle = t;
+                }
+            }
+        }
+
+        const Uint32* Tri = pIndices + BestTriangle * 3;
+        std::copy(Tri, Tri + 3, pDstIndices + NumOutTris * 3);
+        Emitted[BestTriangle] = true;
+
+        for (Uint32 c = 0; c < 3; ++c)
+        {
+            const Uint32 v     = Tri[c];
+            Uint32*      pTris = Adjacency.Triangles.data() + Adjacency.Offsets[v];
+            Uint32*      pEnd  = pTris + NumActiveTris[v];
+            Uint32*      pTri  = std::find(pTris, pEnd, BestTriangle);
+            VERIFY_EXPR(pTri != pEnd);
+            std::swap(*pTri, *(pEnd - 1));
+            --NumActiveTris[v];
+        }
+
+        // The triangle moves to the front, the rest of the cache keeps its order
+        NewCache.clear();
+        for (Uint32 c = 0; c < 3; ++c)
+        {
+            if (std::find(NewCache.begin(), NewCache.end(), Tri[c]) == NewCache.end())
+                NewCache.push_back(Tri[c]);
+        }
+        for (Uint32 v : Cache)
+        {
+            if (v != Tri[0] && v != Tri[1] && v != Tri[2])
+                NewCache.push_back(v);
+        }
+
+        for (size_t i = 0; i < NewCache.size(); ++i)
+        {
+            const Uint32 v = NewCache[i];
+            CachePos[v]    = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+            VertexScore[v] = ForsythVertexScore(CachePos[v], NumActiveTris[v]);
+        }
+
+        // Only triangles touching the cache changed their score
+        BestTriangle    = ~0u;
+        float BestScore = -1.f;
+        for (Uint32 v : NewCache)
+        {
+            const Uint32* pTris = Adjacency.Triangles.data() + Adjacency.Offsets[v];
+            for (Uint32 i = 0; i < NumActiveTris[v]; ++i)
+            {
+                const Uint32  t    = pTris[i];
+                const Uint32* pTri = pIndices + t * 3;
+                TriangleScore[t]   = VertexScore[pTri[0]] + VertexScore[pTri[1]] + VertexScore[pTri[2]];
+                if (TriangleScore[t] > BestScore)
+                {
+                    BestScore    = TriangleScore[t];
+                    BestTriangle = t;
+                }
+            }
+        }
+
+        if (NewCache.size() > ForsythCacheSize)
+            NewCache.resize(ForsythCacheSize);
+        Cache.swap(NewCache);
+    }
+}
+
+void OptimizeVertexCacheTipsify(const Uint32* pIndices,
+                                Uint32        NumIndices,
+                                Uint32        NumVertices,
+                                Uint32        CacheSize,
+                                Uint32*       pDstIndices)
+{
+    VERIFY_EXPR(NumIndices % 3 == 0 && pIndices != pDstIndices);
+
+    const Uint32 NumTriangles = NumIndices / 3;
+    if (NumTriangles == 0)
+        return;
+
+    VertexAdjacency Adjacency(pIndices, NumIndices, NumVertices);
+
+    std::vector<Uint32>& LiveTris = Adjacency.Counts;
+    std::vector<Uint32>  CacheTime(NumVertices, 0);
+    std::vector<bool>    Emitted(NumTriangles, false);
+    std::vector<Uint32>  DeadEnd;
+    std::vector<Uint32>  Candidates;
+    DeadEnd.reserve(NumIndices);
+
+    Uint32 TimeStamp   = CacheSize + 1;
+    Uint32 InputCursor = 0;
+    Uint32 NumOutTris  = 0;
+
+    // Fan around every vertex in turn, the next fanning vertex is picked among the
+    // vertices of the fan that will still be in the cache when their triangles are emitted
+    Uint32 Fanning = 0;
+    while (Fanning != ~0u)
+    {
+        Candidates.clear();
+
+        const Uint32* pTris = Adjacency.Triangles.data() + Adjacency.Offsets[Fanning];
+        const Uint32* pEnd  = Adjacency.Triangles.data() + Adjacency.Offsets[Fanning + 1];
+        for (; pTris != pEnd; ++pTris)
+        {
+            const Uint32 t = *pTris;
+            if (Emitted[t])
+                continue;
+
+            const Uint32* Tri = pIndices + t * 3;
+            for (Uint32 c = 0; c < 3; ++c)
+            {
+                const Uint32 v = Tri[c];
+
+                pDstIndices[NumOutTris * 3 + c] = v;
+                DeadEnd.push_back(v);
+                Candidates.push_back(v);
+                --LiveTris[v];
+                if (TimeStamp - CacheTime[v] > CacheSize)
+                    CacheTime[v] = TimeStamp++;
+            }
+            Emitted[t] = true;
+            ++NumOutTris;
+        }
+
+        Fanning       = ~0u;
+        int BestPrior = -1;
+        for (Uint32 v : Candidates)
+        {
+            if (LiveTris[v] == 0)
+                continue;
+
+            // Vertices that will still be cached after their remaining triangles are emitted
+            // are preferred, the oldest of them first
+            int Priority = 0;
+            if (TimeStamp - CacheTime[v] + 2 * LiveTris[v] <= CacheSize)
+                Priority = static_cast<int>(TimeStamp - CacheTime[v]);
+            if (Priority > BestPrior)
+            {
+                BestPrior = Priority;
+                Fanning   = v;
+            }
+        }
+
+        if (Fanning == ~0u)
+        {
+            // Dead end: back track through the recently emitted vertices, then
+            // continue with the next vertex in the input order
+            while (!DeadEnd.empty())
+            {
+                const Uint32 v = DeadEnd.back();
+                DeadEnd.pop_back();
+                if (LiveTris[v] > 0)
+                {
+                    Fanning = v;
+                    break;
+                }
+            }
+
+            while (Fanning == ~0u && InputCursor < NumVertices)
+            {
+                if (LiveTris[InputCursor] > 0)
+                    Fanning = InputCursor;
+                ++InputCursor;
+            }
+        }
+    }
+    VERIFY_EXPR(NumOutTris == NumTriangles);
+}
+
+Uint32 OptimizeVertexFetch(Uint32*              pIndices,
+                           Uint32               NumIndices,
+                           Uint32               NumVertices,
+                           std::vector<Uint32>& Remap)
+{
+    Remap.assign(NumVertices, ~0u);
+
+    Uint32 NumRemapped = 0;
+    for (Uint32 i = 0; i < NumIndices; ++i)
+    {
+        Uint32& Index = pIndices[i];
+        VERIFY(Index < NumVertices, "Index ", Index, " is out of range");
+        if (Remap[Index] == ~0u)
+            Remap[Index] = NumRemapped++;
+        Index = Remap[Index];
+    }
+    return NumRemapped;
+}
+
+void ConvertTriangleStripToList(const Uint32* pStripIndices, Uint32 NumStripIndices, std::vector<Uint32>& ListIndices)
+{
+    ListIndices.clear();
+    if (NumStripIndices < 3)
+        return;
+
+    ListIndices.reserve((NumStripIndices - 2) * 3);
+    for (Uint32 i = 2; i < NumStripIndices; ++i)
+    {
+        Uint32 i0 = pStripIndices[i - 2];
+        Uint32 i1 = pStripIndices[i - 1];
+        Uint32 i2 = pStripIndices[i];
+        if (i0 == i1 || i1 == i2 || i0 == i2)
+            continue;
+
+        // Every odd triangle of a strip has flipped winding
+        if (i & 0x01)
+            std::swap(i0, i1);
+
+        ListIndices.push_back(i0);
+        ListIndices.push_back(i1);
+        ListIndices.push_back(i2);
+    }
+}
+
+} // namespace Diligent
@@ -29,6 +29,8 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
+#include <map>
 
 #include "PlatformDefinitions.h"
 #include "SampleApp.hpp"
@@ -65,6 +67,16 @@
 namespace Diligent
 {
 
+namespace
+{
+
+// Process exit codes stay in 0..255, the regression count saturates below the error codes
+constexpr int BenchmarkMaxRegressionExitCode = 100;
+constexpr int BenchmarkBaselineErrorExitCode = 101;
+constexpr int BenchmarkReportErrorExitCode   = 102;
+
+} // namespace
+
 SampleApp::SampleApp() :
     m_TheSample{CreateSample()},
     m_AppTitle{m_TheSample->GetSampleName()}
@@ -454,8 +466,15 @@ void SampleApp::InitializeSample()
     InitInfo.NumDeferredCtx = NumDeferredCtx;
     InitInfo.pSwapChain     = m_pSwapChain;
     InitInfo.pImGui         = m_pImGui.get();
+    m_TheSample->GetProfiler().SetThreadName("Main");
     m_TheSample->Initialize(InitInfo);
 
+    if (m_ProfileCaptureInfo.FramesToCapture > 0)
+        m_TheSample->GetProfiler().StartCapture(m_ProfileCaptureInfo.FramesToCapture);
+
+    if (m_BenchmarkInfo.MeasuredFrames > 0)
+        InitializeBenchmark();
+
     m_TheSample->WindowResize(SCDesc.Width, SCDesc.Height);
 }
 
@@ -587,6 +606,20 @@ std::string GetArgument(const char*& pos, const char* ArgName)
 //
 //     -mode d3d11 -adapters_dialog 0 -capture_path . -capture_fps 15 -capture_name frame -width 640 -height 480 -capture_format jpg -capture_quality 100 -capture_frames 3 -capture_alpha 0
 //
+// Command line example to benchmark a sample on a software Vulkan device and compare the results with a baseline:
+//
+//     -mode vk -adapter sw -benchmark 600 -benchmark_output benchmark.json -benchmark_baseline baseline.json -benchmark_tolerance 10
+//
+// The exit code is the number of regressed metrics, capped at 100. It is 101 if the baseline can not be read
+// and 102 if the report can not be written. -benchmark_camera loads a camera path with one
+// "time pos.x pos.y pos.z lookat.x lookat.y lookat.z" key per line instead of the path of the sample.
+//
+// Command line example to profile frames:
+//
+//     -profile_frames 120 -profile_path profile
+//
+// writes profile.json (open in chrome://tracing or Perfetto) and the binary capture profile.dfpc
+//
 // Image magick command to create animated gif:
 //
 //     magick convert  -delay 6  -loop 0 -layers Optimize -compress LZW -strip -resize 240x180   frame*.png   Animation.gif
@@ -686,6 +719,38 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_ScreenCaptureInfo.KeepAlpha = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || Arg == "1";
         }
+        else if (!(Arg = GetArgument(pos, "benchmark")).empty())
+        {
+            m_BenchmarkInfo.MeasuredFrames = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 0));
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_warmup")).empty())
+        {
+            m_BenchmarkInfo.WarmupFrames = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 0));
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_output")).empty())
+        {
+            m_BenchmarkInfo.OutputPath = std::move(Arg);
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_camera")).empty())
+        {
+            m_BenchmarkInfo.CameraPathFile = std::move(Arg);
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_baseline")).empty())
+        {
+            m_BenchmarkInfo.BaselinePath = std::move(Arg);
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_tolerance")).empty())
+        {
+            m_BenchmarkInfo.TolerancePercent = atof(Arg.c_str());
+        }
+        else if (!(Arg = GetArgument(pos, "profile_frames")).empty())
+        {
+            m_ProfileCaptureInfo.FramesToCapture = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 0));
+        }
+        else if (!(Arg = GetArgument(pos, "profile_path")).empty())
+        {
+            m_ProfileCaptureInfo.FilePath = std::move(Arg);
+        }
         else if (!(Arg = GetArgument(pos, "width")).empty())
         {
             m_InitialWindowWidth = atoi(Arg.c_str());
@@ -758,6 +823,12 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         pos = strchr(pos, '-');
     }
 
+    if (m_BenchmarkInfo.MeasuredFrames > 0 && m_bVSync)
+    {
+        LOG_WARNING_MESSAGE("Vertical sync is disabled in benchmark mode");
+        m_bVSync = false;
+    }
+
 	m_DeviceType = RENDER_DEVICE_TYPE_D3D12;
     if (m_DeviceType == RENDER_DEVICE_TYPE_UNDEFINED)
     {
@@ -793,6 +864,20 @@ void SampleApp::WindowResize(int width, int height)
 
 void SampleApp::Update(double CurrTime, double ElapsedTime)
 {
+    const bool bBenchmark = m_BenchmarkInfo.MeasuredFrames > 0;
+    if (bBenchmark)
+    {
+        // Every run simulates the same times whatever the frame rate
+        CurrTime    = m_BenchmarkInfo.CurrentFrame * m_BenchmarkInfo.TimeStep;
+        ElapsedTime = m_BenchmarkInfo.TimeStep;
+        if (!m_BenchmarkInfo.CameraPath.IsEmpty())
+        {
+            float3 Pos, LookAt;
+            m_BenchmarkInfo.CameraPath.Evaluate(static_cast<float>(CurrTime), Pos, LookAt);
+            m_TheSample->SetBenchmarkCamera(Pos, LookAt);
+        }
+    }
+
     m_CurrentTime = CurrTime;
 
     if (m_pImGui)
@@ -806,6 +891,22 @@ void SampleApp::Update(double CurrTime, double ElapsedTime)
     }
     if (m_pDevice)
     {
+        auto& Profiler = m_TheSample->GetProfiler();
+        if (Profiler.IsInFrame())
+        {
+            // The previous frame was not presented
+            if (m_pPipelineStatsQuery)
+            {
+                QueryDataPipelineStatistics Stats;
+                m_pPipelineStatsQuery->End(m_pImmediateContext, &Stats, sizeof(Stats));
+            }
+            Profiler.EndFrame(m_pImmediateContext);
+        }
+        Profiler.BeginFrame(m_pImmediateContext);
+        if (m_pPipelineStatsQuery)
+            m_pPipelineStatsQuery->Begin(m_pImmediateContext);
+
+        PROFILE_CPU_SCOPE(&Profiler, "Update", 0xFF3C9CE7u);
         m_TheSample->Update(CurrTime, ElapsedTime);
         m_TheSample->GetInputController().ClearState();
     }
@@ -820,6 +921,7 @@ void SampleApp::Render()
     ITextureView* pDSV = m_pSwapChain->GetDepthBufferDSV();
     m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+    PROFILE_CPU_SCOPE(&m_TheSample->GetProfiler(), "Render", 0xFF71CC2Eu);
     m_TheSample->Render();
 
     // Restore default render target in case the sample has changed it
@@ -838,6 +940,161 @@ void SampleApp::Render()
     }
 }
 
+void SampleApp::InitializeBenchmark()
+{
+    auto& Benchmark = m_BenchmarkInfo;
+    if (!Benchmark.CameraPathFile.empty())
+        Benchmark.CameraPath.Load(Benchmark.CameraPathFile.c_str());
+    if (Benchmark.CameraPath.IsEmpty())
+        m_TheSample->GetBenchmarkCameraPath(Benchmark.CameraPath);
+    if (Benchmark.CameraPath.IsEmpty())
+        LOG_WARNING_MESSAGE("The sample has no benchmark camera path, the camera will not move");
+
+    if (m_pDevice->GetDeviceCaps().Features.PipelineStatisticsQueries)
+    {
+        QueryDesc queryDesc;
+        queryDesc.Name = "Benchmark pipeline statistics query";
+        queryDesc.Type = QUERY_TYPE_PIPELINE_STATISTICS;
+        m_pPipelineStatsQuery.reset(new ScopedQueryHelper{m_pDevice, queryDesc, m_MaxFrameLatency + 1});
+    }
+    else
+    {
+        LOG_WARNING_MESSAGE("Pipeline statistics queries are not supported by this device and will not be reported");
+    }
+    if (!m_TheSample->GetProfiler().IsGPUProfilingSupported())
+        LOG_WARNING_MESSAGE("Timestamp queries are not supported by this device, GPU times will not be reported");
+
+    LOG_INFO_MESSAGE("Benchmark: ", Benchmark.WarmupFrames, " warm-up and ", Benchmark.MeasuredFrames, " measured frames");
+}
+
+void SampleApp::UpdateBenchmark()
+{
+    auto&       Benchmark = m_BenchmarkInfo;
+    auto&       Recorder  = Benchmark.Recorder;
+    const auto& Profiler  = m_TheSample->GetProfiler();
+
+    // Inclusive time of every scope in the frame, the frame itself is reported separately
+    auto AddScopeSamples = [&](const char* Prefix, const ProfileFrame& Frame) {
+        std::map<ProfileScopeId, double> ScopeTimes;
+        for (const auto& Event : Frame.Events)
+        {
+            if (Event.Depth > 0)
+                ScopeTimes[Event.ScopeId] += Event.End - Event.Begin;
+        }
+        for (const auto& it : ScopeTimes)
+            Recorder.AddSample(std::string{Prefix} + FrameProfiler::GetScopeName(it.first), "ms", it.second * 1000.0);
+    };
+
+    const Uint32 EndFrame   = Benchmark.WarmupFrames + Benchmark.MeasuredFrames;
+    const auto&  CPUFrame   = Profiler.GetLastCPUFrame();
+    const bool   bMeasuring = Benchmark.CurrentFrame >= Benchmark.WarmupFrames && Benchmark.CurrentFrame < EndFrame;
+    if (Benchmark.CurrentFrame == Benchmark.WarmupFrames)
+        Benchmark.FirstMeasuredFrame = CPUFrame.FrameNumber;
+    if (bMeasuring)
+    {
+        Recorder.AddSample("frame/cpu", "ms", (CPUFrame.End - CPUFrame.Begin) * 1000.0);
+        if (Benchmark.LastFrameBegin >= 0)
+            Recorder.AddSample("frame/interval", "ms", (CPUFrame.Begin - Benchmark.LastFrameBegin) * 1000.0);
+        AddScopeSamples("cpu/", CPUFrame);
+    }
+    Benchmark.LastFrameBegin = CPUFrame.Begin;
+
+    // GPU frames are resolved a few frames later
+    const auto& GPUFrame = Profiler.GetLastGPUFrame();
+    if (GPUFrame.FrameNumber != Benchmark.LastGPUFrame && !GPUFrame.Events.empty())
+    {
+        Benchmark.LastGPUFrame = GPUFrame.FrameNumber;
+        if (Benchmark.CurrentFrame >= Benchmark.WarmupFrames &&
+            GPUFrame.FrameNumber >= Benchmark.FirstMeasuredFrame &&
+            GPUFrame.FrameNumber < Benchmark.FirstMeasuredFrame + Benchmark.MeasuredFrames)
+        {
+            for (const auto& Event : GPUFrame.Events)
+            {
+                if (Event.Depth == 0)
+                    Recorder.AddSample("frame/gpu", "ms", (Event.End - Event.Begin) * 1000.0);
+            }
+            AddScopeSamples("gpu/", GPUFrame);
+        }
+    }
+
+    ++Benchmark.CurrentFrame;
+
+    // A few more frames let the timestamps of the last measured frames come back
+    if (Benchmark.CurrentFrame >= EndFrame + m_MaxFrameLatency + 2)
+        FinishBenchmark();
+}
+
+void SampleApp::FinishBenchmark()
+{
+    auto&      Benchmark = m_BenchmarkInfo;
+    const auto Metrics   = Benchmark.Recorder.Summarize();
+
+    m_ExitCode = 0;
+
+    std::vector<BenchmarkRegression> Regressions;
+    if (!Benchmark.BaselinePath.empty())
+    {
+        std::vector<BenchmarkMetric> Baseline;
+        if (ReadBenchmarkReport(Benchmark.BaselinePath.c_str(), Baseline))
+        {
+            Regressions = CompareBenchmarkMetrics(Baseline, Metrics, Benchmark.TolerancePercent, Benchmark.MinTimeDeltaMs);
+            for (const auto& Regression : Regressions)
+            {
+                LOG_ERROR_MESSAGE("Benchmark regression in ", Regression.Name, ": p50 ", Regression.BaselineP50, " -> ", Regression.CurrentP50,
+                                  ", p95 ", Regression.BaselineP95, " -> ", Regression.CurrentP95, " ", Regression.Unit);
+            }
+            m_ExitCode = static_cast<int>(std::min(Regressions.size(), size_t{BenchmarkMaxRegressionExitCode}));
+        }
+        else
+        {
+            m_ExitCode = BenchmarkBaselineErrorExitCode;
+        }
+    }
+
+    BenchmarkRunInfo Info;
+    Info.SampleName = m_TheSample->GetSampleName();
+    switch (m_DeviceType)
+    {
+        // clang-format off
+        case RENDER_DEVICE_TYPE_D3D11:  Info.DeviceType = "D3D11";     break;
+        case RENDER_DEVICE_TYPE_D3D12:  Info.DeviceType = "D3D12";     break;
+        case RENDER_DEVICE_TYPE_GL:     Info.DeviceType = "OpenGL";    break;
+        case RENDER_DEVICE_TYPE_GLES:   Info.DeviceType = "OpenGLES";  break;
+        case RENDER_DEVICE_TYPE_VULKAN: Info.DeviceType = "Vulkan";    break;
+        case RENDER_DEVICE_TYPE_METAL:  Info.DeviceType = "Metal";     break;
+        default:                        Info.DeviceType = "Undefined"; break;
+            // clang-format on
+    }
+    Info.Adapter = m_AdapterAttribs.Description;
+    Info.Width   = m_pSwapChain->GetDesc().Width;
+    Info.Height  = m_pSwapChain->GetDesc().Height;
+    Info.Frames  = Benchmark.MeasuredFrames;
+    Info.Warmup  = Benchmark.WarmupFrames;
+    if (!WriteBenchmarkReport(Benchmark.OutputPath.c_str(), Info, Metrics, Benchmark.BaselinePath.empty() ? nullptr : &Regressions))
+        m_ExitCode = BenchmarkReportErrorExitCode;
+
+    for (const auto& Metric : Metrics)
+    {
+        if (Metric.Name.compare(0, 6, "frame/") == 0)
+            LOG_INFO_MESSAGE(Metric.Name, ": p50 ", Metric.P50, ", p95 ", Metric.P95, ", p99 ", Metric.P99, " ", Metric.Unit);
+    }
+    LOG_INFO_MESSAGE("Benchmark report is written to ", Benchmark.OutputPath);
+
+    // NativeAppBase has no way to leave the message loop, so the benchmark ends the process.
+    // The sample and the engine are released as ~SampleApp() does first, which lets the sample
+    // finish its work in flight (e.g. the atmosphere LUT cache joins its writer threads).
+    m_pImmediateContext->Flush();
+    m_pImmediateContext->WaitForIdle();
+    m_pImGui.reset();
+    m_TheSample.reset();
+    m_pImmediateContext->Flush();
+    m_pDeferredContexts.clear();
+    m_pImmediateContext.Release();
+    m_pSwapChain.Release();
+    m_pDevice.Release();
+    std::exit(m_ExitCode);
+}
+
 void SampleApp::CompareGoldenImage(const std::string& FileName, ScreenCapture::CaptureInfo& Capture)
 {
     RefCntAutoPtr<Image> pGoldenImg;
@@ -957,7 +1214,51 @@ void SampleApp::Present()
         }
     }
 
-    m_pSwapChain->Present(m_bVSync ? 1 : 0);
+    auto& Profiler = m_TheSample->GetProfiler();
+    if (m_pPipelineStatsQuery && Profiler.IsInFrame())
+    {
+        // The data is the one of the oldest frame the GPU has finished
+        QueryDataPipelineStatistics Stats;
+        if (m_pPipelineStatsQuery->End(m_pImmediateContext, &Stats, sizeof(Stats)) &&
+            m_BenchmarkInfo.CurrentFrame >= m_BenchmarkInfo.WarmupFrames &&
+            m_BenchmarkInfo.CurrentFrame < m_BenchmarkInfo.WarmupFrames + m_BenchmarkInfo.MeasuredFrames)
+        {
+            auto& Recorder = m_BenchmarkInfo.Recorder;
+            // clang-format off
+            Recorder.AddSample("pipeline/input_vertices",      "count", static_cast<double>(Stats.InputVertices));
+            Recorder.AddSample("pipeline/input_primitives",    "count", static_cast<double>(Stats.InputPrimitives));
+            Recorder.AddSample("pipeline/vs_invocations",      "count", static_cast<double>(Stats.VSInvocations));
+            Recorder.AddSample("pipeline/gs_invocations",      "count", static_cast<double>(Stats.GSInvocations));
+            Recorder.AddSample("pipeline/hs_invocations",      "count", static_cast<double>(Stats.HSInvocations));
+            Recorder.AddSample("pipeline/ds_invocations",      "count", static_cast<double>(Stats.DSInvocations));
+            Recorder.AddSample("pipeline/clipping_primitives", "count", static_cast<double>(Stats.ClippingPrimitives));
+            Recorder.AddSample("pipeline/ps_invocations",      "count", static_cast<double>(Stats.PSInvocations));
+            Recorder.AddSample("pipeline/cs_invocations",      "count", static_cast<double>(Stats.CSInvocations));
+            // clang-format on
+        }
+    }
+
+    {
+        PROFILE_CPU_SCOPE(&Profiler, "Present", 0xFFB6599Bu);
+        m_pSwapChain->Present(m_bVSync ? 1 : 0);
+    }
+    if (Profiler.IsInFrame())
+    {
+        Profiler.EndFrame(m_pImmediateContext);
+        if (m_BenchmarkInfo.MeasuredFrames > 0)
+            UpdateBenchmark();
+    }
+
+    if (m_ProfileCaptureInfo.FramesToCapture > 0 && Profiler.GetNumCapturedFrames() > 0 && Profiler.IsCaptureResolved())
+    {
+        // Exported once the timestamps of the last captured frame are read back
+        const auto TraceFile   = m_ProfileCaptureInfo.FilePath + ".json";
+        const auto CaptureFile = m_ProfileCaptureInfo.FilePath + ".dfpc";
+        if (Profiler.ExportChromeTrace(TraceFile.c_str()) && Profiler.ExportBinary(CaptureFile.c_str()))
+            LOG_INFO_MESSAGE("Profiled ", Profiler.GetNumCapturedFrames(), " frames to ", TraceFile, " and ", CaptureFile);
+        Profiler.ClearCapture();
+        m_ProfileCaptureInfo.FramesToCapture = 0;
+    }
 
     if (m_pScreenCapture)
     {
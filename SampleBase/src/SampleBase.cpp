@@ -34,6 +34,10 @@ namespace Diligent
 
 void SampleBase::GetEngineInitializationAttribs(RENDER_DEVICE_TYPE DeviceType, EngineCreateInfo& EngineCI, SwapChainDesc& /*SCDesc*/)
 {
+    // GPU scopes of the frame profiler and the counters of the benchmark mode
+    EngineCI.Features.TimestampQueries          = DEVICE_FEATURE_STATE_OPTIONAL;
+    EngineCI.Features.PipelineStatisticsQueries = DEVICE_FEATURE_STATE_OPTIONAL;
+
     switch (DeviceType)
     {
 #if D3D11_SUPPORTED
@@ -48,6 +48,7 @@
 #include <array>
 
 #include "EarthHemisphere.hpp"
+#include "MeshOptimizer.hpp"
 
 namespace Diligent
 {
@@ -221,16 +222,16 @@ void ComputeVertexHeight(HemisphereVertex&          Vertex,
 }
 
 
+// Ring sector meshes are generated as triangle strips and drawn as triangle lists
+// reordered for the post-transform vertex cache
 class RingMeshBuilder
 {
 public:
-    RingMeshBuilder(IRenderDevice*                       pDevice,
-                    const std::vector<HemisphereVertex>& VB,
-                    int                                  iGridDimenion,
-                    std::vector<RingSectorMesh>&         RingMeshes) :
+    RingMeshBuilder(IRenderDevice*               pDevice,
+                    int                          iGridDimenion,
+                    std::vector<RingSectorMesh>& RingMeshes) :
         m_pDevice(pDevice),
         m_RingMeshes(RingMeshes),
-        m_VB(VB),
         m_iGridDimenion(iGridDimenion)
     {}
 
@@ -239,48 +240,76 @@ public:
                     int                          iStartRow,
                     int                          iNumCols,
                     int                          iNumRows,
-                    enum QUAD_TRIANGULATION_TYPE QuadTriangType)
+                    enum QUAD_TRIANGULATION_TYPE QuadTriangType,
+                    Uint32                       NumVertices)
     {
-        m_RingMeshes.push_back(RingSectorMesh());
-        auto& CurrMesh = m_RingMeshes.back();
-
-        std::vector<Uint32> IB;
-        StdTriStrip32       TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
+        std::vector<Uint32> StripIB;
+        StdTriStrip32       TriStrip(StripIB, StdIndexGenerator(m_iGridDimenion));
         TriStrip.AddStrip(iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType);
 
-        CurrMesh.uiNumIndices = (Uint32)IB.size();
-
-        // Prepare buffer description
-        BufferDesc IndexBufferDesc;
-        IndexBufferDesc.Name          = "Ring mesh index buffer";
-        IndexBufferDesc.uiSizeInBytes = (Uint32)(IB.size() * sizeof(IB[0]));
-        IndexBufferDesc.BindFlags     = BIND_INDEX_BUFFER;
-        IndexBufferDesc.Usage         = USAGE_IMMUTABLE;
-        BufferData IBInitData;
-        IBInitData.pData    = IB.data();
-        IBInitData.DataSize = IndexBufferDesc.uiSizeInBytes;
-        // Create the buffer
-        m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
-        VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
-
-        // Compute bounding box
-        auto& BB = CurrMesh.BndBox;
-        BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-        BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
-        for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
+        std::vector<Uint32> ListIB;
+        ConvertTriangleStripToList(StripIB.data(), (Uint32)StripIB.size(), ListIB);
+
+        m_MeshIndices.emplace_back(ListIB.size());
+        OptimizeVertexCacheForsyth(ListIB.data(), (Uint32)ListIB.size(), NumVertices, m_MeshIndices.back().data());
+    }
+
+    // Vertices are reordered for fetch locality and vertices not referenced
+    // by any mesh are removed, so this must be called once all meshes are added
+    void CreateBuffers(std::vector<HemisphereVertex>& VB)
+    {
+        std::vector<Uint32> AllIndices;
+        for (const auto& IB : m_MeshIndices)
+            AllIndices.insert(AllIndices.end(), IB.begin(), IB.end());
+
+        std::vector<Uint32> Remap;
+        const Uint32        NumUsedVertices = OptimizeVertexFetch(AllIndices.data(), (Uint32)AllIndices.size(), (Uint32)VB.size(), Remap);
+        RemapVertices(VB, Remap, NumUsedVertices);
+
+        size_t FirstIndex = 0;
+        for (const auto& SrcIB : m_MeshIndices)
         {
-            const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+            const std::vector<Uint32> IB(AllIndices.begin() + FirstIndex, AllIndices.begin() + FirstIndex + SrcIB.size());
+            FirstIndex += SrcIB.size();
+
+            m_RingMeshes.push_back(RingSectorMesh());
+            auto& CurrMesh = m_RingMeshes.back();
+
+            CurrMesh.uiNumIndices = (Uint32)IB.size();
+
+            // Prepare buffer description
+            BufferDesc IndexBufferDesc;
+            IndexBufferDesc.Name          = "Ring mesh index buffer";
+            IndexBufferDesc.uiSizeInBytes = (Uint32)(IB.size() * sizeof(IB[0]));
+            IndexBufferDesc.BindFlags     = BIND_INDEX_BUFFER;
+            IndexBufferDesc.Usage         = USAGE_IMMUTABLE;
+            BufferData IBInitData;
+            IBInitData.pData    = IB.data();
+            IBInitData.DataSize = IndexBufferDesc.uiSizeInBytes;
+            // Create the buffer
+            m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
+            VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
+
+            // Compute bounding box
+            auto& BB = CurrMesh.BndBox;
+            BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+            for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
+            {
+                const auto& CurrVert = VB[*Ind].f3WorldPos;
 
-            BB.Min = std::min(BB.Min, CurrVert);
-            BB.Max = std::max(BB.Max, CurrVert);
+                BB.Min = std::min(BB.Min, CurrVert);
+                BB.Max = std::max(BB.Max, CurrVert);
+            }
         }
+        m_MeshIndices.clear();
     }
 
 private:
-    RefCntAutoPtr<IRenderDevice>         m_pDevice;
-    std::vector<RingSectorMesh>&         m_RingMeshes;
-    const std::vector<HemisphereVertex>& m_VB;
-    const int                            m_iGridDimenion;
+    RefCntAutoPtr<IRenderDevice>     m_pDevice;
+    std::vector<RingSectorMesh>&     m_RingMeshes;
+    std::vector<std::vector<Uint32>> m_MeshIndices;
+    const int                        m_iGridDimenion;
 };
 
 
@@ -304,7 +333,7 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 
     //const int iLargestGridScale = iGridDimension << (iNumRings-1);
 
-    RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, SphereMeshes);
+    RingMeshBuilder RingMeshBuilder(pDevice, iGridDimension, SphereMeshes);
 
     int iStartRing = 0;
     VB.reserve((iNumRings - iStartRing) * iGridDimension * iGridDimension);
@@ -379,36 +408,38 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
         if (iRing == 0)
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
             // clang-format on
         }
         else
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.CreateMesh(iCurrGridStart,            0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10, (Uint32)VB.size());
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
+            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11, (Uint32)VB.size());
             // clang-format on
         }
     }
 
+    RingMeshBuilder.CreateBuffers(VB);
+
     // We do not need per-vertex normals as we use normal map to shade terrain
     // Sphere tangent vertex are computed in the shader
 #if 0
@@ -775,7 +806,7 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         GraphicsPipeline.InputLayout.LayoutElements = Inputs;
         GraphicsPipeline.InputLayout.NumElements    = _countof(Inputs);
         GraphicsPipeline.DSVFormat                  = m_Params.ShadowMapFormat;
-        GraphicsPipeline.PrimitiveTopology          = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+        GraphicsPipeline.PrimitiveTopology          = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         PSOCreateInfo.pVS                           = pHemisphereZOnlyVS;
         pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pHemisphereZOnlyPSO);
         m_pHemisphereZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
@@ -919,7 +950,7 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
         GraphicsPipeline.RTVFormats[0]                        = m_Params.DstRTVFormat;
         GraphicsPipeline.NumRenderTargets                     = 1;
         GraphicsPipeline.DSVFormat                            = TEX_FORMAT_D32_FLOAT;
-        GraphicsPipeline.PrimitiveTopology                    = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+        GraphicsPipeline.PrimitiveTopology                    = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pHemispherePSO);
         m_pHemispherePSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
         m_pHemispherePSO->CreateShaderResourceBinding(&m_pHemisphereSRB, true);
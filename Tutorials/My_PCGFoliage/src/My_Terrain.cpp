@@ -29,6 +29,7 @@
 #include "MapHelper.hpp"
 #include "GroundMesh.h"
 #include "DebugCanvas.h"
+#include "TerrainCoreAssets.h"
 #include "imgui.h"
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
@@ -41,7 +42,6 @@
 
 namespace Diligent
 {	
-	DebugCanvas gDebugCanvas;
 
 SampleBase* CreateSample()
 {
@@ -96,7 +96,7 @@ void My_Terrain::Initialize(const SampleInitInfo& InitInfo)
     // clang-format on
 
     ShaderCreateInfo ShaderCI;
-	m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &m_pShaderSourceFactory);
+	m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(TERRAIN_CORE_SHADER_DIRS, &m_pShaderSourceFactory);
 	ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
     // Tell the system that the shader source code is in HLSL.
     // For OpenGL, the engine will convert this into GLSL under the hood.
@@ -165,15 +165,23 @@ void My_Terrain::Initialize(const SampleInitInfo& InitInfo)
 
 	//auto start = std::chrono::high_resolution_clock::now();		
 	m_pPCGSystem = new PCGSystem(m_pImmediateContext, m_pDevice, m_pShaderSourceFactory, TerrainDim);
-	m_pPCGSystem->DoProcedural();
-//	auto end = std::chrono::high_resolution_clock::now();
-//	std::chrono::duration<double, std::milli> elapsed = end - start;
-//	//std::cout << "Waited " << elapsed.count() << " ms\n";
-//	std::ofstream myfile;
-//	myfile.open("test_log.txt");
-//	myfile << "Writing this to a file.\n";
-//	myfile << elapsed.count();
-//	myfile.close();
+	if (m_bProfilePCGDispatch)
+	{
+		//logs CPU/GPU time of per node and batched dispatch, the batched result is kept
+		m_pPCGSystem->ProfileDispatchModes();
+	}
+	else
+	{
+		m_pPCGSystem->DoProcedural();
+	}
+
+	if (m_bPCGEditTest)
+	{
+		//clears the mask in a circle at the tile center, the region update time is logged,
+		//then adds medium trees next to it as their own plants
+		m_pPCGSystem->PaintTerrainMask(float2(0.5f, 0.5f), 0.05f, 0.0f);
+		m_pPCGSystem->AddPlants(F_MEDIUM_TREE_LAYER, 0, float2(0.6f, 0.5f), 0.05f, 64);
+	}
 
 	m_pProxyCube = new ProxyCube();
 	PCGResultData pcg_result_data = m_pPCGSystem->GetPCGResultData();
@@ -241,6 +249,27 @@ void My_Terrain::Update(double CurrTime, double ElapsedTime)
 	m_apClipMap->Update(&m_Camera);
 }
 
+std::string GetArgument(const char*& pos, const char* ArgName);
+
+void My_Terrain::ProcessCommandLine(const char* CmdLine)
+{
+	const auto* pos = strchr(CmdLine, '-');
+	while (pos != nullptr)
+	{
+		++pos;
+		std::string Arg;
+		if (!(Arg = GetArgument(pos, "pcg_profile_dispatch")).empty())
+		{
+			m_bProfilePCGDispatch = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "pcg_edit_test")).empty())
+		{
+			m_bPCGEditTest = Arg == "1" || Arg == "true";
+		}
+		pos = strchr(pos, '-');
+	}
+}
+
 void MakePlane(int rows, int columns, TerrainVertexAttrData *vertices, int *indices)
 {
 	// Set up vertices
@@ -325,6 +354,8 @@ void My_Terrain::UpdateUI()
 		float3 CamForward = m_Camera.GetWorldAhead();
 		ImGui::Text("Cam Forward %.2f, %.2f, %.2f", CamForward.x, CamForward.y, CamForward.z);
 		ImGui::gizmo3D("Cam direction", CamForward, ImGui::GetTextLineHeight() * 10);
+		ImGui::Text("Terrain pass CPU %.3f ms, %u patches, %u draws", m_apClipMap->GetRenderCPUTime(),
+			m_apClipMap->GetRenderPatchNum(), m_apClipMap->GetRenderDrawNum());
 	}
 	ImGui::End();
 }
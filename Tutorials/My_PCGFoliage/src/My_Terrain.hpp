@@ -74,6 +74,8 @@ public:
 
 	virtual void WindowResize(Uint32 Width, Uint32 Height);
 
+	virtual void ProcessCommandLine(const char* CmdLine) override final;
+
 protected:
 	void UpdateUI();
 	void CreateGridBuffer();
@@ -99,6 +101,11 @@ private:
 
 	PCGSystem *m_pPCGSystem;
 	ProxyCube *m_pProxyCube;
+
+	//-pcg_profile_dispatch runs the PCG per node and batched at startup to compare them
+	bool m_bProfilePCGDispatch = false;
+	//-pcg_edit_test paints the mask after the PCG, regenerates the touched nodes and adds plants
+	bool m_bPCGEditTest = false;
 };
 
 } // namespace Diligent
@@ -8,12 +8,21 @@
 #include "PCGLayer.h"
 #include "PCGSystem.h"
 
+namespace
+{
+	//layer grid and SDF page layout shared by the PCG compute shaders, see PCGCommon.fxh
+	void AddPCGShaderMacros(Diligent::ShaderMacroHelper &Macros)
+	{
+		Macros.AddShaderMacro("PCG_SDF_PAGE_SIZE", Diligent::PCG_SDF_PAGE_SIZE);
+		Macros.AddShaderMacro("PCG_SDF_PAGES_PER_AXIS", Diligent::PCG_SDF_PAGES_PER_AXIS);
+	}
+}
+
 Diligent::PCGCSCall::PCGCSCall(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory) :	
 	m_pDevice(pDevice)
 {
 	CreatePSO(pDevice, pShaderFactory);
 
-	CreateGlobalPointTextureuBuffer();
 	CreateGPUGenSDFMapBuffer();
 }
 
@@ -53,40 +62,40 @@ void Diligent::PCGCSCall::CreateGlobalPointBuffer(const std::vector<PCGPoint> &p
 	}
 }
 
-void Diligent::PCGCSCall::CreateGlobalPointTextureuBuffer()
+void Diligent::PCGCSCall::CreateGlobalPointTextureuBuffer(const std::vector<PCGPoint> &points, const PlantParamLayer &PlantLayer)
 {
 	mPointTextureDeviceDataVec.resize(F_LAYER_NUM);
 
 	for (int i = 0; i < F_LAYER_NUM; ++i)
 	{
-		char DatName[128];
-		sprintf(DatName, "./PoissonLayer%d.dat", i);
-
-		std::ifstream is(DatName, std::ifstream::binary);
-
-		int TextureSize, PointLen;
-
-		is.read((char*)&TextureSize, sizeof(int));
-		is.read((char*)&PointLen, sizeof(int));
-
-		std::vector<float2> Points;
-		Points.resize(PointLen);
-
-		is.read((char*)&Points[0], sizeof(float2) * PointLen);
-		is.close();
+		//one texel per layer texel over the whole tile, nodes read it at their NodeTexOffset
+		const int TextureSize = (2 << i) * PlantLayer[i][0].size;
+		const int DomainSize = points[i].GetDomainSize();
+		const int RepeatNum = DomainSize > 0 ? TextureSize / DomainSize : 0;
+		const std::vector<std::array<float, 2>> &Points = points[i].GetPoints();
+		const std::vector<uint8_t> &Types = points[i].GetTypes();
 
 		const int TextureDataSize = TextureSize * TextureSize;
 		std::vector<unsigned char> SrcTextureData;
 		SrcTextureData.resize(TextureDataSize);
 
+		//0 - no point, otherwise plant type + 1
 		memset(&SrcTextureData[0], 0, sizeof(unsigned char) * TextureDataSize);
 		for (int pi = 0; pi < Points.size(); ++pi)
 		{
-			float2 &v = Points[pi];
-			int x = v[0];
-			int y = v[1];
-
-			SrcTextureData[y * TextureSize + x] = 255;
+			const std::array<float, 2> &v = Points[pi];
+			unsigned char TypeCode = static_cast<unsigned char>((Types.empty() ? 0 : Types[pi]) + 1);
+
+			for (int ry = 0; ry < RepeatNum; ++ry)
+			{
+				for (int rx = 0; rx < RepeatNum; ++rx)
+				{
+					int x = static_cast<int>(v[0]) + rx * DomainSize;
+					int y = static_cast<int>(v[1]) + ry * DomainSize;
+
+					SrcTextureData[y * TextureSize + x] = TypeCode;
+				}
+			}
 		}
 
 		//float type
@@ -151,7 +160,7 @@ void Diligent::PCGCSCall::BindPoissonPosMap(uint Layer)
 	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "PoissonPosMapData")->Set(pPoissonTex);
 }
 
-void Diligent::PCGCSCall::BindPosMapRes(IDeviceContext *pContext, IBuffer *pNodeConstBuffer, const PCGNodeData &NodeData, ITexture* pOutTex, std::vector<RefCntAutoPtr<ITexture>> &pSDFDensityTex)
+void Diligent::PCGCSCall::BindPosMapRes(IDeviceContext *pContext, IBuffer *pBatchConstBuffer, IBuffer *pNodeDataBuffer, uint FirstNodeIdx, ITexture* pOutTex, ITexture *pSDFAtlasTex, IBufferView *pSDFPageTable)
 {
 	PCGCSGpuRes *pCalPosMapRes = &mPCGCSGPUResVec[PCG_CS_CAL_POS_MAP];
 
@@ -159,23 +168,15 @@ void Diligent::PCGCSCall::BindPosMapRes(IDeviceContext *pContext, IBuffer *pNode
 		&TexDefaultArray[0], 0, TexDefaultArray.size());*/
 	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "OutPosMapData")->Set(pOutTex->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));	
 
-	//if (SDFDensityNum > 0)
-	{
-		std::vector<IDeviceObject*> pTexSRVs(pSDFDensityTex.size());
-		//IDeviceObject* pTexSRVs = new IDeviceObject[pSDFDensityTex.size()];
-		//IDeviceObject*          pTexSRVs[84] = {};
-		for (int i = 0; i < pSDFDensityTex.size(); ++i)
-		{
-			pTexSRVs[i] = pSDFDensityTex[i]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-		}
-		pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "DensityTextures")->SetArray(&pTexSRVs[0], 0, pSDFDensityTex.size());
-	}
+	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "SDFAtlas")->Set(pSDFAtlasTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "SDFPageTable")->Set(pSDFPageTable);
 
 	{
-		MapHelper<PCGNodeData> CBConstants(pContext, pNodeConstBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-		memcpy((void*)CBConstants.GetMapData(), &NodeData, sizeof(PCGNodeData));
+		MapHelper<PCGBatchData> CBConstants(pContext, pBatchConstBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+		CBConstants->BatchNodeOffset = FirstNodeIdx;
 	}
-	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbPCGPointData")->Set(pNodeConstBuffer);
+	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbPCGBatchData")->Set(pBatchConstBuffer);
+	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "PCGNodeDatas")->Set(pNodeDataBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
 }
 
 void Diligent::PCGCSCall::BindPosBuffer(IDeviceContext *pContext, IBuffer *pPlantTypeNumberBuffer, IBuffer *pPlantPositionBuffers)
@@ -207,14 +208,15 @@ void Diligent::PCGCSCall::InitSDFMapSetPSO(IDeviceContext *pContext)
 	pContext->SetPipelineState(pInitSDFMapRes->apBindlessSRB->GetPipelineState());
 }
 
-void Diligent::PCGCSCall::BindInitSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, ITexture *pInputTex, ITexture *pOutputTex)
+void Diligent::PCGCSCall::BindInitSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, ITexture *pInputTex, ITexture *pOutputTex)
 {
 	PCGCSGpuRes *pInitSDFMapRes = &mPCGCSGPUResVec[PCG_CS_INIT_SDF_MAP];
 
 	{
 		MapHelper<InitSDFMapData> CBConstants(pContext, m_apInitSDFMapBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-		InitSDFMapData inData;
+		InitSDFMapData inData = {};
 		inData.TexSizeAndInvertSize = float4(NodeData.TexSize, NodeData.TexSize, 1.0f / NodeData.TexSize, 1.0f / NodeData.TexSize);
+		inData.MortonOffset = FirstMortonCode;
 		memcpy((void*)CBConstants.GetMapData(), &inData, sizeof(InitSDFMapData));
 	}
 	pInitSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbInitSDFMapData")->Set(m_apInitSDFMapBuffer);
@@ -223,12 +225,12 @@ void Diligent::PCGCSCall::BindInitSDFMapData(IDeviceContext *pContext, const PCG
 	pInitSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "OutInitSDFMap")->Set(pOutputTex->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
 }
 
-void Diligent::PCGCSCall::InitSDFDispatch(IDeviceContext *pContext, uint MapSize)
+void Diligent::PCGCSCall::InitSDFDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum)
 {
 	PCGCSGpuRes *pInitSDFMapRes = &mPCGCSGPUResVec[PCG_CS_INIT_SDF_MAP];
 	pContext->CommitShaderResources(pInitSDFMapRes->apBindlessSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4);
+	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4, NodeNum);
 	pContext->DispatchCompute(attr);
 }
 
@@ -238,15 +240,16 @@ void Diligent::PCGCSCall::SDFJumpFloodSetPSO(IDeviceContext *pContext)
 	pContext->SetPipelineState(pSDFJumpFloodMapRes->apBindlessSRB->GetPipelineState());
 }
 
-void Diligent::PCGCSCall::BindSDFJumpFloodData(IDeviceContext *pContext, const PCGNodeData &NodeData, float2 SampleStep, ITexture *pInputTex, ITexture *pOutputTex, bool reverse)
+void Diligent::PCGCSCall::BindSDFJumpFloodData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, float2 SampleStep, ITexture *pInputTex, ITexture *pOutputTex, bool reverse)
 {
 	PCGCSGpuRes *pSDFJumpFloodRes = &mPCGCSGPUResVec[PCG_CS_SDF_JUMP_FLOOD_MAP];
 
 	{
 		MapHelper<PCGSDFJumpFloodData> CBConstants(pContext, m_apSDFJumpFloodBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-		PCGSDFJumpFloodData inData;
+		PCGSDFJumpFloodData inData = {};
 		inData.Step = SampleStep;
 		inData.TextureSize = NodeData.TexSize;
+		inData.MortonOffset = FirstMortonCode;
 		memcpy((void*)CBConstants.GetMapData(), &inData, sizeof(PCGSDFJumpFloodData));
 	}
 	pSDFJumpFloodRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbPCGSDFJumpFloodData")->Set(m_apSDFJumpFloodBuffer);
@@ -263,12 +266,12 @@ void Diligent::PCGCSCall::BindSDFJumpFloodData(IDeviceContext *pContext, const P
 	}
 }
 
-void Diligent::PCGCSCall::SDFJumpFloodDispatch(IDeviceContext *pContext, uint MapSize)
+void Diligent::PCGCSCall::SDFJumpFloodDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum)
 {
 	PCGCSGpuRes *pSDFJumpFloodMapRes = &mPCGCSGPUResVec[PCG_CS_SDF_JUMP_FLOOD_MAP];
 	pContext->CommitShaderResources(pSDFJumpFloodMapRes->apBindlessSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4);
+	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4, NodeNum);
 	pContext->DispatchCompute(attr);
 }
 
@@ -278,32 +281,35 @@ void Diligent::PCGCSCall::GenSDFMapSetPSO(IDeviceContext *pContext)
 	pContext->SetPipelineState(pGenSDFMapRes->apBindlessSRB->GetPipelineState());
 }
 
-void Diligent::PCGCSCall::BindGenSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, ITexture *pOriginalTex, ITexture *pInputTex, ITexture *pOutputTex, bool reverse)
+void Diligent::PCGCSCall::BindGenSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, ITexture *pOriginalTex, ITexture *pInputTex, ITexture *pOutputAtlasTex, IBufferView *pSDFPageTable, bool reverse)
 {
 	PCGCSGpuRes *pGenSDFMapRes = &mPCGCSGPUResVec[PCG_CS_GENERATE_SDF];
 
 	{
 		MapHelper<PCGGenSDFData> CBConstants(pContext, m_apGenSDFMapBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-		PCGGenSDFData inData;
+		PCGGenSDFData inData = {};
 		inData.TextureSize = float2(NodeData.TexSize, NodeData.TexSize);
 		inData.PlantRadius = NodeData.PlantRadius;
 		inData.PlantZOI = NodeData.PlantZOI;
-		memcpy((void*)CBConstants.GetMapData(), &inData, sizeof(InitSDFMapData));
+		inData.MortonOffset = FirstMortonCode;
+		inData.LayerIdx = NodeData.LayerIdx;
+		memcpy((void*)CBConstants.GetMapData(), &inData, sizeof(PCGGenSDFData));
 	}
 	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbPCGGenSDFData")->Set(m_apGenSDFMapBuffer);
 
 	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "OriginalTexture")->Set(pOriginalTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 
 	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "InputTexture")->Set(pInputTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "OutputTexture")->Set(pOutputTex->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));	
+	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "OutputTexture")->Set(pOutputAtlasTex->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+	pGenSDFMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "SDFPageTable")->Set(pSDFPageTable);
 }
 
-void Diligent::PCGCSCall::GenSDFMapDispatch(IDeviceContext *pContext, uint MapSize)
+void Diligent::PCGCSCall::GenSDFMapDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum)
 {
 	PCGCSGpuRes *pGenSDFMapRes = &mPCGCSGPUResVec[PCG_CS_GENERATE_SDF];
 	pContext->CommitShaderResources(pGenSDFMapRes->apBindlessSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4);
+	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4, NodeNum);
 	pContext->DispatchCompute(attr);
 }
 
@@ -315,12 +321,12 @@ void Diligent::PCGCSCall::BindTerrainMaskMap(IDeviceContext *pContext, ITexture*
 	pCalPosMapRes->apBindlessSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "TerrainHeightMap")->Set(pHeightTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 }
 
-void Diligent::PCGCSCall::PosMapDispatch(IDeviceContext *pContext, uint MapSize)
+void Diligent::PCGCSCall::PosMapDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum)
 {
 	PCGCSGpuRes *pCalPosMapRes = &mPCGCSGPUResVec[PCG_CS_CAL_POS_MAP];
 	pContext->CommitShaderResources(pCalPosMapRes->apBindlessSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4);
+	DispatchComputeAttribs attr(MapSize / 4, MapSize / 4, NodeNum);
 	pContext->DispatchCompute(attr);
 }
 
@@ -360,8 +366,7 @@ void Diligent::PCGCSCall::CreateCalPosMapPSO(IRenderDevice *pDevice, IShaderSour
 		//ShaderCI.Macros = Macros;
 		ShaderMacroHelper Macros;
 
-		uint32_t density_texture_num = GetPCGTextureNum();
-		Macros.AddShaderMacro("NUM_DENSITY_TEXTURES", density_texture_num);
+		AddPCGShaderMacros(Macros);
 		ShaderCI.Macros = Macros;
 
 		pDevice->CreateShader(ShaderCI, &pCalculatePOSMapCS);
@@ -380,7 +385,7 @@ void Diligent::PCGCSCall::CreateCalPosMapPSO(IRenderDevice *pDevice, IShaderSour
 	// to change on a per-instance basis
 	ShaderResourceVariableDesc Vars[] =
 	{
-		{SHADER_TYPE_COMPUTE, "cbPCGPointData", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC},		
+		{SHADER_TYPE_COMPUTE, "cbPCGBatchData", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC},		
 	};
 	// clang-format on
 	PSODesc.ResourceLayout.Variables = Vars;
@@ -416,7 +421,9 @@ void Diligent::PCGCSCall::CreateInitSDFMapPSO(IRenderDevice *pDevice, IShaderSou
 		ShaderCI.EntryPoint = "InitSDFMapMain";
 		ShaderCI.Desc.Name = "InitSDFMapMain CS";
 		ShaderCI.FilePath = "InitSDFMap.csh";
-		//ShaderCI.Macros = Macros;
+		ShaderMacroHelper Macros;
+		AddPCGShaderMacros(Macros);
+		ShaderCI.Macros = Macros;
 		pDevice->CreateShader(ShaderCI, &pInitSDFMapCS);
 	}
 
@@ -469,7 +476,9 @@ void Diligent::PCGCSCall::CreateSDFJumpFloodPSO(IRenderDevice *pDevice, IShaderS
 		ShaderCI.EntryPoint = "SDFJumpFloodMain";
 		ShaderCI.Desc.Name = "SDFJumpFloodMain CS";
 		ShaderCI.FilePath = "SDFJumpFlood.csh";
-		//ShaderCI.Macros = Macros;
+		ShaderMacroHelper Macros;
+		AddPCGShaderMacros(Macros);
+		ShaderCI.Macros = Macros;
 		pDevice->CreateShader(ShaderCI, &pSDFJumpFloodCS);
 	}
 
@@ -522,7 +531,9 @@ void Diligent::PCGCSCall::CreateGenSDFMapPSO(IRenderDevice *pDevice, IShaderSour
 		ShaderCI.EntryPoint = "GenSDFMain";
 		ShaderCI.Desc.Name = "GenSDFMain CS";
 		ShaderCI.FilePath = "GenSDFMap.csh";
-		//ShaderCI.Macros = Macros;
+		ShaderMacroHelper Macros;
+		AddPCGShaderMacros(Macros);
+		ShaderCI.Macros = Macros;
 		pDevice->CreateShader(ShaderCI, &pGenSDFMapCS);
 	}
 
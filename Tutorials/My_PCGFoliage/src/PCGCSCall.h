@@ -12,6 +12,7 @@
 #include "Shader.h"
 #include "PCGPoint.h"
 #include "PCGNodePool.h"
+#include "PCGLayer.h"
 
 namespace Diligent
 {
@@ -34,15 +35,27 @@ namespace Diligent
 		//std::unordered_map<std::string, RefCntAutoPtr<IBuffer>>   apCSBuffers;
 	};
 
+	//MortonOffset - morton code of the first node in the dispatch, SV_GroupID.z adds to it
+
+	struct PCGBatchData
+	{
+		uint BatchNodeOffset; //linear quad index of the first node in the dispatch
+		uint Padding[3];
+	};
+
 	struct InitSDFMapData
 	{
 		float4 TexSizeAndInvertSize;
+		uint MortonOffset;
+		uint Padding[3];
 	};
 
 	struct PCGSDFJumpFloodData
 	{
 		float2 Step;
 		float2 TextureSize;
+		uint MortonOffset;
+		uint Padding[3];
 	};
 
 	struct PCGGenSDFData
@@ -50,6 +63,9 @@ namespace Diligent
 		float2 TextureSize;
 		float PlantRadius;
 		float PlantZOI; // zone of influence
+		uint MortonOffset;
+		uint LayerIdx;
+		uint Padding[2];
 	};
 
 	class PCGCSCall
@@ -59,31 +75,31 @@ namespace Diligent
 		~PCGCSCall();
 
 		void CreateGlobalPointBuffer(const std::vector<PCGPoint> &points);
-		void CreateGlobalPointTextureuBuffer();
+		void CreateGlobalPointTextureuBuffer(const std::vector<PCGPoint> &points, const PlantParamLayer &PlantLayer);
 
 		void CreateGPUGenSDFMapBuffer();
 
 		void PosMapSetPSO(IDeviceContext *pContext);
 		void BindPosMapPoints(uint Layer);
 		void BindPoissonPosMap(uint Layer);
-		void BindPosMapRes(IDeviceContext *pContext, IBuffer *pNodeConstBuffer, const PCGNodeData &NodeData, ITexture* pOutTex, std::vector<RefCntAutoPtr<ITexture>> &pSDFDensityTex);
+		void BindPosMapRes(IDeviceContext *pContext, IBuffer *pBatchConstBuffer, IBuffer *pNodeDataBuffer, uint FirstNodeIdx, ITexture* pOutTex, ITexture *pSDFAtlasTex, IBufferView *pSDFPageTable);
 		void BindPosBuffer(IDeviceContext *pContext, IBuffer *pPlantTypeNumberBuffer, IBuffer *pPlantPositionBuffers);
 
 		void InitSDFMapSetPSO(IDeviceContext *pContext);
-		void BindInitSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, ITexture *pInputTex, ITexture *pOutputTex);
-		void InitSDFDispatch(IDeviceContext *pContext, uint MapSize);
+		void BindInitSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, ITexture *pInputTex, ITexture *pOutputTex);
+		void InitSDFDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum);
 
 		void SDFJumpFloodSetPSO(IDeviceContext *pContext);
-		void BindSDFJumpFloodData(IDeviceContext *pContext, const PCGNodeData &NodeData, float2 SampleStep, ITexture *pInputTex, ITexture *pOutputTex, bool reverse);
-		void SDFJumpFloodDispatch(IDeviceContext *pContext, uint MapSize);
+		void BindSDFJumpFloodData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, float2 SampleStep, ITexture *pInputTex, ITexture *pOutputTex, bool reverse);
+		void SDFJumpFloodDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum);
 
 		void GenSDFMapSetPSO(IDeviceContext *pContext);
-		void BindGenSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, ITexture *pOriginalTex, ITexture *pInputTex, ITexture *pOutputTex, bool reverse);
-		void GenSDFMapDispatch(IDeviceContext *pContext, uint MapSize);
+		void BindGenSDFMapData(IDeviceContext *pContext, const PCGNodeData &NodeData, uint FirstMortonCode, ITexture *pOriginalTex, ITexture *pInputTex, ITexture *pOutputAtlasTex, IBufferView *pSDFPageTable, bool reverse);
+		void GenSDFMapDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum);
 
 		void BindTerrainMaskMap(IDeviceContext *pContext, ITexture* pMaskTex, ITexture* pHeightTex);
 
-		void PosMapDispatch(IDeviceContext *pContext, uint MapSize);
+		void PosMapDispatch(IDeviceContext *pContext, uint MapSize, uint NodeNum);
 
 		//void UpdatePosMapData(const PCGNodeData *pPCGNode);
 
@@ -0,0 +1,176 @@
+#include "PCGDensityField.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+#include "RefCntAutoPtr.hpp"
+#include "Image.h"
+#include "TextureUtilities.h"
+
+namespace
+{
+	uint32_t HashBytes(uint32_t Hash, const void *pData, size_t Size)
+	{
+		//FNV-1a
+		const uint8_t *pBytes = reinterpret_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < Size; ++i)
+		{
+			Hash = (Hash ^ pBytes[i]) * 16777619u;
+		}
+		return Hash;
+	}
+}
+
+Diligent::PCGDensityField::PCGDensityField() :
+	mTerrainSize(1.0f, 1.0f, 1.0f),
+	mSlopeStart(35.0f * PI_F / 180.0f),
+	mSlopeEnd(55.0f * PI_F / 180.0f),
+	mHash(0)
+{
+
+}
+
+Diligent::PCGDensityField::~PCGDensityField()
+{
+
+}
+
+void Diligent::PCGDensityField::LoadMaps(const std::string &MaskMapName, const std::string &HeightMapName, const float3 &TerrainSize)
+{
+	LoadGrayMap(MaskMapName, mMaskMap);
+	LoadGrayMap(HeightMapName, mHeightMap);
+
+	mTerrainSize = TerrainSize;
+
+	UpdateHash();
+}
+
+void Diligent::PCGDensityField::SetSlopeRange(const float Start, const float End)
+{
+	mSlopeStart = Start;
+	mSlopeEnd = std::max(End, Start + 1e-4f);
+
+	UpdateHash();
+}
+
+void Diligent::PCGDensityField::UpdateMaskRegion(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize)
+{
+	mMaskMap.Update(Region, pData, Stride, TexelSize);
+
+	UpdateHash();
+}
+
+void Diligent::PCGDensityField::UpdateHeightRegion(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize)
+{
+	mHeightMap.Update(Region, pData, Stride, TexelSize);
+
+	UpdateHash();
+}
+
+float Diligent::PCGDensityField::GetDensity(const float2 &uv) const
+{
+	float Mask = GetMask(uv);
+	if (Mask <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float SlopeFade = clamp((mSlopeEnd - GetSlope(uv)) / (mSlopeEnd - mSlopeStart), 0.0f, 1.0f);
+
+	return Mask * SlopeFade;
+}
+
+float Diligent::PCGDensityField::GetMask(const float2 &uv) const
+{
+	//nearest texel, same as TerrainMaskMap.Load in CalculatePOSMap.csh
+	int x = static_cast<int>(uv.x * mMaskMap.Width);
+	int y = static_cast<int>(uv.y * mMaskMap.Height);
+
+	return mMaskMap.Load(x, y);
+}
+
+float Diligent::PCGDensityField::GetHeight(const float2 &uv) const
+{
+	//nearest texel, same as TerrainHeightMap.Load in CalculatePOSMap.csh
+	int x = static_cast<int>(uv.x * mHeightMap.Width);
+	int y = static_cast<int>(uv.y * mHeightMap.Height);
+
+	return mHeightMap.Load(x, y);
+}
+
+float Diligent::PCGDensityField::GetSlope(const float2 &uv) const
+{
+	int x = static_cast<int>(uv.x * mHeightMap.Width);
+	int y = static_cast<int>(uv.y * mHeightMap.Height);
+
+	//central differences in world units, two texels wide to hide 8-bit height steps
+	const int Step = 2;
+	float dhdx = (mHeightMap.Load(x + Step, y) - mHeightMap.Load(x - Step, y)) * mTerrainSize.y;
+	float dhdz = (mHeightMap.Load(x, y + Step) - mHeightMap.Load(x, y - Step)) * mTerrainSize.y;
+	float dx = 2.0f * Step * mTerrainSize.x / mHeightMap.Width;
+	float dz = 2.0f * Step * mTerrainSize.z / mHeightMap.Height;
+
+	float Gradient = std::sqrt((dhdx / dx) * (dhdx / dx) + (dhdz / dz) * (dhdz / dz));
+
+	return std::atan(Gradient);
+}
+
+float Diligent::PCGDensityField::GrayMap::Load(int x, int y) const
+{
+	x = clamp(x, 0, Width - 1);
+	y = clamp(y, 0, Height - 1);
+
+	return Data[y * Width + x] / 255.0f;
+}
+
+void Diligent::PCGDensityField::GrayMap::Update(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize)
+{
+	const uint32_t MaxX = std::min(Region.MaxX, static_cast<uint32_t>(Width));
+	const uint32_t MaxY = std::min(Region.MaxY, static_cast<uint32_t>(Height));
+
+	const uint8_t *pSrc = reinterpret_cast<const uint8_t*>(pData);
+	for (uint32_t y = Region.MinY; y < MaxY; ++y)
+	{
+		const uint8_t *pRow = pSrc + (y - Region.MinY) * Stride;
+		for (uint32_t x = Region.MinX; x < MaxX; ++x)
+		{
+			Data[y * Width + x] = pRow[(x - Region.MinX) * TexelSize];
+		}
+	}
+}
+
+void Diligent::PCGDensityField::LoadGrayMap(const std::string &FileName, GrayMap &OutMap)
+{
+	RefCntAutoPtr<Image> apImage;
+	CreateImageFromFile(FileName.c_str(), &apImage);
+
+	const ImageDesc &Desc = apImage->GetDesc();
+	assert(Desc.ComponentType == VALUE_TYPE::VT_UINT8);
+
+	OutMap.Width = Desc.Width;
+	OutMap.Height = Desc.Height;
+	OutMap.Data.resize(Desc.Width * Desc.Height);
+
+	//keep the first channel only
+	const uint8_t *pSrc = reinterpret_cast<const uint8_t*>(apImage->GetData()->GetDataPtr());
+	for (uint32_t y = 0; y < Desc.Height; ++y)
+	{
+		for (uint32_t x = 0; x < Desc.Width; ++x)
+		{
+			OutMap.Data[y * Desc.Width + x] = pSrc[y * Desc.RowStride + x * Desc.NumComponents];
+		}
+	}
+}
+
+void Diligent::PCGDensityField::UpdateHash()
+{
+	uint32_t Hash = 2166136261u;
+	Hash = HashBytes(Hash, mMaskMap.Data.data(), mMaskMap.Data.size());
+	Hash = HashBytes(Hash, mHeightMap.Data.data(), mHeightMap.Data.size());
+	Hash = HashBytes(Hash, &mTerrainSize, sizeof(mTerrainSize));
+	Hash = HashBytes(Hash, &mSlopeStart, sizeof(mSlopeStart));
+	Hash = HashBytes(Hash, &mSlopeEnd, sizeof(mSlopeEnd));
+
+	mHash = Hash;
+}
@@ -0,0 +1,66 @@
+#ifndef _PCG_DENSITY_FIELD_H_
+#define _PCG_DENSITY_FIELD_H_
+
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "GraphicsTypes.h"
+
+namespace Diligent
+{
+	//CPU copy of the PCG placement maps used to drive the variable radius poisson sampler.
+	//density = road mask * slope falloff, 0 where nothing may be placed.
+	class PCGDensityField
+	{
+	public:
+		PCGDensityField();
+		~PCGDensityField();
+
+		void LoadMaps(const std::string &MaskMapName, const std::string &HeightMapName, const float3 &TerrainSize);
+
+		//slope angles in radians, density fades from 1 at start to 0 at end
+		void SetSlopeRange(const float Start, const float End);
+
+		//uv in [0, 1] over the whole terrain tile
+		float GetDensity(const float2 &uv) const;
+		float GetMask(const float2 &uv) const;
+		float GetSlope(const float2 &uv) const;
+		//height in [0, 1] of the terrain height range
+		float GetHeight(const float2 &uv) const;
+
+		//Brush edits, the texels uploaded to the GPU maps. The first channel of every TexelSize bytes is kept.
+		//Poisson points are not regenerated, the hash changes so the next start does.
+		void UpdateMaskRegion(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize);
+		void UpdateHeightRegion(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize);
+
+		//content hash of the maps and parameters, keys the poisson point cache
+		uint32_t GetHash() const { return mHash; }
+
+	protected:
+		struct GrayMap
+		{
+			int Width = 0;
+			int Height = 0;
+			std::vector<uint8_t> Data;
+
+			float Load(int x, int y) const;
+			void Update(const Box &Region, const void *pData, uint32_t Stride, uint32_t TexelSize);
+		};
+
+		static void LoadGrayMap(const std::string &FileName, GrayMap &OutMap);
+		void UpdateHash();
+
+	private:
+		GrayMap mMaskMap;
+		GrayMap mHeightMap;
+
+		float3 mTerrainSize;
+		float mSlopeStart;
+		float mSlopeEnd;
+
+		uint32_t mHash;
+	};
+}
+
+#endif
@@ -25,25 +25,46 @@ void Diligent::PCGLayer::SetupPlantParam()
 		PlantParam pt;
 
 		pt.size = PCG_TEX_DEFAULT_SIZE >> i;
+		pt.weight = 1.0f;
 
 		switch (i)
 		{
 		case F_LARGE_TREE_LAYER:
 			pt.footprint = 13.0f;
+			pt.spacing = 50.0f;
+			pt.exclusion = 30.0f;
+			pt.weight = 0.7f;
+			mLayer[i].push_back(pt);
+
+			//sparser second tree species sharing the layer
+			pt.spacing = 70.0f;
+			pt.exclusion = 30.0f;
+			pt.weight = 0.3f;
+			mLayer[i].push_back(pt);
 			break;
 
 		case F_MEDIUM_TREE_LAYER:
 			pt.footprint = 7.0f;
+			pt.spacing = 30.0f;
+			pt.exclusion = 20.0f;
+			pt.weight = 0.6f;
+			mLayer[i].push_back(pt);
+
+			pt.spacing = 24.0f;
+			pt.exclusion = 16.0f;
+			pt.weight = 0.4f;
+			mLayer[i].push_back(pt);
 			break;
 
 		case F_GRASS_LAYER:
 			pt.footprint = 3.0f;
+			pt.spacing = 10.0f;
+			pt.exclusion = 6.0f;
+			mLayer[i].push_back(pt);
 			break;
 
 		default:
 			break;
 		}
-
-		mLayer[i].push_back(pt);
 	}
 }
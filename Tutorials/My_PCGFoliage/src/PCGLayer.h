@@ -16,9 +16,19 @@ namespace Diligent
 		F_LAYER_NUM
 	};
 
+	//texels of a whole layer per axis, the node texture halves when the node count per axis doubles
+	static const int PCG_LAYER_TEX_SIZE = PCG_TEX_DEFAULT_SIZE * 2;
+
+	//SDF results are paged with the node size of the last layer
+	static const int PCG_SDF_PAGE_SIZE = PCG_TEX_DEFAULT_SIZE >> (F_LAYER_NUM - 1);
+	static const int PCG_SDF_PAGES_PER_AXIS = PCG_LAYER_TEX_SIZE / PCG_SDF_PAGE_SIZE;
+
 	struct PlantParam
 	{
 		float footprint;
+		float spacing; //poisson disk radius in texels of the layer map
+		float exclusion; //min distance to the other plant types of the layer, in texels
+		float weight; //share of the layer taken by this plant type
 		int size;
 	};
 
@@ -28,7 +28,7 @@ namespace Diligent
 		float PlantPlaceThreshold;
 
 		float2 TexSampOffsetInParent;		
-		float2 Padding;
+		float2 NodeTexOffset; //node origin in texels of the whole layer
 
 		PCGNodeData()
 		{
@@ -47,6 +47,7 @@ namespace Diligent
 			PCGPointGSize = 0.0f;
 
 			TexSampOffsetInParent = float2(0.0f);
+			NodeTexOffset = float2(0.0f);
 			PlantPlaceThreshold = 0.1f;
 		}		
 	};
@@ -1,30 +1,42 @@
 #include "PCGPoint.h"
+#include "PCGDensityField.h"
 #include "PoissonDisk/PoissonDiskSampling.h"
+#include "PoissonDisk/TiledPoissonDisk.h"
+#include "PoissonDisk/VariablePoissonDisk.h"
+#include "HashUtils.hpp"
+#include "Errors.hpp"
 
+#include <chrono>
 #include <fstream>
 
+namespace
+{
+	//bump when the generator output changes, old cache files are then regenerated
+	const uint32_t POISSON_CACHE_MAGIC = 0x50445343; //"PDSC"
+	const uint32_t POISSON_CACHE_VERSION = 2;
+
+	struct PoissonCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		int32_t DomainSize;
+		uint32_t PointNum;
+		uint32_t CandidateNum;
+		uint32_t HasTypes;
+	};
+}
 
 //Diligent::PCGPoint::PCGPoint(float radius, float2 min_c, float2 max_c, std::uint32_t seed /*= 0*/)
 //{
 //	GeneratePoints(radius, min_c, max_c, seed);
 //}
 
-Diligent::PCGPoint::PCGPoint()
-{
-
-}
-
-void Diligent::PCGPoint::ReadPoints(const uint Layer)
+Diligent::PCGPoint::PCGPoint() :
+	mDomainSize(0),
+	mCandidateNum(0)
 {
-	char DatName[128];
-	sprintf(DatName, "./PoissonLayer%d.dat", Layer);
 
-	std::ifstream rf(DatName, std::ios::out | std::ios::binary);
-	int pointNum;
-	rf.read((char*)&pointNum, sizeof(int));
-	mPoints.resize(pointNum);
-	rf.read((char*)&mPoints[0][0], sizeof(float) * 2 * pointNum);
-	rf.close();
 }
 
 Diligent::PCGPoint::~PCGPoint()
@@ -37,5 +49,164 @@ void Diligent::PCGPoint::GeneratePoints(float radius, float2 min_c, float2 max_c
 	auto kXMin = std::array<float, 2>{ {min_c.x, min_c.y} };
 	auto kXMax = std::array<float, 2>{ {max_c.x, max_c.y} };
 
-	mPoints = thinks::PoissonDiskSampling(radius, kXMin, kXMax);
+	mPoints = thinks::PoissonDiskSampling(radius, kXMin, kXMax, 30, seed);
+	mTypes.clear();
+	mDomainSize = static_cast<int>(max_c.x);
+	mCandidateNum = static_cast<uint32_t>(mPoints.size());
+}
+
+void Diligent::PCGPoint::GenerateTiledPoints(const uint Layer, float radius, int tile_size, std::uint32_t seed)
+{
+	std::size_t Key = ComputeHash(0, radius, tile_size, seed);
+	std::string CacheName = GetCacheName(Layer, Key);
+	if (ReadCache(CacheName, Key))
+	{
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	TiledPoissonDiskDesc Desc;
+	Desc.Radius = radius;
+	Desc.TileSize = static_cast<float>(tile_size);
+	Desc.Seed = seed;
+	mPoints = TiledPoissonDiskSampling(Desc);
+	mTypes.clear();
+	mDomainSize = tile_size;
+	mCandidateNum = Desc.MaxSampleAttempts * static_cast<uint32_t>(mPoints.size());
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	LOG_INFO_MESSAGE("Poisson layer ", Layer, ": ", mPoints.size(), " tiled points generated in ", elapsed.count(), " ms");
+
+	WriteCache(CacheName, Key);
+}
+
+void Diligent::PCGPoint::GenerateDensityPoints(const uint Layer, const std::vector<PlantParam> &Plants, int domain_size, std::uint32_t seed, const PCGDensityField &Field)
+{
+	std::size_t Key = ComputeHash(1, domain_size, seed, Field.GetHash());
+	for (const PlantParam &Plant : Plants)
+	{
+		HashCombine(Key, Plant.spacing, Plant.exclusion, Plant.weight);
+	}
+
+	std::string CacheName = GetCacheName(Layer, Key);
+	if (ReadCache(CacheName, Key))
+	{
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VariablePoissonDiskDesc Desc;
+	Desc.DomainSize = static_cast<float>(domain_size);
+	Desc.Seed = seed;
+	for (const PlantParam &Plant : Plants)
+	{
+		PoissonPlantType Type;
+		Type.Radius = Plant.spacing;
+		Type.Exclusion = Plant.exclusion;
+		Type.Weight = Plant.weight;
+		Desc.Types.push_back(Type);
+	}
+	const float InvDomainSize = 1.0f / domain_size;
+	Desc.Density = [&](float x, float y)
+	{
+		return Field.GetDensity(float2(x, y) * InvDomainSize);
+	};
+
+	VariablePoissonStats Stats;
+	std::vector<VariablePoissonPoint> Points = VariablePoissonDiskSampling(Desc, &Stats);
+
+	mPoints.resize(Points.size());
+	mTypes.resize(Points.size());
+	for (size_t i = 0; i < Points.size(); ++i)
+	{
+		mPoints[i] = Points[i].Pos;
+		mTypes[i] = static_cast<uint8_t>(Points[i].Type);
+	}
+	mDomainSize = domain_size;
+	mCandidateNum = Stats.CandidateNum;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	LOG_INFO_MESSAGE("Poisson layer ", Layer, ": ", mPoints.size(), " density driven points from ", Stats.CandidateNum, " candidates (",
+		Stats.RejectedByDensity, " unplaceable, ", Stats.RejectedByDistance, " too close) generated in ", elapsed.count(), " ms");
+
+	WriteCache(CacheName, Key);
+}
+
+std::string Diligent::PCGPoint::GetCacheName(const uint Layer, std::uint64_t Key)
+{
+	char CacheName[128];
+	snprintf(CacheName, sizeof(CacheName), "./PoissonLayer%u_%016llx.cache", Layer, static_cast<unsigned long long>(Key));
+
+	return CacheName;
+}
+
+bool Diligent::PCGPoint::ReadCache(const std::string &CacheName, std::uint64_t Key)
+{
+	std::ifstream rf(CacheName, std::ios::in | std::ios::binary);
+	if (!rf)
+	{
+		return false;
+	}
+
+	PoissonCacheHeader Header;
+	rf.read((char*)&Header, sizeof(PoissonCacheHeader));
+	if (!rf ||
+		Header.Magic != POISSON_CACHE_MAGIC ||
+		Header.Version != POISSON_CACHE_VERSION ||
+		Header.Key != Key)
+	{
+		return false;
+	}
+
+	std::vector<std::array<float, 2>> Points(Header.PointNum);
+	std::vector<uint8_t> Types(Header.HasTypes ? Header.PointNum : 0);
+	if (Header.PointNum > 0)
+	{
+		rf.read((char*)&Points[0][0], sizeof(float) * 2 * Header.PointNum);
+		if (Header.HasTypes)
+		{
+			rf.read((char*)&Types[0], sizeof(uint8_t) * Header.PointNum);
+		}
+	}
+	if (!rf)
+	{
+		return false;
+	}
+
+	mPoints.swap(Points);
+	mTypes.swap(Types);
+	mDomainSize = Header.DomainSize;
+	mCandidateNum = Header.CandidateNum;
+	return true;
+}
+
+void Diligent::PCGPoint::WriteCache(const std::string &CacheName, std::uint64_t Key) const
+{
+	std::ofstream wf(CacheName, std::ios::out | std::ios::binary);
+	if (!wf)
+	{
+		LOG_WARNING_MESSAGE("Failed to write poisson cache ", CacheName);
+		return;
+	}
+
+	PoissonCacheHeader Header;
+	Header.Magic = POISSON_CACHE_MAGIC;
+	Header.Version = POISSON_CACHE_VERSION;
+	Header.Key = Key;
+	Header.DomainSize = mDomainSize;
+	Header.PointNum = static_cast<uint32_t>(mPoints.size());
+	Header.CandidateNum = mCandidateNum;
+	Header.HasTypes = mTypes.empty() ? 0 : 1;
+
+	wf.write((const char*)&Header, sizeof(PoissonCacheHeader));
+	if (!mPoints.empty())
+	{
+		wf.write((const char*)&mPoints[0][0], sizeof(float) * 2 * mPoints.size());
+		if (!mTypes.empty())
+		{
+			wf.write((const char*)&mTypes[0], sizeof(uint8_t) * mTypes.size());
+		}
+	}
 }
@@ -3,32 +3,61 @@
 
 #include <cstdint>
 #include <array>
+#include <string>
 #include <vector>
 
 #include "BasicMath.hpp"
+#include "PCGLayer.h"
 
 namespace Diligent
 {
+	class PCGDensityField;
+
 	class PCGPoint
 	{
 	public:
 		PCGPoint();
 		//PCGPoint(float radius, float2 min_c, float2 max_c, std::uint32_t seed = 0);
-		void ReadPoints(const uint Layer);
 
 		~PCGPoint();
 
 		void GeneratePoints(float radius, float2 min_c, float2 max_c, std::uint32_t seed);
 
+		//Tileable poisson points of a layer map, read from the on-disk cache when the
+		//parameters match, otherwise generated and written back to the cache.
+		void GenerateTiledPoints(const uint Layer, float radius, int tile_size, std::uint32_t seed);
+
+		//Variable radius poisson points of a whole layer (all nodes), only where the density
+		//field allows placement, one plant type per point. Cached like the tiled points.
+		void GenerateDensityPoints(const uint Layer, const std::vector<PlantParam> &Plants, int domain_size, std::uint32_t seed, const PCGDensityField &Field);
+
 		size_t GetNum() const { return mPoints.size(); }
 
 		const float *GetData() const { return &mPoints[0][0]; }
 
-		
+		const std::vector<std::array<float, 2>> &GetPoints() const { return mPoints; }
+
+		//plant type inside the layer per point, empty for tiled points (all type 0)
+		const std::vector<uint8_t> &GetTypes() const { return mTypes; }
+
+		//size of the square the points cover, tiled points repeat with this period
+		int GetDomainSize() const { return mDomainSize; }
+
+		//darts thrown to get the points, includes the ones rejected by density and distance
+		uint32_t GetCandidateNum() const { return mCandidateNum; }
+
+	protected:
+		static std::string GetCacheName(const uint Layer, std::uint64_t Key);
+
+		bool ReadCache(const std::string &CacheName, std::uint64_t Key);
+		void WriteCache(const std::string &CacheName, std::uint64_t Key) const;
 
 	private:
 		std::vector<std::array<float, 2>> mPoints;
+		std::vector<uint8_t> mTypes;
+		int mDomainSize;
+		uint32_t mCandidateNum;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -6,11 +6,20 @@
 #include "TextureLoader.h"
 #include "TextureUtilities.h"
 #include "MapHelper.hpp"
+#include "GraphicsAccessories.hpp"
+#include "Errors.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 Diligent::PCGSystem::PCGSystem(IDeviceContext *pContext, IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory, const Dimension &TerrainDim) :
 	m_pContext(pContext),
 	m_pRenderDevice(pDevice),
 	mSeed(0),
+	mDensityDrivenPoints(true),
+	mAddedPlants(F_LAYER_NUM),
+	mAddedPlantSeed(0),
 	mTerrainDim(TerrainDim),
 	mPCGCSCall(pDevice, pShaderFactory)
 {
@@ -29,7 +38,7 @@ void Diligent::PCGSystem::Init()
 	float3 tile_size = mTerrainDim.Size;
 	mTerrainTile = new PCGTerrainTile(m_pContext, m_pRenderDevice, tile_min, tile_size);
 
-	//CreatePoissonDiskSamplerData();	
+	CreatePoissonDiskSamplerData();
 }
 
 void Diligent::PCGSystem::CreatePoissonDiskSamplerData()
@@ -37,22 +46,28 @@ void Diligent::PCGSystem::CreatePoissonDiskSamplerData()
 	mPointVec.resize(F_LAYER_NUM);
 	const PlantParamLayer &PlantLayer = mPlantLayer.GetPlantParamLayer();
 
+	//also the CPU copy of the maps for brush edits
+	mDensityField.LoadMaps("./PCGRoadMask.png", "./wm_heightmap.png", mTerrainDim.Size);
+
 	for (int i = 0; i < F_LAYER_NUM; ++i)
 	{
 		const PlantParam &param = PlantLayer[i][0];
 
-		std::vector<std::array<float, 2>> RetPoints;
-		float kRadius = param.footprint;
-		float2 kXMin = float2(0.F + kRadius, 0.F + kRadius); //avoid overlap
-		float2 kXMax = float2(param.size - kRadius, param.size - kRadius); //avoid overlap
-
-		//RetPoints = thinks::PoissonDiskSampling(kRadius, kXMin, kXMax);
-		//mPointVec[i].GeneratePoints(kRadius, kXMin, kXMax, mSeed);
-		mPointVec[i].ReadPoints(i);
+		if (mDensityDrivenPoints)
+		{
+			//one point set over all nodes of the layer, nothing is generated on roads and cliffs
+			int domain_size = (2 << i) * param.size;
+			mPointVec[i].GenerateDensityPoints(i, PlantLayer[i], domain_size, mSeed, mDensityField);
+		}
+		else
+		{
+			//every node of a layer samples the same poisson map, so it has to tile without seams
+			mPointVec[i].GenerateTiledPoints(i, param.spacing, param.size, mSeed);
+		}
 	}
 
-	//To device buffer
-	mPCGCSCall.CreateGlobalPointBuffer(mPointVec);
+	//To device texture
+	mPCGCSCall.CreateGlobalPointTextureuBuffer(mPointVec, PlantLayer);
 }
 
 void Diligent::PCGSystem::DoProcedural()
@@ -62,6 +77,39 @@ void Diligent::PCGSystem::DoProcedural()
 	mTerrainTile->GeneratePosMap(&mPCGCSCall);
 
 	//mTerrainTile->GenerateSDFMap(&mPCGCSCall);
+
+	const PCGDispatchStats &Stats = mTerrainTile->GetDispatchStats();
+	LOG_INFO_MESSAGE("PCG ", mTerrainTile->IsBatchedDispatch() ? "batched" : "per node", " dispatch: ", Stats.DispatchNum, " dispatches, CPU submit ",
+		Stats.CPUSubmitTime, " ms, GPU ", Stats.GPUTime, " ms");
+
+	LogPlacementEfficiency();
+}
+
+void Diligent::PCGSystem::ProfileDispatchModes()
+{
+	mTerrainTile->SetBatchedDispatch(false);
+	DoProcedural();
+
+	mTerrainTile->SetBatchedDispatch(true);
+	DoProcedural();
+}
+
+void Diligent::PCGSystem::LogPlacementEfficiency()
+{
+	PCGResultData ResultData = mTerrainTile->GetPCGResultData();
+	const PlantParamLayer &PlantLayer = mPlantLayer.GetPlantParamLayer();
+
+	for (int i = 0; i < F_LAYER_NUM; ++i)
+	{
+		//tiled points repeat in every node of the layer
+		const int domain_size = (2 << i) * PlantLayer[i][0].size;
+		const size_t repeat_num = static_cast<size_t>(domain_size / mPointVec[i].GetDomainSize());
+		const size_t generated_num = mPointVec[i].GetNum() * repeat_num * repeat_num;
+		const uint32_t placed_num = ResultData.PlantTypeNumHostData[i];
+
+		LOG_INFO_MESSAGE("PCG layer ", i, ": ", generated_num, " points generated (", mPointVec[i].GetCandidateNum(), " candidates), ",
+			placed_num, " placed, efficiency ", generated_num > 0 ? 100.0 * placed_num / generated_num : 0.0, "%");
+	}
 }
 
 Diligent::PCGResultData Diligent::PCGSystem::GetPCGResultData()
@@ -69,29 +117,293 @@ Diligent::PCGResultData Diligent::PCGSystem::GetPCGResultData()
 	return mTerrainTile->GetPCGResultData();
 }
 
-void Diligent::PCGTerrainTile::CreateSpecificPCGTexture(const uint32_t Layer, const uint32_t LinearQuadIndex)
+void Diligent::PCGSystem::UpdateTerrainMaskRegion(const Box &Region, const void *pData, uint32_t Stride)
+{
+	mTerrainTile->UpdateTerrainMaskRegion(Region, pData, Stride);
+
+	const TextureFormatAttribs &FmtAttribs = GetTextureFormatAttribs(mTerrainTile->GetTerrainMaskDesc().Format);
+	mDensityField.UpdateMaskRegion(Region, pData, Stride, FmtAttribs.ComponentSize * FmtAttribs.NumComponents);
+
+	UpdateAddedPlants();
+}
+
+void Diligent::PCGSystem::UpdateTerrainHeightRegion(const Box &Region, const void *pData, uint32_t Stride)
+{
+	mTerrainTile->UpdateTerrainHeightRegion(Region, pData, Stride);
+
+	const TextureFormatAttribs &FmtAttribs = GetTextureFormatAttribs(mTerrainTile->GetTerrainHeightDesc().Format);
+	mDensityField.UpdateHeightRegion(Region, pData, Stride, FmtAttribs.ComponentSize * FmtAttribs.NumComponents);
+
+	UpdateAddedPlants();
+}
+
+void Diligent::PCGSystem::RegenerateRegion(const float2 &DirtyMinUV, const float2 &DirtyMaxUV)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	mTerrainTile->RegenerateRegion(&mPCGCSCall, DirtyMinUV, DirtyMaxUV);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	const PCGDispatchStats &Stats = mTerrainTile->GetDispatchStats();
+	LOG_INFO_MESSAGE("PCG region update: ", Stats.DispatchNum, " dispatches, GPU ", Stats.GPUTime, " ms, total ", elapsed.count(), " ms");
+}
+
+void Diligent::PCGSystem::PaintTerrainMask(const float2 &CenterUV, const float RadiusUV, const float Value)
+{
+	const TextureDesc &MaskDesc = mTerrainTile->GetTerrainMaskDesc();
+	const TextureFormatAttribs &FmtAttribs = GetTextureFormatAttribs(MaskDesc.Format);
+	if (FmtAttribs.ComponentType != COMPONENT_TYPE_UNORM || FmtAttribs.ComponentSize != 1)
+	{
+		LOG_ERROR_MESSAGE("PCG mask brush: unsupported mask format ", FmtAttribs.Name);
+		return;
+	}
+
+	const float2 MinUV = float2(std::max(CenterUV.x - RadiusUV, 0.0f), std::max(CenterUV.y - RadiusUV, 0.0f));
+	const float2 MaxUV = float2(std::min(CenterUV.x + RadiusUV, 1.0f), std::min(CenterUV.y + RadiusUV, 1.0f));
+
+	Box Region;
+	Region.MinX = static_cast<uint32_t>(MinUV.x * MaskDesc.Width);
+	Region.MinY = static_cast<uint32_t>(MinUV.y * MaskDesc.Height);
+	Region.MaxX = std::min(static_cast<uint32_t>(std::ceil(MaxUV.x * MaskDesc.Width)), MaskDesc.Width);
+	Region.MaxY = std::min(static_cast<uint32_t>(std::ceil(MaxUV.y * MaskDesc.Height)), MaskDesc.Height);
+	if (Region.MinX >= Region.MaxX || Region.MinY >= Region.MaxY)
+	{
+		return;
+	}
+
+	//texels outside the circle keep the CPU copy of the mask in every channel
+	const uint32_t TexelSize = FmtAttribs.NumComponents;
+	const uint32_t Stride = (Region.MaxX - Region.MinX) * TexelSize;
+	const uint8_t BrushValue = static_cast<uint8_t>(clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	std::vector<uint8_t> Texels(Stride * (Region.MaxY - Region.MinY));
+	for (uint32_t y = Region.MinY; y < Region.MaxY; ++y)
+	{
+		for (uint32_t x = Region.MinX; x < Region.MaxX; ++x)
+		{
+			const float2 uv = float2((x + 0.5f) / MaskDesc.Width, (y + 0.5f) / MaskDesc.Height);
+			const float2 d = uv - CenterUV;
+			uint8_t TexelValue = BrushValue;
+			if (dot(d, d) > RadiusUV * RadiusUV)
+			{
+				TexelValue = static_cast<uint8_t>(mDensityField.GetMask(uv) * 255.0f + 0.5f);
+			}
+
+			uint8_t *pTexel = &Texels[(y - Region.MinY) * Stride + (x - Region.MinX) * TexelSize];
+			memset(pTexel, TexelValue, TexelSize);
+		}
+	}
+
+	UpdateTerrainMaskRegion(Region, &Texels[0], Stride);
+	RegenerateRegion(MinUV, MaxUV);
+}
+
+uint32_t Diligent::PCGSystem::AddPlants(uint32_t Layer, uint32_t PlantType, const float2 &CenterUV, const float RadiusUV, const uint32_t Num)
 {
+	const PlantParamLayer &PlantLayer = mPlantLayer.GetPlantParamLayer();
+	if (Layer >= F_LAYER_NUM || PlantType >= PlantLayer[Layer].size())
+	{
+		LOG_ERROR_MESSAGE("PCG add plants: no plant type ", PlantType, " on layer ", Layer);
+		return 0;
+	}
+
+	//spacing is in texels of the layer map, which covers the tile, so plants are compared in uv
+	const float2 TileSizeXZ = float2(mTerrainDim.Size.x, mTerrainDim.Size.z);
+	const float Spacing = PlantLayer[Layer][PlantType].spacing / PCG_LAYER_TEX_SIZE;
+	auto ToUV = [&](const float4 &Plant)
+	{
+		return (float2(Plant.x, Plant.z) - float2(mTerrainDim.Min.x, mTerrainDim.Min.z)) / TileSizeXZ;
+	};
+	auto IsFree = [&](const float2 &uv, const float4 *pPlants, size_t PlantNum)
+	{
+		for (size_t p = 0; p < PlantNum; ++p)
+		{
+			const float2 d = ToUV(pPlants[p]) - uv;
+			if (dot(d, d) < Spacing * Spacing)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	//plants of the layer, generated and added by earlier edits, when the PCG has run
+	PCGResultData ResultData = mTerrainTile->GetPCGResultData();
+	const float4 *pLayerPlants = ResultData.PlantTypeNumHostData ? ResultData.PlantPositionHostDatas[Layer].get() : nullptr;
+	const size_t LayerPlantNum = pLayerPlants ? ResultData.PlantTypeNumHostData[Layer] : 0;
+
+	//dart throwing, a few tries per requested plant
+	std::mt19937 Rand(mSeed + mAddedPlantSeed++);
+	std::uniform_real_distribution<float> Dist(-1.0f, 1.0f);
+	std::vector<float4> &AddedPlants = mAddedPlants[Layer];
+	const size_t FirstAdded = AddedPlants.size();
+	for (uint32_t Try = 0; Try < Num * 8 && AddedPlants.size() - FirstAdded < Num; ++Try)
+	{
+		const float2 Offset = float2(Dist(Rand), Dist(Rand));
+		if (dot(Offset, Offset) > 1.0f)
+		{
+			continue;
+		}
+
+		const float2 uv = CenterUV + Offset * RadiusUV;
+		if (uv.x < 0.0f || uv.y < 0.0f || uv.x >= 1.0f || uv.y >= 1.0f || mDensityField.GetDensity(uv) <= 0.0f)
+		{
+			continue;
+		}
+
+		//the plants of this edit are not in the tile's host data yet
+		if (!IsFree(uv, pLayerPlants, LayerPlantNum) || !IsFree(uv, AddedPlants.empty() ? nullptr : &AddedPlants[0], AddedPlants.size()))
+		{
+			continue;
+		}
+
+		const float2 xz = float2(mTerrainDim.Min.x, mTerrainDim.Min.z) + uv * TileSizeXZ;
+		const float y = mTerrainDim.Min.y + mTerrainDim.Size.y * mDensityField.GetHeight(uv);
+		AddedPlants.push_back(float4(xz.x, y, xz.y, static_cast<float>(PlantType)));
+	}
+
+	const uint32_t AddedNum = static_cast<uint32_t>(AddedPlants.size() - FirstAdded);
+	mTerrainTile->SetAddedPlants(mAddedPlants);
+
+	LOG_INFO_MESSAGE("PCG add plants: ", AddedNum, " of ", Num, " plants of type ", PlantType, " added on layer ", Layer);
+
+	return AddedNum;
+}
+
+void Diligent::PCGSystem::UpdateAddedPlants()
+{
+	for (std::vector<float4> &AddedPlants : mAddedPlants)
+	{
+		size_t KeptNum = 0;
+		for (const float4 &Plant : AddedPlants)
+		{
+			const float2 uv = (float2(Plant.x, Plant.z) - float2(mTerrainDim.Min.x, mTerrainDim.Min.z)) / float2(mTerrainDim.Size.x, mTerrainDim.Size.z);
+			if (mDensityField.GetDensity(uv) > 0.0f)
+			{
+				AddedPlants[KeptNum] = Plant;
+				AddedPlants[KeptNum].y = mTerrainDim.Min.y + mTerrainDim.Size.y * mDensityField.GetHeight(uv);
+				++KeptNum;
+			}
+		}
+		AddedPlants.resize(KeptNum);
+	}
+
+	mTerrainTile->SetAddedPlants(mAddedPlants);
+}
+
+void Diligent::PCGTerrainTile::CreatePCGTextures(const std::vector<PCGPoint> &PointVec)
+{
+	//transient maps of one layer, nodes at their morton position in the layer grid
 	TextureDesc DensityTexType;
+	DensityTexType.Name = "PCG density map";
 	DensityTexType.Type = RESOURCE_DIM_TEX_2D;
-	DensityTexType.Width = PCG_TEX_DEFAULT_SIZE >> Layer;
+	DensityTexType.Width = PCG_LAYER_TEX_SIZE;
 	DensityTexType.Height = DensityTexType.Width;
 	DensityTexType.MipLevels = 1;
 	DensityTexType.Format = TEX_FORMAT_R8_UNORM;
-	DensityTexType.Usage = USAGE_DYNAMIC;
+	DensityTexType.Usage = USAGE_DEFAULT;
 	DensityTexType.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-	m_pRenderDevice->CreateTexture(DensityTexType, nullptr, &mGPUDensityTexArray[LinearQuadIndex]);
-	m_pRenderDevice->CreateTexture(DensityTexType, nullptr, &mGPUSDFResultTexArray[LinearQuadIndex]);
+	m_pRenderDevice->CreateTexture(DensityTexType, nullptr, &mGPUDensityTex);
 
+	//xy - nearest empty texel, zw - nearest plant, node local texel coordinates
 	TextureDesc SDFTexType;
+	SDFTexType.Name = "PCG sdf seed map";
 	SDFTexType.Type = RESOURCE_DIM_TEX_2D;
-	SDFTexType.Width = PCG_TEX_DEFAULT_SIZE >> Layer;
+	SDFTexType.Width = PCG_LAYER_TEX_SIZE;
 	SDFTexType.Height = SDFTexType.Width;
 	SDFTexType.MipLevels = 1;
-	SDFTexType.Format = TEX_FORMAT_RGBA32_FLOAT;
-	SDFTexType.Usage = USAGE_DYNAMIC;
+	SDFTexType.Format = TEX_FORMAT_RGBA16_UINT;
+	SDFTexType.Usage = USAGE_DEFAULT;
 	SDFTexType.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-	m_pRenderDevice->CreateTexture(SDFTexType, nullptr, &mGPUSDFTexArrayPing[LinearQuadIndex]);
-	m_pRenderDevice->CreateTexture(SDFTexType, nullptr, &mGPUSDFTexArrayPong[LinearQuadIndex]);
+	m_pRenderDevice->CreateTexture(SDFTexType, nullptr, &mGPUSDFSeedTexPing);
+	m_pRenderDevice->CreateTexture(SDFTexType, nullptr, &mGPUSDFSeedTexPong);
+
+	//The last layer's sdf is never read and a node without poisson points can't hold plants,
+	//its sdf is 0 everywhere, so neither gets pages.
+	const uint32_t PageTableSize = F_LAYER_NUM * PCG_SDF_PAGES_PER_AXIS * PCG_SDF_PAGES_PER_AXIS;
+	std::vector<uint32_t> PageTable(PageTableSize, 0xFFFFFFFFu);
+	mSDFPageNum = 0;
+
+	for (uint32_t i = 0; i + 1 < F_LAYER_NUM; ++i)
+	{
+		const uint32_t NodeNumPerAxis = 2u << i;
+		const uint32_t TexSize = PCG_TEX_DEFAULT_SIZE >> i;
+		const uint32_t NodePageNum = TexSize / PCG_SDF_PAGE_SIZE;
+
+		std::vector<uint8_t> LiveNodes(NodeNumPerAxis * NodeNumPerAxis, 0);
+		const int DomainSize = PointVec[i].GetDomainSize();
+		const int RepeatNum = DomainSize > 0 ? PCG_LAYER_TEX_SIZE / DomainSize : 0;
+		for (const std::array<float, 2> &Point : PointVec[i].GetPoints())
+		{
+			for (int ry = 0; ry < RepeatNum; ++ry)
+			{
+				for (int rx = 0; rx < RepeatNum; ++rx)
+				{
+					uint32_t x = static_cast<uint32_t>(Point[0] + rx * DomainSize) / TexSize;
+					uint32_t y = static_cast<uint32_t>(Point[1] + ry * DomainSize) / TexSize;
+					LiveNodes[y * NodeNumPerAxis + x] = 1;
+				}
+			}
+		}
+
+		for (uint32_t y = 0; y < NodeNumPerAxis; ++y)
+		{
+			for (uint32_t x = 0; x < NodeNumPerAxis; ++x)
+			{
+				if (!LiveNodes[y * NodeNumPerAxis + x])
+				{
+					continue;
+				}
+
+				for (uint32_t py = y * NodePageNum; py < (y + 1) * NodePageNum; ++py)
+				{
+					for (uint32_t px = x * NodePageNum; px < (x + 1) * NodePageNum; ++px)
+					{
+						PageTable[(i * PCG_SDF_PAGES_PER_AXIS + py) * PCG_SDF_PAGES_PER_AXIS + px] = mSDFPageNum++;
+					}
+				}
+			}
+		}
+	}
+
+	TextureDesc AtlasTexType;
+	AtlasTexType.Name = "PCG sdf atlas";
+	AtlasTexType.Type = RESOURCE_DIM_TEX_2D_ARRAY;
+	AtlasTexType.Width = PCG_SDF_PAGE_SIZE;
+	AtlasTexType.Height = AtlasTexType.Width;
+	AtlasTexType.ArraySize = std::max(mSDFPageNum, 1u);
+	AtlasTexType.MipLevels = 1;
+	AtlasTexType.Format = TEX_FORMAT_R8_UNORM;
+	AtlasTexType.Usage = USAGE_DEFAULT;
+	AtlasTexType.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+	m_pRenderDevice->CreateTexture(AtlasTexType, nullptr, &mGPUSDFAtlasTex);
+
+	BufferDesc PageTableBuffDesc;
+	PageTableBuffDesc.Name = "PCG sdf page table";
+	PageTableBuffDesc.Usage = USAGE_IMMUTABLE;
+	PageTableBuffDesc.BindFlags = BIND_SHADER_RESOURCE;
+	PageTableBuffDesc.Mode = BUFFER_MODE_FORMATTED;
+	PageTableBuffDesc.ElementByteStride = sizeof(uint32_t);
+	PageTableBuffDesc.uiSizeInBytes = sizeof(uint32_t) * PageTableSize;
+
+	BufferData PageTableData;
+	PageTableData.pData = &PageTable[0];
+	PageTableData.DataSize = PageTableBuffDesc.uiSizeInBytes;
+	m_pRenderDevice->CreateBuffer(PageTableBuffDesc, &PageTableData, &mGPUSDFPageTableBuffer);
+
+	BufferViewDesc PageTableViewDesc;
+	PageTableViewDesc.ViewType = BUFFER_VIEW_SHADER_RESOURCE;
+	PageTableViewDesc.Format.ValueType = VT_UINT32;
+	PageTableViewDesc.Format.NumComponents = 1;
+	mGPUSDFPageTableBuffer->CreateView(PageTableViewDesc, &mGPUSDFPageTableView);
+
+	//per node R8 density + R8 sdf + two RGBA32F ping/pong for every node of every layer before
+	const double MB = 1024.0 * 1024.0;
+	const double LayerTexelNum = static_cast<double>(PCG_LAYER_TEX_SIZE) * PCG_LAYER_TEX_SIZE;
+	double PerNodeSize = F_LAYER_NUM * LayerTexelNum * (1 + 1 + 16 + 16);
+	double CurrSize = LayerTexelNum * (1 + 8 + 8) + static_cast<double>(AtlasTexType.ArraySize) * PCG_SDF_PAGE_SIZE * PCG_SDF_PAGE_SIZE;
+	const uint32_t MaxSDFPageNum = (F_LAYER_NUM - 1) * PCG_SDF_PAGES_PER_AXIS * PCG_SDF_PAGES_PER_AXIS;
+	LOG_INFO_MESSAGE("PCG node textures: ", CurrSize / MB, " MB (", mSDFPageNum, " of ", MaxSDFPageNum, " sdf pages), per node textures would take ",
+		PerNodeSize / MB, " MB");
 }
 
 void Diligent::PCGTerrainTile::CreatePCGNodeDataBuffer(const std::vector<PCGNodeData> &PCGNodeDataVec)
@@ -115,12 +427,26 @@ void Diligent::PCGTerrainTile::CreatePCGNodeDataBuffer(const std::vector<PCGNode
 	}*/
 
 	BufferDesc BuffDesc;
-	BuffDesc.Name = "PCG Node Data buffer";
+	BuffDesc.Name = "PCG Batch Data buffer";
 	BuffDesc.Usage = USAGE_DYNAMIC;
 	BuffDesc.BindFlags = BIND_UNIFORM_BUFFER;
 	BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-	BuffDesc.uiSizeInBytes = sizeof(PCGNodeData);
-	m_pRenderDevice->CreateBuffer(BuffDesc, nullptr, &mPCGGPUNodeConstBuffer);
+	BuffDesc.uiSizeInBytes = sizeof(PCGBatchData);
+	m_pRenderDevice->CreateBuffer(BuffDesc, nullptr, &mPCGGPUBatchConstBuffer);
+
+	//node constants of every dispatch are read from here by SV_GroupID.z
+	BufferDesc NodeBuffDesc;
+	NodeBuffDesc.Name = "PCG Node Data buffer";
+	NodeBuffDesc.Usage = USAGE_IMMUTABLE;
+	NodeBuffDesc.BindFlags = BIND_SHADER_RESOURCE;
+	NodeBuffDesc.Mode = BUFFER_MODE_STRUCTURED;
+	NodeBuffDesc.ElementByteStride = sizeof(PCGNodeData);
+	NodeBuffDesc.uiSizeInBytes = sizeof(PCGNodeData) * static_cast<uint32_t>(PCGNodeDataVec.size());
+
+	BufferData NodeBuffData;
+	NodeBuffData.pData = &PCGNodeDataVec[0];
+	NodeBuffData.DataSize = NodeBuffDesc.uiSizeInBytes;
+	m_pRenderDevice->CreateBuffer(NodeBuffDesc, &NodeBuffData, &mPCGGPUNodeDataBuffer);
 
 	//init position buffer
 	BufferDesc PlantInitPosBuffDesc;
@@ -194,10 +520,6 @@ void Diligent::PCGTerrainTile::DivideTile(const PCGLayer *pLayer, const std::vec
 	uint32_t texNum = GetPCGTextureNum();
 
 	mPCGNodeDataVec.resize(texNum);
-	mGPUDensityTexArray.resize(texNum);
-	mGPUSDFResultTexArray.resize(texNum);
-	mGPUSDFTexArrayPing.resize(texNum);
-	mGPUSDFTexArrayPong.resize(texNum);
 
 	float width = mTileSize.x;
 	float height = mTileSize.z;
@@ -231,6 +553,7 @@ void Diligent::PCGTerrainTile::DivideTile(const PCGLayer *pLayer, const std::vec
 				pcgData.PlantRadius = pLayer->GetPlantParamLayer()[i][0].footprint;
 				pcgData.PlantZOI = pcgData.PlantRadius + pLayer->GetPlantParamLayer()[i][0].footprint / 2.0f;
 				pcgData.PCGPointGSize = pLayer->GetPlantParamLayer()[i][0].size;
+				pcgData.NodeTexOffset = float2(x, y) * float(pcgData.TexSize);
 
 				//get parent pcg node data
 				if (i > 0)
@@ -241,12 +564,11 @@ void Diligent::PCGTerrainTile::DivideTile(const PCGLayer *pLayer, const std::vec
 				}
 
 				mPCGNodeDataVec[LinearArrayIdx] = pcgData;
-
-				CreateSpecificPCGTexture(i, LinearArrayIdx);
 			}
 		}
 	}
 
+	CreatePCGTextures(PointVec);
 	CreatePCGNodeDataBuffer(mPCGNodeDataVec);
 }
 
@@ -254,15 +576,36 @@ Diligent::PCGTerrainTile::PCGTerrainTile(IDeviceContext *pContext, IRenderDevice
 	m_pContext(pContext),
 	m_pRenderDevice(pDevice),
 	mTileMin(min),
-	mTileSize(size)
+	mTileSize(size),
+	mSDFPageNum(0),
+	mGeneratedPlantNum{},
+	mAddedPlants(F_LAYER_NUM),
+	mBatchedDispatch(true)
 {
 	InitGlobalRes();
+	CreateTimestampQueries();
+}
+
+void Diligent::PCGTerrainTile::CreateTimestampQueries()
+{
+	if (!m_pRenderDevice->GetDeviceCaps().Features.TimestampQueries)
+	{
+		return;
+	}
+
+	QueryDesc Desc;
+	Desc.Type = QUERY_TYPE_TIMESTAMP;
+	Desc.Name = "PCG begin timestamp";
+	m_pRenderDevice->CreateQuery(Desc, &mTimestampQueryBegin);
+	Desc.Name = "PCG end timestamp";
+	m_pRenderDevice->CreateQuery(Desc, &mTimestampQueryEnd);
 }
 
 void Diligent::PCGTerrainTile::InitGlobalRes()
 {
 	TextureLoadInfo loadInfo;
 	loadInfo.IsSRGB = false;
+	loadInfo.Usage = USAGE_DEFAULT; //updated by brush edits
 	CreateTextureFromFile("./PCGRoadMask.png", loadInfo, m_pRenderDevice, &mGlobalTerrainMaskTex);
 
 	CreateTextureFromFile("./wm_heightmap.png", loadInfo, m_pRenderDevice, &mGlobalTerrainHeightTex);
@@ -270,35 +613,97 @@ void Diligent::PCGTerrainTile::InitGlobalRes()
 
 void Diligent::PCGTerrainTile::GenerateNodes(const PCGLayer *pLayer, const std::vector<PCGPoint> &PointVec)
 {
+	//nodes and their textures only depend on the tile, keep them for the next pass
+	if (!mPCGNodeDataVec.empty())
+	{
+		return;
+	}
+
 	DivideTile(pLayer, PointVec);
 }
 
 void Diligent::PCGTerrainTile::GeneratePosMap(PCGCSCall *pPCGCall)
 {
-	uint lastLayer = F_LAYER_NUM;
-	for (int i = 0; i < mGPUDensityTexArray.size(); ++i)
+	mDispatchStats = PCGDispatchStats();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//plant counters are appended to by every pass
+	const uint32_t ZeroTypeNum[F_LAYER_NUM] = {};
+	m_pContext->UpdateBuffer(mPlantTypeNumBuffer, 0, sizeof(ZeroTypeNum), ZeroTypeNum, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+	if (mTimestampQueryBegin)
+	{
+		m_pContext->EndQuery(mTimestampQueryBegin);
+	}
+
+	uint32_t FirstNode = 0;
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
 	{
-		pPCGCall->PosMapSetPSO(m_pContext);
-		pPCGCall->BindTerrainMaskMap(m_pContext, mGlobalTerrainMaskTex, mGlobalTerrainHeightTex);
+		//a layer only reads the sdf of the layers above it, so all its nodes can go at once
+		uint32_t NodeNum = (2u << i) * (2u << i);
 
-		uint currLayerIdx = mPCGNodeDataVec[i].LayerIdx;
-		if (lastLayer != currLayerIdx)
+		//nothing reads the sdf of the last layer
+		bool NeedSDF = i + 1 < F_LAYER_NUM;
+		if (mBatchedDispatch)
 		{
-			pPCGCall->BindPoissonPosMap(currLayerIdx);
-			lastLayer = currLayerIdx;
+			GenerateLayerPosMap(pPCGCall, i, FirstNode, NodeNum);
+
+			//Generate density map to evaluate pos data
+			if (NeedSDF)
+			{
+				GenerateSDFMap(pPCGCall, i, FirstNode, NodeNum);
+			}
+		}
+		else
+		{
+			for (uint32_t n = FirstNode; n < FirstNode + NodeNum; ++n)
+			{
+				GenerateLayerPosMap(pPCGCall, i, n, 1);
+				if (NeedSDF)
+				{
+					GenerateSDFMap(pPCGCall, i, n, 1);
+				}
+			}
 		}
-		
-		pPCGCall->BindPosMapRes(m_pContext, mPCGGPUNodeConstBuffer, mPCGNodeDataVec[i], mGPUDensityTexArray[i], mGPUSDFResultTexArray);
-		pPCGCall->BindPosBuffer(m_pContext, mPlantTypeNumBuffer, mPlantPositionBuffers);
 
-		uint mapSize = PCG_TEX_DEFAULT_SIZE >> currLayerIdx;
-		pPCGCall->PosMapDispatch(m_pContext, mapSize);
+		FirstNode += NodeNum;
+	}
 
-		//Generate density map to evaluate pos data
-		GenerateSDFMap(pPCGCall, i);
+	if (mTimestampQueryEnd)
+	{
+		m_pContext->EndQuery(mTimestampQueryEnd);
 	}
 
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	mDispatchStats.CPUSubmitTime = elapsed.count();
+
 	ReadBackPositionDataToHost();
+
+	//the readback waits for idle, so the timestamps are available
+	if (mTimestampQueryBegin && mTimestampQueryEnd)
+	{
+		QueryDataTimestamp BeginData, EndData;
+		if (mTimestampQueryBegin->GetData(&BeginData, sizeof(BeginData)) &&
+			mTimestampQueryEnd->GetData(&EndData, sizeof(EndData)) &&
+			EndData.Frequency > 0)
+		{
+			mDispatchStats.GPUTime = static_cast<double>(EndData.Counter - BeginData.Counter) * 1000.0 / static_cast<double>(EndData.Frequency);
+		}
+	}
+}
+
+void Diligent::PCGTerrainTile::GenerateLayerPosMap(PCGCSCall *pPCGCall, uint32_t Layer, uint32_t FirstNode, uint32_t NodeNum)
+{
+	pPCGCall->PosMapSetPSO(m_pContext);
+	pPCGCall->BindTerrainMaskMap(m_pContext, mGlobalTerrainMaskTex, mGlobalTerrainHeightTex);
+	pPCGCall->BindPoissonPosMap(Layer);
+
+	pPCGCall->BindPosMapRes(m_pContext, mPCGGPUBatchConstBuffer, mPCGGPUNodeDataBuffer, FirstNode, mGPUDensityTex, mGPUSDFAtlasTex, mGPUSDFPageTableView);
+	pPCGCall->BindPosBuffer(m_pContext, mPlantTypeNumBuffer, mPlantPositionBuffers);
+
+	uint mapSize = PCG_TEX_DEFAULT_SIZE >> Layer;
+	pPCGCall->PosMapDispatch(m_pContext, mapSize, NodeNum);
+	++mDispatchStats.DispatchNum;
 }
 
 //void Diligent::PCGTerrainTile::GenerateSDFMap(PCGCSCall *pPCGCall)
@@ -341,47 +746,55 @@ void Diligent::PCGTerrainTile::GeneratePosMap(PCGCSCall *pPCGCall)
 //
 //}
 
-void Diligent::PCGTerrainTile::GenerateSDFMap(PCGCSCall *pPCGCall, int index)
+void Diligent::PCGTerrainTile::GenerateSDFMap(PCGCSCall *pPCGCall, uint32_t Layer, uint32_t FirstNode, uint32_t NodeNum)
 {
-	int i = index;
-	const PCGNodeData &nodeData = mPCGNodeDataVec[i];
+	const PCGNodeData &nodeData = mPCGNodeDataVec[FirstNode];
+	const uint32_t FirstMortonCode = nodeData.MortonCode;
+
+	ITexture *pDensityTex = mGPUDensityTex;
+	ITexture *pPingTex = mGPUSDFSeedTexPing;
+	ITexture *pPongTex = mGPUSDFSeedTexPong;
 
 	//init sdf map
 	pPCGCall->InitSDFMapSetPSO(m_pContext);
-	pPCGCall->BindInitSDFMapData(m_pContext, nodeData, mGPUDensityTexArray[i], mGPUSDFTexArrayPing[i]);
-	pPCGCall->InitSDFDispatch(m_pContext, nodeData.TexSize);
+	pPCGCall->BindInitSDFMapData(m_pContext, nodeData, FirstMortonCode, pDensityTex, pPingTex);
+	pPCGCall->InitSDFDispatch(m_pContext, nodeData.TexSize, NodeNum);
+	++mDispatchStats.DispatchNum;
 
 	//sdf jump flood
 	bool reverse_val = false;
-	int2 step = int2((mPCGNodeDataVec[i].TexSize + 1) >> 1, (mPCGNodeDataVec[i].TexSize + 1) >> 1);
+	int2 step = int2((nodeData.TexSize + 1) >> 1, (nodeData.TexSize + 1) >> 1);
 	pPCGCall->SDFJumpFloodSetPSO(m_pContext);
 	while (step.x > 1 || step.y > 1)
 	{
-		pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, float2(step.x, step.y), mGPUSDFTexArrayPing[i], mGPUSDFTexArrayPong[i], reverse_val);
+		pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, FirstMortonCode, float2(step.x, step.y), pPingTex, pPongTex, reverse_val);
 
 		reverse_val = !reverse_val;
 		step = int2((step.x + 1) >> 1, (step.y + 1) >> 1);
-		pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize);
+		pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize, NodeNum);
+		++mDispatchStats.DispatchNum;
 	}
-	pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, float2(1.0f, 1.0f), mGPUSDFTexArrayPing[i], mGPUSDFTexArrayPong[i], reverse_val);
-	pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize);
+	pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, FirstMortonCode, float2(1.0f, 1.0f), pPingTex, pPongTex, reverse_val);
+	pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize, NodeNum);
 	reverse_val = !reverse_val;
-	pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, float2(1.0f, 1.0f), mGPUSDFTexArrayPing[i], mGPUSDFTexArrayPong[i], reverse_val);
-	pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize);
+	pPCGCall->BindSDFJumpFloodData(m_pContext, nodeData, FirstMortonCode, float2(1.0f, 1.0f), pPingTex, pPongTex, reverse_val);
+	pPCGCall->SDFJumpFloodDispatch(m_pContext, nodeData.TexSize, NodeNum);
 	reverse_val = !reverse_val;
+	mDispatchStats.DispatchNum += 2;
 
 	//gen sdf composition
 	pPCGCall->GenSDFMapSetPSO(m_pContext);
 	if (!reverse_val)
 	{
-		pPCGCall->BindGenSDFMapData(m_pContext, nodeData, mGPUDensityTexArray[i], mGPUSDFTexArrayPing[i], mGPUSDFResultTexArray[i], reverse_val);
+		pPCGCall->BindGenSDFMapData(m_pContext, nodeData, FirstMortonCode, pDensityTex, pPingTex, mGPUSDFAtlasTex, mGPUSDFPageTableView, reverse_val);
 	}
 	else
 	{
-		pPCGCall->BindGenSDFMapData(m_pContext, nodeData, mGPUDensityTexArray[i], mGPUSDFTexArrayPong[i], mGPUSDFResultTexArray[i], reverse_val);
+		pPCGCall->BindGenSDFMapData(m_pContext, nodeData, FirstMortonCode, pDensityTex, pPongTex, mGPUSDFAtlasTex, mGPUSDFPageTableView, reverse_val);
 	}
 	
-	pPCGCall->GenSDFMapDispatch(m_pContext, nodeData.TexSize);
+	pPCGCall->GenSDFMapDispatch(m_pContext, nodeData.TexSize, NodeNum);
+	++mDispatchStats.DispatchNum;
 
 	//reverse_val = !reverse_val;
 }
@@ -409,14 +822,244 @@ void Diligent::PCGTerrainTile::ReadBackPositionDataToHost()
 	mPlantPositionHostDatas.resize(F_LAYER_NUM);
 	for (int i = 0; i < F_LAYER_NUM; ++i)
 	{
-		uint32_t plant_type_num = mPlantTypeNumHostData[i];
+		float4 *pSrcData = reinterpret_cast<float4*>(map_plant_position_data.GetMapData() + i * PCG_PLANT_MAX_POSITION_NUM);
+		SetHostPlants(i, pSrcData, mPlantTypeNumHostData[i]);
+	}
+}
+
+void Diligent::PCGTerrainTile::UpdateTerrainMaskRegion(const Box &Region, const void *pData, uint32_t Stride)
+{
+	TextureSubResData SubResData;
+	SubResData.pData = pData;
+	SubResData.Stride = Stride;
+	m_pContext->UpdateTexture(mGlobalTerrainMaskTex, 0, 0, Region, SubResData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
 
-		float4 *pPlantPosDatas = new float4[plant_type_num];
+void Diligent::PCGTerrainTile::UpdateTerrainHeightRegion(const Box &Region, const void *pData, uint32_t Stride)
+{
+	TextureSubResData SubResData;
+	SubResData.pData = pData;
+	SubResData.Stride = Stride;
+	m_pContext->UpdateTexture(mGlobalTerrainHeightTex, 0, 0, Region, SubResData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
 
-		float4 *pSrcData = reinterpret_cast<float4*>(map_plant_position_data.GetMapData() + i * PCG_PLANT_MAX_POSITION_NUM);
-		memcpy(pPlantPosDatas, pSrcData, sizeof(float4) * plant_type_num);
+void Diligent::PCGTerrainTile::CollectDirtyNodes(const float2 &DirtyMinUV, const float2 &DirtyMaxUV, std::vector<std::vector<uint32_t>> &DirtyNodes)
+{
+	DirtyNodes.clear();
+	DirtyNodes.resize(F_LAYER_NUM);
+
+	//dirty rect in layer texels, the same for every layer
+	float2 DirtyMin = float2(std::max(DirtyMinUV.x, 0.0f), std::max(DirtyMinUV.y, 0.0f)) * float(PCG_LAYER_TEX_SIZE);
+	float2 DirtyMax = float2(std::min(DirtyMaxUV.x, 1.0f), std::min(DirtyMaxUV.y, 1.0f)) * float(PCG_LAYER_TEX_SIZE);
+	if (DirtyMin.x > DirtyMax.x || DirtyMin.y > DirtyMax.y)
+	{
+		return;
+	}
+
+	//plants of a layer react to the mask inside the rect and to the sdf of the layers above,
+	//which changes up to their zone of influence away from their changed plants
+	float Grow = 0.0f;
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
+	{
+		const int NodeNumPerAxis = 2 << i;
+		const float TexSize = static_cast<float>(PCG_TEX_DEFAULT_SIZE >> i);
+
+		int MinX = std::max(static_cast<int>(std::floor((DirtyMin.x - Grow) / TexSize)), 0);
+		int MinY = std::max(static_cast<int>(std::floor((DirtyMin.y - Grow) / TexSize)), 0);
+		int MaxX = std::min(static_cast<int>(std::floor((DirtyMax.x + Grow) / TexSize)), NodeNumPerAxis - 1);
+		int MaxY = std::min(static_cast<int>(std::floor((DirtyMax.y + Grow) / TexSize)), NodeNumPerAxis - 1);
+
+		for (int y = MinY; y <= MaxY; ++y)
+		{
+			for (int x = MinX; x <= MaxX; ++x)
+			{
+				uint32_t MortonVal = mMortonCode.Morton2D(static_cast<uint16_t>(x), static_cast<uint16_t>(y));
+				DirtyNodes[i].push_back(GetLinearQuadIndex(i, MortonVal));
+			}
+		}
+		std::sort(DirtyNodes[i].begin(), DirtyNodes[i].end());
+
+		//every node of a layer has the same plant parameters
+		Grow += std::ceil(mPCGNodeDataVec[GetLinearQuadIndex(i, 0)].PlantZOI);
+	}
+}
+
+void Diligent::PCGTerrainTile::RegenerateRegion(PCGCSCall *pPCGCall, const float2 &DirtyMinUV, const float2 &DirtyMaxUV)
+{
+	if (mPCGNodeDataVec.empty())
+	{
+		return;
+	}
+
+	std::vector<std::vector<uint32_t>> DirtyNodes;
+	CollectDirtyNodes(DirtyMinUV, DirtyMaxUV, DirtyNodes);
+
+	mDispatchStats = PCGDispatchStats();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//the dirty nodes' plants are appended from the start of every layer range
+	const uint32_t ZeroTypeNum[F_LAYER_NUM] = {};
+	m_pContext->UpdateBuffer(mPlantTypeNumBuffer, 0, sizeof(ZeroTypeNum), ZeroTypeNum, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+	if (mTimestampQueryBegin)
+	{
+		m_pContext->EndQuery(mTimestampQueryBegin);
+	}
+
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
+	{
+		bool NeedSDF = i + 1 < F_LAYER_NUM;
+		const std::vector<uint32_t> &LayerNodes = DirtyNodes[i];
+
+		//consecutive linear indices are consecutive morton codes, one dispatch per run
+		size_t RunBegin = 0;
+		while (RunBegin < LayerNodes.size())
+		{
+			size_t RunEnd = RunBegin + 1;
+			while (mBatchedDispatch && RunEnd < LayerNodes.size() && LayerNodes[RunEnd] == LayerNodes[RunEnd - 1] + 1)
+			{
+				++RunEnd;
+			}
 
-		mPlantPositionHostDatas[i].reset(pPlantPosDatas);
+			uint32_t NodeNum = static_cast<uint32_t>(RunEnd - RunBegin);
+			GenerateLayerPosMap(pPCGCall, i, LayerNodes[RunBegin], NodeNum);
+			if (NeedSDF)
+			{
+				GenerateSDFMap(pPCGCall, i, LayerNodes[RunBegin], NodeNum);
+			}
+
+			RunBegin = RunEnd;
+		}
+	}
+
+	if (mTimestampQueryEnd)
+	{
+		m_pContext->EndQuery(mTimestampQueryEnd);
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	mDispatchStats.CPUSubmitTime = elapsed.count();
+
+	MergePositionDataToHost(DirtyNodes);
+
+	if (mTimestampQueryBegin && mTimestampQueryEnd)
+	{
+		QueryDataTimestamp BeginData, EndData;
+		if (mTimestampQueryBegin->GetData(&BeginData, sizeof(BeginData)) &&
+			mTimestampQueryEnd->GetData(&EndData, sizeof(EndData)) &&
+			EndData.Frequency > 0)
+		{
+			mDispatchStats.GPUTime = static_cast<double>(EndData.Counter - BeginData.Counter) * 1000.0 / static_cast<double>(EndData.Frequency);
+		}
+	}
+}
+
+void Diligent::PCGTerrainTile::MergePositionDataToHost(const std::vector<std::vector<uint32_t>> &DirtyNodes)
+{
+	m_pContext->CopyBuffer(mPlantTypeNumBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+		mPlantTypeNumStageData, 0, F_LAYER_NUM * sizeof(uint32_t),
+		RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	m_pContext->WaitForIdle();
+
+	uint32_t NewPlantNum[F_LAYER_NUM];
+	{
+		MapHelper<uint32_t> map_plant_type_num_data(m_pContext, mPlantTypeNumStageData, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+		memcpy(NewPlantNum, map_plant_type_num_data.GetMapData(), sizeof(uint32_t) * F_LAYER_NUM);
+	}
+
+	//only the plants of the dirty nodes come back
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
+	{
+		NewPlantNum[i] = std::min(NewPlantNum[i], static_cast<uint32_t>(PCG_PLANT_MAX_POSITION_NUM));
+		if (NewPlantNum[i] > 0)
+		{
+			uint32_t Offset = i * PCG_PLANT_MAX_POSITION_NUM * sizeof(float4);
+			m_pContext->CopyBuffer(mPlantPositionBuffers, Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+				mPlantPosStageDatas, Offset, NewPlantNum[i] * sizeof(float4),
+				RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+	}
+	m_pContext->WaitForIdle();
+
+	MapHelper<float4> map_plant_position_data(m_pContext, mPlantPosStageDatas, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+
+	const float2 TerrainOrigin = float2(mTileMin.x, mTileMin.z);
+	const float2 TexelSize = float2(mTileSize.x, mTileSize.z) / float(PCG_LAYER_TEX_SIZE);
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
+	{
+		const uint32_t NodeNumPerAxis = 2u << i;
+		const uint32_t TexSize = PCG_TEX_DEFAULT_SIZE >> i;
+		const uint32_t LayerFirstNode = GetLinearQuadIndex(i, 0);
+
+		//by morton code
+		std::vector<uint8_t> IsDirty(NodeNumPerAxis * NodeNumPerAxis, 0);
+		for (uint32_t LinearQuadIndex : DirtyNodes[i])
+		{
+			IsDirty[LinearQuadIndex - LayerFirstNode] = 1;
+		}
+
+		//the added plants behind them are appended again by SetHostPlants
+		const uint32_t OldPlantNum = mGeneratedPlantNum[i];
+		const float4 *pOldPlants = mPlantPositionHostDatas[i].get();
+		const float4 *pNewPlants = reinterpret_cast<const float4*>(map_plant_position_data.GetMapData() + i * PCG_PLANT_MAX_POSITION_NUM);
+
+		std::vector<float4> Plants;
+		Plants.reserve(OldPlantNum + NewPlantNum[i]);
+		for (uint32_t p = 0; p < OldPlantNum; ++p)
+		{
+			//plants sit on texel corners
+			const float4 &Plant = pOldPlants[p];
+			uint32_t TexX = static_cast<uint32_t>(std::max((Plant.x - TerrainOrigin.x) / TexelSize.x + 0.5f, 0.0f));
+			uint32_t TexY = static_cast<uint32_t>(std::max((Plant.z - TerrainOrigin.y) / TexelSize.y + 0.5f, 0.0f));
+			uint16_t NodeX = static_cast<uint16_t>(std::min(TexX / TexSize, NodeNumPerAxis - 1));
+			uint16_t NodeY = static_cast<uint16_t>(std::min(TexY / TexSize, NodeNumPerAxis - 1));
+			if (!IsDirty[mMortonCode.Morton2D(NodeX, NodeY)])
+			{
+				Plants.push_back(Plant);
+			}
+		}
+		Plants.insert(Plants.end(), pNewPlants, pNewPlants + NewPlantNum[i]);
+
+		SetHostPlants(i, Plants.empty() ? nullptr : &Plants[0], static_cast<uint32_t>(Plants.size()));
+	}
+}
+
+void Diligent::PCGTerrainTile::SetHostPlants(uint32_t Layer, const float4 *pGeneratedPlants, uint32_t GeneratedNum)
+{
+	const std::vector<float4> &AddedPlants = mAddedPlants[Layer];
+	const size_t PlantNum = GeneratedNum + AddedPlants.size();
+
+	//pGeneratedPlants may point into the old array, copy before releasing it
+	float4 *pPlantPosDatas = new float4[PlantNum];
+	if (GeneratedNum > 0)
+	{
+		memcpy(pPlantPosDatas, pGeneratedPlants, sizeof(float4) * GeneratedNum);
+	}
+	if (!AddedPlants.empty())
+	{
+		memcpy(pPlantPosDatas + GeneratedNum, &AddedPlants[0], sizeof(float4) * AddedPlants.size());
+	}
+	mPlantPositionHostDatas[Layer].reset(pPlantPosDatas);
+
+	//counts are updated in place, users keep a pointer to them
+	mGeneratedPlantNum[Layer] = GeneratedNum;
+	mPlantTypeNumHostData[Layer] = static_cast<uint32_t>(PlantNum);
+}
+
+void Diligent::PCGTerrainTile::SetAddedPlants(const std::vector<std::vector<float4>> &AddedPlants)
+{
+	mAddedPlants = AddedPlants;
+	mAddedPlants.resize(F_LAYER_NUM);
+
+	//nothing generated yet, the first readback appends them
+	if (!mPlantTypeNumHostData)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < F_LAYER_NUM; ++i)
+	{
+		SetHostPlants(i, mPlantPositionHostDatas[i].get(), mGeneratedPlantNum[i]);
 	}
 }
 
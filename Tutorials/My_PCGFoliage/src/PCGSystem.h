@@ -6,10 +6,12 @@
 #include "RefCntAutoPtr.hpp"
 #include "BasicMath.hpp"
 #include "Texture.h"
+#include "Query.h"
 
 #include "PCGLayer.h"
 #include "PCGNodePool.h"
 #include "PCGPoint.h"
+#include "PCGDensityField.h"
 #include "PCGCSCall.h"
 #include "PoissonDisk/PoissonDiskSampling.h"
 #include "MortonCode.h"
@@ -32,6 +34,14 @@ namespace Diligent
 		return texNum;
 	}
 
+	//timings of one DoProcedural() pass
+	struct PCGDispatchStats
+	{
+		uint32_t DispatchNum = 0;
+		double CPUSubmitTime = 0.0; //ms, recording the commands, without the readback wait
+		double GPUTime = -1.0; //ms, < 0 when timestamp queries are not supported
+	};
+
 	struct PCGResultData
 	{
 		std::vector<std::shared_ptr<float4[]>> PlantPositionHostDatas;
@@ -52,18 +62,49 @@ namespace Diligent
 
 		void GenerateNodes(const PCGLayer *pLayer, const std::vector<PCGPoint> &PointVec);
 
+		//true - one dispatch per layer and stage for all nodes of the layer, false - one per node
+		void SetBatchedDispatch(bool Batched) { mBatchedDispatch = Batched; }
+		bool IsBatchedDispatch() const { return mBatchedDispatch; }
+
 		void GeneratePosMap(PCGCSCall *pPCGCall);
 		//void GenerateSDFMap(PCGCSCall *pPCGCall);
 
-		void GenerateSDFMap(PCGCSCall *pPCGCall, int index);
+		//sdf of the nodes [FirstNode, FirstNode + NodeNum) of a layer
+		void GenerateSDFMap(PCGCSCall *pPCGCall, uint32_t Layer, uint32_t FirstNode, uint32_t NodeNum);
 
 		void ReadBackPositionDataToHost();
 
+		//Brush edits of the global maps, Region in texels of the map, pData in the map's format
+		void UpdateTerrainMaskRegion(const Box &Region, const void *pData, uint32_t Stride);
+		void UpdateTerrainHeightRegion(const Box &Region, const void *pData, uint32_t Stride);
+
+		const TextureDesc &GetTerrainMaskDesc() const { return mGlobalTerrainMaskTex->GetDesc(); }
+		const TextureDesc &GetTerrainHeightDesc() const { return mGlobalTerrainHeightTex->GetDesc(); }
+
+		//Regenerates the nodes of every layer touched by the uv rect, grown by the zone of influence
+		//of the plants above them. Plants of all other nodes are kept as they are.
+		void RegenerateRegion(PCGCSCall *pPCGCall, const float2 &DirtyMinUV, const float2 &DirtyMaxUV);
+
+		//Plants of add edits, per layer. They are appended to the generated plants of the layer and kept
+		//across regenerations, but are not written to the pos maps, so lower layers do not space against them.
+		void SetAddedPlants(const std::vector<std::vector<float4>> &AddedPlants);
+
 		PCGResultData GetPCGResultData();
 
+		const PCGDispatchStats &GetDispatchStats() const { return mDispatchStats; }
+
 	protected:
-		void CreateSpecificPCGTexture(const uint32_t Layer, const uint32_t LinearQuadIndex);
+		void CreatePCGTextures(const std::vector<PCGPoint> &PointVec);
 		void CreatePCGNodeDataBuffer(const std::vector<PCGNodeData> &PCGNodeDataVec);
+		void CreateTimestampQueries();
+
+		void GenerateLayerPosMap(PCGCSCall *pPCGCall, uint32_t Layer, uint32_t FirstNode, uint32_t NodeNum);
+
+		//linear quad indices per layer, sorted
+		void CollectDirtyNodes(const float2 &DirtyMinUV, const float2 &DirtyMaxUV, std::vector<std::vector<uint32_t>> &DirtyNodes);
+		void MergePositionDataToHost(const std::vector<std::vector<uint32_t>> &DirtyNodes);
+		//host plants of a layer = the generated ones followed by the added ones
+		void SetHostPlants(uint32_t Layer, const float4 *pGeneratedPlants, uint32_t GeneratedNum);
 
 		uint32_t GetLinearQuadIndex(const uint32_t Layer, const uint32_t MortonCode);
 		uint32_t GetParentIndex(const uint32_t LinearQuadIndex);
@@ -73,12 +114,19 @@ namespace Diligent
 	private:
 		float3 mTileMin, mTileSize;
 
-		//Generate texture hierarchy
+		//Generate texture hierarchy. Every layer covers the same PCG_LAYER_TEX_SIZE^2 texel grid,
+		//the transient maps are one grid reused layer by layer.
 		MortonCode mMortonCode;
-		std::vector<RefCntAutoPtr<ITexture>> mGPUDensityTexArray; //quad tree
-		std::vector<RefCntAutoPtr<ITexture>> mGPUSDFTexArrayPing; //quad tree
-		std::vector<RefCntAutoPtr<ITexture>> mGPUSDFTexArrayPong; //quad tree
-		std::vector<RefCntAutoPtr<ITexture>> mGPUSDFResultTexArray; //quad tree
+		RefCntAutoPtr<ITexture> mGPUDensityTex;
+		RefCntAutoPtr<ITexture> mGPUSDFSeedTexPing; //packed 16 bit jump flood seeds
+		RefCntAutoPtr<ITexture> mGPUSDFSeedTexPong;
+
+		//sdf results are read by the lower layers. Pages of nodes without poisson points are not allocated,
+		//but every layer above the last is read in full by it, so with dense points the atlas is dense too.
+		RefCntAutoPtr<ITexture> mGPUSDFAtlasTex;
+		RefCntAutoPtr<IBuffer> mGPUSDFPageTableBuffer;
+		RefCntAutoPtr<IBufferView> mGPUSDFPageTableView;
+		uint32_t mSDFPageNum;
 
 		//position buffer  type-positions data of GPU
 		RefCntAutoPtr<IBuffer> mPlantPositionBuffers;
@@ -92,6 +140,8 @@ namespace Diligent
 		//CPU data
 		std::vector<std::shared_ptr<float4[]>> mPlantPositionHostDatas;
 		std::shared_ptr<uint32_t[]> mPlantTypeNumHostData;
+		uint32_t mGeneratedPlantNum[F_LAYER_NUM];
+		std::vector<std::vector<float4>> mAddedPlants;
 
 		//To CPU stage data
 		RefCntAutoPtr<IBuffer> mPlantPosStageDatas;
@@ -99,9 +149,15 @@ namespace Diligent
 
 		RefCntAutoPtr<IFence>  mPlantStageDataAvailable;
 
-		RefCntAutoPtr<IBuffer> mPCGGPUNodeConstBuffer;
+		RefCntAutoPtr<IBuffer> mPCGGPUBatchConstBuffer;
+		RefCntAutoPtr<IBuffer> mPCGGPUNodeDataBuffer; //structured, all nodes in linear quad tree order
 		std::vector<PCGNodeData> mPCGNodeDataVec;
 
+		bool mBatchedDispatch;
+		PCGDispatchStats mDispatchStats;
+		RefCntAutoPtr<IQuery> mTimestampQueryBegin;
+		RefCntAutoPtr<IQuery> mTimestampQueryEnd;
+
 		IDeviceContext *m_pContext;
 		IRenderDevice *m_pRenderDevice;
 	};
@@ -118,11 +174,33 @@ namespace Diligent
 
 		void DoProcedural();
 
+		//runs DoProcedural() per node and batched and logs both timings, keeps the batched result
+		void ProfileDispatchModes();
+
 		PCGResultData GetPCGResultData();
 
+		//Level editing: upload the edited texels to the GPU maps and the CPU density field, then regenerate
+		//the touched uv rect of the tile. Poisson points stay as generated at startup, so edits move plants
+		//only where points exist, AddPlants places new ones. Texels are in the format of the map.
+		void UpdateTerrainMaskRegion(const Box &Region, const void *pData, uint32_t Stride);
+		void UpdateTerrainHeightRegion(const Box &Region, const void *pData, uint32_t Stride);
+		void RegenerateRegion(const float2 &DirtyMinUV, const float2 &DirtyMaxUV);
+
+		//round brush setting the mask to Value, regenerates the touched nodes
+		void PaintTerrainMask(const float2 &CenterUV, const float RadiusUV, const float Value);
+
+		//round brush scattering up to Num plants of PlantType on a layer where the density field allows them,
+		//at least the poisson spacing away from the other plants of the layer. Returns the added number.
+		uint32_t AddPlants(uint32_t Layer, uint32_t PlantType, const float2 &CenterUV, const float RadiusUV, const uint32_t Num);
+
 		//void GeneratePCGTextureArray();
 
-	//protected:		
+	protected:
+		//generated poisson points vs plants that survive the GPU placement pass
+		void LogPlacementEfficiency();
+
+		//drops the added plants where the edited maps no longer allow plants and moves the rest to the new height
+		void UpdateAddedPlants();
 
 	private:
 		IDeviceContext *m_pContext;
@@ -133,6 +211,14 @@ namespace Diligent
 		uint32_t mSeed;
 		std::vector<PCGPoint> mPointVec;		
 
+		//true - variable radius points from the mask/slope density, false - one tiled map per layer
+		bool mDensityDrivenPoints;
+		PCGDensityField mDensityField;
+
+		//plants of add edits per layer, w - plant type in layer like the generated ones
+		std::vector<std::vector<float4>> mAddedPlants;
+		uint32_t mAddedPlantSeed;
+
 		PCGCSCall mPCGCSCall;
 
 		PCGNodePool mNodePool;
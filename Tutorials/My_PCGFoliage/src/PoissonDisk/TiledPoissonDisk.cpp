@@ -0,0 +1,221 @@
+#include "TiledPoissonDisk.h"
+#include "PoissonDiskSampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	namespace pds = thinks::poisson_disk_sampling_internal;
+
+	//Reusable barrier, all workers step through the phases together.
+	class PhaseBarrier
+	{
+	public:
+		explicit PhaseBarrier(uint32_t Count) :
+			mCount(Count),
+			mWaiting(0),
+			mGeneration(0)
+		{}
+
+		void Wait()
+		{
+			std::unique_lock<std::mutex> Lock(mMutex);
+			uint32_t Generation = mGeneration;
+			if (++mWaiting == mCount)
+			{
+				mWaiting = 0;
+				++mGeneration;
+				mCond.notify_all();
+			}
+			else
+			{
+				mCond.wait(Lock, [&]() { return Generation != mGeneration; });
+			}
+		}
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mCond;
+		uint32_t mCount;
+		uint32_t mWaiting;
+		uint32_t mGeneration;
+	};
+
+	struct TiledGrid
+	{
+		float TileSize;
+		float Radius;
+		float CellSize;
+		int32_t CellNum; //per axis, multiple of PhaseDim
+		int32_t Reach; //neighbour cells to test per axis
+		int32_t PhaseDim;
+
+		//at most one sample per cell
+		std::vector<std::array<float, 2>> CellSamples;
+		std::vector<uint8_t> CellUsed;
+
+		TiledGrid(const float Radius, const float TileSize) :
+			TileSize(TileSize),
+			Radius(Radius)
+		{
+			//Same cell size rule as pds::Grid: the diagonal must not exceed the radius.
+			CellNum = static_cast<int32_t>(std::ceil(TileSize * std::sqrt(2.0f) / Radius));
+			for (;;)
+			{
+				Reach = static_cast<int32_t>(std::ceil(Radius * CellNum / TileSize));
+				PhaseDim = Reach + 1;
+
+				//cells of the same phase must stay PhaseDim apart across the wrap too
+				int32_t AlignedNum = (CellNum + PhaseDim - 1) / PhaseDim * PhaseDim;
+				if (AlignedNum == CellNum)
+				{
+					break;
+				}
+				CellNum = AlignedNum;
+			}
+			CellSize = TileSize / CellNum;
+
+			CellSamples.resize(CellNum * CellNum);
+			CellUsed.resize(CellNum * CellNum, 0);
+		}
+
+		int32_t Wrap(const int32_t Idx) const
+		{
+			int32_t Ret = Idx % CellNum;
+			return Ret < 0 ? Ret + CellNum : Ret;
+		}
+
+		float WrapDistanceSq(const std::array<float, 2> &a, const std::array<float, 2> &b) const
+		{
+			float dx = std::abs(a[0] - b[0]);
+			float dy = std::abs(a[1] - b[1]);
+			dx = std::min(dx, TileSize - dx);
+			dy = std::min(dy, TileSize - dy);
+			return dx * dx + dy * dy;
+		}
+
+		bool ExistingSampleWithinRadius(const std::array<float, 2> &Sample, const int32_t cx, const int32_t cy) const
+		{
+			const float RadiusSq = pds::squared(Radius);
+			for (int32_t y = cy - Reach; y <= cy + Reach; ++y)
+			{
+				const int32_t Row = Wrap(y) * CellNum;
+				for (int32_t x = cx - Reach; x <= cx + Reach; ++x)
+				{
+					const int32_t Idx = Row + Wrap(x);
+					if (CellUsed[Idx] && WrapDistanceSq(Sample, CellSamples[Idx]) < RadiusSq)
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		//Throw one dart into every empty cell of the phase inside rows [RowBegin, RowEnd).
+		void ThrowPhase(const int32_t px, const int32_t py, const int32_t RowBegin, const int32_t RowEnd, const uint32_t RoundSeed)
+		{
+			const int32_t PhaseCellNum = CellNum / PhaseDim;
+			for (int32_t j = RowBegin; j < RowEnd; ++j)
+			{
+				const int32_t cy = py + j * PhaseDim;
+				for (int32_t i = 0; i < PhaseCellNum; ++i)
+				{
+					const int32_t cx = px + i * PhaseDim;
+					const int32_t Idx = cy * CellNum + cx;
+					if (CellUsed[Idx])
+					{
+						continue;
+					}
+
+					uint32_t LocalSeed = RoundSeed + 2u * static_cast<uint32_t>(Idx);
+					const float u = std::min(pds::NormRand<float>(&LocalSeed), 0.9999f);
+					const float v = std::min(pds::NormRand<float>(&LocalSeed), 0.9999f);
+					const std::array<float, 2> Cand = { { (cx + u) * CellSize, (cy + v) * CellSize } };
+
+					if (!ExistingSampleWithinRadius(Cand, cx, cy))
+					{
+						CellSamples[Idx] = Cand;
+						CellUsed[Idx] = 1;
+					}
+				}
+			}
+		}
+	};
+}
+
+std::vector<std::array<float, 2>> Diligent::TiledPoissonDiskSampling(const TiledPoissonDiskDesc &Desc)
+{
+	std::vector<std::array<float, 2>> Samples;
+	if (!(Desc.Radius > 0.0f) || !(Desc.TileSize > 0.0f) || Desc.MaxSampleAttempts == 0)
+	{
+		return Samples;
+	}
+
+	TiledGrid Grid(Desc.Radius, Desc.TileSize);
+
+	const int32_t PhaseNum = Grid.PhaseDim * Grid.PhaseDim;
+	const int32_t PhaseRowNum = Grid.CellNum / Grid.PhaseDim;
+	const uint32_t CellTotal = static_cast<uint32_t>(Grid.CellNum * Grid.CellNum);
+
+	//Phase order is shuffled every round, otherwise the first phase always wins
+	//and the grid structure shows up in the distribution.
+	std::vector<std::vector<int32_t>> PhaseOrders(Desc.MaxSampleAttempts);
+	uint32_t OrderSeed = pds::Hash(Desc.Seed);
+	for (auto &Order : PhaseOrders)
+	{
+		Order.resize(PhaseNum);
+		for (int32_t p = 0; p < PhaseNum; ++p)
+		{
+			Order[p] = p;
+		}
+		for (int32_t p = PhaseNum - 1; p > 0; --p)
+		{
+			std::swap(Order[p], Order[pds::IndexRand(p + 1, &OrderSeed)]);
+		}
+	}
+
+	uint32_t ThreadNum = Desc.ThreadNum != 0 ? Desc.ThreadNum : std::max(std::thread::hardware_concurrency(), 1u);
+	ThreadNum = std::min(ThreadNum, static_cast<uint32_t>(PhaseRowNum));
+
+	PhaseBarrier Barrier(ThreadNum);
+	auto WorkerFunc = [&](const uint32_t ThreadIdx)
+	{
+		const int32_t RowBegin = PhaseRowNum * ThreadIdx / ThreadNum;
+		const int32_t RowEnd = PhaseRowNum * (ThreadIdx + 1) / ThreadNum;
+		for (uint32_t Round = 0; Round < Desc.MaxSampleAttempts; ++Round)
+		{
+			const uint32_t RoundSeed = pds::Hash(Desc.Seed + Round) + 2u * CellTotal * Round;
+			for (int32_t Phase : PhaseOrders[Round])
+			{
+				Grid.ThrowPhase(Phase % Grid.PhaseDim, Phase / Grid.PhaseDim, RowBegin, RowEnd, RoundSeed);
+				Barrier.Wait();
+			}
+		}
+	};
+
+	std::vector<std::thread> Workers;
+	for (uint32_t t = 1; t < ThreadNum; ++t)
+	{
+		Workers.emplace_back(WorkerFunc, t);
+	}
+	WorkerFunc(0);
+	for (auto &Worker : Workers)
+	{
+		Worker.join();
+	}
+
+	for (uint32_t i = 0; i < CellTotal; ++i)
+	{
+		if (Grid.CellUsed[i])
+		{
+			Samples.push_back(Grid.CellSamples[i]);
+		}
+	}
+
+	return Samples;
+}
@@ -0,0 +1,31 @@
+#ifndef _TILED_POISSON_DISK_H_
+#define _TILED_POISSON_DISK_H_
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+namespace Diligent
+{
+	//Poisson disk points on the torus [0, TileSize)^2: distances wrap around the tile borders,
+	//so copies of the tile placed side by side keep the minimum distance across the seams.
+	//
+	//Parallel grid-phase dart throwing: the acceleration grid (same cell sizing as
+	//thinks::PoissonDiskSampling) is split into PhaseDim x PhaseDim interleaved phases whose
+	//cells are too far apart to see each other, so all cells of one phase are filled concurrently.
+	//Random numbers are hashed from (seed, round, cell), so the result does not depend on ThreadNum.
+	struct TiledPoissonDiskDesc
+	{
+		float Radius = 1.0f;
+		float TileSize = 1.0f;
+		uint32_t Seed = 0;
+		uint32_t MaxSampleAttempts = 30;
+
+		//0 - use all hardware threads
+		uint32_t ThreadNum = 0;
+	};
+
+	std::vector<std::array<float, 2>> TiledPoissonDiskSampling(const TiledPoissonDiskDesc &Desc);
+}
+
+#endif
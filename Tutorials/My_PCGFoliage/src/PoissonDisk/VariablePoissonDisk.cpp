@@ -0,0 +1,236 @@
+#include "VariablePoissonDisk.h"
+#include "PoissonDiskSampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	namespace pds = thinks::poisson_disk_sampling_internal;
+
+	//Bucket grid, a cell may hold several points since radii vary.
+	class BucketGrid
+	{
+	public:
+		BucketGrid(const float DomainSize, const float CellSize) :
+			mCellSize(CellSize),
+			mCellNum(std::max(static_cast<int32_t>(std::ceil(DomainSize / CellSize)), 1)),
+			mCellHead(mCellNum * mCellNum, -1)
+		{}
+
+		int32_t CellNum() const { return mCellNum; }
+
+		int32_t AxisIndex(const float Pos) const
+		{
+			return pds::clamped(0, mCellNum - 1, static_cast<int32_t>(Pos / mCellSize));
+		}
+
+		void Add(const std::array<float, 2> &Pos, const int32_t PointIdx)
+		{
+			int32_t Cell = AxisIndex(Pos[1]) * mCellNum + AxisIndex(Pos[0]);
+			mNext.push_back(mCellHead[Cell]);
+			mCellHead[Cell] = PointIdx;
+		}
+
+		int32_t Head(const int32_t x, const int32_t y) const { return mCellHead[y * mCellNum + x]; }
+		int32_t Next(const int32_t PointIdx) const { return mNext[PointIdx]; }
+
+	private:
+		float mCellSize;
+		int32_t mCellNum;
+		std::vector<int32_t> mCellHead;
+		std::vector<int32_t> mNext;
+	};
+}
+
+std::vector<Diligent::VariablePoissonPoint> Diligent::VariablePoissonDiskSampling(const VariablePoissonDiskDesc &Desc, VariablePoissonStats *pStats)
+{
+	std::vector<VariablePoissonPoint> Points;
+	VariablePoissonStats Stats;
+
+	if (!(Desc.DomainSize > 0.0f) || Desc.Types.empty() || !Desc.Density || Desc.MaxSampleAttempts == 0)
+	{
+		if (pStats)
+		{
+			*pStats = Stats;
+		}
+		return Points;
+	}
+
+	const float MaxRadiusScale = std::max(Desc.MaxRadiusScale, 1.0f);
+	const float MinDensity = std::max(Desc.MinDensity, 1e-4f);
+
+	float MaxConflictDistance = 0.0f;
+	float TotalWeight = 0.0f;
+	for (const PoissonPlantType &Type : Desc.Types)
+	{
+		MaxConflictDistance = std::max(MaxConflictDistance, std::max(Type.Radius, Type.Exclusion) * MaxRadiusScale);
+		TotalWeight += std::max(Type.Weight, 0.0f);
+	}
+	if (!(MaxConflictDistance > 0.0f) || !(TotalWeight > 0.0f))
+	{
+		if (pStats)
+		{
+			*pStats = Stats;
+		}
+		return Points;
+	}
+
+	//half the largest conflict distance, neighbours are within 2 cells
+	const int32_t Reach = 2;
+	BucketGrid Grid(Desc.DomainSize, MaxConflictDistance / Reach);
+
+	uint32_t LocalSeed = Desc.Seed;
+
+	auto PickType = [&]() -> uint32_t
+	{
+		float w = pds::NormRand<float>(&LocalSeed) * TotalWeight;
+		for (uint32_t t = 0; t + 1 < Desc.Types.size(); ++t)
+		{
+			w -= std::max(Desc.Types[t].Weight, 0.0f);
+			if (w < 0.0f)
+			{
+				return t;
+			}
+		}
+		return static_cast<uint32_t>(Desc.Types.size() - 1);
+	};
+
+	//Returns false when the position is outside the domain or not placeable.
+	auto MakeCandidate = [&](const std::array<float, 2> &Pos, const uint32_t Type, VariablePoissonPoint &Out) -> bool
+	{
+		++Stats.CandidateNum;
+		if (!(Pos[0] >= 0.0f && Pos[0] < Desc.DomainSize && Pos[1] >= 0.0f && Pos[1] < Desc.DomainSize))
+		{
+			++Stats.RejectedByDensity;
+			return false;
+		}
+
+		float Density = Desc.Density(Pos[0], Pos[1]);
+		if (!(Density >= MinDensity))
+		{
+			++Stats.RejectedByDensity;
+			return false;
+		}
+
+		float Scale = std::min(1.0f / std::sqrt(std::min(Density, 1.0f)), MaxRadiusScale);
+		Out.Pos = Pos;
+		Out.Radius = Desc.Types[Type].Radius * Scale;
+		Out.Type = Type;
+		return true;
+	};
+
+	auto HasConflict = [&](const VariablePoissonPoint &Cand) -> bool
+	{
+		const float CandExclusion = Desc.Types[Cand.Type].Exclusion * Cand.Radius / Desc.Types[Cand.Type].Radius;
+
+		int32_t cx = Grid.AxisIndex(Cand.Pos[0]);
+		int32_t cy = Grid.AxisIndex(Cand.Pos[1]);
+		int32_t MinX = std::max(cx - Reach, 0), MaxX = std::min(cx + Reach, Grid.CellNum() - 1);
+		int32_t MinY = std::max(cy - Reach, 0), MaxY = std::min(cy + Reach, Grid.CellNum() - 1);
+		for (int32_t y = MinY; y <= MaxY; ++y)
+		{
+			for (int32_t x = MinX; x <= MaxX; ++x)
+			{
+				for (int32_t Idx = Grid.Head(x, y); Idx >= 0; Idx = Grid.Next(Idx))
+				{
+					const VariablePoissonPoint &Other = Points[Idx];
+
+					float Limit = 0.0f;
+					if (Other.Type == Cand.Type)
+					{
+						Limit = std::max(Cand.Radius, Other.Radius);
+					}
+					else
+					{
+						float OtherExclusion = Desc.Types[Other.Type].Exclusion * Other.Radius / Desc.Types[Other.Type].Radius;
+						Limit = std::max(CandExclusion, OtherExclusion);
+					}
+
+					float DistSq = pds::squared(Cand.Pos[0] - Other.Pos[0]) + pds::squared(Cand.Pos[1] - Other.Pos[1]);
+					if (DistSq < Limit * Limit)
+					{
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	};
+
+	std::vector<uint32_t> ActiveIndices;
+	auto AddPoint = [&](const VariablePoissonPoint &Point)
+	{
+		int32_t Idx = static_cast<int32_t>(Points.size());
+		Points.push_back(Point);
+		Grid.Add(Point.Pos, Idx);
+		ActiveIndices.push_back(static_cast<uint32_t>(Idx));
+	};
+
+	auto TryAdd = [&](const std::array<float, 2> &Pos)
+	{
+		VariablePoissonPoint Cand;
+		if (!MakeCandidate(Pos, PickType(), Cand))
+		{
+			return false;
+		}
+		if (HasConflict(Cand))
+		{
+			++Stats.RejectedByDistance;
+			return false;
+		}
+		AddPoint(Cand);
+		return true;
+	};
+
+	//Placeable regions may be islands separated by wide unplaceable gaps (roads, cliffs)
+	//that the annulus growth can't cross, so every coarse cell gets seed darts first.
+	const float SeedCellSize = MaxConflictDistance;
+	const int32_t SeedCellNum = std::max(static_cast<int32_t>(std::ceil(Desc.DomainSize / SeedCellSize)), 1);
+	const uint32_t SeedAttempts = 4;
+	for (int32_t sy = 0; sy < SeedCellNum; ++sy)
+	{
+		for (int32_t sx = 0; sx < SeedCellNum; ++sx)
+		{
+			for (uint32_t a = 0; a < SeedAttempts; ++a)
+			{
+				std::array<float, 2> Pos = { { (sx + pds::NormRand<float>(&LocalSeed)) * SeedCellSize,
+					(sy + pds::NormRand<float>(&LocalSeed)) * SeedCellSize } };
+				if (TryAdd(Pos))
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	while (!ActiveIndices.empty())
+	{
+		size_t ActiveIdx = pds::IndexRand(ActiveIndices.size(), &LocalSeed);
+		const VariablePoissonPoint Active = Points[ActiveIndices[ActiveIdx]];
+
+		uint32_t Attempt = 0;
+		for (; Attempt < Desc.MaxSampleAttempts; ++Attempt)
+		{
+			//annulus [r, 2r] around the active point
+			float Angle = pds::NormRand<float>(&LocalSeed) * 6.28318530718f;
+			float Dist = Active.Radius * (1.0f + pds::NormRand<float>(&LocalSeed));
+			std::array<float, 2> Pos = { { Active.Pos[0] + Dist * std::cos(Angle), Active.Pos[1] + Dist * std::sin(Angle) } };
+			if (TryAdd(Pos))
+			{
+				break;
+			}
+		}
+
+		if (Attempt == Desc.MaxSampleAttempts)
+		{
+			pds::EraseUnordered(&ActiveIndices, ActiveIdx);
+		}
+	}
+
+	if (pStats)
+	{
+		*pStats = Stats;
+	}
+	return Points;
+}
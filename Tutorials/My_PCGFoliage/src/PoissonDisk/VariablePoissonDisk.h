@@ -0,0 +1,52 @@
+#ifndef _VARIABLE_POISSON_DISK_H_
+#define _VARIABLE_POISSON_DISK_H_
+
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace Diligent
+{
+	struct PoissonPlantType
+	{
+		float Radius = 1.0f; //min distance to the same type at full density
+		float Exclusion = 1.0f; //min distance to other types at full density
+		float Weight = 1.0f; //relative share of the candidates
+	};
+
+	//Multi-class Poisson disk sampling on [0, DomainSize)^2 with a radius field.
+	//Density(x, y) in [0, 1] scales the local radius by 1 / sqrt(density), so the point
+	//count follows the density. Below MinDensity a position is not placeable and no
+	//point is generated there at all.
+	struct VariablePoissonDiskDesc
+	{
+		float DomainSize = 1.0f;
+		uint32_t Seed = 0;
+		uint32_t MaxSampleAttempts = 30;
+
+		float MinDensity = 0.1f;
+		float MaxRadiusScale = 4.0f;
+
+		std::vector<PoissonPlantType> Types;
+		std::function<float(float, float)> Density;
+	};
+
+	struct VariablePoissonPoint
+	{
+		std::array<float, 2> Pos;
+		float Radius;
+		uint32_t Type;
+	};
+
+	struct VariablePoissonStats
+	{
+		uint32_t CandidateNum = 0;
+		uint32_t RejectedByDensity = 0;
+		uint32_t RejectedByDistance = 0;
+	};
+
+	std::vector<VariablePoissonPoint> VariablePoissonDiskSampling(const VariablePoissonDiskDesc &Desc, VariablePoissonStats *pStats = nullptr);
+}
+
+#endif
@@ -29,13 +29,14 @@
 #include "MapHelper.hpp"
 #include "GroundMesh.h"
 #include "DebugCanvas.h"
+#include "CDLODBenchmark.h"
+#include "TerrainCoreAssets.h"
 #include "imgui.h"
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
 
 namespace Diligent
 {	
-	DebugCanvas gDebugCanvas;
 
 SampleBase* CreateSample()
 {
@@ -142,7 +143,7 @@ void My_Terrain::Initialize(const SampleInitInfo& InitInfo)
     // clang-format on
 
     ShaderCreateInfo ShaderCI;
-	m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &m_pShaderSourceFactory);
+	m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(TERRAIN_CORE_SHADER_DIRS, &m_pShaderSourceFactory);
 	ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
     // Tell the system that the shader source code is in HLSL.
     // For OpenGL, the engine will convert this into GLSL under the hood.
@@ -203,8 +204,99 @@ void My_Terrain::Initialize(const SampleInitInfo& InitInfo)
 	m_Camera.SetLookAt(float3(0, 0, 0));
 
 	m_apClipMap.reset(new GroundMesh(LOD_MESH_GRID_SIZE, LOD_COUNT, 0.115f));
+	m_apClipMap->SetGPUSelection(m_bGPUSelection);
+	m_apClipMap->SetHorizonCulling(m_bHorizonCulling);
 
-	m_apClipMap->InitClipMap(m_pDevice, m_pSwapChain);
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ -5690.0f, -3000.00f, -7090.0f });
+	TerrainDim.Size = float3({ 11380.0f, 3000.0f, 12180.0f });
+	m_apClipMap->InitClipMap(m_pDevice, m_pSwapChain, TerrainDim);
+
+	if (m_bRunSelectLODBenchmark)
+	{
+		SelectLODBenchmarkDesc BenchmarkDesc;
+		BenchmarkDesc.StreamedFileName = m_SelectLODBenchmarkStreamFile;
+		RunSelectLODBenchmark(BenchmarkDesc);
+	}
+
+	if (m_bRunVTPagingSim)
+	{
+		RunVirtualTexturePagingSim(VirtualTexturePagingSimDesc());
+	}
+
+	if (m_bRunGPUSelectValidation)
+	{
+		GPUSelectionValidationDesc ValidationDesc;
+		ValidationDesc.pDevice = m_pDevice;
+		ValidationDesc.pContext = m_pImmediateContext;
+		RunGPUSelectionValidation(ValidationDesc);
+	}
+
+	if (m_bRunHorizonCullingBenchmark)
+	{
+		RunHorizonCullingBenchmark(HorizonCullingBenchmarkDesc());
+	}
+
+	if (m_bRunVertexCacheBenchmark)
+	{
+		RunVertexCacheBenchmark(VertexCacheBenchmarkDesc());
+	}
+
+	if (m_bRunTerrainQueryBenchmark)
+	{
+		RunTerrainQueryBenchmark(TerrainQueryBenchmarkDesc());
+	}
+}
+
+std::string GetArgument(const char*& pos, const char* ArgName);
+
+void My_Terrain::ProcessCommandLine(const char* CmdLine)
+{
+	const auto* pos = strchr(CmdLine, '-');
+	while (pos != nullptr)
+	{
+		++pos;
+		std::string Arg;
+		if (!(Arg = GetArgument(pos, "select_lod_benchmark")).empty())
+		{
+			m_bRunSelectLODBenchmark = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "select_lod_benchmark_stream")).empty())
+		{
+			//tiled heightmap file to write and stream from
+			m_SelectLODBenchmarkStreamFile = Arg;
+		}
+		else if (!(Arg = GetArgument(pos, "vt_paging_sim")).empty())
+		{
+			m_bRunVTPagingSim = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "gpu_select_validate")).empty())
+		{
+			m_bRunGPUSelectValidation = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "gpu_select")).empty())
+		{
+			//lod selection in compute shaders, indirect patch draws
+			m_bGPUSelection = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "horizon_culling")).empty())
+		{
+			m_bHorizonCulling = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "horizon_culling_benchmark")).empty())
+		{
+			m_bRunHorizonCullingBenchmark = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "vertex_cache_benchmark")).empty())
+		{
+			m_bRunVertexCacheBenchmark = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "terrain_query_benchmark")).empty())
+		{
+			m_bRunTerrainQueryBenchmark = Arg == "1" || Arg == "true";
+		}
+		pos = strchr(pos, '-');
+	}
 }
 
 // Render a frame
@@ -346,6 +438,8 @@ void My_Terrain::UpdateUI()
 		float3 CamForward = m_Camera.GetWorldAhead();
 		ImGui::Text("Cam Forward %.2f, %.2f, %.2f", CamForward.x, CamForward.y, CamForward.z);
 		ImGui::gizmo3D("Cam direction", CamForward, ImGui::GetTextLineHeight() * 10);
+		ImGui::Text("Terrain pass CPU %.3f ms, %u patches, %u draws", m_apClipMap->GetRenderCPUTime(),
+			m_apClipMap->GetRenderPatchNum(), m_apClipMap->GetRenderDrawNum());
 	}
 	ImGui::End();
 }
@@ -69,6 +69,8 @@ public:
 
 	virtual void WindowResize(Uint32 Width, Uint32 Height);
 
+	virtual void ProcessCommandLine(const char* CmdLine) override final;
+
 protected:
 	void UpdateUI();
 	void CreateGridBuffer();
@@ -91,6 +93,16 @@ private:
 	MouseState        m_LastMouseState;
 
 	std::shared_ptr<GroundMesh> m_apClipMap;
+
+	bool m_bRunSelectLODBenchmark = false;
+	std::string m_SelectLODBenchmarkStreamFile;
+	bool m_bRunVTPagingSim = false;
+	bool m_bRunGPUSelectValidation = false;
+	bool m_bGPUSelection = false;
+	bool m_bHorizonCulling = false;
+	bool m_bRunHorizonCullingBenchmark = false;
+	bool m_bRunVertexCacheBenchmark = false;
+	bool m_bRunTerrainQueryBenchmark = false;
 };
 
 } // namespace Diligent
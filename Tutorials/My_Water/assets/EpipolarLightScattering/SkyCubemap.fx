@@ -0,0 +1,91 @@
+// SkyCubemap.fx
+// Sky-only mode: evaluates unshadowed inscattering from the precomputed scattering look-up
+// tables for every texel of a cube map. One dispatch writes all six faces, the epipolar
+// passes are not used.
+
+#include "assets/BasicStructures.fxh"
+#include "assets/EpipolarLightScattering/AtmosphereShadersCommon.fxh"
+
+#ifndef THREAD_GROUP_SIZE
+#   define THREAD_GROUP_SIZE 8
+#endif
+
+cbuffer cbParticipatingMediaScatteringParams
+{
+    AirScatteringAttribs g_MediaParams;
+}
+
+// f4Position is the cube map centre, f4ViewportSize is the face size
+cbuffer cbCameraAttribs
+{
+    CameraAttribs g_CameraAttribs;
+}
+
+cbuffer cbLightParams
+{
+    LightAttribs g_LightAttribs;
+}
+
+cbuffer cbPostProcessingAttribs
+{
+    EpipolarLightScatteringAttribs g_PPAttribs;
+};
+
+Texture2D<float2> g_tex2DOccludedNetDensityToAtmTop;
+SamplerState      g_tex2DOccludedNetDensityToAtmTop_sampler;
+
+Texture3D<float3> g_tex3DSingleSctrLUT;
+SamplerState      g_tex3DSingleSctrLUT_sampler;
+
+Texture3D<float3> g_tex3DHighOrderSctrLUT;
+SamplerState      g_tex3DHighOrderSctrLUT_sampler;
+
+Texture3D<float3> g_tex3DMultipleSctrLUT;
+SamplerState      g_tex3DMultipleSctrLUT_sampler;
+
+RWTexture2DArray</*format = rgba16f*/float4> g_rwtex2DSkyCubemap;
+
+#include "assets/EpipolarLightScattering/LookUpTables.fxh"
+#include "assets/EpipolarLightScattering/ScatteringIntegrals.fxh"
+#include "assets/EpipolarLightScattering/Extinction.fxh"
+#include "assets/EpipolarLightScattering/UnshadowedScattering.fxh"
+
+// Direction through the texel of a face, f2XY in [-1, 1] with y pointing down,
+// faces in the order +X, -X, +Y, -Y, +Z, -Z
+float3 CubemapFaceDir(uint uiFace, float2 f2XY)
+{
+    float3 f3Dir;
+    if (uiFace == 0u)
+        f3Dir = float3( 1.0,     -f2XY.y, -f2XY.x);
+    else if (uiFace == 1u)
+        f3Dir = float3(-1.0,     -f2XY.y,  f2XY.x);
+    else if (uiFace == 2u)
+        f3Dir = float3( f2XY.x,   1.0,     f2XY.y);
+    else if (uiFace == 3u)
+        f3Dir = float3( f2XY.x,  -1.0,    -f2XY.y);
+    else if (uiFace == 4u)
+        f3Dir = float3( f2XY.x,  -f2XY.y,  1.0);
+    else
+        f3Dir = float3(-f2XY.x,  -f2XY.y, -1.0);
+    return normalize(f3Dir);
+}
+
+[numthreads(THREAD_GROUP_SIZE, THREAD_GROUP_SIZE, 1)]
+void RenderSkyCubemapCS(uint3 ThreadId : SV_DispatchThreadID)
+{
+    float fFaceSize = g_CameraAttribs.f4ViewportSize.x;
+    if (float(ThreadId.x) >= fFaceSize || float(ThreadId.y) >= fFaceSize)
+        return;
+
+    float2 f2XY = (float2(ThreadId.xy) + float2(0.5, 0.5)) * g_CameraAttribs.f4ViewportSize.zw * 2.0 - float2(1.0, 1.0);
+    float3 f3ViewDir = CubemapFaceDir(ThreadId.z, f2XY);
+
+    float3 f3Inscattering, f3Extinction;
+    ComputeUnshadowedInscatteringAlongRay(g_CameraAttribs.f4Position.xyz, f3ViewDir, +FLT_MAX,
+                                          g_PPAttribs.uiInstrIntegralSteps,
+                                          g_PPAttribs.f4EarthCenter.xyz,
+                                          f3Inscattering, f3Extinction);
+    f3Inscattering *= g_LightAttribs.f4Intensity.rgb;
+
+    g_rwtex2DSkyCubemap[ThreadId] = float4(BoostSkySaturation(f3Inscattering), 1.0);
+}
@@ -307,7 +307,8 @@ EpipolarLightScattering::EpipolarLightScattering(IRenderDevice*              pDe
                                                  TEXTURE_FORMAT              DepthBufferFmt,
                                                  TEXTURE_FORMAT              OffscreenBackBufferFmt,
 												 IShaderSourceInputStreamFactory* pShaderIFactory,
-                                                 const AirScatteringAttribs& ScatteringAttibs) :
+                                                 const AirScatteringAttribs& ScatteringAttibs,
+                                                 const char*                 LUTCacheDirectory) :
     m_BackBufferFmt(BackBufferFmt),
     m_DepthBufferFmt(DepthBufferFmt),
     m_OffscreenBackBufferFmt(OffscreenBackBufferFmt),
@@ -334,6 +335,13 @@ EpipolarLightScattering::EpipolarLightScattering(IRenderDevice*              pDe
         m_iPrecomputedSctrWDim /= 2;
         m_iPrecomputedSctrQDim /= 2;
     }
+    if (deviceCaps.DevType == RENDER_DEVICE_TYPE_GLES)
+    {
+        m_iPrecomputeThreadGroupSize = 8;
+        m_iNumScatteringOrders       = 3;
+    }
+
+    ComputeScatteringCoefficients(m_MediaParams);
 
     // clang-format off
     CreateUniformBuffer(pDevice, sizeof(EpipolarLightScatteringAttribs), "Epipolar Light Scattering Attribs CB", &m_pcbPostProcessingAttribs);
@@ -348,6 +356,7 @@ EpipolarLightScattering::EpipolarLightScattering(IRenderDevice*              pDe
 
         BufferData InitData{&m_MediaParams, CBDesc.uiSizeInBytes};
         pDevice->CreateBuffer(CBDesc, &InitData, &m_pcbMediaAttribs);
+        pDevice->CreateBuffer(CBDesc, &InitData, &m_pcbWorkMediaAttribs);
     }
 
     // clang-format off
@@ -358,15 +367,22 @@ EpipolarLightScattering::EpipolarLightScattering(IRenderDevice*              pDe
     m_pResMapping->AddResource("cbMiscDynamicParams",                  m_pcbMiscParams,            true);
     // clang-format on
 
+    pDevice->CreateResourceMapping(ResourceMappingDesc(), &m_pPrecomputeResMapping);
+    m_pPrecomputeResMapping->AddResource("cbParticipatingMediaScatteringParams", m_pcbWorkMediaAttribs, true);
+
     pDevice->CreateSampler(Sam_LinearClamp, &m_pLinearClampSampler);
     pDevice->CreateSampler(Sam_PointClamp, &m_pPointClampSampler);
     m_pFullScreenTriangleVS = CreateShader(pDevice, "FullScreenTriangleVS.fx", "FullScreenTriangleVS", SHADER_TYPE_VERTEX, pShaderIFactory);
 
-    ComputeScatteringCoefficients(pContext);
+    CreateRandomSphereSamplingTexture(pDevice);
+    CreatePrecomputedLUTTextures(pDevice);
+    CreateAmbientSkyLightTexture(pDevice);
 
-    PrecomputeOpticalDepthTexture(pDevice, pContext);
+    if (LUTCacheDirectory != nullptr)
+        m_pLUTCache.reset(new ScatteringLUTCache(LUTCacheDirectory));
 
-    CreateAmbientSkyLightTexture(pDevice);
+    // Starts reading the tables of the initial attribs, they are waited for on first use
+    BeginLUTUpdate(pContext);
 }
 
 EpipolarLightScattering::~EpipolarLightScattering()
@@ -394,42 +410,167 @@ void EpipolarLightScattering::DefineMacros(ShaderMacroHelper& Macros)
     Macros.AddShaderMacro("SINGLE_SCATTERING_MODE",       m_PostProcessingAttribs.iSingleScatteringMode);
     // clang-format on
 
+    Macros.AddShaderMacro("PRECOMPUTED_SCTR_LUT_DIM", GetPrecomputedSctrLUTDimMacro());
+}
+
+void EpipolarLightScattering::DefinePrecomputeMacros(ShaderMacroHelper& Macros) const
+{
+    // Only what the precomputed tables depend on, the cache key is made of these macros.
+    // The scattering and extinction modes of DefineMacros are not used by the precomputation.
+    Macros.AddShaderMacro("PRECOMPUTED_SCTR_LUT_DIM", GetPrecomputedSctrLUTDimMacro());
+    Macros.AddShaderMacro("THREAD_GROUP_SIZE", m_iPrecomputeThreadGroupSize);
+    Macros.AddShaderMacro("NUM_RANDOM_SPHERE_SAMPLES", static_cast<Int32>(m_uiNumRandomSamplesOnSphere));
+}
+
+std::string EpipolarLightScattering::GetPrecomputedSctrLUTDimMacro() const
+{
+    std::stringstream ss;
+    ss << "float4(" << m_iPrecomputedSctrUDim << ".0,"
+       << m_iPrecomputedSctrVDim << ".0,"
+       << m_iPrecomputedSctrWDim << ".0,"
+       << m_iPrecomputedSctrQDim << ".0)";
+    return ss.str();
+}
+
+bool EpipolarLightScattering::ScatteringCoefficientsChanged(const EpipolarLightScatteringAttribs& PPAttribs) const
+{
+    // clang-format off
+    return m_PostProcessingAttribs.bUseCustomSctrCoeffs    != PPAttribs.bUseCustomSctrCoeffs    ||
+           m_PostProcessingAttribs.bUseOzoneApproximation  != PPAttribs.bUseOzoneApproximation  ||
+           m_PostProcessingAttribs.fAerosolDensityScale    != PPAttribs.fAerosolDensityScale    ||
+           m_PostProcessingAttribs.fAerosolAbsorbtionScale != PPAttribs.fAerosolAbsorbtionScale ||
+           (PPAttribs.bUseCustomSctrCoeffs && 
+               (m_PostProcessingAttribs.f4CustomRlghBeta        != PPAttribs.f4CustomRlghBeta ||
+                m_PostProcessingAttribs.f4CustomMieBeta         != PPAttribs.f4CustomMieBeta ||
+                m_PostProcessingAttribs.f4CustomOzoneAbsorption != PPAttribs.f4CustomOzoneAbsorption) );
+    // clang-format on
+}
+
+void EpipolarLightScattering::CreatePrecomputedLUTTextures(IRenderDevice* pDevice)
+{
+    // The techniques bind these textures statically, they are filled in place
+    TextureDesc NetDensityTexDesc;
+    NetDensityTexDesc.Name      = "Occluded Net Density to Atm Top";
+    NetDensityTexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    NetDensityTexDesc.Width     = sm_iNumPrecomputedHeights;
+    NetDensityTexDesc.Height    = sm_iNumPrecomputedAngles;
+    NetDensityTexDesc.Format    = PrecomputedNetDensityTexFmt;
+    NetDensityTexDesc.MipLevels = 1;
+    NetDensityTexDesc.Usage     = USAGE_DEFAULT;
+    NetDensityTexDesc.BindFlags = BIND_SHADER_RESOURCE;
+    pDevice->CreateTexture(NetDensityTexDesc, nullptr, &m_ptexPrecomputedLUTs[SCATTERING_LUT_NET_DENSITY]);
+
+    TextureDesc PrecomputedSctrTexDesc;
+    PrecomputedSctrTexDesc.Type      = RESOURCE_DIM_TEX_3D;
+    PrecomputedSctrTexDesc.Width     = m_iPrecomputedSctrUDim;
+    PrecomputedSctrTexDesc.Height    = m_iPrecomputedSctrVDim;
+    PrecomputedSctrTexDesc.Depth     = m_iPrecomputedSctrWDim * m_iPrecomputedSctrQDim;
+    PrecomputedSctrTexDesc.MipLevels = 1;
+    PrecomputedSctrTexDesc.Format    = TEX_FORMAT_RGBA16_FLOAT;
+    PrecomputedSctrTexDesc.Usage     = USAGE_DEFAULT;
+    PrecomputedSctrTexDesc.BindFlags = BIND_SHADER_RESOURCE;
+    // clang-format off
+    PrecomputedSctrTexDesc.Name = "Single Scattering LUT";
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexPrecomputedLUTs[SCATTERING_LUT_SINGLE]);
+    PrecomputedSctrTexDesc.Name = "High Order Scattering LUT";
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexPrecomputedLUTs[SCATTERING_LUT_HIGH_ORDER]);
+    PrecomputedSctrTexDesc.Name = "Multiple Scattering LUT";
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexPrecomputedLUTs[SCATTERING_LUT_MULTIPLE]);
+    // clang-format on
+
+    for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+        m_ptexPrecomputedLUTs[t]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
+
+    // clang-format off
+    m_ptex2DOccludedNetDensityToAtmTopSRV = m_ptexPrecomputedLUTs[SCATTERING_LUT_NET_DENSITY]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_ptex3DSingleScatteringSRV           = m_ptexPrecomputedLUTs[SCATTERING_LUT_SINGLE]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_ptex3DHighOrderScatteringSRV        = m_ptexPrecomputedLUTs[SCATTERING_LUT_HIGH_ORDER]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_ptex3DMultipleScatteringSRV         = m_ptexPrecomputedLUTs[SCATTERING_LUT_MULTIPLE]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_pResMapping->AddResource("g_tex2DOccludedNetDensityToAtmTop", m_ptex2DOccludedNetDensityToAtmTopSRV, true);
+    m_pResMapping->AddResource("g_tex3DSingleSctrLUT",              m_ptex3DSingleScatteringSRV,           true);
+    m_pResMapping->AddResource("g_tex3DHighOrderSctrLUT",           m_ptex3DHighOrderScatteringSRV,        true);
+    m_pResMapping->AddResource("g_tex3DMultipleSctrLUT",            m_ptex3DMultipleScatteringSRV,         true);
+    // clang-format on
+}
+
+void EpipolarLightScattering::CreatePrecomputeWorkTextures(IRenderDevice* pDevice)
+{
+    TextureDesc NetDensityTexDesc = m_ptexPrecomputedLUTs[SCATTERING_LUT_NET_DENSITY]->GetDesc();
+    NetDensityTexDesc.Name        = "Occluded Net Density to Atm Top Work";
+    NetDensityTexDesc.BindFlags   = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+    pDevice->CreateTexture(NetDensityTexDesc, nullptr, &m_ptexWorkLUTs[SCATTERING_LUT_NET_DENSITY]);
+
+    TextureDesc PrecomputedSctrTexDesc = m_ptexPrecomputedLUTs[SCATTERING_LUT_SINGLE]->GetDesc();
+    PrecomputedSctrTexDesc.Name        = "Scattering LUT Work";
+    PrecomputedSctrTexDesc.BindFlags   = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexWorkLUTs[SCATTERING_LUT_SINGLE]);
+    // We have to bother with two texture, because HLSL only allows read-write operations on single
+    // component textures
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexWorkLUTs[SCATTERING_LUT_HIGH_ORDER]);
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptex3DWorkHighOrderSctr2);
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptexWorkLUTs[SCATTERING_LUT_MULTIPLE]);
+
+    // We need higher precision to store intermediate data
+    PrecomputedSctrTexDesc.Format = TEX_FORMAT_RGBA32_FLOAT;
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptex3DSctrRadiance);
+    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptex3DInsctrOrder);
+
+    for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+        m_ptexWorkLUTs[t]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
+    m_ptex3DWorkHighOrderSctr2->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
+    m_ptex3DSctrRadiance->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
+    m_ptex3DInsctrOrder->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
+
+    // clang-format off
+    m_pPrecomputeResMapping->AddResource("g_tex2DOccludedNetDensityToAtmTop", m_ptexWorkLUTs[SCATTERING_LUT_NET_DENSITY]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), true);
+    m_pPrecomputeResMapping->AddResource("g_rwtex3DSingleScattering",         m_ptexWorkLUTs[SCATTERING_LUT_SINGLE]->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS),       true);
+    m_pPrecomputeResMapping->AddResource("g_tex3DSingleSctrLUT",              m_ptexWorkLUTs[SCATTERING_LUT_SINGLE]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE),        true);
+    m_pPrecomputeResMapping->AddResource("g_rwtex3DMultipleSctr",             m_ptexWorkLUTs[SCATTERING_LUT_MULTIPLE]->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS),     true);
+    m_pPrecomputeResMapping->AddResource("g_rwtex3DSctrRadiance",             m_ptex3DSctrRadiance->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS),                        true);
+    m_pPrecomputeResMapping->AddResource("g_rwtex3DInsctrOrder",              m_ptex3DInsctrOrder->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS),                         true);
+    // clang-format on
+}
+
+void EpipolarLightScattering::ReleasePrecomputeWorkTextures()
+{
+    // The shader resource bindings hold the work textures as well, they are created again by
+    // the next update
+    // clang-format off
+    for (auto Tech : {RENDER_TECH_PRECOMPUTE_SINGLE_SCATTERING,
+                      RENDER_TECH_COMPUTE_SCATTERING_RADIANCE,
+                      RENDER_TECH_COMPUTE_SCATTERING_ORDER,
+                      RENDER_TECH_INIT_HIGH_ORDER_SCATTERING,
+                      RENDER_TECH_UPDATE_HIGH_ORDER_SCATTERING,
+                      RENDER_TECH_COMBINE_SCATTERING_ORDERS})
+    // clang-format on
     {
-        std::stringstream ss;
-        ss << "float4(" << m_iPrecomputedSctrUDim << ".0,"
-           << m_iPrecomputedSctrVDim << ".0,"
-           << m_iPrecomputedSctrWDim << ".0,"
-           << m_iPrecomputedSctrQDim << ".0)";
-        Macros.AddShaderMacro("PRECOMPUTED_SCTR_LUT_DIM", ss.str());
+        m_RenderTech[Tech].SRB.Release();
     }
+
+    // clang-format off
+    for (const char* Name : {"g_tex2DOccludedNetDensityToAtmTop",
+                             "g_rwtex3DSingleScattering",
+                             "g_tex3DSingleSctrLUT",
+                             "g_tex3DHighOrderSctrLUT",
+                             "g_rwtex3DMultipleSctr",
+                             "g_rwtex3DSctrRadiance",
+                             "g_rwtex3DInsctrOrder"})
+    // clang-format on
+    {
+        m_pPrecomputeResMapping->RemoveResourceByName(Name);
+    }
+
+    for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+        m_ptexWorkLUTs[t].Release();
+    m_ptex3DWorkHighOrderSctr2.Release();
+    m_ptex3DSctrRadiance.Release();
+    m_ptex3DInsctrOrder.Release();
 }
 
 void EpipolarLightScattering::PrecomputeOpticalDepthTexture(IRenderDevice*  pDevice,
                                                             IDeviceContext* pDeviceContext)
 {
-    if (!m_ptex2DOccludedNetDensityToAtmTopSRV)
-    {
-        // Create texture if it has not been created yet.
-        // Do not recreate texture if it already exists as this may
-        // break static resource bindings.
-        TextureDesc TexDesc;
-        TexDesc.Name      = "Occluded Net Density to Atm Top";
-        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
-        TexDesc.Width     = sm_iNumPrecomputedHeights;
-        TexDesc.Height    = sm_iNumPrecomputedAngles;
-        TexDesc.Format    = PrecomputedNetDensityTexFmt;
-        TexDesc.MipLevels = 1;
-        TexDesc.Usage     = USAGE_DEFAULT;
-        TexDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
-        RefCntAutoPtr<ITexture> tex2DOccludedNetDensityToAtmTop;
-        pDevice->CreateTexture(TexDesc, nullptr, &tex2DOccludedNetDensityToAtmTop);
-        m_ptex2DOccludedNetDensityToAtmTopSRV = tex2DOccludedNetDensityToAtmTop->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-        m_ptex2DOccludedNetDensityToAtmTopSRV->SetSampler(m_pLinearClampSampler);
-        m_ptex2DOccludedNetDensityToAtmTopRTV = tex2DOccludedNetDensityToAtmTop->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
-        m_pResMapping->AddResource("g_tex2DOccludedNetDensityToAtmTop", m_ptex2DOccludedNetDensityToAtmTopSRV, false);
-    }
-
-    ITextureView* pRTVs[] = {m_ptex2DOccludedNetDensityToAtmTopRTV};
+    ITextureView* pRTVs[] = {m_ptexWorkLUTs[SCATTERING_LUT_NET_DENSITY]->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET)};
     pDeviceContext->SetRenderTargets(1, pRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
     auto& PrecomputeNetDensityToAtmTopTech = m_RenderTech[RENDER_TECH_PRECOMPUTE_NET_DENSITY_TO_ATM_TOP];
@@ -441,15 +582,121 @@ void EpipolarLightScattering::PrecomputeOpticalDepthTexture(IRenderDevice*  pDev
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
         PrecomputeNetDensityToAtmTopTech.InitializeFullScreenTriangleTechnique(pDevice, "PrecomputeNetDensityToAtmTopPSO", m_pFullScreenTriangleVS,
                                                                                pPrecomputeNetDensityToAtmTopPS, ResourceLayout, PrecomputedNetDensityTexFmt);
-        PrecomputeNetDensityToAtmTopTech.PSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+        // Only the work media attribs buffer is used, the buffer object never changes
+        PrecomputeNetDensityToAtmTopTech.PSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pPrecomputeResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
     }
 
-    PrecomputeNetDensityToAtmTopTech.PrepareSRB(pDevice, m_pResMapping);
+    PrecomputeNetDensityToAtmTopTech.PrepareSRB(pDevice, m_pPrecomputeResMapping);
     PrecomputeNetDensityToAtmTopTech.Render(pDeviceContext);
+}
 
-    m_uiUpToDateResourceFlags |= UpToDateResourceFlags::PrecomputedOpticalDepthTex;
+bool EpipolarLightScattering::PrecomputeLUTStep(IRenderDevice* pDevice, IDeviceContext* pContext, Uint32 uiStep)
+{
+    if (uiStep == 0)
+    {
+        if (!m_ptexWorkLUTs[SCATTERING_LUT_NET_DENSITY])
+            CreatePrecomputeWorkTextures(pDevice);
+        PrecomputeOpticalDepthTexture(pDevice, pContext);
+        return false;
+    }
+    return PrecomputeScatteringLUT(pDevice, pContext, uiStep - 1);
+}
+
+Uint64 EpipolarLightScattering::ComputeLUTCacheKey() const
+{
+    ScatteringLUTKey Key;
+    Key.AddValue(m_WorkMediaParams);
+    Key.AddValue(m_iNumScatteringOrders);
+    Key.AddValue(sm_iNumPrecomputedHeights);
+    Key.AddValue(sm_iNumPrecomputedAngles);
+
+    ShaderMacroHelper Macros;
+    DefinePrecomputeMacros(Macros);
+    Macros.Finalize();
+    Key.Add(static_cast<const ShaderMacro*>(Macros));
+    return Key.Get();
+}
+
+void EpipolarLightScattering::BeginLUTUpdate(IDeviceContext* pContext)
+{
+    // The tables in use and the media attribs they were computed for stay until the new ones
+    // are ready. An update still in progress starts over.
+    m_WorkMediaParams = m_MediaParams;
+    ComputeScatteringCoefficients(m_WorkMediaParams);
+    pContext->UpdateBuffer(m_pcbWorkMediaAttribs, 0, sizeof(m_WorkMediaParams), &m_WorkMediaParams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    m_WorkLUTKey      = ComputeLUTCacheKey();
+    m_uiLUTUpdateStep = 0;
+    if (m_pLUTCache)
+    {
+        m_pLUTCache->BeginLoad(m_WorkLUTKey, m_ptexPrecomputedLUTs);
+        m_LUTUpdate = LUT_UPDATE::Loading;
+    }
+    else
+    {
+        m_LUTUpdate = LUT_UPDATE::Computing;
+    }
+}
+
+void EpipolarLightScattering::UpdatePrecomputedLUTs(IRenderDevice* pDevice, IDeviceContext* pContext)
+{
+    if (m_pLUTCache)
+        m_pLUTCache->Update(pContext);
+
+    // Nothing can be rendered before the first tables, they are waited for. Later updates
+    // advance one step per call while the old tables are used.
+    const bool bWait = !(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedLUTs);
+
+    if (m_LUTUpdate == LUT_UPDATE::Loading)
+    {
+        std::unique_ptr<ScatteringLUTData> pData;
+        if (!m_pLUTCache->PollLoad(bWait, pData))
+            return;
+
+        if (pData)
+        {
+            ScatteringLUTCache::Upload(pContext, *pData, m_ptexPrecomputedLUTs);
+            FinishLUTUpdate(pContext);
+            return;
+        }
+        m_LUTUpdate       = LUT_UPDATE::Computing;
+        m_uiLUTUpdateStep = 0;
+    }
+
+    if (m_LUTUpdate == LUT_UPDATE::Computing)
+    {
+        bool bDone = false;
+        do
+        {
+            bDone = PrecomputeLUTStep(pDevice, pContext, m_uiLUTUpdateStep++);
+        } while (!bDone && bWait);
+
+        if (bDone)
+        {
+            for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+            {
+                CopyTextureAttribs CopyAttribs(m_ptexWorkLUTs[t], RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                               m_ptexPrecomputedLUTs[t], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                pContext->CopyTexture(CopyAttribs);
+            }
+            ReleasePrecomputeWorkTextures();
+            FinishLUTUpdate(pContext);
+
+            if (m_pLUTCache)
+                m_pLUTCache->BeginSave(pDevice, pContext, m_WorkLUTKey, m_ptexPrecomputedLUTs);
+        }
+    }
 }
 
+void EpipolarLightScattering::FinishLUTUpdate(IDeviceContext* pContext)
+{
+    m_MediaParams = m_WorkMediaParams;
+    pContext->UpdateBuffer(m_pcbMediaAttribs, 0, sizeof(m_MediaParams), &m_MediaParams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    m_uiUpToDateResourceFlags |= UpToDateResourceFlags::PrecomputedLUTs;
+    m_uiUpToDateResourceFlags &= ~UpToDateResourceFlags::AmbientSkyLightTex;
+    m_LUTUpdate = LUT_UPDATE::None;
+}
 
 
 void EpipolarLightScattering::CreateRandomSphereSamplingTexture(IRenderDevice* pDevice)
@@ -487,6 +734,7 @@ void EpipolarLightScattering::CreateRandomSphereSamplingTexture(IRenderDevice* p
     m_ptex2DSphereRandomSamplingSRV = ptex2DSphereRandomSampling->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
     m_ptex2DSphereRandomSamplingSRV->SetSampler(m_pLinearClampSampler);
     m_pResMapping->AddResource("g_tex2DSphereRandomSampling", m_ptex2DSphereRandomSamplingSRV, true);
+    m_pPrecomputeResMapping->AddResource("g_tex2DSphereRandomSampling", m_ptex2DSphereRandomSamplingSRV, true);
 }
 
 void EpipolarLightScattering::CreateEpipolarTextures(IRenderDevice* pDevice)
@@ -646,15 +894,17 @@ void EpipolarLightScattering::CreateSliceEndPointsTexture(IRenderDevice* pDevice
     m_pResMapping->AddResource("g_tex2DSliceEndPoints", tex2DSliceEndpointsSRV, false);
 }
 
-void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, IDeviceContext* pContext)
+// Runs one pass of the scattering precomputation on the work textures: single scattering,
+// three passes for every higher scattering order, then the combination of all orders.
+// Returns true after the last pass.
+bool EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, IDeviceContext* pContext, Uint32 uiPass)
 {
-    const int ThreadGroupSize          = pDevice->GetDeviceCaps().DevType == RENDER_DEVICE_TYPE_GLES ? 8 : 16;
+    const int ThreadGroupSize          = m_iPrecomputeThreadGroupSize;
     auto&     PrecomputeSingleSctrTech = m_RenderTech[RENDER_TECH_PRECOMPUTE_SINGLE_SCATTERING];
     if (!PrecomputeSingleSctrTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pPrecomputeSingleSctrCS =
             CreateShader(pDevice, "precompute/PrecomputeSingleScattering.fx", "PrecomputeSingleScatteringCS",
@@ -662,16 +912,14 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         PrecomputeSingleSctrTech.InitializeComputeTechnique(pDevice, "PrecomputeSingleScattering", pPrecomputeSingleSctrCS, ResourceLayout);
-        PrecomputeSingleSctrTech.PrepareSRB(pDevice, m_pResMapping, 0);
     }
+    PrecomputeSingleSctrTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
     auto& ComputeSctrRadianceTech = m_RenderTech[RENDER_TECH_COMPUTE_SCATTERING_RADIANCE];
     if (!ComputeSctrRadianceTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
-        Macros.AddShaderMacro("NUM_RANDOM_SPHERE_SAMPLES", static_cast<Int32>(m_uiNumRandomSamplesOnSphere));
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pComputeSctrRadianceCS =
             CreateShader(pDevice, "precompute/ComputeSctrRadiance.fx", "ComputeSctrRadianceCS",
@@ -679,15 +927,14 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         ComputeSctrRadianceTech.InitializeComputeTechnique(pDevice, "ComputeSctrRadiance", pComputeSctrRadianceCS, ResourceLayout);
-        ComputeSctrRadianceTech.PrepareSRB(pDevice, m_pResMapping, 0);
     }
+    ComputeSctrRadianceTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
     auto& ComputeScatteringOrderTech = m_RenderTech[RENDER_TECH_COMPUTE_SCATTERING_ORDER];
     if (!ComputeScatteringOrderTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pComputeScatteringOrderCS =
             CreateShader(pDevice, "precompute/ComputeScatteringOrder.fx", "ComputeScatteringOrderCS",
@@ -695,15 +942,14 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         ComputeScatteringOrderTech.InitializeComputeTechnique(pDevice, "ComputeScatteringOrder", pComputeScatteringOrderCS, ResourceLayout);
-        ComputeScatteringOrderTech.PrepareSRB(pDevice, m_pResMapping, 0);
     }
+    ComputeScatteringOrderTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
     auto& InitHighOrderScatteringTech = m_RenderTech[RENDER_TECH_INIT_HIGH_ORDER_SCATTERING];
     if (!InitHighOrderScatteringTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pInitHighOrderScatteringCS =
             CreateShader(pDevice, "precompute/InitHighOrderScattering.fx", "InitHighOrderScatteringCS",
@@ -711,15 +957,14 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         InitHighOrderScatteringTech.InitializeComputeTechnique(pDevice, "InitHighOrderScattering", pInitHighOrderScatteringCS, ResourceLayout);
-        InitHighOrderScatteringTech.PrepareSRB(pDevice, m_pResMapping, 0);
     }
+    InitHighOrderScatteringTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
     auto& UpdateHighOrderScatteringTech = m_RenderTech[RENDER_TECH_UPDATE_HIGH_ORDER_SCATTERING];
     if (!UpdateHighOrderScatteringTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pUpdateHighOrderScatteringCS =
             CreateShader(pDevice, "precompute/UpdateHighOrderScattering.fx", "UpdateHighOrderScatteringCS",
@@ -727,15 +972,14 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         UpdateHighOrderScatteringTech.InitializeComputeTechnique(pDevice, "UpdateHighOrderScattering", pUpdateHighOrderScatteringCS, ResourceLayout);
-        UpdateHighOrderScatteringTech.PrepareSRB(pDevice, m_pResMapping, 0);
     }
+    UpdateHighOrderScatteringTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
     auto& CombineScatteringOrdersTech = m_RenderTech[RENDER_TECH_COMBINE_SCATTERING_ORDERS];
     if (!CombineScatteringOrdersTech.PSO)
     {
         ShaderMacroHelper Macros;
-        DefineMacros(Macros);
-        Macros.AddShaderMacro("THREAD_GROUP_SIZE", ThreadGroupSize);
+        DefinePrecomputeMacros(Macros);
         Macros.Finalize();
         auto pCombineScatteringOrdersCS =
             CreateShader(pDevice, "precompute/CombineScatteringOrders.fx", "CombineScatteringOrdersCS",
@@ -743,129 +987,84 @@ void EpipolarLightScattering::PrecomputeScatteringLUT(IRenderDevice* pDevice, ID
         PipelineResourceLayoutDesc ResourceLayout;
         ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
         CombineScatteringOrdersTech.InitializeComputeTechnique(pDevice, "CombineScatteringOrders", pCombineScatteringOrdersCS, ResourceLayout);
-        CombineScatteringOrdersTech.PrepareSRB(pDevice, m_pResMapping, 0);
-    }
-
-    if (!m_ptex2DSphereRandomSamplingSRV)
-        CreateRandomSphereSamplingTexture(pDevice);
-
-    TextureDesc PrecomputedSctrTexDesc;
-    PrecomputedSctrTexDesc.Type      = RESOURCE_DIM_TEX_3D;
-    PrecomputedSctrTexDesc.Width     = m_iPrecomputedSctrUDim;
-    PrecomputedSctrTexDesc.Height    = m_iPrecomputedSctrVDim;
-    PrecomputedSctrTexDesc.Depth     = m_iPrecomputedSctrWDim * m_iPrecomputedSctrQDim;
-    PrecomputedSctrTexDesc.MipLevels = 1;
-    PrecomputedSctrTexDesc.Format    = TEX_FORMAT_RGBA16_FLOAT;
-    PrecomputedSctrTexDesc.Usage     = USAGE_DEFAULT;
-    PrecomputedSctrTexDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-
-    if (!m_ptex3DSingleScatteringSRV)
-    {
-        RefCntAutoPtr<ITexture> ptex3DSingleSctr, ptex3DMultipleSctr;
-        pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &ptex3DSingleSctr);
-        m_ptex3DSingleScatteringSRV = ptex3DSingleSctr->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-        m_ptex3DSingleScatteringSRV->SetSampler(m_pLinearClampSampler);
-        m_pResMapping->AddResource("g_rwtex3DSingleScattering", ptex3DSingleSctr->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), true);
-
-        // We have to bother with two texture, because HLSL only allows read-write operations on single
-        // component textures
-        pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptex3DHighOrderSctr);
-        pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &m_ptex3DHighOrderSctr2);
-        m_ptex3DHighOrderSctr->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
-        m_ptex3DHighOrderSctr2->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pLinearClampSampler);
-
-
-        pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &ptex3DMultipleSctr);
-        m_ptex3DMultipleScatteringSRV = ptex3DMultipleSctr->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-        m_ptex3DMultipleScatteringSRV->SetSampler(m_pLinearClampSampler);
-        m_pResMapping->AddResource("g_rwtex3DMultipleSctr", ptex3DMultipleSctr->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), true);
-
-        m_pResMapping->AddResource("g_tex3DSingleSctrLUT", m_ptex3DSingleScatteringSRV, true);
-
-        m_pResMapping->AddResource("g_tex3DMultipleSctrLUT", m_ptex3DMultipleScatteringSRV, true);
     }
+    CombineScatteringOrdersTech.PrepareSRB(pDevice, m_pPrecomputeResMapping, 0);
 
-    // Precompute single scattering
-    PrecomputeSingleSctrTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+    const auto&            PrecomputedSctrTexDesc = m_ptexWorkLUTs[SCATTERING_LUT_SINGLE]->GetDesc();
     DispatchComputeAttribs DispatchAttrs{
         PrecomputedSctrTexDesc.Width / ThreadGroupSize,
         PrecomputedSctrTexDesc.Height / ThreadGroupSize,
         PrecomputedSctrTexDesc.Depth};
-    PrecomputeSingleSctrTech.DispatchCompute(pContext, DispatchAttrs);
 
-    // Precompute multiple scattering
-    // We need higher precision to store intermediate data
-    PrecomputedSctrTexDesc.Format = TEX_FORMAT_RGBA32_FLOAT;
-    RefCntAutoPtr<ITexture>     ptex3DSctrRadiance, ptex3DInsctrOrder;
-    RefCntAutoPtr<ITextureView> ptex3DSctrRadianceSRV, ptex3DInsctrOrderSRV;
-    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &ptex3DSctrRadiance);
-    pDevice->CreateTexture(PrecomputedSctrTexDesc, nullptr, &ptex3DInsctrOrder);
-    ptex3DSctrRadianceSRV = ptex3DSctrRadiance->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    ptex3DInsctrOrderSRV  = ptex3DInsctrOrder->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    ptex3DSctrRadianceSRV->SetSampler(m_pLinearClampSampler);
-    ptex3DInsctrOrderSRV->SetSampler(m_pLinearClampSampler);
-    m_pResMapping->AddResource("g_rwtex3DSctrRadiance", ptex3DSctrRadiance->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), true);
-    m_pResMapping->AddResource("g_rwtex3DInsctrOrder", ptex3DInsctrOrder->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), true);
-
-
-    ComputeSctrRadianceTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, 0);
-    ComputeScatteringOrderTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, 0);
-    InitHighOrderScatteringTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, 0);
-    UpdateHighOrderScatteringTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, 0);
-
-    const int iNumScatteringOrders = pDevice->GetDeviceCaps().DevType == RENDER_DEVICE_TYPE_GLES ? 3 : 4;
-    for (int iSctrOrder = 1; iSctrOrder < iNumScatteringOrders; ++iSctrOrder)
-    {
-        // Step 1: compute differential in-scattering
-        ComputeSctrRadianceTech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DPreviousSctrOrder")->Set((iSctrOrder == 1) ? m_ptex3DSingleScatteringSRV : ptex3DInsctrOrderSRV);
-        ComputeSctrRadianceTech.DispatchCompute(pContext, DispatchAttrs);
-
-        // It seemse like on Intel GPU, the driver accumulates work into big batch.
-        // The resulting batch turns out to be too big for GPU to process it in allowed time
-        // limit, and the system kills the driver. So we have to flush the command buffer to
-        // force execution of compute shaders.
-        pContext->Flush();
-
-        // Step 2: integrate differential in-scattering
-        ComputeScatteringOrderTech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DPointwiseSctrRadiance")->Set(ptex3DSctrRadianceSRV);
-        ComputeScatteringOrderTech.DispatchCompute(pContext, DispatchAttrs);
-
-        RenderTechnique* pRenderTech = nullptr;
-        // Step 3: accumulate high-order scattering scattering
-        if (iSctrOrder == 1)
-        {
-            pRenderTech = &m_RenderTech[RENDER_TECH_INIT_HIGH_ORDER_SCATTERING];
-        }
-        else
-        {
-            pRenderTech = &m_RenderTech[RENDER_TECH_UPDATE_HIGH_ORDER_SCATTERING];
-            std::swap(m_ptex3DHighOrderSctr, m_ptex3DHighOrderSctr2);
-            pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DHighOrderOrderScattering")->Set(m_ptex3DHighOrderSctr2->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-        }
-        pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_rwtex3DHighOrderSctr")->Set(m_ptex3DHighOrderSctr->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
-        pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DCurrentOrderScattering")->Set(ptex3DInsctrOrderSRV);
-        pRenderTech->DispatchCompute(pContext, DispatchAttrs);
+    ITextureView* ptex3DSingleSctrSRV   = m_ptexWorkLUTs[SCATTERING_LUT_SINGLE]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    ITextureView* ptex3DSctrRadianceSRV = m_ptex3DSctrRadiance->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    ITextureView* ptex3DInsctrOrderSRV  = m_ptex3DInsctrOrder->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
 
-        // Flush the command buffer to force execution of compute shaders and avoid device
-        // reset on low-end Intel GPUs.
-        pContext->Flush();
+    const Uint32 uiNumOrderPasses = 3 * (m_iNumScatteringOrders - 1);
+    if (uiPass == 0)
+    {
+        // Precompute single scattering
+        PrecomputeSingleSctrTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pPrecomputeResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+        PrecomputeSingleSctrTech.DispatchCompute(pContext, DispatchAttrs);
     }
+    else if (uiPass <= uiNumOrderPasses)
+    {
+        // Precompute multiple scattering
+        const int iSctrOrder = 1 + static_cast<int>(uiPass - 1) / 3;
+        switch ((uiPass - 1) % 3)
+        {
+            case 0:
+                // Step 1: compute differential in-scattering
+                ComputeSctrRadianceTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pPrecomputeResMapping, 0);
+                ComputeSctrRadianceTech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DPreviousSctrOrder")->Set((iSctrOrder == 1) ? ptex3DSingleSctrSRV : ptex3DInsctrOrderSRV);
+                ComputeSctrRadianceTech.DispatchCompute(pContext, DispatchAttrs);
+                break;
 
-    // Note that m_ptex3DHighOrderSctr and m_ptex3DHighOrderSctr2 are ping-ponged during pre-processing
-    m_ptex3DHighOrderScatteringSRV = m_ptex3DHighOrderSctr->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    m_ptex3DHighOrderScatteringSRV->SetSampler(m_pLinearClampSampler);
-    m_pResMapping->AddResource("g_tex3DHighOrderSctrLUT", m_ptex3DHighOrderScatteringSRV, false);
+            case 1:
+                // Step 2: integrate differential in-scattering
+                ComputeScatteringOrderTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pPrecomputeResMapping, 0);
+                ComputeScatteringOrderTech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DPointwiseSctrRadiance")->Set(ptex3DSctrRadianceSRV);
+                ComputeScatteringOrderTech.DispatchCompute(pContext, DispatchAttrs);
+                break;
 
+            case 2:
+            {
+                RenderTechnique* pRenderTech = nullptr;
+                // Step 3: accumulate high-order scattering scattering
+                if (iSctrOrder == 1)
+                {
+                    pRenderTech = &InitHighOrderScatteringTech;
+                }
+                else
+                {
+                    pRenderTech = &UpdateHighOrderScatteringTech;
+                    std::swap(m_ptexWorkLUTs[SCATTERING_LUT_HIGH_ORDER], m_ptex3DWorkHighOrderSctr2);
+                    pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DHighOrderOrderScattering")->Set(m_ptex3DWorkHighOrderSctr2->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+                }
+                pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_rwtex3DHighOrderSctr")->Set(m_ptexWorkLUTs[SCATTERING_LUT_HIGH_ORDER]->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+                pRenderTech->SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_tex3DCurrentOrderScattering")->Set(ptex3DInsctrOrderSRV);
+                pRenderTech->DispatchCompute(pContext, DispatchAttrs);
+                break;
+            }
+        }
+    }
+    else
+    {
+        // Note that the high order scattering textures are ping-ponged during pre-processing
+        m_pPrecomputeResMapping->AddResource("g_tex3DHighOrderSctrLUT", m_ptexWorkLUTs[SCATTERING_LUT_HIGH_ORDER]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), false);
 
-    // Combine single scattering and higher order scattering into single texture
-    CombineScatteringOrdersTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
-    CombineScatteringOrdersTech.DispatchCompute(pContext, DispatchAttrs);
+        // Combine single scattering and higher order scattering into single texture
+        CombineScatteringOrdersTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pPrecomputeResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+        CombineScatteringOrdersTech.DispatchCompute(pContext, DispatchAttrs);
+    }
 
-    // Remove temporary textures from the resource mapping
-    m_pResMapping->RemoveResourceByName("g_rwtex3DSctrRadiance");
-    m_pResMapping->RemoveResourceByName("g_rwtex3DInsctrOrder");
+    // It seemse like on Intel GPU, the driver accumulates work into big batch.
+    // The resulting batch turns out to be too big for GPU to process it in allowed time
+    // limit, and the system kills the driver. So we have to flush the command buffer to
+    // force execution of compute shaders.
+    pContext->Flush();
 
-    m_uiUpToDateResourceFlags |= UpToDateResourceFlags::PrecomputedIntegralsTex;
+    return uiPass == uiNumOrderPasses + 1;
 }
 
 void EpipolarLightScattering::CreateLowResLuminanceTexture(IRenderDevice* pDevice, IDeviceContext* pDeviceCtx)
@@ -2241,16 +2440,7 @@ void EpipolarLightScattering::PrepareForNewFrame(FrameAttribs&
     //    m_ptex2DEpipolarExtinctionRTV.Release();
     //}
 
-    // clang-format off
-    bool bRecomputeSctrCoeffs = m_PostProcessingAttribs.bUseCustomSctrCoeffs    != PPAttribs.bUseCustomSctrCoeffs    ||
-                                m_PostProcessingAttribs.bUseOzoneApproximation  != PPAttribs.bUseOzoneApproximation  ||
-                                m_PostProcessingAttribs.fAerosolDensityScale    != PPAttribs.fAerosolDensityScale    ||
-                                m_PostProcessingAttribs.fAerosolAbsorbtionScale != PPAttribs.fAerosolAbsorbtionScale ||
-                                (PPAttribs.bUseCustomSctrCoeffs && 
-                                    (m_PostProcessingAttribs.f4CustomRlghBeta        != PPAttribs.f4CustomRlghBeta ||
-                                     m_PostProcessingAttribs.f4CustomMieBeta         != PPAttribs.f4CustomMieBeta ||
-                                     m_PostProcessingAttribs.f4CustomOzoneAbsorption != PPAttribs.f4CustomOzoneAbsorption) );
-    // clang-format on
+    bool bRecomputeSctrCoeffs = ScatteringCoefficientsChanged(PPAttribs);
 
     m_PostProcessingAttribs = PPAttribs;
 
@@ -2319,10 +2509,7 @@ void EpipolarLightScattering::PrepareForNewFrame(FrameAttribs&
 
     if (bRecomputeSctrCoeffs)
     {
-        m_uiUpToDateResourceFlags &= ~UpToDateResourceFlags::PrecomputedOpticalDepthTex;
-        m_uiUpToDateResourceFlags &= ~UpToDateResourceFlags::AmbientSkyLightTex;
-        m_uiUpToDateResourceFlags &= ~UpToDateResourceFlags::PrecomputedIntegralsTex;
-        ComputeScatteringCoefficients(m_FrameAttribs.pDeviceContext);
+        BeginLUTUpdate(m_FrameAttribs.pDeviceContext);
     }
 
     if (!m_ptex2DCoordinateTextureRTV)
@@ -2363,17 +2550,7 @@ void EpipolarLightScattering::PerformPostProcessing()
     // (CreateLowResLuminanceTexture changes render targets). If they are moved to
     // PrepareForNewFrame, an application must be required to restore states afterwards
 
-    if (!(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedOpticalDepthTex))
-    {
-        PrecomputeOpticalDepthTexture(m_FrameAttribs.pDevice, m_FrameAttribs.pDeviceContext);
-    }
-
-    if ((m_PostProcessingAttribs.iMultipleScatteringMode > MULTIPLE_SCTR_MODE_NONE ||
-         m_PostProcessingAttribs.iSingleScatteringMode == SINGLE_SCTR_MODE_LUT) &&
-        !(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedIntegralsTex))
-    {
-        PrecomputeScatteringLUT(m_FrameAttribs.pDevice, m_FrameAttribs.pDeviceContext);
-    }
+    UpdatePrecomputedLUTs(m_FrameAttribs.pDevice, m_FrameAttribs.pDeviceContext);
 
     if (/*m_PostProcessingAttribs.ToneMapping.bAutoExposure &&*/ !m_ptex2DLowResLuminanceRTV)
     {
@@ -2460,6 +2637,143 @@ void EpipolarLightScattering::PerformPostProcessing()
     }    
 }
 
+void EpipolarLightScattering::RenderSkyCubemap(IRenderDevice*                        pDevice,
+                                               IDeviceContext*                       pContext,
+                                               const LightAttribs&                   Light,
+                                               const float3&                         f3Position,
+                                               const EpipolarLightScatteringAttribs& PPAttribs,
+                                               ITextureView*                         pDstCubemapUAV)
+{
+    DEV_CHECK_ERR(pDstCubemapUAV != nullptr, "Destination cube map UAV must not be null");
+    DEV_CHECK_ERR(pDstCubemapUAV->GetDesc().ViewType == TEXTURE_VIEW_UNORDERED_ACCESS, "Destination cube map view must be an unordered access view");
+    DEV_CHECK_ERR(pDstCubemapUAV->GetDesc().NumArraySlices == 6, "Destination cube map UAV must cover all six faces");
+
+    // Integrating single scattering per texel is what the look-up tables are precomputed for
+    const Int32 iSingleScatteringMode = PPAttribs.iSingleScatteringMode == SINGLE_SCTR_MODE_INTEGRATION ? SINGLE_SCTR_MODE_LUT : PPAttribs.iSingleScatteringMode;
+
+    // Only the scattering settings are taken over. The epipolar resources are sized after the
+    // attribs of the last PrepareForNewFrame, which the next one still compares against.
+    Uint32 StalePSODependencyFlags = 0;
+    StalePSODependencyFlags |= (iSingleScatteringMode != m_PostProcessingAttribs.iSingleScatteringMode) ? PSO_DEPENDENCY_SINGLE_SCATTERING_MODE : 0;
+    StalePSODependencyFlags |= (PPAttribs.iMultipleScatteringMode != m_PostProcessingAttribs.iMultipleScatteringMode) ? PSO_DEPENDENCY_MULTIPLE_SCATTERING_MODE : 0;
+    for (int i = 0; i < RENDER_TECH_TOTAL_TECHNIQUES; ++i)
+        m_RenderTech[i].CheckStaleFlags(StalePSODependencyFlags, 0);
+
+    const bool bRecomputeSctrCoeffs = ScatteringCoefficientsChanged(PPAttribs);
+
+    // clang-format off
+    m_PostProcessingAttribs.iSingleScatteringMode   = iSingleScatteringMode;
+    m_PostProcessingAttribs.iMultipleScatteringMode = PPAttribs.iMultipleScatteringMode;
+    m_PostProcessingAttribs.uiInstrIntegralSteps    = PPAttribs.uiInstrIntegralSteps;
+    m_PostProcessingAttribs.f4EarthCenter           = PPAttribs.f4EarthCenter;
+    m_PostProcessingAttribs.bUseCustomSctrCoeffs    = PPAttribs.bUseCustomSctrCoeffs;
+    m_PostProcessingAttribs.bUseOzoneApproximation  = PPAttribs.bUseOzoneApproximation;
+    m_PostProcessingAttribs.fAerosolDensityScale    = PPAttribs.fAerosolDensityScale;
+    m_PostProcessingAttribs.fAerosolAbsorbtionScale = PPAttribs.fAerosolAbsorbtionScale;
+    m_PostProcessingAttribs.f4CustomRlghBeta        = PPAttribs.f4CustomRlghBeta;
+    m_PostProcessingAttribs.f4CustomMieBeta         = PPAttribs.f4CustomMieBeta;
+    m_PostProcessingAttribs.f4CustomOzoneAbsorption = PPAttribs.f4CustomOzoneAbsorption;
+    // clang-format on
+
+    if (bRecomputeSctrCoeffs)
+    {
+        BeginLUTUpdate(pContext);
+    }
+
+    UpdatePrecomputedLUTs(pDevice, pContext);
+
+    const auto& CubemapDesc = pDstCubemapUAV->GetTexture()->GetDesc();
+
+    // The effect's own buffers are used, the ones of the frame attribs are left alone
+    if (!m_pcbCameraAttribs)
+    {
+        CreateUniformBuffer(pDevice, sizeof(CameraAttribs), "Camera attribs", &m_pcbCameraAttribs);
+    }
+    if (!m_pcbLightAttribs)
+    {
+        CreateUniformBuffer(pDevice, sizeof(LightAttribs), "Light attribs", &m_pcbLightAttribs);
+    }
+    {
+        MapHelper<CameraAttribs> CamAttribs(pContext, m_pcbCameraAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CamAttribs                = CameraAttribs{};
+        CamAttribs->f4Position     = float4(f3Position, 1.f);
+        CamAttribs->f4ViewportSize = float4(static_cast<float>(CubemapDesc.Width), static_cast<float>(CubemapDesc.Height),
+                                            1.f / static_cast<float>(CubemapDesc.Width), 1.f / static_cast<float>(CubemapDesc.Height));
+    }
+    {
+        MapHelper<LightAttribs> LightAttribsData(pContext, m_pcbLightAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+        *LightAttribsData = Light;
+    }
+    {
+        MapHelper<EpipolarLightScatteringAttribs> pPPAttribsBuffData(pContext, m_pcbPostProcessingAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+        memcpy(pPPAttribsBuffData, &m_PostProcessingAttribs, sizeof(m_PostProcessingAttribs));
+    }
+
+    // clang-format off
+    m_pResMapping->AddResource("cbCameraAttribs", m_pcbCameraAttribs, false);
+    m_pResMapping->AddResource("cbLightParams",   m_pcbLightAttribs,  false);
+    // clang-format on
+
+    const Uint32 ThreadGroupSize = 8;
+    auto&        RenderSkyCubemapTech = m_RenderTech[RENDER_TECH_RENDER_SKY_CUBEMAP];
+    if (!RenderSkyCubemapTech.PSO)
+    {
+        ShaderMacroHelper Macros;
+        DefineMacros(Macros);
+        Macros.AddShaderMacro("THREAD_GROUP_SIZE", static_cast<Int32>(ThreadGroupSize));
+        Macros.Finalize();
+        auto pRenderSkyCubemapCS =
+            CreateShader(pDevice, "SkyCubemap.fx", "RenderSkyCubemapCS", SHADER_TYPE_COMPUTE, m_pShaderIFactory, Macros);
+
+        std::unordered_set<std::string> ResourceNames;
+        const auto                      ResCount = pRenderSkyCubemapCS->GetResourceCount();
+        for (Uint32 r = 0; r < ResCount; ++r)
+        {
+            ShaderResourceDesc ResourceDesc;
+            pRenderSkyCubemapCS->GetResourceDesc(r, ResourceDesc);
+            ResourceNames.emplace(ResourceDesc.Name);
+        }
+
+        // clang-format off
+        const std::array<std::string, 4> LinearClampTextures =
+        {
+            std::string{"g_tex3DSingleSctrLUT"},
+            std::string{"g_tex3DHighOrderSctrLUT"},
+            std::string{"g_tex3DMultipleSctrLUT"},
+            std::string{"g_tex2DOccludedNetDensityToAtmTop"}
+        };
+        // clang-format on
+        std::vector<ImmutableSamplerDesc> ImtblSamplers;
+        for (const auto& Tex : LinearClampTextures)
+        {
+            if (ResourceNames.find(Tex) != ResourceNames.end())
+                ImtblSamplers.emplace_back(SHADER_TYPE_COMPUTE, Tex.c_str(), Sam_LinearClamp);
+        }
+
+        PipelineResourceLayoutDesc ResourceLayout;
+        ResourceLayout.DefaultVariableType  = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+        ResourceLayout.ImmutableSamplers    = ImtblSamplers.data();
+        ResourceLayout.NumImmutableSamplers = static_cast<Uint32>(ImtblSamplers.size());
+        RenderSkyCubemapTech.InitializeComputeTechnique(pDevice, "RenderSkyCubemap", pRenderSkyCubemapCS, ResourceLayout);
+        RenderSkyCubemapTech.PrepareSRB(pDevice, m_pResMapping, 0);
+
+        RenderSkyCubemapTech.PSODependencyFlags =
+            PSO_DEPENDENCY_SINGLE_SCATTERING_MODE |
+            PSO_DEPENDENCY_MULTIPLE_SCATTERING_MODE;
+    }
+
+    // The look-up tables may have been recomputed, all variables are dynamic and bound every time
+    m_pResMapping->AddResource("g_rwtex2DSkyCubemap", pDstCubemapUAV, false);
+    RenderSkyCubemapTech.SRB->BindResources(SHADER_TYPE_COMPUTE, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+    m_pResMapping->RemoveResourceByName("g_rwtex2DSkyCubemap");
+
+    DispatchComputeAttribs DispatchAttrs{
+        (CubemapDesc.Width + ThreadGroupSize - 1) / ThreadGroupSize,
+        (CubemapDesc.Height + ThreadGroupSize - 1) / ThreadGroupSize,
+        6};
+    RenderSkyCubemapTech.DispatchCompute(pContext, DispatchAttrs);
+}
+
 
 void EpipolarLightScattering::CreateMinMaxShadowMap(IRenderDevice* pDevice)
 {
@@ -2568,7 +2882,7 @@ void EpipolarLightScattering::ComputeSunColor(const float3& vDirectionOnSun,
     (float3&)f4SunColorAtGround    = ((float3&)f4ExtraterrestrialSunColor) * f3TotalExtinction * fEarthReflectance;
 }
 
-void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDeviceCtx)
+void EpipolarLightScattering::ComputeScatteringCoefficients(AirScatteringAttribs& MediaParams) const
 {
     // For details, see "A practical Analytic Model for Daylight" by Preetham & Hoffman, p.23
 
@@ -2584,9 +2898,9 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
 
     // Calculate angular and total scattering coefficients for Rayleigh scattering:
     {
-        float4& f4AngularRayleighSctrCoeff = m_MediaParams.f4AngularRayleighSctrCoeff;
-        float4& f4TotalRayleighSctrCoeff   = m_MediaParams.f4TotalRayleighSctrCoeff;
-        float4& f4RayleighExtinctionCoeff  = m_MediaParams.f4RayleighExtinctionCoeff;
+        float4& f4AngularRayleighSctrCoeff = MediaParams.f4AngularRayleighSctrCoeff;
+        float4& f4TotalRayleighSctrCoeff   = MediaParams.f4TotalRayleighSctrCoeff;
+        float4& f4RayleighExtinctionCoeff  = MediaParams.f4RayleighExtinctionCoeff;
 
         constexpr double n  = 1.0003;    // - Refractive index of air in the visible spectrum
         constexpr double N  = 2.545e+25; // - Number of molecules per unit volume
@@ -2631,7 +2945,7 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
 
         if (m_PostProcessingAttribs.bUseCustomSctrCoeffs)
         {
-            m_MediaParams.f4RayleighExtinctionCoeff += m_PostProcessingAttribs.f4CustomOzoneAbsorption;
+            MediaParams.f4RayleighExtinctionCoeff += m_PostProcessingAttribs.f4CustomOzoneAbsorption;
         }
         else
         {
@@ -2641,15 +2955,15 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
             //     Eurographics Symposium on Rendering 2020
 
             const float4 f4OzoneAbsorption = float4{0.650f, 1.881f, 0.085f, 0.f} * 1e-6f;
-            m_MediaParams.f4RayleighExtinctionCoeff += f4OzoneAbsorption;
+            MediaParams.f4RayleighExtinctionCoeff += f4OzoneAbsorption;
         }
     }
 
     // Calculate angular and total scattering coefficients for Mie scattering:
     {
-        float4& f4AngularMieSctrCoeff = m_MediaParams.f4AngularMieSctrCoeff;
-        float4& f4TotalMieSctrCoeff   = m_MediaParams.f4TotalMieSctrCoeff;
-        float4& f4MieExtinctionCoeff  = m_MediaParams.f4MieExtinctionCoeff;
+        float4& f4AngularMieSctrCoeff = MediaParams.f4AngularMieSctrCoeff;
+        float4& f4TotalMieSctrCoeff   = MediaParams.f4TotalMieSctrCoeff;
+        float4& f4MieExtinctionCoeff  = MediaParams.f4MieExtinctionCoeff;
 
         if (m_PostProcessingAttribs.bUseCustomSctrCoeffs)
         {
@@ -2669,12 +2983,12 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
                         (0.668532 + 0.669765) / 2.0 // (K[470nm]+K[480nm])/2
                     };
 
-                VERIFY_EXPR(m_MediaParams.fTurbidity >= 1.f);
+                VERIFY_EXPR(MediaParams.fTurbidity >= 1.f);
 
                 // Beta is an Angstrom's turbidity coefficient and is approximated by:
                 //float beta = 0.04608365822050f * m_fTurbidity - 0.04586025928522f; ???????
 
-                const double     c = (0.6544 * m_MediaParams.fTurbidity - 0.6510) * 1E-16; // concentration factor
+                const double     c = (0.6544 * MediaParams.fTurbidity - 0.6510) * 1E-16; // concentration factor
                 constexpr double v = 4;                                                    // Junge's exponent
 
                 const double dTotalMieBetaTerm = 0.434 * c * PI * pow(2.0 * PI, v - 2);
@@ -2695,7 +3009,7 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
                 // For g=0.76 and MieBetha=2e-5 [BN08] was able to reproduce the same luminance as given by the
                 // reference CIE sky light model
                 const float fMieBethaBN08         = 2e-5f * m_PostProcessingAttribs.fAerosolDensityScale;
-                m_MediaParams.f4TotalMieSctrCoeff = float4(fMieBethaBN08, fMieBethaBN08, fMieBethaBN08, 0);
+                MediaParams.f4TotalMieSctrCoeff   = float4(fMieBethaBN08, fMieBethaBN08, fMieBethaBN08, 0);
             }
         }
 
@@ -2717,20 +3031,15 @@ void EpipolarLightScattering::ComputeScatteringCoefficients(IDeviceContext* pDev
         // Cornette phase function (see Nishita et al. 93):
         // F(theta) = 1/(4*PI) * 3*(1-g^2) / (2*(2+g^2)) * (1+cos^2(theta)) / (1 + g^2 - 2g*cos(theta))^(3/2)
         // 1/(4*PI) is baked into the f4AngularMieSctrCoeff
-        float4& f4CS_g = m_MediaParams.f4CS_g;
-        float   f_g    = m_MediaParams.fAerosolPhaseFuncG;
+        float4& f4CS_g = MediaParams.f4CS_g;
+        float   f_g    = MediaParams.fAerosolPhaseFuncG;
         f4CS_g.x       = 3 * (1.f - f_g * f_g) / (2 * (2.f + f_g * f_g));
         f4CS_g.y       = 1.f + f_g * f_g;
         f4CS_g.z       = -2.f * f_g;
         f4CS_g.w       = 1.f;
     }
 
-    m_MediaParams.f4TotalExtinctionCoeff = m_MediaParams.f4RayleighExtinctionCoeff + m_MediaParams.f4MieExtinctionCoeff;
-
-    if (pDeviceCtx && m_pcbMediaAttribs)
-    {
-        pDeviceCtx->UpdateBuffer(m_pcbMediaAttribs, 0, sizeof(m_MediaParams), &m_MediaParams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    }
+    MediaParams.f4TotalExtinctionCoeff = MediaParams.f4RayleighExtinctionCoeff + MediaParams.f4MieExtinctionCoeff;
 }
 
 
@@ -2806,14 +3115,9 @@ void EpipolarLightScattering::RenderSun(TEXTURE_FORMAT RTVFormat,
 
 void EpipolarLightScattering::ComputeAmbientSkyLightTexture(IRenderDevice* pDevice, IDeviceContext* pContext)
 {
-    if (!(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedOpticalDepthTex))
-    {
-        PrecomputeOpticalDepthTexture(pDevice, pContext);
-    }
-
-    if (!(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedIntegralsTex))
+    if (!(m_uiUpToDateResourceFlags & UpToDateResourceFlags::PrecomputedLUTs))
     {
-        PrecomputeScatteringLUT(pDevice, pContext);
+        UpdatePrecomputedLUTs(pDevice, pContext);
     }
 
     auto& PrecomputeAmbientSkyLightTech = m_RenderTech[RENDER_TECH_PRECOMPUTE_AMBIENT_SKY_LIGHT];
@@ -26,6 +26,8 @@
  */
 #pragma once
 
+#include <memory>
+
 #include "RenderDevice.h"
 #include "DeviceContext.h"
 #include "Buffer.h"
@@ -34,6 +36,7 @@
 #include "TextureView.h"
 #include "RefCntAutoPtr.hpp"
 #include "BasicMath.hpp"
+#include "ScatteringLUTCache.h"
 
 namespace Diligent
 {
@@ -74,13 +77,16 @@ public:
         ITextureView* ptex2DDstDepthBufferDSV = nullptr;        
     };
 
+    /// The precomputed scattering tables are read from and written to LUTCacheDirectory, which
+    /// must exist. Null disables the cache and the tables are computed on first use.
     EpipolarLightScattering(IRenderDevice*              in_pDevice,
                             IDeviceContext*             in_pContext,
                             TEXTURE_FORMAT              BackBufferFmt,
                             TEXTURE_FORMAT              DepthBufferFmt,
                             TEXTURE_FORMAT              OffscreenBackBuffer,
 							IShaderSourceInputStreamFactory* pShaderIFactory,
-                            const AirScatteringAttribs& ScatteringAttibs = AirScatteringAttribs{});
+                            const AirScatteringAttribs& ScatteringAttibs  = AirScatteringAttribs{},
+                            const char*                 LUTCacheDirectory = nullptr);
     ~EpipolarLightScattering();
 
 
@@ -103,6 +109,19 @@ public:
 
     void PerformPostProcessing();
 
+    /// Sky-only mode: evaluates the precomputed scattering look-up tables for every texel of a
+    /// cube map seen from f3Position and writes all six faces with one compute dispatch. The
+    /// epipolar passes, the source buffers and PrepareForNewFrame are not needed. Single
+    /// scattering is always looked up, SINGLE_SCTR_MODE_INTEGRATION is treated as SINGLE_SCTR_MODE_LUT.
+    /// pDstCubemapUAV must be a 2D array UAV of the six faces of a cube map with a format
+    /// compute shaders can store, e.g. RGBA16F.
+    void RenderSkyCubemap(IRenderDevice*                        pDevice,
+                          IDeviceContext*                       pContext,
+                          const LightAttribs&                   Light,
+                          const float3&                         f3Position,
+                          const EpipolarLightScatteringAttribs& PPAttribs,
+                          ITextureView*                         pDstCubemapUAV);
+
 
     IBuffer*      GetMediaAttribsCB() { return m_pcbMediaAttribs; }
     ITextureView* GetPrecomputedNetDensitySRV() { return m_ptex2DOccludedNetDensityToAtmTopSRV; }
@@ -131,10 +150,18 @@ private:
     void RenderSampleLocations();
 
     void PrecomputeOpticalDepthTexture(IRenderDevice* pDevice, IDeviceContext* pContext);
-    void PrecomputeScatteringLUT(IRenderDevice* pDevice, IDeviceContext* pContext);
+    bool PrecomputeScatteringLUT(IRenderDevice* pDevice, IDeviceContext* pContext, Uint32 uiPass);
+    bool PrecomputeLUTStep(IRenderDevice* pDevice, IDeviceContext* pContext, Uint32 uiStep);
+    void CreatePrecomputedLUTTextures(IRenderDevice* pDevice);
+    void CreatePrecomputeWorkTextures(IRenderDevice* pDevice);
+    void ReleasePrecomputeWorkTextures();
+    void BeginLUTUpdate(IDeviceContext* pContext);
+    void UpdatePrecomputedLUTs(IRenderDevice* pDevice, IDeviceContext* pContext);
+    void FinishLUTUpdate(IDeviceContext* pContext);
+    Uint64 ComputeLUTCacheKey() const;
     void CreateRandomSphereSamplingTexture(IRenderDevice* pDevice);
     void ComputeAmbientSkyLightTexture(IRenderDevice* pDevice, IDeviceContext* pContext);
-    void ComputeScatteringCoefficients(IDeviceContext* pDeviceCtx = nullptr);
+    void ComputeScatteringCoefficients(AirScatteringAttribs& MediaParams) const;
     void CreateEpipolarTextures(IRenderDevice* pDevice);
     void CreateSliceEndPointsTexture(IRenderDevice* pDevice);
     void CreateExtinctionTexture(IRenderDevice* pDevice);
@@ -145,6 +172,10 @@ private:
     void CreateMinMaxShadowMap(IRenderDevice* pDevice);
 
     void DefineMacros(class ShaderMacroHelper& Macros);
+    void DefinePrecomputeMacros(class ShaderMacroHelper& Macros) const;
+    std::string GetPrecomputedSctrLUTDimMacro() const;
+
+    bool ScatteringCoefficientsChanged(const EpipolarLightScatteringAttribs& PPAttribs) const;
 
     const TEXTURE_FORMAT m_BackBufferFmt;
     const TEXTURE_FORMAT m_DepthBufferFmt;
@@ -190,6 +221,13 @@ private:
     int m_iPrecomputedSctrWDim = 64;
     int m_iPrecomputedSctrQDim = 16;
 
+    int m_iPrecomputeThreadGroupSize = 16;
+    int m_iNumScatteringOrders       = 4;
+
+    // The look-up tables the techniques sample. They are created once and never replaced as this
+    // would break static resource bindings. New tables are uploaded from the cache or computed
+    // into the work textures and copied over, until then the old ones stay in use.
+    RefCntAutoPtr<ITexture>     m_ptexPrecomputedLUTs[SCATTERING_LUT_NUM];
     RefCntAutoPtr<ITextureView> m_ptex3DSingleScatteringSRV;
     RefCntAutoPtr<ITextureView> m_ptex3DHighOrderScatteringSRV;
     RefCntAutoPtr<ITextureView> m_ptex3DMultipleScatteringSRV;
@@ -206,11 +244,12 @@ private:
     RefCntAutoPtr<ITextureView> m_ptex2DAmbientSkyLightSRV; // 1024 x 1 RGBA16F
     RefCntAutoPtr<ITextureView> m_ptex2DAmbientSkyLightRTV;
     RefCntAutoPtr<ITextureView> m_ptex2DOccludedNetDensityToAtmTopSRV; // 1024 x 1024 RG32F
-    RefCntAutoPtr<ITextureView> m_ptex2DOccludedNetDensityToAtmTopRTV;
 
     RefCntAutoPtr<IShader> m_pFullScreenTriangleVS;
 
     RefCntAutoPtr<IResourceMapping> m_pResMapping;
+    // Work textures and media attribs of a table update, the precomputation techniques bind from here
+    RefCntAutoPtr<IResourceMapping> m_pPrecomputeResMapping;
 
     RefCntAutoPtr<ITextureView> m_ptex2DCoordinateTextureRTV;     // Max Samples X Num Slices   RG32F
     RefCntAutoPtr<ITextureView> m_ptex2DSliceEndpointsRTV;        // Num Slices  X 1            RGBA32F
@@ -301,6 +340,9 @@ private:
         RENDER_TECH_COMBINE_SCATTERING_ORDERS,
         RENDER_TECH_PRECOMPUTE_AMBIENT_SKY_LIGHT,
 
+        // Sky-only mode
+        RENDER_TECH_RENDER_SKY_CUBEMAP,
+
         RENDER_TECH_TOTAL_TECHNIQUES
     };
 
@@ -350,10 +392,15 @@ private:
 
     RefCntAutoPtr<IShaderResourceBinding> m_pComputeMinMaxSMLevelSRB[2];
 
-    RefCntAutoPtr<ITexture> m_ptex3DHighOrderSctr, m_ptex3DHighOrderSctr2;
+    // Only exist while tables are computed. The high order scattering texture is ping-ponged
+    // with m_ptex3DWorkHighOrderSctr2, intermediate orders need higher precision.
+    RefCntAutoPtr<ITexture> m_ptexWorkLUTs[SCATTERING_LUT_NUM];
+    RefCntAutoPtr<ITexture> m_ptex3DWorkHighOrderSctr2;
+    RefCntAutoPtr<ITexture> m_ptex3DSctrRadiance, m_ptex3DInsctrOrder; // RGBA32F
 
     RefCntAutoPtr<IBuffer> m_pcbPostProcessingAttribs;
     RefCntAutoPtr<IBuffer> m_pcbMediaAttribs;
+    RefCntAutoPtr<IBuffer> m_pcbWorkMediaAttribs;
     RefCntAutoPtr<IBuffer> m_pcbMiscParams;
     RefCntAutoPtr<IBuffer> m_pcbLightAttribs;
     RefCntAutoPtr<IBuffer> m_pcbCameraAttribs;
@@ -363,14 +410,26 @@ private:
 
     //const float m_fTurbidity = 1.02f;
     AirScatteringAttribs m_MediaParams;
+    // Attribs the tables of the update in progress are computed for
+    AirScatteringAttribs m_WorkMediaParams;
+
+    enum class LUT_UPDATE
+    {
+        None,
+        Loading,  // reading the cache file on a worker thread
+        Computing // one precomputation step per frame
+    };
+    LUT_UPDATE                          m_LUTUpdate       = LUT_UPDATE::None;
+    Uint32                              m_uiLUTUpdateStep = 0;
+    Uint64                              m_WorkLUTKey      = 0;
+    std::unique_ptr<ScatteringLUTCache> m_pLUTCache;
 
 	IShaderSourceInputStreamFactory* m_pShaderIFactory;
 
     enum UpToDateResourceFlags
     {
-        PrecomputedOpticalDepthTex = 0x01,
-        AmbientSkyLightTex         = 0x02,
-        PrecomputedIntegralsTex    = 0x04
+        PrecomputedLUTs    = 0x01,
+        AmbientSkyLightTex = 0x02
     };
     Uint32 m_uiUpToDateResourceFlags;
 };
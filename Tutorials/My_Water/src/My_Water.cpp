@@ -28,10 +28,13 @@
 #include "My_Water.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <future>
+#include <random>
 
 #include "ShaderMacroHelper.hpp"
 #include "MapHelper.hpp"
-#include "GroundMesh.h"
+#include "WaterMesh.h"
 #include "DebugCanvas.h"
 
 #include "TextureLoader.h"
@@ -44,23 +47,36 @@
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
 
-#include "RenderProfile.h"
+#include "ImGuiProfiler/ProfilerTask.h"
 
 #include "OceanWave.h"
+#include "OceanWaveCPU.h"
+#include "OceanHeightQuery.h"
+#include "OceanFlipbook.h"
 #include "ReflectionProbe.h"
 #include "CommonlyUsedStates.h"
+#include "Benchmark.hpp"
 
 namespace Diligent
 {	
-	RenderProfileMgr gRenderProfileMgr;
-
-	DebugCanvas gDebugCanvas;
 
 SampleBase* CreateSample()
 {
     return new My_Water();
 }
 
+void My_Water::GetEngineInitializationAttribs(RENDER_DEVICE_TYPE DeviceType,
+                                              EngineCreateInfo&  Attribs,
+                                              SwapChainDesc&     SCDesc)
+{
+    SampleBase::GetEngineInitializationAttribs(DeviceType, Attribs, SCDesc);
+    //probe filtering records its faces in parallel, OpenGL has no deferred contexts
+    if (DeviceType != RENDER_DEVICE_TYPE_GL && DeviceType != RENDER_DEVICE_TYPE_GLES)
+    {
+        Attribs.NumDeferredContexts = std::max(Attribs.NumDeferredContexts, Uint32(PROBE_FILTER_CONTEXTS));
+    }
+}
+
 void My_Water::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
@@ -171,13 +187,6 @@ void My_Water::Initialize(const SampleInitInfo& InitInfo)
 
 	m_Camera.SetLookAt(float3(0.0, 0.0, -1000.0));
 
-	m_apClipMap.reset(new GroundMesh(LOD_MESH_GRID_SIZE, LOD_COUNT, 0.115f));
-
-	m_apClipMap->InitClipMap(m_pDevice, m_pSwapChain, &m_ShaderUniformDataMgr);
-
-	//profile
-	gRenderProfileMgr.Initialize(m_pDevice, m_pImmediateContext);	
-
 	//Ocean
 	m_Choppy = true;
 	mWaterTimer.Restart();
@@ -185,15 +194,45 @@ void My_Water::Initialize(const SampleInitInfo& InitInfo)
 	m_Log2_N = std::log2(WATER_FFT_N);
 	m_LastTimerCount = mWaterTimer.GetWaterTime();
 
-	m_pOceanWave = new OceanWave(WATER_FFT_N, m_pDevice, m_pShaderSourceFactory);
-	m_pOceanWave->Init(WATER_FFT_N);
 	m_WaveSwellSetting[0] = new WaveDisplaySetting({1.0f, 1.0f, -30.0f, 100000.0f, 1.0f, 0.198f, 3.3f, 0.01f, 9.8f});
 	m_WaveSwellSetting[1] = new WaveDisplaySetting({0.555f, 1.0f, 0.0f, 300000.0f, 1.0f, 1.0f, 5.82f, 0.01f, 9.8f});
 
+	//a bake plays back the flipbook it wrote
+	if (!m_OceanBakePath.empty() && BakeOceanFlipbookFile())
+	{
+		m_OceanFlipbookPath = m_OceanBakePath;
+	}
+	if (!m_OceanFlipbookPath.empty())
+	{
+		m_apOceanFlipbook.reset(new OceanFlipbook());
+		if (!m_apOceanFlipbook->Load(m_pDevice, m_OceanFlipbookPath.c_str()))
+		{
+			m_apOceanFlipbook.reset();
+		}
+	}
+
+	if (!m_apOceanFlipbook)
+	{
+		m_pOceanWave = new OceanWave(WATER_FFT_N, m_pDevice, m_pShaderSourceFactory);
+
+		//the long far waves barely move in a frame, they are simulated every other one
+		OceanCascadeUpdateDesc CascadeDescs[OCEAN_CASCADE_NUM];
+		CascadeDescs[0].UpdateInterval = 2;
+		m_pOceanWave->Init(WATER_FFT_N, OCEAN_GAUSS_NOISE_SEED, CascadeDescs);
+	}
+
+	m_apClipMap.reset(new WaterMesh(WATER_MESH_GRID_SIZE, LOD_COUNT, 0.115f));
+	m_apClipMap->InitClipMap(m_pDevice, m_pSwapChain, &m_ShaderUniformDataMgr, m_apOceanFlipbook != nullptr,
+		m_bLegacyWaterGeometry ? WaterGeometryMode::LEGACY : WaterGeometryMode::ADAPTIVE);
+
 	//sky
 	const auto& SCDesc = m_pSwapChain->GetDesc();
-	m_apSkyScattering.reset(new EpipolarLightScattering(m_pDevice, m_pImmediateContext, SCDesc.ColorBufferFormat, SCDesc.DepthBufferFormat, TEX_FORMAT_R11G11B10_FLOAT, m_pShaderSourceFactory));
-	m_apSkyScatteringCube.reset(new EpipolarLightScattering(m_pDevice, m_pImmediateContext, TEX_FORMAT_RGBA32_FLOAT, TEX_FORMAT_D32_FLOAT, TEX_FORMAT_R11G11B10_FLOAT, m_pShaderSourceFactory));
+	//the precomputed scattering tables are loaded from the cache directory on a worker thread
+	const char *LUTCacheDir = m_AtmosphereLUTCacheDir.empty() ? nullptr : m_AtmosphereLUTCacheDir.c_str();
+	m_apSkyScattering.reset(new EpipolarLightScattering(m_pDevice, m_pImmediateContext, SCDesc.ColorBufferFormat, SCDesc.DepthBufferFormat, TEX_FORMAT_R11G11B10_FLOAT, m_pShaderSourceFactory, \
+		AirScatteringAttribs{}, LUTCacheDir));
+	m_apSkyScatteringCube.reset(new EpipolarLightScattering(m_pDevice, m_pImmediateContext, EnvCubemapFmt, TEX_FORMAT_D32_FLOAT, TEX_FORMAT_R11G11B10_FLOAT, m_pShaderSourceFactory, \
+		AirScatteringAttribs{}, LUTCacheDir));
 
 	m_OceanMaterialParams.OceanColor = float4(0.002f, 0.026f, 0.044f, 1.0f);
 	m_OceanMaterialParams.SSSColor = float4(0.154f, 0.885f, 0.99f, 1.0f);
@@ -214,6 +253,9 @@ void My_Water::Initialize(const SampleInitInfo& InitInfo)
 	//cubemap
 	m_pReflectionProbe = new ReflectionProbe(float3(0.0f, 5000.0f, 0.0f));
 	CreateGPUTexture();
+	InitCubeMapFilterPSO();
+
+	InitOceanHeightQuery();
 }
 
 // Render a frame
@@ -221,7 +263,7 @@ void My_Water::Render()
 {
 	//cube map
 	{
-		CPUAndGPUProfileScope scope(&gRenderProfileMgr, "Gen CubeMap", Colors::emerald);
+		PROFILE_CPU_AND_GPU_SCOPE(&m_Profiler, m_pImmediateContext, "Gen CubeMap", Colors::emerald);
 		CubeMapRender();
 	}
 
@@ -235,13 +277,15 @@ void My_Water::Render()
 
 	//water
 	{
-		GPUProfileScope gpuscope(&gRenderProfileMgr, "WaterFFT", Colors::peterRiver);
+		static const ProfileScopeId FlipbookScope = FrameProfiler::RegisterScope("Ocean flipbook", Colors::peterRiver);
+		static const ProfileScopeId FFTScope = FrameProfiler::RegisterScope("WaterFFT", Colors::peterRiver);
+		GPUProfileScope gpuscope(&m_Profiler, m_pImmediateContext, m_apOceanFlipbook ? FlipbookScope : FFTScope);
 		WaterRender();
 	}	
 
 	//water mesh
 	{
-		CPUAndGPUProfileScope scope(&gRenderProfileMgr, "Water", Colors::alizarin);
+		PROFILE_CPU_AND_GPU_SCOPE(&m_Profiler, m_pImmediateContext, "Water", Colors::alizarin);
 
 		// Bind vertex and index buffers
 		//Uint32   offset = 0;
@@ -277,6 +321,7 @@ void My_Water::Render()
 		//WRenderData.pFoamDiffuseMap = mWaterData.FoamDiffuseTexture;
 		//WRenderData.pFoamMaskMap = m_apFFTFoamTexture;
 		WRenderData.pOceanWave = m_pOceanWave;
+		WRenderData.pOceanFlipbook = m_apOceanFlipbook.get();
 		WRenderData.pDiffIrradianceMap = m_pIrradianceCubeSRV->GetTexture();
 		WRenderData.pIBLSPecMap = m_pPrefilteredEnvMapSRV->GetTexture();
 		WRenderData.OceanRMatParams = m_OceanMaterialParams;
@@ -288,8 +333,8 @@ void My_Water::Render()
 
 	//atmosphere sky
 	{
-		CPUAndGPUProfileScope scope(&gRenderProfileMgr, "Atmosphere", Colors::amethyst);
-		AtmosphereRender(&m_Camera, m_pSwapChain->GetCurrentBackBufferRTV(), m_pSwapChain->GetDepthBufferDSV(), m_apSkyScattering.get());
+		PROFILE_CPU_AND_GPU_SCOPE(&m_Profiler, m_pImmediateContext, "Atmosphere", Colors::amethyst);
+		AtmosphereRender(&m_Camera, m_pSwapChain->GetCurrentBackBufferRTV(), m_pSwapChain->GetDepthBufferDSV(), m_apSkyScattering.get(), m_LightManager.DirLight);
 	}
 }
 
@@ -302,7 +347,9 @@ void My_Water::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
 
 	m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
+	mWaterTimer.Update(ElapsedTime);
 
+	UpdateWaveBounds();
 	m_apClipMap->Update(&m_Camera);
 
 	//update const data
@@ -386,6 +433,9 @@ void My_Water::WindowResize(Uint32 Width, Uint32 Height)
 		m_pSwapChain->GetDesc().PreTransform, m_pDevice->GetDeviceCaps().IsGLDevice());
 	m_Camera.SetSpeedUpScales(100.0f, 300.0f);
 
+	if (m_apClipMap)
+		m_apClipMap->SetViewportHeight(Height);
+
 	//m_apSkyScattering->OnWindowResize(m_pDevice, Width, Height);
 	// Flush is required because Intel driver does not release resources until
 	// command buffer is flushed. When window is resized, WindowResize() is called for
@@ -429,23 +479,43 @@ void My_Water::UpdateUI()
 		ImGui::SliderFloat("DL Intensity", &m_LightManager.DirLight.intensity, 0.1f, 10.0f);
 
 		if (ImGui::InputFloat("Aerosol Density", &m_PPAttribs.fAerosolDensityScale, 0.1f, 0.25f, "%.3f", ImGuiInputTextFlags_EnterReturnsTrue))
+		{
 			m_PPAttribs.fAerosolDensityScale = clamp(m_PPAttribs.fAerosolDensityScale, 0.1f, 10.0f);
+			m_bProbeDirty = true;
+		}
 
 		if (ImGui::InputFloat("Aerosol Absorption", &m_PPAttribs.fAerosolAbsorbtionScale, 0.1f, 0.25f, "%.3f", ImGuiInputTextFlags_EnterReturnsTrue))
+		{
 			m_PPAttribs.fAerosolAbsorbtionScale = clamp(m_PPAttribs.fAerosolAbsorbtionScale, 0.0f, 10.0f);
+			m_bProbeDirty = true;
+		}
+
+		ImGui::SliderFloat("Probe update angle", &m_ProbeUpdateAngle, 0.05f, 5.0f, "%.2f deg");
+		if (ImGui::Checkbox("Sky-only probe", &m_bProbeSkyOnly))
+		{
+			m_bProbeDirty = true;
+		}
+		//a refresh in one frame shows its whole GPU time under Gen CubeMap
+		if (ImGui::Button("Refresh probe now"))
+		{
+			m_bProbeDirty = true;
+			m_bProbeRefreshAtOnce = true;
+		}
+		ImGui::Text(m_ProbeStep < 0 ? "Probe up to date" : "Probe update step %d", m_ProbeStep);
 	}
 	ImGui::End();
 
 	auto UISwellSettingFunc = [](WaveDisplaySetting *pSetting)
 	{
-		ImGui::SliderFloat("Scale", &pSetting->scale, 0.01f, 1.0f);
-		ImGui::SliderFloat("WindSpeed", &pSetting->WindSpeed, 0.01f, 10.0f);
-		ImGui::SliderFloat("WindDirectionalAngle", &pSetting->WindDirectionalAngle, 0.01f, 360.0f);		
-		ImGui::SliderFloat("Fetch", &pSetting->fetch, 0.01f, 1000000.0f);
-		ImGui::SliderFloat("SpreadBlend", &pSetting->SpreadBlend, 0.01f, 1.0f);
-		ImGui::SliderFloat("Swell", &pSetting->swell, 0.01f, 1.0f);
-		ImGui::SliderFloat("PeakEnhancement", &pSetting->PeakEnhancement, 0.01f, 120.0f);
-		ImGui::SliderFloat("ShortWavesFade", &pSetting->ShortWavesFade, 0.01f, 1.0f);
+		bool bChanged = ImGui::SliderFloat("Scale", &pSetting->scale, 0.01f, 1.0f);
+		bChanged |= ImGui::SliderFloat("WindSpeed", &pSetting->WindSpeed, 0.01f, 10.0f);
+		bChanged |= ImGui::SliderFloat("WindDirectionalAngle", &pSetting->WindDirectionalAngle, 0.01f, 360.0f);
+		bChanged |= ImGui::SliderFloat("Fetch", &pSetting->fetch, 0.01f, 1000000.0f);
+		bChanged |= ImGui::SliderFloat("SpreadBlend", &pSetting->SpreadBlend, 0.01f, 1.0f);
+		bChanged |= ImGui::SliderFloat("Swell", &pSetting->swell, 0.01f, 1.0f);
+		bChanged |= ImGui::SliderFloat("PeakEnhancement", &pSetting->PeakEnhancement, 0.01f, 120.0f);
+		bChanged |= ImGui::SliderFloat("ShortWavesFade", &pSetting->ShortWavesFade, 0.01f, 1.0f);
+		return bChanged;
 	};
 
 	if (ImGui::Begin("Ocean params", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
@@ -453,14 +523,14 @@ void My_Water::UpdateUI()
 		//if (ImGui::Button("LocalSpectrumSetting"))
 		if (ImGui::Begin("local spectrum params", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
 		{
-			UISwellSettingFunc(m_WaveSwellSetting[0]);
+			m_bWaveBoundsDirty |= UISwellSettingFunc(m_WaveSwellSetting[0]);
 		}
 		ImGui::End();
 
 		//if (ImGui::Button("SwellSpectrumSetting"))
 		if (ImGui::Begin("swell spectrum params", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
 		{
-			UISwellSettingFunc(m_WaveSwellSetting[1]);
+			m_bWaveBoundsDirty |= UISwellSettingFunc(m_WaveSwellSetting[1]);
 		}
 		ImGui::End();
 
@@ -487,24 +557,476 @@ void My_Water::UpdateUI()
 			ImGui::SliderFloat("FoamScale", &m_OceanMaterialParams.FoamScale, 0.01f, 20.0f);
 		}
 		ImGui::End();
+
+		if (ImGui::Begin("ocean cascades", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+		{
+			static const char *CascadeNames[] = { "Far", "Mid", "Near" };
+			static const char *ResolutionItems[] = { "64", "128", "256" };
+			const float MB = 1.0f / (1024.0f * 1024.0f);
+			if (m_apOceanFlipbook)
+			{
+				const OceanFlipbookStats &Stats = m_apOceanFlipbook->GetStats();
+				const size_t LiveBytes = OCEAN_CASCADE_NUM * WaveCascadeData::GetGPUMemorySize(WATER_FFT_N);
+				ImGui::Text("Flipbook N %u", m_apOceanFlipbook->GetHeader().N);
+				ImGui::Text("On disk %.1f MB, resident %.2f MB", Stats.FileBytes * MB, Stats.ResidentBytes * MB);
+				ImGui::Text("Live simulation textures %.1f MB", LiveBytes * MB);
+				ImGui::Text("Frames streamed %u, sync reads %u", Stats.FramesStreamed, Stats.SyncReads);
+				ImGui::Text("Update %.3f ms", Stats.UpdateMilliseconds);
+			}
+			else
+			{
+				ImGui::Text("Simulation textures %.1f MB", m_pOceanWave->GetGPUMemorySize() * MB);
+			}
+			ImGui::Text("Water patches %u, draws %u, triangles %u", m_apClipMap->GetRenderPatchNum(), m_apClipMap->GetRenderDrawNum(),
+				m_apClipMap->GetRenderTriangleNum());
+			if (m_apClipMap->GetGeometryMode() == WaterGeometryMode::ADAPTIVE)
+			{
+				float MaxError = m_apClipMap->GetMaxScreenSpaceError();
+				if (ImGui::SliderFloat("Max cell pixels", &MaxError, 1.0f, 32.0f))
+					m_apClipMap->SetMaxScreenSpaceError(MaxError);
+			}
+			else
+			{
+				ImGui::Text("Legacy water geometry");
+			}
+			for (int i = 0; m_pOceanWave && i < OCEAN_CASCADE_NUM; ++i)
+			{
+				OceanCascadeUpdateDesc Desc = m_pOceanWave->GetCascadeUpdateDesc(i);
+				int Resolution = clamp(int(std::log2(Desc.N)) - 6, 0, int(_countof(ResolutionItems)) - 1);
+				int UpdateInterval = int(Desc.UpdateInterval);
+
+				ImGui::PushID(i);
+				ImGui::Text("%s cascade", CascadeNames[i]);
+				bool bChanged = ImGui::Combo("N", &Resolution, ResolutionItems, _countof(ResolutionItems));
+				bChanged |= ImGui::SliderInt("Update interval", &UpdateInterval, 1, 4);
+				ImGui::PopID();
+
+				if (bChanged)
+				{
+					Desc.N = 64 << Resolution;
+					Desc.UpdateInterval = uint32_t(UpdateInterval);
+					m_pOceanWave->SetCascadeUpdateDesc(i, Desc);
+				}
+			}
+		}
+		ImGui::End();
+
+		if (m_apOceanHeightQuery && m_apOceanHeightQuery->IsReady())
+		{
+			const float3 CamPos = m_Camera.GetPos();
+			const float2 CamXZ(CamPos.x, CamPos.z);
+			float WaterHeight;
+			m_apOceanHeightQuery->GetHeights(&CamXZ, 1, &WaterHeight);
+			ImGui::Text("Water height below camera %.2f", WaterHeight);
+			ImGui::Text("Height query age %.3f s", mWaterTimer.GetWaterTime() - m_apOceanHeightQuery->GetSnapshotTime());
+		}
 	}	
 	ImGui::End();
 }
 
-void My_Water::WaterRender()
+void My_Water::GetOceanRenderParams(const float Time, const float DeltaTime, OceanRenderParams &params) const
 {
-	OceanRenderParams OceanParams;
 	//set swell
-	m_WaveSwellSetting[0]->ConvertToCSSpectrumElementParam(&OceanParams.HKSpectrumParam.SpectrumElementParam[0]);
-	m_WaveSwellSetting[1]->ConvertToCSSpectrumElementParam(&OceanParams.HKSpectrumParam.SpectrumElementParam[1]);
+	m_WaveSwellSetting[0]->ConvertToCSSpectrumElementParam(&params.HKSpectrumParam.SpectrumElementParam[0]);
+	m_WaveSwellSetting[1]->ConvertToCSSpectrumElementParam(&params.HKSpectrumParam.SpectrumElementParam[1]);
 	//IFFT
-	OceanParams.IFFTParam = IFFTBuffer({ mWaterTimer.GetWaterTime(), (float)WATER_FFT_N, (float)WATER_FFT_N/2, (float)m_Log2_N });
+	params.IFFTParam = IFFTBuffer({ Time, (float)WATER_FFT_N, (float)WATER_FFT_N/2, (float)m_Log2_N });
 	//merge	
+	params.MergeParam = ResultMergeBuffer({1.0f, DeltaTime, float2(0.0f)});
+}
+
+void My_Water::UpdateWaveBounds()
+{
+	if (!m_bWaveBoundsDirty)
+		return;
+	m_bWaveBoundsDirty = false;
+
+	float3 MaxDisplacement(0.0f, 0.0f, 0.0f);
+	if (m_apOceanFlipbook)
+	{
+		//the SNORM scales are the largest displacement of the baked loop
+		const OceanFlipbookHeader &Header = m_apOceanFlipbook->GetHeader();
+		for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+		{
+			MaxDisplacement += float3(std::abs(Header.DispScales[i].x), std::abs(Header.DispScales[i].y), std::abs(Header.DispScales[i].z));
+		}
+	}
+	else
+	{
+		HKSpectrumElementParam ElementParams[2];
+		m_WaveSwellSetting[0]->ConvertToCSSpectrumElementParam(&ElementParams[0]);
+		m_WaveSwellSetting[1]->ConvertToCSSpectrumElementParam(&ElementParams[1]);
+
+		HKSpectrumGlobalParam CascadeParams[OCEAN_CASCADE_NUM];
+		GetOceanCascadeParams(WATER_FFT_N, OCEAN_CASCADE_LENGTH_SCALES, CascadeParams);
+		for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+		{
+			MaxDisplacement += GetOceanDisplacementDeviation(CascadeParams[i], ElementParams) * WATER_BOUNDS_DEVIATIONS;
+		}
+	}
+
+	m_apClipMap->SetWaveBounds(MaxDisplacement);
+}
+
+void My_Water::WaterRender()
+{
+	OceanRenderParams OceanParams;
 	float DeltaTime = mWaterTimer.GetWaterTime() - m_LastTimerCount;
-	OceanParams.MergeParam = ResultMergeBuffer({1.0f, DeltaTime, float2(0.0f)});
-	//std::cout << "DeltaTime = " << DeltaTime << std::endl;
-	m_pOceanWave->ComputeOceanWave(m_pImmediateContext, OceanParams);
+	GetOceanRenderParams(mWaterTimer.GetWaterTime(), DeltaTime, OceanParams);
+	if (m_apOceanFlipbook)
+	{
+		m_apOceanFlipbook->Update(m_pImmediateContext, OceanParams.IFFTParam.Time);
+	}
+	else
+	{
+		m_pOceanWave->ComputeOceanWave(m_pImmediateContext, OceanParams, &m_Profiler);
+	}
 	m_LastTimerCount = mWaterTimer.GetWaterTime();
+
+	if (m_bValidateCPUOcean && m_pOceanWave)
+	{
+		//once, on the first frame
+		m_bValidateCPUOcean = false;
+		ValidateCPUOcean(OceanParams);
+	}
+
+	UpdateOceanHeightQuery(OceanParams);
+}
+
+void My_Water::InitOceanHeightQuery()
+{
+	if (m_OceanQuerySource == OceanQuerySource::NONE)
+	{
+		return;
+	}
+
+	m_apOceanHeightQuery.reset(new OceanHeightQuery());
+	m_apOceanHeightQuery->SetSurfaceMin(m_apClipMap->GetDimension().Min);
+
+	if (m_OceanQuerySource == OceanQuerySource::GPU_READBACK && m_apOceanFlipbook)
+	{
+		LOG_WARNING_MESSAGE("Ocean height query: no GPU simulation to read back with a flipbook, the CPU one loops with it");
+		m_OceanQuerySource = OceanQuerySource::CPU;
+	}
+
+	if (m_OceanQuerySource == OceanQuerySource::GPU_READBACK)
+	{
+		m_apOceanReadback.reset(new OceanDisplacementReadback());
+		m_apOceanReadback->Init(m_pDevice);
+	}
+	else
+	{
+		m_apOceanQueryCPU.reset(new OceanWaveCPU());
+		m_apOceanQueryCPU->Init(OCEAN_QUERY_CPU_N, OCEAN_GAUSS_NOISE_SEED, WATER_FFT_N);
+		if (m_apOceanFlipbook)
+		{
+			float LoopPeriods[OCEAN_CASCADE_NUM];
+			for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+			{
+				LoopPeriods[i] = m_apOceanFlipbook->GetHeader().Cascades[i].LoopPeriod;
+			}
+			m_apOceanQueryCPU->SetLoopPeriods(LoopPeriods);
+		}
+	}
+}
+
+bool My_Water::BakeOceanFlipbookFile()
+{
+	const auto t_start = std::chrono::high_resolution_clock::now();
+
+	float LoopPeriods[OCEAN_CASCADE_NUM];
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		LoopPeriods[i] = OCEAN_FLIPBOOK_DEFAULT_CASCADES[i].LoopPeriod;
+	}
+
+	//the noise of the WATER_FFT_N ocean, the flipbook keeps its waves up to OCEAN_FLIPBOOK_N
+	OceanFlipbookStats Stats;
+	bool bBaked = false;
+	if (m_bOceanBakeGPU)
+	{
+		OceanCascadeUpdateDesc CascadeDescs[OCEAN_CASCADE_NUM];
+		for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+		{
+			CascadeDescs[i].N = OCEAN_FLIPBOOK_N;
+		}
+		OceanWave Ocean(WATER_FFT_N, m_pDevice, m_pShaderSourceFactory);
+		Ocean.Init(WATER_FFT_N, OCEAN_GAUSS_NOISE_SEED, CascadeDescs);
+		Ocean.SetLoopPeriods(LoopPeriods);
+
+		bBaked = BakeOceanFlipbook(m_OceanBakePath.c_str(), OCEAN_FLIPBOOK_N, OCEAN_FLIPBOOK_DEFAULT_CASCADES, OCEAN_CASCADE_LENGTH_SCALES, \
+			[&](const int Cascade, const float Time, const float DeltaTime, OceanCascadeFields &Fields)
+		{
+			OceanRenderParams Params;
+			GetOceanRenderParams(Time, DeltaTime, Params);
+			Ocean.ComputeOceanWave(m_pImmediateContext, Params);
+			Ocean.ReadbackCascade(m_pImmediateContext, Cascade, Fields);
+		}, &Stats);
+	}
+	else
+	{
+		OceanWaveCPU Ocean;
+		Ocean.Init(OCEAN_FLIPBOOK_N, OCEAN_GAUSS_NOISE_SEED, WATER_FFT_N);
+		Ocean.SetLoopPeriods(LoopPeriods);
+
+		bBaked = BakeOceanFlipbook(m_OceanBakePath.c_str(), OCEAN_FLIPBOOK_N, OCEAN_FLIPBOOK_DEFAULT_CASCADES, OCEAN_CASCADE_LENGTH_SCALES, \
+			[&](const int Cascade, const float Time, const float DeltaTime, OceanCascadeFields &Fields)
+		{
+			OceanRenderParams Params;
+			GetOceanRenderParams(Time, DeltaTime, Params);
+			Ocean.ComputeOceanWave(Params);
+			Fields = Ocean.GetCascadeFields(Cascade);
+		}, &Stats);
+	}
+	if (!bBaked)
+	{
+		return false;
+	}
+
+	std::chrono::duration<double> bake_time = std::chrono::high_resolution_clock::now() - t_start;
+	const size_t LiveBytes = OCEAN_CASCADE_NUM * WaveCascadeData::GetGPUMemorySize(WATER_FFT_N) + sizeof(float2) * WATER_FFT_N * WATER_FFT_N;
+	LOG_INFO_MESSAGE("Ocean flipbook ", m_OceanBakePath, " baked on the ", m_bOceanBakeGPU ? "GPU" : "CPU", " in ", bake_time.count(), " s: ", \
+		Stats.FileBytes / 1024, " KB on disk, ", Stats.FrameBytes / 1024, " KB per frame, ", Stats.ResidentBytes / 1024, " KB resident against ", \
+		LiveBytes / 1024, " KB of live simulation textures");
+	return true;
+}
+
+void My_Water::UpdateOceanHeightQuery(const OceanRenderParams &params)
+{
+	if (m_apOceanReadback)
+	{
+		m_apOceanReadback->Update(m_pImmediateContext, *m_pOceanWave, params.IFFTParam.Time, *m_apOceanHeightQuery);
+	}
+	else if (m_apOceanQueryCPU)
+	{
+		const auto t_start = std::chrono::high_resolution_clock::now();
+		m_apOceanQueryCPU->ComputeOceanWave(params);
+		m_apOceanHeightQuery->Update(*m_apOceanQueryCPU, params.IFFTParam.Time);
+		m_OceanQueryCPUTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t_start).count();
+	}
+
+	if (m_bValidateOceanHeightQuery && m_apOceanHeightQuery->IsReady())
+	{
+		//once, on the first snapshot
+		m_bValidateOceanHeightQuery = false;
+		ValidateOceanHeightQuery(params);
+	}
+}
+
+void My_Water::ValidateOceanHeightQuery(const OceanRenderParams &params)
+{
+	//buoyancy probes in a square kilometer around the camera
+	const uint32_t ProbeNum = 4096;
+	const float3 CamPos = m_Camera.GetPos();
+	std::mt19937 Rand(1);
+	std::uniform_real_distribution<float> RandOffset(-512.0f, 512.0f);
+	std::vector<float2> Probes(ProbeNum);
+	for (float2 &Probe : Probes)
+	{
+		Probe = float2(CamPos.x + RandOffset(Rand), CamPos.z + RandOffset(Rand));
+	}
+
+	std::vector<float> Heights(ProbeNum);
+	auto t_start = std::chrono::high_resolution_clock::now();
+	m_apOceanHeightQuery->GetHeights(Probes.data(), ProbeNum, Heights.data());
+	std::chrono::duration<double, std::milli> height_time = std::chrono::high_resolution_clock::now() - t_start;
+
+	//x/z distance of the returned surface points from the probes, with and without the inversion
+	auto GetMiss = [&](float &MeanMiss, float &MaxMiss)
+	{
+		std::vector<float3> Points(ProbeNum);
+		m_apOceanHeightQuery->GetSurfacePoints(Probes.data(), ProbeNum, Points.data());
+		MeanMiss = 0.0f;
+		MaxMiss = 0.0f;
+		for (uint32_t i = 0; i < ProbeNum; ++i)
+		{
+			const float Miss = length(float2(Points[i].x, Points[i].z) - Probes[i]);
+			MeanMiss += Miss / ProbeNum;
+			MaxMiss = std::max(MaxMiss, Miss);
+		}
+	};
+	float MeanMiss, MaxMiss, MeanMissNoInversion, MaxMissNoInversion;
+	GetMiss(MeanMiss, MaxMiss);
+	m_apOceanHeightQuery->SetInversionIterations(0);
+	GetMiss(MeanMissNoInversion, MaxMissNoInversion);
+	m_apOceanHeightQuery->SetInversionIterations(OCEAN_QUERY_DEFAULT_INVERSION_ITERATIONS);
+
+	LOG_INFO_MESSAGE("Ocean height query: ", ProbeNum, " heights in ", height_time.count(), " ms, x/z miss mean ", MeanMiss, " max ", MaxMiss, \
+		" m, without inversion mean ", MeanMissNoInversion, " max ", MaxMissNoInversion, " m");
+
+	if (!m_apOceanQueryCPU)
+	{
+		return;
+	}
+
+	//the band limited copy against the full resolution CPU ocean at the same time
+	OceanWaveCPU RefOcean;
+	RefOcean.Init(WATER_FFT_N, OCEAN_GAUSS_NOISE_SEED, WATER_FFT_N);
+	if (m_apOceanFlipbook)
+	{
+		float LoopPeriods[OCEAN_CASCADE_NUM];
+		for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+		{
+			LoopPeriods[i] = m_apOceanFlipbook->GetHeader().Cascades[i].LoopPeriod;
+		}
+		RefOcean.SetLoopPeriods(LoopPeriods);
+	}
+	RefOcean.ComputeOceanWave(params);
+
+	OceanHeightQuery RefQuery;
+	RefQuery.SetSurfaceMin(m_apClipMap->GetDimension().Min);
+	RefQuery.Update(RefOcean, params.IFFTParam.Time);
+
+	std::vector<float> RefHeights(ProbeNum);
+	RefQuery.GetHeights(Probes.data(), ProbeNum, RefHeights.data());
+	double SquaredError = 0.0;
+	for (uint32_t i = 0; i < ProbeNum; ++i)
+	{
+		SquaredError += double(Heights[i] - RefHeights[i]) * (Heights[i] - RefHeights[i]);
+	}
+	LOG_INFO_MESSAGE("Ocean height query: CPU copy N = ", OCEAN_QUERY_CPU_N, " height rms error ", std::sqrt(SquaredError / ProbeNum), \
+		" m against N = ", WATER_FFT_N, ", ", m_OceanQueryCPUTime, " ms per frame");
+}
+
+void My_Water::ValidateCPUOcean(const OceanRenderParams &params)
+{
+	//relative to the largest magnitude of a field, both sides compute in float
+	const float Tolerance = 1e-3f;
+
+	OceanWaveCPU CPUOcean;
+	CPUOcean.Init(WATER_FFT_N);
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	CPUOcean.ComputeOceanWave(params);
+	std::chrono::duration<double, std::milli> cpu_time = std::chrono::high_resolution_clock::now() - t_start;
+
+	int FailedNum = 0;
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		OceanCascadeFields GPUFields;
+		m_pOceanWave->ReadbackCascade(m_pImmediateContext, i, GPUFields);
+		if (GPUFields.N != WATER_FFT_N)
+		{
+			LOG_INFO_MESSAGE("CPU ocean validation: cascade ", i, " runs at N = ", GPUFields.N, ", skipped");
+			continue;
+		}
+
+		float DisplacementError, DerivativesError;
+		CompareOceanCascadeFields(GPUFields, CPUOcean.GetCascadeFields(i), DisplacementError, DerivativesError);
+		if (DisplacementError > Tolerance || DerivativesError > Tolerance)
+		{
+			++FailedNum;
+			LOG_ERROR_MESSAGE("CPU ocean validation: cascade ", i, " displacement error ", DisplacementError, ", derivatives error ", DerivativesError);
+		}
+		else
+		{
+			LOG_INFO_MESSAGE("CPU ocean validation: cascade ", i, " displacement error ", DisplacementError, ", derivatives error ", DerivativesError);
+		}
+	}
+	LOG_INFO_MESSAGE("CPU ocean validation N = ", WATER_FFT_N, ": ", FailedNum, " of ", OCEAN_CASCADE_NUM, " cascades out of tolerance, first CPU frame ", cpu_time.count(), " ms");
+
+	//the transform alone, every size up to the one in use against a double precision DFT
+	const float FFTTolerance = 1e-5f;
+	for (int N = 2; N <= WATER_FFT_N; N *= 2)
+	{
+		const float FFTError = CheckOceanFFT(N);
+		if (FFTError > FFTTolerance)
+		{
+			LOG_ERROR_MESSAGE("CPU ocean validation: FFT N = ", N, " error ", FFTError, " against the DFT");
+		}
+		else
+		{
+			LOG_INFO_MESSAGE("CPU ocean validation: FFT N = ", N, " error ", FFTError, " against the DFT");
+		}
+	}
+}
+
+// Command line example to check the CPU ocean against the GPU one and its FFT against a naive DFT:
+//
+//     -ocean_cpu_validate 1
+//
+// logs the error of every cascade, the time of the first CPU frame and the FFT error of every size up to WATER_FFT_N.
+//
+// Command line example to measure the buoyancy height queries on the band limited CPU copy:
+//
+//     -ocean_height_query cpu -ocean_height_query_validate 1
+//
+// logs the time of 4096 heights, the x/z miss of their surface points with and without the inversion, and
+// the rms height error of the copy against the full resolution CPU ocean with its time per frame.
+
+std::string GetArgument(const char*& pos, const char* ArgName);
+
+void My_Water::ProcessCommandLine(const char* CmdLine)
+{
+	const auto* pos = strchr(CmdLine, '-');
+	while (pos != nullptr)
+	{
+		++pos;
+		std::string Arg;
+		if (!(Arg = GetArgument(pos, "ocean_cpu_validate")).empty())
+		{
+			m_bValidateCPUOcean = Arg == "1" || Arg == "true";
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_bake")).empty())
+		{
+			//looping flipbook of the waves, played back once written
+			m_OceanBakePath = Arg;
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_bake_source")).empty())
+		{
+			//cpu - OceanWaveCPU, gpu - OceanWave read back every frame
+			m_bOceanBakeGPU = Arg == "gpu";
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_flipbook")).empty())
+		{
+			m_OceanFlipbookPath = Arg;
+		}
+		else if (!(Arg = GetArgument(pos, "atmosphere_lut_cache")).empty())
+		{
+			//existing directory of the scattering table cache, none - computed every start
+			m_AtmosphereLUTCacheDir = Arg == "none" ? std::string() : Arg;
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_geometry")).empty())
+		{
+			//legacy - full height range bounds and distance lods, adaptive - wave bounds and screen space error lods
+			m_bLegacyWaterGeometry = Arg == "legacy";
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_height_query")).empty())
+		{
+			//gpu - readback of the rendered waves, cpu - band limited simulation
+			if (Arg == "gpu")
+				m_OceanQuerySource = OceanQuerySource::GPU_READBACK;
+			else if (Arg == "cpu")
+				m_OceanQuerySource = OceanQuerySource::CPU;
+		}
+		else if (!(Arg = GetArgument(pos, "ocean_height_query_validate")).empty())
+		{
+			m_bValidateOceanHeightQuery = Arg == "1" || Arg == "true";
+		}
+		pos = strchr(pos, '-');
+	}
+}
+
+void My_Water::GetBenchmarkCameraPath(BenchmarkCameraPath& Path) const
+{
+	//a pass low over the waves, a climb to see the horizon and the far lods, then a turn back
+	static const BenchmarkCameraKey Keys[] =
+	{
+		{ 0.0f, float3(  0.0f,  4.0f,   -5.0f), float3(   0.0f,  0.0f, -1000.0f)},
+		{ 3.0f, float3(  0.0f,  3.0f,  -60.0f), float3(  50.0f,  0.0f, -1000.0f)},
+		{ 6.0f, float3( 40.0f, 25.0f, -120.0f), float3( 400.0f,  0.0f, -1000.0f)},
+		{ 9.0f, float3(120.0f, 80.0f, -160.0f), float3( 400.0f, 10.0f,   600.0f)},
+		{12.0f, float3( 60.0f, 10.0f,  -40.0f), float3(-500.0f,  0.0f,   200.0f)},
+		{15.0f, float3(  0.0f,  4.0f,   -5.0f), float3(   0.0f,  0.0f, -1000.0f)},
+	};
+	for (const auto& Key : Keys)
+		Path.AddKey(Key);
+}
+
+void My_Water::SetBenchmarkCamera(const float3& Pos, const float3& LookAt)
+{
+	m_Camera.SetPos(Pos);
+	m_Camera.SetLookAt(LookAt);
 }
 
 void My_Water::ConvertToTextureView(IBuffer* pData, int width, int height, int Stride, ITexture **pRetTex)
@@ -531,21 +1053,33 @@ void My_Water::ConvertToTextureView(IBuffer* pData, int width, int height, int S
 
 void My_Water::UpdateProfileData()
 {
-	ProfilerTask* pCPUData = nullptr;
-	ProfilerTask* pGPUData = nullptr;
-
-	int CPUDataSize = 0;
-	int GPUDataSize = 0;
+	//main thread scopes from MinDepth down, relative to the frame begin
+	auto LoadTasks = [](const ProfileFrame &Frame, const uint32_t MinDepth, std::vector<ProfilerTask> &Tasks)
+	{
+		Tasks.clear();
+		for (const ProfileEvent &Event : Frame.Events)
+		{
+			if (Event.ThreadIndex != 0 || Event.Depth < MinDepth)
+			{
+				continue;
+			}
+			ProfilerTask Task;
+			Task.startTime = Event.Begin - Frame.Begin;
+			Task.endTime = Event.End - Frame.Begin;
+			Task.name = FrameProfiler::GetScopeName(Event.ScopeId);
+			Task.color = FrameProfiler::GetScopeColor(Event.ScopeId);
+			Tasks.push_back(Task);
+		}
+	};
 
-	gRenderProfileMgr.GetCPUProfileData(&pCPUData, CPUDataSize);
-	gRenderProfileMgr.GetGPUProfileData(&pGPUData, GPUDataSize);
+	//CPU scopes of the sample are under the frame and the update or render of the app
+	LoadTasks(m_Profiler.GetLastCPUFrame(), 2, m_CPUProfileTasks);
+	LoadTasks(m_Profiler.GetLastGPUFrame(), 1, m_GPUProfileTasks);
 
-	mProfilersWindow.cpuGraph.LoadFrameData(pCPUData, CPUDataSize);
-	mProfilersWindow.gpuGraph.LoadFrameData(pGPUData, GPUDataSize);	
+	mProfilersWindow.cpuGraph.LoadFrameData(m_CPUProfileTasks.data(), m_CPUProfileTasks.size());
+	mProfilersWindow.gpuGraph.LoadFrameData(m_GPUProfileTasks.data(), m_GPUProfileTasks.size());
 
 	mProfilersWindow.Render();
-
-	gRenderProfileMgr.CleanProfileTask();
 }
 
 My_Water::~My_Water()
@@ -564,20 +1098,36 @@ My_Water::~My_Water()
 
 void My_Water::CreateGPUTexture()
 {
-	const int width = 128;
+	const int width = EnvCubemapDim;
 
 	TextureDesc TexDesc;
 	TexDesc.Name = "Env cube map";
 	TexDesc.Type = RESOURCE_DIM_TEX_CUBE;
 	TexDesc.Usage = USAGE_DEFAULT;
-	TexDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+	TexDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET | BIND_UNORDERED_ACCESS;
 	TexDesc.Width = width;
 	TexDesc.Height = width;
-	TexDesc.Format = TEX_FORMAT_RGBA32_FLOAT;
+	TexDesc.Format = EnvCubemapFmt;
 	TexDesc.ArraySize = 6;
 	TexDesc.MipLevels = 0;
+	//the prefilter samples the mips
+	TexDesc.MiscFlags = MISC_TEXTURE_FLAG_GENERATE_MIPS;
 
 	m_pDevice->CreateTexture(TexDesc, nullptr, &m_apEnvCubemap);
+	for (int face = 0; face < 6; ++face)
+	{
+		TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
+		RTVDesc.Name = "RTV for cube texture";
+		RTVDesc.FirstArraySlice = face;
+		RTVDesc.NumArraySlices = 1;
+		m_apEnvCubemap->CreateView(RTVDesc, &m_apEnvCubemapFaceRTVs[face]);
+	}
+
+	TextureViewDesc UAVDesc(TEXTURE_VIEW_UNORDERED_ACCESS, RESOURCE_DIM_TEX_2D_ARRAY);
+	UAVDesc.Name = "UAV for cube texture";
+	UAVDesc.FirstArraySlice = 0;
+	UAVDesc.NumArraySlices = 6;
+	m_apEnvCubemap->CreateView(UAVDesc, &m_apEnvCubemapUAV);
 
 	TextureDesc DepthBuffDesc;
 	DepthBuffDesc.Type = RESOURCE_DIM_TEX_2D;
@@ -592,44 +1142,111 @@ void My_Water::CreateGPUTexture()
 
 void My_Water::CubeMapRender()
 {		
-	if (m_PrecomputeEnvMapAttribsCB)
+	if (m_ProbeStep < 0)
 	{
-		return;
+		if (m_bProbeReady && !m_bProbeDirty && !ProbeLightChanged())
+		{
+			return;
+		}
+		//the faces of one update all see the light it started with
+		m_ProbeLight = m_LightManager.DirLight;
+		m_bProbeDirty = false;
+		m_ProbeStep = 0;
 	}
-	/*if (!m_apEnvMapAttribsCB)
-	{
-		CreateUniformBuffer(m_pDevice, sizeof(PrecomputeEnvMapAttribs), "env map attribs CB", &m_apEnvMapAttribsCB);
-	}*/
 
-	FirstPersonCamera *pCameras = m_pReflectionProbe->GetCameras();
+	const int StepNum = PROBE_STEP_SPEC + int(m_apPrefilteredEnvMaps[0]->GetDesc().MipLevels);
 
-	for (int face = 0; face < 6; ++face)
+	//one scope per path, the profiler shows both side by side
+	static const ProfileScopeId SkyOnlyScope = FrameProfiler::RegisterScope("Probe sky-only", Colors::emerald);
+	static const ProfileScopeId EpipolarScope = FrameProfiler::RegisterScope("Probe epipolar", Colors::emerald);
+	GPUProfileScope scope(&m_Profiler, m_pImmediateContext, m_bProbeSkyOnly ? SkyOnlyScope : EpipolarScope);
+
+	//the first update runs at once, the water has no lighting before it
+	do
 	{
-		TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
-		RTVDesc.Name = "RTV for cube texture";
-		RTVDesc.FirstArraySlice = face;
-		RTVDesc.NumArraySlices = 1;
-		RefCntAutoPtr<ITextureView> pRTV;
-		m_apEnvCubemap->CreateView(RTVDesc, &pRTV);
-		ITextureView* ppRTVs[] = { pRTV };		
+		if (m_ProbeStep < PROBE_STEP_IRRADIANCE)
+		{
+			if (m_bProbeSkyOnly)
+			{
+				RenderProbeSky();
+				m_ProbeStep = PROBE_STEP_IRRADIANCE - 1;
+			}
+			else
+			{
+				RenderProbeFace(m_ProbeStep);
+			}
+			if (m_ProbeStep == PROBE_STEP_IRRADIANCE - 1)
+			{
+				m_pImmediateContext->GenerateMips(m_apEnvCubemap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+			}
+		}
+		else if (m_ProbeStep == PROBE_STEP_IRRADIANCE)
+		{
+			GetSkyDiffuse();
+		}
+		else
+		{
+			GetSkySpec(Uint32(m_ProbeStep - PROBE_STEP_SPEC));
+		}
+		++m_ProbeStep;
+	} while ((!m_bProbeReady || m_bProbeRefreshAtOnce) && m_ProbeStep < StepNum);
 
-		//set rt for cubemap rendering
-		//const float Zero[] = { 0.f, 0.f, 0.f, 0.f };
-		auto* pDSV = m_apEnvCubemapDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
-		m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-		//m_pImmediateContext->ClearRenderTarget(pRTV, Zero, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-		m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	if (m_ProbeStep == StepNum)
+	{
+		// clang-format off
+		StateTransitionDesc Barriers[] =
+		{
+			{m_apPrefilteredEnvMaps[m_ProbeBackIdx], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
+			{m_apIrradianceCubes[m_ProbeBackIdx],    RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true}
+		};
+		// clang-format on
+		m_pImmediateContext->TransitionResourceStates(_countof(Barriers), Barriers);
+
+		m_pIrradianceCubeSRV = m_apIrradianceCubes[m_ProbeBackIdx]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+		m_pPrefilteredEnvMapSRV = m_apPrefilteredEnvMaps[m_ProbeBackIdx]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+		m_ProbeBackIdx = 1 - m_ProbeBackIdx;
+		m_ProbeStep = -1;
+		m_bProbeReady = true;
+		m_bProbeRefreshAtOnce = false;
+	}
+}
 
-		AtmosphereRender(&(pCameras[face]), pRTV, pDSV, m_apSkyScatteringCube.get(), false);
+bool My_Water::ProbeLightChanged() const
+{
+	const DirectionalLight &Light = m_LightManager.DirLight;
+	const float CosAngle = std::cos(m_ProbeUpdateAngle * PI_F / 180.0f);
+	if (dot(normalize(Light.dir), normalize(m_ProbeLight.dir)) < CosAngle)
+	{
+		return true;
 	}
+	return std::abs(Light.intensity - m_ProbeLight.intensity) > 0.01f * m_ProbeLight.intensity;
+}
 
-	//Generate sky light map
-	InitCubeMapFilterPSO();
-	GetSkyDiffuse();
-	GetSkySpec();
+void My_Water::RenderProbeSky()
+{
+	//the same light the epipolar path passes in AtmosphereRender
+	LightAttribs lattris;
+	lattris.f4Direction = float4(m_ProbeLight.dir, 0.0f);
+	lattris.f4AmbientLight = float4(1, 1, 1, 1);
+	lattris.f4Intensity = float4(10, 10, 10, 10) * m_ProbeLight.intensity;
+
+	m_apSkyScatteringCube->RenderSkyCubemap(m_pDevice, m_pImmediateContext, lattris, m_pReflectionProbe->GetPos(), m_PPAttribs, m_apEnvCubemapUAV);
+}
+
+void My_Water::RenderProbeFace(const int Face)
+{
+	FirstPersonCamera *pCameras = m_pReflectionProbe->GetCameras();
+
+	//set rt for cubemap rendering
+	ITextureView* pRTV = m_apEnvCubemapFaceRTVs[Face];
+	auto* pDSV = m_apEnvCubemapDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+	m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+	AtmosphereRender(&(pCameras[Face]), pRTV, pDSV, m_apSkyScatteringCube.get(), m_ProbeLight, false);
 }
 
-void My_Water::AtmosphereRender(FirstPersonCamera *pCam, ITextureView *pDstColor, ITextureView *pDstDepth, EpipolarLightScattering *pScattering, bool bNeedSun/* = true*/)
+void My_Water::AtmosphereRender(FirstPersonCamera *pCam, ITextureView *pDstColor, ITextureView *pDstDepth, EpipolarLightScattering *pScattering, const DirectionalLight &Light, bool bNeedSun/* = true*/)
 {
 	CameraAttribs CamAttribs;
 	CamAttribs.mViewT = pCam->GetViewMatrix().Transpose();
@@ -652,9 +1269,9 @@ void My_Water::AtmosphereRender(FirstPersonCamera *pCam, ITextureView *pDstColor
 	FrameAttribs.pDeviceContext = m_pImmediateContext;
 	//FrameAttribs.dElapsedTime = m_fElapsedTime;
 	LightAttribs lattris;
-	lattris.f4Direction = float4(m_LightManager.DirLight.dir, 0.0f);
+	lattris.f4Direction = float4(Light.dir, 0.0f);
 	lattris.f4AmbientLight = float4(1, 1, 1, 1);
-	float4 f4ExtraterrestrialSunColor = float4(10, 10, 10, 10) * m_LightManager.DirLight.intensity;
+	float4 f4ExtraterrestrialSunColor = float4(10, 10, 10, 10) * Light.intensity;
 	lattris.f4Intensity = f4ExtraterrestrialSunColor; // *m_fScatteringScale;
 	//lattris.f4AmbientLight = float4(0, 0, 0, 0);
 	//lattris.f4Intensity = float4(m_LightManager.DirLight.intensity, m_LightManager.DirLight.intensity, m_LightManager.DirLight.intensity, m_LightManager.DirLight.intensity);
@@ -710,24 +1327,50 @@ void My_Water::InitCubeMapFilterPSO()
 	TexDesc.Format = IrradianceCubeFmt;
 	TexDesc.ArraySize = 6;
 	TexDesc.MipLevels = 1;
-
-	RefCntAutoPtr<ITexture> IrradainceCubeTex;
-	m_pDevice->CreateTexture(TexDesc, nullptr, &IrradainceCubeTex);
-	m_pIrradianceCubeSRV = IrradainceCubeTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_pDevice->CreateTexture(TexDesc, nullptr, &m_apIrradianceCubes[i]);
+	}
 
 	TexDesc.Name = "Prefiltered environment map for GLTF renderer";
 	TexDesc.Width = PrefilteredEnvMapDim;
 	TexDesc.Height = PrefilteredEnvMapDim;
 	TexDesc.Format = PrefilteredEnvMapFmt;
-	RefCntAutoPtr<ITexture> PrefilteredEnvMapTex;
-	m_pDevice->CreateTexture(TexDesc, nullptr, &PrefilteredEnvMapTex);
-	m_pPrefilteredEnvMapSRV = PrefilteredEnvMapTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_pDevice->CreateTexture(TexDesc, nullptr, &m_apPrefilteredEnvMaps[i]);
+	}
 
-	if (!m_PrecomputeEnvMapAttribsCB)
+	//the face views are made once, a probe update only binds them
+	for (int i = 0; i < 2; ++i)
 	{
-		CreateUniformBuffer(m_pDevice, sizeof(PrecomputeEnvMapAttribs), "Precompute env map attribs CB", &m_PrecomputeEnvMapAttribsCB);
+		for (Uint32 face = 0; face < 6; ++face)
+		{
+			TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
+			RTVDesc.Name = "RTV for irradiance cube texture";
+			RTVDesc.FirstArraySlice = face;
+			RTVDesc.NumArraySlices = 1;
+			m_apIrradianceCubes[i]->CreateView(RTVDesc, &m_apIrradianceFaceRTVs[i][face]);
+		}
+
+		const Uint32 MipLevels = m_apPrefilteredEnvMaps[i]->GetDesc().MipLevels;
+		m_apPrefilteredFaceRTVs[i].resize(MipLevels * 6);
+		for (Uint32 mip = 0; mip < MipLevels; ++mip)
+		{
+			for (Uint32 face = 0; face < 6; ++face)
+			{
+				TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
+				RTVDesc.Name = "RTV for prefiltered env map cube texture";
+				RTVDesc.MostDetailedMip = mip;
+				RTVDesc.FirstArraySlice = face;
+				RTVDesc.NumArraySlices = 1;
+				m_apPrefilteredEnvMaps[i]->CreateView(RTVDesc, &m_apPrefilteredFaceRTVs[i][mip * 6 + face]);
+			}
+		}
 	}
 
+	CreateUniformBuffer(m_pDevice, sizeof(PrecomputeEnvMapAttribs), "Precompute env map attribs CB", &m_PrecomputeEnvMapAttribsCB);
+
 	ShaderCreateInfo ShaderCI;
 	ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
 	ShaderCI.UseCombinedTextureSamplers = true;
@@ -862,51 +1505,31 @@ void My_Water::InitCubeMapFilterPSO()
 		m_pPrefilterEnvMapPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "FilterAttribs")->Set(m_PrecomputeEnvMapAttribsCB);
 		m_pPrefilterEnvMapPSO->CreateShaderResourceBinding(&m_pPrefilterEnvMapSRB, true);
 	}	
+
+	m_pPrecomputeIrradianceCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(m_apEnvCubemap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+	m_pPrefilterEnvMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(m_apEnvCubemap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 }
 
 void My_Water::GetSkyDiffuse()
 {
-	const std::array<float4x4, 6> Matrices =
-	{
-		/* +X */ float4x4::RotationY(+PI_F / 2.f),
-		/* -X */ float4x4::RotationY(-PI_F / 2.f),
-		/* +Y */ float4x4::RotationX(-PI_F / 2.f),
-		/* -Y */ float4x4::RotationX(+PI_F / 2.f),
-		/* +Z */ float4x4::Identity(),
-		/* -Z */ float4x4::RotationY(PI_F)
-	};
+	PrecomputeEnvMapAttribs Attribs = {};
+	FilterProbeFaces(m_pPrecomputeIrradianceCubePSO, m_pPrecomputeIrradianceCubeSRB, &m_apIrradianceFaceRTVs[m_ProbeBackIdx][0], Attribs);
+}
 
-	m_pImmediateContext->SetPipelineState(m_pPrecomputeIrradianceCubePSO);
-	m_pPrecomputeIrradianceCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(m_apEnvCubemap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-	m_pImmediateContext->CommitShaderResources(m_pPrecomputeIrradianceCubeSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-	auto*       pIrradianceCube = m_pIrradianceCubeSRV->GetTexture();
-	const auto& IrradianceCubeDesc = pIrradianceCube->GetDesc();
-	for (Uint32 mip = 0; mip < IrradianceCubeDesc.MipLevels; ++mip)
-	{
-		for (Uint32 face = 0; face < 6; ++face)
-		{
-			TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
-			RTVDesc.Name = "RTV for irradiance cube texture";
-			RTVDesc.MostDetailedMip = mip;
-			RTVDesc.FirstArraySlice = face;
-			RTVDesc.NumArraySlices = 1;
-			RefCntAutoPtr<ITextureView> pRTV;
-			pIrradianceCube->CreateView(RTVDesc, &pRTV);
-			ITextureView* ppRTVs[] = { pRTV };
-			m_pImmediateContext->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-			{
-				MapHelper<PrecomputeEnvMapAttribs> Attribs(m_pImmediateContext, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-				Attribs->Rotation = Matrices[face];
-			}
-			DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
-			m_pImmediateContext->Draw(drawAttrs);
-		}
-	}
+void My_Water::GetSkySpec(const Uint32 Mip)
+{
+	const auto& PrefilteredEnvMapDesc = m_apPrefilteredEnvMaps[m_ProbeBackIdx]->GetDesc();
+
+	PrecomputeEnvMapAttribs Attribs = {};
+	Attribs.Roughness = static_cast<float>(Mip) / static_cast<float>(PrefilteredEnvMapDesc.MipLevels);
+	Attribs.EnvMapDim = static_cast<float>(PrefilteredEnvMapDesc.Width);
+	Attribs.NumSamples = 256;
+	FilterProbeFaces(m_pPrefilterEnvMapPSO, m_pPrefilterEnvMapSRB, &m_apPrefilteredFaceRTVs[m_ProbeBackIdx][Mip * 6], Attribs);
 }
 
-void My_Water::GetSkySpec()
+void My_Water::FilterProbeFaces(IPipelineState *pPSO, IShaderResourceBinding *pSRB, ITextureView *const *ppFaceRTVs, const PrecomputeEnvMapAttribs &Attribs)
 {
-	const std::array<float4x4, 6> Matrices =
+	static const std::array<float4x4, 6> Matrices =
 	{
 		/* +X */ float4x4::RotationY(+PI_F / 2.f),
 		/* -X */ float4x4::RotationY(-PI_F / 2.f),
@@ -916,46 +1539,68 @@ void My_Water::GetSkySpec()
 		/* -Z */ float4x4::RotationY(PI_F)
 	};
 
-	m_pImmediateContext->SetPipelineState(m_pPrefilterEnvMapPSO);
-	m_pPrefilterEnvMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(m_apEnvCubemap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-	m_pImmediateContext->CommitShaderResources(m_pPrefilterEnvMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-	auto*       pPrefilteredEnvMap = m_pPrefilteredEnvMapSRV->GetTexture();
-	const auto& PrefilteredEnvMapDesc = pPrefilteredEnvMap->GetDesc();
-	for (Uint32 mip = 0; mip < PrefilteredEnvMapDesc.MipLevels; ++mip)
+	auto RecordFaces = [&](IDeviceContext *pContext, const Uint32 FirstFace, const Uint32 FaceStep, const RESOURCE_STATE_TRANSITION_MODE TransitionMode)
 	{
-		for (Uint32 face = 0; face < 6; ++face)
+		pContext->SetPipelineState(pPSO);
+		pContext->CommitShaderResources(pSRB, TransitionMode);
+		for (Uint32 face = FirstFace; face < 6; face += FaceStep)
 		{
-			TextureViewDesc RTVDesc(TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY);
-			RTVDesc.Name = "RTV for prefiltered env map cube texture";
-			RTVDesc.MostDetailedMip = mip;
-			RTVDesc.FirstArraySlice = face;
-			RTVDesc.NumArraySlices = 1;
-			RefCntAutoPtr<ITextureView> pRTV;
-			pPrefilteredEnvMap->CreateView(RTVDesc, &pRTV);
-			ITextureView* ppRTVs[] = { pRTV };
-			m_pImmediateContext->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
+			ITextureView* ppRTVs[] = { ppFaceRTVs[face] };
+			pContext->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, TransitionMode);
 			{
-				MapHelper<PrecomputeEnvMapAttribs> Attribs(m_pImmediateContext, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-				Attribs->Rotation = Matrices[face];
-				Attribs->Roughness = static_cast<float>(mip) / static_cast<float>(PrefilteredEnvMapDesc.MipLevels);
-				Attribs->EnvMapDim = static_cast<float>(PrefilteredEnvMapDesc.Width);
-				Attribs->NumSamples = 256;
+				MapHelper<PrecomputeEnvMapAttribs> FaceAttribs(pContext, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+				*FaceAttribs = Attribs;
+				FaceAttribs->Rotation = Matrices[face];
 			}
-
 			DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
-			m_pImmediateContext->Draw(drawAttrs);
+			pContext->Draw(drawAttrs);
 		}
+	};
+
+	const Uint32 ContextNum = std::min(static_cast<Uint32>(m_pDeferredContexts.size()), Uint32(PROBE_FILTER_CONTEXTS));
+	if (ContextNum == 0)
+	{
+		RecordFaces(m_pImmediateContext, 0, 1, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		return;
 	}
 
+	//the deferred contexts only verify the states, the sky and the target go to theirs here
 	// clang-format off
 	StateTransitionDesc Barriers[] =
 	{
-		{m_pPrefilteredEnvMapSRV->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
-		{m_pIrradianceCubeSRV->GetTexture(),    RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true}
+		{m_apEnvCubemap,               RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
+		{ppFaceRTVs[0]->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_RENDER_TARGET,   true}
 	};
 	// clang-format on
 	m_pImmediateContext->TransitionResourceStates(_countof(Barriers), Barriers);
+
+	std::vector<std::future<RefCntAutoPtr<ICommandList>>> Recorders;
+	for (Uint32 ctx = 0; ctx < ContextNum; ++ctx)
+	{
+		IDeviceContext *pDeferredCtx = m_pDeferredContexts[ctx];
+		Recorders.emplace_back(std::async(std::launch::async, [&RecordFaces, pDeferredCtx, ctx, ContextNum]()
+		{
+			RecordFaces(pDeferredCtx, ctx, ContextNum, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+			RefCntAutoPtr<ICommandList> pCmdList;
+			pDeferredCtx->FinishCommandList(&pCmdList);
+			return pCmdList;
+		}));
+	}
+
+	std::vector<RefCntAutoPtr<ICommandList>> CmdLists;
+	std::vector<ICommandList*> CmdListPtrs;
+	for (auto &Recorder : Recorders)
+	{
+		CmdLists.push_back(Recorder.get());
+		CmdListPtrs.push_back(CmdLists.back());
+	}
+	m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(CmdListPtrs.size()), CmdListPtrs.data());
+
+	//releases the dynamic allocations of the face constants
+	for (Uint32 ctx = 0; ctx < ContextNum; ++ctx)
+	{
+		m_pDeferredContexts[ctx]->FinishFrame();
+	}
 }
 
 WaterTimer::WaterTimer()
@@ -968,20 +1613,12 @@ WaterTimer::WaterTimer()
 
 void WaterTimer::Restart()
 {
-	using namespace std::chrono;
-	mt = high_resolution_clock().now();
+	mTCount = 0.0f;
 }
 
-float WaterTimer::GetWaterTime()
+void WaterTimer::Update(double ElapsedTime)
 {
-	using namespace std::chrono;
-
-	std::chrono::high_resolution_clock::time_point CurrTime = high_resolution_clock::now();
-	auto time_span = duration_cast<duration<float>>(CurrTime - mt);
-	mt = CurrTime;
-	mTCount += time_span.count() * mSpeed;
-	//std::cout << mTCount << std::endl;
-	return mTCount;
+	mTCount += float(ElapsedTime) * mSpeed;
 }
 
 } // namespace Diligent
@@ -28,6 +28,8 @@
 #pragma once
 
 #include <chrono>
+#include <string>
+#include <vector>
 
 #include "SampleBase.hpp"
 #include "FirstPersonCamera.hpp"
@@ -42,11 +44,43 @@
 
 #define WATER_FFT_N 256
 
+//band limited copy of the WATER_FFT_N ocean for height queries
+#define OCEAN_QUERY_CPU_N 128
+
+//resolution of the baked ocean flipbook, the same band limited copy
+#define OCEAN_FLIPBOOK_N 128
+
+//standard deviations of the displacement bounding the simulated waves for culling
+#define WATER_BOUNDS_DEVIATIONS 6.0f
+
+//Steps of a probe update, one per frame: the sky, the irradiance map, then one for every mip of
+//the prefiltered map. The filtered maps are swapped in after the last step. The sky-only path
+//writes the six sky faces in step 0 and goes on with the irradiance, the epipolar path draws
+//one face per step.
+#define PROBE_STEP_IRRADIANCE 6
+#define PROBE_STEP_SPEC 7
+
+//deferred contexts recording the faces of a filter step, the faces are split among them
+#define PROBE_FILTER_CONTEXTS 3
+
 namespace Diligent
 {
-class GroundMesh;
+class WaterMesh;
 class OceanWave;
 struct WaveDisplaySetting;
+struct OceanRenderParams;
+class OceanWaveCPU;
+class OceanHeightQuery;
+class OceanDisplacementReadback;
+class OceanFlipbook;
+
+//where the water height queries get the wave displacement from
+enum class OceanQuerySource
+{
+	NONE,
+	GPU_READBACK, //a few frames behind the rendered waves
+	CPU //band limited, at the current time
+};
 class ReflectionProbe;
 
 struct TerrainVertexAttrData
@@ -62,16 +96,17 @@ struct TerrainVertexAttrData
 	}
 };
 
+//simulation time of the waves, advanced by the frame time of the app so fixed step runs repeat
 class WaterTimer
 {
 public:
 	WaterTimer();
 
 	void Restart();
-	float GetWaterTime();
+	void Update(double ElapsedTime);
+	float GetWaterTime() const { return mTCount; }
 
 private:
-	std::chrono::high_resolution_clock::time_point mt;
 	float mSpeed;
 	float mTCount;
 };
@@ -154,6 +189,9 @@ class My_Water final : public SampleBase
 public:
 	virtual ~My_Water();
 
+    virtual void GetEngineInitializationAttribs(RENDER_DEVICE_TYPE DeviceType,
+                                                EngineCreateInfo&  Attribs,
+                                                SwapChainDesc&     SCDesc) override final;
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
 
     virtual void Render() override final;
@@ -163,6 +201,11 @@ public:
 
 	virtual void WindowResize(Uint32 Width, Uint32 Height);
 
+	virtual void ProcessCommandLine(const char* CmdLine) override final;
+
+	virtual void GetBenchmarkCameraPath(BenchmarkCameraPath& Path) const override final;
+	virtual void SetBenchmarkCamera(const float3& Pos, const float3& LookAt) override final;
+
 protected:
 	void UpdateProfileData();
 	void UpdateUI();
@@ -172,14 +215,38 @@ protected:
 	void ConvertToTextureView(IBuffer* pData, int width, int height, int Stride, ITexture** pRetTex);	
 
 	void WaterRender();
+	//culling bounds of the water patches from the spectrum or the flipbook scales
+	void UpdateWaveBounds();
+
+	//spectrum, time and merge params of the simulation from the UI settings
+	void GetOceanRenderParams(const float Time, const float DeltaTime, OceanRenderParams &params) const;
+
+	//writes the flipbook of -ocean_bake with the simulation of -ocean_bake_source
+	bool BakeOceanFlipbookFile();
+
+	//runs the CPU ocean on the params of the last GPU simulation and compares the cascades
+	void ValidateCPUOcean(const OceanRenderParams &params);
+
+	void InitOceanHeightQuery();
+	void UpdateOceanHeightQuery(const OceanRenderParams &params);
+
+	//times 4096 probes on the first snapshot, the cpu source is compared with a full resolution simulation
+	void ValidateOceanHeightQuery(const OceanRenderParams &params);
 
 	//Env 
+	//runs a step of the probe update, starts one when the light has moved
 	void CubeMapRender();
+	bool ProbeLightChanged() const;
+	void RenderProbeSky();
+	void RenderProbeFace(const int Face);
 	void InitCubeMapFilterPSO();
 	void GetSkyDiffuse();
-	void GetSkySpec();
+	void GetSkySpec(const Uint32 Mip);
+
+	//draws the six faces of a filtered cube map, on the deferred contexts when there are any
+	void FilterProbeFaces(IPipelineState *pPSO, IShaderResourceBinding *pSRB, ITextureView *const *ppFaceRTVs, const PrecomputeEnvMapAttribs &Attribs);
 
-	void AtmosphereRender(FirstPersonCamera *pCam, ITextureView *pDstColor, ITextureView *pDstDepth, EpipolarLightScattering *pScattering, bool bNeedSun = true);
+	void AtmosphereRender(FirstPersonCamera *pCam, ITextureView *pDstColor, ITextureView *pDstDepth, EpipolarLightScattering *pScattering, const DirectionalLight &Light, bool bNeedSun = true);
 
 private:
     RefCntAutoPtr<IPipelineState> m_pPSO;
@@ -198,7 +265,7 @@ private:
 	RefCntAutoPtr<IBuffer> m_CameraAttribsCB;
 	MouseState        m_LastMouseState;
 
-	std::shared_ptr<GroundMesh> m_apClipMap;
+	std::shared_ptr<WaterMesh> m_apClipMap;
 
 	LightManager m_LightManager;
 
@@ -206,8 +273,10 @@ private:
 	float m_LastTimerCount;
 	WaterTimer mWaterTimer;
 
-	//profile window
+	//profile window, fed from the last frames of m_Profiler
 	ImGuiUtils::ProfilersWindow mProfilersWindow;
+	std::vector<ProfilerTask> m_CPUProfileTasks;
+	std::vector<ProfilerTask> m_GPUProfileTasks;
 
 	//render fft param
 	WaterRenderParam m_WaterRenderParam;
@@ -218,9 +287,21 @@ private:
 	OceanMaterialParams m_OceanMaterialParams;
 
 	WaveDisplaySetting *m_WaveSwellSetting[2];
-	OceanWave* m_pOceanWave;
+	OceanWave* m_pOceanWave = nullptr;
+
+	//-ocean_flipbook plays the baked waves instead of the simulation, there is no OceanWave then
+	std::string m_OceanBakePath;
+	bool m_bOceanBakeGPU = false;
+	std::string m_OceanFlipbookPath;
+	std::unique_ptr<OceanFlipbook> m_apOceanFlipbook;
+
+	//-ocean_geometry legacy keeps the full height range bounds and the distance lods to compare with
+	bool m_bLegacyWaterGeometry = false;
+	bool m_bWaveBoundsDirty = true; //the spectrum settings changed
 
 	//Sky
+	//-atmosphere_lut_cache, empty for no cache
+	std::string m_AtmosphereLUTCacheDir = ".";
 	std::unique_ptr<EpipolarLightScattering> m_apSkyScattering;
 	std::unique_ptr<EpipolarLightScattering> m_apSkyScatteringCube;
 	RefCntAutoPtr<ITexture> m_pOffscreenColorBuffer;
@@ -229,16 +310,34 @@ private:
 
 	//Env map
 	RefCntAutoPtr<IBuffer> m_apEnvMapAttribsCB;
+	static constexpr TEXTURE_FORMAT EnvCubemapFmt = TEX_FORMAT_RGBA16_FLOAT; //compute shaders store it
+	static constexpr Uint32         EnvCubemapDim = 128;
 	RefCntAutoPtr<ITexture> m_apEnvCubemap;
 	RefCntAutoPtr<ITexture> m_apEnvCubemapDepth;
+	RefCntAutoPtr<ITextureView> m_apEnvCubemapFaceRTVs[6];
+	RefCntAutoPtr<ITextureView> m_apEnvCubemapUAV; //the six faces as an array
 	ReflectionProbe *m_pReflectionProbe;
 
 	static constexpr TEXTURE_FORMAT IrradianceCubeFmt = TEX_FORMAT_RGBA32_FLOAT;
 	static constexpr TEXTURE_FORMAT PrefilteredEnvMapFmt = TEX_FORMAT_RGBA16_FLOAT;
 	static constexpr Uint32         IrradianceCubeDim = 64;
 	static constexpr Uint32         PrefilteredEnvMapDim = 256;
+	//views of the filtered maps the water is lit with
 	RefCntAutoPtr<ITextureView>           m_pIrradianceCubeSRV;
 	RefCntAutoPtr<ITextureView>           m_pPrefilteredEnvMapSRV;
+	//a probe update writes the back maps, face RTVs of the prefiltered map are mip * 6 + face
+	RefCntAutoPtr<ITexture>               m_apIrradianceCubes[2];
+	RefCntAutoPtr<ITexture>               m_apPrefilteredEnvMaps[2];
+	RefCntAutoPtr<ITextureView>           m_apIrradianceFaceRTVs[2][6];
+	std::vector<RefCntAutoPtr<ITextureView>> m_apPrefilteredFaceRTVs[2];
+	int                                   m_ProbeBackIdx = 1;
+	int                                   m_ProbeStep = -1; //-1 when no update runs
+	bool                                  m_bProbeReady = false;
+	bool                                  m_bProbeDirty = false; //the sky settings changed
+	bool                                  m_bProbeSkyOnly = true; //the LUT dispatch, else the epipolar pipeline per face
+	bool                                  m_bProbeRefreshAtOnce = false; //all steps of the next update in one frame
+	DirectionalLight                      m_ProbeLight; //of the update in progress or the last one
+	float                                 m_ProbeUpdateAngle = 0.5f; //degrees the light moves before an update
 	RefCntAutoPtr<IPipelineState>         m_pPrecomputeIrradianceCubePSO;
 	RefCntAutoPtr<IPipelineState>         m_pPrefilterEnvMapPSO;
 	RefCntAutoPtr<IShaderResourceBinding> m_pPrecomputeIrradianceCubeSRB;
@@ -248,6 +347,15 @@ private:
 	int m_Log2_N;
 	int m_CSGroupSize;
 	bool m_Choppy;
+
+	bool m_bValidateCPUOcean = false;
+
+	OceanQuerySource m_OceanQuerySource = OceanQuerySource::NONE;
+	std::unique_ptr<OceanHeightQuery> m_apOceanHeightQuery;
+	std::unique_ptr<OceanDisplacementReadback> m_apOceanReadback;
+	std::unique_ptr<OceanWaveCPU> m_apOceanQueryCPU;
+	double m_OceanQueryCPUTime = 0.0;
+	bool m_bValidateOceanHeightQuery = false;
 	//////////////////////////////////////////////////////////////////////////
 };
 
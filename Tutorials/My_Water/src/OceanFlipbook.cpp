@@ -0,0 +1,532 @@
+#include "OceanFlipbook.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	using namespace Diligent;
+
+	//channels of the simulated float4 fields every layer keeps
+	struct FlipbookLayerChannels
+	{
+		int Num;
+		int Channels[2];
+	};
+	static const FlipbookLayerChannels FLIPBOOK_LAYER_CHANNELS[OCEAN_FLIPBOOK_LAYER_NUM] =
+	{
+		{ 2, { 0, 2 } }, //displacement x, z
+		{ 1, { 1, 0 } }, //displacement y
+		{ 2, { 0, 1 } }, //derivatives x, y
+		{ 2, { 2, 3 } }, //derivatives z, w
+		{ 1, { 0, 0 } }, //turbulence
+	};
+
+	//16 values in [-1, 1] of a 4x4 block to BC4_SNORM, the mode of 6 interpolated values
+	void EncodeBC4Block(const float *pValues, uint8_t *pBlock)
+	{
+		float MinValue = 1.0f;
+		float MaxValue = -1.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			MinValue = std::min(MinValue, pValues[i]);
+			MaxValue = std::max(MaxValue, pValues[i]);
+		}
+
+		const int Red0 = clamp(int(std::ceil(MaxValue * 127.0f)), -127, 127);
+		const int Red1 = clamp(int(std::floor(MinValue * 127.0f)), -127, 127);
+
+		//Red0 > Red1 selects the 8 value palette, on a flat block index 0 is exact either way
+		float Palette[8];
+		Palette[0] = Red0 / 127.0f;
+		Palette[1] = Red1 / 127.0f;
+		for (int i = 2; i < 8; ++i)
+		{
+			Palette[i] = ((8 - i) * Red0 + (i - 1) * Red1) / (7.0f * 127.0f);
+		}
+
+		uint64_t Indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int BestIndex = 0;
+			float BestError = std::abs(pValues[i] - Palette[0]);
+			for (int p = 1; p < (Red0 > Red1 ? 8 : 1); ++p)
+			{
+				const float Error = std::abs(pValues[i] - Palette[p]);
+				if (Error < BestError)
+				{
+					BestError = Error;
+					BestIndex = p;
+				}
+			}
+			Indices |= uint64_t(BestIndex) << (3 * i);
+		}
+
+		pBlock[0] = uint8_t(int8_t(Red0));
+		pBlock[1] = uint8_t(int8_t(Red1));
+		for (int i = 0; i < 6; ++i)
+		{
+			pBlock[2 + i] = uint8_t(Indices >> (8 * i));
+		}
+	}
+
+	//one mip of a layer, the channels divided by their scale
+	uint8_t *EncodeLayerMip(const std::vector<float4> &Src, const int Size, const OCEAN_FLIPBOOK_LAYER Layer, const float4 &Scale, uint8_t *pDst)
+	{
+		const FlipbookLayerChannels &Channels = FLIPBOOK_LAYER_CHANNELS[Layer];
+		float Values[16];
+		for (int by = 0; by < Size; by += 4)
+		{
+			for (int bx = 0; bx < Size; bx += 4)
+			{
+				for (int c = 0; c < Channels.Num; ++c)
+				{
+					const int Channel = Channels.Channels[c];
+					for (int i = 0; i < 16; ++i)
+					{
+						const float4 &Texel = Src[size_t(by + i / 4) * Size + bx + i % 4];
+						Values[i] = clamp(Texel[Channel] / Scale[Channel], -1.0f, 1.0f);
+					}
+					EncodeBC4Block(Values, pDst);
+					pDst += 8;
+				}
+			}
+		}
+		return pDst;
+	}
+
+	//2x2 box filter
+	void DownsampleField(const std::vector<float4> &Src, const int SrcSize, std::vector<float4> &Dst)
+	{
+		const int DstSize = SrcSize / 2;
+		Dst.resize(size_t(DstSize) * DstSize);
+		for (int y = 0; y < DstSize; ++y)
+		{
+			for (int x = 0; x < DstSize; ++x)
+			{
+				const float4 *pRow0 = &Src[size_t(2 * y) * SrcSize + 2 * x];
+				const float4 *pRow1 = pRow0 + SrcSize;
+				Dst[size_t(y) * DstSize + x] = (pRow0[0] + pRow0[1] + pRow1[0] + pRow1[1]) * 0.25f;
+			}
+		}
+	}
+
+	//largest magnitude of every channel, never 0 so the texels stay finite
+	void AccumulateFieldScale(const std::vector<float4> &Src, float4 &Scale)
+	{
+		for (const float4 &Texel : Src)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				Scale[c] = std::max(Scale[c], std::abs(Texel[c]));
+			}
+		}
+	}
+
+	void EncodeFrame(const OceanCascadeFields &Fields, const uint32_t MipLevels, const float4 &DispScale, const float4 &DerivScale, const float4 &TurbScale, \
+		std::vector<uint8_t> &Chunk)
+	{
+		const int N = Fields.N;
+		Chunk.resize(GetOceanFlipbookFrameSize(N, MipLevels));
+		uint8_t *pDst = Chunk.data();
+
+		pDst = EncodeLayerMip(Fields.Displacement, N, OCEAN_FLIPBOOK_LAYER_DISP_XZ, DispScale, pDst);
+		pDst = EncodeLayerMip(Fields.Displacement, N, OCEAN_FLIPBOOK_LAYER_DISP_Y, DispScale, pDst);
+
+		//mip chains of the fields the pixel shader filters
+		std::vector<std::vector<float4>> DerivMips(MipLevels);
+		std::vector<std::vector<float4>> TurbMips(MipLevels);
+		DerivMips[0] = Fields.Derivatives;
+		TurbMips[0] = Fields.Turbulence;
+		for (uint32_t m = 1; m < MipLevels; ++m)
+		{
+			DownsampleField(DerivMips[m - 1], N >> (m - 1), DerivMips[m]);
+			DownsampleField(TurbMips[m - 1], N >> (m - 1), TurbMips[m]);
+		}
+
+		for (uint32_t m = 0; m < MipLevels; ++m)
+		{
+			pDst = EncodeLayerMip(DerivMips[m], N >> m, OCEAN_FLIPBOOK_LAYER_DERIV_XY, DerivScale, pDst);
+		}
+		for (uint32_t m = 0; m < MipLevels; ++m)
+		{
+			pDst = EncodeLayerMip(DerivMips[m], N >> m, OCEAN_FLIPBOOK_LAYER_DERIV_ZW, DerivScale, pDst);
+		}
+		for (uint32_t m = 0; m < MipLevels; ++m)
+		{
+			pDst = EncodeLayerMip(TurbMips[m], N >> m, OCEAN_FLIPBOOK_LAYER_TURBULENCE, TurbScale, pDst);
+		}
+	}
+}
+
+uint32_t Diligent::GetOceanFlipbookMipLevels(const uint32_t N)
+{
+	uint32_t MipLevels = 0;
+	for (uint32_t Size = N; Size >= OCEAN_FLIPBOOK_MIN_MIP_SIZE; Size /= 2)
+	{
+		++MipLevels;
+	}
+	return MipLevels;
+}
+
+uint32_t Diligent::GetOceanFlipbookLayerMipLevels(const uint32_t MipLevels, const OCEAN_FLIPBOOK_LAYER Layer)
+{
+	return (Layer == OCEAN_FLIPBOOK_LAYER_DISP_XZ || Layer == OCEAN_FLIPBOOK_LAYER_DISP_Y) ? 1 : MipLevels;
+}
+
+uint32_t Diligent::GetOceanFlipbookLayerBlockBytes(const OCEAN_FLIPBOOK_LAYER Layer)
+{
+	//8 bytes of BC4 per channel
+	return 8 * FLIPBOOK_LAYER_CHANNELS[Layer].Num;
+}
+
+size_t Diligent::GetOceanFlipbookLayerOffset(const uint32_t N, const uint32_t MipLevels, const OCEAN_FLIPBOOK_LAYER Layer)
+{
+	size_t Offset = 0;
+	for (int l = 0; l < Layer; ++l)
+	{
+		const OCEAN_FLIPBOOK_LAYER PrevLayer = static_cast<OCEAN_FLIPBOOK_LAYER>(l);
+		for (uint32_t m = 0; m < GetOceanFlipbookLayerMipLevels(MipLevels, PrevLayer); ++m)
+		{
+			const size_t BlockNum = (N >> m) / 4;
+			Offset += BlockNum * BlockNum * GetOceanFlipbookLayerBlockBytes(PrevLayer);
+		}
+	}
+	return Offset;
+}
+
+size_t Diligent::GetOceanFlipbookFrameSize(const uint32_t N, const uint32_t MipLevels)
+{
+	return GetOceanFlipbookLayerOffset(N, MipLevels, OCEAN_FLIPBOOK_LAYER_NUM);
+}
+
+bool Diligent::BakeOceanFlipbook(const char *FilePath, const uint32_t N, const OceanFlipbookCascadeDesc *pCascades, const float *pLengthScales, \
+	const OceanFlipbookSimulateFunc &SimulateFrame, OceanFlipbookStats *pStats)
+{
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		LOG_ERROR_MESSAGE("Can not write the ocean flipbook ", FilePath);
+		return false;
+	}
+
+	OceanFlipbookHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = OCEAN_FLIPBOOK_MAGIC;
+	Header.Version = OCEAN_FLIPBOOK_VERSION;
+	Header.N = N;
+	Header.MipLevels = GetOceanFlipbookMipLevels(N);
+	//the scales are only known after the bake, the header is written again at the end
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+
+	OceanCascadeFields Fields;
+	std::vector<uint8_t> Chunk;
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		Header.Cascades[c] = pCascades[c];
+		Header.LengthScales[c] = pLengthScales[c];
+
+		const uint32_t FrameNum = pCascades[c].FrameNum;
+		const float FrameTime = pCascades[c].LoopPeriod / FrameNum;
+
+		//the turbulence integrates over its history, the first loop only settles it
+		for (uint32_t f = 0; f < FrameNum; ++f)
+		{
+			SimulateFrame(c, f * FrameTime, FrameTime, Fields);
+		}
+
+		float4 DispScale(1e-6f, 1e-6f, 1e-6f, 1e-6f);
+		float4 DerivScale(1e-6f, 1e-6f, 1e-6f, 1e-6f);
+		float4 TurbScale(1e-6f, 1e-6f, 1e-6f, 1e-6f);
+		for (uint32_t f = 0; f < FrameNum; ++f)
+		{
+			SimulateFrame(c, f * FrameTime, FrameTime, Fields);
+			AccumulateFieldScale(Fields.Displacement, DispScale);
+			AccumulateFieldScale(Fields.Derivatives, DerivScale);
+			AccumulateFieldScale(Fields.Turbulence, TurbScale);
+		}
+		Header.DispScales[c] = DispScale;
+		Header.DerivScales[c] = DerivScale;
+		Header.TurbScales[c] = TurbScale.x;
+
+		for (uint32_t f = 0; f < FrameNum; ++f)
+		{
+			SimulateFrame(c, f * FrameTime, FrameTime, Fields);
+			if (uint32_t(Fields.N) != N)
+			{
+				LOG_ERROR_MESSAGE("Ocean flipbook of N = ", N, " got a cascade of N = ", Fields.N);
+				return false;
+			}
+			EncodeFrame(Fields, Header.MipLevels, DispScale, DerivScale, float4(TurbScale.x, 0, 0, 0), Chunk);
+			File.write(reinterpret_cast<const char*>(Chunk.data()), Chunk.size());
+		}
+	}
+
+	const size_t FileBytes = size_t(File.tellp());
+	File.seekp(0);
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	if (!File)
+	{
+		LOG_ERROR_MESSAGE("Writing the ocean flipbook ", FilePath, " failed");
+		return false;
+	}
+
+	if (pStats)
+	{
+		pStats->FileBytes = FileBytes;
+		pStats->FrameBytes = GetOceanFlipbookFrameSize(N, Header.MipLevels);
+		pStats->ResidentBytes = pStats->FrameBytes * OCEAN_FLIPBOOK_RING_SIZE * OCEAN_CASCADE_NUM;
+	}
+	return true;
+}
+
+Diligent::OceanFlipbook::OceanFlipbook()
+{
+	memset(&m_Header, 0, sizeof(m_Header));
+	memset(&m_Constants, 0, sizeof(m_Constants));
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		for (int s = 0; s < OCEAN_FLIPBOOK_RING_SIZE; ++s)
+		{
+			m_SlotFrames[c][s] = -1;
+		}
+	}
+}
+
+Diligent::OceanFlipbook::~OceanFlipbook()
+{
+	WaitPrefetch();
+}
+
+bool Diligent::OceanFlipbook::Load(IRenderDevice *pDevice, const char *FilePath)
+{
+	WaitPrefetch();
+	m_PrefetchCascade = -1;
+	m_PrefetchFrame = -1;
+
+	m_File.close();
+	m_File.clear();
+	m_File.open(FilePath, std::ios::binary);
+	if (!m_File)
+	{
+		LOG_ERROR_MESSAGE("Can not open the ocean flipbook ", FilePath);
+		return false;
+	}
+
+	m_File.read(reinterpret_cast<char*>(&m_Header), sizeof(m_Header));
+	if (!m_File || m_Header.Magic != OCEAN_FLIPBOOK_MAGIC || m_Header.Version != OCEAN_FLIPBOOK_VERSION)
+	{
+		LOG_ERROR_MESSAGE(FilePath, " is not an ocean flipbook of version ", OCEAN_FLIPBOOK_VERSION);
+		return false;
+	}
+
+	size_t FrameNum = 0;
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		//playback divides by both
+		const OceanFlipbookCascadeDesc &Desc = m_Header.Cascades[c];
+		if (Desc.FrameNum == 0 || !(Desc.LoopPeriod > 0.0f))
+		{
+			LOG_ERROR_MESSAGE("The ocean flipbook ", FilePath, " has cascade ", c, " with ", Desc.FrameNum, " frames over a loop of ", Desc.LoopPeriod, " s");
+			return false;
+		}
+		FrameNum += Desc.FrameNum;
+	}
+	m_FrameSize = GetOceanFlipbookFrameSize(m_Header.N, m_Header.MipLevels);
+
+	m_File.seekg(0, std::ios::end);
+	const size_t FileBytes = size_t(m_File.tellg());
+	if (FileBytes < sizeof(m_Header) + FrameNum * m_FrameSize)
+	{
+		LOG_ERROR_MESSAGE("The ocean flipbook ", FilePath, " is truncated");
+		return false;
+	}
+
+	for (int l = 0; l < OCEAN_FLIPBOOK_LAYER_NUM; ++l)
+	{
+		const OCEAN_FLIPBOOK_LAYER Layer = static_cast<OCEAN_FLIPBOOK_LAYER>(l);
+
+		TextureDesc TexDesc;
+		TexDesc.Name = "Ocean flipbook";
+		TexDesc.Type = RESOURCE_DIM_TEX_2D_ARRAY;
+		TexDesc.Width = m_Header.N;
+		TexDesc.Height = m_Header.N;
+		TexDesc.ArraySize = OCEAN_FLIPBOOK_RING_SIZE * OCEAN_CASCADE_NUM;
+		TexDesc.MipLevels = GetOceanFlipbookLayerMipLevels(m_Header.MipLevels, Layer);
+		TexDesc.Format = GetOceanFlipbookLayerBlockBytes(Layer) == 8 ? TEX_FORMAT_BC4_SNORM : TEX_FORMAT_BC5_SNORM;
+		TexDesc.Usage = USAGE_DEFAULT;
+		TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+		m_apTextures[l].Release();
+		pDevice->CreateTexture(TexDesc, nullptr, &m_apTextures[l]);
+	}
+
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		for (int s = 0; s < OCEAN_FLIPBOOK_RING_SIZE; ++s)
+		{
+			m_SlotFrames[c][s] = -1;
+		}
+		m_Constants.DispScales[c] = m_Header.DispScales[c];
+		m_Constants.DerivScales[c] = m_Header.DerivScales[c];
+	}
+	m_Constants.TurbScales = m_Header.TurbScales;
+
+	m_Stats = OceanFlipbookStats();
+	m_Stats.FileBytes = FileBytes;
+	m_Stats.FrameBytes = m_FrameSize;
+	m_Stats.ResidentBytes = m_FrameSize * OCEAN_FLIPBOOK_RING_SIZE * OCEAN_CASCADE_NUM;
+
+	LOG_INFO_MESSAGE("Ocean flipbook ", FilePath, ": N = ", m_Header.N, ", ", FrameNum, " frames of ", m_FrameSize / 1024, " KB, ", \
+		FileBytes / (1024 * 1024), " MB on disk, ", m_Stats.ResidentBytes / 1024, " KB resident");
+	return true;
+}
+
+void Diligent::OceanFlipbook::Update(IDeviceContext *pContext, const float Time)
+{
+	const auto StartTime = std::chrono::high_resolution_clock::now();
+
+	uint32_t NextFrames[OCEAN_CASCADE_NUM];
+	float TimesToNext[OCEAN_CASCADE_NUM];
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		const OceanFlipbookCascadeDesc &Desc = m_Header.Cascades[c];
+		float LoopTime = std::fmod(Time, Desc.LoopPeriod);
+		if (LoopTime < 0.0f)
+		{
+			LoopTime += Desc.LoopPeriod;
+		}
+
+		const float FramePos = LoopTime / Desc.LoopPeriod * Desc.FrameNum;
+		const uint32_t Frame0 = std::min(uint32_t(FramePos), Desc.FrameNum - 1);
+		const uint32_t Frame1 = (Frame0 + 1) % Desc.FrameNum;
+		const int Slot0 = MakeResident(pContext, c, Frame0, Frame1);
+		const int Slot1 = MakeResident(pContext, c, Frame1, Frame0);
+
+		const float Blend = clamp(FramePos - Frame0, 0.0f, 1.0f);
+		m_Constants.Slices0[c] = float(Slot0 * OCEAN_CASCADE_NUM + c);
+		m_Constants.Slices1[c] = float(Slot1 * OCEAN_CASCADE_NUM + c);
+		m_Constants.Blends[c] = Blend;
+
+		NextFrames[c] = (Frame1 + 1) % Desc.FrameNum;
+		TimesToNext[c] = (1.0f - Blend) * Desc.LoopPeriod / Desc.FrameNum;
+	}
+
+	//a read ahead the playback has moved past is dropped
+	if (m_PrefetchCascade >= 0 && uint32_t(m_PrefetchFrame) != NextFrames[m_PrefetchCascade])
+	{
+		WaitPrefetch();
+		m_PrefetchCascade = -1;
+	}
+
+	//the cascade that needs its next frame first
+	if (m_PrefetchCascade < 0)
+	{
+		int Cascade = 0;
+		for (int c = 1; c < OCEAN_CASCADE_NUM; ++c)
+		{
+			if (TimesToNext[c] < TimesToNext[Cascade])
+			{
+				Cascade = c;
+			}
+		}
+
+		const uint32_t Frame = NextFrames[Cascade];
+		m_PrefetchCascade = Cascade;
+		m_PrefetchFrame = int(Frame);
+		m_Prefetch = std::async(std::launch::async, [this, Cascade, Frame]()
+		{
+			ReadFrame(Cascade, Frame, m_PrefetchData);
+		});
+	}
+
+	const std::chrono::duration<float, std::milli> UpdateTime = std::chrono::high_resolution_clock::now() - StartTime;
+	m_Stats.UpdateMilliseconds = UpdateTime.count();
+}
+
+size_t Diligent::OceanFlipbook::GetFrameOffset(const int Cascade, const uint32_t Frame) const
+{
+	size_t FrameIndex = Frame;
+	for (int c = 0; c < Cascade; ++c)
+	{
+		FrameIndex += m_Header.Cascades[c].FrameNum;
+	}
+	return sizeof(m_Header) + FrameIndex * m_FrameSize;
+}
+
+void Diligent::OceanFlipbook::ReadFrame(const int Cascade, const uint32_t Frame, std::vector<uint8_t> &Data)
+{
+	Data.resize(m_FrameSize);
+	m_File.seekg(GetFrameOffset(Cascade, Frame));
+	m_File.read(reinterpret_cast<char*>(Data.data()), m_FrameSize);
+}
+
+void Diligent::OceanFlipbook::WaitPrefetch()
+{
+	if (m_Prefetch.valid())
+	{
+		m_Prefetch.get();
+	}
+}
+
+int Diligent::OceanFlipbook::MakeResident(IDeviceContext *pContext, const int Cascade, const uint32_t Frame, const uint32_t KeepFrame)
+{
+	//slots hold distinct frames, with Frame missing at most one of them holds KeepFrame
+	int Slot = -1;
+	for (int s = 0; s < OCEAN_FLIPBOOK_RING_SIZE; ++s)
+	{
+		if (m_SlotFrames[Cascade][s] == int(Frame))
+		{
+			return s;
+		}
+		if (Slot < 0 && m_SlotFrames[Cascade][s] != int(KeepFrame))
+		{
+			Slot = s;
+		}
+	}
+
+	//the worker owns the file until its read is done
+	WaitPrefetch();
+	if (m_PrefetchCascade == Cascade && m_PrefetchFrame == int(Frame))
+	{
+		UploadFrame(pContext, Cascade, Slot, m_PrefetchData);
+		m_PrefetchCascade = -1;
+	}
+	else
+	{
+		ReadFrame(Cascade, Frame, m_ReadData);
+		UploadFrame(pContext, Cascade, Slot, m_ReadData);
+		++m_Stats.SyncReads;
+	}
+	m_SlotFrames[Cascade][Slot] = int(Frame);
+	return Slot;
+}
+
+void Diligent::OceanFlipbook::UploadFrame(IDeviceContext *pContext, const int Cascade, const int Slot, const std::vector<uint8_t> &Data)
+{
+	const uint32_t N = m_Header.N;
+	for (int l = 0; l < OCEAN_FLIPBOOK_LAYER_NUM; ++l)
+	{
+		const OCEAN_FLIPBOOK_LAYER Layer = static_cast<OCEAN_FLIPBOOK_LAYER>(l);
+		const uint32_t BlockBytes = GetOceanFlipbookLayerBlockBytes(Layer);
+		size_t Offset = GetOceanFlipbookLayerOffset(N, m_Header.MipLevels, Layer);
+		for (uint32_t m = 0; m < GetOceanFlipbookLayerMipLevels(m_Header.MipLevels, Layer); ++m)
+		{
+			const uint32_t Size = N >> m;
+			Box Region;
+			Region.MaxX = Size;
+			Region.MaxY = Size;
+
+			TextureSubResData SubResData;
+			SubResData.pData = &Data[Offset];
+			SubResData.Stride = (Size / 4) * BlockBytes;
+			pContext->UpdateTexture(m_apTextures[l], m, Slot * OCEAN_CASCADE_NUM + Cascade, Region, SubResData, \
+				RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+			Offset += size_t(Size / 4) * (Size / 4) * BlockBytes;
+		}
+	}
+
+	m_Stats.StreamedBytes += m_FrameSize;
+	++m_Stats.FramesStreamed;
+}
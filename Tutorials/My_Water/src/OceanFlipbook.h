@@ -0,0 +1,157 @@
+#ifndef _OCEAN_FLIPBOOK_H_
+#define _OCEAN_FLIPBOOK_H_
+
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <future>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "OceanWave.h"
+
+#define OCEAN_FLIPBOOK_MAGIC 0x3142464Fu //"OFB1"
+#define OCEAN_FLIPBOOK_VERSION 1
+
+//frames of a cascade resident on the GPU, the two played ones
+#define OCEAN_FLIPBOOK_RING_SIZE 2
+
+//the block compressed mips stop at one block
+#define OCEAN_FLIPBOOK_MIN_MIP_SIZE 4
+
+namespace Diligent
+{
+	//texture arrays of the flipbook, every frame holds one slice of each
+	enum OCEAN_FLIPBOOK_LAYER
+	{
+		OCEAN_FLIPBOOK_LAYER_DISP_XZ = 0, //BC5, mip 0 only like the simulated displacement
+		OCEAN_FLIPBOOK_LAYER_DISP_Y,      //BC4, mip 0 only
+		OCEAN_FLIPBOOK_LAYER_DERIV_XY,    //BC5, full mips
+		OCEAN_FLIPBOOK_LAYER_DERIV_ZW,    //BC5, full mips
+		OCEAN_FLIPBOOK_LAYER_TURBULENCE,  //BC4, full mips
+		OCEAN_FLIPBOOK_LAYER_NUM
+	};
+
+	//a cascade repeats after LoopPeriod seconds, baked into FrameNum frames
+	struct OceanFlipbookCascadeDesc
+	{
+		float LoopPeriod;
+		uint32_t FrameNum;
+	};
+
+	//Default loops of the far, mid and near cascade at N 128. The frames sample the fastest wave
+	//of a cascade five or more times per period, the small cascades loop sooner.
+	static const OceanFlipbookCascadeDesc OCEAN_FLIPBOOK_DEFAULT_CASCADES[OCEAN_CASCADE_NUM] = { { 32.0f, 128 }, { 16.0f, 128 }, { 4.0f, 128 } };
+
+	//File layout: the header, then the frames of the far, mid and near cascade. A frame is one
+	//chunk of GetOceanFlipbookFrameSize bytes holding the layers in order, every layer its mips.
+	//All frames have the same size, a frame is streamed in from its offset alone.
+	struct OceanFlipbookHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t N;
+		uint32_t MipLevels; //of the derivatives and the turbulence
+		OceanFlipbookCascadeDesc Cascades[OCEAN_CASCADE_NUM];
+		float LengthScales[OCEAN_CASCADE_NUM];
+
+		//the SNORM texels are scaled by these back to the simulated values
+		float4 DispScales[OCEAN_CASCADE_NUM];
+		float4 DerivScales[OCEAN_CASCADE_NUM];
+		float4 TurbScales; //xyz - far, mid and near
+	};
+
+	//Frames of every cascade are blended by the time in its loop. Mirrors cbuffer FlipbookConstants
+	//of clipmap.vsh and clipmap.psh, slice = ring slot * OCEAN_CASCADE_NUM + cascade.
+	struct OceanFlipbookConstants
+	{
+		float4 Slices0; //xyz - far, mid and near
+		float4 Slices1;
+		float4 Blends;
+		float4 DispScales[OCEAN_CASCADE_NUM];
+		float4 DerivScales[OCEAN_CASCADE_NUM];
+		float4 TurbScales;
+	};
+
+	struct OceanFlipbookStats
+	{
+		size_t FileBytes = 0;
+		size_t FrameBytes = 0;
+		size_t ResidentBytes = 0;     //video memory of the ring
+		size_t StreamedBytes = 0;     //read since the load
+		uint32_t FramesStreamed = 0;
+		uint32_t SyncReads = 0;       //frames the prefetch missed
+		float UpdateMilliseconds = 0; //CPU time of the last Update
+	};
+
+	uint32_t GetOceanFlipbookMipLevels(const uint32_t N);
+
+	//bytes of one frame of a cascade
+	size_t GetOceanFlipbookFrameSize(const uint32_t N, const uint32_t MipLevels);
+
+	//offset of a layer in the chunk of a frame, its mips follow each other from mip 0
+	size_t GetOceanFlipbookLayerOffset(const uint32_t N, const uint32_t MipLevels, const OCEAN_FLIPBOOK_LAYER Layer);
+	uint32_t GetOceanFlipbookLayerMipLevels(const uint32_t MipLevels, const OCEAN_FLIPBOOK_LAYER Layer);
+	uint32_t GetOceanFlipbookLayerBlockBytes(const OCEAN_FLIPBOOK_LAYER Layer);
+
+	//Fields of Cascade simulated at Time, DeltaTime after the previous call. The cascades run one
+	//after another, Time restarts at 0 for every cascade.
+	typedef std::function<void(const int Cascade, const float Time, const float DeltaTime, OceanCascadeFields &Fields)> OceanFlipbookSimulateFunc;
+
+	//Runs every cascade through one loop to settle the turbulence, one to find the value ranges
+	//and one more into the file. The simulation has to loop with the periods of pCascades.
+	bool BakeOceanFlipbook(const char *FilePath, const uint32_t N, const OceanFlipbookCascadeDesc *pCascades, const float *pLengthScales, \
+		const OceanFlipbookSimulateFunc &SimulateFrame, OceanFlipbookStats *pStats = nullptr);
+
+	//Plays a baked flipbook instead of the simulation. The two frames around the time of every
+	//cascade stay resident, the one after them is read ahead on a worker thread.
+	class OceanFlipbook
+	{
+	public:
+		OceanFlipbook();
+		~OceanFlipbook();
+
+		bool Load(IRenderDevice *pDevice, const char *FilePath);
+
+		//streams and uploads the frames of Time
+		void Update(IDeviceContext *pContext, const float Time);
+
+		ITexture *GetTexture(const OCEAN_FLIPBOOK_LAYER Layer) const { return m_apTextures[Layer]; }
+		const OceanFlipbookHeader &GetHeader() const { return m_Header; }
+		const OceanFlipbookConstants &GetConstants() const { return m_Constants; }
+		const OceanFlipbookStats &GetStats() const { return m_Stats; }
+
+	protected:
+		size_t GetFrameOffset(const int Cascade, const uint32_t Frame) const;
+		void ReadFrame(const int Cascade, const uint32_t Frame, std::vector<uint8_t> &Data);
+
+		//ring slot holding the frame, uploaded into a slot holding neither it nor KeepFrame when missing
+		int MakeResident(IDeviceContext *pContext, const int Cascade, const uint32_t Frame, const uint32_t KeepFrame);
+		void UploadFrame(IDeviceContext *pContext, const int Cascade, const int Slot, const std::vector<uint8_t> &Data);
+
+		void WaitPrefetch();
+
+	private:
+		OceanFlipbookHeader m_Header;
+		OceanFlipbookConstants m_Constants;
+		OceanFlipbookStats m_Stats;
+		size_t m_FrameSize = 0;
+
+		std::ifstream m_File;
+		RefCntAutoPtr<ITexture> m_apTextures[OCEAN_FLIPBOOK_LAYER_NUM];
+
+		//frame in every ring slot, -1 for none
+		int m_SlotFrames[OCEAN_CASCADE_NUM][OCEAN_FLIPBOOK_RING_SIZE];
+
+		//the one frame read ahead
+		std::future<void> m_Prefetch;
+		int m_PrefetchCascade = -1;
+		int m_PrefetchFrame = -1;
+		std::vector<uint8_t> m_PrefetchData;
+		std::vector<uint8_t> m_ReadData;
+	};
+}
+
+#endif
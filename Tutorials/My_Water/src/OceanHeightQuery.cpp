@@ -0,0 +1,265 @@
+#include "OceanHeightQuery.h"
+#include "OceanWaveCPU.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define OCEAN_QUERY_USE_SSE2 1
+#else
+#	define OCEAN_QUERY_USE_SSE2 0
+#endif
+
+Diligent::OceanHeightQuery::OceanHeightQuery() :
+	m_SurfaceMin(0.0f, 0.0f, 0.0f),
+	m_InversionIterations(OCEAN_QUERY_DEFAULT_INVERSION_ITERATIONS)
+{
+}
+
+void Diligent::OceanHeightQuery::Update(const OceanWaveCPU &Ocean, const float Time)
+{
+	OceanDisplacementSnapshot &Snapshot = BeginUpdate();
+	Snapshot.Time = Time;
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		Snapshot.N[i] = Ocean.GetN();
+		Snapshot.LengthScales[i] = Ocean.GetLengthScale(i);
+		Snapshot.Displacement[i] = Ocean.GetCascadeFields(i).Displacement;
+	}
+	EndUpdate();
+}
+
+Diligent::OceanDisplacementSnapshot &Diligent::OceanHeightQuery::BeginUpdate()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	//new queries only take the front one, a back one nobody else holds is free
+	if (!m_apBack || m_apBack.use_count() > 1)
+	{
+		m_apBack = std::make_shared<OceanDisplacementSnapshot>();
+	}
+	return *m_apBack;
+}
+
+void Diligent::OceanHeightQuery::EndUpdate()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	std::swap(m_apFront, m_apBack);
+}
+
+std::shared_ptr<const Diligent::OceanDisplacementSnapshot> Diligent::OceanHeightQuery::GetSnapshot() const
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	return m_apFront;
+}
+
+bool Diligent::OceanHeightQuery::IsReady() const
+{
+	return GetSnapshot() != nullptr;
+}
+
+float Diligent::OceanHeightQuery::GetSnapshotTime() const
+{
+	std::shared_ptr<const OceanDisplacementSnapshot> apSnapshot = GetSnapshot();
+	return apSnapshot ? apSnapshot->Time : 0.0f;
+}
+
+void Diligent::OceanHeightQuery::GetHeights(const float2 *pXZ, const uint32_t Num, float *pOutHeights) const
+{
+	std::shared_ptr<const OceanDisplacementSnapshot> apSnapshot = GetSnapshot();
+	for (uint32_t i = 0; i < Num; ++i)
+	{
+		pOutHeights[i] = apSnapshot ? FindSurfacePoint(*apSnapshot, pXZ[i].x, pXZ[i].y).y : m_SurfaceMin.y;
+	}
+}
+
+void Diligent::OceanHeightQuery::GetSurfacePoints(const float2 *pXZ, const uint32_t Num, float3 *pOutPoints) const
+{
+	std::shared_ptr<const OceanDisplacementSnapshot> apSnapshot = GetSnapshot();
+	for (uint32_t i = 0; i < Num; ++i)
+	{
+		pOutPoints[i] = apSnapshot ? FindSurfacePoint(*apSnapshot, pXZ[i].x, pXZ[i].y) : float3(pXZ[i].x, m_SurfaceMin.y, pXZ[i].y);
+	}
+}
+
+Diligent::float3 Diligent::OceanHeightQuery::SampleDisplacement(const OceanDisplacementSnapshot &Snapshot, const float x, const float z) const
+{
+#if OCEAN_QUERY_USE_SSE2
+	__m128 Sum = _mm_setzero_ps();
+#else
+	float Sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+#endif
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		const int N = Snapshot.N[i];
+		const int Mask = N - 1;
+
+		//bilinear with wrap addressing like the displacement sampler, texel centers at (i + 0.5) / N
+		const float TexelScale = N / Snapshot.LengthScales[i];
+		const float tx = (x - m_SurfaceMin.x) * TexelScale - 0.5f;
+		const float tz = (z - m_SurfaceMin.z) * TexelScale - 0.5f;
+		const float FloorX = std::floor(tx);
+		const float FloorZ = std::floor(tz);
+		const float fx = tx - FloorX;
+		const float fz = tz - FloorZ;
+
+		const int x0 = int(FloorX) & Mask;
+		const int z0 = int(FloorZ) & Mask;
+		const int x1 = (x0 + 1) & Mask;
+		const int z1 = (z0 + 1) & Mask;
+
+		const float4 *pTex = Snapshot.Displacement[i].data();
+		const float4 *pCorners[4] = { &pTex[z0 * N + x0], &pTex[z0 * N + x1], &pTex[z1 * N + x0], &pTex[z1 * N + x1] };
+		const float Weights[4] = { (1.0f - fx) * (1.0f - fz), fx * (1.0f - fz), (1.0f - fx) * fz, fx * fz };
+		for (int c = 0; c < 4; ++c)
+		{
+#if OCEAN_QUERY_USE_SSE2
+			Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(&pCorners[c]->x), _mm_set1_ps(Weights[c])));
+#else
+			Sum[0] += pCorners[c]->x * Weights[c];
+			Sum[1] += pCorners[c]->y * Weights[c];
+			Sum[2] += pCorners[c]->z * Weights[c];
+#endif
+		}
+	}
+
+#if OCEAN_QUERY_USE_SSE2
+	float Result[4];
+	_mm_storeu_ps(Result, Sum);
+	return float3(Result[0], Result[1], Result[2]);
+#else
+	return float3(Sum[0], Sum[1], Sum[2]);
+#endif
+}
+
+Diligent::float3 Diligent::OceanHeightQuery::FindSurfacePoint(const OceanDisplacementSnapshot &Snapshot, const float x, const float z) const
+{
+	//The vertex of undisplaced p lands on p + D(p). Solving p = q - D(p) by fixed point iteration
+	//converges while the waves do not fold over, the jacobian of the merge pass stays positive.
+	float px = x;
+	float pz = z;
+	float3 Disp = SampleDisplacement(Snapshot, px, pz);
+	for (uint32_t i = 0; i < m_InversionIterations; ++i)
+	{
+		px = x - Disp.x;
+		pz = z - Disp.z;
+		Disp = SampleDisplacement(Snapshot, px, pz);
+	}
+	return float3(px + Disp.x, m_SurfaceMin.y + Disp.y, pz + Disp.z);
+}
+
+void Diligent::OceanDisplacementReadback::Init(IRenderDevice *pDevice)
+{
+	m_pDevice = pDevice;
+	m_Frame = 0;
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		m_N[c] = 0;
+	}
+
+	FenceDesc FDesc;
+	FDesc.Name = "Ocean displacement readback";
+	m_pFence.Release();
+	m_pDevice->CreateFence(FDesc, &m_pFence);
+	m_FenceValue = 0;
+	m_PublishedFenceValue = 0;
+	memset(m_SlotFenceValues, 0, sizeof(m_SlotFenceValues));
+}
+
+void Diligent::OceanDisplacementReadback::InitStaging(const int Cascade, const int N)
+{
+	m_N[Cascade] = N;
+	m_Frame = 0;
+
+	//copies of the old size are not read, the fence values keep counting up
+	memset(m_SlotFenceValues, 0, sizeof(m_SlotFenceValues));
+
+	TextureDesc StagingDesc;
+	StagingDesc.Name = "Ocean displacement readback";
+	StagingDesc.Type = RESOURCE_DIM_TEX_2D;
+	StagingDesc.Width = N;
+	StagingDesc.Height = N;
+	StagingDesc.MipLevels = 1;
+	StagingDesc.Format = TEX_FORMAT_RGBA32_FLOAT;
+	StagingDesc.Usage = USAGE_STAGING;
+	StagingDesc.BindFlags = BIND_NONE;
+	StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+	for (int i = 0; i < OCEAN_READBACK_LATENCY; ++i)
+	{
+		m_apStagingTexs[i][Cascade].Release();
+		m_pDevice->CreateTexture(StagingDesc, nullptr, &m_apStagingTexs[i][Cascade]);
+	}
+}
+
+void Diligent::OceanDisplacementReadback::Update(IDeviceContext *pContext, const OceanWave &Ocean, const float Time, OceanHeightQuery &Query)
+{
+	const ExportRenderParams Params = Ocean.ExportParamsToShader();
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		const int N = int(Params.OceanRenderTexs[c].pDisp->GetDesc().Width);
+		if (N != m_N[c])
+		{
+			InitStaging(c, N);
+		}
+	}
+
+	//newest finished copy that is not published yet, read before this frame's copy may overwrite it
+	const uint64_t CompletedValue = m_pFence->GetCompletedValue();
+	int ReadSlot = -1;
+	for (int i = 0; i < OCEAN_READBACK_LATENCY; ++i)
+	{
+		const uint64_t SlotValue = m_SlotFenceValues[i];
+		if (SlotValue > m_PublishedFenceValue && SlotValue <= CompletedValue && (ReadSlot < 0 || SlotValue > m_SlotFenceValues[ReadSlot]))
+		{
+			ReadSlot = i;
+		}
+	}
+	if (ReadSlot >= 0)
+	{
+		m_PublishedFenceValue = m_SlotFenceValues[ReadSlot];
+		PublishSlot(pContext, static_cast<uint32_t>(ReadSlot), Params, Query);
+	}
+
+	//the oldest slot, its copy is either published or outdated by a newer one
+	const uint32_t WriteSlot = m_Frame % OCEAN_READBACK_LATENCY;
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		CopyTextureAttribs CopyAttribs(Params.OceanRenderTexs[c].pDisp, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, m_apStagingTexs[WriteSlot][c], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyTexture(CopyAttribs);
+	}
+	pContext->SignalFence(m_pFence, ++m_FenceValue);
+	m_SlotFenceValues[WriteSlot] = m_FenceValue;
+	m_CopyTime[WriteSlot] = Time;
+	++m_Frame;
+}
+
+void Diligent::OceanDisplacementReadback::PublishSlot(IDeviceContext *pContext, const uint32_t Slot, const ExportRenderParams &Params, OceanHeightQuery &Query)
+{
+	OceanDisplacementSnapshot &Snapshot = Query.BeginUpdate();
+	Snapshot.Time = m_CopyTime[Slot];
+	for (int c = 0; c < OCEAN_CASCADE_NUM; ++c)
+	{
+		//the fence passed, the copy is done and the map does not stall
+		ITexture *pReadTex = m_apStagingTexs[Slot][c];
+		MappedTextureSubresource MappedData;
+		pContext->MapTextureSubresource(pReadTex, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+		if (!MappedData.pData)
+		{
+			LOG_ERROR_MESSAGE("Mapping the ocean displacement readback failed");
+			return;
+		}
+
+		const int N = m_N[c];
+		std::vector<float4> &Dst = Snapshot.Displacement[c];
+		Dst.resize(size_t(N) * N);
+		for (int y = 0; y < N; ++y)
+		{
+			memcpy(&Dst[size_t(y) * N], reinterpret_cast<const uint8_t*>(MappedData.pData) + size_t(y) * MappedData.Stride, sizeof(float4) * N);
+		}
+		pContext->UnmapTextureSubresource(pReadTex, 0, 0);
+
+		Snapshot.N[c] = N;
+		Snapshot.LengthScales[c] = Params.LengthScales[c];
+	}
+	Query.EndUpdate();
+}
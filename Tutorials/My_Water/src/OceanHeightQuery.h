@@ -0,0 +1,118 @@
+#ifndef _OCEAN_HEIGHT_QUERY_H_
+#define _OCEAN_HEIGHT_QUERY_H_
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "Fence.h"
+#include "OceanWave.h"
+
+//staging copies of the displacement in flight, a copy is usually read this many frames minus one after it is queued
+#define OCEAN_READBACK_LATENCY 3
+
+//fixed point steps that undo the horizontal displacement of the waves
+#define OCEAN_QUERY_DEFAULT_INVERSION_ITERATIONS 4
+
+namespace Diligent
+{
+	class OceanWaveCPU;
+
+	//displacement of the three cascades at one simulation time, row major N[c] * N[c]
+	struct OceanDisplacementSnapshot
+	{
+		float Time = 0.0f;
+		int N[OCEAN_CASCADE_NUM] = {};
+		float LengthScales[OCEAN_CASCADE_NUM] = {};
+		std::vector<float4> Displacement[OCEAN_CASCADE_NUM];
+	};
+
+	//Water heights for gameplay and physics (buoyancy probes) without touching the GPU on the query side.
+	//The surface comes from snapshots of the cascade displacement, published either by a CPU
+	//simulation (Update) or by OceanDisplacementReadback. Queries run on the latest published
+	//snapshot, so any thread may query while a new one is written.
+	//The displaced surface matches clipmap.vsh at full detail, its distance fade is left out.
+	class OceanHeightQuery
+	{
+	public:
+		OceanHeightQuery();
+
+		//x/z origin of the cascade tiles and the water level, the dimension min of WaterMesh
+		void SetSurfaceMin(const float3 &SurfaceMin) { m_SurfaceMin = SurfaceMin; }
+		void SetInversionIterations(const uint32_t Iterations) { m_InversionIterations = Iterations; }
+
+		//snapshot of a CPU simulation computed for Time
+		void Update(const OceanWaveCPU &Ocean, const float Time);
+
+		//The writer fills the returned snapshot and publishes it with EndUpdate. Queries still
+		//running on the previous snapshot finish on it, it is only reused once they let go.
+		OceanDisplacementSnapshot &BeginUpdate();
+		void EndUpdate();
+
+		bool IsReady() const;
+
+		//simulation time of the heights the queries return, behind the current time with readback
+		float GetSnapshotTime() const;
+
+		//height of the surface point above every world x/z
+		void GetHeights(const float2 *pXZ, const uint32_t Num, float *pOutHeights) const;
+
+		//displaced surface point above every world x/z, its x/z lands on the query up to the inversion error
+		void GetSurfacePoints(const float2 *pXZ, const uint32_t Num, float3 *pOutPoints) const;
+
+	protected:
+		std::shared_ptr<const OceanDisplacementSnapshot> GetSnapshot() const;
+
+		//summed displacement of the cascades at an undisplaced world x/z
+		float3 SampleDisplacement(const OceanDisplacementSnapshot &Snapshot, const float x, const float z) const;
+
+		//undisplaced x/z whose displaced point lands on the query
+		float3 FindSurfacePoint(const OceanDisplacementSnapshot &Snapshot, const float x, const float z) const;
+
+	private:
+		float3 m_SurfaceMin;
+		uint32_t m_InversionIterations;
+
+		mutable std::mutex m_Mutex;
+		std::shared_ptr<OceanDisplacementSnapshot> m_apFront;
+		std::shared_ptr<OceanDisplacementSnapshot> m_apBack;
+	};
+
+	//GPU source of OceanHeightQuery: a ring of staging copies of the displacement textures.
+	//Every frame queues a copy into the oldest slot and signals a fence after it. The newest slot
+	//whose fence value the GPU has reached is published, a slot is never mapped before that.
+	//While the GPU is behind, the queries keep the previous snapshot.
+	//Cascades not simulated every frame are copied at their latest result.
+	class OceanDisplacementReadback
+	{
+	public:
+		void Init(IRenderDevice *pDevice);
+
+		//Time - simulation time of the displacement computed this frame
+		void Update(IDeviceContext *pContext, const OceanWave &Ocean, const float Time, OceanHeightQuery &Query);
+
+	protected:
+		//staging textures follow the resolution of the cascades, the ring restarts when it changes
+		void InitStaging(const int Cascade, const int N);
+
+		void PublishSlot(IDeviceContext *pContext, const uint32_t Slot, const ExportRenderParams &Params, OceanHeightQuery &Query);
+
+	private:
+		IRenderDevice *m_pDevice = nullptr;
+		int m_N[OCEAN_CASCADE_NUM] = {};
+		uint64_t m_Frame = 0;
+		float m_CopyTime[OCEAN_READBACK_LATENCY] = {};
+		RefCntAutoPtr<ITexture> m_apStagingTexs[OCEAN_READBACK_LATENCY][OCEAN_CASCADE_NUM];
+
+		//the copy of a slot is done once the fence reaches its value, 0 - no copy
+		RefCntAutoPtr<IFence> m_pFence;
+		uint64_t m_FenceValue = 0;
+		uint64_t m_SlotFenceValues[OCEAN_READBACK_LATENCY] = {};
+		uint64_t m_PublishedFenceValue = 0;
+	};
+}
+
+#endif
@@ -1,33 +1,114 @@
 #include "OceanWave.h"
 
+#include <algorithm>
 #include <random>
 
 #include "MapHelper.hpp"
 #include "ShaderMacroHelper.hpp"
+#include "ImGuiProfiler/ProfilerTask.h"
 
-Diligent::WaveCascadeData::WaveCascadeData(IRenderDevice *pDevice, \
-	IPipelineState* pHKSpectrumPSO, IPipelineState* pIFFTRowPSO, IPipelineState* pIFFTColumnPSO, IPipelineState* pResultMergePSO, \
-	ITexture* pGaussNoiseTex)
+void Diligent::GenerateOceanGaussNoise(const int N, const uint32_t Seed, std::vector<float2> &Noise, const int NoiseN)
+{
+	if (NoiseN > N)
+	{
+		//the spectrum is centered, the wave vectors of N are the center block of NoiseN
+		std::vector<float2> FullNoise;
+		GenerateOceanGaussNoise(NoiseN, Seed, FullNoise);
+		const int Offset = (NoiseN - N) / 2;
+		Noise.resize(size_t(N) * N);
+		for (int y = 0; y < N; ++y)
+		{
+			memcpy(&Noise[size_t(y) * N], &FullNoise[size_t(y + Offset) * NoiseN + Offset], sizeof(float2) * N);
+		}
+		return;
+	}
+
+	std::mt19937 gen(Seed);
+
+	//(0, 1), never 0 for the log
+	auto UniformRandom = [&]()->double
+	{
+		return (double(gen()) + 0.5) * (1.0 / 4294967296.0);
+	};
+	auto NormalRandom = [&]()->float
+	{
+		const double u0 = UniformRandom();
+		const double u1 = UniformRandom();
+		return float(std::cos(2.0 * PI * u0) * std::sqrt(-2.0 * std::log(u1)));
+	};
+
+	Noise.resize(size_t(N) * N);
+	for (size_t i = 0; i < Noise.size(); ++i)
+	{
+		const float x = NormalRandom();
+		const float y = NormalRandom();
+		Noise[i] = float2(x, y);
+	}
+}
+
+void Diligent::GetOceanCascadeParams(const int N, const float *pLengthScales, HKSpectrumGlobalParam *pParams, const float *pLoopPeriods)
+{
+	float boundary1 = 2 * PI_F / pLengthScales[1] * 6.0f;
+	float boundary2 = 2 * PI_F / pLengthScales[2] * 6.0f;
+
+	pParams[0] = HKSpectrumGlobalParam(float(N), pLengthScales[0], 0.0001f, boundary1);
+	pParams[1] = HKSpectrumGlobalParam(float(N), pLengthScales[1], boundary1, boundary2);
+	pParams[2] = HKSpectrumGlobalParam(float(N), pLengthScales[2], boundary2, 9999.9f);
+
+	if (pLoopPeriods)
+	{
+		for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+		{
+			pParams[i].LoopPeriod = pLoopPeriods[i];
+		}
+	}
+}
+
+Diligent::WaveCascadeData::WaveCascadeData(IRenderDevice *pDevice, IPipelineState* pHKSpectrumPSO, IPipelineState* pResultMergePSO) :
+	m_bSpectrumValid(false),
+	m_UpdateInterval(1),
+	m_SkippedFrames(0),
+	m_CurrResult(1),
+	m_ResultNum(0)
 {
 	m_pDevice = pDevice;
 
 	m_pHKSpectrumPSO = pHKSpectrumPSO;
-	m_pIFFTRowPSO = pIFFTRowPSO;
-	m_pIFFTColumnPSO = pIFFTColumnPSO;
+	m_pIFFTRowPSO = nullptr;
+	m_pIFFTColumnPSO = nullptr;
 	m_pResultMergePSO = pResultMergePSO;
 
-	m_pGaussNoiseTex = pGaussNoiseTex;
+	m_pGaussNoiseTex = nullptr;
+
+	memset(m_SpectrumElementParam, 0, sizeof(m_SpectrumElementParam));
+	m_ResultTime[0] = m_ResultTime[1] = 0.0f;
 
-	//Create SRB
+	//Create SRB, the IFFT ones come with the N
 	m_pHKSpectrumPSO->CreateShaderResourceBinding(&m_apHKSpectrumSRB, true);
-	m_pIFFTRowPSO->CreateShaderResourceBinding(&m_apIFFTRowSRB, true);
-	m_pIFFTColumnPSO->CreateShaderResourceBinding(&m_apIFFTColumnSRB, true);
 	m_pResultMergePSO->CreateShaderResourceBinding(&m_apResultMergeSRB, true);
 }
 
-void Diligent::WaveCascadeData::Init(const int N, const HKSpectrumGlobalParam &param)
+void Diligent::WaveCascadeData::Init(const int N, const HKSpectrumGlobalParam &param, const uint32_t UpdateInterval, \
+	IPipelineState* pIFFTRowPSO, IPipelineState* pIFFTColumnPSO, ITexture* pGaussNoiseTex)
 {	
 	m_HKScaleCutSpectrumData = param;
+	m_UpdateInterval = std::max(UpdateInterval, 1u);
+
+	m_pIFFTRowPSO = pIFFTRowPSO;
+	m_pIFFTColumnPSO = pIFFTColumnPSO;
+	m_pGaussNoiseTex = pGaussNoiseTex;
+
+	m_apIFFTRowSRB.Release();
+	m_apIFFTColumnSRB.Release();
+	m_pIFFTRowPSO->CreateShaderResourceBinding(&m_apIFFTRowSRB, true);
+	m_pIFFTColumnPSO->CreateShaderResourceBinding(&m_apIFFTColumnSRB, true);
+
+	//the results restart
+	m_bSpectrumValid = false;
+	m_SkippedFrames = 0;
+	m_CurrResult = 1;
+	m_ResultNum = 0;
+
 	InitTexture(N);
 	InitBuffer();
 }
@@ -43,6 +124,11 @@ void Diligent::WaveCascadeData::InitTexture(const int N)
 	InitFloat2Type.Format = TEX_FORMAT_RG32_FLOAT;
 	InitFloat2Type.Usage = USAGE_DYNAMIC;
 	InitFloat2Type.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+	m_apHkSpectrum.Release();
+	m_apDxDz.Release();
+	m_apDyDxz.Release();
+	m_apDyxDyz.Release();
+	m_apDxxDzz.Release();
 	m_pDevice->CreateTexture(InitFloat2Type, nullptr, &m_apHkSpectrum);
 	m_pDevice->CreateTexture(InitFloat2Type, nullptr, &m_apDxDz);
 	m_pDevice->CreateTexture(InitFloat2Type, nullptr, &m_apDyDxz);
@@ -58,17 +144,46 @@ void Diligent::WaveCascadeData::InitTexture(const int N)
 	InitFloat4Type.Format = TEX_FORMAT_RGBA32_FLOAT;
 	InitFloat4Type.Usage = USAGE_DYNAMIC;
 	InitFloat4Type.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+	m_apWaveDataSpectrum.Release();
+	m_apBufferTmp0.Release();
+	m_apBufferTmp1.Release();
 	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apWaveDataSpectrum);
 	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apBufferTmp0);
 	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apBufferTmp1);
-	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apDisplacement);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_apDisplacement[i].Release();
+		m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apDisplacement[i]);
+	}
 
 	InitFloat4Type.MipLevels = 0;  //full mipmap chain
 	InitFloat4Type.MiscFlags = MISC_TEXTURE_FLAG_GENERATE_MIPS;
-	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apDerivatives);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_apDerivatives[i].Release();
+		m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apDerivatives[i]);
+	}
+	m_apTurbulence.Release();
 	m_pDevice->CreateTexture(InitFloat4Type, nullptr, &m_apTurbulence);
 }
 
+size_t Diligent::WaveCascadeData::GetGPUMemorySize(const int N)
+{
+	size_t MipTexels = 0;
+	for (int Size = N; Size > 0; Size /= 2)
+	{
+		MipTexels += size_t(Size) * Size;
+	}
+
+	//H0K, DxDz, DyDxz, DyxDyz, DxxDzz
+	size_t Bytes = 5 * sizeof(float2) * N * N;
+	//WavesData, the two IFFT buffers, the two displacements
+	Bytes += 5 * sizeof(float4) * N * N;
+	//the two derivatives and the turbulence with their mips
+	Bytes += 3 * sizeof(float4) * MipTexels;
+	return Bytes;
+}
+
 void Diligent::WaveCascadeData::InitBuffer()
 {
 	BufferDesc ConstHKSpectrumBuffer;
@@ -77,6 +192,7 @@ void Diligent::WaveCascadeData::InitBuffer()
 	ConstHKSpectrumBuffer.BindFlags = BIND_UNIFORM_BUFFER;
 	ConstHKSpectrumBuffer.CPUAccessFlags = CPU_ACCESS_WRITE;
 	ConstHKSpectrumBuffer.uiSizeInBytes = sizeof(HKSpectrumBuffer);
+	m_apHKSpectrumParamsBuffer.Release();
 	m_pDevice->CreateBuffer(ConstHKSpectrumBuffer, nullptr, &m_apHKSpectrumParamsBuffer);
 	IShaderResourceVariable *pHKSpectrumBuffer = m_apHKSpectrumSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbHKSpectrumBuffer");
 	pHKSpectrumBuffer->Set(m_apHKSpectrumParamsBuffer);
@@ -87,6 +203,7 @@ void Diligent::WaveCascadeData::InitBuffer()
 	ConstIFFTBuffer.BindFlags = BIND_UNIFORM_BUFFER;
 	ConstIFFTBuffer.CPUAccessFlags = CPU_ACCESS_WRITE;
 	ConstIFFTBuffer.uiSizeInBytes = sizeof(IFFTBuffer);
+	m_apIFFTParamsBuffer.Release();
 	m_pDevice->CreateBuffer(ConstIFFTBuffer, nullptr, &m_apIFFTParamsBuffer);
 	IShaderResourceVariable *pIFFTBuffer = m_apIFFTColumnSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbIFFTBuffer");
 	pIFFTBuffer->Set(m_apIFFTParamsBuffer);
@@ -99,22 +216,128 @@ void Diligent::WaveCascadeData::InitBuffer()
 	ConstResultMergeBuffer.BindFlags = BIND_UNIFORM_BUFFER;
 	ConstResultMergeBuffer.CPUAccessFlags = CPU_ACCESS_WRITE;
 	ConstResultMergeBuffer.uiSizeInBytes = sizeof(IFFTBuffer);
+	m_apResultMergeBuffer.Release();
 	m_pDevice->CreateBuffer(ConstResultMergeBuffer, nullptr, &m_apResultMergeBuffer);
 	IShaderResourceVariable *pResultMergeBuffer = m_apResultMergeSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbResultMergeBuffer");
 	pResultMergeBuffer->Set(m_apResultMergeBuffer);
 }
 
-void Diligent::WaveCascadeData::ComputeWave(IDeviceContext *pContext, const OceanRenderParams& params)
+bool Diligent::WaveCascadeData::ComputeWave(IDeviceContext *pContext, const OceanRenderParams& params, FrameProfiler *pProfiler, const ProfileScopeId ProfileScope)
 {
-	ComputeHKSpectrum(pContext, params);
+	if (m_ResultNum > 0 && m_SkippedFrames + 1 < m_UpdateInterval)
+	{
+		++m_SkippedFrames;
+		return false;
+	}
+	m_SkippedFrames = 0;
+
+	//A cascade simulated every UpdateInterval frames runs that far ahead, the frames
+	//until its next simulation lerp from the previous result toward it.
+	float Time = params.IFFTParam.Time;
+	if (m_ResultNum > 0 && m_UpdateInterval > 1)
+	{
+		Time += params.MergeParam.DeltaTime * m_UpdateInterval;
+	}
+
+	const int N = GetN();
+	OceanRenderParams CascadeParams = params;
+	CascadeParams.IFFTParam = IFFTBuffer({ Time, float(N), float(N / 2), std::log2(float(N)) });
+	if (m_ResultNum > 0)
+	{
+		//turbulence integrates over the time between two simulations
+		CascadeParams.MergeParam.DeltaTime = Time - m_ResultTime[m_CurrResult];
+	}
+
+	m_CurrResult = 1 - m_CurrResult;
+	m_ResultTime[m_CurrResult] = Time;
+	m_ResultNum = std::min(m_ResultNum + 1, 2);
+
+	{
+		GPUProfileScope gpuscope(ProfileScope != InvalidProfileScopeId ? pProfiler : nullptr, pContext, ProfileScope);
+		Simulate(pContext, CascadeParams);
+	}
+	return true;
+}
+
+void Diligent::WaveCascadeData::Simulate(IDeviceContext *pContext, const OceanRenderParams& params)
+{
+	//H0K and WavesData only depend on the spectrum settings
+	const HKSpectrumElementParam *pElementParam = params.HKSpectrumParam.SpectrumElementParam;
+	if (!m_bSpectrumValid || memcmp(m_SpectrumElementParam, pElementParam, sizeof(m_SpectrumElementParam)) != 0)
+	{
+		memcpy(m_SpectrumElementParam, pElementParam, sizeof(m_SpectrumElementParam));
+		m_bSpectrumValid = true;
+		ComputeHKSpectrum(pContext, params);
+	}
 	ComputeIFFT(pContext, params);
 	ResultMerge(pContext, params);
 	GenerateFullMipmap(pContext);
 }
 
-Diligent::OceanRenderTextures Diligent::WaveCascadeData::GetRenderTexture()
+Diligent::OceanRenderTextures Diligent::WaveCascadeData::GetRenderTexture(const float Time) const
 {
-	return OceanRenderTextures({ m_apDisplacement, m_apDerivatives, m_apTurbulence });
+	const int PrevResult = 1 - m_CurrResult;
+
+	OceanRenderTextures Texs;
+	Texs.pDisp = m_apDisplacement[m_CurrResult];
+	Texs.pDeriva = m_apDerivatives[m_CurrResult];
+	Texs.pTurb = m_apTurbulence;
+	Texs.pPrevDisp = m_apDisplacement[PrevResult];
+	Texs.pPrevDeriva = m_apDerivatives[PrevResult];
+	Texs.Blend = 1.0f;
+	if (m_ResultNum > 1 && m_ResultTime[m_CurrResult] > m_ResultTime[PrevResult])
+	{
+		Texs.Blend = clamp((Time - m_ResultTime[PrevResult]) / (m_ResultTime[m_CurrResult] - m_ResultTime[PrevResult]), 0.0f, 1.0f);
+	}
+	return Texs;
+}
+
+void Diligent::WaveCascadeData::Readback(IDeviceContext *pContext, OceanCascadeFields &Fields)
+{
+	const int N = GetN();
+	Fields.N = N;
+
+	ITexture *pSrcTexs[] = { m_apDisplacement[m_CurrResult], m_apDerivatives[m_CurrResult], m_apTurbulence };
+	std::vector<float4> *pDstFields[] = { &Fields.Displacement, &Fields.Derivatives, &Fields.Turbulence };
+
+	TextureDesc StagingDesc;
+	StagingDesc.Name = "Ocean cascade readback";
+	StagingDesc.Type = RESOURCE_DIM_TEX_2D;
+	StagingDesc.Width = N;
+	StagingDesc.Height = N;
+	StagingDesc.MipLevels = 1;
+	StagingDesc.Format = TEX_FORMAT_RGBA32_FLOAT;
+	StagingDesc.Usage = USAGE_STAGING;
+	StagingDesc.BindFlags = BIND_NONE;
+	StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+
+	RefCntAutoPtr<ITexture> apStagingTexs[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		m_pDevice->CreateTexture(StagingDesc, nullptr, &apStagingTexs[i]);
+
+		CopyTextureAttribs CopyAttribs(pSrcTexs[i], RESOURCE_STATE_TRANSITION_MODE_TRANSITION, apStagingTexs[i], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyTexture(CopyAttribs);
+	}
+	pContext->WaitForIdle();
+
+	for (int i = 0; i < 3; ++i)
+	{
+		std::vector<float4> &Dst = *pDstFields[i];
+		Dst.assign(size_t(N) * N, float4(0.0f));
+
+		MappedTextureSubresource MappedData;
+		pContext->MapTextureSubresource(apStagingTexs[i], 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+		if (!MappedData.pData)
+		{
+			continue;
+		}
+		for (int y = 0; y < N; ++y)
+		{
+			memcpy(&Dst[size_t(y) * N], reinterpret_cast<const uint8_t*>(MappedData.pData) + size_t(y) * MappedData.Stride, sizeof(float4) * N);
+		}
+		pContext->UnmapTextureSubresource(apStagingTexs[i], 0, 0);
+	}
 }
 
 void Diligent::WaveCascadeData::ComputeHKSpectrum(IDeviceContext *pContext, const OceanRenderParams& params)
@@ -207,8 +430,8 @@ void Diligent::WaveCascadeData::ResultMerge(IDeviceContext *pContext, const Ocea
 	pDyxDyz->Set(m_apDyxDyz->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 	pDxxDzz->Set(m_apDxxDzz->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 
-	pDisp->Set(m_apDisplacement->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
-	pDerivatives->Set(m_apDerivatives->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+	pDisp->Set(m_apDisplacement[m_CurrResult]->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+	pDerivatives->Set(m_apDerivatives[m_CurrResult]->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
 	pTurbulence->Set(m_apTurbulence->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
 
 	pContext->SetPipelineState(m_apResultMergeSRB->GetPipelineState());
@@ -226,20 +449,27 @@ void Diligent::WaveCascadeData::ResultMerge(IDeviceContext *pContext, const Ocea
 
 void Diligent::WaveCascadeData::GenerateFullMipmap(IDeviceContext *pContext)
 {
-	pContext->GenerateMips(m_apDerivatives->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+	pContext->GenerateMips(m_apDerivatives[m_CurrResult]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 	pContext->GenerateMips(m_apTurbulence->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 }
 
 Diligent::OceanWave::OceanWave(const int N, IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory) :
 	m_N(N),
+	m_NoiseSeed(OCEAN_GAUSS_NOISE_SEED),
+	m_Time(0.0f),
 	m_pDevice(pDevice),
+	m_pShaderFactory(pShaderFactory),
 	m_pCascadeFar(nullptr),
 	m_pCascadeMid(nullptr),
 	m_pCascadeNear(nullptr),
-	m_LengthScale0(250.0f),
-	m_LengthScale1(17.0f),
-	m_LengthScale2(5.0f)
+	m_LengthScale0(OCEAN_CASCADE_LENGTH_SCALES[0]),
+	m_LengthScale1(OCEAN_CASCADE_LENGTH_SCALES[1]),
+	m_LengthScale2(OCEAN_CASCADE_LENGTH_SCALES[2])
 {
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		m_LoopPeriods[i] = 0.0f;
+	}
 	CreatePSO(pDevice, pShaderFactory);
 }
 
@@ -264,75 +494,141 @@ Diligent::OceanWave::~OceanWave()
 	}
 }
 
-void Diligent::OceanWave::Init(const int N)
+void Diligent::OceanWave::Init(const int N, const uint32_t NoiseSeed, const OceanCascadeUpdateDesc *pCascadeDescs)
 {
-	m_N = N;
-	if (!m_apGaussNoiseTex)
+	if (N != m_N || NoiseSeed != m_NoiseSeed)
 	{
-		const float EPS = 0.00001f;
-		std::random_device rd;  //Will be used to obtain a seed for the random number engine
-		std::mt19937 gen(rd()); //Standard mersenne_twister_engine seeded with rd()
-		std::uniform_real_distribution<> dis(0.0f + EPS, 1.0);
-
-		auto NormalRandom = [&]()->float
-		{
-			return std::cosf(2 * PI_F * dis(gen)) * std::sqrtf(-2 * std::logf(dis(gen)));
-		};		
-		float2 *pSrcTexData = new float2[N * N];
-		for (int i = 0; i < N; ++i)
-		{
-			for (int j = 0; j < N; ++j)
-			{
-				pSrcTexData[i * N + j] = float2(NormalRandom(), NormalRandom());
-			}
-		}
-
-		TextureData GaussTexData;
-		TextureSubResData TexData;
-		TexData.pData = pSrcTexData;
-		TexData.Stride = sizeof(float2) * N;
-		GaussTexData.pSubResources = &TexData;
-		GaussTexData.NumSubresources = 1;
-
-		TextureDesc TexDesc;
-		TexDesc.Type = RESOURCE_DIM_TEX_2D;
-		TexDesc.Width = N;
-		TexDesc.Height = N;
-		TexDesc.MipLevels = 1;
-		TexDesc.Format = TEX_FORMAT_RG32_FLOAT;
-		TexDesc.Usage = USAGE_DEFAULT;
-		TexDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-		m_pDevice->CreateTexture(TexDesc, &GaussTexData, &m_apGaussNoiseTex);
-
-		delete[] pSrcTexData;
+		//the noise of every resolution is cut from the one of N
+		m_CascadeResources.clear();
 	}
+	m_N = N;
+	m_NoiseSeed = NoiseSeed;
 
 	if (!m_pCascadeFar)
 	{
-		m_pCascadeFar = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apIFFTRowPSO, m_apIFFTColumnPSO, m_apResultMergePSO, m_apGaussNoiseTex);
+		m_pCascadeFar = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apResultMergePSO);
 	}
 	if (!m_pCascadeMid)
 	{
-		m_pCascadeMid = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apIFFTRowPSO, m_apIFFTColumnPSO, m_apResultMergePSO, m_apGaussNoiseTex);
+		m_pCascadeMid = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apResultMergePSO);
 	}
 	if (!m_pCascadeNear)
 	{
-		m_pCascadeNear = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apIFFTRowPSO, m_apIFFTColumnPSO, m_apResultMergePSO, m_apGaussNoiseTex);
+		m_pCascadeNear = new WaveCascadeData(m_pDevice, m_apHKSpectrumPSO, m_apResultMergePSO);
+	}
+
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		InitCascade(i, pCascadeDescs ? pCascadeDescs[i] : OceanCascadeUpdateDesc());
+	}
+}
+
+void Diligent::OceanWave::SetCascadeUpdateDesc(const int Cascade, const OceanCascadeUpdateDesc &Desc)
+{
+	InitCascade(Cascade, Desc);
+}
+
+Diligent::OceanCascadeUpdateDesc Diligent::OceanWave::GetCascadeUpdateDesc(const int Cascade) const
+{
+	const WaveCascadeData *pCascades[OCEAN_CASCADE_NUM] = { m_pCascadeFar, m_pCascadeMid, m_pCascadeNear };
+
+	OceanCascadeUpdateDesc Desc;
+	Desc.N = pCascades[Cascade]->GetN();
+	Desc.UpdateInterval = pCascades[Cascade]->GetUpdateInterval();
+	return Desc;
+}
+
+void Diligent::OceanWave::SetLoopPeriods(const float *pLoopPeriods)
+{
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		m_LoopPeriods[i] = pLoopPeriods ? pLoopPeriods[i] : 0.0f;
+		InitCascade(i, GetCascadeUpdateDesc(i));
 	}
+}
 
-	float boundary1 = 2 * PI_F / m_LengthScale1 * 6.0f;
-	float boundary2 = 2 * PI_F/ m_LengthScale2 * 6.0f;	
+size_t Diligent::OceanWave::GetGPUMemorySize() const
+{
+	const WaveCascadeData *pCascades[OCEAN_CASCADE_NUM] = { m_pCascadeFar, m_pCascadeMid, m_pCascadeNear };
 
-	m_pCascadeFar->Init(N, HKSpectrumGlobalParam(m_N, m_LengthScale0, 0.0001f, boundary1));
-	m_pCascadeMid->Init(N, HKSpectrumGlobalParam(m_N, m_LengthScale1, boundary1, boundary2));
-	m_pCascadeNear->Init(N, HKSpectrumGlobalParam(m_N, m_LengthScale2, boundary2, 9999.9f));
+	size_t Bytes = 0;
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		Bytes += WaveCascadeData::GetGPUMemorySize(pCascades[i]->GetN());
+	}
+	for (const auto &Resources : m_CascadeResources)
+	{
+		Bytes += sizeof(float2) * Resources.first * Resources.first;
+	}
+	return Bytes;
 }
 
-void Diligent::OceanWave::ComputeOceanWave(IDeviceContext* pContext, const OceanRenderParams& params)
+void Diligent::OceanWave::InitCascade(const int Cascade, const OceanCascadeUpdateDesc &Desc)
 {
-	m_pCascadeFar->ComputeWave(pContext, params);
-	m_pCascadeMid->ComputeWave(pContext, params);
-	m_pCascadeNear->ComputeWave(pContext, params);
+	WaveCascadeData *pCascades[OCEAN_CASCADE_NUM] = { m_pCascadeFar, m_pCascadeMid, m_pCascadeNear };
+	const int N = Desc.N > 0 ? Desc.N : m_N;
+
+	const float LengthScales[OCEAN_CASCADE_NUM] = { m_LengthScale0, m_LengthScale1, m_LengthScale2 };
+	HKSpectrumGlobalParam CascadeParams[OCEAN_CASCADE_NUM];
+	GetOceanCascadeParams(N, LengthScales, CascadeParams, m_LoopPeriods);
+
+	const CascadeResources &Resources = GetCascadeResources(N);
+	pCascades[Cascade]->Init(N, CascadeParams[Cascade], Desc.UpdateInterval, Resources.apIFFTRowPSO, Resources.apIFFTColumnPSO, Resources.apGaussNoiseTex);
+}
+
+const Diligent::OceanWave::CascadeResources &Diligent::OceanWave::GetCascadeResources(const int N)
+{
+	auto Iter = m_CascadeResources.find(N);
+	if (Iter != m_CascadeResources.end())
+	{
+		return Iter->second;
+	}
+
+	CascadeResources &Resources = m_CascadeResources[N];
+	_CreateIFFTRowPSO(m_pDevice, m_pShaderFactory, N, &Resources.apIFFTRowPSO);
+	_CreateIFFTColumnPSO(m_pDevice, m_pShaderFactory, N, &Resources.apIFFTColumnPSO);
+
+	//a lower resolution keeps the wave components it can hold, above m_N the noise is its own
+	std::vector<float2> GaussNoise;
+	GenerateOceanGaussNoise(N, m_NoiseSeed, GaussNoise, m_N);
+
+	TextureData GaussTexData;
+	TextureSubResData TexData;
+	TexData.pData = GaussNoise.data();
+	TexData.Stride = sizeof(float2) * N;
+	GaussTexData.pSubResources = &TexData;
+	GaussTexData.NumSubresources = 1;
+
+	TextureDesc TexDesc;
+	TexDesc.Type = RESOURCE_DIM_TEX_2D;
+	TexDesc.Width = N;
+	TexDesc.Height = N;
+	TexDesc.MipLevels = 1;
+	TexDesc.Format = TEX_FORMAT_RG32_FLOAT;
+	TexDesc.Usage = USAGE_DEFAULT;
+	TexDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+	m_pDevice->CreateTexture(TexDesc, &GaussTexData, &Resources.apGaussNoiseTex);
+
+	return Resources;
+}
+
+void Diligent::OceanWave::ComputeOceanWave(IDeviceContext* pContext, const OceanRenderParams& params, FrameProfiler *pProfiler)
+{
+	static const ProfileScopeId FarScope = FrameProfiler::RegisterScope("Ocean cascade far", Colors::peterRiver);
+	static const ProfileScopeId MidScope = FrameProfiler::RegisterScope("Ocean cascade mid", Colors::peterRiver);
+	static const ProfileScopeId NearScope = FrameProfiler::RegisterScope("Ocean cascade near", Colors::peterRiver);
+
+	m_Time = params.IFFTParam.Time;
+
+	m_pCascadeFar->ComputeWave(pContext, params, pProfiler, FarScope);
+	m_pCascadeMid->ComputeWave(pContext, params, pProfiler, MidScope);
+	m_pCascadeNear->ComputeWave(pContext, params, pProfiler, NearScope);
+}
+
+void Diligent::OceanWave::ReadbackCascade(IDeviceContext *pContext, const int Cascade, OceanCascadeFields &Fields)
+{
+	WaveCascadeData *pCascades[OCEAN_CASCADE_NUM] = { m_pCascadeFar, m_pCascadeMid, m_pCascadeNear };
+	pCascades[Cascade]->Readback(pContext, Fields);
 }
 
 Diligent::ExportRenderParams Diligent::OceanWave::ExportParamsToShader() const
@@ -342,20 +638,18 @@ Diligent::ExportRenderParams Diligent::OceanWave::ExportParamsToShader() const
 	params.LengthScales[1] = m_LengthScale1;
 	params.LengthScales[2] = m_LengthScale2;
 
-	params.OceanRenderTexs[0] = m_pCascadeFar->GetRenderTexture();
-	params.OceanRenderTexs[1] = m_pCascadeMid->GetRenderTexture();
-	params.OceanRenderTexs[2] = m_pCascadeNear->GetRenderTexture();
+	params.OceanRenderTexs[0] = m_pCascadeFar->GetRenderTexture(m_Time);
+	params.OceanRenderTexs[1] = m_pCascadeMid->GetRenderTexture(m_Time);
+	params.OceanRenderTexs[2] = m_pCascadeNear->GetRenderTexture(m_Time);
 
 	return params;
 }
 
 void Diligent::OceanWave::CreatePSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory)
 {
+	//the IFFT ones are created for the N of every cascade
 	_CreateSpectrumPSO(pDevice, pShaderFactory);
-	_CreateIFFTColumnPSO(pDevice, pShaderFactory);
-	_CreateIFFTRowPSO(pDevice, pShaderFactory);
 	_CreateResultMergePSO(pDevice, pShaderFactory);
-	
 }
 
 void Diligent::OceanWave::_CreateSpectrumPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory)
@@ -405,7 +699,7 @@ void Diligent::OceanWave::_CreateSpectrumPSO(IRenderDevice *pDevice, IShaderSour
 	pDevice->CreateComputePipelineState(PSOCreateInfo, &m_apHKSpectrumPSO);
 }
 
-void Diligent::OceanWave::_CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory)
+void Diligent::OceanWave::_CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory, const int N, IPipelineState **ppPSO)
 {
 	ShaderCreateInfo ShaderCI;
 	ShaderCI.pShaderSourceStreamFactory = pShaderFactory;
@@ -416,7 +710,7 @@ void Diligent::OceanWave::_CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourc
 	ShaderCI.UseCombinedTextureSamplers = true;
 
 	ShaderMacroHelper Macros;
-	Macros.AddShaderMacro("THREAD_GROUP_SIZE", m_N);
+	Macros.AddShaderMacro("THREAD_GROUP_SIZE", N);
 	Macros.Finalize();
 
 	RefCntAutoPtr<IShader> pIFFTRowCS;
@@ -439,10 +733,10 @@ void Diligent::OceanWave::_CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourc
 
 	PSODesc.Name = "Wave IFFT Row Compute shader";
 	PSOCreateInfo.pCS = pIFFTRowCS;
-	pDevice->CreateComputePipelineState(PSOCreateInfo, &m_apIFFTRowPSO);
+	pDevice->CreateComputePipelineState(PSOCreateInfo, ppPSO);
 }
 
-void Diligent::OceanWave::_CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory)
+void Diligent::OceanWave::_CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory, const int N, IPipelineState **ppPSO)
 {
 	ShaderCreateInfo ShaderCI;
 	ShaderCI.pShaderSourceStreamFactory = pShaderFactory;
@@ -453,7 +747,7 @@ void Diligent::OceanWave::_CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSo
 	ShaderCI.UseCombinedTextureSamplers = true;
 
 	ShaderMacroHelper Macros;
-	Macros.AddShaderMacro("THREAD_GROUP_SIZE", m_N);
+	Macros.AddShaderMacro("THREAD_GROUP_SIZE", N);
 	Macros.Finalize();
 
 	RefCntAutoPtr<IShader> pIFFTColumnCS;
@@ -476,7 +770,7 @@ void Diligent::OceanWave::_CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSo
 
 	PSODesc.Name = "Wave IFFT Column Compute shader";
 	PSOCreateInfo.pCS = pIFFTColumnCS;
-	pDevice->CreateComputePipelineState(PSOCreateInfo, &m_apIFFTColumnPSO);
+	pDevice->CreateComputePipelineState(PSOCreateInfo, ppPSO);
 }
 
 void Diligent::OceanWave::_CreateResultMergePSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory)
@@ -1,11 +1,20 @@
 #ifndef _OCEAN_WAVE_H_
 #define _OCEAN_WAVE_H_
 
+#include <map>
+#include <vector>
+
 #include "BasicMath.hpp"
 #include "DeviceContext.h"
+#include "FrameProfiler.hpp"
 #include "RefCntAutoPtr.hpp"
 #include "RenderDevice.h"
 
+#define OCEAN_CASCADE_NUM 3
+
+//the GPU and the CPU simulation draw the same noise from this seed
+#define OCEAN_GAUSS_NOISE_SEED 0x0CEA17u
+
 namespace Diligent
 {
 	namespace WaveTextureSpace
@@ -82,7 +91,8 @@ namespace Diligent
 
 		float GravityAcceleration;
 		float Depth;
-		float2 Padding;
+		float LoopPeriod; //0 - no loop, else every frequency is a multiple of 2 PI / LoopPeriod
+		float Padding;
 
 		HKSpectrumGlobalParam()
 		{
@@ -129,11 +139,39 @@ namespace Diligent
 		ResultMergeBuffer MergeParam;
 	};
 
+	//CPU copy of the render textures of one cascade, N * N row major, mip 0 only
+	struct OceanCascadeFields
+	{
+		int N = 0;
+		std::vector<float4> Displacement;
+		std::vector<float4> Derivatives;
+		std::vector<float4> Turbulence;
+	};
+
+	//world size of the far, mid and near cascade
+	static const float OCEAN_CASCADE_LENGTH_SCALES[OCEAN_CASCADE_NUM] = { 250.0f, 17.0f, 5.0f };
+
+	//N * N standard normal pairs, row major. Drawn from the raw mt19937 output, so every
+	//compiler and standard library produces the same noise for a seed.
+	//NoiseN - resolution of the simulation the noise is shared with, 0 for N. A smaller N gets the
+	//center block of that noise, the same wave components up to its band limit.
+	void GenerateOceanGaussNoise(const int N, const uint32_t Seed, std::vector<float2> &Noise, const int NoiseN = 0);
+
+	//spectrum range of the far, mid and near cascade
+	//pLoopPeriods - seconds after which every cascade repeats itself, nullptr for no loop
+	void GetOceanCascadeParams(const int N, const float *pLengthScales, HKSpectrumGlobalParam *pParams, const float *pLoopPeriods = nullptr);
+
 	struct OceanRenderTextures
 	{
 		ITexture *pDisp;
 		ITexture *pDeriva;
 		ITexture *pTurb;
+
+		//the result simulated before pDisp/pDeriva, frames between two simulations
+		//lerp from it by Blend. Blend is 1 for a cascade simulated every frame.
+		ITexture *pPrevDisp;
+		ITexture *pPrevDeriva;
+		float Blend;
 	};
 
 	struct ExportRenderParams
@@ -142,23 +180,43 @@ namespace Diligent
 		float LengthScales[3];
 	};
 
+	//resolution and update rate of one cascade
+	struct OceanCascadeUpdateDesc
+	{
+		int N = 0; //0 - the N of OceanWave, below it the cascade keeps the lower part of its band
+		uint32_t UpdateInterval = 1; //frames per simulation, the frames between interpolate
+	};
+
 	class WaveCascadeData
 	{	
 	public:
-		WaveCascadeData(IRenderDevice *pDevice, \
-			IPipelineState* pHKSpectrumPSO, IPipelineState* pIFFTRowPSO, IPipelineState* pIFFTColumnPSO, IPipelineState* pResultMergePSO, \
-			ITexture* pGaussNoiseTex);
+		WaveCascadeData(IRenderDevice *pDevice, IPipelineState* pHKSpectrumPSO, IPipelineState* pResultMergePSO);
 
-		void Init(const int N, const HKSpectrumGlobalParam &param);
+		//the IFFT pipelines and the noise are the ones of N
+		void Init(const int N, const HKSpectrumGlobalParam &param, const uint32_t UpdateInterval, \
+			IPipelineState* pIFFTRowPSO, IPipelineState* pIFFTColumnPSO, ITexture* pGaussNoiseTex);
 
 		void InitTexture(const int N);
 		void InitBuffer();
 
-		void ComputeWave(IDeviceContext *pContext, const OceanRenderParams& params);
+		//Simulates the cascade on every UpdateInterval-th call, returns false for the skipped ones.
+		//The spectrum is only rebuilt when its params change.
+		bool ComputeWave(IDeviceContext *pContext, const OceanRenderParams& params, FrameProfiler *pProfiler = nullptr, const ProfileScopeId ProfileScope = InvalidProfileScopeId);
 
-		OceanRenderTextures GetRenderTexture();
+		//Time - the current simulation time, sets the blend of the last two results
+		OceanRenderTextures GetRenderTexture(const float Time) const;
+
+		int GetN() const { return int(m_HKScaleCutSpectrumData.N); }
+		uint32_t GetUpdateInterval() const { return m_UpdateInterval; }
+
+		//video memory of the textures of a cascade at N, the noise and the pipelines left out
+		static size_t GetGPUMemorySize(const int N);
+
+		//copies mip 0 of the render textures to the CPU, waits for the GPU
+		void Readback(IDeviceContext *pContext, OceanCascadeFields &Fields);
 
 	protected:
+		void Simulate(IDeviceContext *pContext, const OceanRenderParams& params);
 		void ComputeHKSpectrum(IDeviceContext *pContext, const OceanRenderParams& params);
 		void ComputeIFFT(IDeviceContext *pContext, const OceanRenderParams& params);
 		void ResultMerge(IDeviceContext *pContext, const OceanRenderParams& params);
@@ -167,6 +225,18 @@ namespace Diligent
 	private:
 		HKSpectrumGlobalParam m_HKScaleCutSpectrumData;
 
+		//spectrum params H0K and WavesData were built from
+		HKSpectrumElementParam m_SpectrumElementParam[2];
+		bool m_bSpectrumValid;
+
+		uint32_t m_UpdateInterval;
+		uint32_t m_SkippedFrames;
+
+		//ping pong of the results, m_CurrResult is the latest one
+		int m_CurrResult;
+		int m_ResultNum;
+		float m_ResultTime[2];
+
 		IRenderDevice *m_pDevice;
 		IPipelineState *m_pHKSpectrumPSO;
 		IPipelineState *m_pIFFTRowPSO;
@@ -185,9 +255,10 @@ namespace Diligent
 		RefCntAutoPtr<ITexture> m_apBufferTmp0; //float4
 		RefCntAutoPtr<ITexture> m_apBufferTmp1; //float4
 
-		RefCntAutoPtr<ITexture> m_apDisplacement; //float4
+		RefCntAutoPtr<ITexture> m_apDisplacement[2]; //float4
 		//need to generate mipmap
-		RefCntAutoPtr<ITexture> m_apDerivatives; //float4
+		RefCntAutoPtr<ITexture> m_apDerivatives[2]; //float4
+		//integrated over the simulations, only the latest one
 		RefCntAutoPtr<ITexture> m_apTurbulence; //float4
 
 		//Buffer params
@@ -210,34 +281,65 @@ namespace Diligent
 
 		~OceanWave();
 
-		void Init(const int N);
+		//pCascadeDescs - far, mid and near, nullptr for all at N every frame
+		void Init(const int N, const uint32_t NoiseSeed = OCEAN_GAUSS_NOISE_SEED, const OceanCascadeUpdateDesc *pCascadeDescs = nullptr);
+
+		//re-inits one cascade, its results restart
+		void SetCascadeUpdateDesc(const int Cascade, const OceanCascadeUpdateDesc &Desc);
+		OceanCascadeUpdateDesc GetCascadeUpdateDesc(const int Cascade) const;
 
-		void ComputeOceanWave(IDeviceContext *pContext, const OceanRenderParams &params);
+		//Far, mid and near repeat themselves after these seconds, nullptr or 0 for no loop.
+		//The frequencies are rounded down to the loop, the cascades restart.
+		void SetLoopPeriods(const float *pLoopPeriods);
+
+		//video memory of the cascade textures and the noise
+		size_t GetGPUMemorySize() const;
+
+		//pProfiler - GPU time of every simulated cascade
+		void ComputeOceanWave(IDeviceContext *pContext, const OceanRenderParams &params, FrameProfiler *pProfiler = nullptr);
 
 		ExportRenderParams ExportParamsToShader() const;
 
+		//0 far, 1 mid, 2 near, the order of ExportRenderParams. The latest result.
+		void ReadbackCascade(IDeviceContext *pContext, const int Cascade, OceanCascadeFields &Fields);
+
 	protected:
 		void CreatePSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory);
 		void _CreateSpectrumPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory);
-		void _CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory);
-		void _CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory);
+		void _CreateIFFTRowPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory, const int N, IPipelineState **ppPSO);
+		void _CreateIFFTColumnPSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory, const int N, IPipelineState **ppPSO);
 		void _CreateResultMergePSO(IRenderDevice *pDevice, IShaderSourceInputStreamFactory *pShaderFactory);
 
+		//IFFT pipelines are compiled for one N, the noise is cropped to it
+		struct CascadeResources
+		{
+			RefCntAutoPtr<IPipelineState> apIFFTRowPSO;
+			RefCntAutoPtr<IPipelineState> apIFFTColumnPSO;
+			RefCntAutoPtr<ITexture> apGaussNoiseTex;
+		};
+		const CascadeResources &GetCascadeResources(const int N);
+
+		void InitCascade(const int Cascade, const OceanCascadeUpdateDesc &Desc);
+
 	private:
 		int m_N;
+		uint32_t m_NoiseSeed;
 		float m_LengthScale0, m_LengthScale1, m_LengthScale2;
+		float m_LoopPeriods[OCEAN_CASCADE_NUM];
+
+		//simulation time of the last ComputeOceanWave
+		float m_Time;
 
 		IRenderDevice *m_pDevice;
+		IShaderSourceInputStreamFactory *m_pShaderFactory;
 
 		WaveCascadeData *m_pCascadeNear;
 		WaveCascadeData *m_pCascadeMid;
 		WaveCascadeData *m_pCascadeFar;
 
 		RefCntAutoPtr<IPipelineState> m_apHKSpectrumPSO;
-		RefCntAutoPtr<IPipelineState> m_apIFFTRowPSO;
-		RefCntAutoPtr<IPipelineState> m_apIFFTColumnPSO;
 		RefCntAutoPtr<IPipelineState> m_apResultMergePSO;
-		RefCntAutoPtr<ITexture> m_apGaussNoiseTex;
+		std::map<int, CascadeResources> m_CascadeResources;
 	};
 }
 
@@ -0,0 +1,665 @@
+#include "OceanWaveCPU.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define OCEAN_CPU_USE_SSE2 1
+#else
+#	define OCEAN_CPU_USE_SSE2 0
+#endif
+
+//columns of one work item, whole cache lines of the row spectrum and the fields
+#define OCEAN_CPU_COLUMN_BLOCK 8
+
+namespace
+{
+	using namespace Diligent;
+
+	//the constants of the shaders, kept for the same results
+	const float SHADER_PI = 3.1415926f;
+
+#if OCEAN_CPU_USE_SSE2
+	typedef __m128 Lane4;
+
+	inline Lane4 LoadLane(const float *p) { return _mm_load_ps(p); }
+	inline void StoreLane(float *p, const Lane4 &a) { _mm_store_ps(p, a); }
+	inline Lane4 SetLane(const float f) { return _mm_set1_ps(f); }
+	inline Lane4 AddLane(const Lane4 &a, const Lane4 &b) { return _mm_add_ps(a, b); }
+	inline Lane4 SubLane(const Lane4 &a, const Lane4 &b) { return _mm_sub_ps(a, b); }
+	inline Lane4 MulLane(const Lane4 &a, const Lane4 &b) { return _mm_mul_ps(a, b); }
+#else
+	struct Lane4
+	{
+		float v[4];
+	};
+
+	inline Lane4 LoadLane(const float *p) { return Lane4{ { p[0], p[1], p[2], p[3] } }; }
+	inline void StoreLane(float *p, const Lane4 &a) { memcpy(p, a.v, sizeof(a.v)); }
+	inline Lane4 SetLane(const float f) { return Lane4{ { f, f, f, f } }; }
+	inline Lane4 AddLane(const Lane4 &a, const Lane4 &b) { return Lane4{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+	inline Lane4 SubLane(const Lane4 &a, const Lane4 &b) { return Lane4{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+	inline Lane4 MulLane(const Lane4 &a, const Lane4 &b) { return Lane4{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+#endif
+
+	struct Complex4
+	{
+		Lane4 Re;
+		Lane4 Im;
+	};
+
+	inline Complex4 Load(const OceanComplex4 &c) { return Complex4{ LoadLane(c.Re), LoadLane(c.Im) }; }
+	inline void Store(OceanComplex4 &c, const Complex4 &a) { StoreLane(c.Re, a.Re); StoreLane(c.Im, a.Im); }
+	inline Complex4 Add(const Complex4 &a, const Complex4 &b) { return Complex4{ AddLane(a.Re, b.Re), AddLane(a.Im, b.Im) }; }
+	inline Complex4 Sub(const Complex4 &a, const Complex4 &b) { return Complex4{ SubLane(a.Re, b.Re), SubLane(a.Im, b.Im) }; }
+
+	//i * a
+	inline Complex4 MulI(const Complex4 &a) { return Complex4{ SubLane(SetLane(0.0f), a.Im), a.Re }; }
+
+	//a * w, w is the same for all lanes
+	inline Complex4 MulTwiddle(const Complex4 &a, const Lane4 &wRe, const Lane4 &wIm)
+	{
+		return Complex4{ SubLane(MulLane(a.Re, wRe), MulLane(a.Im, wIm)), AddLane(MulLane(a.Re, wIm), MulLane(a.Im, wRe)) };
+	}
+
+	//wave_h0.csh
+	float Frequency(float k, float g, float depth)
+	{
+		return std::sqrt(g * k * std::tanh(std::min(k * depth, 20.0f)));
+	}
+
+	float FrequencyDerivative(float k, float g, float depth)
+	{
+		float th = std::tanh(std::min(k * depth, 20.0f));
+		float ch = std::cosh(k * depth);
+		return g * (depth * k / ch / ch + th) / Frequency(k, g, depth) / 2;
+	}
+
+	float NormalisationFactor(float s)
+	{
+		float s2 = s * s;
+		float s3 = s2 * s;
+		float s4 = s3 * s;
+		if (s < 5)
+			return -0.000564f * s4 + 0.00776f * s3 - 0.044f * s2 + 0.192f * s + 0.163f;
+		else
+			return -4.80e-08f * s4 + 1.07e-05f * s3 - 9.53e-04f * s2 + 5.90e-02f * s + 3.93e-01f;
+	}
+
+	float Cosine2s(float theta, float s)
+	{
+		return NormalisationFactor(s) * std::pow(std::abs(std::cos(0.5f * theta)), 2 * s);
+	}
+
+	float SpreadPower(float omega, float peakOmega)
+	{
+		if (omega > peakOmega)
+		{
+			return 9.77f * std::pow(std::abs(omega / peakOmega), -2.5f);
+		}
+		else
+		{
+			return 6.97f * std::pow(std::abs(omega / peakOmega), 5.0f);
+		}
+	}
+
+	float DirectionSpectrum(float theta, float omega, const HKSpectrumElementParam &pars)
+	{
+		float s = SpreadPower(omega, pars.PeakOmega)
+			+ 16 * std::tanh(std::min(omega / pars.PeakOmega, 20.0f)) * pars.swell * pars.swell;
+		float a = 2 / 3.1415f * std::cos(theta) * std::cos(theta);
+		float b = Cosine2s(theta - pars.angle, s);
+		return a + (b - a) * pars.SpreadBlend;
+	}
+
+	float TMACorrection(float omega, float g, float depth)
+	{
+		float omegaH = omega * std::sqrt(depth / g);
+		float RetVal = 1;
+		if (omegaH <= 1)
+			RetVal = 0.5f * omegaH * omegaH;
+		if (omegaH < 2)
+			RetVal = 1.0f - 0.5f * (2.0f - omegaH) * (2.0f - omegaH);
+		return RetVal;
+	}
+
+	float JONSWAP(float omega, float g, float depth, const HKSpectrumElementParam &pars)
+	{
+		float sigma;
+		if (omega <= pars.PeakOmega)
+			sigma = 0.07f;
+		else
+			sigma = 0.09f;
+		float r = std::exp(-(omega - pars.PeakOmega) * (omega - pars.PeakOmega)
+			/ 2 / sigma / sigma / pars.PeakOmega / pars.PeakOmega);
+
+		float oneOverOmega = 1 / omega;
+		float peakOmegaOverOmega = pars.PeakOmega / omega;
+		return pars.scale * TMACorrection(omega, g, depth) * pars.alpha * g * g
+			* oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega * oneOverOmega
+			* std::exp(-1.25f * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega * peakOmegaOverOmega)
+			* std::pow(std::abs(pars.gamma), r);
+	}
+
+	float ShortWavesFade(float kLength, const HKSpectrumElementParam &pars)
+	{
+		return std::exp(-pars.ShortWavesFade * pars.ShortWavesFade * kLength * kLength);
+	}
+
+	//amplitude the noise of a wave vector is scaled by, both spectra of pElementParam summed
+	float SpectrumAmplitude(const HKSpectrumGlobalParam &Global, const HKSpectrumElementParam *pElementParam, const float kx, const float kz, const float kLength, const float omega)
+	{
+		const float deltaK = 2 * SHADER_PI / Global.LengthScale;
+		const float kAngle = std::atan2(kz, kx);
+		const float dOmegadk = FrequencyDerivative(kLength, Global.GravityAcceleration, Global.Depth);
+
+		float spectrum = JONSWAP(omega, Global.GravityAcceleration, Global.Depth, pElementParam[0])
+			* DirectionSpectrum(kAngle, omega, pElementParam[0]) * ShortWavesFade(kLength, pElementParam[0]);
+		if (pElementParam[1].scale > 0)
+			spectrum += JONSWAP(omega, Global.GravityAcceleration, Global.Depth, pElementParam[1])
+			* DirectionSpectrum(kAngle, omega, pElementParam[1]) * ShortWavesFade(kLength, pElementParam[1]);
+
+		return std::sqrt(2 * spectrum * std::abs(dOmegadk) / kLength * deltaK * deltaK);
+	}
+
+	//a + i * b of two complex numbers
+	inline void StoreComplexSum(OceanComplex4 &Dst, const int Lane, const float aRe, const float aIm, const float bRe, const float bIm)
+	{
+		Dst.Re[Lane] = aRe - bIm;
+		Dst.Im[Lane] = aIm + bRe;
+	}
+}
+
+void Diligent::OceanFFT::Init(const int N)
+{
+	m_N = N;
+	m_TwiddleRe.resize(N);
+	m_TwiddleIm.resize(N);
+	for (int k = 0; k < N; ++k)
+	{
+		const double Angle = 2.0 * PI * k / N;
+		m_TwiddleRe[k] = float(std::cos(Angle));
+		m_TwiddleIm[k] = float(std::sin(Angle));
+	}
+}
+
+void Diligent::OceanFFT::Inverse(OceanComplex4 *pData, OceanComplex4 *pScratch) const
+{
+	OceanComplex4 *pX = pData;
+	OceanComplex4 *pY = pScratch;
+
+	//n - length of the sub transforms, s - their number and stride
+	int n = m_N;
+	int s = 1;
+	for (; n >= 4; n /= 4, s *= 4)
+	{
+		const int m = n / 4;
+		for (int p = 0; p < m; ++p)
+		{
+			const int k = p * s;
+			const Lane4 w1Re = SetLane(m_TwiddleRe[k]);
+			const Lane4 w1Im = SetLane(m_TwiddleIm[k]);
+			const Lane4 w2Re = SetLane(m_TwiddleRe[2 * k]);
+			const Lane4 w2Im = SetLane(m_TwiddleIm[2 * k]);
+			const Lane4 w3Re = SetLane(m_TwiddleRe[3 * k]);
+			const Lane4 w3Im = SetLane(m_TwiddleIm[3 * k]);
+
+			const OceanComplex4 *pSrc = pX + s * p;
+			OceanComplex4 *pDst = pY + s * 4 * p;
+			for (int q = 0; q < s; ++q)
+			{
+				const Complex4 a = Load(pSrc[q]);
+				const Complex4 b = Load(pSrc[q + s * m]);
+				const Complex4 c = Load(pSrc[q + s * 2 * m]);
+				const Complex4 d = Load(pSrc[q + s * 3 * m]);
+
+				const Complex4 apc = Add(a, c);
+				const Complex4 amc = Sub(a, c);
+				const Complex4 bpd = Add(b, d);
+				const Complex4 jbmd = MulI(Sub(b, d));
+
+				Store(pDst[q], Add(apc, bpd));
+				Store(pDst[q + s], MulTwiddle(Add(amc, jbmd), w1Re, w1Im));
+				Store(pDst[q + s * 2], MulTwiddle(Sub(apc, bpd), w2Re, w2Im));
+				Store(pDst[q + s * 3], MulTwiddle(Sub(amc, jbmd), w3Re, w3Im));
+			}
+		}
+		std::swap(pX, pY);
+	}
+
+	//odd power of two
+	if (n == 2)
+	{
+		for (int q = 0; q < s; ++q)
+		{
+			const Complex4 a = Load(pX[q]);
+			const Complex4 b = Load(pX[q + s]);
+			Store(pY[q], Add(a, b));
+			Store(pY[q + s], Sub(a, b));
+		}
+		std::swap(pX, pY);
+	}
+
+	if (pX != pData)
+	{
+		memcpy(pData, pX, sizeof(OceanComplex4) * m_N);
+	}
+}
+
+void Diligent::WaveCascadeCPU::Init(const int N, const HKSpectrumGlobalParam &param, const float2 *pGaussNoise)
+{
+	m_HKScaleCutSpectrumData = param;
+	m_pGaussNoise = pGaussNoise;
+
+	const size_t TexelNum = size_t(N) * N;
+	m_HkSpectrum.assign(TexelNum, float2(0.0f, 0.0f));
+	m_WaveDataSpectrum.assign(TexelNum, float4(0.0f));
+	m_RowSpectrum.resize(TexelNum);
+
+	m_Fields.N = N;
+	m_Fields.Displacement.assign(TexelNum, float4(0.0f));
+	m_Fields.Derivatives.assign(TexelNum, float4(0.0f));
+	m_Fields.Turbulence.assign(TexelNum, float4(0.0f));
+}
+
+void Diligent::WaveCascadeCPU::ComputeSpectrumRow(const HKSpectrumElementParam *pElementParam, const int Row)
+{
+	const HKSpectrumGlobalParam &Global = m_HKScaleCutSpectrumData;
+	const int N = m_Fields.N;
+	const float deltaK = 2 * SHADER_PI / Global.LengthScale;
+
+	for (int x = 0; x < N; ++x)
+	{
+		const size_t Idx = size_t(Row) * N + x;
+		const float kx = (x - Global.N / 2) * deltaK;
+		const float kz = (Row - Global.N / 2) * deltaK;
+		const float kLength = std::sqrt(kx * kx + kz * kz);
+
+		if (kLength <= Global.CutoffHigh && kLength >= Global.CutoffLow)
+		{
+			const float omega = Frequency(kLength, Global.GravityAcceleration, Global.Depth);
+			float PhaseOmega = omega;
+			if (Global.LoopPeriod > 0)
+			{
+				const float BaseOmega = 2 * SHADER_PI / Global.LoopPeriod;
+				PhaseOmega = std::floor(omega / BaseOmega) * BaseOmega;
+			}
+			m_WaveDataSpectrum[Idx] = float4(kx, 1 / kLength, kz, PhaseOmega);
+
+			const float Amplitude = SpectrumAmplitude(Global, pElementParam, kx, kz, kLength, omega);
+			m_HkSpectrum[Idx] = float2(m_pGaussNoise[Idx].x * Amplitude, m_pGaussNoise[Idx].y * Amplitude);
+		}
+		else
+		{
+			m_HkSpectrum[Idx] = float2(0.0f, 0.0f);
+			m_WaveDataSpectrum[Idx] = float4(kx, 1, kz, 0);
+		}
+	}
+}
+
+void Diligent::WaveCascadeCPU::ComputeRowIFFT(const OceanFFT &FFT, const float Time, const int Row, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1)
+{
+	const int N = FFT.GetN();
+	for (int x = 0; x < N; ++x)
+	{
+		const float4 &wave = m_WaveDataSpectrum[size_t(Row) * N + x];
+		const float phase = wave.w * Time;
+		const float eRe = std::cos(phase);
+		const float eIm = std::sin(phase);
+
+		//the mirrored texel of the first row and column is outside the texture and reads as zero on the GPU
+		const float2 &h0 = m_HkSpectrum[size_t(Row) * N + x];
+		float2 h0m(0.0f, 0.0f);
+		if (x != 0 && Row != 0)
+		{
+			h0m = m_HkSpectrum[size_t(N - Row) * N + (N - x)];
+		}
+
+		//h0 * e + conj(h0m) * conj(e)
+		const float hRe = h0.x * eRe - h0.y * eIm + h0m.x * eRe - h0m.y * eIm;
+		const float hIm = h0.x * eIm + h0.y * eRe - h0m.x * eIm - h0m.y * eRe;
+		const float ihRe = -hIm;
+		const float ihIm = hRe;
+
+		const float kx = wave.x;
+		const float kInv = wave.y;
+		const float kz = wave.z;
+
+		OceanComplex4 &Dst = pScratch0[x];
+		//DxDz - displacement x + i * displacement z
+		StoreComplexSum(Dst, 0, ihRe * kx * kInv, ihIm * kx * kInv, ihRe * kz * kInv, ihIm * kz * kInv);
+		//DyDxz
+		StoreComplexSum(Dst, 1, hRe, hIm, -hRe * kx * kz * kInv, -hIm * kx * kz * kInv);
+		//DyxDyz
+		StoreComplexSum(Dst, 2, ihRe * kx, ihIm * kx, ihRe * kz, ihIm * kz);
+		//DxxDzz
+		StoreComplexSum(Dst, 3, -hRe * kx * kx * kInv, -hIm * kx * kx * kInv, -hRe * kz * kz * kInv, -hIm * kz * kz * kInv);
+	}
+
+	FFT.Inverse(pScratch0, pScratch1);
+	memcpy(&m_RowSpectrum[size_t(Row) * N], pScratch0, sizeof(OceanComplex4) * N);
+}
+
+void Diligent::WaveCascadeCPU::ComputeColumnIFFT(const OceanFFT &FFT, const ResultMergeBuffer &MergeParam, const int ColumnBeg, const int ColumnNum, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1)
+{
+	//the columns are gathered and scattered together, a power of two row stride alone thrashes the cache
+	const int N = FFT.GetN();
+	for (int y = 0; y < N; ++y)
+	{
+		const OceanComplex4 *pSrcRow = &m_RowSpectrum[size_t(y) * N + ColumnBeg];
+		for (int c = 0; c < ColumnNum; ++c)
+		{
+			pScratch0[c * N + y] = pSrcRow[c];
+		}
+	}
+
+	for (int c = 0; c < ColumnNum; ++c)
+	{
+		FFT.Inverse(pScratch0 + c * N, pScratch1);
+	}
+
+	const float Lambda = MergeParam.Lambda;
+	for (int y = 0; y < N; ++y)
+	{
+		for (int c = 0; c < ColumnNum; ++c)
+		{
+			const int Column = ColumnBeg + c;
+			const size_t Idx = size_t(y) * N + Column;
+			const OceanComplex4 &Src = pScratch0[c * N + y];
+
+			//the spectrum is centered on N / 2
+			const float Permute = ((Column + y) & 1) ? -1.0f : 1.0f;
+			const float2 DxDz(Src.Re[0] * Permute, Src.Im[0] * Permute);
+			const float2 DyDxz(Src.Re[1] * Permute, Src.Im[1] * Permute);
+			const float2 DyxDyz(Src.Re[2] * Permute, Src.Im[2] * Permute);
+			const float2 DxxDzz(Src.Re[3] * Permute, Src.Im[3] * Permute);
+
+			m_Fields.Displacement[Idx] = float4(Lambda * DxDz.x, DyDxz.x, Lambda * DxDz.y, 0.0f);
+			m_Fields.Derivatives[Idx] = float4(DyxDyz.x, DyxDyz.y, DxxDzz.x * Lambda, DxxDzz.y * Lambda);
+
+			const float jacobian = (1 + Lambda * DxxDzz.x) * (1 + Lambda * DxxDzz.y) - Lambda * Lambda * DyDxz.y * DyDxz.y;
+			float Turbulence = m_Fields.Turbulence[Idx].x + MergeParam.DeltaTime * 0.5f / std::max(jacobian, 0.5f);
+			Turbulence = std::min(jacobian, Turbulence);
+			m_Fields.Turbulence[Idx] = float4(Turbulence, Turbulence, Turbulence, Turbulence);
+		}
+	}
+}
+
+Diligent::OceanWaveCPU::OceanWaveCPU(const uint32_t ThreadNum) :
+	m_N(0),
+	m_ThreadNum(ThreadNum != 0 ? ThreadNum : std::max(std::thread::hardware_concurrency(), 1u)),
+	m_pPassFunc(nullptr),
+	m_pPassFuncData(nullptr),
+	m_PassItemNum(0),
+	m_PassIndex(0),
+	m_BusyWorkerNum(0),
+	m_bStopWorkers(false),
+	m_NextItem(0),
+	m_bSpectrumValid(false)
+{
+	memset(m_SpectrumElementParam, 0, sizeof(m_SpectrumElementParam));
+	memset(m_LoopPeriods, 0, sizeof(m_LoopPeriods));
+
+	//the scratch is sized by Init, the workers only touch it during a pass
+	m_WorkerScratch.resize(m_ThreadNum);
+	for (uint32_t t = 1; t < m_ThreadNum; ++t)
+	{
+		m_Workers.emplace_back(&OceanWaveCPU::WorkerThreadFunc, this, t);
+	}
+}
+
+Diligent::OceanWaveCPU::~OceanWaveCPU()
+{
+	{
+		std::lock_guard<std::mutex> Lock(m_PassMutex);
+		m_bStopWorkers = true;
+	}
+	m_PassCond.notify_all();
+	for (auto &Worker : m_Workers)
+	{
+		Worker.join();
+	}
+}
+
+void Diligent::OceanWaveCPU::Init(const int N, const uint32_t NoiseSeed, const int NoiseN)
+{
+	m_N = N;
+	GenerateOceanGaussNoise(N, NoiseSeed, m_GaussNoise, NoiseN);
+	m_FFT.Init(N);
+
+	for (WorkerScratch &Scratch : m_WorkerScratch)
+	{
+		Scratch.Scratch0.resize(size_t(N) * OCEAN_CPU_COLUMN_BLOCK);
+		Scratch.Scratch1.resize(N);
+	}
+
+	InitCascades();
+}
+
+void Diligent::OceanWaveCPU::SetLoopPeriods(const float *pLoopPeriods)
+{
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		m_LoopPeriods[i] = pLoopPeriods ? pLoopPeriods[i] : 0.0f;
+	}
+	InitCascades();
+}
+
+void Diligent::OceanWaveCPU::InitCascades()
+{
+	HKSpectrumGlobalParam CascadeParams[OCEAN_CASCADE_NUM];
+	GetOceanCascadeParams(m_N, OCEAN_CASCADE_LENGTH_SCALES, CascadeParams, m_LoopPeriods);
+	for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+	{
+		m_Cascades[i].Init(m_N, CascadeParams[i], m_GaussNoise.data());
+	}
+	m_bSpectrumValid = false;
+}
+
+template<typename FuncType>
+void Diligent::OceanWaveCPU::ParallelFor(const uint32_t Num, const FuncType &Func)
+{
+	RunPass(Num, [](const void *pFunc, const uint32_t Item, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1)
+	{
+		(*static_cast<const FuncType*>(pFunc))(Item, pScratch0, pScratch1);
+	}, &Func);
+}
+
+void Diligent::OceanWaveCPU::RunPass(const uint32_t Num, PassFuncType PassFunc, const void *pFunc)
+{
+	if (Num == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(m_PassMutex);
+		m_pPassFunc = PassFunc;
+		m_pPassFuncData = pFunc;
+		m_PassItemNum = Num;
+		m_NextItem = 0;
+		m_BusyWorkerNum = static_cast<uint32_t>(m_Workers.size());
+		++m_PassIndex;
+	}
+	m_PassCond.notify_all();
+
+	RunPassItems(0);
+
+	//Func and the items live on the caller's stack, every worker has to be done with them
+	std::unique_lock<std::mutex> Lock(m_PassMutex);
+	m_PassDoneCond.wait(Lock, [&]() { return m_BusyWorkerNum == 0; });
+}
+
+void Diligent::OceanWaveCPU::RunPassItems(const uint32_t Worker)
+{
+	WorkerScratch &Scratch = m_WorkerScratch[Worker];
+	for (uint32_t Item = m_NextItem++; Item < m_PassItemNum; Item = m_NextItem++)
+	{
+		m_pPassFunc(m_pPassFuncData, Item, Scratch.Scratch0.data(), Scratch.Scratch1.data());
+	}
+}
+
+void Diligent::OceanWaveCPU::WorkerThreadFunc(const uint32_t Worker)
+{
+	uint32_t PassIndex = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(m_PassMutex);
+			m_PassCond.wait(Lock, [&]() { return m_bStopWorkers || m_PassIndex != PassIndex; });
+			if (m_bStopWorkers)
+			{
+				return;
+			}
+			PassIndex = m_PassIndex;
+		}
+
+		RunPassItems(Worker);
+
+		std::lock_guard<std::mutex> Lock(m_PassMutex);
+		if (--m_BusyWorkerNum == 0)
+		{
+			m_PassDoneCond.notify_one();
+		}
+	}
+}
+
+void Diligent::OceanWaveCPU::ComputeOceanWave(const OceanRenderParams &params)
+{
+	const uint32_t N = static_cast<uint32_t>(m_N);
+	const HKSpectrumElementParam *pElementParam = params.HKSpectrumParam.SpectrumElementParam;
+
+	//the GPU rebuilds H0K every frame, here it only follows the settings
+	if (!m_bSpectrumValid || memcmp(m_SpectrumElementParam, pElementParam, sizeof(m_SpectrumElementParam)) != 0)
+	{
+		memcpy(m_SpectrumElementParam, pElementParam, sizeof(m_SpectrumElementParam));
+		m_bSpectrumValid = true;
+
+		ParallelFor(OCEAN_CASCADE_NUM * N, [&](const uint32_t Item, OceanComplex4*, OceanComplex4*)
+		{
+			m_Cascades[Item / N].ComputeSpectrumRow(m_SpectrumElementParam, Item % N);
+		});
+	}
+
+	const float Time = params.IFFTParam.Time;
+	ParallelFor(OCEAN_CASCADE_NUM * N, [&](const uint32_t Item, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1)
+	{
+		m_Cascades[Item / N].ComputeRowIFFT(m_FFT, Time, Item % N, pScratch0, pScratch1);
+	});
+
+	const uint32_t BlockNum = (N + OCEAN_CPU_COLUMN_BLOCK - 1) / OCEAN_CPU_COLUMN_BLOCK;
+	ParallelFor(OCEAN_CASCADE_NUM * BlockNum, [&](const uint32_t Item, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1)
+	{
+		const uint32_t ColumnBeg = (Item % BlockNum) * OCEAN_CPU_COLUMN_BLOCK;
+		const uint32_t ColumnNum = std::min<uint32_t>(OCEAN_CPU_COLUMN_BLOCK, N - ColumnBeg);
+		m_Cascades[Item / BlockNum].ComputeColumnIFFT(m_FFT, params.MergeParam, ColumnBeg, ColumnNum, pScratch0, pScratch1);
+	});
+}
+
+Diligent::float3 Diligent::GetOceanDisplacementDeviation(const HKSpectrumGlobalParam &Global, const HKSpectrumElementParam *pElementParam, const float Lambda)
+{
+	//The field is the sum of h(k) e^(ikx) over the spectrum, its mean square over x is the sum of |h(k)|^2.
+	//With unit variance noise in both components and random phases E|h(k)|^2 = 2 A(k)^2 + 2 A(-k)^2,
+	//the spectrum is symmetric so every wave vector counts 4 A(k)^2. x and z are scaled by k / |k|.
+	const int N = int(Global.N);
+	const float deltaK = 2 * SHADER_PI / Global.LengthScale;
+
+	double SumX = 0.0, SumY = 0.0, SumZ = 0.0;
+	for (int y = 0; y < N; ++y)
+	{
+		for (int x = 0; x < N; ++x)
+		{
+			const float kx = (x - Global.N / 2) * deltaK;
+			const float kz = (y - Global.N / 2) * deltaK;
+			const float kLength = std::sqrt(kx * kx + kz * kz);
+			if (kLength > Global.CutoffHigh || kLength < Global.CutoffLow)
+			{
+				continue;
+			}
+
+			const float omega = Frequency(kLength, Global.GravityAcceleration, Global.Depth);
+			const float Amplitude = SpectrumAmplitude(Global, pElementParam, kx, kz, kLength, omega);
+			const double Variance = 4.0 * Amplitude * Amplitude;
+			SumX += Variance * kx * kx / (kLength * kLength);
+			SumY += Variance;
+			SumZ += Variance * kz * kz / (kLength * kLength);
+		}
+	}
+	return float3(Lambda * float(std::sqrt(SumX)), float(std::sqrt(SumY)), Lambda * float(std::sqrt(SumZ)));
+}
+
+void Diligent::CompareOceanCascadeFields(const OceanCascadeFields &Ref, const OceanCascadeFields &Fields, float &DisplacementError, float &DerivativesError)
+{
+	auto FieldError = [](const std::vector<float4> &RefField, const std::vector<float4> &Field, const int ComponentNum)
+	{
+		float MaxRef = 0.0f;
+		float MaxDiff = 0.0f;
+		const size_t Num = std::min(RefField.size(), Field.size());
+		for (size_t i = 0; i < Num; ++i)
+		{
+			for (int c = 0; c < ComponentNum; ++c)
+			{
+				MaxRef = std::max(MaxRef, std::abs(RefField[i][c]));
+				MaxDiff = std::max(MaxDiff, std::abs(RefField[i][c] - Field[i][c]));
+			}
+		}
+		if (RefField.size() != Field.size())
+		{
+			return 1e30f;
+		}
+		return MaxRef > 0.0f ? MaxDiff / MaxRef : MaxDiff;
+	};
+
+	//displacement w is not written by the merge shader
+	DisplacementError = FieldError(Ref.Displacement, Fields.Displacement, 3);
+	DerivativesError = FieldError(Ref.Derivatives, Fields.Derivatives, 4);
+}
+
+float Diligent::CheckOceanFFT(const int N, const uint32_t Seed)
+{
+	std::mt19937 Rand(Seed);
+	std::uniform_real_distribution<float> RandSignal(-1.0f, 1.0f);
+
+	std::vector<OceanComplex4> Data(N);
+	std::vector<OceanComplex4> Scratch(N);
+	for (OceanComplex4 &Elem : Data)
+	{
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			Elem.Re[Lane] = RandSignal(Rand);
+			Elem.Im[Lane] = RandSignal(Rand);
+		}
+	}
+	const std::vector<OceanComplex4> Signal = Data;
+
+	OceanFFT FFT;
+	FFT.Init(N);
+	FFT.Inverse(Data.data(), Scratch.data());
+
+	double MaxRef = 0.0;
+	double MaxDiff = 0.0;
+	for (int k = 0; k < N; ++k)
+	{
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			double Re = 0.0;
+			double Im = 0.0;
+			for (int n = 0; n < N; ++n)
+			{
+				const double Angle = 2.0 * PI * ((int64_t(n) * k) % N) / N;
+				const double c = std::cos(Angle);
+				const double s = std::sin(Angle);
+				Re += Signal[n].Re[Lane] * c - Signal[n].Im[Lane] * s;
+				Im += Signal[n].Re[Lane] * s + Signal[n].Im[Lane] * c;
+			}
+			MaxRef = std::max(MaxRef, std::max(std::abs(Re), std::abs(Im)));
+			MaxDiff = std::max(MaxDiff, std::max(std::abs(Re - Data[k].Re[Lane]), std::abs(Im - Data[k].Im[Lane])));
+		}
+	}
+	return float(MaxRef > 0.0 ? MaxDiff / MaxRef : MaxDiff);
+}
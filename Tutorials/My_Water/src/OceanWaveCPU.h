@@ -0,0 +1,162 @@
+#ifndef _OCEAN_WAVE_CPU_H_
+#define _OCEAN_WAVE_CPU_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "OceanWave.h"
+
+namespace Diligent
+{
+	//4 complex signals per element, one per lane
+	struct alignas(16) OceanComplex4
+	{
+		float Re[4];
+		float Im[4];
+	};
+
+	//Unnormalized inverse DFT of 4 signals at once, the sign convention of wave_ifft.csh.
+	//Radix-4 Stockham stages, a radix-2 stage closes odd powers of two.
+	class OceanFFT
+	{
+	public:
+		void Init(const int N);
+
+		//pData and pScratch hold N elements, the result is left in pData
+		void Inverse(OceanComplex4 *pData, OceanComplex4 *pScratch) const;
+
+		int GetN() const { return m_N; }
+
+	private:
+		int m_N = 0;
+		std::vector<float> m_TwiddleRe;
+		std::vector<float> m_TwiddleIm;
+	};
+
+	//CPU counterpart of WaveCascadeData: the spectrum of wave_h0.csh, the inverse FFTs of wave_ifft.csh
+	//and the merge of wave_result_merge.csh. The four complex fields of a texel share one OceanComplex4.
+	class WaveCascadeCPU
+	{
+	public:
+		void Init(const int N, const HKSpectrumGlobalParam &param, const float2 *pGaussNoise);
+
+		//H0K and WavesData of one row
+		void ComputeSpectrumRow(const HKSpectrumElementParam *pElementParam, const int Row);
+
+		//time dependent spectrum of one row and its inverse FFT
+		void ComputeRowIFFT(const OceanFFT &FFT, const float Time, const int Row, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1);
+
+		//inverse FFT of neighbour columns, merged into the render fields. pScratch0 holds ColumnNum * N elements.
+		void ComputeColumnIFFT(const OceanFFT &FFT, const ResultMergeBuffer &MergeParam, const int ColumnBeg, const int ColumnNum, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1);
+
+		const OceanCascadeFields &GetFields() const { return m_Fields; }
+
+	private:
+		HKSpectrumGlobalParam m_HKScaleCutSpectrumData;
+		const float2 *m_pGaussNoise = nullptr;
+
+		std::vector<float2> m_HkSpectrum;
+		std::vector<float4> m_WaveDataSpectrum;
+
+		//DxDz, DyDxz, DyxDyz, DxxDzz after the row pass
+		std::vector<OceanComplex4> m_RowSpectrum;
+
+		OceanCascadeFields m_Fields;
+	};
+
+	//The three cascades of OceanWave simulated on the CPU for physics, servers and headless runs.
+	//Rows and columns of all cascades are spread over a pool of worker threads started with the
+	//object, the spectrum is only rebuilt when its parameters change.
+	class OceanWaveCPU
+	{
+	public:
+		//0 threads - one per hardware thread, the calling thread is one of them
+		explicit OceanWaveCPU(const uint32_t ThreadNum = 0);
+		~OceanWaveCPU();
+
+		OceanWaveCPU(const OceanWaveCPU &) = delete;
+		OceanWaveCPU &operator=(const OceanWaveCPU &) = delete;
+
+		//NoiseN - resolution of the simulation the noise is shared with, 0 for N. A smaller N then
+		//keeps the same wave components up to its band limit, a low resolution copy of that ocean.
+		void Init(const int N, const uint32_t NoiseSeed = OCEAN_GAUSS_NOISE_SEED, const int NoiseN = 0);
+
+		//far, mid and near repeat themselves after these seconds, nullptr or 0 for no loop
+		void SetLoopPeriods(const float *pLoopPeriods);
+
+		void ComputeOceanWave(const OceanRenderParams &params);
+
+		//0 far, 1 mid, 2 near, the order of ExportRenderParams
+		const OceanCascadeFields &GetCascadeFields(const int Cascade) const { return m_Cascades[Cascade].GetFields(); }
+		float GetLengthScale(const int Cascade) const { return OCEAN_CASCADE_LENGTH_SCALES[Cascade]; }
+		int GetN() const { return m_N; }
+
+	protected:
+		typedef void (*PassFuncType)(const void *pFunc, const uint32_t Item, OceanComplex4 *pScratch0, OceanComplex4 *pScratch1);
+
+		struct WorkerScratch
+		{
+			std::vector<OceanComplex4> Scratch0; //N * OCEAN_CPU_COLUMN_BLOCK elements
+			std::vector<OceanComplex4> Scratch1; //N elements
+		};
+
+		//Func(Item, Scratch0, Scratch1) for every item in [0, Num), on the pool and the calling thread
+		template<typename FuncType>
+		void ParallelFor(const uint32_t Num, const FuncType &Func);
+		void RunPass(const uint32_t Num, PassFuncType PassFunc, const void *pFunc);
+		void RunPassItems(const uint32_t Worker);
+		void WorkerThreadFunc(const uint32_t Worker);
+
+		void InitCascades();
+
+	private:
+		int m_N;
+		uint32_t m_ThreadNum;
+
+		//worker 0 is the calling thread, m_Workers[i] runs worker i + 1
+		std::vector<std::thread> m_Workers;
+		std::vector<WorkerScratch> m_WorkerScratch;
+
+		//the current pass, written under m_PassMutex while no worker is busy
+		std::mutex m_PassMutex;
+		std::condition_variable m_PassCond;
+		std::condition_variable m_PassDoneCond;
+		PassFuncType m_pPassFunc;
+		const void *m_pPassFuncData;
+		uint32_t m_PassItemNum;
+		uint32_t m_PassIndex;
+		uint32_t m_BusyWorkerNum;
+		bool m_bStopWorkers;
+		std::atomic<uint32_t> m_NextItem;
+
+		std::vector<float2> m_GaussNoise;
+		OceanFFT m_FFT;
+		WaveCascadeCPU m_Cascades[OCEAN_CASCADE_NUM];
+
+		HKSpectrumElementParam m_SpectrumElementParam[2];
+		bool m_bSpectrumValid;
+
+		float m_LoopPeriods[OCEAN_CASCADE_NUM];
+	};
+
+	//Standard deviation of the x, y and z displacement of a cascade over its surface and time, from the
+	//spectrum alone. The waves are a sum of many random phased components, close to a normal distribution,
+	//so a few deviations bound the displacement without simulating it.
+	float3 GetOceanDisplacementDeviation(const HKSpectrumGlobalParam &Global, const HKSpectrumElementParam *pElementParam, const float Lambda = 1.0f);
+
+	//Largest difference of two results relative to the largest magnitude of the reference field.
+	//Turbulence integrates over frames, it is only comparable from the same history and left out.
+	void CompareOceanCascadeFields(const OceanCascadeFields &Ref, const OceanCascadeFields &Fields, float &DisplacementError, float &DerivativesError);
+
+	//Largest difference of OceanFFT::Inverse on random signals of length N from a double precision
+	//naive DFT, relative to the largest magnitude of the DFT.
+	float CheckOceanFFT(const int N, const uint32_t Seed = 1);
+}
+
+#endif
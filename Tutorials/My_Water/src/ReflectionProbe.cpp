@@ -1,6 +1,7 @@
 #include "ReflectionProbe.h"
 
-Diligent::ReflectionProbe::ReflectionProbe(const float3& pos)
+Diligent::ReflectionProbe::ReflectionProbe(const float3& pos) :
+	m_Pos(pos)
 {
 	float x = pos.x;
 	float y = pos.y;
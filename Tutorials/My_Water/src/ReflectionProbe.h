@@ -13,6 +13,7 @@ namespace Diligent
 		~ReflectionProbe();
 
 		FirstPersonCamera *GetCameras();
+		const float3 &GetPos() const { return m_Pos; }
 
 	private:
 		float3 m_Pos;
@@ -1,142 +0,0 @@
-#include "RenderProfile.h"
-
-
-using hrc = std::chrono::high_resolution_clock;
-
-Diligent::CPUProfileScope::CPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor /*= Colors::orange*/)
-{
-	m_pProfilerTask = pRenderProfileMgr->GetCPUProfilerTask();
-	m_StartTime = pRenderProfileMgr->FrameTime;
-
-	m_pProfilerTask->startTime = GetCurrFrameTimeSeconds();
-	m_pProfilerTask->color = TextColor;
-	m_pProfilerTask->name = name;
-}
-
-Diligent::CPUProfileScope::~CPUProfileScope()
-{
-	m_pProfilerTask->endTime = GetCurrFrameTimeSeconds();	
-}
-
-double Diligent::CPUProfileScope::GetCurrFrameTimeSeconds()
-{	
-	return double(std::chrono::duration_cast<std::chrono::microseconds>(hrc::now() - m_StartTime).count()) / 1e6;
-}
-
-Diligent::GPUProfileScope::GPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor /*= Colors::orange*/)
-{
-	m_pRenderProfileMgr = pRenderProfileMgr;
-
-	m_pProfilerTask = pRenderProfileMgr->GetGPUProfilerTask();
-	m_pProfilerTask->name = name;
-	m_pProfilerTask->color = TextColor;
-	m_pProfilerTask->startTime = 0;
-
-	pRenderProfileMgr->GPUProfileTaskStart(name);
-}
-
-Diligent::GPUProfileScope::~GPUProfileScope()
-{
-	double DurationTime;
-	m_pRenderProfileMgr->GPUProfileTaskEnd(m_pProfilerTask->name, DurationTime);
-	m_pProfilerTask->endTime = DurationTime;
-}
-
-void Diligent::RenderProfileMgr::Initialize(IRenderDevice *pDevice, IDeviceContext *pImmediateContext)
-{
-	m_pIRenderDevice = pDevice;
-	m_pImmediateContext = pImmediateContext;
-
-	CleanProfileTask();	
-
-	/*{
-		QueryDesc queryDesc;
-		queryDesc.Name = "Pipeline statistics query";
-		queryDesc.Type = QUERY_TYPE_PIPELINE_STATISTICS;
-		m_pPipelineStatsQuery.reset(new ScopedQueryHelper{ pDevice, queryDesc, 2 });
-	}
-
-	{
-		QueryDesc queryDesc;
-		queryDesc.Name = "Occlusion query";
-		queryDesc.Type = QUERY_TYPE_OCCLUSION;
-		m_pOcclusionQuery.reset(new ScopedQueryHelper{ pDevice, queryDesc, 2 });
-	}
-
-	{
-		QueryDesc queryDesc;
-		queryDesc.Name = "Duration query";
-		queryDesc.Type = QUERY_TYPE_DURATION;
-		m_pDurationQuery.reset(new ScopedQueryHelper{ pDevice, queryDesc, 2 });
-	}*/
-
-	//m_pDurationFromTimestamps.reset(new DurationQueryHelper{ pDevice, 2 });
-}
-
-Diligent::RenderProfileMgr::RenderProfileMgr()
-{
-	m_CPUProfileTasks.resize(MAX_PROFILE_PARAM);
-	m_GPUProfileTasks.resize(MAX_PROFILE_PARAM);
-}
-
-Diligent::RenderProfileMgr::~RenderProfileMgr()
-{
-	
-}
-
-Diligent::ProfilerTask * Diligent::RenderProfileMgr::GetCPUProfilerTask()
-{
-	return &m_CPUProfileTasks[m_CurrCPUProfileTaskIndex++];
-}
-
-Diligent::ProfilerTask * Diligent::RenderProfileMgr::GetGPUProfilerTask()
-{
-	return &m_GPUProfileTasks[m_CurrGPUProfileTaskIndex++];
-}
-
-void Diligent::RenderProfileMgr::GPUProfileTaskStart(const std::string &name)
-{
-	if (m_QueryNameToHelper.find(name) == m_QueryNameToHelper.end())
-	{
-		m_QueryNameToHelper.insert(std::make_pair(name, new DurationQueryHelper(m_pIRenderDevice, 2)));
-	}
-
-	m_QueryNameToHelper[name]->Begin(m_pImmediateContext);
-}
-
-void Diligent::RenderProfileMgr::GPUProfileTaskEnd(const std::string &name, double &RefEndTime)
-{
-	m_QueryNameToHelper[name]->End(m_pImmediateContext, RefEndTime);
-}
-
-void Diligent::RenderProfileMgr::CleanProfileTask()
-{
-	m_CurrCPUProfileTaskIndex = 0;
-	m_CurrGPUProfileTaskIndex = 0;
-
-	FrameTime = hrc::now();
-}
-
-void Diligent::RenderProfileMgr::GetCPUProfileData(ProfilerTask** pData, int& size)
-{
-	*pData = &m_CPUProfileTasks[0];
-	size = m_CurrCPUProfileTaskIndex;
-}
-
-void Diligent::RenderProfileMgr::GetGPUProfileData(ProfilerTask** pData, int& size)
-{
-	*pData = &m_GPUProfileTasks[0];
-	size = m_CurrGPUProfileTaskIndex;
-}
-
-Diligent::CPUAndGPUProfileScope::CPUAndGPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor /*= Colors::orange*/) :
-	m_cpu(pRenderProfileMgr, name, TextColor),
-	m_gpu(pRenderProfileMgr, name, TextColor)
-{
-
-}
-
-Diligent::CPUAndGPUProfileScope::~CPUAndGPUProfileScope()
-{
-
-}
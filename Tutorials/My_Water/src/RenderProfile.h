@@ -1,100 +0,0 @@
-#ifndef _RENDER_PROFILE_H_
-#define _RENDER_PROFILE_H_
-
-#pragma once
-
-#include <chrono>
-#include <vector>
-#include <memory>
-#include <unordered_map>
-#include "ImGuiProfiler/ProfilerTask.h"
-#include "GraphicsTypes.h"
-#include "ScopedQueryHelper.hpp"
-#include "DurationQueryHelper.hpp"
-
-#define MAX_PROFILE_PARAM 256
-
-namespace Diligent
-{
-	struct IDeviceContext;
-	struct IRenderDevice;
-
-	class RenderProfileMgr;
-
-	class CPUProfileScope
-	{
-	public:
-		CPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor = Colors::orange);
-		~CPUProfileScope();
-	
-	protected:
-		double GetCurrFrameTimeSeconds();		
-
-	private:
-		std::chrono::high_resolution_clock::time_point m_StartTime;
-		ProfilerTask *m_pProfilerTask;
-	};
-
-	class GPUProfileScope
-	{
-	public:
-		GPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor = Colors::orange);
-		~GPUProfileScope();
-
-	private:
-		ProfilerTask *m_pProfilerTask;
-		RenderProfileMgr *m_pRenderProfileMgr;
-	};
-
-	class CPUAndGPUProfileScope
-	{
-	public:
-		CPUAndGPUProfileScope(RenderProfileMgr *pRenderProfileMgr, std::string name, uint32_t TextColor = Colors::orange);
-		~CPUAndGPUProfileScope();
-
-	private:
-		CPUProfileScope m_cpu;
-		GPUProfileScope m_gpu;
-	};
-
-	class RenderProfileMgr
-	{
-	public:
-		RenderProfileMgr();
-		void Initialize(IRenderDevice *pDevice, IDeviceContext *pImmediateContext);
-		~RenderProfileMgr();
-
-		ProfilerTask *GetCPUProfilerTask();
-		ProfilerTask *GetGPUProfilerTask();
-
-		void GPUProfileTaskStart(const std::string &name);
-		void GPUProfileTaskEnd(const std::string &name, double &RefEndTime);
-
-		void CleanProfileTask();
-
-		void GetCPUProfileData(ProfilerTask** pData, int& size);
-		void GetGPUProfileData(ProfilerTask** pData, int& size);
-
-	public:
-		std::chrono::high_resolution_clock::time_point FrameTime;
-
-	private:
-		/*std::unique_ptr<ScopedQueryHelper>   m_pPipelineStatsQuery;
-		std::unique_ptr<ScopedQueryHelper>   m_pOcclusionQuery;
-		std::unique_ptr<ScopedQueryHelper>   m_pDurationQuery;*/
-		//std::unique_ptr<DurationQueryHelper> m_pDurationFromTimestamps;
-
-		std::unordered_map<std::string, std::unique_ptr<DurationQueryHelper>> m_QueryNameToHelper;
-
-		IDeviceContext *m_pImmediateContext;
-		IRenderDevice *m_pIRenderDevice;
-
-		std::vector<ProfilerTask> m_CPUProfileTasks;
-		std::vector<ProfilerTask> m_GPUProfileTasks;
-		int m_CurrGPUProfileTaskIndex;
-		int m_CurrCPUProfileTaskIndex;
-	};
-}
-
-#endif
-
@@ -0,0 +1,296 @@
+#include "ScatteringLUTCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "GraphicsAccessories.hpp"
+
+void Diligent::ScatteringLUTKey::Add(const void *pData, const size_t Size)
+{
+	const uint8_t *pBytes = reinterpret_cast<const uint8_t*>(pData);
+	for (size_t i = 0; i < Size; ++i)
+	{
+		m_Hash ^= pBytes[i];
+		m_Hash *= 1099511628211ull;
+	}
+}
+
+void Diligent::ScatteringLUTKey::Add(const char *Str)
+{
+	//the terminator keeps "ab" "c" apart from "a" "bc"
+	Add(Str, Str ? strlen(Str) + 1 : 0);
+}
+
+void Diligent::ScatteringLUTKey::Add(const ShaderMacro *pMacros)
+{
+	for (; pMacros && pMacros->Name; ++pMacros)
+	{
+		Add(pMacros->Name);
+		Add(pMacros->Definition);
+	}
+}
+
+Diligent::ScatteringLUTCache::ScatteringLUTCache(const char *Directory) :
+	m_Directory(Directory ? Directory : ".")
+{
+	memset(&m_SaveHeader, 0, sizeof(m_SaveHeader));
+}
+
+Diligent::ScatteringLUTCache::~ScatteringLUTCache()
+{
+	if (m_Load.valid())
+	{
+		m_Load.wait();
+	}
+	WaitSave();
+}
+
+std::string Diligent::ScatteringLUTCache::GetFilePath(const uint64_t Key) const
+{
+	char FileName[64];
+	snprintf(FileName, sizeof(FileName), "scattering_%016llx.bin", static_cast<unsigned long long>(Key));
+	return m_Directory + "/" + FileName;
+}
+
+size_t Diligent::ScatteringLUTCache::GetTexelBytes(const TEXTURE_FORMAT Format)
+{
+	const TextureFormatAttribs &FmtAttribs = GetTextureFormatAttribs(Format);
+	return size_t(FmtAttribs.ComponentSize) * FmtAttribs.NumComponents;
+}
+
+size_t Diligent::ScatteringLUTCache::GetTableBytes(const TextureDesc &Desc)
+{
+	const size_t Depth = Desc.Type == RESOURCE_DIM_TEX_3D ? Desc.Depth : 1;
+	return GetTexelBytes(Desc.Format) * Desc.Width * Desc.Height * Depth;
+}
+
+void Diligent::ScatteringLUTCache::BeginLoad(const uint64_t Key, const RefCntAutoPtr<ITexture> *ppTextures)
+{
+	if (m_Load.valid())
+	{
+		m_Load.wait();
+	}
+
+	ScatteringLUTHeader Expected;
+	memset(&Expected, 0, sizeof(Expected));
+	Expected.Magic = SCATTERING_LUT_CACHE_MAGIC;
+	Expected.Version = SCATTERING_LUT_CACHE_VERSION;
+	Expected.Key = Key;
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		const TextureDesc &Desc = ppTextures[t]->GetDesc();
+		Expected.Width[t] = Desc.Width;
+		Expected.Height[t] = Desc.Height;
+		Expected.Depth[t] = Desc.Type == RESOURCE_DIM_TEX_3D ? Desc.Depth : 1;
+		Expected.Format[t] = Desc.Format;
+	}
+
+	m_Load = std::async(std::launch::async, ReadFile, GetFilePath(Key), Expected);
+}
+
+bool Diligent::ScatteringLUTCache::PollLoad(const bool bWait, std::unique_ptr<ScatteringLUTData> &apData)
+{
+	if (!m_Load.valid())
+	{
+		apData.reset();
+		return true;
+	}
+	if (!bWait && m_Load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	apData = m_Load.get();
+	return true;
+}
+
+std::unique_ptr<Diligent::ScatteringLUTData> Diligent::ScatteringLUTCache::ReadFile(const std::string FilePath, const ScatteringLUTHeader Expected)
+{
+	std::ifstream File(FilePath, std::ios::binary);
+	if (!File)
+	{
+		//not computed yet, no error
+		return nullptr;
+	}
+
+	ScatteringLUTHeader Header;
+	File.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+	if (!File || memcmp(&Header, &Expected, sizeof(Header)) != 0)
+	{
+		LOG_WARNING_MESSAGE(FilePath, " was written for other scattering tables, they are computed again");
+		return nullptr;
+	}
+
+	std::unique_ptr<ScatteringLUTData> apData(new ScatteringLUTData());
+	apData->Key = Header.Key;
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		const size_t Bytes = GetTexelBytes(static_cast<TEXTURE_FORMAT>(Header.Format[t])) * Header.Width[t] * Header.Height[t] * Header.Depth[t];
+		apData->Texels[t].resize(Bytes);
+		File.read(reinterpret_cast<char*>(apData->Texels[t].data()), Bytes);
+	}
+	if (!File)
+	{
+		LOG_WARNING_MESSAGE("The scattering table cache ", FilePath, " is truncated");
+		return nullptr;
+	}
+
+	LOG_INFO_MESSAGE("Scattering tables loaded from ", FilePath);
+	return apData;
+}
+
+void Diligent::ScatteringLUTCache::Upload(IDeviceContext *pContext, const ScatteringLUTData &Data, const RefCntAutoPtr<ITexture> *ppTextures)
+{
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		const TextureDesc &Desc = ppTextures[t]->GetDesc();
+		const uint32_t Depth = Desc.Type == RESOURCE_DIM_TEX_3D ? Desc.Depth : 1;
+		VERIFY_EXPR(Data.Texels[t].size() == GetTableBytes(Desc));
+
+		Box Region;
+		Region.MaxX = Desc.Width;
+		Region.MaxY = Desc.Height;
+		Region.MaxZ = Depth;
+
+		TextureSubResData SubResData;
+		SubResData.pData = Data.Texels[t].data();
+		SubResData.Stride = GetTexelBytes(Desc.Format) * Desc.Width;
+		SubResData.DepthStride = SubResData.Stride * Desc.Height;
+		pContext->UpdateTexture(ppTextures[t], 0, 0, Region, SubResData, \
+			RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	}
+}
+
+void Diligent::ScatteringLUTCache::BeginSave(IRenderDevice *pDevice, IDeviceContext *pContext, const uint64_t Key, const RefCntAutoPtr<ITexture> *ppTextures)
+{
+	if (!m_pSaveFence)
+	{
+		FenceDesc FDesc;
+		FDesc.Name = "scattering table readback";
+		pDevice->CreateFence(FDesc, &m_pSaveFence);
+	}
+
+	memset(&m_SaveHeader, 0, sizeof(m_SaveHeader));
+	m_SaveHeader.Magic = SCATTERING_LUT_CACHE_MAGIC;
+	m_SaveHeader.Version = SCATTERING_LUT_CACHE_VERSION;
+	m_SaveHeader.Key = Key;
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		TextureDesc StagingDesc = ppTextures[t]->GetDesc();
+		StagingDesc.Name = "Scattering table readback";
+		StagingDesc.Usage = USAGE_STAGING;
+		StagingDesc.BindFlags = BIND_NONE;
+		StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+		StagingDesc.MiscFlags = MISC_TEXTURE_FLAG_NONE;
+
+		m_SaveHeader.Width[t] = StagingDesc.Width;
+		m_SaveHeader.Height[t] = StagingDesc.Height;
+		m_SaveHeader.Depth[t] = StagingDesc.Type == RESOURCE_DIM_TEX_3D ? StagingDesc.Depth : 1;
+		m_SaveHeader.Format[t] = StagingDesc.Format;
+
+		//the staging textures of a dropped save are reused when their size still fits
+		if (!m_apStagingTexs[t] || GetTableBytes(m_apStagingTexs[t]->GetDesc()) != GetTableBytes(StagingDesc) || \
+			m_apStagingTexs[t]->GetDesc().Format != StagingDesc.Format)
+		{
+			m_apStagingTexs[t].Release();
+			pDevice->CreateTexture(StagingDesc, nullptr, &m_apStagingTexs[t]);
+		}
+
+		CopyTextureAttribs CopyAttribs(ppTextures[t], RESOURCE_STATE_TRANSITION_MODE_TRANSITION, m_apStagingTexs[t], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyTexture(CopyAttribs);
+	}
+
+	pContext->SignalFence(m_pSaveFence, ++m_SaveFenceValue);
+	m_bSavePending = true;
+}
+
+void Diligent::ScatteringLUTCache::Update(IDeviceContext *pContext)
+{
+	if (!m_bSavePending || m_pSaveFence->GetCompletedValue() < m_SaveFenceValue)
+	{
+		return;
+	}
+	m_bSavePending = false;
+
+	std::shared_ptr<ScatteringLUTData> apData(new ScatteringLUTData());
+	apData->Key = m_SaveHeader.Key;
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		const size_t RowBytes = GetTexelBytes(static_cast<TEXTURE_FORMAT>(m_SaveHeader.Format[t])) * m_SaveHeader.Width[t];
+		std::vector<uint8_t> &Dst = apData->Texels[t];
+		Dst.resize(RowBytes * m_SaveHeader.Height[t] * m_SaveHeader.Depth[t]);
+
+		MappedTextureSubresource MappedData;
+		pContext->MapTextureSubresource(m_apStagingTexs[t], 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+		if (!MappedData.pData)
+		{
+			LOG_ERROR_MESSAGE("Mapping the scattering table readback failed, the tables are not cached");
+			return;
+		}
+		for (uint32_t z = 0; z < m_SaveHeader.Depth[t]; ++z)
+		{
+			const uint8_t *pSlice = reinterpret_cast<const uint8_t*>(MappedData.pData) + size_t(z) * MappedData.DepthStride;
+			for (uint32_t y = 0; y < m_SaveHeader.Height[t]; ++y)
+			{
+				memcpy(&Dst[(size_t(z) * m_SaveHeader.Height[t] + y) * RowBytes], pSlice + size_t(y) * MappedData.Stride, RowBytes);
+			}
+		}
+		pContext->UnmapTextureSubresource(m_apStagingTexs[t], 0, 0);
+	}
+
+	//about 100 MB of staging memory, the next save creates them again
+	for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+	{
+		m_apStagingTexs[t].Release();
+	}
+
+	WaitSave();
+	m_Save = std::async(std::launch::async, WriteFile, GetFilePath(m_SaveHeader.Key), m_SaveHeader, apData);
+}
+
+void Diligent::ScatteringLUTCache::WriteFile(const std::string FilePath, const ScatteringLUTHeader Header, std::shared_ptr<const ScatteringLUTData> apData)
+{
+	//written under a temporary name, a load never sees half a file. Effects with the same
+	//tables may save at the same time, every save has its own name.
+	char TmpSuffix[32];
+	snprintf(TmpSuffix, sizeof(TmpSuffix), ".%p.tmp", static_cast<const void*>(apData.get()));
+	const std::string TmpPath = FilePath + TmpSuffix;
+	{
+		std::ofstream File(TmpPath, std::ios::binary | std::ios::trunc);
+		if (!File)
+		{
+			LOG_ERROR_MESSAGE("Can not write the scattering table cache ", TmpPath);
+			return;
+		}
+		File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		for (int t = 0; t < SCATTERING_LUT_NUM; ++t)
+		{
+			File.write(reinterpret_cast<const char*>(apData->Texels[t].data()), apData->Texels[t].size());
+		}
+		if (!File)
+		{
+			LOG_ERROR_MESSAGE("Writing the scattering table cache ", TmpPath, " failed");
+			File.close();
+			std::remove(TmpPath.c_str());
+			return;
+		}
+	}
+
+	std::remove(FilePath.c_str());
+	if (std::rename(TmpPath.c_str(), FilePath.c_str()) != 0)
+	{
+		LOG_ERROR_MESSAGE("Can not rename ", TmpPath, " to ", FilePath);
+		std::remove(TmpPath.c_str());
+		return;
+	}
+	LOG_INFO_MESSAGE("Scattering tables cached in ", FilePath);
+}
+
+void Diligent::ScatteringLUTCache::WaitSave()
+{
+	if (m_Save.valid())
+	{
+		m_Save.wait();
+	}
+}
@@ -0,0 +1,124 @@
+#ifndef _SCATTERING_LUT_CACHE_H_
+#define _SCATTERING_LUT_CACHE_H_
+
+#pragma once
+
+#include <future>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "DeviceContext.h"
+#include "Fence.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "Shader.h"
+
+#define SCATTERING_LUT_CACHE_MAGIC 0x31544C53u //"SLT1"
+#define SCATTERING_LUT_CACHE_VERSION 1
+
+namespace Diligent
+{
+	//precomputed tables of EpipolarLightScattering kept in a cache file
+	enum SCATTERING_LUT
+	{
+		SCATTERING_LUT_NET_DENSITY = 0, //occluded net density to the atmosphere top, 2D
+		SCATTERING_LUT_SINGLE,          //single scattering, 3D
+		SCATTERING_LUT_HIGH_ORDER,      //scattering of the orders above the first, 3D
+		SCATTERING_LUT_MULTIPLE,        //all orders combined, 3D
+		SCATTERING_LUT_NUM
+	};
+
+	//64 bit FNV-1a of everything the tables are computed from
+	class ScatteringLUTKey
+	{
+	public:
+		void Add(const void *pData, const size_t Size);
+		void Add(const char *Str);
+
+		//names and definitions up to the terminating null name
+		void Add(const ShaderMacro *pMacros);
+
+		template<typename T>
+		void AddValue(const T &Value) { Add(&Value, sizeof(Value)); }
+
+		uint64_t Get() const { return m_Hash; }
+
+	private:
+		uint64_t m_Hash = 14695981039346656037ull;
+	};
+
+	//File layout: the header, then the texels of the tables in SCATTERING_LUT order, every table
+	//packed row after row and slice after slice
+	struct ScatteringLUTHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Width[SCATTERING_LUT_NUM];
+		uint32_t Height[SCATTERING_LUT_NUM];
+		uint32_t Depth[SCATTERING_LUT_NUM];
+		uint32_t Format[SCATTERING_LUT_NUM];
+	};
+
+	struct ScatteringLUTData
+	{
+		uint64_t Key = 0;
+		std::vector<uint8_t> Texels[SCATTERING_LUT_NUM];
+	};
+
+	//Disk cache of the scattering tables, one file per key in the cache directory. Files are read
+	//and written on worker threads, the GPU side only uploads or copies the textures out.
+	class ScatteringLUTCache
+	{
+	public:
+		explicit ScatteringLUTCache(const char *Directory);
+		~ScatteringLUTCache();
+
+		std::string GetFilePath(const uint64_t Key) const;
+
+		//Reads the tables of Key, ppTextures give the sizes and formats they must have. A load
+		//still running is finished first.
+		void BeginLoad(const uint64_t Key, const RefCntAutoPtr<ITexture> *ppTextures);
+		bool IsLoading() const { return m_Load.valid(); }
+
+		//False while reading. Once done it returns true with the tables, or with a null
+		//apData when the file is missing or was written for other tables.
+		bool PollLoad(const bool bWait, std::unique_ptr<ScatteringLUTData> &apData);
+
+		static void Upload(IDeviceContext *pContext, const ScatteringLUTData &Data, const RefCntAutoPtr<ITexture> *ppTextures);
+
+		//Copies the textures to staging ones, they are written to the file of Key once the GPU
+		//has finished the copies. A save still waiting for the GPU is dropped.
+		void BeginSave(IRenderDevice *pDevice, IDeviceContext *pContext, const uint64_t Key, const RefCntAutoPtr<ITexture> *ppTextures);
+
+		//reads back a finished save, called once a frame
+		void Update(IDeviceContext *pContext);
+
+	protected:
+		static size_t GetTexelBytes(const TEXTURE_FORMAT Format);
+		static size_t GetTableBytes(const TextureDesc &Desc);
+
+		static std::unique_ptr<ScatteringLUTData> ReadFile(const std::string FilePath, const ScatteringLUTHeader Expected);
+		static void WriteFile(const std::string FilePath, const ScatteringLUTHeader Header, std::shared_ptr<const ScatteringLUTData> apData);
+
+		void WaitSave();
+
+	private:
+		std::string m_Directory;
+
+		std::future<std::unique_ptr<ScatteringLUTData>> m_Load;
+
+		//staging copies of a save in flight, done once the fence reaches m_SaveFenceValue
+		RefCntAutoPtr<IFence> m_pSaveFence;
+		uint64_t m_SaveFenceValue = 0;
+		bool m_bSavePending = false;
+		ScatteringLUTHeader m_SaveHeader;
+		RefCntAutoPtr<ITexture> m_apStagingTexs[SCATTERING_LUT_NUM];
+
+		std::future<void> m_Save;
+	};
+}
+
+#endif
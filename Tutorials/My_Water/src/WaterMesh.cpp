@@ -0,0 +1,454 @@
+#include "WaterMesh.h"
+#include "FirstPersonCamera.hpp"
+#include "MapHelper.hpp"
+#include "TerrainMap.h"
+
+#include "ShaderMacroHelper.hpp"
+#include "ShaderUniformDataMgr.h"
+#include "OceanWave.h"
+#include "OceanFlipbook.h"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+static void SetTextureVar(IShaderResourceBinding *pSRB, const SHADER_TYPE ShaderType, const char *Name, ITexture *pTexture)
+{
+	IShaderResourceVariable *pVar = pSRB->GetVariableByName(ShaderType, Name);
+	if (pVar)
+	{
+		pVar->Set(pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+	}
+}
+
+Diligent::WaterMesh::WaterMesh(const uint SizeM, const uint Level, const float ClipScale) :
+	m_sizem(SizeM),
+	m_level(Level),
+	m_clip_scale(ClipScale),
+	m_RenderDrawNum(0),
+	m_bFlipbook(false),
+	m_GeometryMode(WaterGeometryMode::ADAPTIVE),
+	mpCDLODTree(nullptr)
+{
+	
+}
+
+Diligent::WaterMesh::~WaterMesh()
+{
+	if (mpCDLODTree)
+	{
+		delete mpCDLODTree;
+		mpCDLODTree = nullptr;
+	}
+}
+
+void WaterMesh::InitClipMap(IRenderDevice *pDevice, ISwapChain *pSwapChain, ShaderUniformDataMgr *pShaderUniformDataMgr, const bool bFlipbook,
+	const WaterGeometryMode Mode)
+{	
+	m_bFlipbook = bFlipbook;
+	m_GeometryMode = Mode;
+
+	//only the raster size matters, it sets the node sizes of the tree
+	m_Heightmap.InitFlat(1024, 1024);
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ -5690.0f, 0.00f, -7090.0f });
+	TerrainDim.Size = float3({ 12000.0f, 1000.0f, 12000.0f });
+
+	CDLODTreeDesc TreeDesc;
+	if (Mode == WaterGeometryMode::LEGACY)
+	{
+		//waves move the surface below the water level as well
+		TreeDesc.BoundsPolicy = CDLODBoundsPolicy::FULL_RANGE;
+		TreeDesc.BoundsPaddingY = TerrainDim.SizeY;
+	}
+	else
+	{
+		//the flat map gives nodes at the water level, the waves pad them until SetWaveBounds
+		TreeDesc.BoundsPaddingY = TerrainDim.SizeY;
+		TreeDesc.BoundsPaddingXZ = TerrainDim.SizeY;
+		TreeDesc.MaxScreenSpaceError = WATER_MAX_SCREEN_SPACE_ERROR;
+		TreeDesc.PatchGridSize = m_sizem;
+	}
+	mpCDLODTree = new CDLODTree(m_Heightmap, TerrainDim, TreeDesc);
+	mpCDLODTree->Create();
+	mpCDLODTree->SetViewportHeight(pSwapChain->GetDesc().Height);
+
+	m_PatchBatch.Init(pDevice, m_sizem);
+	InitPSO(pDevice, pSwapChain, TerrainDim, pShaderUniformDataMgr);
+}
+
+void WaterMesh::SetOceanTextures(const WaterRenderData &WRenderData)
+{
+	ExportRenderParams OceanRenderShaderParams = WRenderData.pOceanWave->ExportParamsToShader();
+
+	//disp lods
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_texL0", OceanRenderShaderParams.OceanRenderTexs[0].pDisp);
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_texL1", OceanRenderShaderParams.OceanRenderTexs[1].pDisp);
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_texL2", OceanRenderShaderParams.OceanRenderTexs[2].pDisp);
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_prev_texL0", OceanRenderShaderParams.OceanRenderTexs[0].pPrevDisp);
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_prev_texL1", OceanRenderShaderParams.OceanRenderTexs[1].pPrevDisp);
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_displacement_prev_texL2", OceanRenderShaderParams.OceanRenderTexs[2].pPrevDisp);
+	//derivative texs
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_texL0", OceanRenderShaderParams.OceanRenderTexs[0].pDeriva);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_texL1", OceanRenderShaderParams.OceanRenderTexs[1].pDeriva);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_texL2", OceanRenderShaderParams.OceanRenderTexs[2].pDeriva);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_prev_texL0", OceanRenderShaderParams.OceanRenderTexs[0].pPrevDeriva);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_prev_texL1", OceanRenderShaderParams.OceanRenderTexs[1].pPrevDeriva);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_derivatives_prev_texL2", OceanRenderShaderParams.OceanRenderTexs[2].pPrevDeriva);
+	//turbulence texs
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_turbulence_texL0", OceanRenderShaderParams.OceanRenderTexs[0].pTurb);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_turbulence_texL1", OceanRenderShaderParams.OceanRenderTexs[1].pTurb);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_turbulence_texL2", OceanRenderShaderParams.OceanRenderTexs[2].pTurb);
+	//lighting tex
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_IrradianceCube", WRenderData.pDiffIrradianceMap);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_IBLSpecCube", WRenderData.pIBLSPecMap);
+}
+
+void WaterMesh::SetFlipbookTextures(const WaterRenderData &WRenderData)
+{
+	const OceanFlipbook *pFlipbook = WRenderData.pOceanFlipbook;
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_flipbook_disp_xz", pFlipbook->GetTexture(OCEAN_FLIPBOOK_LAYER_DISP_XZ));
+	SetTextureVar(m_pSRB, SHADER_TYPE_VERTEX, "g_flipbook_disp_y", pFlipbook->GetTexture(OCEAN_FLIPBOOK_LAYER_DISP_Y));
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_flipbook_deriv_xy", pFlipbook->GetTexture(OCEAN_FLIPBOOK_LAYER_DERIV_XY));
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_flipbook_deriv_zw", pFlipbook->GetTexture(OCEAN_FLIPBOOK_LAYER_DERIV_ZW));
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_flipbook_turbulence", pFlipbook->GetTexture(OCEAN_FLIPBOOK_LAYER_TURBULENCE));
+	//lighting tex
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_IrradianceCube", WRenderData.pDiffIrradianceMap);
+	SetTextureVar(m_pSRB, SHADER_TYPE_PIXEL, "g_IBLSpecCube", WRenderData.pIBLSPecMap);
+}
+
+void WaterMesh::Render(IDeviceContext* pContext, const float3& CamPos, const WaterRenderData &WRenderData)
+{
+	m_PatchBatch.Update(pContext, mpCDLODTree->GetSelectInfo());
+
+	m_RenderDrawNum = 0;
+	if (m_PatchBatch.GetInstanceNum() == 0)
+	{
+		return;
+	}
+
+	m_PatchBatch.BindBuffers(pContext);
+
+	// Set the pipeline state in the immediate context
+	pContext->SetPipelineState(m_pPSO);
+
+	// Set uniform, once for all patches
+	{
+		ExportRenderParams OceanRenderShaderParams;
+		if (m_bFlipbook)
+		{
+			//the frames are blended by FlipbookConstants
+			const OceanFlipbookHeader &Header = WRenderData.pOceanFlipbook->GetHeader();
+			for (int i = 0; i < OCEAN_CASCADE_NUM; ++i)
+			{
+				OceanRenderShaderParams.LengthScales[i] = Header.LengthScales[i];
+				OceanRenderShaderParams.OceanRenderTexs[i].Blend = 1.0f;
+			}
+		}
+		else
+		{
+			OceanRenderShaderParams = WRenderData.pOceanWave->ExportParamsToShader();
+		}
+
+		// Map the buffer and write current world-view-projection matrix
+		MapHelper<GPUConstBuffer> CBConstants(pContext, m_pVsConstBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+		CBConstants->ViewProj = m_TerrainViewProjMat;
+		CBConstants->CameraPos = CamPos;
+		CBConstants->L.x = WRenderData.L_RepeatScale_NormalIntensity_N.x;
+		CBConstants->L.y = WRenderData.L_RepeatScale_NormalIntensity_N.y;
+		CBConstants->g_BaseNormalIntensity = WRenderData.L_RepeatScale_NormalIntensity_N.z;
+		CBConstants->g_FFTN = WRenderData.L_RepeatScale_NormalIntensity_N.w;
+		CBConstants->LengthScale0 = OceanRenderShaderParams.LengthScales[0];
+		CBConstants->LengthScale1 = OceanRenderShaderParams.LengthScales[1];
+		CBConstants->LengthScale2 = OceanRenderShaderParams.LengthScales[2];
+		CBConstants->LOD_scale = 7.0f;
+		CBConstants->CascadeBlends = float4(OceanRenderShaderParams.OceanRenderTexs[0].Blend, OceanRenderShaderParams.OceanRenderTexs[1].Blend, OceanRenderShaderParams.OceanRenderTexs[2].Blend, 1.0f);
+	}
+	{
+		//Ocean render material params
+		MapHelper<OceanMaterialParams> OceanRMatParams(pContext, m_pPsOceanMatParamBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+		*OceanRMatParams = WRenderData.OceanRMatParams;
+	}
+
+	if (m_bFlipbook)
+	{
+		{
+			MapHelper<OceanFlipbookConstants> FlipbookConstants(pContext, m_pFlipbookConstBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+			*FlipbookConstants = WRenderData.pOceanFlipbook->GetConstants();
+		}
+		SetFlipbookTextures(WRenderData);
+	}
+	else
+	{
+		SetOceanTextures(WRenderData);
+	}
+
+	// Commit shader resources. RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode
+	// makes sure that resources are transitioned to required states.
+	pContext->CommitShaderResources(m_pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	m_RenderDrawNum = m_PatchBatch.Draw(pContext);
+}
+
+void WaterMesh::SetWaveBounds(const float3 &MaxDisplacement)
+{
+	if (m_GeometryMode == WaterGeometryMode::ADAPTIVE)
+	{
+		mpCDLODTree->SetBoundsPadding(MaxDisplacement.y, std::max(MaxDisplacement.x, MaxDisplacement.z));
+	}
+}
+
+void WaterMesh::SetViewportHeight(const uint Height)
+{
+	mpCDLODTree->SetViewportHeight(Height);
+}
+
+void WaterMesh::SetMaxScreenSpaceError(const float MaxError)
+{
+	if (m_GeometryMode == WaterGeometryMode::ADAPTIVE)
+	{
+		mpCDLODTree->SetMaxScreenSpaceError(MaxError);
+	}
+}
+
+void WaterMesh::Update(const FirstPersonCamera *pCam)
+{
+	m_TerrainViewProjMat = pCam->GetViewProjMatrix();
+
+	mpCDLODTree->SelectLOD(*pCam);
+}
+
+void WaterMesh::InitPSO(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension& dim, ShaderUniformDataMgr *pShaderUniformDataMgr)
+{	
+	// Pipeline state object encompasses configuration of all GPU stages
+
+	GraphicsPipelineStateCreateInfo PSOCreateInfo;
+
+	PipelineStateDesc& PSODesc = PSOCreateInfo.PSODesc;
+	PipelineResourceLayoutDesc& ResourceLayout = PSODesc.ResourceLayout;
+
+	// Pipeline state name is used by the engine to report issues.
+	// It is always a good idea to give objects descriptive names.
+	PSOCreateInfo.PSODesc.Name = m_bFlipbook ? "Water Mesh flipbook PSO" : "Water Mesh PSO";
+
+	// This is a graphics pipeline
+	PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+	// clang-format off
+	// This tutorial will render to a single render target
+	PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
+	// Set render target format which is the format of the swap chain's color buffer
+	PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = TEX_FORMAT_R11G11B10_FLOAT;//pSwapChain->GetDesc().ColorBufferFormat;
+	// Use the depth buffer format from the swap chain
+	PSOCreateInfo.GraphicsPipeline.DSVFormat = TEX_FORMAT_D32_FLOAT;// pSwapChain->GetDesc().DepthBufferFormat;
+	// Primitive topology defines what kind of primitives will be rendered by this pipeline state
+	PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// Wireframe
+	//PSOCreateInfo.GraphicsPipeline.RasterizerDesc.FillMode = FILL_MODE_WIREFRAME;
+	PSOCreateInfo.GraphicsPipeline.RasterizerDesc.FillMode = FILL_MODE_SOLID;
+
+	// No back face culling for this tutorial
+	PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_BACK;
+	// depth testing
+	PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = true;
+
+	// Define vertex shader input layout, the patch grid and the per instance data
+	// clang-format on
+	PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = CDLODPatchBatch::GetLayoutElements(PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements);
+
+	// clang-format on
+
+	ShaderCreateInfo ShaderCI;
+	RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+	pDevice->GetEngineFactory()->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+	ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+	// Tell the system that the shader source code is in HLSL.
+	// For OpenGL, the engine will convert this into GLSL under the hood.
+	ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+	// OpenGL backend requires emulated combined HLSL texture samplers (g_Texture + g_Texture_sampler combination)
+	ShaderCI.UseCombinedTextureSamplers = true;
+
+	ShaderMacroHelper Macros;
+	Macros.AddShaderMacro("OCEAN_FLIPBOOK", m_bFlipbook);
+	ShaderCI.Macros = Macros;
+
+	// Create a vertex shader
+	RefCntAutoPtr<IShader> pVS;
+	{
+		ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+		ShaderCI.EntryPoint = "main";
+		ShaderCI.Desc.Name = "ClipMap Terrain vertex shader";
+		//ShaderCI.Source          = VSSource;
+		ShaderCI.FilePath = "assets/clipmap.vsh";
+		pDevice->CreateShader(ShaderCI, &pVS);
+
+		//Create dynamic const buffer		
+		BufferDesc CBDesc;
+		CBDesc.Name = "ClipMap VS Constants CB";
+		CBDesc.uiSizeInBytes = sizeof(GPUConstBuffer);
+		CBDesc.Usage = USAGE_DYNAMIC;
+		CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+		pDevice->CreateBuffer(CBDesc, nullptr, &m_pVsConstBuf);
+
+		struct GPUDIM
+		{
+			float4 Min;
+			float4 Size;
+		};
+		GPUDIM gdim;
+		gdim.Min = dim.Min;
+		gdim.Size = dim.Size;
+
+		BufferDesc TerrainDesc;
+		TerrainDesc.Name = "ClipMap VS Terrain info CB";
+		TerrainDesc.uiSizeInBytes = sizeof(GPUDIM);
+		TerrainDesc.Usage = USAGE_IMMUTABLE;
+		TerrainDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		BufferData TerrainInitData;
+		TerrainInitData.pData = &gdim;
+		TerrainInitData.DataSize = TerrainDesc.uiSizeInBytes;
+		pDevice->CreateBuffer(TerrainDesc, &TerrainInitData, &m_pVSTerrainInfoBuf);
+	}
+
+	// Create a pixel shader
+	RefCntAutoPtr<IShader> pPS;
+	{
+		ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+		ShaderCI.EntryPoint = "main";
+		ShaderCI.Desc.Name = "ClipMap Terrain pixel shader";
+		//ShaderCI.Source          = PSSource;
+		ShaderCI.FilePath = "assets/clipmap.psh";
+		pDevice->CreateShader(ShaderCI, &pPS);
+
+		BufferDesc OceanMatParamsDesc;
+		OceanMatParamsDesc.Name = "Ocean material params CB";
+		OceanMatParamsDesc.uiSizeInBytes = sizeof(OceanMaterialParams);
+		OceanMatParamsDesc.Usage = USAGE_DYNAMIC;
+		OceanMatParamsDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		OceanMatParamsDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+		pDevice->CreateBuffer(OceanMatParamsDesc, nullptr, &m_pPsOceanMatParamBuf);
+
+		if (m_bFlipbook)
+		{
+			BufferDesc FlipbookDesc;
+			FlipbookDesc.Name = "Ocean flipbook CB";
+			FlipbookDesc.uiSizeInBytes = sizeof(OceanFlipbookConstants);
+			FlipbookDesc.Usage = USAGE_DYNAMIC;
+			FlipbookDesc.BindFlags = BIND_UNIFORM_BUFFER;
+			FlipbookDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+			pDevice->CreateBuffer(FlipbookDesc, nullptr, &m_pFlipbookConstBuf);
+		}
+	}
+
+	// Shader variables should typically be mutable, which means they are expected
+	// to change on a per-instance basis
+	// clang-format off
+	ShaderResourceVariableDesc Vars[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_displacement_texL0", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_displacement_texL1", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_displacement_texL2", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL0", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL1", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL2", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL0", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL1", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL2", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL0", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL1", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL2", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL0", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL1", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL2", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_IrradianceCube", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_IBLSpecCube", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+	};
+	ShaderResourceVariableDesc FlipbookVars[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_flipbook_disp_xz", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_flipbook_disp_y", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_flipbook_deriv_xy", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_flipbook_deriv_zw", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_flipbook_turbulence", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_IrradianceCube", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_IBLSpecCube", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+	};
+	// clang-format on
+	ResourceLayout.Variables = m_bFlipbook ? FlipbookVars : Vars;
+	ResourceLayout.NumVariables = m_bFlipbook ? _countof(FlipbookVars) : _countof(Vars);
+
+	// Define immutable sampler for g_Texture. Immutable samplers should be used whenever possible
+	// clang-format off
+	SamplerDesc SamLinearWrapDesc
+	{
+		FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+		TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP
+	};
+	SamplerDesc SamAnisoWrapDesc
+	{
+		FILTER_TYPE_ANISOTROPIC, FILTER_TYPE_ANISOTROPIC, FILTER_TYPE_ANISOTROPIC,
+		TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP
+	};
+	ImmutableSamplerDesc ImtblSamplers[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_displacement_texL0", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_displacement_texL1", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_displacement_texL2", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL0", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL1", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_displacement_prev_texL2", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL0", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL1", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_texL2", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL0", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL1", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_derivatives_prev_texL2", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL0", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL1", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_turbulence_texL2", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_IrradianceCube", SamLinearWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_IBLSpecCube", SamLinearWrapDesc}
+	};
+	ImmutableSamplerDesc FlipbookImtblSamplers[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_flipbook_disp_xz", SamAnisoWrapDesc},
+		{SHADER_TYPE_VERTEX, "g_flipbook_disp_y", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_flipbook_deriv_xy", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_flipbook_deriv_zw", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_flipbook_turbulence", SamAnisoWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_IrradianceCube", SamLinearWrapDesc},
+		{SHADER_TYPE_PIXEL, "g_IBLSpecCube", SamLinearWrapDesc}
+	};
+	// clang-format on
+	ResourceLayout.ImmutableSamplers = m_bFlipbook ? FlipbookImtblSamplers : ImtblSamplers;
+	ResourceLayout.NumImmutableSamplers = m_bFlipbook ? _countof(FlipbookImtblSamplers) : _countof(ImtblSamplers);
+
+	// Finally, create the pipeline state
+	PSOCreateInfo.pVS = pVS;
+	PSOCreateInfo.pPS = pPS;
+	pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
+
+	// Since we did not explcitly specify the type for 'Constants' variable, default
+	// type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
+	// change and are bound directly through the pipeline state object.
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_pVsConstBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "TerrainDimension")->Set(m_pVSTerrainInfoBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "OceanMaterialParams")->Set(m_pPsOceanMatParamBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "Constants")->Set(m_pVsConstBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbLightStructure")->Set(pShaderUniformDataMgr->GetLightStructure());
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "OceanMaterialParams")->Set(m_pPsOceanMatParamBuf);
+	if (m_bFlipbook)
+	{
+		m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "FlipbookConstants")->Set(m_pFlipbookConstBuf);
+		m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "FlipbookConstants")->Set(m_pFlipbookConstBuf);
+	}
+
+	// Create a shader resource binding object and bind all static resources in it
+	m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
+
+}
+
+}
@@ -0,0 +1,140 @@
+#ifndef _WATER_MESH_H_
+#define _WATER_MESH_H_
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Buffer.h"
+#include "BasicMath.hpp"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+
+#include "CDLODPatchBatch.h"
+#include "CDLODTree.h"
+
+#include "ShaderUniformDataMgr.h"
+
+//finer than the terrain patches, the waves are displaced per vertex
+#define WATER_MESH_GRID_SIZE 64
+
+//default pixels a patch grid cell may cover before a finer lod is selected
+#define WATER_MAX_SCREEN_SPACE_ERROR 6.0f
+
+namespace Diligent
+{
+	class FirstPersonCamera;
+	class ShaderUniformDataMgr;
+	class OceanWave;
+	class OceanFlipbook;
+
+	struct GPUConstBuffer
+	{
+		float4x4 ViewProj;
+		float4 CameraPos;
+
+		float2 L;
+		float g_BaseNormalIntensity;
+		float g_FFTN;
+
+		float LengthScale0;
+		float LengthScale1;
+		float LengthScale2;
+		float LOD_scale;
+
+		float4 CascadeBlends;
+	};
+
+	//how the water patches are selected
+	enum class WaterGeometryMode
+	{
+		ADAPTIVE, //node bounds from the wave amplitude, lod ranges from the screen space error
+		LEGACY    //every node spans the whole water height, lod ranges split the view distance
+	};
+
+	struct WaterRenderData
+	{
+		float4 L_RepeatScale_NormalIntensity_N;
+		/*ITexture *pHeightMap;
+		ITexture *pFoamMaskMap;
+		ITexture *pFoamDiffuseMap;
+		ITexture *pDetailNormalMap;*/
+
+		OceanMaterialParams OceanRMatParams;
+
+		ITexture *pDiffIrradianceMap;
+		ITexture *pIBLSPecMap;
+
+		OceanWave *pOceanWave;
+
+		//the baked waves of a WaterMesh initialized for flipbook playback, pOceanWave is not used then
+		const OceanFlipbook *pOceanFlipbook;
+	};
+
+	//Ocean surface on the shared CDLOD tree, the patches are drawn instanced and the waves are displaced
+	//in the vertex shader. There is no heightmap, the nodes are flat at the water level and their bounds
+	//grow by the largest displacement of the waves, see SetWaveBounds.
+	class WaterMesh
+	{
+	public:
+		WaterMesh(const uint SizeM, const uint Level, const float ClipScale);
+		~WaterMesh();
+
+		//bFlipbook - the waves come from an OceanFlipbook instead of the simulation
+		void InitClipMap(IRenderDevice *pDevice, ISwapChain *pSwapChain, ShaderUniformDataMgr *pShaderUniformDataMgr, const bool bFlipbook = false,
+			const WaterGeometryMode Mode = WaterGeometryMode::ADAPTIVE);
+		void Render(IDeviceContext* pContext, const float3& CamPos, const WaterRenderData &WRenderData);
+
+		void Update(const FirstPersonCamera *pCam);
+
+		//largest x, y and z displacement of the waves, the next Update culls with it
+		void SetWaveBounds(const float3 &MaxDisplacement);
+		void SetViewportHeight(const uint Height);
+		void SetMaxScreenSpaceError(const float MaxError);
+
+		WaterGeometryMode GetGeometryMode() const { return m_GeometryMode; }
+		float GetMaxScreenSpaceError() const { return mpCDLODTree->GetDesc().MaxScreenSpaceError; }
+
+		uint GetRenderDrawNum() const { return m_RenderDrawNum; }
+		uint GetRenderPatchNum() const { return m_PatchBatch.GetPatchNum(); }
+		uint GetRenderTriangleNum() const { return m_PatchBatch.GetTriangleNum(); }
+
+		//min x/z is the origin of the wave cascade tiles, min y the water level
+		const Dimension &GetDimension() const { return mpCDLODTree->GetTerrainDimension(); }
+
+	protected:
+		void InitPSO(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension& dim, ShaderUniformDataMgr *pShaderUniformDataMgr);
+
+		void SetOceanTextures(const WaterRenderData &WRenderData);
+		void SetFlipbookTextures(const WaterRenderData &WRenderData);
+
+	private:
+		uint m_sizem;
+		uint m_level;
+		float m_clip_scale;
+
+		CDLODPatchBatch m_PatchBatch;
+
+		RefCntAutoPtr<IBuffer> m_pVsConstBuf;
+		RefCntAutoPtr<IBuffer> m_pVSTerrainInfoBuf;
+		RefCntAutoPtr<IBuffer> m_pPsOceanMatParamBuf;
+		RefCntAutoPtr<IBuffer> m_pFlipbookConstBuf;
+		RefCntAutoPtr<IShaderResourceBinding> m_pSRB;
+
+		RefCntAutoPtr<IPipelineState> m_pPSO;
+
+		float4x4 m_TerrainViewProjMat;
+
+		uint m_RenderDrawNum;
+		bool m_bFlipbook;
+		WaterGeometryMode m_GeometryMode;
+
+		TerrainMap m_Heightmap;
+
+		//------------------CDLOD
+		CDLODTree *mpCDLODTree;
+	};
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef _CDLOD_BENCHMARK_H_
+#define _CDLOD_BENCHMARK_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Diligent
+{
+	struct IRenderDevice;
+	struct IDeviceContext;
+
+	struct SelectLODBenchmarkDesc
+	{
+		uint32_t RasterSize = 16384; //square synthetic heightmap
+		float TexelWorldSize = 1.0f;
+		float TerrainHeight = 3000.0f;
+		uint32_t FrameNum = 1024;
+
+		float NearPlane = 0.1f;
+		float FarPlane = 100000.0f;
+
+		//non empty - the heightmap is written to this tiled file and streamed around the camera
+		std::string StreamedFileName;
+		float StreamingFullDetailRadius = 1024.0f;
+	};
+
+	//Builds a CDLOD tree over a generated heightmap and times CDLODTree::SelectLOD
+	//along a scripted camera path (a low orbit, a high orbit and a dive). Results are logged.
+	void RunSelectLODBenchmark(const SelectLODBenchmarkDesc &Desc);
+
+	struct VirtualTexturePagingSimDesc
+	{
+		uint32_t RasterSize = 16384;
+		float TexelWorldSize = 1.0f;
+		float TerrainHeight = 3000.0f;
+		uint32_t FrameNum = 1024;
+
+		float NearPlane = 0.1f;
+		float FarPlane = 100000.0f;
+
+		uint32_t PageSize = 128;
+		uint32_t SlotNum = 16; //per atlas axis, small enough to force evictions
+		uint32_t UploadBudget = 8;
+	};
+
+	//CPU only run of the height virtual texture along the benchmark camera path: pages of the
+	//selection are requested from a VirtualTextureCache with a dummy loader, no GPU resources.
+	//Requests, misses, fallbacks, uploads and evictions are logged.
+	void RunVirtualTexturePagingSim(const VirtualTexturePagingSimDesc &Desc);
+
+	struct GPUSelectionValidationDesc
+	{
+		uint32_t RasterSize = 4096;
+		float TexelWorldSize = 1.0f;
+		float TerrainHeight = 3000.0f;
+		uint32_t FrameNum = 256;
+
+		float NearPlane = 0.1f;
+		float FarPlane = 100000.0f;
+
+		//set - the kernels also run on this device and their output is read back every frame
+		IRenderDevice *pDevice = nullptr;
+		IDeviceContext *pContext = nullptr;
+	};
+
+	//Compares the CPU emulation of the GPU selection kernels (CDLODGPUSelection::EmulateSelection)
+	//with CDLODTree::SelectLOD along the benchmark camera path. Selected nodes, their lod levels and
+	//quadrant flags have to be identical, mismatches are logged. With a device the node list, the
+	//draw arguments and the instances written by cdlod_select.csh are read back and compared with
+	//SelectLOD and CDLODPatchBatch::Update too. Returns true if all frames match.
+	bool RunGPUSelectionValidation(const GPUSelectionValidationDesc &Desc);
+
+	struct HorizonCullingBenchmarkDesc
+	{
+		uint32_t RasterSize = 8192;
+		float TexelWorldSize = 1.0f;
+		float TerrainHeight = 3000.0f;
+		uint32_t FrameNum = 512;
+
+		float NearPlane = 0.1f;
+		float FarPlane = 100000.0f;
+
+		//eye height above the ground on the walk path
+		float WalkEyeHeight = 2.0f;
+
+		//every n-th frame the nodes removed by the horizon are checked with rays, 0 - never
+		uint32_t RayCheckFrameStep = 8;
+		uint32_t RayCheckSampleNum = 4; //surface points per node axis
+	};
+
+	//Selects every frame with and without horizon culling, on the benchmark camera path and on a
+	//walk close to the ground. Selected nodes, patch triangles and selection times are logged.
+	//Rays are marched from the camera to surface points of the culled nodes, points in the view that
+	//no terrain hides are logged as wrongly culled.
+	void RunHorizonCullingBenchmark(const HorizonCullingBenchmarkDesc &Desc);
+
+	struct VertexCacheBenchmarkDesc
+	{
+		//patch grid sizes, LOD_MESH_GRID_SIZE and larger grids for reference
+		std::vector<uint32_t> GridSizes = { 8, 16, 32, 64 };
+
+		//simulated post-transform cache entries, FIFO and LRU are run for each
+		std::vector<uint32_t> CacheSizes = { 16, 32 };
+	};
+
+	//CPU only comparison of the CDLOD patch index orders (rows, Forsyth, Tipsify) in a simulated
+	//post-transform vertex cache. ACMR and ATVR of the full patch draw and of a single quadrant
+	//draw are logged with the optimization times.
+	void RunVertexCacheBenchmark(const VertexCacheBenchmarkDesc &Desc);
+
+	struct TerrainQueryBenchmarkDesc
+	{
+		uint32_t RasterSize = 4096;
+		float TexelWorldSize = 1.0f;
+		float TerrainHeight = 3000.0f;
+
+		uint32_t QueryNum = 1 << 20; //random positions, batched and one by one
+		uint32_t RayNum = 16384;
+		uint32_t ThreadNum = 4; //query threads running next to the selection
+		uint32_t FrameNum = 256; //selections done meanwhile
+	};
+
+	//Times TerrainQuery heights, normals and raycasts, the batched heights are checked against single
+	//queries and the raycasts against a dense march. The threaded run queries while the main thread
+	//keeps selecting LODs on the benchmark camera path, as gameplay would next to the renderer.
+	void RunTerrainQueryBenchmark(const TerrainQueryBenchmarkDesc &Desc);
+}
+
+#endif
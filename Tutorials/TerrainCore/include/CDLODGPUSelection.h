@@ -0,0 +1,144 @@
+#ifndef _CDLOD_GPU_SELECTION_H_
+#define _CDLOD_GPU_SELECTION_H_
+
+#pragma once
+
+#include <vector>
+#include "Buffer.h"
+#include "BasicMath.hpp"
+#include "DeviceContext.h"
+#include "PipelineState.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "ShaderResourceBinding.h"
+
+#include "CDLODPatchBatch.h"
+#include "CDLODTree.h"
+
+#define CDLOD_SELECT_GROUP_SIZE 64
+//instances per draw bucket, more are dropped
+#define CDLOD_SELECT_MAX_BUCKET_INSTANCES 16384
+#define CDLOD_SELECT_READBACK_LATENCY 3
+
+namespace Diligent
+{
+	//matches CDLODSelectConstants in cdlod_select.csh
+	struct CDLODSelectShaderConstants
+	{
+		float4 FrustumPlanes[6]; //left, right, bottom, top, near, far
+		float4 CamPos;
+		float4 TerrainMin; //w: world height of one normalized height unit
+		float4 SelectInfo; //x: bounds padding y, y: patch grid size
+		uint4 BucketInfo; //x: instances per bucket, y: capacity of the selected node list
+		uint4 LevelNodes[LOD_COUNT]; //x: node num x, y: node num y, z: first node
+		float4 LevelInfo[LOD_COUNT]; //x: node world size x, y: node world size z, z: lod range
+		float4 MorphK[LOD_COUNT]; //by shader lod level, xy: GetMorphFromLevel
+	};
+
+	//One Select/Resolve step of the kernels in cdlod_select.csh, also used by the CPU emulation
+	enum CDLODSelectPass
+	{
+		CDLOD_SELECT_PASS_SEED = 0,
+		CDLOD_SELECT_PASS_PREPARE_ARGS,
+		CDLOD_SELECT_PASS_SELECT_LEVEL,
+		CDLOD_SELECT_PASS_RESOLVE_LEVEL,
+		CDLOD_SELECT_PASS_FINISH,
+
+		CDLOD_SELECT_PASS_NUM
+	};
+
+	//Everything the kernels wrote for one frame, see CDLODGPUSelection::ReadBackSync
+	struct CDLODGPUSelectionResult
+	{
+		//decoded from the selected node list, without the quadrant flags
+		std::vector<SelectNodeData> Nodes;
+		uint32_t SelectedNum = 0; //count of the list
+
+		//PATCH_DRAW_BUCKET_NUM sets of DrawIndexedIndirect arguments
+		uint32_t DrawArgs[5 * PATCH_DRAW_BUCKET_NUM] = {};
+		//the instances counted in DrawArgs, per bucket
+		std::vector<PerPatchShaderData> Instances[PATCH_DRAW_BUCKET_NUM];
+	};
+
+	//CDLOD selection in compute shaders. The flattened tree stays on the GPU, the nodes are visited
+	//level by level from append lists, top-down for the frustum and LOD range tests and bottom-up to
+	//decide which quadrants a parent still covers. The result is written straight into the per
+	//bucket patch instances and the indirect draw arguments of CDLODPatchBatch.
+	class CDLODGPUSelection
+	{
+	public:
+		CDLODGPUSelection();
+
+		void Init(IRenderDevice *pDevice, const CDLODTree &Tree, const CDLODPatchBatch &PatchBatch);
+
+		//Tree selection params have to be up to date, see CDLODTree::UpdateSelectionParams
+		void Select(IDeviceContext *pContext, const CDLODTree &Tree);
+
+		//Queues the selected nodes of this frame and decodes the oldest copy into OutInfo.
+		//Returns false while no copy is ready, OutInfo is left untouched then.
+		bool ReadBack(IDeviceContext *pContext, const CDLODTree &Tree, SelectionInfo &OutInfo);
+
+		//Copies the node list, the draw arguments and the instances of the last Select and waits for
+		//them. Stalls the GPU, for validation only.
+		void ReadBackSync(IDeviceContext *pContext, const CDLODTree &Tree, CDLODGPUSelectionResult &OutResult);
+
+		IBuffer *GetInstanceBuffer() const { return mpInstanceBuf; }
+		IBuffer *GetDrawArgsBuffer() const { return mpDrawArgsBuf; }
+
+		static void FillShaderConstants(const CDLODTree &Tree, const uint GridSize, CDLODSelectShaderConstants &Constants);
+
+		//Runs the kernels on the CPU pass by pass, same order and arithmetic as the shaders.
+		//Nodes come out per pass instead of in the depth first order of CDLODTree::SelectLOD.
+		static void EmulateSelection(const CDLODTree &Tree, const CDLODSelectShaderConstants &Constants, std::vector<SelectNodeData> &OutNodes);
+
+	protected:
+		void CreatePSO(IRenderDevice *pDevice);
+		void CreateBuffers(IRenderDevice *pDevice, const CDLODTree &Tree, const CDLODPatchBatch &PatchBatch);
+
+		void Dispatch(IDeviceContext *pContext, const CDLODSelectPass Pass, const uint Level, const uint Slot, const uint GroupNum);
+		void DispatchIndirect(IDeviceContext *pContext, const CDLODSelectPass Pass, const uint Level, const uint Slot);
+
+	private:
+		uint32_t mNodeNum;
+		uint32_t mTopNodeNum;
+		uint32_t mGridSize;
+		uint64_t mFrame;
+
+		RefCntAutoPtr<IPipelineState> mpPSO[CDLOD_SELECT_PASS_NUM];
+		RefCntAutoPtr<IShaderResourceBinding> mpSRB[CDLOD_SELECT_PASS_NUM];
+
+		RefCntAutoPtr<IBuffer> mpConstantsBuf;
+		RefCntAutoPtr<IBuffer> mpPassBuf;
+
+		//packed min | max << 16 normalized heights of every node, flat tree order
+		RefCntAutoPtr<IBuffer> mpNodeBoundsBuf;
+		RefCntAutoPtr<IBuffer> mpNodeStateBuf;
+
+		//per level regions at CDLODLevel::FirstNode
+		RefCntAutoPtr<IBuffer> mpVisitListBuf;
+		RefCntAutoPtr<IBuffer> mpPendingListBuf;
+
+		//slot 2 * level: visited nodes, slot 2 * level + 1: pending parents
+		RefCntAutoPtr<IBuffer> mpCounterBuf;
+		RefCntAutoPtr<IBuffer> mpDispatchArgsBuf;
+
+		RefCntAutoPtr<IBuffer> mpInstanceBuf;
+		RefCntAutoPtr<IBuffer> mpDrawArgsBuf;
+
+		//[0]: count, then level << 28 | y << 14 | x of every selected node
+		RefCntAutoPtr<IBuffer> mpSelectedNodesBuf;
+		RefCntAutoPtr<IBuffer> mpReadbackBuf[CDLOD_SELECT_READBACK_LATENCY];
+
+		//staging copies of ReadBackSync, created on its first call
+		RefCntAutoPtr<IRenderDevice> mpDevice;
+		RefCntAutoPtr<IBuffer> mpSyncNodesBuf;
+		RefCntAutoPtr<IBuffer> mpSyncDrawArgsBuf;
+		RefCntAutoPtr<IBuffer> mpSyncInstanceBuf;
+
+		//reset values uploaded every frame
+		std::vector<uint32_t> mDrawArgsInit;
+		std::vector<uint32_t> mCounterInit;
+	};
+}
+
+#endif
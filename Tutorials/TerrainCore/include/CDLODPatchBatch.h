@@ -0,0 +1,113 @@
+#ifndef _CDLOD_PATCH_BATCH_H_
+#define _CDLOD_PATCH_BATCH_H_
+
+#pragma once
+
+#include <vector>
+#include "Buffer.h"
+#include "BasicMath.hpp"
+#include "DeviceContext.h"
+#include "InputLayout.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+
+#include "CDLODTree.h"
+
+namespace Diligent
+{
+	struct ClipMapTerrainVerticesData
+	{
+		float2 XZ;
+	};
+
+	//per instance vertex data of a selected patch
+	struct PerPatchShaderData
+	{
+		float4 Scale; //xy: world size of a grid cell, z: shader lod level
+		float4 Offset;
+		float4 MorphKInfo; //[0]:end/dis, [1] 1/dis
+	};
+
+	//instances are grouped by the part of the patch mesh they draw
+	enum PatchDrawBucket
+	{
+		PATCH_DRAW_FULL = 0,
+		PATCH_DRAW_TL,
+		PATCH_DRAW_TR,
+		PATCH_DRAW_BL,
+		PATCH_DRAW_BR,
+
+		PATCH_DRAW_BUCKET_NUM
+	};
+
+	//Shared render path of the CDLOD samples. One GridSize x GridSize patch mesh is drawn for every
+	//selected node with instancing, one draw per non-empty bucket. Shaders read the grid position
+	//from attribute 0 and PerPatchShaderData from attributes 1-3.
+	class CDLODPatchBatch
+	{
+	public:
+		CDLODPatchBatch();
+
+		void Init(IRenderDevice *pDevice, const uint GridSize);
+
+		//rebuilds the instances from the selection, morph constants included
+		void Update(IDeviceContext *pContext, const SelectionInfo &SelectInfo);
+
+		//binds the patch mesh and the instances, the pipeline and its resources are set by the caller
+		void BindBuffers(IDeviceContext *pContext);
+
+		//returns the number of draw calls
+		uint Draw(IDeviceContext *pContext);
+
+		//Instances and draw arguments written on the GPU, one DrawIndexedIndirect per bucket.
+		//pDrawArgsBuffer holds PATCH_DRAW_BUCKET_NUM argument sets in bucket order.
+		uint DrawIndirect(IDeviceContext *pContext, IBuffer *pInstanceBuffer, IBuffer *pDrawArgsBuffer);
+
+		void GetBucketIndexRange(const int Bucket, uint &FirstIndex, uint &IndexNum) const;
+
+		static const LayoutElement *GetLayoutElements(Uint32 &NumElements);
+
+		//Indices of the patch mesh, quadrants TL, TR, BL, BR one after another, QuadrantEnd gets the
+		//end of the first three. With Optimize the triangles of every quadrant are reordered for the
+		//post-transform cache and the grid vertices (y * (GridSize + 1) + x) for fetch locality,
+		//VertexRemap then holds the new location of every vertex, otherwise it is left empty.
+		static void BuildPatchIndices(const uint GridSize, const bool Optimize, std::vector<uint32_t> &Indices, uint QuadrantEnd[3], std::vector<uint32_t> &VertexRemap);
+
+		uint GetGridSize() const { return m_GridSize; }
+		uint GetInstanceNum() const { return (uint)m_InstanceData.size(); }
+		uint GetPatchNum() const { return m_PatchNum; }
+		const std::vector<PerPatchShaderData> &GetBucketInstances(const int Bucket) const { return m_Buckets[Bucket]; }
+
+		//triangles of the instances of the last Update
+		uint GetTriangleNum() const { return m_TriangleNum; }
+
+	protected:
+		void InitVertexBuffer(IRenderDevice *pDevice, const std::vector<uint32_t> &VertexRemap);
+		void InitIndicesBuffer(IRenderDevice *pDevice, const std::vector<uint32_t> &Indices);
+
+		DrawIndexedAttribs GetDrawIndex(const uint start, const uint num, const uint FirstInstance, const uint InstanceNum) const;
+
+	private:
+		uint m_GridSize;
+		uint m_IndexNum;
+
+		//end of the quadrant index ranges, the quadrants are stored TL, TR, BL, BR
+		uint m_IndexEndTL;
+		uint m_IndexEndTR;
+		uint m_IndexEndBL;
+
+		RefCntAutoPtr<IRenderDevice> m_pDevice;
+		RefCntAutoPtr<IBuffer> m_pVertexGPUBuffer;
+		RefCntAutoPtr<IBuffer> m_pIndexGPUBuffer;
+		RefCntAutoPtr<IBuffer> m_pInstanceBuf;
+		uint m_InstanceCapacity;
+
+		//rebuilt every frame from the selection, buckets are stored one after another
+		std::vector<PerPatchShaderData> m_Buckets[PATCH_DRAW_BUCKET_NUM];
+		std::vector<PerPatchShaderData> m_InstanceData;
+		uint m_PatchNum;
+		uint m_TriangleNum;
+	};
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef _CDLOD_TREE_H_
+#define _CDLOD_TREE_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "AdvancedMath.hpp"
+#include "FirstPersonCamera.hpp"
+
+#define MAX_LOD_COUNT 16
+
+#define MAX_HEIGHTMAP_SIZE 65535
+#define LEAF_RENDER_NODE_SIZE 8
+#define LOD_COUNT  8
+#define LOD_DISTANCE_RATIO 2.0f
+#define LOD_MESH_GRID_SIZE 8
+#define MORPH_START_RATIO 0.66f
+
+#include "TerrainMap.h"
+#include "HeightPyramid.h"
+#include "HorizonBuffer.h"
+
+namespace Diligent
+{
+	struct SelectionInfo;	
+
+	enum class LODNodeState
+	{
+		UNDEFINED,
+		OUT_OF_FRUSTUM,
+		OUT_OF_LOD_RANGE,
+		SELECTED
+	};
+
+	//quad area
+	struct SelectNodeAreaFlag
+	{
+		enum AreaFlag : uint8_t
+		{
+			TL_ON = 1,
+			TR_ON = 1 << 1,
+			BL_ON = 1 << 2,
+			BR_ON = 1 << 3,
+			
+			FULL = 255
+		};
+
+		uint8_t flag;
+
+		SelectNodeAreaFlag()
+		{
+			memset(this, 0, sizeof(SelectNodeAreaFlag));
+		}
+
+		SelectNodeAreaFlag(bool full)
+		{
+			if (full)
+			{
+				SetFull();
+			}
+			else
+			{
+				memset(this, 0, sizeof(SelectNodeAreaFlag));
+			}			
+		}
+
+		SelectNodeAreaFlag(bool tl, bool tr, bool bl, bool br) :
+			flag(0)
+		{
+			SetFlag(tl, tr, bl, br);
+		}
+
+		void SetFlag(bool tl, bool tr, bool bl, bool br)
+		{
+			if (tl == true && tr == true && bl == true && br == true)
+			{
+				SetFull();
+			}
+			else
+			{
+				flag |= (tl) | (tr << 1) | (bl << 2) | (br << 3);
+			}						
+		}
+
+		void SetFull()
+		{
+			flag = FULL;
+		}
+	};
+
+	struct SelectNodeData
+	{
+		uint32_t NodeIdx; //flat index in the tree
+		int LODLevel;
+		BoundBox aabb;
+		SelectNodeAreaFlag AreaFlag;
+	};
+
+	struct SelectionInfo
+	{
+		std::vector<SelectNodeData> SelectionNodes;
+		uint32_t RasSizeX, RasSizeY;
+		Dimension TerrainDimension;
+		ViewFrustum frustum;
+		float3 CamPos;
+		std::vector<float> LODRange;
+		std::vector<float> MorphStart;
+		std::vector<float> MorphEnd;
+
+		float near, far;
+
+		SelectionInfo() :
+			RasSizeX(0),
+			RasSizeY(0),
+			near(-1.0f),
+			far(-1.0f)
+		{
+
+		}
+
+		void GetMorphFromLevel(const int level, float *pOut) const;
+	};	
+
+	//One level of the implicit quadtree, level 0 is the top. Nodes are stored row by row,
+	//the children of (x, y) are (2x, 2y), (2x + 1, 2y), (2x, 2y + 1), (2x + 1, 2y + 1) of the next level.
+	//Heights are read from the min/max pyramid, x/z bounds follow from the node position.
+	struct CDLODLevel
+	{
+		uint32_t NodeNumX;
+		uint32_t NodeNumY;
+		uint32_t FirstNode; //flat index of the first node of the level
+		int NodeSize; //in heightmap texels
+		float NodeWorldSizeX;
+		float NodeWorldSizeZ;
+
+		//normalized node heights, owned by the pyramid
+		const uint16_t *pMinZ;
+		const uint16_t *pMaxZ;
+
+		CDLODLevel() :
+			NodeNumX(0),
+			NodeNumY(0),
+			FirstNode(0),
+			NodeSize(0),
+			NodeWorldSizeX(0.0f),
+			NodeWorldSizeZ(0.0f),
+			pMinZ(nullptr),
+			pMaxZ(nullptr)
+		{
+
+		}
+	};
+
+	//where the heights of the node bounds come from
+	enum class CDLODBoundsPolicy
+	{
+		HEIGHTMAP, //min/max pyramid of the heightmap, flat maps give zero heights
+		FULL_RANGE //every node spans the whole terrain height, for surfaces displaced at render time
+	};
+
+	struct CDLODTreeDesc
+	{
+		CDLODBoundsPolicy BoundsPolicy = CDLODBoundsPolicy::HEIGHTMAP;
+
+		//world space margin below and above every node, e.g. for displacement the heights don't hold
+		float BoundsPaddingY = 0.0f;
+
+		//world space margin around every node in x/z for the frustum tests only, the node bounds
+		//place the patches. For horizontal displacement, not applied by CDLODGPUSelection.
+		float BoundsPaddingXZ = 0.0f;
+
+		//>0 - the lod ranges keep a patch grid cell below this many pixels on screen instead of
+		//splitting the view distance by LOD_DISTANCE_RATIO, see SetViewportHeight
+		float MaxScreenSpaceError = 0.0f;
+		uint32_t PatchGridSize = LOD_MESH_GRID_SIZE;
+
+		//drop selected nodes hidden behind closer terrain, see CullOccludedNodes
+		bool HorizonCulling = false;
+		uint32_t HorizonBinNum = HORIZON_BUFFER_DEFAULT_BIN_NUM;
+	};
+
+	class CDLODTree
+	{
+	public:
+		explicit CDLODTree(const TerrainMap &heightmap, const Dimension &TerrainDim, const CDLODTreeDesc &Desc = CDLODTreeDesc());
+		~CDLODTree();
+
+		void Create();
+		void SelectLOD(const FirstPersonCamera &cam);
+
+		//LOD ranges, morph constants and frustum of the camera without the traversal,
+		//for selections done elsewhere (see CDLODGPUSelection)
+		void UpdateSelectionParams(const FirstPersonCamera &cam);
+
+		BoundBox GetNodeBBox(const int LODLevel, const uint32_t x, const uint32_t y) const;
+		float GetHeightScale() const { return mHeightScale; }
+
+		const SelectionInfo &GetSelectInfo() const;
+
+		uint32_t GetNodeNum() const { return mNodeNum; }
+		const CDLODLevel &GetLevel(const int LODLevel) const { return mLevels[LODLevel]; }
+		const CDLODTreeDesc &GetDesc() const { return mDesc; }
+
+		//not modified after Create
+		const TerrainMap &GetHeightMap() const { return mHeightMap; }
+		const HeightMinMaxPyramid &GetPyramid() const { return mPyramid; }
+		const Dimension &GetTerrainDimension() const { return mSelectionInfo.TerrainDimension; }
+
+		void SetHorizonCulling(const bool bEnable) { mDesc.HorizonCulling = bEnable; }
+
+		//for bounds that change at run time, e.g. with the wave amplitude
+		void SetBoundsPadding(const float PaddingY, const float PaddingXZ);
+
+		//pixels the screen space error is measured in, the lod ranges are rebuilt when it changes
+		void SetViewportHeight(const uint32_t Height);
+		void SetMaxScreenSpaceError(const float MaxError);
+		//nodes of the last selection rejected by the horizon
+		uint32_t GetOccludedNodeNum() const { return mOccludedNodeNum; }
+
+	protected:
+		void UpdateLODRangeAndMorph(const FirstPersonCamera &cam);
+
+		//LODRange from the near and far plane, by LOD_DISTANCE_RATIO
+		void SplitLODRangeByDistance();
+
+		//LODRange from the projected size of a patch grid cell
+		void SplitLODRangeByScreenSpaceError(const float FOV);
+
+		//GetNodeBBox grown by BoundsPaddingXZ
+		BoundBox GetNodeCullBBox(const int LODLevel, const uint32_t x, const uint32_t y) const;
+
+		float ToWorldY(const uint16_t z) const { return z * mHeightScale + mSelectionInfo.TerrainDimension.Min.y; }
+
+		//Frustum test of the four children of (x, y) at once, in TL, TR, BL, BR order.
+		void GetChildVisibility(const int LODLevel, const uint32_t x, const uint32_t y, const bool bFullInFrustum, BoxVisibility *pOutVis) const;
+
+		//Depth first selection below a top node with an explicit stack.
+		LODNodeState SelectNode(const uint32_t x, const uint32_t y, const BoxVisibility Vis);
+
+		//Front-to-back pass over the selected nodes with a horizon built from their min heights.
+		//A node only becomes an occluder once every node starting closer than its far end was tested.
+		void CullOccludedNodes();
+
+	private:
+		//Dimension mTerrainDimension;
+		TerrainMap mHeightMap;
+		CDLODTreeDesc mDesc;
+
+		CDLODLevel mLevels[LOD_COUNT];
+		uint32_t mNodeNum;
+
+		HeightMinMaxPyramid mPyramid;
+		float mHeightScale;
+
+		SelectionInfo mSelectionInfo;
+
+		HorizonBuffer mHorizon;
+		uint32_t mOccludedNodeNum;
+
+		//what the lod ranges were built for
+		float mLODRangeFOV;
+		uint32_t mViewportHeight;
+		bool mbLODRangeDirty;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -28,7 +28,7 @@ namespace Diligent
 	public:
 		enum
 		{
-			MAX_AABB_COUNT = 4086
+			MAX_AABB_COUNT = 4096
 		};
 
 		DebugCanvas();
@@ -59,6 +59,9 @@ namespace Diligent
 		RefCntAutoPtr<IShaderResourceBinding> mSRB;
 	};
 
+	//boxes of the last CDLOD selection, drawn by the samples on demand
+	extern DebugCanvas gDebugCanvas;
+
 }
 
 #endif
\ No newline at end of file
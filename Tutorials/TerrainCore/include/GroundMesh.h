@@ -0,0 +1,102 @@
+#ifndef _GROUND_MESH_H_
+#define _GROUND_MESH_H_
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Buffer.h"
+#include "BasicMath.hpp"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "SwapChain.h"
+
+#include "CDLODGPUSelection.h"
+#include "CDLODPatchBatch.h"
+#include "CDLODTree.h"
+#include "TerrainVirtualTexture.h"
+
+namespace Diligent
+{
+	class FirstPersonCamera;
+
+	struct GPUConstBuffer
+	{
+		float4x4 ViewProj;
+		float4 CameraPos;
+	};
+
+	class GroundMesh
+	{
+	public:
+		GroundMesh(const uint SizeM, const uint Level, const float ClipScale);
+		~GroundMesh();
+
+		//selection and instances on the GPU, has to be set before InitClipMap
+		void SetGPUSelection(const bool bEnable) { m_bGPUSelection = bEnable; }
+		//CPU selection only, nodes behind closer terrain are not drawn
+		void SetHorizonCulling(const bool bEnable) { m_bHorizonCulling = bEnable; }
+
+		void InitClipMap(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension &TerrainDim);
+		void Render(IDeviceContext *pContext, const float3 &CamPos);
+
+		void Update(const FirstPersonCamera *pCam);		
+
+		double GetRenderCPUTime() const { return m_RenderCPUTime; }
+		uint GetRenderDrawNum() const { return m_RenderDrawNum; }
+		uint GetRenderPatchNum() const { return m_RenderPatchNum; }
+
+		//valid after InitClipMap, e.g. for a TerrainQuery
+		const CDLODTree *GetCDLODTree() const { return mpCDLODTree; }
+
+	protected:
+		void InitVirtualTextures(IRenderDevice *pDevice, ISwapChain *pSwapChain);
+		void InitPSO(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension& dim);
+
+	private:
+		uint m_sizem;
+		uint m_level;
+		float m_clip_scale;
+
+		CDLODPatchBatch m_PatchBatch;
+
+		RefCntAutoPtr<IBuffer> m_pVsConstBuf;
+		RefCntAutoPtr<IBuffer> m_pVSTerrainInfoBuf;
+		RefCntAutoPtr<IRenderDevice> m_pDevice;
+		RefCntAutoPtr<IShaderResourceBinding> m_pSRB;
+
+		RefCntAutoPtr<IPipelineState> m_pPSO;
+
+		//same vertex stage, writes the diffuse pages the pixels need
+		RefCntAutoPtr<IPipelineState> m_pFeedbackPSO;
+		RefCntAutoPtr<IShaderResourceBinding> m_pFeedbackSRB;
+		RefCntAutoPtr<ISwapChain> m_pSwapChain;
+
+		float4x4 m_TerrainViewProjMat;
+
+		double m_RenderCPUTime;
+		uint m_RenderDrawNum;
+		uint m_RenderPatchNum;
+
+		TerrainMap m_Heightmap;
+
+		//heights are paged for the selected nodes, diffuse from the feedback of the previous frames
+		TerrainVirtualTexture m_HeightVT;
+		TerrainVirtualTexture m_DiffuseVT;
+		VirtualTextureFeedback m_Feedback;
+		RefCntAutoPtr<IBuffer> m_pVTInfoBuf;
+		std::vector<uint32_t> m_PageKeys;
+
+		//------------------CDLOD
+		CDLODTree *mpCDLODTree;
+
+		bool m_bGPUSelection;
+		bool m_bHorizonCulling;
+		CDLODGPUSelection *mpGPUSelection;
+		//nodes read back from the GPU selection a few frames late, only for the height pages
+		SelectionInfo m_GPUSelectInfo;
+	};
+}
+
+#endif
\ No newline at end of file
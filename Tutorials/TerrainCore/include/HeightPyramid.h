@@ -0,0 +1,58 @@
+#ifndef _HEIGHT_PYRAMID_H_
+#define _HEIGHT_PYRAMID_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Diligent
+{
+	class TerrainMap;
+
+	//Min/max mips of a heightmap. Mip 0 holds blocks of LeafSize x LeafSize texels (clamped at the
+	//borders), every next mip reduces 2x2 blocks of the previous one, so mip m matches the CDLOD
+	//level LOD_COUNT - 1 - m. Values are normalized heights in [0, MAX_HEIGHTMAP_SIZE].
+	class HeightMinMaxPyramid
+	{
+	public:
+		struct Mip
+		{
+			uint32_t NumX = 0;
+			uint32_t NumY = 0;
+			std::vector<uint16_t> Min;
+			std::vector<uint16_t> Max;
+		};
+
+		//ThreadNum 0 - use all hardware threads
+		void Build(const TerrainMap &Heightmap, const uint32_t LeafSize, const uint32_t MipNum, uint32_t ThreadNum = 0);
+
+		//same layout for a Width x Height raster, every block spans [MinZ, MaxZ]
+		void BuildUniform(const uint32_t Width, const uint32_t Height, const uint32_t LeafSize, const uint32_t MipNum, const uint16_t MinZ, const uint16_t MaxZ);
+
+		bool LoadCache(const std::string &FileName, const uint64_t Key);
+		void SaveCache(const std::string &FileName, const uint64_t Key) const;
+
+		//raw layout without a header, also embedded in tiled heightmap files
+		bool Read(std::istream &rs);
+		void Write(std::ostream &ws) const;
+
+		//identifies the heightmap content and the pyramid layout
+		static uint64_t ComputeKey(const TerrainMap &Heightmap, const uint32_t LeafSize, const uint32_t MipNum);
+
+		uint32_t GetLeafSize() const { return mLeafSize; }
+		uint32_t GetMipNum() const { return static_cast<uint32_t>(mMips.size()); }
+		const Mip &GetMip(const uint32_t MipIdx) const { return mMips[MipIdx]; }
+
+	protected:
+		void BuildTopBlock(const TerrainMap &Heightmap, const uint32_t TopX, const uint32_t TopY, std::vector<uint16_t> &RowMin, std::vector<uint16_t> &RowMax);
+
+	private:
+		uint32_t mLeafSize = 0;
+		std::vector<Mip> mMips;
+	};
+}
+
+#endif
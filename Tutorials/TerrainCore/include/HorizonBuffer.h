@@ -0,0 +1,44 @@
+#ifndef _HORIZON_BUFFER_H_
+#define _HORIZON_BUFFER_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "AdvancedMath.hpp"
+
+#define HORIZON_BUFFER_DEFAULT_BIN_NUM 1024
+
+namespace Diligent
+{
+	//Coarse horizon around the camera for terrain occlusion. Every azimuth bin keeps the highest
+	//elevation slope (dy / horizontal distance) the inserted occluders are known to reach.
+	//Boxes are tested and inserted in world space, only their x/z footprint and y range matter.
+	//Tests are only valid against occluders that are closer than the tested box, see GetDistanceRange.
+	class HorizonBuffer
+	{
+	public:
+		void Reset(const float3 &CamPos, const uint32_t BinNum = HORIZON_BUFFER_DEFAULT_BIN_NUM);
+
+		//true if the whole box is below the horizon in every bin it touches
+		bool IsOccluded(const BoundBox &Box) const;
+
+		//Terrain inside the footprint is at least OccluderY high, that raises the bins
+		//fully covered by the footprint. Boxes around the camera are ignored.
+		void AddOccluder(const BoundBox &Box, const float OccluderY);
+
+		//closest and farthest horizontal distance of the footprint, false if the camera is above it
+		bool GetDistanceRange(const BoundBox &Box, float &MinDist, float &MaxDist) const;
+
+	protected:
+		//azimuth span of a footprint the camera is outside of, in bins, Last may exceed the bin num
+		void GetBinRange(const BoundBox &Box, float &FirstBin, float &LastBin) const;
+
+	private:
+		float3 mCamPos;
+		std::vector<float> mHorizon;
+	};
+}
+
+#endif
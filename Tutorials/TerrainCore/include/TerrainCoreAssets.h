@@ -0,0 +1,14 @@
+#ifndef _TERRAIN_CORE_ASSETS_H_
+#define _TERRAIN_CORE_ASSETS_H_
+
+#pragma once
+
+namespace Diligent
+{
+	//Shader search dirs of the TerrainCore assets, the shaders shared by the terrain samples.
+	//The build copies them to TerrainCore next to the sample, the sample's assets dir is the
+	//working dir when it is started from the IDE.
+	static const char *TERRAIN_CORE_SHADER_DIRS = "TerrainCore;../../TerrainCore/assets";
+}
+
+#endif
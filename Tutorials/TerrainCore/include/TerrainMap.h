@@ -0,0 +1,81 @@
+#ifndef _TERRAIN_HEIGHT_MAP_H_
+#define _TERRAIN_HEIGHT_MAP_H_
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "RefCntAutoPtr.hpp"
+#include "BasicMath.hpp"
+#include "Texture.h"
+#include "Image.h"
+
+namespace Diligent 
+{
+	struct IRenderDevice;
+	class TiledHeightMapStreamer;
+
+class TerrainMap
+{
+public:
+	TerrainMap();
+	~TerrainMap();
+
+	//8-bit, 16-bit and float heightmaps are accepted, the first channel is the height.
+	//The CPU copy always holds normalized 16-bit heights, float sources are expected in [0, 1].
+	//An empty diffuse name skips the diffuse map, a null device skips the textures.
+	void LoadMap(const std::string &DiffuseMapName, const std::string &HightMapName, IRenderDevice *device);	
+
+	//CPU only heights without textures, e.g. generated for benchmarks
+	void InitHeightMap(const uint32_t Width, const uint32_t Height, std::vector<uint16_t> &&Heights);
+
+	//Width x Height raster of zero heights without any data, for surfaces displaced on the GPU
+	void InitFlat(const uint32_t Width, const uint32_t Height);
+
+	//CPU only heights paged from a tiled file written by WriteTiledHeightMap (TiledHeightMap.h),
+	//the full raster is never in memory
+	bool OpenTiledHeightMap(const std::string &FileName);
+
+	//Moves the streaming focus, FocusUV is in [0, 1] over the map. Does nothing for maps in memory.
+	void UpdateStreaming(const float2 &FocusUV, const float FullDetailRadius = 1024.0f);
+
+	bool IsStreamed() const { return m_pStreamer != nullptr; }
+	bool IsFlat() const { return !m_pStreamer && !m_pHeightMemData; }
+	const TiledHeightMapStreamer *GetStreamer() const { return m_pStreamer.get(); }
+
+	void GetYArea(const uint32_t& x, const uint32_t& y, const uint16_t& size, uint16_t& o_minz, uint16_t& o_maxz) const;
+
+	uint16_t GetY(const uint32_t& x, const uint32_t& y) const;
+
+	//GetY of Num texels, streamed maps lock their tiles once for the whole batch
+	void GetYBatch(const uint32_t *pX, const uint32_t *pY, const uint32_t Num, uint16_t *pOut) const;
+
+	//nullptr for streamed maps
+	const uint16_t *GetHeightData() const;
+	const std::string &GetHeightMapName() const { return m_HeightMapName; }
+
+	ITexture* GetHeightMapTexture();
+	ITexture* GetDiffuseMapTexture();
+
+public:
+	uint32_t width;
+	uint32_t height;
+
+protected:
+	void LoadHeightMap(const std::string &FileName, IRenderDevice *device);
+	void LoadDiffuseMap(const std::string &FileName, IRenderDevice *device);
+
+private:
+	RefCntAutoPtr<ITexture> m_apHeightTex;
+	std::shared_ptr<std::vector<uint16_t>> m_pHeightMemData; //shared by copies of the map
+	std::shared_ptr<TiledHeightMapStreamer> m_pStreamer;
+	std::string m_HeightMapName;
+
+	RefCntAutoPtr<ITexture> m_apDiffTex;
+};
+
+}
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef _TERRAIN_QUERY_H_
+#define _TERRAIN_QUERY_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include "AdvancedMath.hpp"
+#include "TerrainMap.h"
+
+//queries of a batch are processed in chunks of this size with stack buffers
+#define TERRAIN_QUERY_CHUNK_SIZE 256
+
+namespace Diligent
+{
+	class CDLODTree;
+	class HeightMinMaxPyramid;
+
+	struct TerrainRay
+	{
+		float3 Origin;
+		float3 Dir; //normalized
+		float MaxDist = 1e30f;
+	};
+
+	struct TerrainRayHit
+	{
+		float3 Pos;
+		float3 Normal;
+		float Dist = 0.0f;
+		bool bHit = false;
+	};
+
+	//World space height, normal and ray queries for gameplay and physics. Heights are bilinearly
+	//filtered between texels, positions outside the terrain are clamped to its border.
+	//The heights and the min/max pyramid of the tree are not modified after CDLODTree::Create, so
+	//every method can be called from any number of threads while the renderer selects and draws.
+	//The tree has to outlive the query.
+	class TerrainQuery
+	{
+	public:
+		explicit TerrainQuery(const CDLODTree &Tree);
+
+		float GetHeight(const float2 &XZ) const;
+		float3 GetNormal(const float2 &XZ) const;
+
+		void GetHeights(const float2 *pXZ, const uint32_t Num, float *pOutHeights) const;
+
+		//from central differences one texel apart
+		void GetNormals(const float2 *pXZ, const uint32_t Num, float3 *pOutNormals) const;
+
+		//first hit of every ray within its MaxDist, the min/max pyramid skips empty space
+		void RayCast(const TerrainRay *pRays, const uint32_t Num, TerrainRayHit *pOutHits) const;
+
+	protected:
+		//Num <= TERRAIN_QUERY_CHUNK_SIZE positions in texel space, world heights out
+		void SampleChunk(const float *pTexX, const float *pTexZ, const uint32_t Num, float *pOutHeights) const;
+
+		float SampleTexel(float TexX, float TexZ) const;
+
+		bool RayCastOne(const TerrainRay &Ray, TerrainRayHit &Hit) const;
+
+		//heights of the leaf march between entering and leaving a leaf node
+		bool MarchLeaf(const TerrainRay &Ray, const float t0, const float t1, float &tHit) const;
+
+		//World box of a pyramid node. The bilinear surface of a node reaches the first texels
+		//of the next nodes, their bounds are merged in.
+		BoundBox GetNodeBox(const uint32_t Mip, const uint32_t x, const uint32_t y) const;
+
+	private:
+		TerrainMap mHeightMap;
+		const HeightMinMaxPyramid *mpPyramid;
+
+		float3 mTerrainMin;
+		float mTexelWorldSizeX;
+		float mTexelWorldSizeZ;
+		float mHeightScale;
+		uint32_t mWidth;
+		uint32_t mHeight;
+	};
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef _TERRAIN_VIRTUAL_TEXTURE_H_
+#define _TERRAIN_VIRTUAL_TEXTURE_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "Texture.h"
+
+#include "VirtualTextureCache.h"
+
+//the feedback target is this many times smaller than the screen
+#define VT_FEEDBACK_DOWNSCALE 8
+#define VT_FEEDBACK_LATENCY 3
+
+namespace Diligent
+{
+	class TerrainMap;
+	struct SelectionInfo;
+
+	//matches VirtualTextureAttribs in VirtualTexture.fxh
+	struct VirtualTextureShaderAttribs
+	{
+		float4 TexelScale; //xy: mip 0 texels per terrain uv, z: page size, w: page border
+		float4 AtlasInfo; //xy: 1 / atlas size, z: mip count, w: feedback mip bias
+	};
+
+	//Page table texture (one mip per virtual mip) and physical page atlas of a VirtualTextureCache.
+	class TerrainVirtualTexture
+	{
+	public:
+		bool Init(IRenderDevice *pDevice, const VirtualTextureDesc &Desc, const TEXTURE_FORMAT AtlasFormat, const char *Name);
+
+		void RequestPages(const std::vector<uint32_t> &PageKeys) { mCache.RequestPages(PageKeys); }
+
+		//copies the pages of the frame into the atlas, the upload budget of the cache applies
+		void Update(IDeviceContext *pContext);
+
+		VirtualTextureShaderAttribs GetShaderAttribs(const float2 &TexelScale, const float FeedbackMipBias) const;
+
+		ITextureView *GetPageTableSRV() const { return mpPageTableTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE); }
+		ITextureView *GetAtlasSRV() const { return mpAtlasTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE); }
+		const VirtualTextureCache &GetCache() const { return mCache; }
+
+	private:
+		VirtualTextureCache mCache;
+		std::vector<VirtualPageUpload> mUploads;
+
+		RefCntAutoPtr<ITexture> mpPageTableTex;
+		RefCntAutoPtr<ITexture> mpAtlasTex;
+	};
+
+	//Low resolution target the terrain writes its diffuse page requests to, read back
+	//VT_FEEDBACK_LATENCY frames later so the CPU never waits for the GPU.
+	class VirtualTextureFeedback
+	{
+	public:
+		VirtualTextureFeedback();
+
+		void Init(IRenderDevice *pDevice, const uint32_t Width, const uint32_t Height);
+
+		//binds and clears the feedback target
+		void Begin(IDeviceContext *pContext);
+
+		//Queues the target for readback and decodes the oldest one into packed VirtualPageId
+		void End(IDeviceContext *pContext, std::vector<uint32_t> &PageKeys);
+
+		static const TEXTURE_FORMAT ColorFormat = TEX_FORMAT_RGBA8_UNORM;
+		static const TEXTURE_FORMAT DepthFormat = TEX_FORMAT_D32_FLOAT;
+
+	private:
+		uint32_t mWidth;
+		uint32_t mHeight;
+		uint64_t mFrame;
+
+		RefCntAutoPtr<ITexture> mpColorTex;
+		RefCntAutoPtr<ITexture> mpDepthTex;
+		RefCntAutoPtr<ITexture> mpStagingTex[VT_FEEDBACK_LATENCY];
+	};
+
+	//Height pages are decimated instead of filtered, a vertex on a grid of 2^m texels reads the same
+	//height from mip m as from mip 0, so patches of different LODs keep matching edges.
+	void CreateHeightPageLoader(const TerrainMap &Heightmap, VirtualTextureDesc &Desc);
+
+	//8-bit image with a box filtered mip chain kept by the loader, fills Width, Height and TexelBytes
+	bool CreateImagePageLoader(const std::string &FileName, VirtualTextureDesc &Desc);
+
+	//Height pages under the selected CDLOD nodes, each node at the mip of its grid spacing
+	void CollectSelectionPageKeys(const SelectionInfo &SelectInfo, const VirtualTextureCache &Cache, std::vector<uint32_t> &PageKeys);
+}
+
+#endif
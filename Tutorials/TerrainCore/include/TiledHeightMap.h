@@ -0,0 +1,109 @@
+#ifndef _TILED_HEIGHT_MAP_H_
+#define _TILED_HEIGHT_MAP_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "HeightPyramid.h"
+
+namespace Diligent
+{
+	class TerrainMap;
+
+	//File layout: TiledHeightMapHeader, the min/max pyramid of the whole map (HeightMinMaxPyramid::Write),
+	//then TileNumX * TileNumY tiles row by row from TileDataOffset. A tile stores its mips from the finest
+	//on, mip m is (TileSize >> m)^2 normalized 16-bit heights, texels past the map border repeat the edge.
+	struct TiledHeightMapHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t TileSize;
+		uint32_t TileMipNum;
+		uint32_t TileNumX;
+		uint32_t TileNumY;
+		uint64_t TileDataOffset;
+	};
+
+	//Converts a heightmap in memory, TileSize must be a power of two with TileSize >> (TileMipNum - 1) >= 1.
+	bool WriteTiledHeightMap(const TerrainMap &Source, const std::string &FileName, const uint32_t TileSize = 256, const uint32_t TileMipNum = 5);
+
+	//Pages the tiles of a tiled heightmap around a focus point. The coarsest mip of every tile and the
+	//min/max pyramid are loaded on Open and stay resident, finer mips are read by a background IO thread.
+	class TiledHeightMapStreamer
+	{
+	public:
+		TiledHeightMapStreamer();
+		~TiledHeightMapStreamer();
+
+		bool Open(const std::string &FileName);
+		void Close();
+
+		//Tiles within FullDetailRadius texels of the focus want mip 0, every doubling of the distance
+		//one mip coarser. Missing mips are queued closest first, mips finer than wanted are dropped.
+		void SetFocus(const float2 &FocusTexel, const float FullDetailRadius);
+
+		//normalized height from the finest resident mip of the tile
+		uint16_t Sample(const uint32_t x, const uint32_t y) const;
+		void SampleBatch(const uint32_t *pX, const uint32_t *pY, const uint32_t Num, uint16_t *pOut) const;
+
+		uint32_t GetWidth() const { return mHeader.Width; }
+		uint32_t GetHeight() const { return mHeader.Height; }
+		const HeightMinMaxPyramid &GetPyramid() const { return mPyramid; }
+
+		//tiles with a mip finer than the always resident one
+		uint32_t GetResidentTileNum() const;
+		size_t GetResidentBytes() const;
+		uint32_t GetPendingRequestNum() const;
+
+	protected:
+		struct TileRequest
+		{
+			uint32_t TileIdx;
+			uint32_t Mip;
+		};
+
+		struct TileSlot
+		{
+			uint32_t ResidentMip; //finest mip in Data, TileMipNum - 1 when only Coarse is resident
+			std::vector<uint16_t> Data;
+			std::vector<uint16_t> Coarse;
+		};
+
+		void IOThreadFunc();
+		//mTileMutex has to be held
+		uint16_t SampleLocked(const uint32_t x, const uint32_t y) const;
+		void DropTileMips(TileSlot &Slot, const uint32_t Mip) const;
+		bool ReadTileMip(std::ifstream &rf, const uint32_t TileIdx, const uint32_t Mip, std::vector<uint16_t> &Out) const;
+		uint64_t GetTileMipOffset(const uint32_t TileIdx, const uint32_t Mip) const;
+
+	private:
+		std::string mFileName;
+		TiledHeightMapHeader mHeader;
+		HeightMinMaxPyramid mPyramid;
+
+		//Data and ResidentMip are swapped by the IO thread
+		mutable std::mutex mTileMutex;
+		std::vector<TileSlot> mTiles;
+
+		//replaced as a whole on every SetFocus
+		mutable std::mutex mQueueMutex;
+		std::condition_variable mQueueCond;
+		std::deque<TileRequest> mRequests;
+		bool mStopIO;
+
+		std::thread mIOThread;
+	};
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef _VIRTUAL_TEXTURE_CACHE_H_
+#define _VIRTUAL_TEXTURE_CACHE_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Diligent
+{
+	//page address in the virtual texture, 12 bits per axis
+	struct VirtualPageId
+	{
+		uint32_t Mip;
+		uint32_t X;
+		uint32_t Y;
+
+		uint32_t Pack() const { return (Mip << 24) | (Y << 12) | X; }
+		static VirtualPageId Unpack(const uint32_t Key) { return VirtualPageId({ Key >> 24, Key & 0xFFF, (Key >> 12) & 0xFFF }); }
+	};
+
+	struct VirtualTextureDesc
+	{
+		uint32_t Width = 0; //source texels at mip 0
+		uint32_t Height = 0;
+		uint32_t PageSize = 128; //texels without the border
+		uint32_t PageBorder = 4;
+		uint32_t TexelBytes = 4;
+		uint32_t SlotNumX = 16; //physical pages of the atlas, at most 256 per axis
+		uint32_t SlotNumY = 16;
+		uint32_t UploadBudget = 8; //pages moved into the atlas per frame
+
+		//Fills (PageSize + 2 * PageBorder)^2 texels of a page on the loader thread,
+		//texels past the source repeat the edge
+		std::function<void(const VirtualPageId&, uint8_t*)> LoadPage;
+	};
+
+	//page table texel, matches a RGBA8_UINT texture
+	struct VirtualPageTableEntry
+	{
+		uint8_t SlotX;
+		uint8_t SlotY;
+		uint8_t Mip; //mip of the page in the slot, coarser than the entry when it falls back
+		uint8_t Valid;
+	};
+
+	struct VirtualPageUpload
+	{
+		uint32_t SlotX;
+		uint32_t SlotY;
+		VirtualPageId Page;
+		std::vector<uint8_t> Data;
+	};
+
+	struct VirtualTextureStats
+	{
+		uint32_t RequestedPageNum = 0; //last frame
+		uint32_t MissingPageNum = 0; //requested last frame but not resident
+		uint32_t ResidentPageNum = 0;
+		uint32_t PendingPageNum = 0; //queued, loading or waiting for the upload budget
+		uint32_t UploadNum = 0; //last frame
+		uint64_t EvictionNum = 0;
+	};
+
+	//Page residency of a virtual texture without any GPU resources, so the request and eviction
+	//logic also runs CPU only. The page grid is square with a power of two size, the top mip is one
+	//page which is loaded on Init and never evicted, every page table entry falls back to it.
+	class VirtualTextureCache
+	{
+	public:
+		VirtualTextureCache();
+		~VirtualTextureCache();
+
+		bool Init(const VirtualTextureDesc &Desc);
+		void Shutdown();
+
+		//Packed VirtualPageId used by the frame, duplicates are fine. Resident pages and their parents
+		//are touched, missing ones are queued for the loader coarsest first, replacing the last queue.
+		void RequestPages(const std::vector<uint32_t> &PageKeys);
+
+		//Moves at most UploadBudget loaded pages into slots, evicting the least recently used pages
+		//not requested this frame, and ends the frame. Returns true if the page table changed.
+		bool Update(std::vector<VirtualPageUpload> &Uploads);
+
+		const VirtualTextureDesc &GetDesc() const { return mDesc; }
+		uint32_t GetMipNum() const { return mMipNum; }
+		uint32_t GetPageNum(const uint32_t Mip) const { return std::max(mPageNum >> Mip, 1u); }
+		uint32_t GetSlotSize() const { return mDesc.PageSize + 2 * mDesc.PageBorder; }
+		const std::vector<VirtualPageTableEntry> &GetPageTable(const uint32_t Mip) const { return mPageTable[Mip]; }
+		const VirtualTextureStats &GetStats() const { return mStats; }
+
+	protected:
+		struct Slot
+		{
+			uint32_t PageKey;
+			uint64_t LastUsedFrame;
+			bool bPinned;
+		};
+
+		void LoaderThreadFunc();
+		int AcquireSlot();
+		void RebuildPageTable();
+
+	private:
+		VirtualTextureDesc mDesc;
+		uint32_t mPageNum; //per axis at mip 0
+		uint32_t mMipNum;
+		uint64_t mFrame;
+
+		std::vector<Slot> mSlots;
+		std::vector<uint32_t> mFreeSlots;
+		std::unordered_map<uint32_t, uint32_t> mResident; //page key -> slot
+		std::unordered_set<uint32_t> mPending; //main thread only
+		std::vector<std::vector<VirtualPageTableEntry>> mPageTable;
+
+		std::mutex mQueueMutex;
+		std::condition_variable mQueueCond;
+		std::deque<uint32_t> mLoadQueue;
+		std::deque<VirtualPageUpload> mLoaded;
+		bool mStopLoader;
+		std::thread mLoaderThread;
+
+		VirtualTextureStats mStats;
+	};
+}
+
+#endif
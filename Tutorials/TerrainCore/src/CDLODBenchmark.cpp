@@ -0,0 +1,808 @@
+#include "CDLODBenchmark.h"
+#include "CDLODGPUSelection.h"
+#include "CDLODPatchBatch.h"
+#include "CDLODTree.h"
+#include "TerrainMap.h"
+#include "TerrainQuery.h"
+#include "TiledHeightMap.h"
+#include "TerrainVirtualTexture.h"
+#include "Errors.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace Diligent;
+
+	//a few octaves of sines, enough height variation for the min/max bounds
+	std::vector<uint16_t> GenerateHeights(const uint32_t Size)
+	{
+		std::vector<uint16_t> Heights(size_t(Size) * Size);
+		const float Freq = 6.28318530718f / Size;
+		for (uint32_t y = 0; y < Size; ++y)
+		{
+			for (uint32_t x = 0; x < Size; ++x)
+			{
+				float h = 0.0f;
+				float Amp = 0.5f;
+				float f = Freq * 2.0f;
+				for (int Octave = 0; Octave < 4; ++Octave)
+				{
+					h += Amp * std::sin(x * f + Octave) * std::cos(y * f * 1.3f - Octave);
+					Amp *= 0.5f;
+					f *= 3.1f;
+				}
+				Heights[size_t(y) * Size + x] = static_cast<uint16_t>(std::min(std::max((h + 1.0f) * 32767.5f, 0.0f), 65535.0f));
+			}
+		}
+		return Heights;
+	}
+
+	//t in [0, 1) over the whole run
+	void PlaceCamera(FirstPersonCamera &Cam, const Dimension &TerrainDim, const float t)
+	{
+		const float3 Center = TerrainDim.Min + TerrainDim.Size * 0.5f;
+		const float Radius = std::min(TerrainDim.SizeX, TerrainDim.SizeZ) * 0.35f;
+		const float Angle = t * 3.0f * 6.28318530718f;
+
+		float3 Pos;
+		float3 LookAt;
+		if (t < 1.0f / 3.0f)
+		{
+			//low orbit, looking along the path
+			Pos = float3({ Center.x + Radius * std::cos(Angle), TerrainDim.Min.y + TerrainDim.SizeY + 50.0f, Center.z + Radius * std::sin(Angle) });
+			LookAt = float3({ Center.x + Radius * std::cos(Angle + 0.1f), Pos.y - 200.0f, Center.z + Radius * std::sin(Angle + 0.1f) });
+		}
+		else if (t < 2.0f / 3.0f)
+		{
+			//high orbit, looking at the center
+			Pos = float3({ Center.x + Radius * std::cos(Angle), TerrainDim.Min.y + TerrainDim.SizeY * 4.0f, Center.z + Radius * std::sin(Angle) });
+			LookAt = Center;
+		}
+		else
+		{
+			//dive across the terrain
+			float s = (t - 2.0f / 3.0f) * 3.0f;
+			Pos = float3({ TerrainDim.Min.x + TerrainDim.SizeX * s, TerrainDim.Min.y + TerrainDim.SizeY * (3.0f - 2.0f * s), Center.z });
+			LookAt = Pos + float3({ 1000.0f, -300.0f, 200.0f });
+		}
+
+		Cam.SetPos(Pos);
+		Cam.SetLookAt(LookAt);
+		Cam.InvalidUpdate();
+	}
+
+	//t in [0, 1), a walk across the terrain at eye height, looking ahead
+	void PlaceWalkCamera(FirstPersonCamera &Cam, const TerrainMap &Heightmap, const Dimension &TerrainDim, const float EyeHeight, const float t)
+	{
+		const float s = 0.1f + 0.8f * t;
+		const float Sway = 0.1f * std::sin(t * 6.28318530718f * 2.0f);
+		float3 Pos = float3({ TerrainDim.Min.x + TerrainDim.SizeX * s, 0.0f, TerrainDim.Min.z + TerrainDim.SizeZ * (s + Sway) });
+
+		const uint32_t x = std::min(static_cast<uint32_t>((Pos.x - TerrainDim.Min.x) / TerrainDim.SizeX * (Heightmap.width - 1)), Heightmap.width - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>((Pos.z - TerrainDim.Min.z) / TerrainDim.SizeZ * (Heightmap.height - 1)), Heightmap.height - 1);
+		Pos.y = TerrainDim.Min.y + Heightmap.GetY(x, y) * TerrainDim.SizeY / MAX_HEIGHTMAP_SIZE + EyeHeight;
+
+		Cam.SetPos(Pos);
+		Cam.SetLookAt(Pos + float3({ 1000.0f, 0.0f, 1000.0f }));
+		Cam.InvalidUpdate();
+	}
+
+	uint64_t GetSelectionTriangleNum(const SelectionInfo &SelectInfo, const uint32_t GridSize)
+	{
+		const uint64_t PatchTriangles = uint64_t(GridSize) * GridSize * 2;
+		uint64_t TriangleNum = 0;
+		for (const SelectNodeData &NodeData : SelectInfo.SelectionNodes)
+		{
+			if (NodeData.AreaFlag.flag == SelectNodeAreaFlag::FULL)
+			{
+				TriangleNum += PatchTriangles;
+			}
+			else
+			{
+				for (int q = 0; q < 4; ++q)
+				{
+					TriangleNum += (NodeData.AreaFlag.flag >> q) & 1 ? PatchTriangles / 4 : 0;
+				}
+			}
+		}
+		return TriangleNum;
+	}
+
+	//bilinear height of the raster at world x/z, the point has to be on the terrain
+	float SampleHeight(const TerrainMap &Heightmap, const Dimension &TerrainDim, const float x, const float z)
+	{
+		const float fx = std::min(std::max((x - TerrainDim.Min.x) / TerrainDim.SizeX * (Heightmap.width - 1), 0.0f), float(Heightmap.width - 1));
+		const float fz = std::min(std::max((z - TerrainDim.Min.z) / TerrainDim.SizeZ * (Heightmap.height - 1), 0.0f), float(Heightmap.height - 1));
+		const uint32_t x0 = std::min(static_cast<uint32_t>(fx), Heightmap.width - 2);
+		const uint32_t z0 = std::min(static_cast<uint32_t>(fz), Heightmap.height - 2);
+		const float sx = fx - x0;
+		const float sz = fz - z0;
+
+		const float h0 = Heightmap.GetY(x0, z0) * (1.0f - sx) + Heightmap.GetY(x0 + 1, z0) * sx;
+		const float h1 = Heightmap.GetY(x0, z0 + 1) * (1.0f - sx) + Heightmap.GetY(x0 + 1, z0 + 1) * sx;
+		return TerrainDim.Min.y + (h0 * (1.0f - sz) + h1 * sz) * TerrainDim.SizeY / MAX_HEIGHTMAP_SIZE;
+	}
+
+	struct HorizonRayCheckStats
+	{
+		uint64_t NodeNum = 0;
+		uint64_t SampleNum = 0; //in the view
+		uint64_t VisibleSampleNum = 0;
+		uint64_t VisibleNodeNum = 0;
+	};
+
+	//Marches rays from the camera to a grid of surface points of every node in AllNodes but not in
+	//CulledNodes, Step apart. A point in the view that no terrain hides belongs to a wrongly culled node.
+	void CheckHorizonCulledNodes(const TerrainMap &Heightmap, const Dimension &TerrainDim, const FirstPersonCamera &Cam, std::vector<SelectNodeData> AllNodes,
+		std::vector<SelectNodeData> CulledNodes, const uint32_t SampleNum, const float Step, HorizonRayCheckStats &Stats)
+	{
+		auto ByNode = [](const SelectNodeData &a, const SelectNodeData &b) { return a.NodeIdx < b.NodeIdx; };
+		std::sort(AllNodes.begin(), AllNodes.end(), ByNode);
+		std::sort(CulledNodes.begin(), CulledNodes.end(), ByNode);
+
+		std::vector<SelectNodeData> Removed;
+		std::set_difference(AllNodes.begin(), AllNodes.end(), CulledNodes.begin(), CulledNodes.end(), std::back_inserter(Removed), ByNode);
+
+		const float3 CamPos = Cam.GetPos();
+		const float4x4 ViewProj = Cam.GetViewProjMatrix();
+		const float2 TerrainMax = float2(TerrainDim.Min.x + TerrainDim.SizeX, TerrainDim.Min.z + TerrainDim.SizeZ);
+		for (const SelectNodeData &Node : Removed)
+		{
+			uint32_t ViewNum = 0;
+			uint32_t VisibleNum = 0;
+			for (uint32_t y = 0; y < SampleNum; ++y)
+			{
+				for (uint32_t x = 0; x < SampleNum; ++x)
+				{
+					const float u = (x + 0.5f) / SampleNum;
+					const float v = (y + 0.5f) / SampleNum;
+					const float px = Node.aabb.Min.x + (Node.aabb.Max.x - Node.aabb.Min.x) * u;
+					const float pz = Node.aabb.Min.z + (Node.aabb.Max.z - Node.aabb.Min.z) * v;
+					const float3 Pos = float3({ px, SampleHeight(Heightmap, TerrainDim, px, pz), pz });
+
+					const float4 Clip = float4(Pos, 1.0f) * ViewProj;
+					if (Clip.w <= 0.0f || std::abs(Clip.x) > Clip.w || std::abs(Clip.y) > Clip.w || Clip.z < 0.0f || Clip.z > Clip.w)
+					{
+						continue;
+					}
+
+					//stops a step short of the point, the surface around it must not hide it
+					const float Dist = length(Pos - CamPos);
+					if (Dist <= Step)
+					{
+						continue;
+					}
+					++ViewNum;
+
+					const float3 Dir = (Pos - CamPos) / Dist;
+					bool bHidden = false;
+					for (float t = Step; t < Dist - Step && !bHidden; t += Step)
+					{
+						const float3 RayPos = CamPos + Dir * t;
+						if (RayPos.x < TerrainDim.Min.x || RayPos.z < TerrainDim.Min.z || RayPos.x > TerrainMax.x || RayPos.z > TerrainMax.y)
+						{
+							continue;
+						}
+						bHidden = RayPos.y < SampleHeight(Heightmap, TerrainDim, RayPos.x, RayPos.z);
+					}
+					VisibleNum += bHidden ? 0 : 1;
+				}
+			}
+
+			++Stats.NodeNum;
+			Stats.SampleNum += ViewNum;
+			Stats.VisibleSampleNum += VisibleNum;
+			Stats.VisibleNodeNum += VisibleNum > 0 ? 1 : 0;
+		}
+	}
+}
+
+namespace
+{
+	using namespace Diligent;
+
+	bool NearlyEqual(const float4 &a, const float4 &b)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			if (std::abs(a[i] - b[i]) > 1e-3f * std::max(1.0f, std::abs(b[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//First difference of what cdlod_select.csh wrote and the CPU path, empty if there is none.
+	//CPUNodes are sorted by node, PatchBatch is updated from the same selection.
+	std::string CompareGPUSelectionResult(CDLODGPUSelectionResult &Result, const std::vector<SelectNodeData> &CPUNodes, const CDLODPatchBatch &PatchBatch)
+	{
+		if (Result.SelectedNum != CPUNodes.size())
+		{
+			return "node count " + std::to_string(Result.SelectedNum) + ", SelectLOD " + std::to_string(CPUNodes.size());
+		}
+
+		std::sort(Result.Nodes.begin(), Result.Nodes.end(), [](const SelectNodeData &a, const SelectNodeData &b) { return a.NodeIdx < b.NodeIdx; });
+		for (size_t n = 0; n < CPUNodes.size(); ++n)
+		{
+			if (Result.Nodes[n].NodeIdx != CPUNodes[n].NodeIdx || Result.Nodes[n].LODLevel != CPUNodes[n].LODLevel)
+			{
+				return "node " + std::to_string(Result.Nodes[n].NodeIdx) + " level " + std::to_string(Result.Nodes[n].LODLevel) +
+					", SelectLOD node " + std::to_string(CPUNodes[n].NodeIdx) + " level " + std::to_string(CPUNodes[n].LODLevel);
+			}
+		}
+
+		auto ByPosition = [](const PerPatchShaderData &a, const PerPatchShaderData &b)
+		{
+			if (a.Scale.z != b.Scale.z) return a.Scale.z < b.Scale.z;
+			if (a.Offset.z != b.Offset.z) return a.Offset.z < b.Offset.z;
+			return a.Offset.x < b.Offset.x;
+		};
+
+		for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+		{
+			uint FirstIndex, IndexNum;
+			PatchBatch.GetBucketIndexRange(i, FirstIndex, IndexNum);
+			std::vector<PerPatchShaderData> CPUInstances = PatchBatch.GetBucketInstances(i);
+
+			const uint32_t *pArgs = &Result.DrawArgs[i * 5];
+			if (pArgs[0] != IndexNum || pArgs[1] != CPUInstances.size() || pArgs[2] != FirstIndex || pArgs[3] != 0 ||
+				pArgs[4] != uint32_t(i) * CDLOD_SELECT_MAX_BUCKET_INSTANCES)
+			{
+				return "bucket " + std::to_string(i) + " draw args " + std::to_string(pArgs[0]) + " " + std::to_string(pArgs[1]) + " " +
+					std::to_string(pArgs[2]) + " " + std::to_string(pArgs[3]) + " " + std::to_string(pArgs[4]) + ", expected " +
+					std::to_string(IndexNum) + " " + std::to_string(CPUInstances.size()) + " " + std::to_string(FirstIndex) + " 0 " +
+					std::to_string(i * CDLOD_SELECT_MAX_BUCKET_INSTANCES);
+			}
+
+			//instances are appended in any order
+			std::vector<PerPatchShaderData> &GPUInstances = Result.Instances[i];
+			std::sort(GPUInstances.begin(), GPUInstances.end(), ByPosition);
+			std::sort(CPUInstances.begin(), CPUInstances.end(), ByPosition);
+			for (size_t n = 0; n < CPUInstances.size(); ++n)
+			{
+				if (!NearlyEqual(GPUInstances[n].Scale, CPUInstances[n].Scale) || !NearlyEqual(GPUInstances[n].Offset, CPUInstances[n].Offset) ||
+					!NearlyEqual(GPUInstances[n].MorphKInfo, CPUInstances[n].MorphKInfo))
+				{
+					return "bucket " + std::to_string(i) + " instance at " + std::to_string(CPUInstances[n].Offset.x) + ", " +
+						std::to_string(CPUInstances[n].Offset.z) + " differs";
+				}
+			}
+		}
+		return std::string();
+	}
+}
+
+void Diligent::RunSelectLODBenchmark(const SelectLODBenchmarkDesc &Desc)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	TerrainMap Heightmap;
+	Heightmap.InitHeightMap(Desc.RasterSize, Desc.RasterSize, GenerateHeights(Desc.RasterSize));
+	if (!Desc.StreamedFileName.empty())
+	{
+		if (!WriteTiledHeightMap(Heightmap, Desc.StreamedFileName) || !Heightmap.OpenTiledHeightMap(Desc.StreamedFileName))
+		{
+			return;
+		}
+	}
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ 0.0f, 0.0f, 0.0f });
+	TerrainDim.Size = float3({ (Desc.RasterSize - 1) * Desc.TexelWorldSize, Desc.TerrainHeight, (Desc.RasterSize - 1) * Desc.TexelWorldSize });
+
+	CDLODTree Tree(Heightmap, TerrainDim);
+	Tree.Create();
+
+	std::chrono::duration<double, std::milli> build_time = std::chrono::high_resolution_clock::now() - start;
+
+	FirstPersonCamera Cam;
+	Cam.SetProjAttribs(Desc.NearPlane, Desc.FarPlane, 16.0f / 9.0f, PI_F / 4.f, SURFACE_TRANSFORM_IDENTITY, false);
+
+	//warm up
+	PlaceCamera(Cam, TerrainDim, 0.0f);
+	Tree.SelectLOD(Cam);
+
+	double TotalTime = 0.0;
+	double MinTime = 1e30;
+	double MaxTime = 0.0;
+	size_t TotalSelectNum = 0;
+	for (uint32_t i = 0; i < Desc.FrameNum; ++i)
+	{
+		PlaceCamera(Cam, TerrainDim, float(i) / Desc.FrameNum);
+
+		//streaming runs on its own thread, only the focus update is on the frame
+		const float3 &CamPos = Cam.GetPos();
+		Heightmap.UpdateStreaming(float2((CamPos.x - TerrainDim.Min.x) / TerrainDim.SizeX, (CamPos.z - TerrainDim.Min.z) / TerrainDim.SizeZ),
+			Desc.StreamingFullDetailRadius);
+
+		auto frame_start = std::chrono::high_resolution_clock::now();
+		Tree.SelectLOD(Cam);
+		std::chrono::duration<double, std::milli> frame_time = std::chrono::high_resolution_clock::now() - frame_start;
+
+		TotalTime += frame_time.count();
+		MinTime = std::min(MinTime, frame_time.count());
+		MaxTime = std::max(MaxTime, frame_time.count());
+		TotalSelectNum += Tree.GetSelectInfo().SelectionNodes.size();
+	}
+
+	uint32_t FrameNum = std::max(Desc.FrameNum, 1u);
+	LOG_INFO_MESSAGE("SelectLOD benchmark ", Desc.RasterSize, "x", Desc.RasterSize, ": ", Tree.GetNodeNum(), " nodes, build ", build_time.count(), " ms");
+	LOG_INFO_MESSAGE("SelectLOD benchmark ", FrameNum, " frames: avg ", TotalTime / FrameNum, " ms, min ", MinTime, " ms, max ", MaxTime,
+		" ms, avg selected nodes ", TotalSelectNum / FrameNum);
+	if (const TiledHeightMapStreamer *pStreamer = Heightmap.GetStreamer())
+	{
+		LOG_INFO_MESSAGE("SelectLOD benchmark streaming: ", pStreamer->GetResidentTileNum(), " detailed tiles, ",
+			pStreamer->GetResidentBytes() / (1024.0 * 1024.0), " MB resident, ", pStreamer->GetPendingRequestNum(), " pending requests");
+	}
+}
+
+void Diligent::RunVirtualTexturePagingSim(const VirtualTexturePagingSimDesc &Desc)
+{
+	TerrainMap Heightmap;
+	Heightmap.InitHeightMap(Desc.RasterSize, Desc.RasterSize, GenerateHeights(Desc.RasterSize));
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ 0.0f, 0.0f, 0.0f });
+	TerrainDim.Size = float3({ (Desc.RasterSize - 1) * Desc.TexelWorldSize, Desc.TerrainHeight, (Desc.RasterSize - 1) * Desc.TexelWorldSize });
+
+	CDLODTree Tree(Heightmap, TerrainDim);
+	Tree.Create();
+
+	//page content does not matter here
+	VirtualTextureDesc VTDesc;
+	VTDesc.Width = Desc.RasterSize;
+	VTDesc.Height = Desc.RasterSize;
+	VTDesc.PageSize = Desc.PageSize;
+	VTDesc.TexelBytes = sizeof(uint16_t);
+	VTDesc.SlotNumX = Desc.SlotNum;
+	VTDesc.SlotNumY = Desc.SlotNum;
+	VTDesc.UploadBudget = Desc.UploadBudget;
+	const size_t PageBytes = size_t(Desc.PageSize + 2 * VTDesc.PageBorder) * (Desc.PageSize + 2 * VTDesc.PageBorder) * VTDesc.TexelBytes;
+	VTDesc.LoadPage = [PageBytes](const VirtualPageId &Page, uint8_t *pData)
+	{
+		memset(pData, Page.Mip, PageBytes);
+	};
+
+	VirtualTextureCache Cache;
+	if (!Cache.Init(VTDesc))
+	{
+		return;
+	}
+
+	FirstPersonCamera Cam;
+	Cam.SetProjAttribs(Desc.NearPlane, Desc.FarPlane, 16.0f / 9.0f, PI_F / 4.f, SURFACE_TRANSFORM_IDENTITY, false);
+
+	std::vector<uint32_t> PageKeys;
+	std::vector<VirtualPageUpload> Uploads;
+	uint64_t TotalRequested = 0;
+	uint64_t TotalMissing = 0;
+	uint64_t TotalFallback = 0;
+	uint64_t TotalUploads = 0;
+	uint32_t MaxPending = 0;
+	for (uint32_t i = 0; i < Desc.FrameNum; ++i)
+	{
+		PlaceCamera(Cam, TerrainDim, float(i) / Desc.FrameNum);
+		Tree.SelectLOD(Cam);
+
+		CollectSelectionPageKeys(Tree.GetSelectInfo(), Cache, PageKeys);
+		Cache.RequestPages(PageKeys);
+		Cache.Update(Uploads);
+
+		//lookups served by a coarser page after this frame's uploads
+		for (uint32_t Key : PageKeys)
+		{
+			VirtualPageId Page = VirtualPageId::Unpack(Key);
+			const VirtualPageTableEntry &Entry = Cache.GetPageTable(Page.Mip)[Page.Y * Cache.GetPageNum(Page.Mip) + Page.X];
+			TotalFallback += Entry.Mip != Page.Mip;
+		}
+
+		const VirtualTextureStats &Stats = Cache.GetStats();
+		TotalRequested += Stats.RequestedPageNum;
+		TotalMissing += Stats.MissingPageNum;
+		TotalUploads += Stats.UploadNum;
+		MaxPending = std::max(MaxPending, Stats.PendingPageNum);
+	}
+
+	uint32_t FrameNum = std::max(Desc.FrameNum, 1u);
+	const VirtualTextureStats &Stats = Cache.GetStats();
+	LOG_INFO_MESSAGE("VT paging sim ", Desc.RasterSize, "x", Desc.RasterSize, ", ", Cache.GetMipNum(), " mips, ",
+		Desc.SlotNum * Desc.SlotNum, " slots, upload budget ", Desc.UploadBudget);
+	LOG_INFO_MESSAGE("VT paging sim ", FrameNum, " frames: avg requested ", double(TotalRequested) / FrameNum, ", missing ", double(TotalMissing) / FrameNum,
+		", fallback ", double(TotalFallback) / FrameNum, ", uploads ", double(TotalUploads) / FrameNum, ", evictions ", Stats.EvictionNum,
+		", max pending ", MaxPending, ", resident ", Stats.ResidentPageNum);
+}
+
+bool Diligent::RunGPUSelectionValidation(const GPUSelectionValidationDesc &Desc)
+{
+	TerrainMap Heightmap;
+	Heightmap.InitHeightMap(Desc.RasterSize, Desc.RasterSize, GenerateHeights(Desc.RasterSize));
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ 0.0f, 0.0f, 0.0f });
+	TerrainDim.Size = float3({ (Desc.RasterSize - 1) * Desc.TexelWorldSize, Desc.TerrainHeight, (Desc.RasterSize - 1) * Desc.TexelWorldSize });
+
+	CDLODTree Tree(Heightmap, TerrainDim);
+	Tree.Create();
+
+	FirstPersonCamera Cam;
+	Cam.SetProjAttribs(Desc.NearPlane, Desc.FarPlane, 16.0f / 9.0f, PI_F / 4.f, SURFACE_TRANSFORM_IDENTITY, false);
+
+	//the two paths emit in a different order
+	auto SortByNode = [](std::vector<SelectNodeData> &Nodes)
+	{
+		std::sort(Nodes.begin(), Nodes.end(), [](const SelectNodeData &a, const SelectNodeData &b) { return a.NodeIdx < b.NodeIdx; });
+	};
+
+	//the kernels themselves, when there is a device
+	const bool bRunKernels = Desc.pDevice != nullptr && Desc.pContext != nullptr;
+	CDLODPatchBatch PatchBatch;
+	CDLODGPUSelection GPUSelection;
+	CDLODGPUSelectionResult KernelResult;
+	if (bRunKernels)
+	{
+		PatchBatch.Init(Desc.pDevice, LOD_MESH_GRID_SIZE);
+		GPUSelection.Init(Desc.pDevice, Tree, PatchBatch);
+	}
+
+	CDLODSelectShaderConstants Constants;
+	std::vector<SelectNodeData> CPUNodes;
+	std::vector<SelectNodeData> GPUNodes;
+	uint32_t MismatchFrameNum = 0;
+	uint32_t KernelMismatchFrameNum = 0;
+	size_t TotalSelectNum = 0;
+	for (uint32_t i = 0; i < Desc.FrameNum; ++i)
+	{
+		PlaceCamera(Cam, TerrainDim, float(i) / Desc.FrameNum);
+		Tree.SelectLOD(Cam);
+		CPUNodes = Tree.GetSelectInfo().SelectionNodes;
+
+		if (bRunKernels)
+		{
+			PatchBatch.Update(Desc.pContext, Tree.GetSelectInfo());
+			GPUSelection.Select(Desc.pContext, Tree);
+			GPUSelection.ReadBackSync(Desc.pContext, Tree, KernelResult);
+		}
+
+		CDLODGPUSelection::FillShaderConstants(Tree, LOD_MESH_GRID_SIZE, Constants);
+		CDLODGPUSelection::EmulateSelection(Tree, Constants, GPUNodes);
+
+		SortByNode(CPUNodes);
+		SortByNode(GPUNodes);
+		TotalSelectNum += CPUNodes.size();
+
+		bool bMatch = CPUNodes.size() == GPUNodes.size();
+		for (size_t n = 0; bMatch && n < CPUNodes.size(); ++n)
+		{
+			bMatch = CPUNodes[n].NodeIdx == GPUNodes[n].NodeIdx && CPUNodes[n].LODLevel == GPUNodes[n].LODLevel &&
+				CPUNodes[n].AreaFlag.flag == GPUNodes[n].AreaFlag.flag;
+		}
+
+		if (!bMatch)
+		{
+			if (MismatchFrameNum == 0)
+			{
+				LOG_ERROR_MESSAGE("GPU selection validation: frame ", i, " selects ", GPUNodes.size(), " nodes, SelectLOD ", CPUNodes.size());
+			}
+			++MismatchFrameNum;
+		}
+
+		if (bRunKernels)
+		{
+			const std::string Mismatch = CompareGPUSelectionResult(KernelResult, CPUNodes, PatchBatch);
+			if (!Mismatch.empty())
+			{
+				if (KernelMismatchFrameNum == 0)
+				{
+					LOG_ERROR_MESSAGE("GPU selection validation: frame ", i, " read back from the kernels: ", Mismatch);
+				}
+				++KernelMismatchFrameNum;
+			}
+		}
+	}
+
+	uint32_t FrameNum = std::max(Desc.FrameNum, 1u);
+	LOG_INFO_MESSAGE("GPU selection validation ", Desc.RasterSize, "x", Desc.RasterSize, ", ", FrameNum, " frames: ", MismatchFrameNum,
+		" mismatching, avg selected nodes ", TotalSelectNum / FrameNum);
+	if (bRunKernels)
+	{
+		LOG_INFO_MESSAGE("GPU selection validation, kernel readback: ", KernelMismatchFrameNum, " of ", FrameNum, " frames mismatching");
+	}
+	else
+	{
+		LOG_WARNING_MESSAGE("GPU selection validation: no device, only the CPU emulation of the kernels was checked");
+	}
+	return MismatchFrameNum == 0 && KernelMismatchFrameNum == 0;
+}
+
+void Diligent::RunHorizonCullingBenchmark(const HorizonCullingBenchmarkDesc &Desc)
+{
+	TerrainMap Heightmap;
+	Heightmap.InitHeightMap(Desc.RasterSize, Desc.RasterSize, GenerateHeights(Desc.RasterSize));
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ 0.0f, 0.0f, 0.0f });
+	TerrainDim.Size = float3({ (Desc.RasterSize - 1) * Desc.TexelWorldSize, Desc.TerrainHeight, (Desc.RasterSize - 1) * Desc.TexelWorldSize });
+
+	CDLODTree Tree(Heightmap, TerrainDim);
+	Tree.Create();
+
+	FirstPersonCamera Cam;
+	Cam.SetProjAttribs(Desc.NearPlane, Desc.FarPlane, 16.0f / 9.0f, PI_F / 4.f, SURFACE_TRANSFORM_IDENTITY, false);
+
+	std::vector<SelectNodeData> UnculledNodes;
+
+	const char *PathNames[] = { "orbit/dive", "walk" };
+	for (int Path = 0; Path < 2; ++Path)
+	{
+		//[0]: frustum and lod range only, [1]: with the horizon
+		size_t NodeNum[2] = {};
+		uint64_t TriangleNum[2] = {};
+		double Time[2] = {};
+		HorizonRayCheckStats RayCheck;
+		for (uint32_t i = 0; i < Desc.FrameNum; ++i)
+		{
+			const float t = float(i) / Desc.FrameNum;
+			if (Path == 0)
+			{
+				PlaceCamera(Cam, TerrainDim, t);
+			}
+			else
+			{
+				PlaceWalkCamera(Cam, Heightmap, TerrainDim, Desc.WalkEyeHeight, t);
+			}
+
+			for (int Culling = 0; Culling < 2; ++Culling)
+			{
+				Tree.SetHorizonCulling(Culling != 0);
+
+				auto frame_start = std::chrono::high_resolution_clock::now();
+				Tree.SelectLOD(Cam);
+				std::chrono::duration<double, std::milli> frame_time = std::chrono::high_resolution_clock::now() - frame_start;
+
+				Time[Culling] += frame_time.count();
+				NodeNum[Culling] += Tree.GetSelectInfo().SelectionNodes.size();
+				TriangleNum[Culling] += GetSelectionTriangleNum(Tree.GetSelectInfo(), LOD_MESH_GRID_SIZE);
+
+				if (Culling == 0)
+				{
+					UnculledNodes = Tree.GetSelectInfo().SelectionNodes;
+				}
+			}
+
+			if (Desc.RayCheckFrameStep > 0 && i % Desc.RayCheckFrameStep == 0)
+			{
+				CheckHorizonCulledNodes(Heightmap, TerrainDim, Cam, UnculledNodes, Tree.GetSelectInfo().SelectionNodes, std::max(Desc.RayCheckSampleNum, 1u),
+					Desc.TexelWorldSize, RayCheck);
+			}
+		}
+
+		uint32_t FrameNum = std::max(Desc.FrameNum, 1u);
+		LOG_INFO_MESSAGE("Horizon culling ", PathNames[Path], " ", FrameNum, " frames: avg nodes ", NodeNum[0] / FrameNum, " -> ", NodeNum[1] / FrameNum,
+			", avg triangles ", TriangleNum[0] / FrameNum, " -> ", TriangleNum[1] / FrameNum,
+			", avg select ", Time[0] / FrameNum, " ms -> ", Time[1] / FrameNum, " ms");
+		if (Desc.RayCheckFrameStep > 0)
+		{
+			LOG_INFO_MESSAGE("Horizon culling ", PathNames[Path], " ray check every ", Desc.RayCheckFrameStep, " frames: ", RayCheck.NodeNum, " culled nodes, ",
+				RayCheck.SampleNum, " points in view, ", RayCheck.VisibleSampleNum, " visible in ", RayCheck.VisibleNodeNum, " nodes");
+			if (RayCheck.VisibleSampleNum > 0)
+			{
+				LOG_WARNING_MESSAGE("Horizon culling ", PathNames[Path], ": ", RayCheck.VisibleNodeNum, " culled nodes have visible surface points");
+			}
+		}
+	}
+	Tree.SetHorizonCulling(false);
+}
+
+void Diligent::RunVertexCacheBenchmark(const VertexCacheBenchmarkDesc &Desc)
+{
+	const char *OrderNames[] = { "rows", "forsyth", "tipsify" };
+	const char *CacheNames[] = { "fifo", "lru" };
+
+	for (uint32_t GridSize : Desc.GridSizes)
+	{
+		const uint32_t VertexNum = (GridSize + 1) * (GridSize + 1);
+
+		std::vector<uint32_t> Indices[3];
+		std::vector<uint32_t> VertexRemap;
+		uint QuadrantEnd[3];
+		double OptimizeTime[3] = {};
+
+		CDLODPatchBatch::BuildPatchIndices(GridSize, false, Indices[0], QuadrantEnd, VertexRemap);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		CDLODPatchBatch::BuildPatchIndices(GridSize, true, Indices[1], QuadrantEnd, VertexRemap);
+		std::chrono::duration<double, std::milli> forsyth_time = std::chrono::high_resolution_clock::now() - start;
+		OptimizeTime[1] = forsyth_time.count();
+
+		//same quadrant ranges as the patch batch, the fetch order does not change cache hits
+		const uint32_t QuadrantStart[4] = { 0, QuadrantEnd[0], QuadrantEnd[1], QuadrantEnd[2] };
+		const uint32_t QuadrantStop[4] = { QuadrantEnd[0], QuadrantEnd[1], QuadrantEnd[2], (uint32_t)Indices[0].size() };
+		Indices[2].resize(Indices[0].size());
+		for (uint32_t CacheSize : Desc.CacheSizes)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			for (int q = 0; q < 4; ++q)
+			{
+				OptimizeVertexCacheTipsify(&Indices[0][QuadrantStart[q]], QuadrantStop[q] - QuadrantStart[q], VertexNum, CacheSize, &Indices[2][QuadrantStart[q]]);
+			}
+			std::chrono::duration<double, std::milli> tipsify_time = std::chrono::high_resolution_clock::now() - start;
+			OptimizeTime[2] = tipsify_time.count();
+
+			for (int Order = 0; Order < 3; ++Order)
+			{
+				for (int CacheType = 0; CacheType < 2; ++CacheType)
+				{
+					const VERTEX_CACHE_TYPE Type = CacheType == 0 ? VERTEX_CACHE_TYPE_FIFO : VERTEX_CACHE_TYPE_LRU;
+					VertexCacheStats Full = SimulateVertexCache(Indices[Order].data(), (Uint32)Indices[Order].size(), VertexNum, CacheSize, Type);
+					VertexCacheStats Quadrant = SimulateVertexCache(Indices[Order].data(), QuadrantEnd[0], VertexNum, CacheSize, Type);
+
+					LOG_INFO_MESSAGE("Vertex cache ", GridSize, "x", GridSize, " patch, ", CacheNames[CacheType], " ", CacheSize, ", ", OrderNames[Order],
+						": full ACMR ", Full.ACMR, " ATVR ", Full.ATVR, ", quadrant ACMR ", Quadrant.ACMR, " ATVR ", Quadrant.ATVR,
+						", optimize ", OptimizeTime[Order], " ms");
+				}
+			}
+		}
+	}
+}
+
+void Diligent::RunTerrainQueryBenchmark(const TerrainQueryBenchmarkDesc &Desc)
+{
+	TerrainMap Heightmap;
+	Heightmap.InitHeightMap(Desc.RasterSize, Desc.RasterSize, GenerateHeights(Desc.RasterSize));
+
+	Dimension TerrainDim;
+	TerrainDim.Min = float3({ 0.0f, 0.0f, 0.0f });
+	TerrainDim.Size = float3({ (Desc.RasterSize - 1) * Desc.TexelWorldSize, Desc.TerrainHeight, (Desc.RasterSize - 1) * Desc.TexelWorldSize });
+
+	CDLODTree Tree(Heightmap, TerrainDim);
+	Tree.Create();
+	TerrainQuery Query(Tree);
+
+	std::mt19937 Rand(7);
+	std::uniform_real_distribution<float> RandX(TerrainDim.Min.x, TerrainDim.Min.x + TerrainDim.SizeX);
+	std::uniform_real_distribution<float> RandZ(TerrainDim.Min.z, TerrainDim.Min.z + TerrainDim.SizeZ);
+	std::vector<float2> Positions(Desc.QueryNum);
+	for (float2 &Pos : Positions)
+	{
+		Pos = float2(RandX(Rand), RandZ(Rand));
+	}
+
+	//one by one against the batch
+	std::vector<float> Heights(Desc.QueryNum);
+	std::vector<float> BatchHeights(Desc.QueryNum);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < Desc.QueryNum; ++i)
+	{
+		Heights[i] = Query.GetHeight(Positions[i]);
+	}
+	std::chrono::duration<double, std::milli> single_time = std::chrono::high_resolution_clock::now() - start;
+
+	start = std::chrono::high_resolution_clock::now();
+	Query.GetHeights(Positions.data(), Desc.QueryNum, BatchHeights.data());
+	std::chrono::duration<double, std::milli> batch_time = std::chrono::high_resolution_clock::now() - start;
+
+	float MaxError = 0.0f;
+	for (uint32_t i = 0; i < Desc.QueryNum; ++i)
+	{
+		MaxError = std::max(MaxError, std::abs(Heights[i] - BatchHeights[i]));
+	}
+
+	std::vector<float3> Normals(Desc.QueryNum);
+	start = std::chrono::high_resolution_clock::now();
+	Query.GetNormals(Positions.data(), Desc.QueryNum, Normals.data());
+	std::chrono::duration<double, std::milli> normal_time = std::chrono::high_resolution_clock::now() - start;
+
+	LOG_INFO_MESSAGE("Terrain query ", Desc.QueryNum, " heights: single ", single_time.count(), " ms, batched ", batch_time.count(),
+		" ms, max difference ", MaxError, ", normals ", normal_time.count(), " ms");
+
+	//rays from above the terrain, shallow to steep, checked with a dense march
+	std::uniform_real_distribution<float> Rand01(0.0f, 1.0f);
+	std::vector<TerrainRay> Rays(Desc.RayNum);
+	for (TerrainRay &Ray : Rays)
+	{
+		float2 Start = float2(RandX(Rand), RandZ(Rand));
+		Ray.Origin = float3(Start.x, Query.GetHeight(Start) + 2.0f + Rand01(Rand) * 200.0f, Start.y);
+		const float Yaw = Rand01(Rand) * 6.28318530718f;
+		const float Pitch = -0.02f - Rand01(Rand) * 1.5f;
+		Ray.Dir = float3(std::cos(Yaw) * std::cos(Pitch), std::sin(Pitch), std::sin(Yaw) * std::cos(Pitch));
+		Ray.MaxDist = 4000.0f;
+	}
+
+	std::vector<TerrainRayHit> Hits(Desc.RayNum);
+	start = std::chrono::high_resolution_clock::now();
+	Query.RayCast(Rays.data(), Desc.RayNum, Hits.data());
+	std::chrono::duration<double, std::milli> ray_time = std::chrono::high_resolution_clock::now() - start;
+
+	uint32_t HitNum = 0;
+	uint32_t MismatchNum = 0;
+	const uint32_t CheckNum = std::min(Desc.RayNum, 1024u);
+	const float MarchStep = Desc.TexelWorldSize * 0.05f;
+	for (uint32_t r = 0; r < Desc.RayNum; ++r)
+	{
+		HitNum += Hits[r].bHit;
+		if (r >= CheckNum)
+		{
+			continue;
+		}
+
+		const TerrainRay &Ray = Rays[r];
+		float tRef = -1.0f;
+		for (float t = 0.0f; t <= Ray.MaxDist; t += MarchStep)
+		{
+			const float3 Pos = Ray.Origin + Ray.Dir * t;
+			if (Pos.x < TerrainDim.Min.x || Pos.z < TerrainDim.Min.z || Pos.x > TerrainDim.Min.x + TerrainDim.SizeX || Pos.z > TerrainDim.Min.z + TerrainDim.SizeZ)
+			{
+				break;
+			}
+			if (Pos.y <= Query.GetHeight(float2(Pos.x, Pos.z)))
+			{
+				tRef = t;
+				break;
+			}
+		}
+
+		//the march may step over thin crests the reference catches, and the other way round
+		const bool bMatch = (tRef < 0.0f) == !Hits[r].bHit && (tRef < 0.0f || std::abs(tRef - Hits[r].Dist) <= 1.0f);
+		MismatchNum += !bMatch;
+	}
+
+	LOG_INFO_MESSAGE("Terrain query ", Desc.RayNum, " rays: ", ray_time.count(), " ms, ", HitNum, " hits, ",
+		MismatchNum, " of ", CheckNum, " differ from the dense march");
+
+	//queries from worker threads while the tree keeps selecting
+	FirstPersonCamera Cam;
+	Cam.SetProjAttribs(0.1f, 100000.0f, 16.0f / 9.0f, PI_F / 4.f, SURFACE_TRANSFORM_IDENTITY, false);
+
+	std::atomic<bool> bStop(false);
+	std::atomic<uint64_t> ThreadQueryNum(0);
+	std::atomic<uint32_t> ThreadErrorNum(0);
+	auto WorkerFunc = [&](const uint32_t Seed)
+	{
+		const uint32_t BatchSize = 4096;
+		std::vector<float> Out(BatchSize);
+		uint32_t Offset = (Seed * 7919u) % (Desc.QueryNum - BatchSize + 1);
+		while (!bStop)
+		{
+			Query.GetHeights(&Positions[Offset], BatchSize, Out.data());
+			for (uint32_t i = 0; i < BatchSize; i += 97)
+			{
+				ThreadErrorNum += Out[i] != BatchHeights[Offset + i];
+			}
+			ThreadQueryNum += BatchSize;
+			Offset = (Offset + BatchSize) % (Desc.QueryNum - BatchSize + 1);
+		}
+	};
+
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> Workers;
+	for (uint32_t t = 0; t < Desc.ThreadNum; ++t)
+	{
+		Workers.emplace_back(WorkerFunc, t);
+	}
+	for (uint32_t i = 0; i < Desc.FrameNum; ++i)
+	{
+		PlaceCamera(Cam, TerrainDim, float(i) / Desc.FrameNum);
+		Tree.SelectLOD(Cam);
+	}
+	bStop = true;
+	for (auto &Worker : Workers)
+	{
+		Worker.join();
+	}
+	std::chrono::duration<double, std::milli> thread_time = std::chrono::high_resolution_clock::now() - start;
+
+	LOG_INFO_MESSAGE("Terrain query ", Desc.ThreadNum, " threads next to ", Desc.FrameNum, " selections: ", ThreadQueryNum.load(), " heights in ",
+		thread_time.count(), " ms, ", ThreadErrorNum.load(), " wrong");
+}
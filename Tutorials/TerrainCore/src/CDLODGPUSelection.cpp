@@ -0,0 +1,598 @@
+#include "CDLODGPUSelection.h"
+#include "TerrainCoreAssets.h"
+#include "MapHelper.hpp"
+#include "ShaderMacroHelper.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Diligent
+{
+	namespace
+	{
+		//NodeState values of cdlod_select.csh, the first ones match LODNodeState
+		const uint32_t NODE_STATE_PENDING = 4;
+
+		const uint32_t SELECTED_NODE_CAPACITY = CDLOD_SELECT_MAX_BUCKET_INSTANCES;
+
+		const char *PassEntryPoints[CDLOD_SELECT_PASS_NUM] =
+		{
+			"SeedTopLevel",
+			"PrepareArgs",
+			"SelectLevel",
+			"ResolveLevel",
+			"FinishSelection"
+		};
+
+		struct CDLODSelectPassConstants
+		{
+			uint4 Pass; //x: level, y: counter slot
+		};
+
+		struct EmulatedNode
+		{
+			uint32_t x, y;
+			BoxVisibility Vis;
+		};
+
+		//same as GetNodeBox of the shader
+		BoundBox GetNodeBox(const CDLODTree &Tree, const CDLODSelectShaderConstants &Constants, const int LODLevel, const uint32_t x, const uint32_t y)
+		{
+			const CDLODLevel &Level = Tree.GetLevel(LODLevel);
+			const uint32_t Idx = y * Level.NodeNumX + x;
+			const float4 &LevelInfo = Constants.LevelInfo[LODLevel];
+
+			BoundBox Box;
+			Box.Min.x = Constants.TerrainMin.x + float(x) * LevelInfo.x;
+			Box.Min.y = float(Level.pMinZ[Idx]) * Constants.TerrainMin.w + Constants.TerrainMin.y - Constants.SelectInfo.x;
+			Box.Min.z = Constants.TerrainMin.z + float(y) * LevelInfo.y;
+			Box.Max.x = Box.Min.x + LevelInfo.x;
+			Box.Max.y = float(Level.pMaxZ[Idx]) * Constants.TerrainMin.w + Constants.TerrainMin.y + Constants.SelectInfo.x;
+			Box.Max.z = Box.Min.z + LevelInfo.y;
+			return Box;
+		}
+
+		//same as IntersectSphereSq of the shader
+		bool IntersectSphereSq(const BoundBox &Box, const float3 &Center, const float RadiusSq)
+		{
+			float dx = std::max(std::max(Box.Min.x - Center.x, 0.0f), Center.x - Box.Max.x);
+			float dy = std::max(std::max(Box.Min.y - Center.y, 0.0f), Center.y - Box.Max.y);
+			float dz = std::max(std::max(Box.Min.z - Center.z, 0.0f), Center.z - Box.Max.z);
+			return dx * dx + dy * dy + dz * dz <= RadiusSq;
+		}
+
+		//same as GetBoxVisibility of the shader
+		BoxVisibility GetBoxVisibility(const CDLODSelectShaderConstants &Constants, const BoundBox &Box)
+		{
+			const float3 Center = (Box.Min + Box.Max) * 0.5f;
+			const float3 Extent = (Box.Max - Box.Min) * 0.5f;
+
+			bool bOutside = false;
+			bool bNotInside = false;
+			for (int i = 0; i < 6; ++i)
+			{
+				const float4 &Plane = Constants.FrustumPlanes[i];
+				float Dist = Center.x * Plane.x + Center.y * Plane.y + Center.z * Plane.z + Plane.w;
+				float Radius = Extent.x * std::abs(Plane.x) + Extent.y * std::abs(Plane.y) + Extent.z * std::abs(Plane.z);
+				bOutside |= Dist < -Radius;
+				bNotInside |= Dist <= Radius;
+			}
+			return bOutside ? BoxVisibility::Invisible : (bNotInside ? BoxVisibility::Intersecting : BoxVisibility::FullyVisible);
+		}
+
+		//level << 28 | y << 14 | x of the selected node list
+		SelectNodeData DecodeSelectedNode(const CDLODTree &Tree, const uint32_t Packed)
+		{
+			const int LODLevel = int(Packed >> 28);
+			const uint32_t x = Packed & 0x3FFF;
+			const uint32_t y = (Packed >> 14) & 0x3FFF;
+			const CDLODLevel &Level = Tree.GetLevel(LODLevel);
+			return SelectNodeData({ Level.FirstNode + y * Level.NodeNumX + x, LODLevel, Tree.GetNodeBBox(LODLevel, x, y), SelectNodeAreaFlag(true) });
+		}
+
+		void SetPassVariable(IShaderResourceBinding *pSRB, const char *Name, IDeviceObject *pObject)
+		{
+			IShaderResourceVariable *pVar = pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, Name);
+			if (pVar)
+			{
+				pVar->Set(pObject);
+			}
+		}
+	}
+
+	CDLODGPUSelection::CDLODGPUSelection() :
+		mNodeNum(0),
+		mTopNodeNum(0),
+		mGridSize(0),
+		mFrame(0)
+	{
+
+	}
+
+	void CDLODGPUSelection::Init(IRenderDevice *pDevice, const CDLODTree &Tree, const CDLODPatchBatch &PatchBatch)
+	{
+		mNodeNum = Tree.GetNodeNum();
+		mTopNodeNum = Tree.GetLevel(0).NodeNumX * Tree.GetLevel(0).NodeNumY;
+		mGridSize = PatchBatch.GetGridSize();
+		mpDevice = pDevice;
+
+		CreatePSO(pDevice);
+		CreateBuffers(pDevice, Tree, PatchBatch);
+
+		LOG_INFO_MESSAGE("CDLOD GPU selection: ", mNodeNum, " nodes, ", (mNodeNum * 4 * sizeof(uint32_t) + PATCH_DRAW_BUCKET_NUM * CDLOD_SELECT_MAX_BUCKET_INSTANCES * sizeof(PerPatchShaderData)) / 1024.0f, " KB");
+	}
+
+	void CDLODGPUSelection::CreatePSO(IRenderDevice *pDevice)
+	{
+		ShaderCreateInfo ShaderCI;
+		RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+		pDevice->GetEngineFactory()->CreateDefaultShaderSourceStreamFactory(TERRAIN_CORE_SHADER_DIRS, &pShaderSourceFactory);
+		ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+		ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+		ShaderCI.UseCombinedTextureSamplers = true;
+
+		ShaderMacroHelper Macros;
+		Macros.AddShaderMacro("LOD_COUNT", LOD_COUNT);
+		Macros.AddShaderMacro("GROUP_SIZE", CDLOD_SELECT_GROUP_SIZE);
+		ShaderCI.Macros = Macros;
+
+		for (int i = 0; i < CDLOD_SELECT_PASS_NUM; ++i)
+		{
+			RefCntAutoPtr<IShader> pCS;
+			ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+			ShaderCI.EntryPoint = PassEntryPoints[i];
+			ShaderCI.Desc.Name = PassEntryPoints[i];
+			ShaderCI.FilePath = "cdlod_select.csh";
+			pDevice->CreateShader(ShaderCI, &pCS);
+
+			ComputePipelineStateCreateInfo PSOCreateInfo;
+			PipelineStateDesc &PSODesc = PSOCreateInfo.PSODesc;
+			PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+			PSODesc.Name = PassEntryPoints[i];
+			//resources never change, everything is bound once in CreateBuffers
+			PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+			PSOCreateInfo.pCS = pCS;
+			pDevice->CreateComputePipelineState(PSOCreateInfo, &mpPSO[i]);
+
+			mpPSO[i]->CreateShaderResourceBinding(&mpSRB[i], true);
+		}
+	}
+
+	void CDLODGPUSelection::CreateBuffers(IRenderDevice *pDevice, const CDLODTree &Tree, const CDLODPatchBatch &PatchBatch)
+	{
+		BufferDesc CBDesc;
+		CBDesc.Name = "CDLOD select constants";
+		CBDesc.Usage = USAGE_DYNAMIC;
+		CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+		CBDesc.uiSizeInBytes = sizeof(CDLODSelectShaderConstants);
+		pDevice->CreateBuffer(CBDesc, nullptr, &mpConstantsBuf);
+
+		CBDesc.Name = "CDLOD select pass constants";
+		CBDesc.uiSizeInBytes = sizeof(CDLODSelectPassConstants);
+		pDevice->CreateBuffer(CBDesc, nullptr, &mpPassBuf);
+
+		//flat tree, the same order as the CPU levels
+		std::vector<uint32_t> NodeBounds(mNodeNum);
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			const CDLODLevel &Level = Tree.GetLevel(i);
+			for (uint32_t n = 0; n < Level.NodeNumX * Level.NodeNumY; ++n)
+			{
+				NodeBounds[Level.FirstNode + n] = uint32_t(Level.pMinZ[n]) | (uint32_t(Level.pMaxZ[n]) << 16);
+			}
+		}
+
+		BufferDesc ListDesc;
+		ListDesc.Name = "CDLOD node bounds";
+		ListDesc.Usage = USAGE_IMMUTABLE;
+		ListDesc.BindFlags = BIND_SHADER_RESOURCE;
+		ListDesc.Mode = BUFFER_MODE_FORMATTED;
+		ListDesc.ElementByteStride = sizeof(uint32_t);
+		ListDesc.uiSizeInBytes = sizeof(uint32_t) * mNodeNum;
+
+		BufferData BoundsData;
+		BoundsData.pData = NodeBounds.data();
+		BoundsData.DataSize = ListDesc.uiSizeInBytes;
+		pDevice->CreateBuffer(ListDesc, &BoundsData, &mpNodeBoundsBuf);
+
+		ListDesc.Usage = USAGE_DEFAULT;
+		ListDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+		ListDesc.Name = "CDLOD node state";
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpNodeStateBuf);
+		ListDesc.Name = "CDLOD visit list";
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpVisitListBuf);
+		ListDesc.Name = "CDLOD pending list";
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpPendingListBuf);
+
+		ListDesc.Name = "CDLOD select counters";
+		ListDesc.uiSizeInBytes = sizeof(uint32_t) * 2 * LOD_COUNT;
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpCounterBuf);
+
+		ListDesc.Name = "CDLOD select dispatch args";
+		ListDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_INDIRECT_DRAW_ARGS;
+		ListDesc.uiSizeInBytes = sizeof(uint32_t) * 3 * 2 * LOD_COUNT;
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpDispatchArgsBuf);
+
+		ListDesc.Name = "CDLOD select draw args";
+		ListDesc.uiSizeInBytes = sizeof(uint32_t) * 5 * PATCH_DRAW_BUCKET_NUM;
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpDrawArgsBuf);
+
+		ListDesc.Name = "CDLOD selected nodes";
+		ListDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+		ListDesc.uiSizeInBytes = sizeof(uint32_t) * (1 + SELECTED_NODE_CAPACITY);
+		pDevice->CreateBuffer(ListDesc, nullptr, &mpSelectedNodesBuf);
+
+		//three float4 per instance, the layout of PerPatchShaderData
+		BufferDesc InstDesc;
+		InstDesc.Name = "CDLOD GPU patch instances";
+		InstDesc.Usage = USAGE_DEFAULT;
+		InstDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_VERTEX_BUFFER;
+		InstDesc.Mode = BUFFER_MODE_FORMATTED;
+		InstDesc.ElementByteStride = sizeof(float4);
+		InstDesc.uiSizeInBytes = sizeof(PerPatchShaderData) * PATCH_DRAW_BUCKET_NUM * CDLOD_SELECT_MAX_BUCKET_INSTANCES;
+		pDevice->CreateBuffer(InstDesc, nullptr, &mpInstanceBuf);
+
+		BufferDesc StageDesc;
+		StageDesc.Name = "CDLOD selected nodes readback";
+		StageDesc.Usage = USAGE_STAGING;
+		StageDesc.CPUAccessFlags = CPU_ACCESS_READ;
+		StageDesc.uiSizeInBytes = sizeof(uint32_t) * (1 + SELECTED_NODE_CAPACITY);
+		for (int i = 0; i < CDLOD_SELECT_READBACK_LATENCY; ++i)
+		{
+			pDevice->CreateBuffer(StageDesc, nullptr, &mpReadbackBuf[i]);
+		}
+
+		//instances start at bucket * capacity, counts are added by the kernels
+		mDrawArgsInit.assign(5 * PATCH_DRAW_BUCKET_NUM, 0);
+		for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+		{
+			uint FirstIndex, IndexNum;
+			PatchBatch.GetBucketIndexRange(i, FirstIndex, IndexNum);
+			mDrawArgsInit[i * 5 + 0] = IndexNum;
+			mDrawArgsInit[i * 5 + 2] = FirstIndex;
+			mDrawArgsInit[i * 5 + 4] = i * CDLOD_SELECT_MAX_BUCKET_INSTANCES;
+		}
+		mCounterInit.assign(2 * LOD_COUNT, 0);
+
+		auto CreateView = [](IBuffer *pBuffer, const BUFFER_VIEW_TYPE ViewType, const VALUE_TYPE ValueType, const Uint8 NumComponents)
+		{
+			RefCntAutoPtr<IBufferView> pView;
+			BufferViewDesc ViewDesc;
+			ViewDesc.ViewType = ViewType;
+			ViewDesc.Format.ValueType = ValueType;
+			ViewDesc.Format.NumComponents = NumComponents;
+			pBuffer->CreateView(ViewDesc, &pView);
+			return pView;
+		};
+
+		//the SRBs keep the views alive
+		RefCntAutoPtr<IBufferView> pBoundsSRV = CreateView(mpNodeBoundsBuf, BUFFER_VIEW_SHADER_RESOURCE, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pStateUAV = CreateView(mpNodeStateBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pVisitUAV = CreateView(mpVisitListBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pPendingUAV = CreateView(mpPendingListBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pCounterUAV = CreateView(mpCounterBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pDispatchArgsUAV = CreateView(mpDispatchArgsBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pDrawArgsUAV = CreateView(mpDrawArgsBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+		RefCntAutoPtr<IBufferView> pInstanceUAV = CreateView(mpInstanceBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_FLOAT32, 4);
+		RefCntAutoPtr<IBufferView> pSelectedUAV = CreateView(mpSelectedNodesBuf, BUFFER_VIEW_UNORDERED_ACCESS, VT_UINT32, 1);
+
+		for (int i = 0; i < CDLOD_SELECT_PASS_NUM; ++i)
+		{
+			IShaderResourceBinding *pSRB = mpSRB[i];
+			SetPassVariable(pSRB, "CDLODSelectConstants", mpConstantsBuf);
+			SetPassVariable(pSRB, "CDLODSelectPass", mpPassBuf);
+			SetPassVariable(pSRB, "g_NodeBounds", pBoundsSRV);
+			SetPassVariable(pSRB, "g_NodeState", pStateUAV);
+			SetPassVariable(pSRB, "g_VisitList", pVisitUAV);
+			SetPassVariable(pSRB, "g_PendingList", pPendingUAV);
+			SetPassVariable(pSRB, "g_Counters", pCounterUAV);
+			SetPassVariable(pSRB, "g_DispatchArgs", pDispatchArgsUAV);
+			SetPassVariable(pSRB, "g_DrawArgs", pDrawArgsUAV);
+			SetPassVariable(pSRB, "g_Instances", pInstanceUAV);
+			SetPassVariable(pSRB, "g_SelectedNodes", pSelectedUAV);
+		}
+	}
+
+	void CDLODGPUSelection::Dispatch(IDeviceContext *pContext, const CDLODSelectPass Pass, const uint Level, const uint Slot, const uint GroupNum)
+	{
+		{
+			MapHelper<CDLODSelectPassConstants> PassConstants(pContext, mpPassBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+			PassConstants->Pass = uint4(Level, Slot, 0, 0);
+		}
+		pContext->SetPipelineState(mpPSO[Pass]);
+		pContext->CommitShaderResources(mpSRB[Pass], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+		DispatchComputeAttribs attr(GroupNum, 1, 1);
+		pContext->DispatchCompute(attr);
+	}
+
+	void CDLODGPUSelection::DispatchIndirect(IDeviceContext *pContext, const CDLODSelectPass Pass, const uint Level, const uint Slot)
+	{
+		//group count of the slot, written by the PrepareArgs pass
+		Dispatch(pContext, CDLOD_SELECT_PASS_PREPARE_ARGS, Level, Slot, 1);
+
+		{
+			MapHelper<CDLODSelectPassConstants> PassConstants(pContext, mpPassBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+			PassConstants->Pass = uint4(Level, Slot, 0, 0);
+		}
+		pContext->SetPipelineState(mpPSO[Pass]);
+		pContext->CommitShaderResources(mpSRB[Pass], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+		DispatchComputeIndirectAttribs attr;
+		attr.IndirectAttribsBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+		attr.DispatchArgsByteOffset = Slot * 3 * sizeof(uint32_t);
+		pContext->DispatchComputeIndirect(attr, mpDispatchArgsBuf);
+	}
+
+	void CDLODGPUSelection::Select(IDeviceContext *pContext, const CDLODTree &Tree)
+	{
+		{
+			MapHelper<CDLODSelectShaderConstants> Constants(pContext, mpConstantsBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+			FillShaderConstants(Tree, mGridSize, *Constants);
+		}
+
+		const uint32_t SelectedNum = 0;
+		pContext->UpdateBuffer(mpCounterBuf, 0, sizeof(uint32_t) * (Uint32)mCounterInit.size(), mCounterInit.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->UpdateBuffer(mpDrawArgsBuf, 0, sizeof(uint32_t) * (Uint32)mDrawArgsInit.size(), mDrawArgsInit.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->UpdateBuffer(mpSelectedNodesBuf, 0, sizeof(uint32_t), &SelectedNum, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+		Dispatch(pContext, CDLOD_SELECT_PASS_SEED, 0, 0, (mTopNodeNum + CDLOD_SELECT_GROUP_SIZE - 1) / CDLOD_SELECT_GROUP_SIZE);
+
+		//top-down, every level appends the visible children of the next one
+		for (uint Level = 0; Level < LOD_COUNT; ++Level)
+		{
+			DispatchIndirect(pContext, CDLOD_SELECT_PASS_SELECT_LEVEL, Level, 2 * Level);
+		}
+
+		//bottom-up, the children states of a parent are final once their level is resolved
+		for (int Level = LOD_COUNT - 2; Level >= 0; --Level)
+		{
+			DispatchIndirect(pContext, CDLOD_SELECT_PASS_RESOLVE_LEVEL, Level, 2 * Level + 1);
+		}
+
+		Dispatch(pContext, CDLOD_SELECT_PASS_FINISH, 0, 0, 1);
+	}
+
+	bool CDLODGPUSelection::ReadBack(IDeviceContext *pContext, const CDLODTree &Tree, SelectionInfo &OutInfo)
+	{
+		pContext->CopyBuffer(mpSelectedNodesBuf, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+			mpReadbackBuf[mFrame % CDLOD_SELECT_READBACK_LATENCY], 0, sizeof(uint32_t) * (1 + SELECTED_NODE_CAPACITY),
+			RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		++mFrame;
+		if (mFrame < CDLOD_SELECT_READBACK_LATENCY)
+		{
+			return false;
+		}
+
+		//the next one to be written is the oldest copy
+		MapHelper<uint32_t> ReadbackData(pContext, mpReadbackBuf[mFrame % CDLOD_SELECT_READBACK_LATENCY], MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+		const uint32_t *pData = ReadbackData;
+		if (!pData)
+		{
+			return false;
+		}
+
+		//only the nodes, the patch flags stay on the GPU
+		const SelectionInfo &TreeInfo = Tree.GetSelectInfo();
+		OutInfo.RasSizeX = TreeInfo.RasSizeX;
+		OutInfo.RasSizeY = TreeInfo.RasSizeY;
+		OutInfo.TerrainDimension = TreeInfo.TerrainDimension;
+		OutInfo.SelectionNodes.clear();
+		const uint32_t SelectedNum = std::min(pData[0], SELECTED_NODE_CAPACITY);
+		for (uint32_t i = 0; i < SelectedNum; ++i)
+		{
+			OutInfo.SelectionNodes.push_back(DecodeSelectedNode(Tree, pData[1 + i]));
+		}
+		return true;
+	}
+
+	void CDLODGPUSelection::ReadBackSync(IDeviceContext *pContext, const CDLODTree &Tree, CDLODGPUSelectionResult &OutResult)
+	{
+		const Uint32 NodesSize = sizeof(uint32_t) * (1 + SELECTED_NODE_CAPACITY);
+		const Uint32 DrawArgsSize = sizeof(OutResult.DrawArgs);
+		const Uint32 InstanceSize = sizeof(PerPatchShaderData) * PATCH_DRAW_BUCKET_NUM * CDLOD_SELECT_MAX_BUCKET_INSTANCES;
+		if (!mpSyncNodesBuf)
+		{
+			BufferDesc StageDesc;
+			StageDesc.Usage = USAGE_STAGING;
+			StageDesc.CPUAccessFlags = CPU_ACCESS_READ;
+			StageDesc.Name = "CDLOD selected nodes sync readback";
+			StageDesc.uiSizeInBytes = NodesSize;
+			mpDevice->CreateBuffer(StageDesc, nullptr, &mpSyncNodesBuf);
+			StageDesc.Name = "CDLOD draw args sync readback";
+			StageDesc.uiSizeInBytes = DrawArgsSize;
+			mpDevice->CreateBuffer(StageDesc, nullptr, &mpSyncDrawArgsBuf);
+			StageDesc.Name = "CDLOD instances sync readback";
+			StageDesc.uiSizeInBytes = InstanceSize;
+			mpDevice->CreateBuffer(StageDesc, nullptr, &mpSyncInstanceBuf);
+		}
+
+		pContext->CopyBuffer(mpSelectedNodesBuf, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, mpSyncNodesBuf, 0, NodesSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyBuffer(mpDrawArgsBuf, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, mpSyncDrawArgsBuf, 0, DrawArgsSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyBuffer(mpInstanceBuf, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, mpSyncInstanceBuf, 0, InstanceSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->WaitForIdle();
+
+		{
+			MapHelper<uint32_t> NodesData(pContext, mpSyncNodesBuf, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+			const uint32_t *pData = NodesData;
+			OutResult.SelectedNum = pData[0];
+			OutResult.Nodes.clear();
+			const uint32_t SelectedNum = std::min(pData[0], SELECTED_NODE_CAPACITY);
+			for (uint32_t i = 0; i < SelectedNum; ++i)
+			{
+				OutResult.Nodes.push_back(DecodeSelectedNode(Tree, pData[1 + i]));
+			}
+		}
+
+		{
+			MapHelper<uint32_t> DrawArgsData(pContext, mpSyncDrawArgsBuf, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+			memcpy(OutResult.DrawArgs, DrawArgsData, DrawArgsSize);
+		}
+
+		//instances of a bucket start at bucket * capacity, see mDrawArgsInit
+		MapHelper<PerPatchShaderData> InstanceData(pContext, mpSyncInstanceBuf, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+		for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+		{
+			const PerPatchShaderData *pFirst = InstanceData + i * CDLOD_SELECT_MAX_BUCKET_INSTANCES;
+			const uint32_t InstanceNum = std::min(OutResult.DrawArgs[i * 5 + 1], uint32_t(CDLOD_SELECT_MAX_BUCKET_INSTANCES));
+			OutResult.Instances[i].assign(pFirst, pFirst + InstanceNum);
+		}
+	}
+
+	void CDLODGPUSelection::FillShaderConstants(const CDLODTree &Tree, const uint GridSize, CDLODSelectShaderConstants &Constants)
+	{
+		const SelectionInfo &SelectInfo = Tree.GetSelectInfo();
+		const ViewFrustum &Frustum = SelectInfo.frustum;
+		const Plane3D *Planes[] = { &Frustum.LeftPlane, &Frustum.RightPlane, &Frustum.BottomPlane, &Frustum.TopPlane, &Frustum.NearPlane, &Frustum.FarPlane };
+		for (int i = 0; i < 6; ++i)
+		{
+			Constants.FrustumPlanes[i] = float4(Planes[i]->Normal.x, Planes[i]->Normal.y, Planes[i]->Normal.z, Planes[i]->Distance);
+		}
+
+		const Dimension &TerrainDim = SelectInfo.TerrainDimension;
+		Constants.CamPos = float4(SelectInfo.CamPos.x, SelectInfo.CamPos.y, SelectInfo.CamPos.z, 0.0f);
+		Constants.TerrainMin = float4(TerrainDim.Min.x, TerrainDim.Min.y, TerrainDim.Min.z, Tree.GetHeightScale());
+		Constants.SelectInfo = float4(Tree.GetDesc().BoundsPaddingY, float(GridSize), 0.0f, 0.0f);
+		Constants.BucketInfo = uint4(CDLOD_SELECT_MAX_BUCKET_INSTANCES, SELECTED_NODE_CAPACITY, 0, 0);
+
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			const CDLODLevel &Level = Tree.GetLevel(i);
+			Constants.LevelNodes[i] = uint4(Level.NodeNumX, Level.NodeNumY, Level.FirstNode, 0);
+			Constants.LevelInfo[i] = float4(Level.NodeWorldSizeX, Level.NodeWorldSizeZ, SelectInfo.LODRange[i], 0.0f);
+
+			float MorphK[2];
+			SelectInfo.GetMorphFromLevel(i, MorphK);
+			Constants.MorphK[i] = float4(MorphK[0], MorphK[1], 0.0f, 0.0f);
+		}
+	}
+
+	void CDLODGPUSelection::EmulateSelection(const CDLODTree &Tree, const CDLODSelectShaderConstants &Constants, std::vector<SelectNodeData> &OutNodes)
+	{
+		OutNodes.clear();
+
+		std::vector<uint32_t> NodeState(Tree.GetNodeNum(), uint32_t(LODNodeState::UNDEFINED));
+		std::vector<EmulatedNode> VisitList[LOD_COUNT];
+		std::vector<EmulatedNode> PendingList[LOD_COUNT];
+
+		auto GetNodeIndex = [&](const int LODLevel, const uint32_t x, const uint32_t y)
+		{
+			return Constants.LevelNodes[LODLevel].z + y * Constants.LevelNodes[LODLevel].x + x;
+		};
+
+		auto EmitPatch = [&](const int LODLevel, const uint32_t x, const uint32_t y, const SelectNodeAreaFlag &AreaFlag)
+		{
+			if (OutNodes.size() < Constants.BucketInfo.y)
+			{
+				OutNodes.push_back(SelectNodeData({ GetNodeIndex(LODLevel, x, y), LODLevel, GetNodeBox(Tree, Constants, LODLevel, x, y), AreaFlag }));
+			}
+		};
+
+		//SeedTopLevel
+		for (uint32_t y = 0; y < Constants.LevelNodes[0].y; ++y)
+		{
+			for (uint32_t x = 0; x < Constants.LevelNodes[0].x; ++x)
+			{
+				BoxVisibility Vis = GetBoxVisibility(Constants, GetNodeBox(Tree, Constants, 0, x, y));
+				if (Vis != BoxVisibility::Invisible)
+				{
+					VisitList[0].push_back({ x, y, Vis });
+				}
+			}
+		}
+
+		const float3 CamPos = float3(Constants.CamPos.x, Constants.CamPos.y, Constants.CamPos.z);
+
+		//SelectLevel
+		for (int Level = 0; Level < LOD_COUNT; ++Level)
+		{
+			for (const EmulatedNode &Node : VisitList[Level])
+			{
+				const uint32_t NodeIdx = GetNodeIndex(Level, Node.x, Node.y);
+				BoundBox Box = GetNodeBox(Tree, Constants, Level, Node.x, Node.y);
+				float LODDistance = Constants.LevelInfo[Level].z;
+				if (!IntersectSphereSq(Box, CamPos, LODDistance * LODDistance))
+				{
+					NodeState[NodeIdx] = uint32_t(LODNodeState::OUT_OF_LOD_RANGE);
+					continue;
+				}
+
+				if (Level == LOD_COUNT - 1)
+				{
+					NodeState[NodeIdx] = uint32_t(LODNodeState::SELECTED);
+					EmitPatch(Level, Node.x, Node.y, SelectNodeAreaFlag(true));
+					continue;
+				}
+
+				float NextLODDistance = Constants.LevelInfo[Level + 1].z;
+				if (!IntersectSphereSq(Box, CamPos, NextLODDistance * NextLODDistance))
+				{
+					NodeState[NodeIdx] = uint32_t(LODNodeState::SELECTED);
+					EmitPatch(Level, Node.x, Node.y, SelectNodeAreaFlag(true));
+					continue;
+				}
+
+				NodeState[NodeIdx] = NODE_STATE_PENDING;
+				PendingList[Level].push_back({ Node.x, Node.y, BoxVisibility::Invisible });
+
+				const int ChildLevel = Level + 1;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					uint32_t cx = 2 * Node.x + (c & 1);
+					uint32_t cy = 2 * Node.y + (c >> 1);
+					if (cx < Constants.LevelNodes[ChildLevel].x && cy < Constants.LevelNodes[ChildLevel].y)
+					{
+						BoxVisibility ChildVis = BoxVisibility::FullyVisible;
+						if (Node.Vis != BoxVisibility::FullyVisible)
+						{
+							ChildVis = GetBoxVisibility(Constants, GetNodeBox(Tree, Constants, ChildLevel, cx, cy));
+						}
+
+						if (ChildVis == BoxVisibility::Invisible)
+						{
+							NodeState[GetNodeIndex(ChildLevel, cx, cy)] = uint32_t(LODNodeState::OUT_OF_FRUSTUM);
+						}
+						else
+						{
+							VisitList[ChildLevel].push_back({ cx, cy, ChildVis });
+						}
+					}
+				}
+			}
+		}
+
+		//ResolveLevel
+		for (int Level = LOD_COUNT - 2; Level >= 0; --Level)
+		{
+			const int ChildLevel = Level + 1;
+			for (const EmulatedNode &Node : PendingList[Level])
+			{
+				bool Flags[4];
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					uint32_t cx = 2 * Node.x + (c & 1);
+					uint32_t cy = 2 * Node.y + (c >> 1);
+					uint32_t ChildState = uint32_t(LODNodeState::UNDEFINED);
+					if (cx < Constants.LevelNodes[ChildLevel].x && cy < Constants.LevelNodes[ChildLevel].y)
+					{
+						ChildState = NodeState[GetNodeIndex(ChildLevel, cx, cy)];
+					}
+					Flags[c] = ChildState != uint32_t(LODNodeState::SELECTED) && ChildState != uint32_t(LODNodeState::OUT_OF_FRUSTUM);
+				}
+
+				const uint32_t NodeIdx = GetNodeIndex(Level, Node.x, Node.y);
+				if (Flags[0] | Flags[1] | Flags[2] | Flags[3])
+				{
+					NodeState[NodeIdx] = uint32_t(LODNodeState::SELECTED);
+					EmitPatch(Level, Node.x, Node.y, SelectNodeAreaFlag(Flags[0], Flags[1], Flags[2], Flags[3]));
+				}
+				else
+				{
+					NodeState[NodeIdx] = uint32_t(LODNodeState::OUT_OF_FRUSTUM);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,320 @@
+#include "CDLODPatchBatch.h"
+#include "DebugUtilities.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+Diligent::CDLODPatchBatch::CDLODPatchBatch() :
+	m_GridSize(0),
+	m_IndexNum(0),
+	m_IndexEndTL(0),
+	m_IndexEndTR(0),
+	m_IndexEndBL(0),
+	m_InstanceCapacity(0),
+	m_PatchNum(0),
+	m_TriangleNum(0)
+{
+
+}
+
+void CDLODPatchBatch::Init(IRenderDevice *pDevice, const uint GridSize)
+{
+	//16-bit indices
+	VERIFY_EXPR((GridSize + 1) * (GridSize + 1) <= 65536);
+
+	m_pDevice = pDevice;
+	m_GridSize = GridSize;
+
+	std::vector<uint32_t> Indices;
+	std::vector<uint32_t> VertexRemap;
+	uint QuadrantEnd[3];
+	BuildPatchIndices(GridSize, true, Indices, QuadrantEnd, VertexRemap);
+	m_IndexNum = (uint)Indices.size();
+	m_IndexEndTL = QuadrantEnd[0];
+	m_IndexEndTR = QuadrantEnd[1];
+	m_IndexEndBL = QuadrantEnd[2];
+
+	InitVertexBuffer(pDevice, VertexRemap);
+	InitIndicesBuffer(pDevice, Indices);
+}
+
+const LayoutElement *CDLODPatchBatch::GetLayoutElements(Uint32 &NumElements)
+{
+	// clang-format off
+	static const LayoutElement LayoutElems[] =
+	{
+		// Attribute 0 - vertex position
+		LayoutElement{0, 0, 2, VT_FLOAT32, False},
+
+		// Per-instance patch data - second buffer slot
+		LayoutElement{1, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+		LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+		LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+	};
+	// clang-format on
+
+	NumElements = _countof(LayoutElems);
+	return LayoutElems;
+}
+
+void CDLODPatchBatch::Update(IDeviceContext *pContext, const SelectionInfo &SelectInfo)
+{
+	for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+	{
+		m_Buckets[i].clear();
+	}
+
+	//morph constants only depend on the lod level
+	float MorphInfo[LOD_COUNT][2] = {};
+	if (!SelectInfo.SelectionNodes.empty())
+	{
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			SelectInfo.GetMorphFromLevel(i, MorphInfo[i]);
+		}
+	}
+
+	for (size_t i = 0; i < SelectInfo.SelectionNodes.size(); ++i)
+	{
+		const SelectNodeData &NodeData = SelectInfo.SelectionNodes[i];
+
+		int ShaderLODLevel = LOD_COUNT - NodeData.LODLevel - 1;
+		PerPatchShaderData PatchData;
+		PatchData.Scale = float4((NodeData.aabb.Max.x - NodeData.aabb.Min.x) / m_GridSize,
+			(NodeData.aabb.Max.z - NodeData.aabb.Min.z) / m_GridSize,
+			float(ShaderLODLevel), 0.0f);
+		PatchData.Offset = float4(NodeData.aabb.Min.x,
+			(NodeData.aabb.Max.y + NodeData.aabb.Min.y) / 2.0f, NodeData.aabb.Min.z, 0.0f);
+		PatchData.MorphKInfo = float4({ MorphInfo[ShaderLODLevel][0], MorphInfo[ShaderLODLevel][1], 0.0f, 0.0f });
+
+		if (NodeData.AreaFlag.flag == SelectNodeAreaFlag::FULL)
+		{
+			m_Buckets[PATCH_DRAW_FULL].push_back(PatchData);
+		}
+		else
+		{
+			if (NodeData.AreaFlag.flag & SelectNodeAreaFlag::TL_ON) m_Buckets[PATCH_DRAW_TL].push_back(PatchData);
+			if (NodeData.AreaFlag.flag & SelectNodeAreaFlag::TR_ON) m_Buckets[PATCH_DRAW_TR].push_back(PatchData);
+			if (NodeData.AreaFlag.flag & SelectNodeAreaFlag::BL_ON) m_Buckets[PATCH_DRAW_BL].push_back(PatchData);
+			if (NodeData.AreaFlag.flag & SelectNodeAreaFlag::BR_ON) m_Buckets[PATCH_DRAW_BR].push_back(PatchData);
+		}
+	}
+	m_PatchNum = (uint)SelectInfo.SelectionNodes.size();
+
+	m_TriangleNum = 0;
+	for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+	{
+		uint FirstIndex, IndexNum;
+		GetBucketIndexRange(i, FirstIndex, IndexNum);
+		m_TriangleNum += (uint)m_Buckets[i].size() * (IndexNum / 3);
+	}
+
+	m_InstanceData.clear();
+	for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+	{
+		m_InstanceData.insert(m_InstanceData.end(), m_Buckets[i].begin(), m_Buckets[i].end());
+	}
+
+	uint InstanceNum = (uint)m_InstanceData.size();
+	if (InstanceNum > m_InstanceCapacity)
+	{
+		m_InstanceCapacity = std::max(InstanceNum, m_InstanceCapacity * 2);
+
+		BufferDesc InstBuffDesc;
+		InstBuffDesc.Name = "CDLOD patch instance buffer";
+		InstBuffDesc.Usage = USAGE_DEFAULT;
+		InstBuffDesc.BindFlags = BIND_VERTEX_BUFFER;
+		InstBuffDesc.uiSizeInBytes = sizeof(PerPatchShaderData) * m_InstanceCapacity;
+		m_pInstanceBuf.Release();
+		m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_pInstanceBuf);
+	}
+
+	if (InstanceNum > 0)
+	{
+		pContext->UpdateBuffer(m_pInstanceBuf, 0, sizeof(PerPatchShaderData) * InstanceNum, &m_InstanceData[0], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	}
+}
+
+void CDLODPatchBatch::BindBuffers(IDeviceContext *pContext)
+{
+	// Bind vertex, instance and index buffers
+	Uint32   offsets[] = { 0, 0 };
+	IBuffer* pBuffs[] = { m_pVertexGPUBuffer, m_pInstanceBuf };
+	pContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+	pContext->SetIndexBuffer(m_pIndexGPUBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void CDLODPatchBatch::GetBucketIndexRange(const int Bucket, uint &FirstIndex, uint &IndexNum) const
+{
+	const uint QuadIndexNum = m_IndexNum / 4;
+	const uint BucketIndexStart[PATCH_DRAW_BUCKET_NUM] = { 0, 0, m_IndexEndTL, m_IndexEndTR, m_IndexEndBL };
+	const uint BucketIndexNum[PATCH_DRAW_BUCKET_NUM] = { m_IndexNum, QuadIndexNum, QuadIndexNum, QuadIndexNum, QuadIndexNum };
+
+	FirstIndex = BucketIndexStart[Bucket];
+	IndexNum = BucketIndexNum[Bucket];
+}
+
+uint CDLODPatchBatch::Draw(IDeviceContext *pContext)
+{
+	uint DrawNum = 0;
+	uint FirstInstance = 0;
+	for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+	{
+		uint InstanceNum = (uint)m_Buckets[i].size();
+		if (InstanceNum > 0)
+		{
+			uint FirstIndex, IndexNum;
+			GetBucketIndexRange(i, FirstIndex, IndexNum);
+			pContext->DrawIndexed(GetDrawIndex(FirstIndex, IndexNum, FirstInstance, InstanceNum));
+			++DrawNum;
+		}
+		FirstInstance += InstanceNum;
+	}
+	return DrawNum;
+}
+
+uint CDLODPatchBatch::DrawIndirect(IDeviceContext *pContext, IBuffer *pInstanceBuffer, IBuffer *pDrawArgsBuffer)
+{
+	Uint32   offsets[] = { 0, 0 };
+	IBuffer* pBuffs[] = { m_pVertexGPUBuffer, pInstanceBuffer };
+	pContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+	pContext->SetIndexBuffer(m_pIndexGPUBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+	//empty buckets are still drawn, their instance count is only known on the GPU
+	for (int i = 0; i < PATCH_DRAW_BUCKET_NUM; ++i)
+	{
+		DrawIndexedIndirectAttribs drawAttrs;
+		drawAttrs.IndexType = VT_UINT16;
+		drawAttrs.IndirectAttribsBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+		drawAttrs.IndirectDrawArgsOffset = i * 5 * sizeof(Uint32);
+		drawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
+		pContext->DrawIndexedIndirect(drawAttrs, pDrawArgsBuffer);
+	}
+	return PATCH_DRAW_BUCKET_NUM;
+}
+
+DrawIndexedAttribs CDLODPatchBatch::GetDrawIndex(const uint start, const uint num, const uint FirstInstance, const uint InstanceNum) const
+{
+	DrawIndexedAttribs drawAttrs;
+	drawAttrs.IndexType = VT_UINT16; // Index type
+	drawAttrs.FirstIndexLocation = start;
+	drawAttrs.NumIndices = num;
+	drawAttrs.FirstInstanceLocation = FirstInstance;
+	drawAttrs.NumInstances = InstanceNum;
+	// Verify the state of vertex and index buffers
+	drawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
+
+	return drawAttrs;
+}
+
+void CDLODPatchBatch::BuildPatchIndices(const uint GridSize, const bool Optimize, std::vector<uint32_t> &Indices, uint QuadrantEnd[3], std::vector<uint32_t> &VertexRemap)
+{
+	Indices.clear();
+	Indices.reserve(GridSize * GridSize * 2 * 3);
+	VertexRemap.clear();
+
+	const uint VertDim = GridSize + 1;
+	const uint halfd = VertDim / 2;
+	const uint fulld = GridSize;
+
+	auto AddQuadrant = [&](const uint StartX, const uint EndX, const uint StartY, const uint EndY)
+	{
+		const size_t QuadrantStart = Indices.size();
+		for (uint y = StartY; y < EndY; y++)
+		{
+			for (uint x = StartX; x < EndX; x++)
+			{
+				Indices.push_back(x + VertDim * (y + 1));
+				Indices.push_back((x + 1) + VertDim * y);
+				Indices.push_back(x + VertDim * y);
+
+				Indices.push_back(x + VertDim * (y + 1));
+				Indices.push_back((x + 1) + VertDim * (y + 1));
+				Indices.push_back((x + 1) + VertDim * y);
+			}
+		}
+
+		//every quadrant is drawn on its own, triangles may only move inside of it
+		if (Optimize)
+		{
+			std::vector<uint32_t> Quadrant(Indices.begin() + QuadrantStart, Indices.end());
+			OptimizeVertexCacheForsyth(Quadrant.data(), (Uint32)Quadrant.size(), VertDim * VertDim, &Indices[QuadrantStart]);
+		}
+	};
+
+	// Top left part
+	AddQuadrant(0, halfd, 0, halfd);
+	QuadrantEnd[0] = (uint)Indices.size();
+
+	// Top right part
+	AddQuadrant(halfd, fulld, 0, halfd);
+	QuadrantEnd[1] = (uint)Indices.size();
+
+	// Bottom left part
+	AddQuadrant(0, halfd, halfd, fulld);
+	QuadrantEnd[2] = (uint)Indices.size();
+
+	// Bottom right part
+	AddQuadrant(halfd, fulld, halfd, fulld);
+	VERIFY_EXPR(Indices.size() == GridSize * GridSize * 2 * 3);
+
+	if (Optimize)
+	{
+		//one vertex order for the whole mesh, the quadrants draw from the same vertex buffer
+		Uint32 VertexNum = OptimizeVertexFetch(Indices.data(), (Uint32)Indices.size(), VertDim * VertDim, VertexRemap);
+		VERIFY_EXPR(VertexNum == VertDim * VertDim);
+		(void)VertexNum;
+	}
+}
+
+void CDLODPatchBatch::InitVertexBuffer(IRenderDevice *pDevice, const std::vector<uint32_t> &VertexRemap)
+{
+	uint VertexSizeM = m_GridSize + 1;
+	std::vector<ClipMapTerrainVerticesData> Vertices(VertexSizeM * VertexSizeM);
+
+	for (uint i = 0; i < VertexSizeM; ++i)
+	{
+		for (uint j = 0; j < VertexSizeM; ++j)
+		{
+			Vertices[i * VertexSizeM + j].XZ = float2((float)j, (float)i);
+		}
+	}
+
+	if (!VertexRemap.empty())
+	{
+		RemapVertices(Vertices, VertexRemap, (Uint32)Vertices.size());
+	}
+
+	BufferDesc VertBufDesc;
+	VertBufDesc.Name = "CDLOD patch vertex buffer";
+	VertBufDesc.Usage = USAGE_IMMUTABLE;
+	VertBufDesc.BindFlags = BIND_VERTEX_BUFFER;
+	VertBufDesc.uiSizeInBytes = (Uint32)(sizeof(ClipMapTerrainVerticesData) * Vertices.size());
+
+	BufferData VBData;
+	VBData.pData = Vertices.data();
+	VBData.DataSize = VertBufDesc.uiSizeInBytes;
+	pDevice->CreateBuffer(VertBufDesc, &VBData, &m_pVertexGPUBuffer);
+}
+
+void CDLODPatchBatch::InitIndicesBuffer(IRenderDevice *pDevice, const std::vector<uint32_t> &Indices32)
+{
+	//16-bit on the GPU
+	std::vector<uint16_t> Indices(Indices32.begin(), Indices32.end());
+
+	BufferDesc IdxBufDesc;
+	IdxBufDesc.Name = "CDLOD patch index buffer";
+	IdxBufDesc.Usage = USAGE_IMMUTABLE;
+	IdxBufDesc.BindFlags = BIND_INDEX_BUFFER;
+	IdxBufDesc.uiSizeInBytes = (Uint32)(sizeof(uint16_t) * Indices.size());
+
+	BufferData IdxData;
+	IdxData.pData = Indices.data();
+	IdxData.DataSize = IdxBufDesc.uiSizeInBytes;
+	pDevice->CreateBuffer(IdxBufDesc, &IdxData, &m_pIndexGPUBuffer);
+}
+
+}
@@ -0,0 +1,599 @@
+#include "CDLODTree.h"
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include "DebugCanvas.h"
+#include "TiledHeightMap.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	include <xmmintrin.h>
+#	define CDLOD_USE_SSE 1
+#else
+#	define CDLOD_USE_SSE 0
+#endif
+
+namespace Diligent
+{
+	namespace
+	{
+		struct SelectStackEntry
+		{
+			uint32_t x, y;
+			BoxVisibility Vis;
+			BoxVisibility ChildVis[4];
+			LODNodeState ChildStates[4];
+			uint8_t NextChild;
+			bool bEvaluated;
+			bool bDescend;
+		};
+
+#if CDLOD_USE_SSE
+		//Four boxes against one plane, same test as GetBoxVisibilityAgainstPlane.
+		inline void TestPlane4(const Plane3D &Plane, const __m128 CenterX, const __m128 CenterY, const __m128 CenterZ,
+			const __m128 ExtX, const __m128 ExtY, const __m128 ExtZ, __m128 &Outside, __m128 &NotInside)
+		{
+			const __m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(CenterX, _mm_set1_ps(Plane.Normal.x)),
+				_mm_mul_ps(CenterY, _mm_set1_ps(Plane.Normal.y))),
+				_mm_add_ps(_mm_mul_ps(CenterZ, _mm_set1_ps(Plane.Normal.z)), _mm_set1_ps(Plane.Distance)));
+			const __m128 Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ExtX, _mm_set1_ps(std::abs(Plane.Normal.x))),
+				_mm_mul_ps(ExtY, _mm_set1_ps(std::abs(Plane.Normal.y)))),
+				_mm_mul_ps(ExtZ, _mm_set1_ps(std::abs(Plane.Normal.z))));
+
+			Outside = _mm_or_ps(Outside, _mm_cmplt_ps(Dist, _mm_sub_ps(_mm_setzero_ps(), Radius)));
+			NotInside = _mm_or_ps(NotInside, _mm_cmple_ps(Dist, Radius));
+		}
+#endif
+	}
+
+	Diligent::BoundBox CDLODTree::GetNodeBBox(const int LODLevel, const uint32_t x, const uint32_t y) const
+	{
+		const CDLODLevel &Level = mLevels[LODLevel];
+		const Dimension &TerrainDim = mSelectionInfo.TerrainDimension;
+		uint32_t Idx = y * Level.NodeNumX + x;
+
+		BoundBox bbox;
+		bbox.Min = float3({ TerrainDim.Min.x + x * Level.NodeWorldSizeX, ToWorldY(Level.pMinZ[Idx]) - mDesc.BoundsPaddingY, TerrainDim.Min.z + y * Level.NodeWorldSizeZ });
+		bbox.Max = float3({ bbox.Min.x + Level.NodeWorldSizeX, ToWorldY(Level.pMaxZ[Idx]) + mDesc.BoundsPaddingY, bbox.Min.z + Level.NodeWorldSizeZ });
+
+		return bbox;
+	}
+
+	Diligent::BoundBox CDLODTree::GetNodeCullBBox(const int LODLevel, const uint32_t x, const uint32_t y) const
+	{
+		BoundBox bbox = GetNodeBBox(LODLevel, x, y);
+		bbox.Min.x -= mDesc.BoundsPaddingXZ;
+		bbox.Min.z -= mDesc.BoundsPaddingXZ;
+		bbox.Max.x += mDesc.BoundsPaddingXZ;
+		bbox.Max.z += mDesc.BoundsPaddingXZ;
+		return bbox;
+	}
+
+	void CDLODTree::GetChildVisibility(const int LODLevel, const uint32_t x, const uint32_t y, const bool bFullInFrustum, BoxVisibility *pOutVis) const
+	{
+		if (bFullInFrustum)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				pOutVis[c] = BoxVisibility::FullyVisible;
+			}
+			return;
+		}
+
+		//missing children get the bounds of an existing one, the caller skips them anyway
+		const CDLODLevel &ChildLevel = mLevels[LODLevel + 1];
+		const Dimension &TerrainDim = mSelectionInfo.TerrainDimension;
+
+		alignas(16) float CenterX[4], CenterY[4], CenterZ[4], ExtY[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			uint32_t cx = std::min(2 * x + (c & 1), ChildLevel.NodeNumX - 1);
+			uint32_t cy = std::min(2 * y + (c >> 1), ChildLevel.NodeNumY - 1);
+			uint32_t Idx = cy * ChildLevel.NodeNumX + cx;
+
+			CenterX[c] = TerrainDim.Min.x + (cx + 0.5f) * ChildLevel.NodeWorldSizeX;
+			CenterZ[c] = TerrainDim.Min.z + (cy + 0.5f) * ChildLevel.NodeWorldSizeZ;
+			float MinY = ToWorldY(ChildLevel.pMinZ[Idx]);
+			float MaxY = ToWorldY(ChildLevel.pMaxZ[Idx]);
+			CenterY[c] = (MinY + MaxY) * 0.5f;
+			ExtY[c] = (MaxY - MinY) * 0.5f + mDesc.BoundsPaddingY;
+		}
+
+		const ViewFrustum &Frustum = mSelectionInfo.frustum;
+		const Plane3D *Planes[] = { &Frustum.LeftPlane, &Frustum.RightPlane, &Frustum.BottomPlane, &Frustum.TopPlane, &Frustum.NearPlane, &Frustum.FarPlane };
+
+#if CDLOD_USE_SSE
+		const __m128 vCenterX = _mm_load_ps(CenterX);
+		const __m128 vCenterY = _mm_load_ps(CenterY);
+		const __m128 vCenterZ = _mm_load_ps(CenterZ);
+		const __m128 vExtX = _mm_set1_ps(ChildLevel.NodeWorldSizeX * 0.5f + mDesc.BoundsPaddingXZ);
+		const __m128 vExtY = _mm_load_ps(ExtY);
+		const __m128 vExtZ = _mm_set1_ps(ChildLevel.NodeWorldSizeZ * 0.5f + mDesc.BoundsPaddingXZ);
+
+		__m128 Outside = _mm_setzero_ps();
+		__m128 NotInside = _mm_setzero_ps();
+		for (const Plane3D *pPlane : Planes)
+		{
+			TestPlane4(*pPlane, vCenterX, vCenterY, vCenterZ, vExtX, vExtY, vExtZ, Outside, NotInside);
+		}
+
+		int OutsideMask = _mm_movemask_ps(Outside);
+		int NotInsideMask = _mm_movemask_ps(NotInside);
+		for (int c = 0; c < 4; ++c)
+		{
+			if (OutsideMask & (1 << c))
+			{
+				pOutVis[c] = BoxVisibility::Invisible;
+			}
+			else
+			{
+				pOutVis[c] = (NotInsideMask & (1 << c)) ? BoxVisibility::Intersecting : BoxVisibility::FullyVisible;
+			}
+		}
+#else
+		for (int c = 0; c < 4; ++c)
+		{
+			float3 Ext = float3({ ChildLevel.NodeWorldSizeX * 0.5f + mDesc.BoundsPaddingXZ, ExtY[c], ChildLevel.NodeWorldSizeZ * 0.5f + mDesc.BoundsPaddingXZ });
+			float3 Center = float3({ CenterX[c], CenterY[c], CenterZ[c] });
+
+			bool bOutside = false;
+			bool bNotInside = false;
+			for (const Plane3D *pPlane : Planes)
+			{
+				float Dist = dot(Center, pPlane->Normal) + pPlane->Distance;
+				float Radius = Ext.x * std::abs(pPlane->Normal.x) + Ext.y * std::abs(pPlane->Normal.y) + Ext.z * std::abs(pPlane->Normal.z);
+				bOutside |= Dist < -Radius;
+				bNotInside |= Dist <= Radius;
+			}
+			pOutVis[c] = bOutside ? BoxVisibility::Invisible : (bNotInside ? BoxVisibility::Intersecting : BoxVisibility::FullyVisible);
+		}
+#endif
+	}
+
+	LODNodeState CDLODTree::SelectNode(const uint32_t x, const uint32_t y, const BoxVisibility Vis)
+	{
+		//stack depth is the lod level of the entry
+		SelectStackEntry Stack[LOD_COUNT];
+		int Top = -1;
+		LODNodeState Result = LODNodeState::UNDEFINED;
+
+		auto Push = [&](const uint32_t NodeX, const uint32_t NodeY, const BoxVisibility NodeVis)
+		{
+			SelectStackEntry &Entry = Stack[++Top];
+			Entry.x = NodeX;
+			Entry.y = NodeY;
+			Entry.Vis = NodeVis;
+			Entry.NextChild = 0;
+			Entry.bEvaluated = false;
+			Entry.bDescend = false;
+			for (int c = 0; c < 4; ++c)
+			{
+				Entry.ChildStates[c] = LODNodeState::UNDEFINED;
+			}
+		};
+
+		auto Pop = [&](const LODNodeState State)
+		{
+			--Top;
+			if (Top >= 0)
+			{
+				SelectStackEntry &Parent = Stack[Top];
+				Parent.ChildStates[Parent.NextChild - 1] = State;
+			}
+			else
+			{
+				Result = State;
+			}
+		};
+
+		Push(x, y, Vis);
+		while (Top >= 0)
+		{
+			SelectStackEntry &Entry = Stack[Top];
+			const int LODLevel = Top;
+			const CDLODLevel &Level = mLevels[LODLevel];
+
+			if (!Entry.bEvaluated)
+			{
+				Entry.bEvaluated = true;
+
+				//LOD distance
+				BoundBox bbox = GetNodeBBox(LODLevel, Entry.x, Entry.y);
+				float LODDistance = mSelectionInfo.LODRange[LODLevel];
+				if (!bbox.IntersectSphereSq(mSelectionInfo.CamPos, LODDistance * LODDistance))
+				{
+					Pop(LODNodeState::OUT_OF_LOD_RANGE);
+					continue;
+				}
+
+				if (LODLevel == LOD_COUNT - 1)
+				{
+					//Leaf
+					uint32_t NodeIdx = Level.FirstNode + Entry.y * Level.NodeNumX + Entry.x;
+					mSelectionInfo.SelectionNodes.push_back(SelectNodeData({ NodeIdx, LODLevel, bbox, SelectNodeAreaFlag(true) }));
+					Pop(LODNodeState::SELECTED);
+					continue;
+				}
+
+				float NextLODDistance = mSelectionInfo.LODRange[LODLevel + 1];
+				if (bbox.IntersectSphereSq(mSelectionInfo.CamPos, NextLODDistance * NextLODDistance))
+				{
+					Entry.bDescend = true;
+					GetChildVisibility(LODLevel, Entry.x, Entry.y, Entry.Vis == BoxVisibility::FullyVisible, Entry.ChildVis);
+				}
+			}
+
+			//Child Visible
+			if (Entry.bDescend && Entry.NextChild < 4)
+			{
+				const CDLODLevel &ChildLevel = mLevels[LODLevel + 1];
+				int c = Entry.NextChild++;
+				uint32_t cx = 2 * Entry.x + (c & 1);
+				uint32_t cy = 2 * Entry.y + (c >> 1);
+				if (cx < ChildLevel.NodeNumX && cy < ChildLevel.NodeNumY)
+				{
+					if (Entry.ChildVis[c] == BoxVisibility::Invisible)
+					{
+						Entry.ChildStates[c] = LODNodeState::OUT_OF_FRUSTUM;
+					}
+					else
+					{
+						Push(cx, cy, Entry.ChildVis[c]);
+					}
+				}
+				continue;
+			}
+
+			//the node covers the quadrants its children did not draw
+			bool Flags[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				Flags[c] = Entry.ChildStates[c] != LODNodeState::SELECTED && Entry.ChildStates[c] != LODNodeState::OUT_OF_FRUSTUM;
+			}
+
+			if (Flags[0] | Flags[1] | Flags[2] | Flags[3])
+			{
+				uint32_t NodeIdx = Level.FirstNode + Entry.y * Level.NodeNumX + Entry.x;
+				BoundBox bbox = GetNodeBBox(LODLevel, Entry.x, Entry.y);
+				mSelectionInfo.SelectionNodes.push_back(SelectNodeData({ NodeIdx, LODLevel, bbox, SelectNodeAreaFlag(Flags[0], Flags[1], Flags[2], Flags[3]) }));
+				Pop(LODNodeState::SELECTED);
+			}
+			else
+			{
+				Pop(LODNodeState::OUT_OF_FRUSTUM);
+			}
+		}
+
+		return Result;
+	}
+
+	CDLODTree::CDLODTree(const TerrainMap &heightmap, const Dimension &TerrainDim, const CDLODTreeDesc &Desc) :
+		mHeightMap(heightmap),
+		mDesc(Desc),
+		mNodeNum(0),
+		mHeightScale(0.0f),
+		mOccludedNodeNum(0),
+		mLODRangeFOV(0.0f),
+		mViewportHeight(1080),
+		mbLODRangeDirty(true)
+	{
+		mSelectionInfo.RasSizeX = heightmap.width;
+		mSelectionInfo.RasSizeY = heightmap.height;
+		mSelectionInfo.TerrainDimension = TerrainDim;
+	}
+
+	CDLODTree::~CDLODTree()
+	{
+
+	}
+
+
+	void CDLODTree::Create()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		uint32_t RasterW = mHeightMap.width;
+		uint32_t RasterH = mHeightMap.height;
+
+		//node bounds come from the min/max pyramid, cached next to the heightmap,
+		//streamed maps carry it in the tiled file since the full raster is never loaded
+		bool bFromCache = false;
+		if (mDesc.BoundsPolicy == CDLODBoundsPolicy::FULL_RANGE || mHeightMap.IsFlat())
+		{
+			const uint16_t MaxZ = mDesc.BoundsPolicy == CDLODBoundsPolicy::FULL_RANGE ? MAX_HEIGHTMAP_SIZE : 0;
+			mPyramid.BuildUniform(RasterW, RasterH, LEAF_RENDER_NODE_SIZE, LOD_COUNT, 0, MaxZ);
+		}
+		else if (mHeightMap.IsStreamed())
+		{
+			mPyramid = mHeightMap.GetStreamer()->GetPyramid();
+			bFromCache = true;
+		}
+		else
+		{
+			const std::string &HeightMapName = mHeightMap.GetHeightMapName();
+			std::string CacheName = HeightMapName.empty() ? std::string() : HeightMapName + ".minmax";
+			uint64_t Key = HeightMinMaxPyramid::ComputeKey(mHeightMap, LEAF_RENDER_NODE_SIZE, LOD_COUNT);
+			bFromCache = !CacheName.empty() && mPyramid.LoadCache(CacheName, Key);
+			if (!bFromCache)
+			{
+				mPyramid.Build(mHeightMap, LEAF_RENDER_NODE_SIZE, LOD_COUNT);
+				if (!CacheName.empty())
+				{
+					mPyramid.SaveCache(CacheName, Key);
+				}
+			}
+		}
+
+		const Dimension &TerrainDim = mSelectionInfo.TerrainDimension;
+		const float TexelWorldSizeX = TerrainDim.SizeX / (RasterW - 1);
+		const float TexelWorldSizeZ = TerrainDim.SizeZ / (RasterH - 1);
+		mHeightScale = TerrainDim.SizeY / MAX_HEIGHTMAP_SIZE;
+
+		uint32_t TotalNodeCount = 0;
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			CDLODLevel &Level = mLevels[i];
+			const HeightMinMaxPyramid::Mip &LevelMip = mPyramid.GetMip(LOD_COUNT - 1 - i);
+			Level.NodeSize = LEAF_RENDER_NODE_SIZE << (LOD_COUNT - 1 - i);
+			Level.NodeNumX = LevelMip.NumX;
+			Level.NodeNumY = LevelMip.NumY;
+			Level.FirstNode = TotalNodeCount;
+			Level.NodeWorldSizeX = Level.NodeSize * TexelWorldSizeX;
+			Level.NodeWorldSizeZ = Level.NodeSize * TexelWorldSizeZ;
+			Level.pMinZ = LevelMip.Min.data();
+			Level.pMaxZ = LevelMip.Max.data();
+
+			TotalNodeCount += Level.NodeNumX * Level.NodeNumY;
+		}
+		mNodeNum = TotalNodeCount;
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		LOG_INFO_MESSAGE("CDLOD Tree Memory: ", sizeof(uint16_t) * 2 * TotalNodeCount / 1024.0f, " KB, ", TotalNodeCount, " nodes, created in ",
+			elapsed.count(), " ms", bFromCache ? " (cached pyramid)" : "");
+	}
+	
+
+	void CDLODTree::SelectLOD(const FirstPersonCamera &cam)
+	{
+		gDebugCanvas.ClearAABB();
+
+		UpdateSelectionParams(cam);
+
+		const CDLODLevel &TopLevel = mLevels[0];
+		for (uint32_t y = 0; y < TopLevel.NodeNumY; ++y)
+		{
+			for (uint32_t x = 0; x < TopLevel.NodeNumX; ++x)
+			{
+				BoundBox bbox = GetNodeCullBBox(0, x, y);
+
+				BoxVisibility vis = GetBoxVisibility(mSelectionInfo.frustum, bbox);
+				if (vis != BoxVisibility::Invisible)
+				{
+					SelectNode(x, y, vis);
+				}
+			}
+		}
+
+		mOccludedNodeNum = 0;
+		if (mDesc.HorizonCulling)
+		{
+			CullOccludedNodes();
+		}
+
+		//Add debug aabb
+		for (int i = 0; i < mSelectionInfo.SelectionNodes.size(); ++i)
+		{
+			gDebugCanvas.AddDebugBox(mSelectionInfo.SelectionNodes[i].aabb);
+		}
+	}
+	void CDLODTree::CullOccludedNodes()
+	{
+		struct CullEntry
+		{
+			float MinDist;
+			float MaxDist;
+			uint32_t NodeIdx; //in SelectionNodes
+		};
+
+		std::vector<SelectNodeData> &Nodes = mSelectionInfo.SelectionNodes;
+		mHorizon.Reset(mSelectionInfo.CamPos, mDesc.HorizonBinNum);
+
+		std::vector<CullEntry> Order(Nodes.size());
+		for (uint32_t i = 0; i < Nodes.size(); ++i)
+		{
+			//nodes under the camera get a zero distance, they are never culled nor occlude
+			Order[i].NodeIdx = i;
+			mHorizon.GetDistanceRange(Nodes[i].aabb, Order[i].MinDist, Order[i].MaxDist);
+		}
+		std::sort(Order.begin(), Order.end(), [](const CullEntry &a, const CullEntry &b) { return a.MinDist < b.MinDist; });
+
+		//visible nodes wait here until nothing closer than their far end is left to test
+		auto FartherEnd = [](const CullEntry &a, const CullEntry &b) { return a.MaxDist > b.MaxDist; };
+		std::priority_queue<CullEntry, std::vector<CullEntry>, decltype(FartherEnd)> Pending(FartherEnd);
+
+		std::vector<bool> Occluded(Nodes.size(), false);
+		for (const CullEntry &Entry : Order)
+		{
+			while (!Pending.empty() && Pending.top().MaxDist <= Entry.MinDist)
+			{
+				const BoundBox &OccluderBox = Nodes[Pending.top().NodeIdx].aabb;
+				mHorizon.AddOccluder(OccluderBox, OccluderBox.Min.y);
+				Pending.pop();
+			}
+
+			if (Entry.MinDist > 0.0f && mHorizon.IsOccluded(Nodes[Entry.NodeIdx].aabb))
+			{
+				Occluded[Entry.NodeIdx] = true;
+				++mOccludedNodeNum;
+			}
+			else if (Entry.MinDist > 0.0f)
+			{
+				Pending.push(Entry);
+			}
+		}
+
+		//keep the traversal order of the rest
+		uint32_t Count = 0;
+		for (uint32_t i = 0; i < Nodes.size(); ++i)
+		{
+			if (!Occluded[i])
+			{
+				Nodes[Count++] = Nodes[i];
+			}
+		}
+		Nodes.resize(Count);
+	}
+
+	void CDLODTree::UpdateSelectionParams(const FirstPersonCamera &cam)
+	{
+		UpdateLODRangeAndMorph(cam);
+
+		ExtractViewFrustumPlanesFromMatrix(cam.GetViewProjMatrix(), mSelectionInfo.frustum, false);
+	}
+
+	const Diligent::SelectionInfo & CDLODTree::GetSelectInfo() const
+	{
+		return mSelectionInfo;
+	}
+
+	void CDLODTree::UpdateLODRangeAndMorph(const FirstPersonCamera &cam)
+	{
+		mSelectionInfo.SelectionNodes.clear();
+		mSelectionInfo.CamPos = cam.GetPos();
+
+		//Update LOD distance range
+		const float FOV = cam.GetProjAttribs().FOV;
+		const bool bScreenSpaceError = mDesc.MaxScreenSpaceError > 0.0f;
+		if (mbLODRangeDirty ||
+			mSelectionInfo.near != cam.GetProjAttribs().NearClipPlane ||
+			mSelectionInfo.far != cam.GetProjAttribs().FarClipPlane ||
+			(bScreenSpaceError && mLODRangeFOV != FOV))
+		{
+			mbLODRangeDirty = false;
+			mLODRangeFOV = FOV;
+			mSelectionInfo.near = cam.GetProjAttribs().NearClipPlane;
+			mSelectionInfo.far = cam.GetProjAttribs().FarClipPlane;
+
+			mSelectionInfo.LODRange.resize(LOD_COUNT);
+			mSelectionInfo.MorphStart.resize(LOD_COUNT);
+			mSelectionInfo.MorphEnd.resize(LOD_COUNT);
+			std::vector<float> &LODRange = mSelectionInfo.LODRange;
+			std::vector<float> &MorphStart = mSelectionInfo.MorphStart;
+			std::vector<float> &MorphEnd = mSelectionInfo.MorphEnd;
+
+			if (bScreenSpaceError)
+			{
+				SplitLODRangeByScreenSpaceError(FOV);
+			}
+			else
+			{
+				SplitLODRangeByDistance();
+			}
+
+			float PrevPos = mSelectionInfo.near;
+			for (int i = 0; i < LOD_COUNT; ++i)
+			{
+				int index = LOD_COUNT - i - 1;
+				MorphEnd[i] = LODRange[index];
+				MorphStart[i] = PrevPos + (MorphEnd[i] - PrevPos) * MORPH_START_RATIO;
+				PrevPos = MorphStart[i];
+			}
+		}
+	}
+
+	void CDLODTree::SplitLODRangeByDistance()
+	{
+		std::vector<float> &LODRange = mSelectionInfo.LODRange;
+
+		//update LOD range
+		float total = 0.0f;
+		float distance = 1.0f;
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			total += distance;
+			distance *= LOD_DISTANCE_RATIO;
+		}
+
+		float CamViewDistance = mSelectionInfo.far - mSelectionInfo.near;
+		float SectUnit = CamViewDistance / total;
+
+		float PrevPos = mSelectionInfo.near;
+		distance = 1.0f;
+		for (int i = 0; i < LOD_COUNT; ++i)
+		{
+			int index = LOD_COUNT - i - 1; //reverse
+			LODRange[index] = PrevPos + SectUnit * distance;
+			PrevPos = LODRange[index];
+			distance *= LOD_DISTANCE_RATIO;
+		}
+	}
+
+	void CDLODTree::SplitLODRangeByScreenSpaceError(const float FOV)
+	{
+		std::vector<float> &LODRange = mSelectionInfo.LODRange;
+
+		//a grid cell of size s at distance d covers s * PixelsPerRadian / d pixels, a level is used
+		//from where its cells drop below the error, that is where its parent level stops
+		const float PixelsPerRadian = mViewportHeight * 0.5f / std::tan(FOV * 0.5f);
+		const float DistancePerCellSize = PixelsPerRadian / mDesc.MaxScreenSpaceError;
+		const uint32_t GridSize = std::max(mDesc.PatchGridSize, 1u);
+
+		float PrevRange = 0.0f;
+		for (int i = LOD_COUNT - 1; i >= 0; --i)
+		{
+			const CDLODLevel &Level = mLevels[i];
+			const float NodeSize = std::max(Level.NodeWorldSizeX, Level.NodeWorldSizeZ);
+			const float ParentCellSize = NodeSize * 2.0f / GridSize;
+
+			//the morph to the parent has to finish inside the range, it needs more than the
+			//diagonal of the parent beyond the range of the children
+			float Range = std::max(ParentCellSize * DistancePerCellSize, NodeSize * 3.0f);
+			Range = std::max(Range, PrevRange * LOD_DISTANCE_RATIO);
+			Range = std::max(Range, mSelectionInfo.near * 2.0f);
+			LODRange[i] = Range;
+			PrevRange = Range;
+		}
+
+		//the top level reaches the far plane whatever its error, nothing is left undrawn
+		LODRange[0] = std::max(LODRange[0], mSelectionInfo.far);
+	}
+
+	void CDLODTree::SetBoundsPadding(const float PaddingY, const float PaddingXZ)
+	{
+		mDesc.BoundsPaddingY = PaddingY;
+		mDesc.BoundsPaddingXZ = PaddingXZ;
+	}
+
+	void CDLODTree::SetViewportHeight(const uint32_t Height)
+	{
+		if (mViewportHeight != Height)
+		{
+			mViewportHeight = std::max(Height, 1u);
+			mbLODRangeDirty = true;
+		}
+	}
+
+	void CDLODTree::SetMaxScreenSpaceError(const float MaxError)
+	{
+		if (mDesc.MaxScreenSpaceError != MaxError)
+		{
+			mDesc.MaxScreenSpaceError = MaxError;
+			mbLODRangeDirty = true;
+		}
+	}
+
+	void SelectionInfo::GetMorphFromLevel(const int level, float *pOut) const
+	{
+		float start = MorphStart[level];
+		float end = MorphEnd[level];
+
+		const float ErrorFudge = 0.01f;
+		end = lerp(end, start, ErrorFudge);
+
+		float dis = end - start;
+		pOut[0] = end / dis;
+		pOut[1] = 1.0f / dis;
+	}
+
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 namespace Diligent
 {
+	DebugCanvas gDebugCanvas;
 
 	DebugCanvas::DebugCanvas() : 
 		mbInitGPUBuffer(false)
@@ -0,0 +1,411 @@
+#include "GroundMesh.h"
+#include "FirstPersonCamera.hpp"
+#include "MapHelper.hpp"
+#include "TerrainMap.h"
+#include "TerrainCoreAssets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Diligent
+{
+
+static void SetVirtualTextureVars(IShaderResourceBinding *pSRB, const SHADER_TYPE ShaderType, const char *PageTableName, const char *AtlasName, const TerrainVirtualTexture &VT)
+{
+	IShaderResourceVariable *pPageTableVar = pSRB->GetVariableByName(ShaderType, PageTableName);
+	if (pPageTableVar)
+	{
+		pPageTableVar->Set(VT.GetPageTableSRV());
+	}
+	IShaderResourceVariable *pAtlasVar = pSRB->GetVariableByName(ShaderType, AtlasName);
+	if (pAtlasVar)
+	{
+		pAtlasVar->Set(VT.GetAtlasSRV());
+	}
+}
+
+Diligent::GroundMesh::GroundMesh(const uint SizeM, const uint Level, const float ClipScale) :
+	m_sizem(SizeM),
+	m_level(Level),
+	m_clip_scale(ClipScale),
+	mpCDLODTree(nullptr),
+	m_RenderCPUTime(0.0),
+	m_RenderDrawNum(0),
+	m_RenderPatchNum(0),
+	m_bGPUSelection(false),
+	m_bHorizonCulling(false),
+	mpGPUSelection(nullptr)
+{
+	
+}
+
+Diligent::GroundMesh::~GroundMesh()
+{
+	if (mpCDLODTree)
+	{
+		delete mpCDLODTree;
+		mpCDLODTree = nullptr;
+	}
+
+	if (mpGPUSelection)
+	{
+		delete mpGPUSelection;
+		mpGPUSelection = nullptr;
+	}
+}
+
+//void Diligent::GroundMesh::UpdateLevelOffset(const float2& CamPosXZ)
+//{
+//	m_LevelOffsets.resize(m_level);
+//	for (int i = 0; i < m_LevelOffsets.size(); ++i)
+//	{
+//		m_LevelOffsets[i] = GetOffsetLevel(CamPosXZ, i);
+//	}
+//}
+
+void Diligent::GroundMesh::Render(IDeviceContext *pContext, const float3 &CamPos)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (mpGPUSelection)
+	{
+		mpGPUSelection->Select(pContext, *mpCDLODTree);
+		if (mpGPUSelection->ReadBack(pContext, *mpCDLODTree, m_GPUSelectInfo))
+		{
+			m_RenderPatchNum = (uint)m_GPUSelectInfo.SelectionNodes.size();
+		}
+	}
+	else
+	{
+		m_PatchBatch.Update(pContext, mpCDLODTree->GetSelectInfo());
+		m_RenderPatchNum = m_PatchBatch.GetPatchNum();
+	}
+
+	//pages loaded since the last frame, within the upload budget
+	m_HeightVT.Update(pContext);
+	m_DiffuseVT.Update(pContext);
+
+	m_RenderDrawNum = 0;
+	if (!mpGPUSelection && m_PatchBatch.GetInstanceNum() == 0)
+	{
+		m_RenderCPUTime = 0.0;
+		return;
+	}
+
+	//the GPU selection draws its own instances
+	auto DrawPatches = [&]()
+	{
+		if (mpGPUSelection)
+		{
+			return m_PatchBatch.DrawIndirect(pContext, mpGPUSelection->GetInstanceBuffer(), mpGPUSelection->GetDrawArgsBuffer());
+		}
+		m_PatchBatch.BindBuffers(pContext);
+		return m_PatchBatch.Draw(pContext);
+	};
+
+	// Set uniform
+	{
+		// Map the buffer and write current world-view-projection matrix
+		MapHelper<GPUConstBuffer> CBConstants(pContext, m_pVsConstBuf, MAP_WRITE, MAP_FLAG_DISCARD);
+		CBConstants->ViewProj = m_TerrainViewProjMat;
+		CBConstants->CameraPos = CamPos;
+	}
+
+	//feedback pass, the requests are read back a few frames later
+	m_Feedback.Begin(pContext);
+	pContext->SetPipelineState(m_pFeedbackPSO);
+	pContext->CommitShaderResources(m_pFeedbackSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	m_RenderDrawNum += DrawPatches();
+	m_Feedback.End(pContext, m_PageKeys);
+	if (!m_PageKeys.empty())
+	{
+		m_DiffuseVT.RequestPages(m_PageKeys);
+	}
+
+	ITextureView *pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
+	ITextureView *pDSV = m_pSwapChain->GetDepthBufferDSV();
+	pContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+	// Set the pipeline state in the immediate context
+	pContext->SetPipelineState(m_pPSO);
+
+	// Commit shader resources. RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode
+	// makes sure that resources are transitioned to required states.
+	pContext->CommitShaderResources(m_pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	m_RenderDrawNum += DrawPatches();
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	m_RenderCPUTime = elapsed.count();
+}
+
+void GroundMesh::InitClipMap(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension &TerrainDim)
+{	
+	m_pDevice = pDevice;
+	m_pSwapChain = pSwapChain;
+
+	//only the CPU heights, both maps reach the GPU through the virtual textures
+	m_Heightmap.LoadMap("", "./wm_heightmap.png", nullptr);
+
+	CDLODTreeDesc TreeDesc;
+	TreeDesc.HorizonCulling = m_bHorizonCulling;
+	mpCDLODTree = new CDLODTree(m_Heightmap, TerrainDim, TreeDesc);
+	mpCDLODTree->Create();
+
+	InitVirtualTextures(pDevice, pSwapChain);
+
+	m_PatchBatch.Init(pDevice, m_sizem);
+	InitPSO(pDevice, pSwapChain, TerrainDim);
+
+	if (m_bGPUSelection)
+	{
+		mpGPUSelection = new CDLODGPUSelection();
+		mpGPUSelection->Init(pDevice, *mpCDLODTree, m_PatchBatch);
+	}
+
+	//init shader value
+	SetVirtualTextureVars(m_pSRB, SHADER_TYPE_VERTEX, "g_HeightPageTable", "g_HeightAtlas", m_HeightVT);
+	SetVirtualTextureVars(m_pSRB, SHADER_TYPE_PIXEL, "g_DiffusePageTable", "g_DiffuseAtlas", m_DiffuseVT);
+	SetVirtualTextureVars(m_pFeedbackSRB, SHADER_TYPE_VERTEX, "g_HeightPageTable", "g_HeightAtlas", m_HeightVT);
+}
+
+void GroundMesh::InitVirtualTextures(IRenderDevice *pDevice, ISwapChain *pSwapChain)
+{
+	VirtualTextureDesc HeightDesc;
+	CreateHeightPageLoader(m_Heightmap, HeightDesc);
+	m_HeightVT.Init(pDevice, HeightDesc, TEX_FORMAT_R16_UNORM, "Terrain height");
+
+	VirtualTextureDesc DiffuseDesc;
+	if (CreateImagePageLoader("./wm_diffuse_map.png", DiffuseDesc))
+	{
+		m_DiffuseVT.Init(pDevice, DiffuseDesc, TEX_FORMAT_RGBA8_UNORM_SRGB, "Terrain diffuse");
+	}
+
+	const SwapChainDesc &SCDesc = pSwapChain->GetDesc();
+	m_Feedback.Init(pDevice, SCDesc.Width / VT_FEEDBACK_DOWNSCALE, SCDesc.Height / VT_FEEDBACK_DOWNSCALE);
+}
+
+void GroundMesh::Update(const FirstPersonCamera *pCam)
+{
+	//const float3 &pos = pCam->GetPos();
+	//UpdateLevelOffset(float2(pos.x, pos.z));
+	//UpdateLevelOffset(float2(0.0f, 0.0f));
+
+	m_TerrainViewProjMat = pCam->GetViewProjMatrix();
+
+	if (m_Heightmap.IsStreamed())
+	{
+		const Dimension &TerrainDim = mpCDLODTree->GetSelectInfo().TerrainDimension;
+		const float3 &CamPos = pCam->GetPos();
+		m_Heightmap.UpdateStreaming(float2((CamPos.x - TerrainDim.Min.x) / TerrainDim.SizeX, (CamPos.z - TerrainDim.Min.z) / TerrainDim.SizeZ));
+	}
+
+	//the GPU path only needs the camera params, its nodes come back a few frames later
+	if (mpGPUSelection)
+	{
+		mpCDLODTree->UpdateSelectionParams(*pCam);
+	}
+	else
+	{
+		mpCDLODTree->SelectLOD(*pCam);
+	}
+
+	CollectSelectionPageKeys(mpGPUSelection ? m_GPUSelectInfo : mpCDLODTree->GetSelectInfo(), m_HeightVT.GetCache(), m_PageKeys);
+	m_HeightVT.RequestPages(m_PageKeys);
+}
+
+void GroundMesh::InitPSO(IRenderDevice *pDevice, ISwapChain *pSwapChain, const Dimension& dim)
+{	
+	// Pipeline state object encompasses configuration of all GPU stages
+
+	GraphicsPipelineStateCreateInfo PSOCreateInfo;
+
+	PipelineStateDesc& PSODesc = PSOCreateInfo.PSODesc;
+	PipelineResourceLayoutDesc& ResourceLayout = PSODesc.ResourceLayout;
+
+	// Pipeline state name is used by the engine to report issues.
+	// It is always a good idea to give objects descriptive names.
+	PSOCreateInfo.PSODesc.Name = "Simple triangle PSO";
+
+	// This is a graphics pipeline
+	PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+	// clang-format off
+	// This tutorial will render to a single render target
+	PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
+	// Set render target format which is the format of the swap chain's color buffer
+	PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = pSwapChain->GetDesc().ColorBufferFormat;
+	// Use the depth buffer format from the swap chain
+	PSOCreateInfo.GraphicsPipeline.DSVFormat = pSwapChain->GetDesc().DepthBufferFormat;
+	// Primitive topology defines what kind of primitives will be rendered by this pipeline state
+	PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// Wireframe
+	//PSOCreateInfo.GraphicsPipeline.RasterizerDesc.FillMode = FILL_MODE_WIREFRAME;
+	PSOCreateInfo.GraphicsPipeline.RasterizerDesc.FillMode = FILL_MODE_SOLID;
+
+	// No back face culling for this tutorial
+	PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_BACK;
+	// Disable depth testing
+	PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
+
+	// Define vertex shader input layout, the patch grid and the per instance data
+	// clang-format on
+	PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = CDLODPatchBatch::GetLayoutElements(PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements);
+
+	// clang-format on
+
+	ShaderCreateInfo ShaderCI;
+	RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+	pDevice->GetEngineFactory()->CreateDefaultShaderSourceStreamFactory(TERRAIN_CORE_SHADER_DIRS, &pShaderSourceFactory);
+	ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+	// Tell the system that the shader source code is in HLSL.
+	// For OpenGL, the engine will convert this into GLSL under the hood.
+	ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+	// OpenGL backend requires emulated combined HLSL texture samplers (g_Texture + g_Texture_sampler combination)
+	ShaderCI.UseCombinedTextureSamplers = true;
+	// Create a vertex shader
+	RefCntAutoPtr<IShader> pVS;
+	{
+		ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+		ShaderCI.EntryPoint = "main";
+		ShaderCI.Desc.Name = "ClipMap Terrain vertex shader";
+		//ShaderCI.Source          = VSSource;
+		ShaderCI.FilePath = "clipmap.vsh";
+		pDevice->CreateShader(ShaderCI, &pVS);
+
+		//Create dynamic const buffer		
+		BufferDesc CBDesc;
+		CBDesc.Name = "ClipMap VS Constants CB";
+		CBDesc.uiSizeInBytes = sizeof(GPUConstBuffer);
+		CBDesc.Usage = USAGE_DYNAMIC;
+		CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+		pDevice->CreateBuffer(CBDesc, nullptr, &m_pVsConstBuf);
+
+		struct GPUDIM
+		{
+			float4 Min;
+			float4 Size;
+		};
+		GPUDIM gdim;
+		gdim.Min = dim.Min;
+		gdim.Size = dim.Size;
+
+		BufferDesc TerrainDesc;
+		TerrainDesc.Name = "ClipMap VS Terrain info CB";
+		TerrainDesc.uiSizeInBytes = sizeof(GPUDIM);
+		TerrainDesc.Usage = USAGE_IMMUTABLE;
+		TerrainDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		BufferData TerrainInitData;
+		TerrainInitData.pData = &gdim;
+		TerrainInitData.DataSize = TerrainDesc.uiSizeInBytes;
+		pDevice->CreateBuffer(TerrainDesc, &TerrainInitData, &m_pVSTerrainInfoBuf);
+
+		//heights are read at uv * (size - 1), the feedback target is VT_FEEDBACK_DOWNSCALE times smaller
+		const float FeedbackMipBias = -std::log2(float(VT_FEEDBACK_DOWNSCALE));
+		const VirtualTextureDesc &DiffuseDesc = m_DiffuseVT.GetCache().GetDesc();
+		VirtualTextureShaderAttribs VTInfo[2];
+		VTInfo[0] = m_HeightVT.GetShaderAttribs(float2(float(m_Heightmap.width - 1), float(m_Heightmap.height - 1)), 0.0f);
+		VTInfo[1] = m_DiffuseVT.GetShaderAttribs(float2(float(DiffuseDesc.Width), float(DiffuseDesc.Height)), FeedbackMipBias);
+
+		BufferDesc VTInfoDesc;
+		VTInfoDesc.Name = "Terrain virtual texture info CB";
+		VTInfoDesc.uiSizeInBytes = sizeof(VTInfo);
+		VTInfoDesc.Usage = USAGE_IMMUTABLE;
+		VTInfoDesc.BindFlags = BIND_UNIFORM_BUFFER;
+		BufferData VTInitData;
+		VTInitData.pData = VTInfo;
+		VTInitData.DataSize = VTInfoDesc.uiSizeInBytes;
+		pDevice->CreateBuffer(VTInfoDesc, &VTInitData, &m_pVTInfoBuf);
+	}
+
+	// Create a pixel shader
+	RefCntAutoPtr<IShader> pPS;
+	{
+		ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+		ShaderCI.EntryPoint = "main";
+		ShaderCI.Desc.Name = "ClipMap Terrain pixel shader";
+		//ShaderCI.Source          = PSSource;
+		ShaderCI.FilePath = "clipmap.psh";
+		pDevice->CreateShader(ShaderCI, &pPS);
+	}
+
+	// Shader variables should typically be mutable, which means they are expected
+	// to change on a per-instance basis
+	// clang-format off
+	ShaderResourceVariableDesc Vars[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_HeightPageTable", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_VERTEX, "g_HeightAtlas", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_DiffusePageTable", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+		{SHADER_TYPE_PIXEL, "g_DiffuseAtlas", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+	};
+	// clang-format on
+	ResourceLayout.Variables = Vars;
+	ResourceLayout.NumVariables = _countof(Vars);
+
+	// Define immutable sampler for g_Texture. Immutable samplers should be used whenever possible
+	// clang-format off
+	SamplerDesc SamLinearClampDesc
+	{
+		FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+		TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP
+	};
+	SamplerDesc SamAnisoClampDesc
+	{
+		FILTER_TYPE_ANISOTROPIC, FILTER_TYPE_ANISOTROPIC, FILTER_TYPE_ANISOTROPIC,
+		TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP
+	};
+	ImmutableSamplerDesc ImtblSamplers[] =
+	{
+		{SHADER_TYPE_VERTEX, "g_HeightAtlas", SamLinearClampDesc},
+		{SHADER_TYPE_PIXEL, "g_DiffuseAtlas", SamAnisoClampDesc}
+	};
+	// clang-format on
+	ResourceLayout.ImmutableSamplers = ImtblSamplers;
+	ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+	// Finally, create the pipeline state
+	PSOCreateInfo.pVS = pVS;
+	PSOCreateInfo.pPS = pPS;
+	pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
+
+	// Since we did not explcitly specify the type for 'Constants' variable, default
+	// type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
+	// change and are bound directly through the pipeline state object.
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_pVsConstBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "TerrainDimension")->Set(m_pVSTerrainInfoBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "VirtualTextureInfo")->Set(m_pVTInfoBuf);
+	m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "VirtualTextureInfo")->Set(m_pVTInfoBuf);
+
+	// Create a shader resource binding object and bind all static resources in it
+	m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
+
+	//feedback pipeline, only the vertex stage reads textures
+	RefCntAutoPtr<IShader> pFeedbackPS;
+	{
+		ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+		ShaderCI.EntryPoint = "main";
+		ShaderCI.Desc.Name = "ClipMap Terrain VT feedback pixel shader";
+		ShaderCI.FilePath = "clipmap_feedback.psh";
+		pDevice->CreateShader(ShaderCI, &pFeedbackPS);
+	}
+
+	PSOCreateInfo.PSODesc.Name = "Terrain VT feedback PSO";
+	PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = VirtualTextureFeedback::ColorFormat;
+	PSOCreateInfo.GraphicsPipeline.DSVFormat = VirtualTextureFeedback::DepthFormat;
+	ResourceLayout.NumVariables = 2;
+	ResourceLayout.NumImmutableSamplers = 1;
+	PSOCreateInfo.pPS = pFeedbackPS;
+	pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pFeedbackPSO);
+
+	m_pFeedbackPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_pVsConstBuf);
+	m_pFeedbackPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "TerrainDimension")->Set(m_pVSTerrainInfoBuf);
+	m_pFeedbackPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "VirtualTextureInfo")->Set(m_pVTInfoBuf);
+	m_pFeedbackPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "VirtualTextureInfo")->Set(m_pVTInfoBuf);
+	m_pFeedbackPSO->CreateShaderResourceBinding(&m_pFeedbackSRB, true);
+
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "HeightPyramid.h"
+#include "TerrainMap.h"
+#include "CDLODTree.h"
+#include "Errors.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define HEIGHT_PYRAMID_USE_SSE2 1
+#else
+#	define HEIGHT_PYRAMID_USE_SSE2 0
+#endif
+
+namespace
+{
+	//bump when the layout changes, old cache files are then rebuilt
+	const uint32_t PYRAMID_CACHE_MAGIC = 0x4D4D4850; //"PHMM"
+	const uint32_t PYRAMID_CACHE_VERSION = 2;
+
+	struct PyramidCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+	};
+
+	//Column wise min/max of Count heights over several rows
+	void ReduceRows(const uint16_t *const *ppRows, const uint32_t RowNum, const uint32_t Count, uint16_t *pMin, uint16_t *pMax)
+	{
+		uint32_t i = 0;
+#if HEIGHT_PYRAMID_USE_SSE2
+		//SSE2 only has signed 16-bit min/max, flipping the sign bit keeps the unsigned order
+		const __m128i Bias = _mm_set1_epi16(-0x8000);
+		for (; i + 8 <= Count; i += 8)
+		{
+			__m128i vMin = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ppRows[0] + i)), Bias);
+			__m128i vMax = vMin;
+			for (uint32_t r = 1; r < RowNum; ++r)
+			{
+				__m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ppRows[r] + i)), Bias);
+				vMin = _mm_min_epi16(vMin, v);
+				vMax = _mm_max_epi16(vMax, v);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pMin + i), _mm_xor_si128(vMin, Bias));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pMax + i), _mm_xor_si128(vMax, Bias));
+		}
+#endif
+		for (; i < Count; ++i)
+		{
+			uint16_t MinData = ppRows[0][i];
+			uint16_t MaxData = MinData;
+			for (uint32_t r = 1; r < RowNum; ++r)
+			{
+				MinData = std::min(MinData, ppRows[r][i]);
+				MaxData = std::max(MaxData, ppRows[r][i]);
+			}
+			pMin[i] = MinData;
+			pMax[i] = MaxData;
+		}
+	}
+}
+
+void Diligent::HeightMinMaxPyramid::BuildUniform(const uint32_t Width, const uint32_t Height, const uint32_t LeafSize, const uint32_t MipNum, const uint16_t MinZ, const uint16_t MaxZ)
+{
+	mLeafSize = LeafSize;
+	mMips.clear();
+	mMips.resize(MipNum);
+	if (Width == 0 || Height == 0)
+	{
+		return;
+	}
+
+	for (uint32_t m = 0; m < MipNum; ++m)
+	{
+		Mip &CurrMip = mMips[m];
+		uint32_t BlockSize = LeafSize << m;
+		CurrMip.NumX = (Width - 1) / BlockSize + 1;
+		CurrMip.NumY = (Height - 1) / BlockSize + 1;
+		CurrMip.Min.assign(CurrMip.NumX * CurrMip.NumY, MinZ);
+		CurrMip.Max.assign(CurrMip.NumX * CurrMip.NumY, MaxZ);
+	}
+}
+
+void Diligent::HeightMinMaxPyramid::Build(const TerrainMap &Heightmap, const uint32_t LeafSize, const uint32_t MipNum, uint32_t ThreadNum)
+{
+	mLeafSize = LeafSize;
+	mMips.clear();
+	mMips.resize(MipNum);
+	if (MipNum == 0 || Heightmap.width == 0 || Heightmap.height == 0)
+	{
+		return;
+	}
+
+	for (uint32_t m = 0; m < MipNum; ++m)
+	{
+		Mip &CurrMip = mMips[m];
+		uint32_t BlockSize = LeafSize << m;
+		CurrMip.NumX = (Heightmap.width - 1) / BlockSize + 1;
+		CurrMip.NumY = (Heightmap.height - 1) / BlockSize + 1;
+		CurrMip.Min.resize(CurrMip.NumX * CurrMip.NumY);
+		CurrMip.Max.resize(CurrMip.NumX * CurrMip.NumY);
+	}
+
+	//top blocks own disjoint parts of every mip, so they are built independently
+	const Mip &TopMip = mMips[MipNum - 1];
+	const uint32_t TopBlockNum = TopMip.NumX * TopMip.NumY;
+
+	if (ThreadNum == 0)
+	{
+		ThreadNum = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	ThreadNum = std::min(ThreadNum, TopBlockNum);
+
+	std::atomic<uint32_t> NextBlock(0);
+	auto WorkerFunc = [&]()
+	{
+		std::vector<uint16_t> RowMin;
+		std::vector<uint16_t> RowMax;
+		for (uint32_t Block = NextBlock++; Block < TopBlockNum; Block = NextBlock++)
+		{
+			BuildTopBlock(Heightmap, Block % TopMip.NumX, Block / TopMip.NumX, RowMin, RowMax);
+		}
+	};
+
+	std::vector<std::thread> Workers;
+	for (uint32_t t = 1; t < ThreadNum; ++t)
+	{
+		Workers.emplace_back(WorkerFunc);
+	}
+	WorkerFunc();
+	for (auto &Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+void Diligent::HeightMinMaxPyramid::BuildTopBlock(const TerrainMap &Heightmap, const uint32_t TopX, const uint32_t TopY, std::vector<uint16_t> &RowMin, std::vector<uint16_t> &RowMax)
+{
+	const uint32_t MipNum = static_cast<uint32_t>(mMips.size());
+	const uint32_t Width = Heightmap.width;
+	const uint32_t Height = Heightmap.height;
+	const uint16_t *pHeightData = Heightmap.GetHeightData();
+
+	//leaf range of the block
+	Mip &LeafMip = mMips[0];
+	const uint32_t LeafBegX = TopX << (MipNum - 1);
+	const uint32_t LeafBegY = TopY << (MipNum - 1);
+	const uint32_t LeafEndX = std::min(LeafBegX + (1u << (MipNum - 1)), LeafMip.NumX);
+	const uint32_t LeafEndY = std::min(LeafBegY + (1u << (MipNum - 1)), LeafMip.NumY);
+
+	//texel columns of the block, the last leaf may hang over the border
+	const uint32_t TexBegX = LeafBegX * mLeafSize;
+	const uint32_t TexEndX = std::min(LeafEndX * mLeafSize, Width);
+	RowMin.resize(TexEndX - TexBegX);
+	RowMax.resize(TexEndX - TexBegX);
+
+	std::vector<const uint16_t*> Rows(mLeafSize);
+	for (uint32_t ly = LeafBegY; ly < LeafEndY; ++ly)
+	{
+		for (uint32_t r = 0; r < mLeafSize; ++r)
+		{
+			uint32_t y = std::min(ly * mLeafSize + r, Height - 1);
+			Rows[r] = pHeightData + size_t(y) * Width + TexBegX;
+		}
+		ReduceRows(&Rows[0], mLeafSize, TexEndX - TexBegX, &RowMin[0], &RowMax[0]);
+
+		for (uint32_t lx = LeafBegX; lx < LeafEndX; ++lx)
+		{
+			uint32_t Beg = lx * mLeafSize - TexBegX;
+			uint32_t End = std::min(Beg + mLeafSize, TexEndX - TexBegX);
+			uint32_t Idx = ly * LeafMip.NumX + lx;
+			LeafMip.Min[Idx] = *std::min_element(RowMin.begin() + Beg, RowMin.begin() + End);
+			LeafMip.Max[Idx] = *std::max_element(RowMax.begin() + Beg, RowMax.begin() + End);
+		}
+	}
+
+	//coarser mips inside the block, a block bounds its existing children
+	for (uint32_t m = 1; m < MipNum; ++m)
+	{
+		const Mip &ChildMip = mMips[m - 1];
+		Mip &CurrMip = mMips[m];
+		const uint32_t Shift = MipNum - 1 - m;
+		const uint32_t BegX = TopX << Shift;
+		const uint32_t BegY = TopY << Shift;
+		const uint32_t EndX = std::min(BegX + (1u << Shift), CurrMip.NumX);
+		const uint32_t EndY = std::min(BegY + (1u << Shift), CurrMip.NumY);
+		for (uint32_t y = BegY; y < EndY; ++y)
+		{
+			for (uint32_t x = BegX; x < EndX; ++x)
+			{
+				uint32_t ChildIdx = 2 * y * ChildMip.NumX + 2 * x;
+				uint16_t MinData = ChildMip.Min[ChildIdx];
+				uint16_t MaxData = ChildMip.Max[ChildIdx];
+				for (uint32_t c = 1; c < 4; ++c)
+				{
+					uint32_t cx = 2 * x + (c & 1);
+					uint32_t cy = 2 * y + (c >> 1);
+					if (cx < ChildMip.NumX && cy < ChildMip.NumY)
+					{
+						ChildIdx = cy * ChildMip.NumX + cx;
+						MinData = std::min(MinData, ChildMip.Min[ChildIdx]);
+						MaxData = std::max(MaxData, ChildMip.Max[ChildIdx]);
+					}
+				}
+
+				uint32_t Idx = y * CurrMip.NumX + x;
+				CurrMip.Min[Idx] = MinData;
+				CurrMip.Max[Idx] = MaxData;
+			}
+		}
+	}
+}
+
+uint64_t Diligent::HeightMinMaxPyramid::ComputeKey(const TerrainMap &Heightmap, const uint32_t LeafSize, const uint32_t MipNum)
+{
+	//FNV-1a over 64-bit words, the whole map has to be read anyway
+	const uint64_t Prime = 1099511628211ull;
+	uint64_t Hash = 14695981039346656037ull;
+	auto Mix = [&](const uint64_t Value)
+	{
+		Hash = (Hash ^ Value) * Prime;
+	};
+
+	Mix(Heightmap.width);
+	Mix(Heightmap.height);
+	Mix(LeafSize);
+	Mix(MipNum);
+
+	const uint16_t *pHeightData = Heightmap.GetHeightData();
+	const size_t Size = size_t(Heightmap.width) * Heightmap.height;
+	size_t i = 0;
+	for (; i + 4 <= Size; i += 4)
+	{
+		uint64_t Word;
+		memcpy(&Word, pHeightData + i, sizeof(Word));
+		Mix(Word);
+	}
+	for (; i < Size; ++i)
+	{
+		Mix(pHeightData[i]);
+	}
+
+	return Hash;
+}
+
+bool Diligent::HeightMinMaxPyramid::LoadCache(const std::string &FileName, const uint64_t Key)
+{
+	std::ifstream rf(FileName, std::ios::in | std::ios::binary);
+	if (!rf)
+	{
+		return false;
+	}
+
+	PyramidCacheHeader Header;
+	rf.read((char*)&Header, sizeof(PyramidCacheHeader));
+	if (!rf ||
+		Header.Magic != PYRAMID_CACHE_MAGIC ||
+		Header.Version != PYRAMID_CACHE_VERSION ||
+		Header.Key != Key)
+	{
+		return false;
+	}
+
+	return Read(rf);
+}
+
+void Diligent::HeightMinMaxPyramid::SaveCache(const std::string &FileName, const uint64_t Key) const
+{
+	std::ofstream wf(FileName, std::ios::out | std::ios::binary);
+	if (!wf)
+	{
+		LOG_WARNING_MESSAGE("Failed to write height pyramid cache ", FileName);
+		return;
+	}
+
+	PyramidCacheHeader Header;
+	Header.Magic = PYRAMID_CACHE_MAGIC;
+	Header.Version = PYRAMID_CACHE_VERSION;
+	Header.Key = Key;
+
+	wf.write((const char*)&Header, sizeof(PyramidCacheHeader));
+	Write(wf);
+}
+
+bool Diligent::HeightMinMaxPyramid::Read(std::istream &rs)
+{
+	uint32_t LeafSize = 0;
+	uint32_t MipNum = 0;
+	rs.read((char*)&LeafSize, sizeof(uint32_t));
+	rs.read((char*)&MipNum, sizeof(uint32_t));
+	if (!rs || MipNum > 32)
+	{
+		return false;
+	}
+
+	std::vector<Mip> Mips(MipNum);
+	for (Mip &CurrMip : Mips)
+	{
+		rs.read((char*)&CurrMip.NumX, sizeof(uint32_t));
+		rs.read((char*)&CurrMip.NumY, sizeof(uint32_t));
+		if (!rs)
+		{
+			return false;
+		}
+
+		CurrMip.Min.resize(CurrMip.NumX * CurrMip.NumY);
+		CurrMip.Max.resize(CurrMip.NumX * CurrMip.NumY);
+		if (!CurrMip.Min.empty())
+		{
+			rs.read((char*)&CurrMip.Min[0], sizeof(uint16_t) * CurrMip.Min.size());
+			rs.read((char*)&CurrMip.Max[0], sizeof(uint16_t) * CurrMip.Max.size());
+		}
+	}
+	if (!rs)
+	{
+		return false;
+	}
+
+	mLeafSize = LeafSize;
+	mMips.swap(Mips);
+	return true;
+}
+
+void Diligent::HeightMinMaxPyramid::Write(std::ostream &ws) const
+{
+	uint32_t MipNum = static_cast<uint32_t>(mMips.size());
+	ws.write((const char*)&mLeafSize, sizeof(uint32_t));
+	ws.write((const char*)&MipNum, sizeof(uint32_t));
+	for (const Mip &CurrMip : mMips)
+	{
+		ws.write((const char*)&CurrMip.NumX, sizeof(uint32_t));
+		ws.write((const char*)&CurrMip.NumY, sizeof(uint32_t));
+		if (!CurrMip.Min.empty())
+		{
+			ws.write((const char*)&CurrMip.Min[0], sizeof(uint16_t) * CurrMip.Min.size());
+			ws.write((const char*)&CurrMip.Max[0], sizeof(uint16_t) * CurrMip.Max.size());
+		}
+	}
+}
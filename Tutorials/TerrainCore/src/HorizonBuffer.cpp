@@ -0,0 +1,124 @@
+#include "HorizonBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Diligent
+{
+	namespace
+	{
+		const float TWO_PI = 6.28318530718f;
+
+		//into (-pi, pi]
+		float WrapAngle(float Angle)
+		{
+			while (Angle > PI_F)
+			{
+				Angle -= TWO_PI;
+			}
+			while (Angle <= -PI_F)
+			{
+				Angle += TWO_PI;
+			}
+			return Angle;
+		}
+	}
+
+	void HorizonBuffer::Reset(const float3 &CamPos, const uint32_t BinNum)
+	{
+		mCamPos = CamPos;
+		mHorizon.assign(BinNum, std::numeric_limits<float>::lowest());
+	}
+
+	bool HorizonBuffer::GetDistanceRange(const BoundBox &Box, float &MinDist, float &MaxDist) const
+	{
+		float dx = std::max(std::max(Box.Min.x - mCamPos.x, 0.0f), mCamPos.x - Box.Max.x);
+		float dz = std::max(std::max(Box.Min.z - mCamPos.z, 0.0f), mCamPos.z - Box.Max.z);
+		MinDist = std::sqrt(dx * dx + dz * dz);
+
+		float fx = std::max(std::abs(Box.Min.x - mCamPos.x), std::abs(Box.Max.x - mCamPos.x));
+		float fz = std::max(std::abs(Box.Min.z - mCamPos.z), std::abs(Box.Max.z - mCamPos.z));
+		MaxDist = std::sqrt(fx * fx + fz * fz);
+
+		return MinDist > 0.0f;
+	}
+
+	void HorizonBuffer::GetBinRange(const BoundBox &Box, float &FirstBin, float &LastBin) const
+	{
+		//the footprint spans less than half a turn seen from outside, corners are measured from its center
+		const float CenterAngle = std::atan2((Box.Min.z + Box.Max.z) * 0.5f - mCamPos.z, (Box.Min.x + Box.Max.x) * 0.5f - mCamPos.x);
+		const float CornerX[] = { Box.Min.x, Box.Max.x, Box.Min.x, Box.Max.x };
+		const float CornerZ[] = { Box.Min.z, Box.Min.z, Box.Max.z, Box.Max.z };
+
+		float MinDelta = 0.0f;
+		float MaxDelta = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			float Delta = WrapAngle(std::atan2(CornerZ[i] - mCamPos.z, CornerX[i] - mCamPos.x) - CenterAngle);
+			MinDelta = std::min(MinDelta, Delta);
+			MaxDelta = std::max(MaxDelta, Delta);
+		}
+
+		const float BinPerRadian = mHorizon.size() / TWO_PI;
+		float First = (CenterAngle + MinDelta) * BinPerRadian;
+		if (First < 0.0f)
+		{
+			First += float(mHorizon.size());
+		}
+		FirstBin = First;
+		LastBin = First + (MaxDelta - MinDelta) * BinPerRadian;
+	}
+
+	bool HorizonBuffer::IsOccluded(const BoundBox &Box) const
+	{
+		float MinDist, MaxDist;
+		if (mHorizon.empty() || !GetDistanceRange(Box, MinDist, MaxDist))
+		{
+			return false;
+		}
+
+		//steepest the box can be seen at
+		const float Rise = Box.Max.y - mCamPos.y;
+		const float Slope = Rise / (Rise > 0.0f ? MinDist : MaxDist);
+
+		float FirstBin, LastBin;
+		GetBinRange(Box, FirstBin, LastBin);
+
+		const uint32_t BinNum = static_cast<uint32_t>(mHorizon.size());
+		const uint32_t End = static_cast<uint32_t>(LastBin);
+		for (uint32_t b = static_cast<uint32_t>(FirstBin); b <= End; ++b)
+		{
+			if (Slope >= mHorizon[b % BinNum])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void HorizonBuffer::AddOccluder(const BoundBox &Box, const float OccluderY)
+	{
+		float MinDist, MaxDist;
+		if (mHorizon.empty() || !GetDistanceRange(Box, MinDist, MaxDist))
+		{
+			return;
+		}
+
+		//every ray of an inner bin crosses the footprint somewhere in [MinDist, MaxDist]
+		const float Rise = OccluderY - mCamPos.y;
+		const float Slope = Rise / (Rise >= 0.0f ? MaxDist : MinDist);
+
+		float FirstBin, LastBin;
+		GetBinRange(Box, FirstBin, LastBin);
+
+		const uint32_t BinNum = static_cast<uint32_t>(mHorizon.size());
+		const uint32_t Begin = static_cast<uint32_t>(std::ceil(FirstBin));
+		const uint32_t End = static_cast<uint32_t>(std::floor(LastBin));
+		for (uint32_t b = Begin; b < End; ++b)
+		{
+			float &Horizon = mHorizon[b % BinNum];
+			Horizon = std::max(Horizon, Slope);
+		}
+	}
+}
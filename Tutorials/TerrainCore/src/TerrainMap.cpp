@@ -0,0 +1,216 @@
+#include "TerrainMap.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "TextureLoader.h"
+#include "TextureUtilities.h"
+#include "RenderDevice.h"
+#include "Image.h"
+#include "Errors.hpp"
+
+#include "CDLODTree.h"
+#include "TiledHeightMap.h"
+
+namespace Diligent
+{
+
+	TerrainMap::TerrainMap() :
+		width(0),
+		height(0)
+	{
+
+	}
+
+
+	TerrainMap::~TerrainMap()
+	{
+
+	}
+
+	void TerrainMap::LoadMap(const std::string &DiffuseMapName, const std::string &HightMapName, IRenderDevice *device)
+	{
+		if (!DiffuseMapName.empty())
+		{
+			LoadDiffuseMap(DiffuseMapName, device);
+		}
+		LoadHeightMap(HightMapName, device);
+	}
+
+	void TerrainMap::InitHeightMap(const uint32_t Width, const uint32_t Height, std::vector<uint16_t> &&Heights)
+	{
+		assert(Heights.size() == size_t(Width) * Height);
+
+		m_pHeightMemData = std::make_shared<std::vector<uint16_t>>(std::move(Heights));
+		m_pStreamer.reset();
+		width = Width;
+		height = Height;
+	}
+
+	void TerrainMap::InitFlat(const uint32_t Width, const uint32_t Height)
+	{
+		m_pHeightMemData.reset();
+		m_pStreamer.reset();
+		m_HeightMapName.clear();
+		width = Width;
+		height = Height;
+	}
+
+	bool TerrainMap::OpenTiledHeightMap(const std::string &FileName)
+	{
+		auto pStreamer = std::make_shared<TiledHeightMapStreamer>();
+		if (!pStreamer->Open(FileName))
+		{
+			LOG_ERROR_MESSAGE("Failed to open tiled heightmap ", FileName);
+			return false;
+		}
+
+		m_pStreamer = pStreamer;
+		m_pHeightMemData.reset();
+		m_HeightMapName = FileName;
+		width = m_pStreamer->GetWidth();
+		height = m_pStreamer->GetHeight();
+		return true;
+	}
+
+	void TerrainMap::UpdateStreaming(const float2 &FocusUV, const float FullDetailRadius)
+	{
+		if (m_pStreamer)
+		{
+			m_pStreamer->SetFocus(float2(FocusUV.x * (width - 1), FocusUV.y * (height - 1)), FullDetailRadius);
+		}
+	}
+
+	const uint16_t *TerrainMap::GetHeightData() const
+	{
+		return m_pHeightMemData ? m_pHeightMemData->data() : nullptr;
+	}
+
+	ITexture* TerrainMap::GetHeightMapTexture()
+	{
+		return m_apHeightTex;
+	}
+
+	ITexture* TerrainMap::GetDiffuseMapTexture()
+	{
+		return m_apDiffTex;
+	}
+
+	void TerrainMap::LoadHeightMap(const std::string &FileName, IRenderDevice *device)
+	{
+		if (device)
+		{
+			TextureLoadInfo loadInfo;
+			loadInfo.IsSRGB = false;
+			CreateTextureFromFile(FileName.c_str(), loadInfo, device, &m_apHeightTex);
+		}
+		
+		//the decoded image is only needed until the heights are converted
+		RefCntAutoPtr<Image> apHeightImage;
+		CreateImageFromFile(FileName.c_str(), &apHeightImage);
+		m_HeightMapName = FileName;
+		m_pStreamer.reset();
+
+		const ImageDesc &Desc = apHeightImage->GetDesc();
+		width = Desc.Width;
+		height = Desc.Height;
+
+		std::vector<uint16_t> Heights(size_t(width) * height, 0);
+		const uint8_t *pSrcData = reinterpret_cast<const uint8_t*>(apHeightImage->GetData()->GetDataPtr());
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t *pRow = pSrcData + size_t(y) * Desc.RowStride;
+			uint16_t *pDst = &Heights[size_t(y) * width];
+			switch (Desc.ComponentType)
+			{
+			case VT_UINT8:
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					pDst[x] = static_cast<uint16_t>(pRow[x * Desc.NumComponents] * 257);
+				}
+				break;
+
+			case VT_UINT16:
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					pDst[x] = reinterpret_cast<const uint16_t*>(pRow)[x * Desc.NumComponents];
+				}
+				break;
+
+			case VT_FLOAT32:
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					float h = reinterpret_cast<const float*>(pRow)[x * Desc.NumComponents];
+					pDst[x] = static_cast<uint16_t>(std::min(std::max(h, 0.0f), 1.0f) * MAX_HEIGHTMAP_SIZE + 0.5f);
+				}
+				break;
+
+			default:
+				LOG_ERROR_MESSAGE("Unsupported heightmap format in ", FileName, ", heights are left flat");
+				y = height;
+				break;
+			}
+		}
+		m_pHeightMemData = std::make_shared<std::vector<uint16_t>>(std::move(Heights));
+	}
+
+	void TerrainMap::LoadDiffuseMap(const std::string &FileName, IRenderDevice *device)
+	{
+		TextureLoadInfo loadInfo;
+		loadInfo.IsSRGB = true;
+		CreateTextureFromFile(FileName.c_str(), loadInfo, device, &m_apDiffTex);
+	}
+
+	void TerrainMap::GetYArea(const uint32_t& x, const uint32_t& y, const uint16_t& size, uint16_t& o_minz, uint16_t& o_maxz) const
+	{
+		uint16_t MinData = MAX_HEIGHTMAP_SIZE;
+		uint16_t MaxData = 0;
+
+		for (uint32_t j = y; j < y + size; ++j)
+		{
+			for (uint32_t i = x; i < x + size; ++i)
+			{
+				uint16_t h = GetY(std::min(i, width - 1), std::min(j, height - 1));
+				MinData = std::min(h, MinData);
+				MaxData = std::max(h, MaxData);
+			}
+		}
+
+		o_minz = MinData;
+		o_maxz = MaxData;
+	}
+
+	uint16_t TerrainMap::GetY(const uint32_t& x, const uint32_t& y) const
+	{
+		if (m_pStreamer)
+		{
+			return m_pStreamer->Sample(x, y);
+		}
+		if (!m_pHeightMemData)
+		{
+			return 0;
+		}
+		return (*m_pHeightMemData)[size_t(y) * width + x];
+	}
+
+	void TerrainMap::GetYBatch(const uint32_t *pX, const uint32_t *pY, const uint32_t Num, uint16_t *pOut) const
+	{
+		if (m_pStreamer)
+		{
+			m_pStreamer->SampleBatch(pX, pY, Num, pOut);
+			return;
+		}
+		if (!m_pHeightMemData)
+		{
+			std::fill(pOut, pOut + Num, uint16_t(0));
+			return;
+		}
+
+		const uint16_t *pData = m_pHeightMemData->data();
+		for (uint32_t i = 0; i < Num; ++i)
+		{
+			pOut[i] = pData[size_t(pY[i]) * width + pX[i]];
+		}
+	}
+
+}
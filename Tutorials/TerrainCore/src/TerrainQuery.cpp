@@ -0,0 +1,379 @@
+#include "TerrainQuery.h"
+#include "CDLODTree.h"
+#include "HeightPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define TERRAIN_QUERY_USE_SSE2 1
+#else
+#	define TERRAIN_QUERY_USE_SSE2 0
+#endif
+
+namespace
+{
+	//bisection steps once the leaf march crossed the surface
+	const int RAY_REFINE_STEP_NUM = 12;
+
+	//pyramid nodes waiting on the traversal stack, at most 3 per level plus the top node
+	struct RayNode
+	{
+		uint32_t Mip;
+		uint32_t x;
+		uint32_t y;
+		float t0;
+		float t1;
+	};
+
+	//slab test, [t0, t1] is clipped to the entering/leaving distance of the box
+	bool IntersectRayBox(const Diligent::TerrainRay &Ray, const Diligent::BoundBox &Box, float &t0, float &t1)
+	{
+		const float Origin[] = { Ray.Origin.x, Ray.Origin.y, Ray.Origin.z };
+		const float Dir[] = { Ray.Dir.x, Ray.Dir.y, Ray.Dir.z };
+		const float BoxMin[] = { Box.Min.x, Box.Min.y, Box.Min.z };
+		const float BoxMax[] = { Box.Max.x, Box.Max.y, Box.Max.z };
+		for (int a = 0; a < 3; ++a)
+		{
+			if (std::abs(Dir[a]) < 1e-12f)
+			{
+				if (Origin[a] < BoxMin[a] || Origin[a] > BoxMax[a])
+				{
+					return false;
+				}
+				continue;
+			}
+
+			float InvDir = 1.0f / Dir[a];
+			float tNear = (BoxMin[a] - Origin[a]) * InvDir;
+			float tFar = (BoxMax[a] - Origin[a]) * InvDir;
+			if (tNear > tFar)
+			{
+				std::swap(tNear, tFar);
+			}
+			t0 = std::max(t0, tNear);
+			t1 = std::min(t1, tFar);
+			if (t0 > t1)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace Diligent
+{
+	TerrainQuery::TerrainQuery(const CDLODTree &Tree) :
+		mHeightMap(Tree.GetHeightMap()),
+		mpPyramid(&Tree.GetPyramid()),
+		mHeightScale(Tree.GetHeightScale()),
+		mWidth(Tree.GetHeightMap().width),
+		mHeight(Tree.GetHeightMap().height)
+	{
+		const Dimension &TerrainDim = Tree.GetTerrainDimension();
+		mTerrainMin = TerrainDim.Min;
+		mTexelWorldSizeX = TerrainDim.SizeX / std::max(mWidth - 1, 1u);
+		mTexelWorldSizeZ = TerrainDim.SizeZ / std::max(mHeight - 1, 1u);
+	}
+
+	float TerrainQuery::GetHeight(const float2 &XZ) const
+	{
+		return SampleTexel((XZ.x - mTerrainMin.x) / mTexelWorldSizeX, (XZ.y - mTerrainMin.z) / mTexelWorldSizeZ);
+	}
+
+	float3 TerrainQuery::GetNormal(const float2 &XZ) const
+	{
+		float3 Normal;
+		GetNormals(&XZ, 1, &Normal);
+		return Normal;
+	}
+
+	void TerrainQuery::GetHeights(const float2 *pXZ, const uint32_t Num, float *pOutHeights) const
+	{
+		float TexX[TERRAIN_QUERY_CHUNK_SIZE];
+		float TexZ[TERRAIN_QUERY_CHUNK_SIZE];
+		const float InvSizeX = 1.0f / mTexelWorldSizeX;
+		const float InvSizeZ = 1.0f / mTexelWorldSizeZ;
+		for (uint32_t Begin = 0; Begin < Num; Begin += TERRAIN_QUERY_CHUNK_SIZE)
+		{
+			const uint32_t ChunkNum = std::min(Num - Begin, uint32_t(TERRAIN_QUERY_CHUNK_SIZE));
+			for (uint32_t i = 0; i < ChunkNum; ++i)
+			{
+				TexX[i] = (pXZ[Begin + i].x - mTerrainMin.x) * InvSizeX;
+				TexZ[i] = (pXZ[Begin + i].y - mTerrainMin.z) * InvSizeZ;
+			}
+			SampleChunk(TexX, TexZ, ChunkNum, pOutHeights + Begin);
+		}
+	}
+
+	void TerrainQuery::GetNormals(const float2 *pXZ, const uint32_t Num, float3 *pOutNormals) const
+	{
+		//left, right, back, front sample of every query
+		const uint32_t QueryPerChunk = TERRAIN_QUERY_CHUNK_SIZE / 4;
+		float TexX[TERRAIN_QUERY_CHUNK_SIZE];
+		float TexZ[TERRAIN_QUERY_CHUNK_SIZE];
+		float Heights[TERRAIN_QUERY_CHUNK_SIZE];
+		const float MaxX = float(mWidth - 1);
+		const float MaxZ = float(mHeight - 1);
+		for (uint32_t Begin = 0; Begin < Num; Begin += QueryPerChunk)
+		{
+			const uint32_t ChunkNum = std::min(Num - Begin, QueryPerChunk);
+			for (uint32_t i = 0; i < ChunkNum; ++i)
+			{
+				const float x = std::min(std::max((pXZ[Begin + i].x - mTerrainMin.x) / mTexelWorldSizeX, 0.0f), MaxX);
+				const float z = std::min(std::max((pXZ[Begin + i].y - mTerrainMin.z) / mTexelWorldSizeZ, 0.0f), MaxZ);
+				TexX[i * 4 + 0] = std::max(x - 1.0f, 0.0f);
+				TexX[i * 4 + 1] = std::min(x + 1.0f, MaxX);
+				TexX[i * 4 + 2] = x;
+				TexX[i * 4 + 3] = x;
+				TexZ[i * 4 + 0] = z;
+				TexZ[i * 4 + 1] = z;
+				TexZ[i * 4 + 2] = std::max(z - 1.0f, 0.0f);
+				TexZ[i * 4 + 3] = std::min(z + 1.0f, MaxZ);
+			}
+			SampleChunk(TexX, TexZ, ChunkNum * 4, Heights);
+
+			for (uint32_t i = 0; i < ChunkNum; ++i)
+			{
+				//the differences are shorter at the border
+				const float DistX = std::max(TexX[i * 4 + 1] - TexX[i * 4 + 0], 1e-6f) * mTexelWorldSizeX;
+				const float DistZ = std::max(TexZ[i * 4 + 3] - TexZ[i * 4 + 2], 1e-6f) * mTexelWorldSizeZ;
+				float3 Normal = float3(-(Heights[i * 4 + 1] - Heights[i * 4 + 0]) / DistX, 1.0f, -(Heights[i * 4 + 3] - Heights[i * 4 + 2]) / DistZ);
+				pOutNormals[Begin + i] = Normal * (1.0f / std::sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z));
+			}
+		}
+	}
+
+	void TerrainQuery::SampleChunk(const float *pTexX, const float *pTexZ, const uint32_t Num, float *pOutHeights) const
+	{
+		//corner texels 00, 10, 01, 11 of every sample, one batch for the height map
+		uint32_t CornerX[TERRAIN_QUERY_CHUNK_SIZE * 4];
+		uint32_t CornerZ[TERRAIN_QUERY_CHUNK_SIZE * 4];
+		uint16_t Corners[TERRAIN_QUERY_CHUNK_SIZE * 4];
+		float FracX[TERRAIN_QUERY_CHUNK_SIZE];
+		float FracZ[TERRAIN_QUERY_CHUNK_SIZE];
+
+		const float MaxX = float(mWidth - 1);
+		const float MaxZ = float(mHeight - 1);
+		for (uint32_t i = 0; i < Num; ++i)
+		{
+			const float x = std::min(std::max(pTexX[i], 0.0f), MaxX);
+			const float z = std::min(std::max(pTexZ[i], 0.0f), MaxZ);
+			const uint32_t x0 = uint32_t(x);
+			const uint32_t z0 = uint32_t(z);
+			const uint32_t x1 = std::min(x0 + 1, mWidth - 1);
+			const uint32_t z1 = std::min(z0 + 1, mHeight - 1);
+			FracX[i] = x - float(x0);
+			FracZ[i] = z - float(z0);
+
+			//corner planes of the chunk, each one Num long
+			CornerX[i] = x0;
+			CornerZ[i] = z0;
+			CornerX[Num + i] = x1;
+			CornerZ[Num + i] = z0;
+			CornerX[Num * 2 + i] = x0;
+			CornerZ[Num * 2 + i] = z1;
+			CornerX[Num * 3 + i] = x1;
+			CornerZ[Num * 3 + i] = z1;
+		}
+		mHeightMap.GetYBatch(CornerX, CornerZ, Num * 4, Corners);
+
+		const uint16_t *p00 = Corners;
+		const uint16_t *p10 = Corners + Num;
+		const uint16_t *p01 = Corners + Num * 2;
+		const uint16_t *p11 = Corners + Num * 3;
+
+		uint32_t i = 0;
+#if TERRAIN_QUERY_USE_SSE2
+		const __m128i Zero = _mm_setzero_si128();
+		const __m128 Scale = _mm_set1_ps(mHeightScale);
+		const __m128 Offset = _mm_set1_ps(mTerrainMin.y);
+		auto LoadHeights = [&Zero](const uint16_t *p)
+		{
+			return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), Zero));
+		};
+		for (; i + 4 <= Num; i += 4)
+		{
+			const __m128 fx = _mm_loadu_ps(FracX + i);
+			const __m128 fz = _mm_loadu_ps(FracZ + i);
+			const __m128 h00 = LoadHeights(p00 + i);
+			const __m128 h10 = LoadHeights(p10 + i);
+			const __m128 h01 = LoadHeights(p01 + i);
+			const __m128 h11 = LoadHeights(p11 + i);
+
+			const __m128 h0 = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h10, h00), fx));
+			const __m128 h1 = _mm_add_ps(h01, _mm_mul_ps(_mm_sub_ps(h11, h01), fx));
+			const __m128 h = _mm_add_ps(h0, _mm_mul_ps(_mm_sub_ps(h1, h0), fz));
+			_mm_storeu_ps(pOutHeights + i, _mm_add_ps(_mm_mul_ps(h, Scale), Offset));
+		}
+#endif
+		for (; i < Num; ++i)
+		{
+			const float h0 = p00[i] + (float(p10[i]) - float(p00[i])) * FracX[i];
+			const float h1 = p01[i] + (float(p11[i]) - float(p01[i])) * FracX[i];
+			pOutHeights[i] = (h0 + (h1 - h0) * FracZ[i]) * mHeightScale + mTerrainMin.y;
+		}
+	}
+
+	float TerrainQuery::SampleTexel(float TexX, float TexZ) const
+	{
+		float Height;
+		SampleChunk(&TexX, &TexZ, 1, &Height);
+		return Height;
+	}
+
+	void TerrainQuery::RayCast(const TerrainRay *pRays, const uint32_t Num, TerrainRayHit *pOutHits) const
+	{
+		for (uint32_t i = 0; i < Num; ++i)
+		{
+			TerrainRayHit &Hit = pOutHits[i];
+			Hit = TerrainRayHit();
+			if (RayCastOne(pRays[i], Hit))
+			{
+				Hit.Normal = GetNormal(float2(Hit.Pos.x, Hit.Pos.z));
+			}
+		}
+	}
+
+	BoundBox TerrainQuery::GetNodeBox(const uint32_t Mip, const uint32_t x, const uint32_t y) const
+	{
+		const HeightMinMaxPyramid::Mip &NodeMip = mpPyramid->GetMip(Mip);
+		const uint32_t NodeSize = mpPyramid->GetLeafSize() << Mip;
+
+		uint16_t MinZ = NodeMip.Min[y * NodeMip.NumX + x];
+		uint16_t MaxZ = NodeMip.Max[y * NodeMip.NumX + x];
+		const uint32_t EndX = std::min(x + 1, NodeMip.NumX - 1);
+		const uint32_t EndY = std::min(y + 1, NodeMip.NumY - 1);
+		for (uint32_t ny = y; ny <= EndY; ++ny)
+		{
+			for (uint32_t nx = x; nx <= EndX; ++nx)
+			{
+				MinZ = std::min(MinZ, NodeMip.Min[ny * NodeMip.NumX + nx]);
+				MaxZ = std::max(MaxZ, NodeMip.Max[ny * NodeMip.NumX + nx]);
+			}
+		}
+
+		BoundBox Box;
+		Box.Min = float3(mTerrainMin.x + x * NodeSize * mTexelWorldSizeX, mTerrainMin.y + MinZ * mHeightScale, mTerrainMin.z + y * NodeSize * mTexelWorldSizeZ);
+		Box.Max = float3(mTerrainMin.x + std::min((x + 1) * NodeSize, mWidth - 1) * mTexelWorldSizeX, mTerrainMin.y + MaxZ * mHeightScale,
+			mTerrainMin.z + std::min((y + 1) * NodeSize, mHeight - 1) * mTexelWorldSizeZ);
+		return Box;
+	}
+
+	bool TerrainQuery::RayCastOne(const TerrainRay &Ray, TerrainRayHit &Hit) const
+	{
+		const uint32_t MipNum = mpPyramid->GetMipNum();
+		if (MipNum == 0 || mWidth < 2 || mHeight < 2)
+		{
+			return false;
+		}
+
+		//top nodes along the ray, nearest first
+		const uint32_t TopMip = MipNum - 1;
+		const HeightMinMaxPyramid::Mip &Top = mpPyramid->GetMip(TopMip);
+		std::vector<RayNode> TopNodes;
+		for (uint32_t y = 0; y < Top.NumY; ++y)
+		{
+			for (uint32_t x = 0; x < Top.NumX; ++x)
+			{
+				RayNode Node = { TopMip, x, y, 0.0f, Ray.MaxDist };
+				if (IntersectRayBox(Ray, GetNodeBox(TopMip, x, y), Node.t0, Node.t1))
+				{
+					TopNodes.push_back(Node);
+				}
+			}
+		}
+		std::sort(TopNodes.begin(), TopNodes.end(), [](const RayNode &a, const RayNode &b) { return a.t0 < b.t0; });
+
+		//Node footprints do not overlap, so their ray intervals only touch. Depth first with the
+		//nearest child on top of the stack finds the closest hit first.
+		std::vector<RayNode> Stack;
+		for (const RayNode &TopNode : TopNodes)
+		{
+			Stack.push_back(TopNode);
+			while (!Stack.empty())
+			{
+				RayNode Node = Stack.back();
+				Stack.pop_back();
+
+				if (Node.Mip == 0)
+				{
+					float tHit;
+					if (MarchLeaf(Ray, Node.t0, Node.t1, tHit))
+					{
+						Hit.bHit = true;
+						Hit.Dist = tHit;
+						Hit.Pos = Ray.Origin + Ray.Dir * tHit;
+						return true;
+					}
+					continue;
+				}
+
+				const uint32_t ChildMip = Node.Mip - 1;
+				const HeightMinMaxPyramid::Mip &Child = mpPyramid->GetMip(ChildMip);
+				RayNode Children[4];
+				uint32_t ChildNum = 0;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					RayNode ChildNode = { ChildMip, Node.x * 2 + (c & 1), Node.y * 2 + (c >> 1), Node.t0, Node.t1 };
+					if (ChildNode.x < Child.NumX && ChildNode.y < Child.NumY &&
+						IntersectRayBox(Ray, GetNodeBox(ChildMip, ChildNode.x, ChildNode.y), ChildNode.t0, ChildNode.t1))
+					{
+						Children[ChildNum++] = ChildNode;
+					}
+				}
+				std::sort(Children, Children + ChildNum, [](const RayNode &a, const RayNode &b) { return a.t0 > b.t0; });
+				Stack.insert(Stack.end(), Children, Children + ChildNum);
+			}
+		}
+		return false;
+	}
+
+	bool TerrainQuery::MarchLeaf(const TerrainRay &Ray, const float t0, const float t1, float &tHit) const
+	{
+		auto Above = [&](const float t)
+		{
+			const float3 Pos = Ray.Origin + Ray.Dir * t;
+			return Pos.y - GetHeight(float2(Pos.x, Pos.z));
+		};
+
+		if (Above(t0) <= 0.0f)
+		{
+			tHit = t0;
+			return true;
+		}
+
+		//half a texel horizontally per step, steep rays take the end points only
+		const float HorizontalLen = std::sqrt(Ray.Dir.x * Ray.Dir.x + Ray.Dir.z * Ray.Dir.z);
+		const float Step = HorizontalLen > 1e-6f ? 0.5f * std::min(mTexelWorldSizeX, mTexelWorldSizeZ) / HorizontalLen : t1 - t0;
+
+		float tPrev = t0;
+		while (tPrev < t1)
+		{
+			const float t = std::min(tPrev + std::max(Step, 1e-6f), t1);
+			if (Above(t) <= 0.0f)
+			{
+				float tOut = tPrev;
+				float tIn = t;
+				for (int i = 0; i < RAY_REFINE_STEP_NUM; ++i)
+				{
+					const float tMid = (tOut + tIn) * 0.5f;
+					if (Above(tMid) <= 0.0f)
+					{
+						tIn = tMid;
+					}
+					else
+					{
+						tOut = tMid;
+					}
+				}
+				tHit = tIn;
+				return true;
+			}
+			tPrev = t;
+		}
+		return false;
+	}
+}
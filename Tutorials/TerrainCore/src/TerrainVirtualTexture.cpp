@@ -0,0 +1,353 @@
+#include "TerrainVirtualTexture.h"
+#include "TerrainMap.h"
+#include "CDLODTree.h"
+#include "Errors.hpp"
+
+#include "TextureLoader.h"
+#include "TextureUtilities.h"
+#include "Image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace Diligent
+{
+
+	bool TerrainVirtualTexture::Init(IRenderDevice *pDevice, const VirtualTextureDesc &Desc, const TEXTURE_FORMAT AtlasFormat, const char *Name)
+	{
+		if (!mCache.Init(Desc))
+		{
+			return false;
+		}
+
+		std::string PageTableName = std::string(Name) + " page table";
+		TextureDesc PageTableDesc;
+		PageTableDesc.Name = PageTableName.c_str();
+		PageTableDesc.Type = RESOURCE_DIM_TEX_2D;
+		PageTableDesc.Width = mCache.GetPageNum(0);
+		PageTableDesc.Height = mCache.GetPageNum(0);
+		PageTableDesc.MipLevels = mCache.GetMipNum();
+		PageTableDesc.Format = TEX_FORMAT_RGBA8_UINT;
+		PageTableDesc.Usage = USAGE_DEFAULT;
+		PageTableDesc.BindFlags = BIND_SHADER_RESOURCE;
+		pDevice->CreateTexture(PageTableDesc, nullptr, &mpPageTableTex);
+
+		std::string AtlasName = std::string(Name) + " page atlas";
+		TextureDesc AtlasDesc;
+		AtlasDesc.Name = AtlasName.c_str();
+		AtlasDesc.Type = RESOURCE_DIM_TEX_2D;
+		AtlasDesc.Width = Desc.SlotNumX * mCache.GetSlotSize();
+		AtlasDesc.Height = Desc.SlotNumY * mCache.GetSlotSize();
+		AtlasDesc.MipLevels = 1;
+		AtlasDesc.Format = AtlasFormat;
+		AtlasDesc.Usage = USAGE_DEFAULT;
+		AtlasDesc.BindFlags = BIND_SHADER_RESOURCE;
+		pDevice->CreateTexture(AtlasDesc, nullptr, &mpAtlasTex);
+
+		LOG_INFO_MESSAGE(Name, " virtual texture: ", mCache.GetPageNum(0), "x", mCache.GetPageNum(0), " pages, ", mCache.GetMipNum(), " mips, atlas ",
+			AtlasDesc.Width, "x", AtlasDesc.Height);
+		return true;
+	}
+
+	void TerrainVirtualTexture::Update(IDeviceContext *pContext)
+	{
+		if (!mCache.Update(mUploads))
+		{
+			return;
+		}
+
+		const uint32_t SlotSize = mCache.GetSlotSize();
+		const uint32_t TexelBytes = mCache.GetDesc().TexelBytes;
+		for (const VirtualPageUpload &Upload : mUploads)
+		{
+			Box Region;
+			Region.MinX = Upload.SlotX * SlotSize;
+			Region.MaxX = Region.MinX + SlotSize;
+			Region.MinY = Upload.SlotY * SlotSize;
+			Region.MaxY = Region.MinY + SlotSize;
+
+			TextureSubResData SubResData;
+			SubResData.pData = &Upload.Data[0];
+			SubResData.Stride = SlotSize * TexelBytes;
+			pContext->UpdateTexture(mpAtlasTex, 0, 0, Region, SubResData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		//fallbacks cascade into the finer mips, the whole table is small
+		for (uint32_t m = 0; m < mCache.GetMipNum(); ++m)
+		{
+			const uint32_t PageNum = mCache.GetPageNum(m);
+			Box Region;
+			Region.MaxX = PageNum;
+			Region.MaxY = PageNum;
+
+			TextureSubResData SubResData;
+			SubResData.pData = &mCache.GetPageTable(m)[0];
+			SubResData.Stride = PageNum * sizeof(VirtualPageTableEntry);
+			pContext->UpdateTexture(mpPageTableTex, m, 0, Region, SubResData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+	}
+
+	VirtualTextureShaderAttribs TerrainVirtualTexture::GetShaderAttribs(const float2 &TexelScale, const float FeedbackMipBias) const
+	{
+		const VirtualTextureDesc &Desc = mCache.GetDesc();
+		const uint32_t SlotSize = mCache.GetSlotSize();
+
+		VirtualTextureShaderAttribs Attribs;
+		Attribs.TexelScale = float4(TexelScale.x, TexelScale.y, float(Desc.PageSize), float(Desc.PageBorder));
+		Attribs.AtlasInfo = float4(1.0f / (Desc.SlotNumX * SlotSize), 1.0f / (Desc.SlotNumY * SlotSize), float(mCache.GetMipNum()), FeedbackMipBias);
+		return Attribs;
+	}
+
+	VirtualTextureFeedback::VirtualTextureFeedback() :
+		mWidth(0),
+		mHeight(0),
+		mFrame(0)
+	{
+
+	}
+
+	void VirtualTextureFeedback::Init(IRenderDevice *pDevice, const uint32_t Width, const uint32_t Height)
+	{
+		mWidth = std::max(Width, 1u);
+		mHeight = std::max(Height, 1u);
+		mFrame = 0;
+
+		TextureDesc ColorDesc;
+		ColorDesc.Name = "VT feedback target";
+		ColorDesc.Type = RESOURCE_DIM_TEX_2D;
+		ColorDesc.Width = mWidth;
+		ColorDesc.Height = mHeight;
+		ColorDesc.MipLevels = 1;
+		ColorDesc.Format = ColorFormat;
+		ColorDesc.Usage = USAGE_DEFAULT;
+		ColorDesc.BindFlags = BIND_RENDER_TARGET;
+		pDevice->CreateTexture(ColorDesc, nullptr, &mpColorTex);
+
+		TextureDesc DepthDesc = ColorDesc;
+		DepthDesc.Name = "VT feedback depth";
+		DepthDesc.Format = DepthFormat;
+		DepthDesc.BindFlags = BIND_DEPTH_STENCIL;
+		pDevice->CreateTexture(DepthDesc, nullptr, &mpDepthTex);
+
+		TextureDesc StagingDesc = ColorDesc;
+		StagingDesc.Name = "VT feedback readback";
+		StagingDesc.Usage = USAGE_STAGING;
+		StagingDesc.BindFlags = BIND_NONE;
+		StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+		for (int i = 0; i < VT_FEEDBACK_LATENCY; ++i)
+		{
+			pDevice->CreateTexture(StagingDesc, nullptr, &mpStagingTex[i]);
+		}
+	}
+
+	void VirtualTextureFeedback::Begin(IDeviceContext *pContext)
+	{
+		ITextureView *pRTV = mpColorTex->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+		ITextureView *pDSV = mpDepthTex->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+		pContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+		//alpha 0 - no terrain
+		const float ClearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		pContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+	}
+
+	void VirtualTextureFeedback::End(IDeviceContext *pContext, std::vector<uint32_t> &PageKeys)
+	{
+		PageKeys.clear();
+
+		CopyTextureAttribs CopyAttribs(mpColorTex, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, mpStagingTex[mFrame % VT_FEEDBACK_LATENCY], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		pContext->CopyTexture(CopyAttribs);
+		++mFrame;
+		if (mFrame < VT_FEEDBACK_LATENCY)
+		{
+			return;
+		}
+
+		//the next one to be written is the oldest copy
+		ITexture *pReadTex = mpStagingTex[mFrame % VT_FEEDBACK_LATENCY];
+		MappedTextureSubresource MappedData;
+		pContext->MapTextureSubresource(pReadTex, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+		if (!MappedData.pData)
+		{
+			return;
+		}
+
+		//rgb: low 8 bits of x, y and their high 4 bits, a: mip + 1
+		for (uint32_t y = 0; y < mHeight; ++y)
+		{
+			const uint8_t *pRow = reinterpret_cast<const uint8_t*>(MappedData.pData) + size_t(y) * MappedData.Stride;
+			for (uint32_t x = 0; x < mWidth; ++x)
+			{
+				const uint8_t *pTexel = pRow + x * 4;
+				if (pTexel[3] == 0)
+				{
+					continue;
+				}
+				VirtualPageId Page;
+				Page.Mip = pTexel[3] - 1u;
+				Page.X = pTexel[0] | ((pTexel[2] & 0xFu) << 8);
+				Page.Y = pTexel[1] | ((pTexel[2] >> 4) << 8);
+				PageKeys.push_back(Page.Pack());
+			}
+		}
+		pContext->UnmapTextureSubresource(pReadTex, 0, 0);
+
+		std::sort(PageKeys.begin(), PageKeys.end());
+		PageKeys.erase(std::unique(PageKeys.begin(), PageKeys.end()), PageKeys.end());
+	}
+
+	void CreateHeightPageLoader(const TerrainMap &Heightmap, VirtualTextureDesc &Desc)
+	{
+		Desc.Width = Heightmap.width;
+		Desc.Height = Heightmap.height;
+		Desc.TexelBytes = sizeof(uint16_t);
+
+		const int64_t PageSize = Desc.PageSize;
+		const int64_t Border = Desc.PageBorder;
+		Desc.LoadPage = [Heightmap, PageSize, Border](const VirtualPageId &Page, uint8_t *pData)
+		{
+			uint16_t *pHeights = reinterpret_cast<uint16_t*>(pData);
+			const int64_t SlotSize = PageSize + 2 * Border;
+			const int64_t Step = int64_t(1) << Page.Mip;
+			const int64_t MaxX = Heightmap.width - 1;
+			const int64_t MaxY = Heightmap.height - 1;
+			for (int64_t y = 0; y < SlotSize; ++y)
+			{
+				int64_t SrcY = std::min(std::max((Page.Y * PageSize + y - Border) * Step, int64_t(0)), MaxY);
+				for (int64_t x = 0; x < SlotSize; ++x)
+				{
+					int64_t SrcX = std::min(std::max((Page.X * PageSize + x - Border) * Step, int64_t(0)), MaxX);
+					pHeights[y * SlotSize + x] = Heightmap.GetY(uint32_t(SrcX), uint32_t(SrcY));
+				}
+			}
+		};
+	}
+
+	bool CreateImagePageLoader(const std::string &FileName, VirtualTextureDesc &Desc)
+	{
+		RefCntAutoPtr<Image> apImage;
+		CreateImageFromFile(FileName.c_str(), &apImage);
+		if (!apImage || apImage->GetDesc().ComponentType != VT_UINT8)
+		{
+			LOG_ERROR_MESSAGE("Failed to load ", FileName, " as an 8-bit virtual texture source");
+			return false;
+		}
+
+		const ImageDesc &ImgDesc = apImage->GetDesc();
+		const uint8_t *pSrcData = reinterpret_cast<const uint8_t*>(apImage->GetData()->GetDataPtr());
+
+		//RGBA8 mips owned by the loader, gray sources are replicated
+		auto pMips = std::make_shared<std::vector<std::vector<uint8_t>>>(1);
+		std::vector<uint8_t> &Mip0 = (*pMips)[0];
+		Mip0.resize(size_t(ImgDesc.Width) * ImgDesc.Height * 4);
+		for (uint32_t y = 0; y < ImgDesc.Height; ++y)
+		{
+			const uint8_t *pRow = pSrcData + size_t(y) * ImgDesc.RowStride;
+			for (uint32_t x = 0; x < ImgDesc.Width; ++x)
+			{
+				const uint8_t *pSrc = pRow + x * ImgDesc.NumComponents;
+				uint8_t *pDst = &Mip0[(size_t(y) * ImgDesc.Width + x) * 4];
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					pDst[c] = pSrc[std::min(c, ImgDesc.NumComponents - 1)];
+				}
+				pDst[3] = ImgDesc.NumComponents == 4 ? pSrc[3] : 255;
+			}
+		}
+
+		uint32_t MipW = ImgDesc.Width;
+		uint32_t MipH = ImgDesc.Height;
+		while (MipW > 1 || MipH > 1)
+		{
+			const uint32_t SrcW = MipW;
+			const uint32_t SrcH = MipH;
+			MipW = std::max(MipW / 2, 1u);
+			MipH = std::max(MipH / 2, 1u);
+
+			pMips->emplace_back(size_t(MipW) * MipH * 4);
+			const std::vector<uint8_t> &Src = (*pMips)[pMips->size() - 2];
+			std::vector<uint8_t> &Dst = pMips->back();
+			for (uint32_t y = 0; y < MipH; ++y)
+			{
+				const uint32_t y0 = std::min(2 * y, SrcH - 1);
+				const uint32_t y1 = std::min(2 * y + 1, SrcH - 1);
+				for (uint32_t x = 0; x < MipW; ++x)
+				{
+					const uint32_t x0 = std::min(2 * x, SrcW - 1);
+					const uint32_t x1 = std::min(2 * x + 1, SrcW - 1);
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						uint32_t Sum = Src[(size_t(y0) * SrcW + x0) * 4 + c] + Src[(size_t(y0) * SrcW + x1) * 4 + c] +
+							Src[(size_t(y1) * SrcW + x0) * 4 + c] + Src[(size_t(y1) * SrcW + x1) * 4 + c];
+						Dst[(size_t(y) * MipW + x) * 4 + c] = static_cast<uint8_t>((Sum + 2) / 4);
+					}
+				}
+			}
+		}
+
+		Desc.Width = ImgDesc.Width;
+		Desc.Height = ImgDesc.Height;
+		Desc.TexelBytes = 4;
+
+		const uint32_t Width = ImgDesc.Width;
+		const uint32_t Height = ImgDesc.Height;
+		const int64_t PageSize = Desc.PageSize;
+		const int64_t Border = Desc.PageBorder;
+		Desc.LoadPage = [pMips, Width, Height, PageSize, Border](const VirtualPageId &Page, uint8_t *pData)
+		{
+			//a page of mip m spans PageSize texels of image mip m
+			const uint32_t Mip = std::min<uint32_t>(Page.Mip, static_cast<uint32_t>(pMips->size()) - 1);
+			const std::vector<uint8_t> &Src = (*pMips)[Mip];
+			const int64_t MipW = std::max(Width >> Mip, 1u);
+			const int64_t MipH = std::max(Height >> Mip, 1u);
+			const int64_t SlotSize = PageSize + 2 * Border;
+			for (int64_t y = 0; y < SlotSize; ++y)
+			{
+				int64_t SrcY = std::min(std::max(Page.Y * PageSize + y - Border, int64_t(0)), MipH - 1);
+				for (int64_t x = 0; x < SlotSize; ++x)
+				{
+					int64_t SrcX = std::min(std::max(Page.X * PageSize + x - Border, int64_t(0)), MipW - 1);
+					memcpy(pData + (y * SlotSize + x) * 4, &Src[(SrcY * MipW + SrcX) * 4], 4);
+				}
+			}
+		};
+		return true;
+	}
+
+	void CollectSelectionPageKeys(const SelectionInfo &SelectInfo, const VirtualTextureCache &Cache, std::vector<uint32_t> &PageKeys)
+	{
+		PageKeys.clear();
+
+		//heights are addressed at uv * (size - 1)
+		const Dimension &TerrainDim = SelectInfo.TerrainDimension;
+		const float TexelPerWorldX = (SelectInfo.RasSizeX - 1) / TerrainDim.SizeX;
+		const float TexelPerWorldZ = (SelectInfo.RasSizeY - 1) / TerrainDim.SizeZ;
+		const float PageSize = float(Cache.GetDesc().PageSize);
+
+		for (const SelectNodeData &NodeData : SelectInfo.SelectionNodes)
+		{
+			const uint32_t Mip = std::min<uint32_t>(LOD_COUNT - NodeData.LODLevel - 1, Cache.GetMipNum() - 1);
+			const float MipPageSize = PageSize * (1u << Mip);
+			const int MaxPage = static_cast<int>(Cache.GetPageNum(Mip)) - 1;
+			auto ToPage = [&](const float World, const float Min, const float TexelPerWorld)
+			{
+				return std::min(std::max(static_cast<int>(std::floor((World - Min) * TexelPerWorld / MipPageSize)), 0), MaxPage);
+			};
+
+			const int MinX = ToPage(NodeData.aabb.Min.x, TerrainDim.Min.x, TexelPerWorldX);
+			const int MaxX = ToPage(NodeData.aabb.Max.x, TerrainDim.Min.x, TexelPerWorldX);
+			const int MinY = ToPage(NodeData.aabb.Min.z, TerrainDim.Min.z, TexelPerWorldZ);
+			const int MaxY = ToPage(NodeData.aabb.Max.z, TerrainDim.Min.z, TexelPerWorldZ);
+			for (int y = MinY; y <= MaxY; ++y)
+			{
+				for (int x = MinX; x <= MaxX; ++x)
+				{
+					PageKeys.push_back(VirtualPageId({ Mip, uint32_t(x), uint32_t(y) }).Pack());
+				}
+			}
+		}
+	}
+
+}
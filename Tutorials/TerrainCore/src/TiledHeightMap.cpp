@@ -0,0 +1,384 @@
+#include "TiledHeightMap.h"
+#include "TerrainMap.h"
+#include "CDLODTree.h"
+#include "Errors.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+	//bump when the layout changes, old files have to be converted again
+	const uint32_t TILED_HEIGHTMAP_MAGIC = 0x4D544854; //"THTM"
+	const uint32_t TILED_HEIGHTMAP_VERSION = 1;
+
+	//texels of the mips before Mip inside a tile
+	uint64_t GetMipTexelOffset(const uint32_t TileSize, const uint32_t Mip)
+	{
+		uint64_t Offset = 0;
+		for (uint32_t m = 0; m < Mip; ++m)
+		{
+			uint64_t MipSize = TileSize >> m;
+			Offset += MipSize * MipSize;
+		}
+		return Offset;
+	}
+
+	//2x2 box filter, builds the stored mips and drops resident ones alike
+	void DownsampleMip(const uint16_t *pSrc, const uint32_t SrcSize, uint16_t *pDst)
+	{
+		const uint32_t DstSize = SrcSize / 2;
+		for (uint32_t y = 0; y < DstSize; ++y)
+		{
+			const uint16_t *pRow0 = pSrc + size_t(2 * y) * SrcSize;
+			const uint16_t *pRow1 = pRow0 + SrcSize;
+			for (uint32_t x = 0; x < DstSize; ++x)
+			{
+				uint32_t Sum = pRow0[2 * x] + pRow0[2 * x + 1] + pRow1[2 * x] + pRow1[2 * x + 1];
+				pDst[size_t(y) * DstSize + x] = static_cast<uint16_t>((Sum + 2) / 4);
+			}
+		}
+	}
+
+	bool IsValidTileLayout(const uint32_t TileSize, const uint32_t TileMipNum)
+	{
+		return TileSize != 0 && (TileSize & (TileSize - 1)) == 0 &&
+			TileMipNum != 0 && TileMipNum <= 16 && (TileSize >> (TileMipNum - 1)) != 0;
+	}
+}
+
+bool Diligent::WriteTiledHeightMap(const TerrainMap &Source, const std::string &FileName, const uint32_t TileSize, const uint32_t TileMipNum)
+{
+	const uint16_t *pHeightData = Source.GetHeightData();
+	if (!pHeightData || !IsValidTileLayout(TileSize, TileMipNum))
+	{
+		LOG_ERROR_MESSAGE("Can't write tiled heightmap ", FileName, ", the source must be in memory and the tile size a power of two");
+		return false;
+	}
+
+	std::ofstream wf(FileName, std::ios::out | std::ios::binary);
+	if (!wf)
+	{
+		LOG_ERROR_MESSAGE("Failed to write tiled heightmap ", FileName);
+		return false;
+	}
+
+	HeightMinMaxPyramid Pyramid;
+	Pyramid.Build(Source, LEAF_RENDER_NODE_SIZE, LOD_COUNT);
+
+	TiledHeightMapHeader Header;
+	Header.Magic = TILED_HEIGHTMAP_MAGIC;
+	Header.Version = TILED_HEIGHTMAP_VERSION;
+	Header.Width = Source.width;
+	Header.Height = Source.height;
+	Header.TileSize = TileSize;
+	Header.TileMipNum = TileMipNum;
+	Header.TileNumX = (Source.width - 1) / TileSize + 1;
+	Header.TileNumY = (Source.height - 1) / TileSize + 1;
+	Header.TileDataOffset = 0;
+
+	//the tile data offset is known after the pyramid, the header is written twice
+	wf.write((const char*)&Header, sizeof(TiledHeightMapHeader));
+	Pyramid.Write(wf);
+	Header.TileDataOffset = static_cast<uint64_t>(wf.tellp());
+	wf.seekp(0);
+	wf.write((const char*)&Header, sizeof(TiledHeightMapHeader));
+	wf.seekp(Header.TileDataOffset);
+
+	std::vector<uint16_t> TileData(GetMipTexelOffset(TileSize, TileMipNum));
+	for (uint32_t ty = 0; ty < Header.TileNumY; ++ty)
+	{
+		for (uint32_t tx = 0; tx < Header.TileNumX; ++tx)
+		{
+			for (uint32_t y = 0; y < TileSize; ++y)
+			{
+				uint32_t SrcY = std::min(ty * TileSize + y, Source.height - 1);
+				for (uint32_t x = 0; x < TileSize; ++x)
+				{
+					uint32_t SrcX = std::min(tx * TileSize + x, Source.width - 1);
+					TileData[size_t(y) * TileSize + x] = pHeightData[size_t(SrcY) * Source.width + SrcX];
+				}
+			}
+
+			for (uint32_t m = 1; m < TileMipNum; ++m)
+			{
+				DownsampleMip(&TileData[GetMipTexelOffset(TileSize, m - 1)], TileSize >> (m - 1), &TileData[GetMipTexelOffset(TileSize, m)]);
+			}
+
+			wf.write((const char*)&TileData[0], sizeof(uint16_t) * TileData.size());
+		}
+	}
+
+	if (!wf)
+	{
+		LOG_ERROR_MESSAGE("Failed to write tiled heightmap ", FileName);
+		return false;
+	}
+
+	LOG_INFO_MESSAGE("Tiled heightmap ", FileName, ": ", Header.TileNumX, "x", Header.TileNumY, " tiles of ", TileSize, ", ", TileMipNum, " mips");
+	return true;
+}
+
+Diligent::TiledHeightMapStreamer::TiledHeightMapStreamer() :
+	mStopIO(false)
+{
+	memset(&mHeader, 0, sizeof(TiledHeightMapHeader));
+}
+
+Diligent::TiledHeightMapStreamer::~TiledHeightMapStreamer()
+{
+	Close();
+}
+
+bool Diligent::TiledHeightMapStreamer::Open(const std::string &FileName)
+{
+	Close();
+
+	std::ifstream rf(FileName, std::ios::in | std::ios::binary);
+	if (!rf)
+	{
+		return false;
+	}
+
+	TiledHeightMapHeader Header;
+	rf.read((char*)&Header, sizeof(TiledHeightMapHeader));
+	if (!rf ||
+		Header.Magic != TILED_HEIGHTMAP_MAGIC ||
+		Header.Version != TILED_HEIGHTMAP_VERSION ||
+		Header.Width == 0 || Header.Height == 0 ||
+		!IsValidTileLayout(Header.TileSize, Header.TileMipNum) ||
+		Header.TileNumX != (Header.Width - 1) / Header.TileSize + 1 ||
+		Header.TileNumY != (Header.Height - 1) / Header.TileSize + 1)
+	{
+		return false;
+	}
+
+	//the CDLOD tree takes the pyramid as is
+	if (!mPyramid.Read(rf) || mPyramid.GetLeafSize() != LEAF_RENDER_NODE_SIZE || mPyramid.GetMipNum() != LOD_COUNT)
+	{
+		LOG_WARNING_MESSAGE("Height pyramid of ", FileName, " doesn't match the CDLOD layout, the file has to be written again");
+		return false;
+	}
+	mHeader = Header;
+
+	const uint32_t CoarsestMip = mHeader.TileMipNum - 1;
+	mTiles.resize(mHeader.TileNumX * mHeader.TileNumY);
+	for (uint32_t i = 0; i < mTiles.size(); ++i)
+	{
+		mTiles[i].ResidentMip = CoarsestMip;
+		if (!ReadTileMip(rf, i, CoarsestMip, mTiles[i].Coarse))
+		{
+			mTiles.clear();
+			return false;
+		}
+	}
+
+	mFileName = FileName;
+	mStopIO = false;
+	mIOThread = std::thread(&TiledHeightMapStreamer::IOThreadFunc, this);
+	return true;
+}
+
+void Diligent::TiledHeightMapStreamer::Close()
+{
+	if (mIOThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> Lock(mQueueMutex);
+			mStopIO = true;
+			mRequests.clear();
+		}
+		mQueueCond.notify_all();
+		mIOThread.join();
+	}
+
+	std::lock_guard<std::mutex> Lock(mTileMutex);
+	mTiles.clear();
+}
+
+void Diligent::TiledHeightMapStreamer::SetFocus(const float2 &FocusTexel, const float FullDetailRadius)
+{
+	const uint32_t CoarsestMip = mHeader.TileMipNum - 1;
+	const float Radius = std::max(FullDetailRadius, 1.0f);
+
+	std::vector<std::pair<float, TileRequest>> Missing;
+	{
+		std::lock_guard<std::mutex> Lock(mTileMutex);
+		for (uint32_t ty = 0; ty < mHeader.TileNumY; ++ty)
+		{
+			for (uint32_t tx = 0; tx < mHeader.TileNumX; ++tx)
+			{
+				//distance from the focus to the tile rect
+				float MinX = float(tx * mHeader.TileSize);
+				float MinY = float(ty * mHeader.TileSize);
+				float dx = std::max(std::max(MinX - FocusTexel.x, FocusTexel.x - (MinX + mHeader.TileSize)), 0.0f);
+				float dy = std::max(std::max(MinY - FocusTexel.y, FocusTexel.y - (MinY + mHeader.TileSize)), 0.0f);
+				float Dist = std::sqrt(dx * dx + dy * dy);
+
+				uint32_t Mip = 0;
+				for (float r = Radius; Dist > r && Mip < CoarsestMip; r *= 2.0f)
+				{
+					++Mip;
+				}
+
+				uint32_t TileIdx = ty * mHeader.TileNumX + tx;
+				TileSlot &Slot = mTiles[TileIdx];
+				if (Mip > Slot.ResidentMip)
+				{
+					DropTileMips(Slot, Mip);
+				}
+				else if (Mip < Slot.ResidentMip)
+				{
+					Missing.push_back(std::make_pair(Dist, TileRequest({ TileIdx, Mip })));
+				}
+			}
+		}
+	}
+
+	std::sort(Missing.begin(), Missing.end(), [](const std::pair<float, TileRequest> &a, const std::pair<float, TileRequest> &b)
+	{
+		return a.first < b.first;
+	});
+
+	{
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
+		mRequests.clear();
+		for (const auto &Request : Missing)
+		{
+			mRequests.push_back(Request.second);
+		}
+	}
+	if (!Missing.empty())
+	{
+		mQueueCond.notify_one();
+	}
+}
+
+uint16_t Diligent::TiledHeightMapStreamer::Sample(const uint32_t x, const uint32_t y) const
+{
+	std::lock_guard<std::mutex> Lock(mTileMutex);
+	return SampleLocked(x, y);
+}
+
+void Diligent::TiledHeightMapStreamer::SampleBatch(const uint32_t *pX, const uint32_t *pY, const uint32_t Num, uint16_t *pOut) const
+{
+	std::lock_guard<std::mutex> Lock(mTileMutex);
+	for (uint32_t i = 0; i < Num; ++i)
+	{
+		pOut[i] = SampleLocked(pX[i], pY[i]);
+	}
+}
+
+uint16_t Diligent::TiledHeightMapStreamer::SampleLocked(const uint32_t x, const uint32_t y) const
+{
+	const uint32_t cx = std::min(x, mHeader.Width - 1);
+	const uint32_t cy = std::min(y, mHeader.Height - 1);
+	const uint32_t TileIdx = (cy / mHeader.TileSize) * mHeader.TileNumX + cx / mHeader.TileSize;
+
+	const TileSlot &Slot = mTiles[TileIdx];
+	const std::vector<uint16_t> &Data = Slot.ResidentMip == mHeader.TileMipNum - 1 ? Slot.Coarse : Slot.Data;
+	const uint32_t MipSize = mHeader.TileSize >> Slot.ResidentMip;
+	const uint32_t lx = (cx % mHeader.TileSize) >> Slot.ResidentMip;
+	const uint32_t ly = (cy % mHeader.TileSize) >> Slot.ResidentMip;
+	return Data[ly * MipSize + lx];
+}
+
+uint32_t Diligent::TiledHeightMapStreamer::GetResidentTileNum() const
+{
+	std::lock_guard<std::mutex> Lock(mTileMutex);
+	uint32_t Num = 0;
+	for (const TileSlot &Slot : mTiles)
+	{
+		Num += Slot.ResidentMip != mHeader.TileMipNum - 1;
+	}
+	return Num;
+}
+
+size_t Diligent::TiledHeightMapStreamer::GetResidentBytes() const
+{
+	std::lock_guard<std::mutex> Lock(mTileMutex);
+	size_t Bytes = 0;
+	for (const TileSlot &Slot : mTiles)
+	{
+		Bytes += sizeof(uint16_t) * (Slot.Data.capacity() + Slot.Coarse.capacity());
+	}
+	return Bytes;
+}
+
+uint32_t Diligent::TiledHeightMapStreamer::GetPendingRequestNum() const
+{
+	std::lock_guard<std::mutex> Lock(mQueueMutex);
+	return static_cast<uint32_t>(mRequests.size());
+}
+
+void Diligent::TiledHeightMapStreamer::IOThreadFunc()
+{
+	std::ifstream rf(mFileName, std::ios::in | std::ios::binary);
+	std::vector<uint16_t> Data;
+	for (;;)
+	{
+		TileRequest Request;
+		{
+			std::unique_lock<std::mutex> Lock(mQueueMutex);
+			mQueueCond.wait(Lock, [&]() { return mStopIO || !mRequests.empty(); });
+			if (mStopIO)
+			{
+				return;
+			}
+			Request = mRequests.front();
+			mRequests.pop_front();
+		}
+
+		if (!ReadTileMip(rf, Request.TileIdx, Request.Mip, Data))
+		{
+			LOG_WARNING_MESSAGE("Failed to read tile ", Request.TileIdx, " mip ", Request.Mip, " of ", mFileName);
+			rf.clear();
+			continue;
+		}
+
+		//the focus may have moved meanwhile, the next SetFocus drops what is not wanted any more
+		std::lock_guard<std::mutex> Lock(mTileMutex);
+		TileSlot &Slot = mTiles[Request.TileIdx];
+		if (Request.Mip < Slot.ResidentMip)
+		{
+			Slot.Data.swap(Data);
+			Slot.ResidentMip = Request.Mip;
+		}
+	}
+}
+
+void Diligent::TiledHeightMapStreamer::DropTileMips(TileSlot &Slot, const uint32_t Mip) const
+{
+	if (Mip == mHeader.TileMipNum - 1)
+	{
+		std::vector<uint16_t>().swap(Slot.Data);
+		Slot.ResidentMip = Mip;
+		return;
+	}
+
+	//reduce in place, every mip is smaller than the one it is read from
+	for (; Slot.ResidentMip < Mip; ++Slot.ResidentMip)
+	{
+		DownsampleMip(&Slot.Data[0], mHeader.TileSize >> Slot.ResidentMip, &Slot.Data[0]);
+	}
+	const uint32_t MipSize = mHeader.TileSize >> Mip;
+	Slot.Data.resize(MipSize * MipSize);
+	Slot.Data.shrink_to_fit();
+}
+
+bool Diligent::TiledHeightMapStreamer::ReadTileMip(std::ifstream &rf, const uint32_t TileIdx, const uint32_t Mip, std::vector<uint16_t> &Out) const
+{
+	const uint32_t MipSize = mHeader.TileSize >> Mip;
+	Out.resize(MipSize * MipSize);
+	rf.seekg(GetTileMipOffset(TileIdx, Mip));
+	rf.read((char*)&Out[0], sizeof(uint16_t) * Out.size());
+	return !!rf;
+}
+
+uint64_t Diligent::TiledHeightMapStreamer::GetTileMipOffset(const uint32_t TileIdx, const uint32_t Mip) const
+{
+	const uint64_t TileBytes = sizeof(uint16_t) * GetMipTexelOffset(mHeader.TileSize, mHeader.TileMipNum);
+	return mHeader.TileDataOffset + TileIdx * TileBytes + sizeof(uint16_t) * GetMipTexelOffset(mHeader.TileSize, Mip);
+}
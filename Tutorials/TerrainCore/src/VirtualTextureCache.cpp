@@ -0,0 +1,317 @@
+#include "VirtualTextureCache.h"
+#include "Errors.hpp"
+
+namespace
+{
+	const uint32_t INVALID_PAGE_KEY = 0xFFFFFFFF;
+	const uint32_t MAX_PAGE_NUM = 4096; //12 bits per axis in the page key
+}
+
+Diligent::VirtualTextureCache::VirtualTextureCache() :
+	mPageNum(0),
+	mMipNum(0),
+	mFrame(0),
+	mStopLoader(false)
+{
+
+}
+
+Diligent::VirtualTextureCache::~VirtualTextureCache()
+{
+	Shutdown();
+}
+
+bool Diligent::VirtualTextureCache::Init(const VirtualTextureDesc &Desc)
+{
+	Shutdown();
+
+	if (!Desc.LoadPage || Desc.Width == 0 || Desc.Height == 0 || Desc.PageSize == 0 ||
+		Desc.SlotNumX == 0 || Desc.SlotNumX > 256 || Desc.SlotNumY == 0 || Desc.SlotNumY > 256 ||
+		Desc.SlotNumX * Desc.SlotNumY < 2 || Desc.UploadBudget == 0)
+	{
+		LOG_ERROR_MESSAGE("Invalid virtual texture description");
+		return false;
+	}
+
+	uint32_t PageNumX = (Desc.Width - 1) / Desc.PageSize + 1;
+	uint32_t PageNumY = (Desc.Height - 1) / Desc.PageSize + 1;
+	mPageNum = 1;
+	mMipNum = 1;
+	while (mPageNum < std::max(PageNumX, PageNumY))
+	{
+		mPageNum *= 2;
+		++mMipNum;
+	}
+	if (mPageNum > MAX_PAGE_NUM)
+	{
+		LOG_ERROR_MESSAGE("Virtual texture of ", Desc.Width, "x", Desc.Height, " needs more than ", MAX_PAGE_NUM, " pages per axis");
+		return false;
+	}
+
+	mDesc = Desc;
+	mFrame = 0;
+	mStats = VirtualTextureStats();
+
+	mSlots.resize(Desc.SlotNumX * Desc.SlotNumY);
+	mFreeSlots.clear();
+	for (uint32_t i = 0; i < mSlots.size(); ++i)
+	{
+		mSlots[i] = Slot({ INVALID_PAGE_KEY, 0, false });
+		mFreeSlots.push_back(static_cast<uint32_t>(mSlots.size()) - 1 - i);
+	}
+
+	mPageTable.resize(mMipNum);
+	for (uint32_t m = 0; m < mMipNum; ++m)
+	{
+		mPageTable[m].assign(GetPageNum(m) * GetPageNum(m), VirtualPageTableEntry({ 0, 0, 0, 0 }));
+	}
+
+	//the root is the fallback of every lookup, it is loaded right away and placed by the first Update
+	VirtualPageUpload Root;
+	Root.Page = VirtualPageId({ mMipNum - 1, 0, 0 });
+	Root.Data.resize(GetSlotSize() * GetSlotSize() * mDesc.TexelBytes);
+	mDesc.LoadPage(Root.Page, &Root.Data[0]);
+	mPending.insert(Root.Page.Pack());
+	mLoaded.push_back(std::move(Root));
+
+	mStopLoader = false;
+	mLoaderThread = std::thread(&VirtualTextureCache::LoaderThreadFunc, this);
+	return true;
+}
+
+void Diligent::VirtualTextureCache::Shutdown()
+{
+	if (mLoaderThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> Lock(mQueueMutex);
+			mStopLoader = true;
+			mLoadQueue.clear();
+		}
+		mQueueCond.notify_all();
+		mLoaderThread.join();
+	}
+
+	mLoaded.clear();
+	mSlots.clear();
+	mFreeSlots.clear();
+	mResident.clear();
+	mPending.clear();
+	mPageTable.clear();
+}
+
+void Diligent::VirtualTextureCache::RequestPages(const std::vector<uint32_t> &PageKeys)
+{
+	std::vector<uint32_t> Keys(PageKeys);
+	std::sort(Keys.begin(), Keys.end());
+	Keys.erase(std::unique(Keys.begin(), Keys.end()), Keys.end());
+
+	mStats.RequestedPageNum = 0;
+	mStats.MissingPageNum = 0;
+
+	std::vector<uint32_t> Missing;
+	for (uint32_t Key : Keys)
+	{
+		VirtualPageId Page = VirtualPageId::Unpack(Key);
+		if (Page.Mip >= mMipNum || Page.X >= GetPageNum(Page.Mip) || Page.Y >= GetPageNum(Page.Mip))
+		{
+			continue;
+		}
+		++mStats.RequestedPageNum;
+
+		//parents are the fallback while a page loads, they have to stay resident as well
+		for (bool bRequested = true; ; bRequested = false)
+		{
+			uint32_t CurrKey = Page.Pack();
+			auto Iter = mResident.find(CurrKey);
+			if (Iter != mResident.end())
+			{
+				mSlots[Iter->second].LastUsedFrame = mFrame;
+			}
+			else
+			{
+				Missing.push_back(CurrKey);
+				mStats.MissingPageNum += bRequested;
+			}
+
+			if (Page.Mip + 1 >= mMipNum)
+			{
+				break;
+			}
+			Page = VirtualPageId({ Page.Mip + 1, Page.X / 2, Page.Y / 2 });
+		}
+	}
+
+	//coarsest first, a finer page is useless until its parent is there
+	std::sort(Missing.begin(), Missing.end());
+	Missing.erase(std::unique(Missing.begin(), Missing.end()), Missing.end());
+	std::stable_sort(Missing.begin(), Missing.end(), [](const uint32_t a, const uint32_t b)
+	{
+		return (a >> 24) > (b >> 24);
+	});
+
+	{
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
+
+		//pages still queued are dropped unless requested again, loading and loaded ones stay pending
+		for (uint32_t Key : mLoadQueue)
+		{
+			mPending.erase(Key);
+		}
+		mLoadQueue.clear();
+
+		for (uint32_t Key : Missing)
+		{
+			if (mPending.insert(Key).second)
+			{
+				mLoadQueue.push_back(Key);
+			}
+		}
+	}
+	mQueueCond.notify_one();
+}
+
+bool Diligent::VirtualTextureCache::Update(std::vector<VirtualPageUpload> &Uploads)
+{
+	Uploads.clear();
+
+	std::vector<VirtualPageUpload> Loaded;
+	{
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
+		while (!mLoaded.empty() && Loaded.size() < mDesc.UploadBudget)
+		{
+			Loaded.push_back(std::move(mLoaded.front()));
+			mLoaded.pop_front();
+		}
+	}
+
+	for (VirtualPageUpload &Upload : Loaded)
+	{
+		uint32_t Key = Upload.Page.Pack();
+		mPending.erase(Key);
+		if (mResident.count(Key) != 0)
+		{
+			continue;
+		}
+
+		//everything is in use this frame, the page is requested again later
+		int SlotIdx = AcquireSlot();
+		if (SlotIdx < 0)
+		{
+			continue;
+		}
+
+		Slot &CurrSlot = mSlots[SlotIdx];
+		CurrSlot.PageKey = Key;
+		CurrSlot.LastUsedFrame = mFrame;
+		CurrSlot.bPinned = Upload.Page.Mip == mMipNum - 1;
+		mResident[Key] = static_cast<uint32_t>(SlotIdx);
+
+		Upload.SlotX = SlotIdx % mDesc.SlotNumX;
+		Upload.SlotY = SlotIdx / mDesc.SlotNumX;
+		Uploads.push_back(std::move(Upload));
+	}
+
+	if (!Uploads.empty())
+	{
+		RebuildPageTable();
+	}
+
+	mStats.UploadNum = static_cast<uint32_t>(Uploads.size());
+	mStats.ResidentPageNum = static_cast<uint32_t>(mResident.size());
+	mStats.PendingPageNum = static_cast<uint32_t>(mPending.size());
+	++mFrame;
+	return !Uploads.empty();
+}
+
+int Diligent::VirtualTextureCache::AcquireSlot()
+{
+	if (!mFreeSlots.empty())
+	{
+		int SlotIdx = static_cast<int>(mFreeSlots.back());
+		mFreeSlots.pop_back();
+		return SlotIdx;
+	}
+
+	int Victim = -1;
+	for (uint32_t i = 0; i < mSlots.size(); ++i)
+	{
+		const Slot &CurrSlot = mSlots[i];
+		if (!CurrSlot.bPinned && CurrSlot.LastUsedFrame < mFrame &&
+			(Victim < 0 || CurrSlot.LastUsedFrame < mSlots[Victim].LastUsedFrame))
+		{
+			Victim = static_cast<int>(i);
+		}
+	}
+
+	if (Victim >= 0)
+	{
+		mResident.erase(mSlots[Victim].PageKey);
+		mSlots[Victim].PageKey = INVALID_PAGE_KEY;
+		++mStats.EvictionNum;
+	}
+	return Victim;
+}
+
+void Diligent::VirtualTextureCache::RebuildPageTable()
+{
+	//top down, a missing page takes the entry of its parent
+	for (int m = static_cast<int>(mMipNum) - 1; m >= 0; --m)
+	{
+		const uint32_t PageNum = GetPageNum(m);
+		std::vector<VirtualPageTableEntry> &Table = mPageTable[m];
+		for (uint32_t y = 0; y < PageNum; ++y)
+		{
+			for (uint32_t x = 0; x < PageNum; ++x)
+			{
+				VirtualPageTableEntry &Entry = Table[y * PageNum + x];
+				auto Iter = mResident.find(VirtualPageId({ uint32_t(m), x, y }).Pack());
+				if (Iter != mResident.end())
+				{
+					Entry.SlotX = static_cast<uint8_t>(Iter->second % mDesc.SlotNumX);
+					Entry.SlotY = static_cast<uint8_t>(Iter->second / mDesc.SlotNumX);
+					Entry.Mip = static_cast<uint8_t>(m);
+					Entry.Valid = 1;
+				}
+				else if (m + 1 < static_cast<int>(mMipNum))
+				{
+					const uint32_t ParentPageNum = GetPageNum(m + 1);
+					Entry = mPageTable[m + 1][(y / 2) * ParentPageNum + x / 2];
+				}
+				else
+				{
+					Entry = VirtualPageTableEntry({ 0, 0, static_cast<uint8_t>(m), 0 });
+				}
+			}
+		}
+	}
+}
+
+void Diligent::VirtualTextureCache::LoaderThreadFunc()
+{
+	const size_t PageBytes = size_t(GetSlotSize()) * GetSlotSize() * mDesc.TexelBytes;
+	for (;;)
+	{
+		uint32_t Key;
+		{
+			std::unique_lock<std::mutex> Lock(mQueueMutex);
+			mQueueCond.wait(Lock, [&]() { return mStopLoader || !mLoadQueue.empty(); });
+			if (mStopLoader)
+			{
+				return;
+			}
+			Key = mLoadQueue.front();
+			mLoadQueue.pop_front();
+		}
+
+		VirtualPageUpload Upload;
+		Upload.SlotX = 0;
+		Upload.SlotY = 0;
+		Upload.Page = VirtualPageId::Unpack(Key);
+		Upload.Data.resize(PageBytes);
+		mDesc.LoadPage(Upload.Page, &Upload.Data[0]);
+
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
+		mLoaded.push_back(std::move(Upload));
+	}
+}